@@ -0,0 +1 @@
+#define BLT_COMPILER_UNUSED(x) (void)(x)
@@ -21,8 +21,17 @@ CHUNK_SIZE=4096
 class MediaRequestHandler(BaseHTTPServer.BaseHTTPRequestHandler):
     server_version = "MediaTest/" + __version__
 
+    # HTTP/1.1 so that clients can keep connections alive
+    protocol_version = "HTTP/1.1"
+
+    def setup(self):
+        BaseHTTPServer.BaseHTTPRequestHandler.setup(self)
+        self.request_count = 0
+        if VERBOSE: print "CONNECTION", self.client_address
+
     def do_GET(self):
-        if VERBOSE: print "GET", self.path
+        self.request_count += 1
+        if VERBOSE: print "GET", self.path, self.client_address, "request #"+str(self.request_count), self.headers.getheader('Range')
         f = self.send_head()
         if f:
             self.copyfile(f, self.wfile)
@@ -47,14 +56,42 @@ class MediaRequestHandler(BaseHTTPServer.BaseHTTPRequestHandler):
         except IOError:
             self.send_error(404, "File not found")
             return None
-        self.send_response(200)
-        self.send_header("Content-type", ctype)
         fs = os.fstat(f.fileno())
-        self.send_header("Content-Length", str(fs[6]))
+        size = fs[6]
+        start, end = self.parse_range(size)
+        if start is None:
+            self.send_error(416, "Requested Range Not Satisfiable")
+            f.close()
+            return None
+        if end-start+1 == size:
+            self.send_response(200)
+        else:
+            self.send_response(206)
+            self.send_header("Content-Range", "bytes %d-%d/%d" % (start, end, size))
+        self.send_header("Content-type", ctype)
+        self.send_header("Content-Length", str(end-start+1))
+        self.send_header("Accept-Ranges", "bytes")
         self.send_header("Last-Modified", self.date_time_string(fs.st_mtime))
         self.end_headers()
+        f.seek(start)
+        self.remaining = end-start+1
         return f
 
+    def parse_range(self, size):
+        range = self.headers.getheader('Range')
+        if not range or not range.startswith('bytes='):
+            return 0, size-1
+        first, last = range[6:].split(',')[0].split('-')
+        if first == '':
+            start = max(0, size-int(last))
+            end = size-1
+        else:
+            start = int(first)
+            end = last and min(int(last), size-1) or size-1
+        if start >= size or start > end:
+            return None, None
+        return start, end
+
     def translate_path(self, path):
         path = urlparse.urlparse(path)[2]
         path = posixpath.normpath(urllib.unquote(path))
@@ -74,8 +111,8 @@ class MediaRequestHandler(BaseHTTPServer.BaseHTTPRequestHandler):
         
         total=0
         elapsed = 0
-        while True:
-            chunk = source.read(CHUNK_SIZE)
+        while self.remaining:
+            chunk = source.read(min(CHUNK_SIZE, self.remaining))
             #print "READ", len(chunk)
             if len(chunk) == 0: break
             try:
@@ -83,8 +120,10 @@ class MediaRequestHandler(BaseHTTPServer.BaseHTTPRequestHandler):
             except:
                 break
             total += len(chunk)
+            self.remaining -= len(chunk)
             now = time.time()
             elapsed = now-start
+            if elapsed == 0: continue
             rate = total/elapsed
             
             #print "STAT", total, elapsed, rate
@@ -93,7 +132,7 @@ class MediaRequestHandler(BaseHTTPServer.BaseHTTPRequestHandler):
                 
         print "END", time.time()
         print "ELAPSED", elapsed
-        print "BPS =", total/elapsed
+        if elapsed: print "BPS =", total/elapsed
         
     def guess_type(self, path):
         base, ext = posixpath.splitext(path)
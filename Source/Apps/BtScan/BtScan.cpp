@@ -0,0 +1,396 @@
+/*****************************************************************
+|
+|      File: BtScan.cpp
+|
+|      BlueTune - Media Scanner
+|
+|      (c) 2002-2012 Gilles Boccon-Gibod
+|      Author: Gilles Boccon-Gibod (bok@bok.net)
+|
+ ****************************************************************/
+
+/*----------------------------------------------------------------------
+|    includes
++---------------------------------------------------------------------*/
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "Atomix.h"
+#include "Neptune.h"
+#include "BlueTune.h"
+#include "BltLoudnessAnalyzerFilter.h"
+
+/*----------------------------------------------------------------------
+|    constants
++---------------------------------------------------------------------*/
+const unsigned int BTSCAN_DEFAULT_THREAD_COUNT = 4;
+const unsigned int BTSCAN_MAX_THREAD_COUNT     = 64;
+const char* const  BTSCAN_LOUDNESS_ANALYZER    = "com.axiosys.filter.loudness-analyzer";
+
+/*----------------------------------------------------------------------
+|    globals
++---------------------------------------------------------------------*/
+static struct {
+    unsigned int thread_count;
+    BLT_Flags    probe_flags;
+    bool         show_properties;
+    bool         measure_loudness;
+} Options;
+
+/*----------------------------------------------------------------------
+|    BtScanQueue
++---------------------------------------------------------------------*/
+class BtScanQueue {
+public:
+    BtScanQueue() : m_ActiveCount(0), m_FileCount(0), m_ErrorCount(0) {}
+
+    void Add(const char* path);
+    bool Get(NPT_String& path);
+    void Done(bool succeeded);
+    void Print(const NPT_String& text);
+
+    unsigned int GetFileCount()  { return m_FileCount;  }
+    unsigned int GetErrorCount() { return m_ErrorCount; }
+
+private:
+    NPT_Mutex            m_Lock;
+    NPT_Mutex            m_OutputLock;
+    NPT_List<NPT_String> m_Pending;
+    unsigned int         m_ActiveCount;
+    unsigned int         m_FileCount;
+    unsigned int         m_ErrorCount;
+};
+
+/*----------------------------------------------------------------------
+|    BtScanQueue::Add
++---------------------------------------------------------------------*/
+void
+BtScanQueue::Add(const char* path)
+{
+    NPT_AutoLock lock(m_Lock);
+    m_Pending.Add(path);
+}
+
+/*----------------------------------------------------------------------
+|    BtScanQueue::Get
++---------------------------------------------------------------------*/
+bool
+BtScanQueue::Get(NPT_String& path)
+{
+    for (;;) {
+        {
+            NPT_AutoLock lock(m_Lock);
+            if (NPT_SUCCEEDED(m_Pending.PopHead(path))) {
+                ++m_ActiveCount;
+                return true;
+            }
+
+            // nothing pending and nobody left to add more: we're done
+            if (m_ActiveCount == 0) return false;
+        }
+
+        // another worker may still be listing a directory
+        NPT_System::Sleep(NPT_TimeInterval(0.01));
+    }
+}
+
+/*----------------------------------------------------------------------
+|    BtScanQueue::Done
++---------------------------------------------------------------------*/
+void
+BtScanQueue::Done(bool succeeded)
+{
+    NPT_AutoLock lock(m_Lock);
+    --m_ActiveCount;
+    ++m_FileCount;
+    if (!succeeded) ++m_ErrorCount;
+}
+
+/*----------------------------------------------------------------------
+|    BtScanQueue::Print
++---------------------------------------------------------------------*/
+void
+BtScanQueue::Print(const NPT_String& text)
+{
+    NPT_AutoLock lock(m_OutputLock);
+    fputs(text.GetChars(), stdout);
+}
+
+/*----------------------------------------------------------------------
+|    BtScanWorker
++---------------------------------------------------------------------*/
+class BtScanWorker : public NPT_Thread {
+public:
+    BtScanWorker(BtScanQueue& queue) : m_Queue(queue), m_Decoder(NULL) {}
+    ~BtScanWorker() { if (m_Decoder) BLT_Decoder_Destroy(m_Decoder); }
+
+    // NPT_Runnable methods
+    void Run();
+
+private:
+    // methods
+    bool ScanDirectory(const NPT_String& path);
+    bool ScanFile(const NPT_String& path);
+    bool MeasureFile(const NPT_String& path);
+
+    // members
+    BtScanQueue& m_Queue;
+    BLT_Decoder* m_Decoder;
+};
+
+/*----------------------------------------------------------------------
+|    BtScanWorker::Run
++---------------------------------------------------------------------*/
+void
+BtScanWorker::Run()
+{
+    // each worker has its own decoder, so probes run fully in parallel
+    if (BLT_FAILED(BLT_Decoder_Create(&m_Decoder))) return;
+    BLT_Decoder_RegisterBuiltins(m_Decoder);
+
+    // decode everything to a null output, as fast as possible, through
+    // a loudness analyzer that only publishes its results at the end
+    if (Options.measure_loudness) {
+        ATX_Properties*   properties = NULL;
+        ATX_PropertyValue batch;
+        if (BLT_FAILED(BLT_Decoder_SetOutput(m_Decoder, "null", "audio/pcm")) ||
+            BLT_FAILED(BLT_Decoder_AddNodeByName(m_Decoder, NULL, BTSCAN_LOUDNESS_ANALYZER))) {
+            fprintf(stderr, "ERROR: the loudness analyzer is not available\n");
+            return;
+        }
+        BLT_Decoder_GetProperties(m_Decoder, &properties);
+        batch.type         = ATX_PROPERTY_VALUE_TYPE_INTEGER;
+        batch.data.integer = 1;
+        if (properties) {
+            ATX_Properties_SetProperty(properties, BLT_LOUDNESS_ANALYZER_FILTER_BATCH, &batch);
+        }
+    }
+
+    NPT_String path;
+    while (m_Queue.Get(path)) {
+        NPT_FileInfo info;
+        if (NPT_SUCCEEDED(NPT_File::GetInfo(path, &info)) &&
+            info.m_Type == NPT_FileInfo::FILE_TYPE_DIRECTORY) {
+            m_Queue.Done(ScanDirectory(path));
+        } else {
+            m_Queue.Done(Options.measure_loudness?MeasureFile(path):ScanFile(path));
+        }
+    }
+}
+
+/*----------------------------------------------------------------------
+|    BtScanWorker::ScanDirectory
++---------------------------------------------------------------------*/
+bool
+BtScanWorker::ScanDirectory(const NPT_String& path)
+{
+    NPT_List<NPT_String> entries;
+    if (NPT_FAILED(NPT_File::ListDir(path, entries))) return false;
+
+    for (NPT_List<NPT_String>::Iterator i = entries.GetFirstItem(); i; ++i) {
+        if (*i == "." || *i == "..") continue;
+        NPT_String child = path;
+        child += NPT_FilePath::Separator;
+        child += *i;
+        m_Queue.Add(child);
+    }
+
+    return true;
+}
+
+/*----------------------------------------------------------------------
+|    BtScanWorker::ScanFile
++---------------------------------------------------------------------*/
+bool
+BtScanWorker::ScanFile(const NPT_String& path)
+{
+    BLT_StreamInfo info;
+    BLT_Result     result = BLT_Decoder_Probe(m_Decoder, path, NULL, Options.probe_flags, &info);
+
+    // print everything for this file at once, so that lines don't interleave
+    NPT_String text = path;
+    if (BLT_FAILED(result)) {
+        text += NPT_String::Format(": ERROR %d (%s)\n", result, BLT_ResultText(result));
+        m_Queue.Print(text);
+        return false;
+    }
+    text += ":";
+    if (info.mask & BLT_STREAM_INFO_MASK_DATA_TYPE && info.data_type) {
+        text += NPT_String::Format(" type=%s", info.data_type);
+    }
+    if (info.mask & BLT_STREAM_INFO_MASK_DURATION) {
+        text += NPT_String::Format(" duration=%dms", (int)info.duration);
+    }
+    if (info.mask & BLT_STREAM_INFO_MASK_AVERAGE_BITRATE) {
+        text += NPT_String::Format(" bitrate=%d", info.average_bitrate);
+    } else if (info.mask & BLT_STREAM_INFO_MASK_NOMINAL_BITRATE) {
+        text += NPT_String::Format(" bitrate=%d", info.nominal_bitrate);
+    }
+    if (info.mask & BLT_STREAM_INFO_MASK_SAMPLE_RATE) {
+        text += NPT_String::Format(" sample_rate=%d", info.sample_rate);
+    }
+    if (info.mask & BLT_STREAM_INFO_MASK_CHANNEL_COUNT) {
+        text += NPT_String::Format(" channels=%d", info.channel_count);
+    }
+    text += "\n";
+
+    // the stream properties contain the tags
+    if (Options.show_properties) {
+        ATX_Properties* properties = NULL;
+        ATX_Iterator*   it = NULL;
+        void*           next;
+        BLT_Decoder_GetStreamProperties(m_Decoder, &properties);
+        if (properties && ATX_SUCCEEDED(ATX_Properties_GetIterator(properties, &it))) {
+            while (ATX_SUCCEEDED(ATX_Iterator_GetNext(it, &next))) {
+                ATX_Property* property = (ATX_Property*)next;
+                switch (property->value.type) {
+                  case ATX_PROPERTY_VALUE_TYPE_STRING:
+                    text += NPT_String::Format("  %s = %s\n", property->name, property->value.data.string);
+                    break;
+
+                  case ATX_PROPERTY_VALUE_TYPE_INTEGER:
+                    text += NPT_String::Format("  %s = %d\n", property->name, property->value.data.integer);
+                    break;
+
+                  default:
+                    break;
+                }
+            }
+            ATX_DESTROY_OBJECT(it);
+        }
+    }
+
+    m_Queue.Print(text);
+    return true;
+}
+
+/*----------------------------------------------------------------------
+|    BtScanWorker::MeasureFile
++---------------------------------------------------------------------*/
+bool
+BtScanWorker::MeasureFile(const NPT_String& path)
+{
+    // decode the whole file
+    BLT_Result result = BLT_Decoder_SetInput(m_Decoder, path, NULL);
+    while (BLT_SUCCEEDED(result)) {
+        result = BLT_Decoder_PumpPacket(m_Decoder);
+    }
+
+    NPT_String text = path;
+    if (result != BLT_ERROR_EOS) {
+        text += NPT_String::Format(": ERROR %d (%s)\n", result, BLT_ResultText(result));
+        m_Queue.Print(text);
+        return false;
+    }
+
+    // the analyzer publishes its results as stream properties, in 100th of a unit
+    static const struct {
+        const char* property;
+        const char* label;
+        const char* unit;
+    } results[] = {
+        { BLT_LOUDNESS_ANALYZER_FILTER_INTEGRATED, "integrated", "LUFS" },
+        { BLT_LOUDNESS_ANALYZER_FILTER_TRUE_PEAK,  "true_peak",  "dBTP" },
+        { BLT_LOUDNESS_ANALYZER_FILTER_TRACK_GAIN, "track_gain", "dB"   }
+    };
+    ATX_Properties* properties = NULL;
+    BLT_Decoder_GetStreamProperties(m_Decoder, &properties);
+    text += ":";
+    for (unsigned int i=0; i<sizeof(results)/sizeof(results[0]); i++) {
+        ATX_PropertyValue value;
+        if (properties &&
+            ATX_SUCCEEDED(ATX_Properties_GetProperty(properties, results[i].property, &value)) &&
+            value.type == ATX_PROPERTY_VALUE_TYPE_INTEGER) {
+            text += NPT_String::Format(" %s=%.2f%s",
+                                       results[i].label,
+                                       (double)value.data.integer/100.0,
+                                       results[i].unit);
+        }
+    }
+    text += "\n";
+
+    m_Queue.Print(text);
+    return true;
+}
+
+/*----------------------------------------------------------------------
+|    PrintUsageAndExit
++---------------------------------------------------------------------*/
+static void
+PrintUsageAndExit()
+{
+    printf("btscan [options] <path> [<path> ...]\n"
+           "  paths can be files or directories, which are scanned recursively\n"
+           "  options:\n"
+           "  --threads=<n>:   number of scanning threads [def=%d]\n"
+           "  --decoders:      allow decoders to be used (needed for the duration of some formats, like MP3)\n"
+           "  --properties:    print the stream properties (tags)\n"
+           "  --loudness:      decode the files and measure their EBU R128 loudness and ReplayGain 2.0 track gain\n",
+           BTSCAN_DEFAULT_THREAD_COUNT
+        );
+    exit(1);
+}
+
+/*----------------------------------------------------------------------
+|    main
++---------------------------------------------------------------------*/
+int
+main(int argc, char** argv)
+{
+    if (argc < 2) PrintUsageAndExit();
+
+    // default options
+    Options.thread_count     = BTSCAN_DEFAULT_THREAD_COUNT;
+    Options.probe_flags      = 0;
+    Options.show_properties  = false;
+    Options.measure_loudness = false;
+
+    // parse the command line
+    BtScanQueue queue;
+    char*       arg;
+    argv++;
+    while ((arg = *argv++)) {
+        if (!strncmp(arg, "--threads=", 10)) {
+            Options.thread_count = strtoul(arg+10, NULL, 10);
+            if (Options.thread_count == 0) Options.thread_count = 1;
+            if (Options.thread_count > BTSCAN_MAX_THREAD_COUNT) Options.thread_count = BTSCAN_MAX_THREAD_COUNT;
+        } else if (!strcmp(arg, "--decoders")) {
+            Options.probe_flags |= BLT_DECODER_PROBE_FLAG_ALLOW_DECODERS;
+        } else if (!strcmp(arg, "--properties")) {
+            Options.show_properties = true;
+        } else if (!strcmp(arg, "--loudness")) {
+            Options.measure_loudness = true;
+        } else if (!strncmp(arg, "--", 2)) {
+            fprintf(stderr, "ERROR: invalid option '%s'\n", arg);
+            PrintUsageAndExit();
+        } else {
+            queue.Add(arg);
+        }
+    }
+
+    // start the workers
+    NPT_TimeStamp start;
+    NPT_System::GetCurrentTimeStamp(start);
+    NPT_Array<BtScanWorker*> workers;
+    for (unsigned int i=0; i<Options.thread_count; i++) {
+        BtScanWorker* worker = new BtScanWorker(queue);
+        workers.Add(worker);
+        worker->Start();
+    }
+
+    // wait for all the workers to be done
+    for (unsigned int i=0; i<workers.GetItemCount(); i++) {
+        workers[i]->Wait();
+        delete workers[i];
+    }
+    NPT_TimeStamp end;
+    NPT_System::GetCurrentTimeStamp(end);
+
+    fprintf(stderr, "scanned %d entries (%d errors) in %d ms\n",
+            queue.GetFileCount(),
+            queue.GetErrorCount(),
+            (int)(end.ToMillis()-start.ToMillis()));
+
+    return 0;
+}
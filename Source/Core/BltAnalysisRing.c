@@ -0,0 +1,160 @@
+/*****************************************************************
+|
+|   BlueTune - Analysis Ring
+|
+|   (c) 2002-2012 Gilles Boccon-Gibod
+|   Author: Gilles Boccon-Gibod (bok@bok.net)
+|
+ ****************************************************************/
+
+/*----------------------------------------------------------------------
+|   includes
++---------------------------------------------------------------------*/
+#include "Atomix.h"
+#include "BltMemoryBarrier.h"
+#include "BltAnalysisRing.h"
+
+/*----------------------------------------------------------------------
+|   types
++---------------------------------------------------------------------*/
+typedef struct {
+    /* 2n+1 while frame n is written, 2n+2 once it is published */
+    volatile BLT_UInt32 state;
+    BLT_AnalysisFrame   frame;
+} BLT_AnalysisRingSlot;
+
+struct BLT_AnalysisRing {
+    BLT_Cardinal          size;
+    BLT_Flags             flags;
+    volatile BLT_UInt32   write_count; /* number of frames published */
+    BLT_AnalysisRingSlot* slots;
+};
+
+/*----------------------------------------------------------------------
+|   BLT_AnalysisRing_Create
++---------------------------------------------------------------------*/
+BLT_Result
+BLT_AnalysisRing_Create(BLT_Cardinal       size,
+                        BLT_Flags          flags,
+                        BLT_AnalysisRing** ring)
+{
+    BLT_AnalysisRing* self;
+
+    *ring = NULL;
+    if (size == 0) return BLT_ERROR_INVALID_PARAMETERS;
+
+    /* allocate everything at once */
+    self = (BLT_AnalysisRing*)ATX_AllocateZeroMemory(sizeof(BLT_AnalysisRing)+
+                                                      size*sizeof(BLT_AnalysisRingSlot));
+    if (self == NULL) return BLT_ERROR_OUT_OF_MEMORY;
+    self->size  = size;
+    self->flags = flags;
+    self->slots = (BLT_AnalysisRingSlot*)(void*)(self+1);
+
+    *ring = self;
+    return BLT_SUCCESS;
+}
+
+/*----------------------------------------------------------------------
+|   BLT_AnalysisRing_Destroy
++---------------------------------------------------------------------*/
+void
+BLT_AnalysisRing_Destroy(BLT_AnalysisRing* self)
+{
+    ATX_FreeMemory(self);
+}
+
+/*----------------------------------------------------------------------
+|   BLT_AnalysisRing_GetFlags
++---------------------------------------------------------------------*/
+BLT_Flags
+BLT_AnalysisRing_GetFlags(const BLT_AnalysisRing* self)
+{
+    return self->flags;
+}
+
+/*----------------------------------------------------------------------
+|   BLT_AnalysisRing_BeginWrite
++---------------------------------------------------------------------*/
+BLT_AnalysisFrame*
+BLT_AnalysisRing_BeginWrite(BLT_AnalysisRing* self)
+{
+    BLT_UInt32            n    = self->write_count;
+    BLT_AnalysisRingSlot* slot = &self->slots[n%self->size];
+
+    /* let the readers know that the slot is changing */
+    slot->state = 2*n+1;
+    BLT_MEMORY_BARRIER();
+    slot->frame.sequence = n;
+
+    return &slot->frame;
+}
+
+/*----------------------------------------------------------------------
+|   BLT_AnalysisRing_EndWrite
++---------------------------------------------------------------------*/
+void
+BLT_AnalysisRing_EndWrite(BLT_AnalysisRing* self)
+{
+    BLT_UInt32            n    = self->write_count;
+    BLT_AnalysisRingSlot* slot = &self->slots[n%self->size];
+
+    BLT_MEMORY_BARRIER();
+    slot->state = 2*n+2;
+    BLT_MEMORY_BARRIER();
+    self->write_count = n+1;
+}
+
+/*----------------------------------------------------------------------
+|   BLT_AnalysisRing_Read
++---------------------------------------------------------------------*/
+BLT_Result
+BLT_AnalysisRing_Read(BLT_AnalysisRing*  self,
+                      BLT_UInt32*        cursor,
+                      BLT_AnalysisFrame* frame)
+{
+    for (;;) {
+        BLT_UInt32            available = self->write_count;
+        BLT_AnalysisRingSlot* slot;
+        BLT_UInt32            state;
+
+        BLT_MEMORY_BARRIER();
+        if (*cursor == available) return BLT_ERROR_WOULD_BLOCK;
+
+        /* skip the frames that have been overwritten already */
+        if (available-*cursor > self->size) {
+            *cursor = available > self->size ? available-self->size : 0;
+        }
+
+        /* copy the frame, and check that it did not change meanwhile */
+        slot  = &self->slots[*cursor%self->size];
+        state = slot->state;
+        BLT_MEMORY_BARRIER();
+        if (state == 2*(*cursor)+2) {
+            ATX_CopyMemory(frame, &slot->frame, sizeof(*frame));
+            BLT_MEMORY_BARRIER();
+            if (slot->state == state) {
+                ++*cursor;
+                return BLT_SUCCESS;
+            }
+        }
+
+        /* the writer got to this slot first, move on */
+        ++*cursor;
+    }
+}
+
+/*----------------------------------------------------------------------
+|   BLT_AnalysisRing_ReadLatest
++---------------------------------------------------------------------*/
+BLT_Result
+BLT_AnalysisRing_ReadLatest(BLT_AnalysisRing*  self,
+                            BLT_AnalysisFrame* frame)
+{
+    BLT_UInt32 cursor = self->write_count;
+
+    if (cursor == 0) return BLT_ERROR_WOULD_BLOCK;
+    --cursor;
+
+    return BLT_AnalysisRing_Read(self, &cursor, frame);
+}
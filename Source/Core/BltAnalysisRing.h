@@ -0,0 +1,146 @@
+/*****************************************************************
+|
+|   BlueTune - Analysis Ring
+|
+|   (c) 2002-2012 Gilles Boccon-Gibod
+|   Author: Gilles Boccon-Gibod (bok@bok.net)
+|
+ ****************************************************************/
+/** @file
+ * Analysis Ring: fixed size audio analysis frames (levels and spectrum),
+ * written by one thread (the decoding thread) and read by any number of
+ * other threads (typically user interface threads).
+ * The writer never waits for the readers and never allocates memory:
+ * when the readers fall behind, the oldest frames are overwritten.
+ * Readers never block the writer: they detect frames that were
+ * overwritten while they were copying them, and skip them.
+ */
+
+#ifndef _BLT_ANALYSIS_RING_H_
+#define _BLT_ANALYSIS_RING_H_
+
+/*----------------------------------------------------------------------
+|   includes
++---------------------------------------------------------------------*/
+#include "Atomix.h"
+#include "BltDefs.h"
+#include "BltTypes.h"
+#include "BltErrors.h"
+#include "BltTime.h"
+
+/*----------------------------------------------------------------------
+|   constants
++---------------------------------------------------------------------*/
+/**
+ * Name of the core property through which an analysis ring is handed to
+ * the analysis tap node (pointer to a BLT_AnalysisRing).
+ */
+#define BLT_ANALYSIS_RING_PROPERTY     "AnalysisRing"
+
+/**
+ * Name of the module that creates analysis tap nodes, which analyze the
+ * audio flowing through them and write frames to the analysis ring.
+ */
+#define BLT_ANALYSIS_TAP_MODULE_NAME   "com.axiosys.filter.analysis-tap"
+
+#define BLT_ANALYSIS_MAX_CHANNELS      8
+#define BLT_ANALYSIS_BLOCK_SIZE        1024 /* frames analyzed per analysis frame */
+#define BLT_ANALYSIS_SPECTRUM_SIZE     (BLT_ANALYSIS_BLOCK_SIZE/2)
+#define BLT_ANALYSIS_RING_DEFAULT_SIZE 32
+
+/** Compute a magnitude spectrum for each analysis frame. */
+#define BLT_ANALYSIS_RING_FLAG_SPECTRUM 1
+
+/*----------------------------------------------------------------------
+|   types
++---------------------------------------------------------------------*/
+/**
+ * Analysis of one block of audio.
+ */
+typedef struct {
+    BLT_UInt32    sequence;      /**< Frame number, counted from the creation of the ring */
+    BLT_TimeStamp time_stamp;    /**< Stream time of the first frame of the block         */
+    BLT_Cardinal  sample_rate;
+    BLT_Cardinal  channel_count;
+    BLT_Cardinal  sample_count;  /**< Number of frames analyzed                            */
+    float         rms[BLT_ANALYSIS_MAX_CHANNELS];  /**< RMS level per channel, 1.0 = full scale  */
+    float         peak[BLT_ANALYSIS_MAX_CHANNELS]; /**< Peak level per channel, 1.0 = full scale */
+
+    /**
+     * Number of values in the spectrum: 0 when the spectrum is not
+     * computed, or BLT_ANALYSIS_SPECTRUM_SIZE.
+     */
+    BLT_Cardinal  spectrum_size;
+
+    /**
+     * Magnitude spectrum of the channels mixed down to mono.
+     * Bin i is centered on i*sample_rate/BLT_ANALYSIS_BLOCK_SIZE Hz.
+     * A full scale sine wave has a magnitude close to 1.0.
+     */
+    float         spectrum[BLT_ANALYSIS_SPECTRUM_SIZE];
+} BLT_AnalysisFrame;
+
+typedef struct BLT_AnalysisRing BLT_AnalysisRing;
+
+/*----------------------------------------------------------------------
+|   prototypes
++---------------------------------------------------------------------*/
+#if defined(__cplusplus)
+extern "C" {
+#endif
+
+/**
+ * Create a ring.
+ * @param size Number of frames that the ring can hold.
+ * @param flags Combination of BLT_ANALYSIS_RING_FLAG_XXX flags, telling
+ * the writer what to compute.
+ */
+BLT_Result BLT_AnalysisRing_Create(BLT_Cardinal       size,
+                                   BLT_Flags          flags,
+                                   BLT_AnalysisRing** ring);
+
+/**
+ * Destroy a ring. The writer and all the readers must be done with it.
+ */
+void BLT_AnalysisRing_Destroy(BLT_AnalysisRing* self);
+
+BLT_Flags BLT_AnalysisRing_GetFlags(const BLT_AnalysisRing* self);
+
+/**
+ * Get the frame to fill next. Only one thread may write to a ring.
+ * The frame is published by BLT_AnalysisRing_EndWrite.
+ */
+BLT_AnalysisFrame* BLT_AnalysisRing_BeginWrite(BLT_AnalysisRing* self);
+
+/**
+ * Publish the frame obtained from BLT_AnalysisRing_BeginWrite.
+ */
+void BLT_AnalysisRing_EndWrite(BLT_AnalysisRing* self);
+
+/**
+ * Copy the next frame for a reader.
+ * Each reader keeps its own cursor, which should start at 0. Frames
+ * that were overwritten before the reader could get them are skipped,
+ * which the reader can detect with the frame sequence numbers.
+ * @param cursor Sequence number of the next frame to read, updated
+ * by this function.
+ * @return BLT_SUCCESS if a frame was copied, BLT_ERROR_WOULD_BLOCK if
+ * there is no new frame.
+ */
+BLT_Result BLT_AnalysisRing_Read(BLT_AnalysisRing*  self,
+                                 BLT_UInt32*        cursor,
+                                 BLT_AnalysisFrame* frame);
+
+/**
+ * Copy the most recent frame.
+ * @return BLT_SUCCESS if a frame was copied, BLT_ERROR_WOULD_BLOCK if
+ * no frame was written yet.
+ */
+BLT_Result BLT_AnalysisRing_ReadLatest(BLT_AnalysisRing*  self,
+                                       BLT_AnalysisFrame* frame);
+
+#if defined(__cplusplus)
+}
+#endif
+
+#endif /* _BLT_ANALYSIS_RING_H_ */
@@ -34,6 +34,7 @@ struct BLT_MediaPacket {
     BLT_Flags      flags;
     BLT_TimeStamp  time_stamp;
     BLT_Time       duration;
+    BLT_MediaPacketBufferDestructor buffer_destructor;
 };
 
 /*----------------------------------------------------------------------
@@ -76,6 +77,46 @@ BLT_MediaPacket_Create(BLT_Size             size,
     return BLT_SUCCESS;
 }
 
+/*----------------------------------------------------------------------
+|    BLT_MediaPacket_CreateWithBuffer
++---------------------------------------------------------------------*/
+BLT_Result
+BLT_MediaPacket_CreateWithBuffer(BLT_Any                                buffer,
+                                 BLT_Size                               size,
+                                 const BLT_MediaType*                   type,
+                                 const BLT_MediaPacketBufferDestructor* destructor,
+                                 BLT_MediaPacket**                      packet)
+{
+    BLT_Result result;
+
+    /* create a packet without a buffer */
+    result = BLT_MediaPacket_Create(0, type, packet);
+    if (BLT_FAILED(result)) return result;
+
+    /* use the caller's buffer */
+    (*packet)->payload           = buffer;
+    (*packet)->allocated_size    = size;
+    (*packet)->payload_size      = size;
+    (*packet)->buffer_destructor = *destructor;
+
+    return BLT_SUCCESS;
+}
+
+/*----------------------------------------------------------------------
+|    BLT_MediaPacket_FreeBuffer
++---------------------------------------------------------------------*/
+static void
+BLT_MediaPacket_FreeBuffer(BLT_MediaPacket* packet)
+{
+    if (packet->buffer_destructor.Destruct) {
+        packet->buffer_destructor.Destruct(packet->buffer_destructor.instance, 
+                                           packet->payload);
+        packet->buffer_destructor.Destruct = NULL;
+    } else {
+        ATX_FreeMemory(packet->payload);
+    }
+}
+
 /*----------------------------------------------------------------------
 |    BLT_MediaPacket_Destroy
 +---------------------------------------------------------------------*/
@@ -84,7 +125,7 @@ BLT_MediaPacket_Destroy(BLT_MediaPacket* packet)
 {
     /* free the packet payload */
     if (packet->payload) {
-        ATX_FreeMemory(packet->payload);
+        BLT_MediaPacket_FreeBuffer(packet);
     }
 
     /* free the media type extensions if any */
@@ -219,7 +260,7 @@ BLT_MediaPacket_SetAllocatedSize(BLT_MediaPacket* packet, BLT_Size size)
 
         /* free the previous buffer, if any */
         if (packet->payload) {
-            ATX_FreeMemory(packet->payload);
+            BLT_MediaPacket_FreeBuffer(packet);
         }
         
         /* use the new buffer */
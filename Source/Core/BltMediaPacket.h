@@ -38,6 +38,15 @@
  */
 typedef struct BLT_MediaPacket BLT_MediaPacket;
 
+/**
+ * Destructor for a payload buffer that a packet doesn't own.
+ * @see BLT_MediaPacket_CreateWithBuffer
+ */
+typedef struct {
+    BLT_Any instance;
+    void (*Destruct)(BLT_Any instance, BLT_Any buffer);
+} BLT_MediaPacketBufferDestructor;
+
 /** @} */
 
 /*----------------------------------------------------------------------
@@ -95,6 +104,20 @@ typedef struct BLT_MediaPacket BLT_MediaPacket;
 extern "C" {
 #endif
 
+/**
+ * Create a packet whose payload is a buffer allocated by the caller,
+ * without copying it. The payload size is set to the size of the buffer.
+ * The destructor is called when the packet no longer uses the buffer:
+ * when the packet is destroyed, or when the buffer needs to be replaced
+ * by a larger one.
+ * @param destructor Destructor for the buffer, copied by the packet.
+ */
+BLT_Result BLT_MediaPacket_CreateWithBuffer(BLT_Any                                buffer,
+                                            BLT_Size                               size,
+                                            const BLT_MediaType*                   type,
+                                            const BLT_MediaPacketBufferDestructor* destructor,
+                                            BLT_MediaPacket**                      packet);
+
 /**
  * Increase the reference counter of a packet.
  */
@@ -0,0 +1,32 @@
+/*****************************************************************
+|
+|   BlueTune - Memory Barrier
+|
+|   (c) 2002-2012 Gilles Boccon-Gibod
+|   Author: Gilles Boccon-Gibod (bok@bok.net)
+|
+ ****************************************************************/
+/** @file
+ * Full memory barrier, for the lock-free structures shared between a
+ * producer and a consumer thread (BLT_OutputBuffer, BLT_AnalysisRing):
+ * they only share plain 32-bit counters and sequence numbers, so a
+ * barrier between the accesses to those and to the data is all the
+ * synchronization that they need.
+ */
+
+#ifndef _BLT_MEMORY_BARRIER_H_
+#define _BLT_MEMORY_BARRIER_H_
+
+/*----------------------------------------------------------------------
+|   macros
++---------------------------------------------------------------------*/
+#if defined(_MSC_VER)
+#include <windows.h>
+#define BLT_MEMORY_BARRIER() MemoryBarrier()
+#elif defined(__GNUC__)
+#define BLT_MEMORY_BARRIER() __sync_synchronize()
+#else
+#error "no memory barrier for this compiler"
+#endif
+
+#endif /* _BLT_MEMORY_BARRIER_H_ */
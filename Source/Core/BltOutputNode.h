@@ -32,6 +32,15 @@
 #define BLT_OUTPUT_NODE_HEIGHT     "OutputNode.Height"
 #define BLT_OUTPUT_NODE_FULLSCREEN "OutputNode.FullScreen"
 
+/**
+ * Media type for an output used as a probe sink. Outputs created with
+ * this type accept packets of any type, but advertise a type that no
+ * other node produces, so that a stream only interpolates the parsers
+ * it needs to get from its input to the first packet, and not the
+ * decoders that would be chosen to produce PCM or raw video.
+ */
+#define BLT_OUTPUT_NODE_PROBE_MIME_TYPE "application/x-bluetune-probe"
+
 /*----------------------------------------------------------------------
 |   types
 +---------------------------------------------------------------------*/
@@ -15,6 +15,46 @@
 +---------------------------------------------------------------------*/
 #include "BltPixels.h"
 
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#define BLT_PIXELS_SSE2
+#include <emmintrin.h>
+#elif defined(__ARM_NEON__) || defined(__ARM_NEON)
+#define BLT_PIXELS_NEON
+#include <arm_neon.h>
+#endif
+
+/*----------------------------------------------------------------------
+|   constants
++---------------------------------------------------------------------*/
+/* BT.601 limited range, scaled by 64, so that the products of the     */
+/* vector code fit in 16 bits; the scalar code computes the same thing */
+#define BLT_PIXELS_Y_FACTOR   74  /* 1.164 */
+#define BLT_PIXELS_RV_FACTOR  102 /* 1.596 */
+#define BLT_PIXELS_GU_FACTOR  25  /* 0.391 */
+#define BLT_PIXELS_GV_FACTOR  52  /* 0.813 */
+#define BLT_PIXELS_BU_FACTOR  129 /* 2.018 */
+#define BLT_PIXELS_SHIFT      6
+
+/*----------------------------------------------------------------------
+|   types
++---------------------------------------------------------------------*/
+typedef struct {
+    unsigned int index;  /* first source sample */
+    unsigned int next;   /* second source sample */
+    unsigned int weight; /* of the second sample, out of 256 */
+} BLT_PixelScalerTap;
+
+struct BLT_PixelScaler {
+    unsigned int        src_width;
+    unsigned int        src_height;
+    unsigned int        dst_width;
+    unsigned int        dst_height;
+    BLT_PixelFormat     dst_format;
+    BLT_PixelScalerTap* luma_taps;    /* horizontal, dst_width entries */
+    BLT_PixelScalerTap* chroma_taps;  /* horizontal, (dst_width+1)/2 entries */
+    BLT_UInt8*          rows[6];      /* vertically, then horizontally scaled Y, U, V */
+};
+
 /*----------------------------------------------------------------------
 |   BLT_RawVideoMediaType_Init
 +---------------------------------------------------------------------*/
@@ -26,3 +66,426 @@ BLT_RawVideoMediaType_Init(BLT_RawVideoMediaType* media_type)
     media_type->base.extension_size = sizeof(BLT_RawVideoMediaType)-sizeof(BLT_MediaType);
 }
 
+/*----------------------------------------------------------------------
+|   BLT_Pixels_Saturate16
++---------------------------------------------------------------------*/
+static int
+BLT_Pixels_Saturate16(int x)
+{
+    return x > 32767 ? 32767 : (x < -32768 ? -32768 : x);
+}
+
+/*----------------------------------------------------------------------
+|   BLT_Pixels_ConvertYuv420RowScalar
+|
+|   Same arithmetic as the vector code, saturations included, so that
+|   all the implementations produce the same pixels.
++---------------------------------------------------------------------*/
+static void
+BLT_Pixels_ConvertYuv420RowScalar(const BLT_UInt8* y,
+                                  const BLT_UInt8* u,
+                                  const BLT_UInt8* v,
+                                  BLT_UInt8*       dst,
+                                  unsigned int     width,
+                                  BLT_PixelFormat  format)
+{
+    unsigned int r_offset = format == BLT_PIXEL_FORMAT_RGBA ? 0 : 2;
+    unsigned int b_offset = 2-r_offset;
+    unsigned int x;
+
+    for (x=0; x<width; x++) {
+        int luma = (y[x]-16)*BLT_PIXELS_Y_FACTOR;
+        int cb   = u[x/2]-128;
+        int cr   = v[x/2]-128;
+        int r    = BLT_Pixels_Saturate16(luma+cr*BLT_PIXELS_RV_FACTOR)>>BLT_PIXELS_SHIFT;
+        int g    = BLT_Pixels_Saturate16(BLT_Pixels_Saturate16(luma-cr*BLT_PIXELS_GV_FACTOR)-
+                                         cb*BLT_PIXELS_GU_FACTOR)>>BLT_PIXELS_SHIFT;
+        int b    = BLT_Pixels_Saturate16(luma+cb*BLT_PIXELS_BU_FACTOR)>>BLT_PIXELS_SHIFT;
+        dst[r_offset] = (BLT_UInt8)(r < 0 ? 0 : (r > 255 ? 255 : r));
+        dst[1]        = (BLT_UInt8)(g < 0 ? 0 : (g > 255 ? 255 : g));
+        dst[b_offset] = (BLT_UInt8)(b < 0 ? 0 : (b > 255 ? 255 : b));
+        dst[3]        = 255;
+        dst += 4;
+    }
+}
+
+#if defined(BLT_PIXELS_SSE2)
+/*----------------------------------------------------------------------
+|   BLT_Pixels_ConvertYuv420RowSse2
+|
+|   16 pixels at a time.
++---------------------------------------------------------------------*/
+static unsigned int
+BLT_Pixels_ConvertYuv420RowSse2(const BLT_UInt8* y,
+                                const BLT_UInt8* u,
+                                const BLT_UInt8* v,
+                                BLT_UInt8*       dst,
+                                unsigned int     width,
+                                BLT_PixelFormat  format)
+{
+    const __m128i zero      = _mm_setzero_si128();
+    const __m128i alpha     = _mm_set1_epi8((char)0xFF);
+    const __m128i offset_y  = _mm_set1_epi16(16);
+    const __m128i offset_uv = _mm_set1_epi16(128);
+    const __m128i factor_y  = _mm_set1_epi16(BLT_PIXELS_Y_FACTOR);
+    const __m128i factor_rv = _mm_set1_epi16(BLT_PIXELS_RV_FACTOR);
+    const __m128i factor_gu = _mm_set1_epi16(BLT_PIXELS_GU_FACTOR);
+    const __m128i factor_gv = _mm_set1_epi16(BLT_PIXELS_GV_FACTOR);
+    const __m128i factor_bu = _mm_set1_epi16(BLT_PIXELS_BU_FACTOR);
+    unsigned int  x;
+
+    for (x=0; x+16 <= width; x += 16) {
+        __m128i luma = _mm_loadu_si128((const __m128i*)(y+x));
+        __m128i cb   = _mm_sub_epi16(_mm_unpacklo_epi8(_mm_loadl_epi64((const __m128i*)(u+x/2)), zero), offset_uv);
+        __m128i cr   = _mm_sub_epi16(_mm_unpacklo_epi8(_mm_loadl_epi64((const __m128i*)(v+x/2)), zero), offset_uv);
+        __m128i r[2], g[2], b[2];
+        __m128i r8, g8, b8, first, second;
+        unsigned int half;
+
+        for (half=0; half<2; half++) {
+            /* each chroma sample covers two pixels */
+            __m128i l  = _mm_mullo_epi16(_mm_sub_epi16(half ? _mm_unpackhi_epi8(luma, zero) :
+                                                              _mm_unpacklo_epi8(luma, zero),
+                                                       offset_y), 
+                                         factor_y);
+            __m128i cbh = half ? _mm_unpackhi_epi16(cb, cb) : _mm_unpacklo_epi16(cb, cb);
+            __m128i crh = half ? _mm_unpackhi_epi16(cr, cr) : _mm_unpacklo_epi16(cr, cr);
+            r[half] = _mm_srai_epi16(_mm_adds_epi16(l, _mm_mullo_epi16(crh, factor_rv)), BLT_PIXELS_SHIFT);
+            g[half] = _mm_srai_epi16(_mm_subs_epi16(_mm_subs_epi16(l, _mm_mullo_epi16(crh, factor_gv)),
+                                                    _mm_mullo_epi16(cbh, factor_gu)),
+                                     BLT_PIXELS_SHIFT);
+            b[half] = _mm_srai_epi16(_mm_adds_epi16(l, _mm_mullo_epi16(cbh, factor_bu)), BLT_PIXELS_SHIFT);
+        }
+        r8 = _mm_packus_epi16(r[0], r[1]);
+        g8 = _mm_packus_epi16(g[0], g[1]);
+        b8 = _mm_packus_epi16(b[0], b[1]);
+        if (format == BLT_PIXEL_FORMAT_RGBA) {
+            __m128i swap = r8;
+            r8 = b8;
+            b8 = swap;
+        }
+
+        /* interleave, the bytes of each pixel being in B,G,R,A order here */
+        first  = _mm_unpacklo_epi8(b8, g8);
+        second = _mm_unpacklo_epi8(r8, alpha);
+        _mm_storeu_si128((__m128i*)(dst   ), _mm_unpacklo_epi16(first, second));
+        _mm_storeu_si128((__m128i*)(dst+16), _mm_unpackhi_epi16(first, second));
+        first  = _mm_unpackhi_epi8(b8, g8);
+        second = _mm_unpackhi_epi8(r8, alpha);
+        _mm_storeu_si128((__m128i*)(dst+32), _mm_unpacklo_epi16(first, second));
+        _mm_storeu_si128((__m128i*)(dst+48), _mm_unpackhi_epi16(first, second));
+        dst += 64;
+    }
+
+    return x;
+}
+#endif
+
+#if defined(BLT_PIXELS_NEON)
+/*----------------------------------------------------------------------
+|   BLT_Pixels_ConvertYuv420RowNeon
+|
+|   16 pixels at a time.
++---------------------------------------------------------------------*/
+static unsigned int
+BLT_Pixels_ConvertYuv420RowNeon(const BLT_UInt8* y,
+                                const BLT_UInt8* u,
+                                const BLT_UInt8* v,
+                                BLT_UInt8*       dst,
+                                unsigned int     width,
+                                BLT_PixelFormat  format)
+{
+    const int16x8_t offset_y  = vdupq_n_s16(16);
+    const int16x8_t offset_uv = vdupq_n_s16(128);
+    unsigned int    x;
+
+    for (x=0; x+16 <= width; x += 16) {
+        uint8x16_t   luma = vld1q_u8(y+x);
+        int16x8_t    cb   = vsubq_s16(vreinterpretq_s16_u16(vmovl_u8(vld1_u8(u+x/2))), offset_uv);
+        int16x8_t    cr   = vsubq_s16(vreinterpretq_s16_u16(vmovl_u8(vld1_u8(v+x/2))), offset_uv);
+        int16x8x2_t  cb2  = vzipq_s16(cb, cb); /* each chroma sample covers two pixels */
+        int16x8x2_t  cr2  = vzipq_s16(cr, cr);
+        uint8x8_t    r[2], g[2], b[2];
+        uint8x16x4_t pixels;
+        unsigned int half;
+
+        for (half=0; half<2; half++) {
+            int16x8_t l = vmulq_n_s16(vsubq_s16(vreinterpretq_s16_u16(vmovl_u8(half ? vget_high_u8(luma) :
+                                                                                      vget_low_u8(luma))),
+                                                offset_y),
+                                      BLT_PIXELS_Y_FACTOR);
+            r[half] = vqmovun_s16(vshrq_n_s16(vqaddq_s16(l, vmulq_n_s16(cr2.val[half], BLT_PIXELS_RV_FACTOR)), 
+                                              BLT_PIXELS_SHIFT));
+            g[half] = vqmovun_s16(vshrq_n_s16(vqsubq_s16(vqsubq_s16(l, vmulq_n_s16(cr2.val[half], BLT_PIXELS_GV_FACTOR)),
+                                                         vmulq_n_s16(cb2.val[half], BLT_PIXELS_GU_FACTOR)),
+                                              BLT_PIXELS_SHIFT));
+            b[half] = vqmovun_s16(vshrq_n_s16(vqaddq_s16(l, vmulq_n_s16(cb2.val[half], BLT_PIXELS_BU_FACTOR)), 
+                                              BLT_PIXELS_SHIFT));
+        }
+        pixels.val[format == BLT_PIXEL_FORMAT_RGBA ? 0 : 2] = vcombine_u8(r[0], r[1]);
+        pixels.val[1]                                       = vcombine_u8(g[0], g[1]);
+        pixels.val[format == BLT_PIXEL_FORMAT_RGBA ? 2 : 0] = vcombine_u8(b[0], b[1]);
+        pixels.val[3]                                       = vdupq_n_u8(255);
+        vst4q_u8(dst, pixels);
+        dst += 64;
+    }
+
+    return x;
+}
+#endif
+
+/*----------------------------------------------------------------------
+|   BLT_Pixels_ConvertYuv420Row
++---------------------------------------------------------------------*/
+void
+BLT_Pixels_ConvertYuv420Row(const BLT_UInt8* y,
+                            const BLT_UInt8* u,
+                            const BLT_UInt8* v,
+                            BLT_UInt8*       dst,
+                            unsigned int     width,
+                            BLT_PixelFormat  format)
+{
+    unsigned int done = 0;
+
+#if defined(BLT_PIXELS_SSE2)
+    done = BLT_Pixels_ConvertYuv420RowSse2(y, u, v, dst, width, format);
+#elif defined(BLT_PIXELS_NEON)
+    done = BLT_Pixels_ConvertYuv420RowNeon(y, u, v, dst, width, format);
+#endif
+
+    /* the rest, an even number of pixels having been done */
+    if (done < width) {
+        BLT_Pixels_ConvertYuv420RowScalar(y+done, u+done/2, v+done/2, dst+4*done, width-done, format);
+    }
+}
+
+/*----------------------------------------------------------------------
+|   BLT_PixelScaler_ComputeTap
+|
+|   Maps the center of a destination sample onto the source.
++---------------------------------------------------------------------*/
+static void
+BLT_PixelScaler_ComputeTap(unsigned int        dst_index,
+                           unsigned int        dst_size,
+                           unsigned int        src_size,
+                           BLT_PixelScalerTap* tap)
+{
+    /* ((dst_index+0.5)*src_size/dst_size-0.5) in 8.8 fixed point */
+    ATX_Int64 position = ((ATX_Int64)(2*dst_index+1)*src_size-dst_size)*256/(2*(ATX_Int64)dst_size);
+
+    if (position < 0) position = 0;
+    tap->index  = (unsigned int)(position>>8);
+    tap->weight = (unsigned int)(position&0xFF);
+    if (tap->index >= src_size-1) {
+        tap->index  = src_size-1;
+        tap->weight = 0;
+    }
+    tap->next = tap->weight ? tap->index+1 : tap->index;
+}
+
+/*----------------------------------------------------------------------
+|   BLT_PixelScaler_Create
++---------------------------------------------------------------------*/
+BLT_Result
+BLT_PixelScaler_Create(unsigned int      src_width,
+                       unsigned int      src_height,
+                       unsigned int      dst_width,
+                       unsigned int      dst_height,
+                       BLT_PixelFormat   dst_format,
+                       BLT_PixelScaler** scaler)
+{
+    BLT_PixelScaler* self;
+    unsigned int     src_chroma_width = (src_width+1)/2;
+    unsigned int     dst_chroma_width = (dst_width+1)/2;
+    unsigned int     i;
+
+    *scaler = NULL;
+    if (src_width == 0 || src_height == 0 || dst_width == 0 || dst_height == 0) {
+        return BLT_ERROR_INVALID_PARAMETERS;
+    }
+    if (dst_format != BLT_PIXEL_FORMAT_RGBA && dst_format != BLT_PIXEL_FORMAT_BGRA) {
+        return BLT_ERROR_NOT_SUPPORTED;
+    }
+
+    self = (BLT_PixelScaler*)ATX_AllocateZeroMemory(sizeof(BLT_PixelScaler));
+    if (self == NULL) return BLT_ERROR_OUT_OF_MEMORY;
+    self->src_width   = src_width;
+    self->src_height  = src_height;
+    self->dst_width   = dst_width;
+    self->dst_height  = dst_height;
+    self->dst_format  = dst_format;
+    self->luma_taps   = (BLT_PixelScalerTap*)ATX_AllocateMemory(dst_width*sizeof(BLT_PixelScalerTap));
+    self->chroma_taps = (BLT_PixelScalerTap*)ATX_AllocateMemory(dst_chroma_width*sizeof(BLT_PixelScalerTap));
+    self->rows[0]     = (BLT_UInt8*)ATX_AllocateMemory(src_width);
+    self->rows[1]     = (BLT_UInt8*)ATX_AllocateMemory(src_chroma_width);
+    self->rows[2]     = (BLT_UInt8*)ATX_AllocateMemory(src_chroma_width);
+    self->rows[3]     = (BLT_UInt8*)ATX_AllocateMemory(dst_width);
+    self->rows[4]     = (BLT_UInt8*)ATX_AllocateMemory(dst_chroma_width);
+    self->rows[5]     = (BLT_UInt8*)ATX_AllocateMemory(dst_chroma_width);
+    if (self->luma_taps == NULL || self->chroma_taps == NULL) {
+        BLT_PixelScaler_Destroy(self);
+        return BLT_ERROR_OUT_OF_MEMORY;
+    }
+    for (i=0; i<6; i++) {
+        if (self->rows[i] == NULL) {
+            BLT_PixelScaler_Destroy(self);
+            return BLT_ERROR_OUT_OF_MEMORY;
+        }
+    }
+
+    for (i=0; i<dst_width; i++) {
+        BLT_PixelScaler_ComputeTap(i, dst_width, src_width, &self->luma_taps[i]);
+    }
+    for (i=0; i<dst_chroma_width; i++) {
+        BLT_PixelScaler_ComputeTap(i, dst_chroma_width, src_chroma_width, &self->chroma_taps[i]);
+    }
+
+    *scaler = self;
+    return BLT_SUCCESS;
+}
+
+/*----------------------------------------------------------------------
+|   BLT_PixelScaler_Destroy
++---------------------------------------------------------------------*/
+void
+BLT_PixelScaler_Destroy(BLT_PixelScaler* self)
+{
+    unsigned int i;
+
+    if (self == NULL) return;
+    for (i=0; i<6; i++) {
+        ATX_FreeMemory(self->rows[i]);
+    }
+    ATX_FreeMemory(self->luma_taps);
+    ATX_FreeMemory(self->chroma_taps);
+    ATX_FreeMemory(self);
+}
+
+/*----------------------------------------------------------------------
+|   BLT_PixelScaler_BlendRows
++---------------------------------------------------------------------*/
+static const BLT_UInt8*
+BLT_PixelScaler_BlendRows(const BLT_UInt8* plane,
+                          unsigned int     pitch,
+                          unsigned int     width,
+                          const BLT_PixelScalerTap* tap,
+                          BLT_UInt8*       out)
+{
+    const BLT_UInt8* first  = plane+tap->index*pitch;
+    const BLT_UInt8* second = plane+tap->next*pitch;
+    unsigned int     weight = tap->weight;
+    unsigned int     x;
+
+    if (weight == 0) return first;
+    x = 0;
+#if defined(BLT_PIXELS_SSE2)
+    {
+        const __m128i zero           = _mm_setzero_si128();
+        const __m128i rounding       = _mm_set1_epi16(128);
+        const __m128i first_weight   = _mm_set1_epi16((short)(256-weight));
+        const __m128i second_weight  = _mm_set1_epi16((short)weight);
+        for (; x+16 <= width; x += 16) {
+            __m128i a = _mm_loadu_si128((const __m128i*)(first+x));
+            __m128i b = _mm_loadu_si128((const __m128i*)(second+x));
+            __m128i low  = _mm_add_epi16(_mm_add_epi16(_mm_mullo_epi16(_mm_unpacklo_epi8(a, zero), first_weight),
+                                                       _mm_mullo_epi16(_mm_unpacklo_epi8(b, zero), second_weight)),
+                                         rounding);
+            __m128i high = _mm_add_epi16(_mm_add_epi16(_mm_mullo_epi16(_mm_unpackhi_epi8(a, zero), first_weight),
+                                                       _mm_mullo_epi16(_mm_unpackhi_epi8(b, zero), second_weight)),
+                                         rounding);
+            _mm_storeu_si128((__m128i*)(out+x), _mm_packus_epi16(_mm_srli_epi16(low, 8), _mm_srli_epi16(high, 8)));
+        }
+    }
+#elif defined(BLT_PIXELS_NEON)
+    {
+        const uint8x8_t first_weight  = vdup_n_u8((BLT_UInt8)(256-weight)); /* weight is never 0 here */
+        const uint8x8_t second_weight = vdup_n_u8((BLT_UInt8)weight);
+        for (; x+8 <= width; x += 8) {
+            uint16x8_t sum = vmlal_u8(vmull_u8(vld1_u8(first+x), first_weight), vld1_u8(second+x), second_weight);
+            vst1_u8(out+x, vrshrn_n_u16(sum, 8));
+        }
+    }
+#endif
+    for (; x<width; x++) {
+        out[x] = (BLT_UInt8)((first[x]*(256-weight)+second[x]*weight+128)>>8);
+    }
+
+    return out;
+}
+
+/*----------------------------------------------------------------------
+|   BLT_PixelScaler_ScaleRow
++---------------------------------------------------------------------*/
+static void
+BLT_PixelScaler_ScaleRow(const BLT_UInt8*          in,
+                         const BLT_PixelScalerTap* taps,
+                         unsigned int              width,
+                         BLT_UInt8*                out)
+{
+    unsigned int x;
+
+    for (x=0; x<width; x++) {
+        out[x] = (BLT_UInt8)((in[taps[x].index]*(256-taps[x].weight)+
+                              in[taps[x].next ]*taps[x].weight+128)>>8);
+    }
+}
+
+/*----------------------------------------------------------------------
+|   BLT_PixelScaler_Convert
++---------------------------------------------------------------------*/
+BLT_Result
+BLT_PixelScaler_Convert(BLT_PixelScaler*       self,
+                        const BLT_UInt8* const planes[3],
+                        const unsigned int     pitches[3],
+                        BLT_UInt8*             dst,
+                        unsigned int           dst_pitch)
+{
+    unsigned int src_chroma_width  = (self->src_width+1)/2;
+    unsigned int src_chroma_height = (self->src_height+1)/2;
+    unsigned int dst_chroma_width  = (self->dst_width+1)/2;
+    unsigned int row;
+
+    /* no scaling: straight from the planes */
+    if (self->src_width == self->dst_width && self->src_height == self->dst_height) {
+        for (row=0; row<self->dst_height; row++) {
+            BLT_Pixels_ConvertYuv420Row(planes[0]+row*pitches[0],
+                                        planes[1]+(row/2)*pitches[1],
+                                        planes[2]+(row/2)*pitches[2],
+                                        dst,
+                                        self->dst_width,
+                                        self->dst_format);
+            dst += dst_pitch;
+        }
+        return BLT_SUCCESS;
+    }
+
+    for (row=0; row<self->dst_height; row++) {
+        BLT_PixelScalerTap luma_tap;
+        BLT_PixelScalerTap chroma_tap;
+        const BLT_UInt8*   y;
+        const BLT_UInt8*   u;
+        const BLT_UInt8*   v;
+
+        /* vertically */
+        BLT_PixelScaler_ComputeTap(row, self->dst_height, self->src_height, &luma_tap);
+        BLT_PixelScaler_ComputeTap(row/2, (self->dst_height+1)/2, src_chroma_height, &chroma_tap);
+        y = BLT_PixelScaler_BlendRows(planes[0], pitches[0], self->src_width, &luma_tap,   self->rows[0]);
+        u = BLT_PixelScaler_BlendRows(planes[1], pitches[1], src_chroma_width, &chroma_tap, self->rows[1]);
+        v = BLT_PixelScaler_BlendRows(planes[2], pitches[2], src_chroma_width, &chroma_tap, self->rows[2]);
+
+        /* horizontally */
+        if (self->src_width != self->dst_width) {
+            BLT_PixelScaler_ScaleRow(y, self->luma_taps,   self->dst_width, self->rows[3]);
+            BLT_PixelScaler_ScaleRow(u, self->chroma_taps, dst_chroma_width, self->rows[4]);
+            BLT_PixelScaler_ScaleRow(v, self->chroma_taps, dst_chroma_width, self->rows[5]);
+            y = self->rows[3];
+            u = self->rows[4];
+            v = self->rows[5];
+        }
+
+        BLT_Pixels_ConvertYuv420Row(y, u, v, dst, self->dst_width, self->dst_format);
+        dst += dst_pitch;
+    }
+
+    return BLT_SUCCESS;
+}
@@ -29,7 +29,9 @@
 |   types
 +---------------------------------------------------------------------*/
 typedef enum {
-    BLT_PIXEL_FORMAT_YV12  /* Planar YUV 4:2:0 */
+    BLT_PIXEL_FORMAT_YV12, /* Planar YUV 4:2:0 */
+    BLT_PIXEL_FORMAT_RGBA, /* 32 bits per pixel, bytes in R,G,B,A order */
+    BLT_PIXEL_FORMAT_BGRA  /* 32 bits per pixel, bytes in B,G,R,A order */
 } BLT_PixelFormat;
 
 typedef struct {
@@ -44,6 +46,13 @@ typedef struct {
     }               planes[4];
 } BLT_RawVideoMediaType;
 
+/**
+ * Converts YUV 4:2:0 pictures to RGBA or BGRA, scaling them if needed.
+ * The buffers it needs are allocated once, when it is created, so it
+ * is meant to be kept for as long as the sizes don't change.
+ */
+typedef struct BLT_PixelScaler BLT_PixelScaler;
+
 /*----------------------------------------------------------------------
 |   constants
 +---------------------------------------------------------------------*/
@@ -58,6 +67,47 @@ extern "C" {
 extern void
 BLT_RawVideoMediaType_Init(BLT_RawVideoMediaType* media_type);
 
+/**
+ * Convert one row of YUV 4:2:0 pixels (ITU-R BT.601, limited range) to
+ * RGBA or BGRA, with alpha set to 255. Each u and v sample covers two
+ * pixels. Uses SSE2 or NEON when the build targets them.
+ */
+extern void
+BLT_Pixels_ConvertYuv420Row(const BLT_UInt8* y,
+                            const BLT_UInt8* u,
+                            const BLT_UInt8* v,
+                            BLT_UInt8*       dst,
+                            unsigned int     width,
+                            BLT_PixelFormat  format);
+
+/**
+ * Create a scaler from src_width x src_height YUV 4:2:0 pictures to
+ * dst_width x dst_height pictures in the given RGBA or BGRA format.
+ * Pictures are scaled with bilinear filtering.
+ */
+extern BLT_Result
+BLT_PixelScaler_Create(unsigned int      src_width,
+                       unsigned int      src_height,
+                       unsigned int      dst_width,
+                       unsigned int      dst_height,
+                       BLT_PixelFormat   dst_format,
+                       BLT_PixelScaler** scaler);
+
+extern void
+BLT_PixelScaler_Destroy(BLT_PixelScaler* scaler);
+
+/**
+ * Convert a picture.
+ * @param planes Y, U and V planes of the source picture.
+ * @param pitches Bytes per line of each source plane.
+ */
+extern BLT_Result
+BLT_PixelScaler_Convert(BLT_PixelScaler*       scaler,
+                        const BLT_UInt8* const planes[3],
+                        const unsigned int     pitches[3],
+                        BLT_UInt8*             dst,
+                        unsigned int           dst_pitch);
+
 #ifdef __cplusplus
 }
 #endif /* __cplusplus */
@@ -0,0 +1,44 @@
+/*****************************************************************
+|
+|   BlueTune - SIMD Support
+|
+|   (c) 2002-2012 Gilles Boccon-Gibod
+|   Author: Gilles Boccon-Gibod (bok@bok.net)
+|
+ ****************************************************************/
+/** @file
+ * Selection of the SIMD instruction set used by the sample processing
+ * loops.
+ *
+ * BLT_SIMD_SSE2 is defined when compiling for x86 with SSE2 (always the
+ * case on x86-64), and BLT_SIMD_NEON when compiling for ARM with NEON.
+ * The choice is made at compile time, from the target the compiler was
+ * asked to generate code for, like BltPixels.c does. Unlike the AES
+ * instructions (see BltAesCbc.h), which are detected at runtime, SSE2 is
+ * part of the x86-64 baseline and NEON of the ARMv8 one: a build for
+ * those targets can't run on a processor without them, so a runtime
+ * check would only add an indirect call per buffer. Every SIMD loop has
+ * a scalar version that produces the same results, which is also used
+ * for the remainder of buffers that are not a multiple of the vector
+ * size. Define BLT_CONFIG_DISABLE_SIMD to build the scalar versions only.
+ */
+
+#ifndef _BLT_SIMD_H_
+#define _BLT_SIMD_H_
+
+/*----------------------------------------------------------------------
+|   includes
++---------------------------------------------------------------------*/
+#include "BltConfig.h"
+
+#if !defined(BLT_CONFIG_DISABLE_SIMD)
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#define BLT_SIMD_SSE2
+#include <emmintrin.h>
+#elif defined(__ARM_NEON__) || defined(__ARM_NEON)
+#define BLT_SIMD_NEON
+#include <arm_neon.h>
+#endif
+#endif
+
+#endif /* _BLT_SIMD_H_ */
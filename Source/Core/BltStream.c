@@ -1467,6 +1467,20 @@ Stream_DeliverPacket(Stream*          self,
                     }
                 }
             }
+
+            /* when the playback rate is changed, the duration is that */
+            /* of the audio: scale it to media time                    */
+            {
+                ATX_PropertyValue rate;
+                if (ATX_SUCCEEDED(ATX_Properties_GetProperty(self->properties,
+                                                             BLT_STREAM_PROPERTY_MEDIA_RATE,
+                                                             &rate)) &&
+                    rate.type == ATX_PROPERTY_VALUE_TYPE_FLOAT &&
+                    rate.data.fp > 0.0f) {
+                    duration = BLT_TimeStamp_FromNanos(
+                        (ATX_UInt64)((double)BLT_TimeStamp_ToNanos(duration)*rate.data.fp));
+                }
+            }
             self->output.next_time_stamp = BLT_TimeStamp_Add(self->output.last_time_stamp, duration);
         }
         if (from_node->output.connected == BLT_FALSE) {
@@ -1896,7 +1910,8 @@ Stream_GetInfo(BLT_Stream* _self, BLT_StreamInfo* info)
 BLT_METHOD
 Stream_GetStatus(BLT_Stream* _self, BLT_StreamStatus* status)
 {
-    Stream* self = ATX_SELF(Stream, BLT_Stream);
+    Stream*           self = ATX_SELF(Stream, BLT_Stream);
+    ATX_PropertyValue latency;
 
     /* set the stream status */
     status->time_stamp = self->output.next_time_stamp;
@@ -1908,6 +1923,17 @@ Stream_GetStatus(BLT_Stream* _self, BLT_StreamStatus* status)
         status->position.offset = 0;
         status->position.range  = 0;
     }
+
+    /* the delay added by the media nodes */
+    if (ATX_SUCCEEDED(ATX_Properties_GetProperty(self->properties,
+                                                 BLT_STREAM_PROPERTY_LATENCY,
+                                                 &latency)) &&
+        latency.type == ATX_PROPERTY_VALUE_TYPE_INTEGER &&
+        latency.data.integer > 0) {
+        status->latency = BLT_TimeStamp_FromMillis(latency.data.integer);
+    } else {
+        BLT_TimeStamp_Set(status->latency, 0, 0);
+    }
     
     /* compute the output node status */
     BLT_TimeStamp_Set(status->output_status.media_time, 0, 0);
@@ -2138,6 +2164,32 @@ Stream_SeekToPosition(BLT_Stream* _self,
     return Stream_Seek(self, &mode, &point);
 }
 
+/*----------------------------------------------------------------------
+|    Stream_Flush
+|
+|    Seek all the nodes with BLT_SEEK_MODE_IGNORE, as when a parser has
+|    already moved the input: they drop what they hold, and the input
+|    stays where it is.
++---------------------------------------------------------------------*/
+BLT_METHOD
+Stream_Flush(BLT_Stream* _self, BLT_UInt64 time)
+{
+    Stream*       self = ATX_SELF(Stream, BLT_Stream);
+    BLT_SeekPoint point;
+    BLT_SeekMode  mode;
+
+    /* setup the flush request */
+    ATX_SetMemory(&point, 0, sizeof(point));
+    mode       = BLT_SEEK_MODE_IGNORE;
+    point.mask = BLT_SEEK_POINT_MASK_TIME_STAMP;
+    point.time_stamp.seconds     = (BLT_Int32)(time/1000);
+    point.time_stamp.nanoseconds = 
+        (BLT_Int32)
+        ((time-(point.time_stamp.seconds*1000))*1000000);
+
+    return Stream_Seek(self, &mode, &point);
+}
+
 /*----------------------------------------------------------------------
 |    Stream_OnEvent
 +---------------------------------------------------------------------*/
@@ -2192,7 +2244,8 @@ ATX_BEGIN_INTERFACE_MAP(Stream, BLT_Stream)
     Stream_GetProperties,
     Stream_EstimateSeekPoint,
     Stream_SeekToTime,
-    Stream_SeekToPosition
+    Stream_SeekToPosition,
+    Stream_Flush
 ATX_END_INTERFACE_MAP
 
 /*----------------------------------------------------------------------
@@ -71,6 +71,43 @@
 /* Common stream properties */
 #define BLT_STREAM_PROPERTY_METADATA_JSON "Metadata.Json"
 
+/**
+ * Stream property set by the media nodes that hold media back before
+ * passing it on, like the look-ahead of a limiter: the sum of the
+ * delays they add, in milliseconds (integer). Each node adds its own
+ * delay to the value it finds, and takes it out again when it stops
+ * holding media back. It is reported as the latency of the stream
+ * status.
+ */
+#define BLT_STREAM_PROPERTY_LATENCY "Stream.Latency"
+
+/**
+ * Stream property set by a media node that keeps the true peak level
+ * under full scale, like a limiter, for as long as it is active
+ * (integer, 1). While it is set, nodes that amplify the audio leave the
+ * part of their gain above unity to that node, through
+ * BLT_STREAM_PROPERTY_HANDOFF_GAIN, so that peaks are limited rather
+ * than clipped.
+ */
+#define BLT_STREAM_PROPERTY_GAIN_HANDOFF "Stream.GainHandoff"
+
+/**
+ * Stream property set by the media nodes that change the playback rate,
+ * like a time stretcher, while they do: the media time played per unit
+ * of playback time (floating point, 2.0 plays twice as fast). The
+ * packets of such nodes are time stamped in media time, but have the
+ * duration of the audio they carry, which the stream scales by this
+ * rate to keep its time stamp in media time.
+ */
+#define BLT_STREAM_PROPERTY_MEDIA_RATE "Stream.MediaRate"
+
+/**
+ * Stream property for the gain handed over to the node that announced
+ * BLT_STREAM_PROPERTY_GAIN_HANDOFF: a linear factor of 1.0 or more
+ * (floating point), applied on top of that node's own gain.
+ */
+#define BLT_STREAM_PROPERTY_HANDOFF_GAIN "Stream.HandoffGain"
+
 /*----------------------------------------------------------------------
 |   types
 +---------------------------------------------------------------------*/
@@ -148,6 +185,7 @@ typedef struct {
 typedef struct {
     BLT_StreamPosition   position;
     BLT_TimeStamp        time_stamp;
+    BLT_Time             latency;
     BLT_OutputNodeStatus output_status;
 } BLT_StreamStatus;
 
@@ -203,6 +241,7 @@ ATX_BEGIN_INTERFACE_DEFINITION(BLT_Stream)
     BLT_Result (*SeekToPosition)(BLT_Stream* self,
                                  BLT_UInt64  offset,
                                  BLT_UInt64  range);
+    BLT_Result (*Flush)(BLT_Stream* self, BLT_UInt64 time);
 ATX_END_INTERFACE_DEFINITION
 
 /*----------------------------------------------------------------------
@@ -283,4 +322,7 @@ ATX_INTERFACE(object)->SeekToTime(object, time)
 #define BLT_Stream_SeekToPosition(object, offset, range) \
 ATX_INTERFACE(object)->SeekToPosition(object, offset, range)
 
+#define BLT_Stream_Flush(object, time) \
+ATX_INTERFACE(object)->Flush(object, time)
+
 #endif /* _BLT_STREAM_H_ */
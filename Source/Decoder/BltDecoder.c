@@ -17,6 +17,7 @@
 #include "BltCorePriv.h"
 #include "BltDynamicPlugins.h"
 #include "BltVolumeControl.h"
+#include "BltOutputNode.h"
 
 /*----------------------------------------------------------------------
 |   logging
@@ -157,6 +158,7 @@ BLT_Decoder_UpdateStatus(BLT_Decoder* decoder)
     if (BLT_SUCCEEDED(result)) {
         decoder->status.time_stamp = status.time_stamp;
         decoder->status.position   = status.position;
+        decoder->status.latency    = status.latency;
     }
 
     return BLT_SUCCESS;
@@ -485,6 +487,62 @@ BLT_Decoder_PumpPacket(BLT_Decoder* decoder)
     return BLT_Decoder_PumpPacketWithOptions(decoder, 0);
 }
 
+/*----------------------------------------------------------------------
+|    BLT_Decoder_Probe
++---------------------------------------------------------------------*/
+BLT_Result
+BLT_Decoder_Probe(BLT_Decoder*    decoder,
+                  BLT_CString     name,
+                  BLT_CString     type,
+                  BLT_Flags       flags,
+                  BLT_StreamInfo* info)
+{
+    unsigned int packet_count;
+    BLT_Result   result;
+
+    /* check parameters */
+    if (name == NULL || name[0] == '\0' || info == NULL) {
+        return BLT_ERROR_INVALID_PARAMETERS;
+    }
+    ATX_SetMemory(info, 0, sizeof(*info));
+
+    /* use a null output as the sink. Without decoders, the output accepts */
+    /* any packet but expects a type that no node produces, so that only   */
+    /* the parsers needed to reach the first packet are interpolated       */
+    result = BLT_Decoder_SetOutput(decoder, 
+                                   "null", 
+                                   (flags & BLT_DECODER_PROBE_FLAG_ALLOW_DECODERS) ?
+                                   "audio/pcm" : BLT_OUTPUT_NODE_PROBE_MIME_TYPE);
+    if (BLT_FAILED(result)) return result;
+
+    /* open the input */
+    result = BLT_Decoder_SetInput(decoder, name, type);
+    if (BLT_FAILED(result)) return result;
+
+    /* pump until the first packet reaches the output, which means that */
+    /* all the parsers up to it have seen the start of the stream       */
+    for (packet_count = 0; packet_count < BLT_DECODER_PROBE_MAX_PACKETS; packet_count++) {
+        result = BLT_Stream_PumpPacket(decoder->stream);
+        if (BLT_FAILED(result)) break;
+        if (!(flags & BLT_DECODER_PROBE_FLAG_ALLOW_DECODERS)) break;
+
+        /* with decoders, wait until the duration is known */
+        BLT_Stream_GetInfo(decoder->stream, info);
+        if (info->mask & BLT_STREAM_INFO_MASK_DURATION) break;
+    }
+    if (result == BLT_ERROR_EOS) result = BLT_SUCCESS;
+    ATX_LOG_FINE_2("probed %d packets (%d)", packet_count, result);
+
+    /* return the info collected so far */
+    BLT_Stream_GetInfo(decoder->stream, info);
+    decoder->status.stream_info = *info;
+
+    /* let the nodes release their resources */
+    BLT_Stream_Stop(decoder->stream);
+
+    return result;
+}
+
 /*----------------------------------------------------------------------
 |    BLT_Decoder_Stop
 +---------------------------------------------------------------------*/
@@ -525,4 +583,13 @@ BLT_Decoder_SeekToPosition(BLT_Decoder* decoder,
     return BLT_Stream_SeekToPosition(decoder->stream, offset, range);
 }
 
+/*----------------------------------------------------------------------
+|    BLT_Decoder_Flush
++---------------------------------------------------------------------*/
+BLT_Result 
+BLT_Decoder_Flush(BLT_Decoder* decoder, BLT_UInt64 time)
+{
+    return BLT_Stream_Flush(decoder->stream, time);
+}
+
 
@@ -33,6 +33,11 @@
 
 #define BLT_DECODER_PUMP_OPTION_NON_BLOCKING 1
 
+#define BLT_DECODER_PROBE_FLAG_ALLOW_DECODERS 1
+
+/** Maximum number of packets pumped by BLT_Decoder_Probe */
+#define BLT_DECODER_PROBE_MAX_PACKETS 64
+
 /*----------------------------------------------------------------------
 |   types
 +---------------------------------------------------------------------*/
@@ -54,6 +59,7 @@ typedef struct {
     BLT_StreamInfo     stream_info; /**< Stream info       */
     BLT_StreamPosition position;    /**< Stream position   */
     BLT_TimeStamp      time_stamp;  /**< Timestamp         */
+    BLT_Time           latency;     /**< Delay added by the media nodes (see BLT_STREAM_PROPERTY_LATENCY) */
 } BLT_DecoderStatus;
 
 /**
@@ -281,6 +287,40 @@ BLT_Result BLT_Decoder_SeekToPosition(BLT_Decoder* decoder,
                                       BLT_UInt64   offset,
                                       BLT_UInt64   range);
 
+/**
+ * Discard the media held by the nodes and the output, without moving
+ * the input.
+ * @param time Time, in milliseconds, at which the media that comes
+ * next starts.
+ */
+BLT_Result BLT_Decoder_Flush(BLT_Decoder* decoder, BLT_UInt64 time);
+
+/**
+ * Probe an input to obtain its stream info and properties (tags) without
+ * decoding it. Only the input node and the parsers needed to get to the
+ * first media packet (tag parsers, container parsers, packetizers) are
+ * instantiated, unless the BLT_DECODER_PROBE_FLAG_ALLOW_DECODERS flag is
+ * set. The stream properties can be obtained with
+ * BLT_Decoder_GetStreamProperties until the input is changed.
+ * The decoder's output is replaced by a 'null' output, so the output must
+ * be set again before the decoder can be used for playback.
+ * @param name Name of the input.
+ * @param type Mime type of the input, or NULL.
+ * @param flags Combination of 0 or more BLT_DECODER_PROBE_FLAG_XXX flags.
+ * When BLT_DECODER_PROBE_FLAG_ALLOW_DECODERS is set, audio decoders are
+ * instantiated, and packets are pumped until the duration of the stream is
+ * known (or BLT_DECODER_PROBE_MAX_PACKETS packets have been pumped). This is
+ * needed for formats where the duration is only computed by the decoder, 
+ * such as MP3.
+ * @param info Pointer to a BLT_StreamInfo structure where the stream info
+ * will be returned.
+ */
+BLT_Result BLT_Decoder_Probe(BLT_Decoder*    decoder,
+                             BLT_CString     name,
+                             BLT_CString     type,
+                             BLT_Flags       flags,
+                             BLT_StreamInfo* info);
+
 /**
  * Set a BLT_Decoder object's event listener. The listener object's
  * notification functions will be called when certain events occur.
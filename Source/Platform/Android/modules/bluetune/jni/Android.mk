@@ -15,6 +15,7 @@ LOCAL_C_INCLUDES += $(BLT_SRC_ROOT)/Core
 LOCAL_C_INCLUDES += $(BLT_SRC_ROOT)/Player
 LOCAL_C_INCLUDES += $(BLT_SRC_ROOT)/Decoder
 LOCAL_C_INCLUDES += $(BLT_SRC_ROOT)/Plugins/Common
+LOCAL_C_INCLUDES += $(BLT_SRC_ROOT)/Plugins/Outputs/Callback
 LOCAL_C_INCLUDES += $(BLT_SRC_ROOT)/Plugins/DynamicLoading
 LOCAL_C_INCLUDES += $(BLT_ROOT)/../Neptune/Source/Core
 LOCAL_C_INCLUDES += $(BLT_ROOT)/../Atomix/Source/Core
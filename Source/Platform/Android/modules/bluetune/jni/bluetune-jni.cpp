@@ -17,6 +17,7 @@
 
 #include "bluetune-jni.h"
 #include "BlueTune.h"
+#include "BltCallbackOutput.h"
 
 #include <android/log.h>
 
@@ -575,6 +576,166 @@ JniInput_Create(JNIEnv* env, jobject delegate)
     return input;
 }
 
+/* This class MUST remain a plain-old-C data structured without methods */
+struct JniOutput {
+    /* interfaces */
+    ATX_IMPLEMENTS(BLT_PacketConsumer);
+    ATX_IMPLEMENTS(BLT_PacketBorrower);
+    ATX_IMPLEMENTS(ATX_Referenceable);
+        
+    /* members */
+    ATX_Cardinal m_ReferenceCounter;
+    JNIEnv*      m_JniEnv;
+    jobject      m_Delegate;
+    jmethodID    m_BorrowPacketMethod;
+};
+
+/*----------------------------------------------------------------------
+|   JniOutput_Destroy
++---------------------------------------------------------------------*/
+static void
+JniOutput_Destroy(JniOutput* self) 
+{
+    ATX_LOG_FINE("destroying output");
+    if (self->m_JniEnv) {
+        if (self->m_Delegate) {
+            self->m_JniEnv->DeleteGlobalRef(self->m_Delegate);
+        }
+    }
+    delete self;
+}
+
+/*----------------------------------------------------------------------
+|   JniOutput_CheckAttachment
++---------------------------------------------------------------------*/
+static void
+JniOutput_CheckAttachment(JniOutput* self)
+{
+    if (!self->m_JniEnv) {
+        ATX_LOG_FINE("attaching current thread");
+        jint result = JniJavaVM->AttachCurrentThread(&self->m_JniEnv, NULL);
+        if (result != JNI_OK) {
+            ATX_LOG_WARNING_1("AttachCurrentThread failed (%d)", result);
+        }
+    }
+}
+
+/*----------------------------------------------------------------------
+|   JniOutput_PutPacket
++---------------------------------------------------------------------*/
+BLT_METHOD
+JniOutput_PutPacket(BLT_PacketConsumer*, BLT_MediaPacket*)
+{
+    /* the packets are always lent */
+    return BLT_ERROR_NOT_SUPPORTED;
+}
+
+/*----------------------------------------------------------------------
+|   JniOutput_BorrowPacket
+|
+|   The samples are handed to Java in place, in a direct buffer that 
+|   wraps the payload, until Player.returnPacket is called.
++---------------------------------------------------------------------*/
+BLT_METHOD
+JniOutput_BorrowPacket(BLT_PacketBorrower* _self,
+                       BLT_MediaPacket*    packet,
+                       BLT_PacketLender*   lender)
+{
+    JniOutput* self = ATX_SELF(JniOutput, BLT_PacketBorrower);
+
+    JniOutput_CheckAttachment(self);
+    if (self->m_JniEnv == NULL || self->m_BorrowPacketMethod == NULL) return BLT_ERROR_INTERNAL;
+
+    const BLT_PcmMediaType* media_type = NULL;
+    BLT_MediaPacket_GetMediaType(packet, (const BLT_MediaType**)&media_type);
+    if (media_type->base.id != BLT_MEDIA_TYPE_ID_AUDIO_PCM) {
+        return BLT_ERROR_INVALID_MEDIA_TYPE;
+    }
+
+    jobject samples = self->m_JniEnv->NewDirectByteBuffer(BLT_MediaPacket_GetPayloadBuffer(packet),
+                                                          BLT_MediaPacket_GetPayloadSize(packet));
+    if (samples == NULL) return BLT_ERROR_OUT_OF_MEMORY;
+
+    jint result = self->m_JniEnv->CallIntMethod(self->m_Delegate, 
+                                                self->m_BorrowPacketMethod, 
+                                                samples,
+                                                (jint)media_type->sample_rate,
+                                                (jint)media_type->channel_count,
+                                                (jint)media_type->bits_per_sample,
+                                                (jlong)ATX_POINTER_TO_LONG(lender),
+                                                (jlong)ATX_POINTER_TO_LONG(packet));
+    self->m_JniEnv->DeleteLocalRef(samples);
+    if (self->m_JniEnv->ExceptionCheck()) {
+        /* not lent: nothing will return it */
+        self->m_JniEnv->ExceptionClear();
+        return BLT_FAILURE;
+    }
+    
+    return result == 0?BLT_SUCCESS:BLT_FAILURE;
+}
+
+/*----------------------------------------------------------------------
+|   JniOutput GetInterface
++---------------------------------------------------------------------*/
+ATX_BEGIN_GET_INTERFACE_IMPLEMENTATION(JniOutput)
+    ATX_GET_INTERFACE_ACCEPT(JniOutput, BLT_PacketConsumer)
+    ATX_GET_INTERFACE_ACCEPT(JniOutput, BLT_PacketBorrower)
+    ATX_GET_INTERFACE_ACCEPT(JniOutput, ATX_Referenceable)
+ATX_END_GET_INTERFACE_IMPLEMENTATION
+
+/*----------------------------------------------------------------------
+|   JniOutput BLT_PacketConsumer interface
++---------------------------------------------------------------------*/
+ATX_BEGIN_INTERFACE_MAP(JniOutput, BLT_PacketConsumer)
+    JniOutput_PutPacket
+};
+
+/*----------------------------------------------------------------------
+|   JniOutput BLT_PacketBorrower interface
++---------------------------------------------------------------------*/
+ATX_BEGIN_INTERFACE_MAP(JniOutput, BLT_PacketBorrower)
+    JniOutput_BorrowPacket
+};
+
+ATX_IMPLEMENT_REFERENCEABLE_INTERFACE(JniOutput, m_ReferenceCounter)
+
+/*----------------------------------------------------------------------
+|   JniOutput_Create
++---------------------------------------------------------------------*/
+static JniOutput*
+JniOutput_Create(JNIEnv* env, jobject delegate) 
+{
+    JniOutput* output = new JniOutput();
+    ATX_SetMemory(output, 0, sizeof(JniOutput));
+    
+    output->m_ReferenceCounter = 0;
+    output->m_JniEnv           = NULL;
+    output->m_Delegate         = env->NewGlobalRef(delegate);
+    
+    jclass output_interface = env->FindClass("com/bluetune/player/Output");
+    if (output_interface) {
+        output->m_BorrowPacketMethod = env->GetMethodID(output_interface, "borrowPacket", "(Ljava/nio/ByteBuffer;IIIJJ)I");
+        env->DeleteLocalRef(output_interface);
+    }
+    if (output->m_BorrowPacketMethod == NULL) {
+        /* FindClass or GetMethodID threw: don't return to Java with it pending */
+        env->ExceptionClear();
+        ATX_LOG_WARNING("com/bluetune/player/Output.borrowPacket not found");
+        if (output->m_Delegate) env->DeleteGlobalRef(output->m_Delegate);
+        delete output;
+        return NULL;
+    }
+    
+    /* setup the interfaces */
+    ATX_SET_INTERFACE(output, JniOutput, BLT_PacketConsumer);
+    ATX_SET_INTERFACE(output, JniOutput, BLT_PacketBorrower);
+    ATX_SET_INTERFACE(output, JniOutput, ATX_Referenceable);
+
+    ATX_LOG_FINE("output created");
+    
+    return output;
+}
+
 /*
  * Class:     com_bluetune_player_Player
  * Method:    _init
@@ -664,7 +825,7 @@ Java_com_bluetune_player_Player__1setInput__JLcom_bluetune_player_Input_2Ljava_l
  * Signature: (JLjava/lang/String;Ljava/lang/String;)I
  */
 JNIEXPORT jint JNICALL 
-Java_com_bluetune_player_Player__1setOutput(JNIEnv* env, jclass, jlong _self, jstring _output, jstring _mimeType)
+Java_com_bluetune_player_Player__1setOutput__JLjava_lang_String_2Ljava_lang_String_2(JNIEnv* env, jclass, jlong _self, jstring _output, jstring _mimeType)
 {
     JniPlayer* self = (JniPlayer*)_self;
 
@@ -683,6 +844,34 @@ Java_com_bluetune_player_Player__1setOutput(JNIEnv* env, jclass, jlong _self, js
     if (_mimeType && mimeType) env->ReleaseStringUTFChars(_mimeType, mimeType);
     return result;
 }
+
+/*
+ * Class:     com_bluetune_player_Player
+ * Method:    _setOutput
+ * Signature: (JLcom/bluetune/player/Output;Ljava/lang/String;)I
+ */
+JNIEXPORT jint JNICALL 
+Java_com_bluetune_player_Player__1setOutput__JLcom_bluetune_player_Output_2Ljava_lang_String_2(JNIEnv *env, jclass, jlong _self, jobject _output, jstring _mimeType)
+{
+    JniPlayer* self = (JniPlayer*)_self;
+
+    JniOutput* output = JniOutput_Create(env, _output);
+    if (output == NULL) return BLT_ERROR_INTERNAL;
+    
+    char output_name[64];
+    sprintf(output_name, "callback-output:%lld", ATX_POINTER_TO_LONG(&ATX_BASE(output, BLT_PacketConsumer)));
+    
+    const char* mimeType = NULL;
+    if (_mimeType){
+        mimeType = env->GetStringUTFChars(_mimeType, JNI_FALSE);
+    }
+
+    ATX_LOG_FINE_2("SetOutput %s, %s", output_name, mimeType?mimeType:"NULL");
+    BLT_Result result = self->SetOutput(output_name, mimeType);
+
+    if (_mimeType && mimeType) env->ReleaseStringUTFChars(_mimeType, mimeType);
+    return result;
+}
   
 /*
  * Class:     com_bluetune_player_Player
@@ -775,4 +964,17 @@ Java_com_bluetune_player_Player__1setVolume(JNIEnv *env, jclass, jlong _self, jf
     return self->SetVolume(volume);
 }
 
+/*
+ * Class:     com_bluetune_player_Player
+ * Method:    _returnPacket
+ * Signature: (JJ)I
+ */
+JNIEXPORT jint JNICALL 
+Java_com_bluetune_player_Player__1returnPacket(JNIEnv *, jclass, jlong _lender, jlong _packet)
+{
+    BLT_PacketLender* lender = (BLT_PacketLender*)_lender;
+    
+    return BLT_PacketLender_ReturnPacket(lender, (BLT_MediaPacket*)_packet);
+}
+
 
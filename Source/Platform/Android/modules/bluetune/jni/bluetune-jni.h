@@ -120,9 +120,17 @@ JNIEXPORT jint JNICALL Java_com_bluetune_player_Player__1setInput__JLcom_bluetun
  * Method:    _setOutput
  * Signature: (JLjava/lang/String;Ljava/lang/String;)I
  */
-JNIEXPORT jint JNICALL Java_com_bluetune_player_Player__1setOutput
+JNIEXPORT jint JNICALL Java_com_bluetune_player_Player__1setOutput__JLjava_lang_String_2Ljava_lang_String_2
   (JNIEnv *, jclass, jlong, jstring, jstring);
 
+/*
+ * Class:     com_bluetune_player_Player
+ * Method:    _setOutput
+ * Signature: (JLcom/bluetune/player/Output;Ljava/lang/String;)I
+ */
+JNIEXPORT jint JNICALL Java_com_bluetune_player_Player__1setOutput__JLcom_bluetune_player_Output_2Ljava_lang_String_2
+  (JNIEnv *, jclass, jlong, jobject, jstring);
+
 /*
  * Class:     com_bluetune_player_Player
  * Method:    _play
@@ -179,6 +187,14 @@ JNIEXPORT jint JNICALL Java_com_bluetune_player_Player__1seekToPosition
 JNIEXPORT jint JNICALL Java_com_bluetune_player_Player__1setVolume
   (JNIEnv *, jclass, jlong, jfloat);
 
+/*
+ * Class:     com_bluetune_player_Player
+ * Method:    _returnPacket
+ * Signature: (JJ)I
+ */
+JNIEXPORT jint JNICALL Java_com_bluetune_player_Player__1returnPacket
+  (JNIEnv *, jclass, jlong, jlong);
+
 #ifdef __cplusplus
 }
 #endif
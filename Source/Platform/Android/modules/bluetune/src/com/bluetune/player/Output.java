@@ -0,0 +1,18 @@
+package com.bluetune.player;
+
+import java.nio.ByteBuffer;
+
+/**
+ * An output that borrows the decoded PCM packets instead of copying them.
+ * borrowPacket is called on the decoder thread with a buffer that wraps
+ * the packet's samples (native byte order). The buffer stays valid until
+ * the packet is handed back, from any thread, with
+ * Player.returnPacket(lender, packet). When borrowPacket returns
+ * FAILURE, the packet isn't lent and must not be returned.
+ */
+public interface Output {
+	public static final int SUCCESS = 0;
+	public static final int FAILURE = -1;
+
+	public int borrowPacket(ByteBuffer samples, int sampleRate, int channelCount, int bitsPerSample, long lender, long packet);
+}
@@ -212,6 +212,18 @@ public class Player {
 		setOutput(output, null);
 	}
 
+	public void setOutput(Output output, String mimeType) {
+		_setOutput(cSelf, output, mimeType);
+	}
+
+	public void setOutput(Output output) {
+		setOutput(output, null);
+	}
+
+	public static int returnPacket(long lender, long packet) {
+		return _returnPacket(lender, packet);
+	}
+
 	public void play() {
 		_play(cSelf);
 	}
@@ -246,6 +258,7 @@ public class Player {
 	private static native int _setInput(long self, String input, String mimeType);
 	private static native int _setInput(long self, Input input, String mimeType);
 	private static native int _setOutput(long self, String output, String mimeType);
+	private static native int _setOutput(long self, Output output, String mimeType);
 	private static native int _play(long self);
 	private static native int _stop(long self);
 	private static native int _pause(long self);
@@ -253,6 +266,7 @@ public class Player {
 	private static native int _seekToTimeStamp(long self, int h, int m, int s, int f);
 	private static native int _seekToPosition(long self, long offset, long range);
 	private static native int _setVolume(long self, float volume);
+	private static native int _returnPacket(long lender, long packet);
 	private final long     cSelf;
 	private MessageHandler messageHandler;
 	private MessageLoop    messageLoop;
@@ -20,6 +20,7 @@
 #include "BltDecoder.h"
 #include "BltDecoderServer.h"
 #include "BltDecoderClient.h"
+#include "BltCrossFade.h"
 
 /*----------------------------------------------------------------------
 |   logging
@@ -30,6 +31,7 @@ ATX_SET_LOCAL_LOGGER("bluetune.player.decoder-server")
 |   constants
 +---------------------------------------------------------------------*/
 const unsigned int BLT_PLAYER_LOOP_WAIT_DURATION = 50; // milliseconds
+const unsigned int BLT_PLAYER_TRACK_SOURCE_PRE_ROLL = 8; // packets
 
 /*----------------------------------------------------------------------
 |   BLT_DecoderServer_Message::MessageType
@@ -59,6 +61,16 @@ BLT_DecoderServer_PropertyListenerWrapper_OnPropertyChanged(
     ATX_CString              name,
     const ATX_PropertyValue* value);
 
+BLT_METHOD
+BLT_DecoderServer_TrackSource_GetPacket(
+    BLT_PacketProducer* self,
+    BLT_MediaPacket**   packet);
+
+BLT_METHOD
+BLT_DecoderServer_TrackSource_PutPacket(
+    BLT_PacketConsumer* self,
+    BLT_MediaPacket*    packet);
+
 /*----------------------------------------------------------------------
 |    BLT_EventListener interface
 +---------------------------------------------------------------------*/
@@ -81,6 +93,22 @@ ATX_BEGIN_INTERFACE_MAP(BLT_DecoderServer_PropertyListenerWrapper, ATX_PropertyL
     BLT_DecoderServer_PropertyListenerWrapper_OnPropertyChanged
 ATX_END_INTERFACE_MAP
 
+/*----------------------------------------------------------------------
+|    BLT_PacketProducer and BLT_PacketConsumer interfaces
++---------------------------------------------------------------------*/
+ATX_BEGIN_GET_INTERFACE_IMPLEMENTATION(BLT_DecoderServer_TrackSource)
+    ATX_GET_INTERFACE_ACCEPT(BLT_DecoderServer_TrackSource, BLT_PacketProducer)
+    ATX_GET_INTERFACE_ACCEPT(BLT_DecoderServer_TrackSource, BLT_PacketConsumer)
+ATX_END_GET_INTERFACE_IMPLEMENTATION
+
+ATX_BEGIN_INTERFACE_MAP(BLT_DecoderServer_TrackSource, BLT_PacketProducer)
+    BLT_DecoderServer_TrackSource_GetPacket
+ATX_END_INTERFACE_MAP
+
+ATX_BEGIN_INTERFACE_MAP(BLT_DecoderServer_TrackSource, BLT_PacketConsumer)
+    BLT_DecoderServer_TrackSource_PutPacket
+ATX_END_INTERFACE_MAP
+
 /*----------------------------------------------------------------------
 |   BLT_DecoderServer_Message::Dispatch
 +---------------------------------------------------------------------*/
@@ -104,7 +132,9 @@ BLT_DecoderServer::BLT_DecoderServer(NPT_MessageReceiver* client) :
     m_Client(client),
     m_TimeStampUpdateQuantum(1000),
     m_PositionUpdateRange(BLT_DECODER_SERVER_DEFAULT_POSITION_UPDATE_RANGE),
-    m_State(STATE_STOPPED)
+    m_State(STATE_STOPPED),
+    m_NextTrackSource(0),
+    m_CrossFaderAdded(false)
 {
     // create a queue to receive messages
     m_MessageQueue = new NPT_SimpleMessageQueue();
@@ -140,6 +170,21 @@ BLT_DecoderServer::BLT_DecoderServer(NPT_MessageReceiver* client) :
     ATX_SET_INTERFACE(&m_StreamPropertyListener, 
                       BLT_DecoderServer_PropertyListenerWrapper, 
                       ATX_PropertyListener);
+
+    // setup the sources for the next tracks
+    for (unsigned int i=0; i<2; i++) {
+        m_TrackSources[i].decoder      = NULL;
+        m_TrackSources[i].first        = 0;
+        m_TrackSources[i].packet_count = 0;
+        m_TrackSources[i].result       = BLT_SUCCESS;
+        m_TrackSources[i].started      = false;
+        ATX_SET_INTERFACE(&m_TrackSources[i], 
+                          BLT_DecoderServer_TrackSource, 
+                          BLT_PacketProducer);
+        ATX_SET_INTERFACE(&m_TrackSources[i], 
+                          BLT_DecoderServer_TrackSource, 
+                          BLT_PacketConsumer);
+    }
 }
 
 /*----------------------------------------------------------------------
@@ -270,9 +315,14 @@ BLT_DecoderServer::Run()
             result = BLT_Decoder_PumpPacketWithOptions(m_Decoder, BLT_DECODER_PUMP_OPTION_NON_BLOCKING);
             if (BLT_FAILED(result)) {
                 if (result == BLT_ERROR_WOULD_BLOCK || result == BLT_ERROR_PORT_HAS_NO_DATA) {
-                    /* not fatal, just wait and try again later */
-                    ATX_LOG_FINER("pump would block, waiting a short time");
-                    result = m_MessageQueue->PumpMessage(BLT_PLAYER_LOOP_WAIT_DURATION);
+                    /* not fatal, just wait and try again later, unless */
+                    /* the next track has made some progress meanwhile   */
+                    if (PreRollTrackSources()) {
+                        result = BLT_SUCCESS;
+                    } else {
+                        ATX_LOG_FINER("pump would block, waiting a short time");
+                        result = m_MessageQueue->PumpMessage(BLT_PLAYER_LOOP_WAIT_DURATION);
+                    }
                 } else {
                     ATX_LOG_FINE_1("stopped on %d", result);
                     if (result != BLT_ERROR_EOS) {
@@ -285,7 +335,9 @@ BLT_DecoderServer::Run()
                     result = BLT_SUCCESS;
                 }
             } else {
+                CheckTrackTransition();
                 UpdateStatus();
+                PreRollTrackSources();
             }
         } else {
             ATX_LOG_FINE("waiting for message");
@@ -299,6 +351,10 @@ BLT_DecoderServer::Run()
     // unregister as an event listener
     BLT_Decoder_SetEventListener(m_Decoder, NULL);
 
+    // the next tracks go before the decoder that pulls from them
+    ReleaseTrackSource(m_TrackSources[0]);
+    ReleaseTrackSource(m_TrackSources[1]);
+
     // destroy the decoder
     if (m_Decoder != NULL) {
         BLT_Decoder_Destroy(m_Decoder);
@@ -373,8 +429,8 @@ BLT_DecoderServer::UpdateStatus()
     BLT_DecoderStatus status;
     BLT_Result        result;
 
-    // get the decoder status
-    result = BLT_Decoder_GetStatus(m_Decoder, &status);
+    // get the decoder status, from the track that is heard
+    result = BLT_Decoder_GetStatus(GetFeedDecoder(), &status);
     if (BLT_FAILED(result)) return result;
 
     // notify if the time has changed by more than the update threshold
@@ -450,6 +506,9 @@ BLT_DecoderServer::OnSetInputCommand(BLT_CString name, BLT_CString type)
 
     ATX_LOG_FINE_2("set input (%s / %s)",
                    BLT_SAFE_STRING(name), BLT_SAFE_STRING(type));
+
+    // the next tracks were to follow the previous input
+    CancelNextTracks();
     result = BLT_Decoder_SetInput(m_Decoder, name, type);
 
     // update the state if we were in the STATE_EOS state
@@ -459,6 +518,213 @@ BLT_DecoderServer::OnSetInputCommand(BLT_CString name, BLT_CString type)
     SendReply(BLT_DecoderServer_Message::COMMAND_ID_SET_INPUT, result);
 }
 
+/*----------------------------------------------------------------------
+|    BLT_DecoderServer::SetNextInput
++---------------------------------------------------------------------*/
+BLT_Result 
+BLT_DecoderServer::SetNextInput(BLT_CString name, BLT_CString type)
+{
+    ATX_LOG_FINER("set-next-input");
+    return PostMessage(
+        new BLT_DecoderServer_SetNextInputCommandMessage(name, type));
+}
+
+/*----------------------------------------------------------------------
+|    BLT_DecoderServer::OnSetNextInputCommand
++---------------------------------------------------------------------*/
+void
+BLT_DecoderServer::OnSetNextInputCommand(BLT_CString name, BLT_CString type)
+{
+    BLT_DecoderServer_TrackSource& next = m_TrackSources[m_NextTrackSource];
+    BLT_Result                     result = BLT_SUCCESS;
+
+    ATX_LOG_FINE_2("set next input (%s / %s)",
+                   BLT_SAFE_STRING(name), BLT_SAFE_STRING(type));
+
+    // replace the next track, if there was one
+    SetNextSource(NULL);
+    ReleaseTrackSource(next);
+    if (name == NULL || name[0] == '\0') {
+        SendReply(BLT_DecoderServer_Message::COMMAND_ID_SET_NEXT_INPUT, BLT_SUCCESS);
+        return;
+    }
+
+    // the cross fader switches from one track to the next
+    if (!m_CrossFaderAdded) {
+        result = BLT_Decoder_AddNodeByName(m_Decoder, NULL, BLT_CROSS_FADER_MODULE_NAME);
+        if (BLT_SUCCEEDED(result)) m_CrossFaderAdded = true;
+    }
+
+    // decode the next track with the same modules as this one
+    if (BLT_SUCCEEDED(result)) {
+        result = BLT_Decoder_Create(&next.decoder);
+    }
+    if (BLT_SUCCEEDED(result)) {
+        ATX_List* modules = NULL;
+        result = BLT_Decoder_EnumerateModules(m_Decoder, &modules);
+        if (BLT_SUCCEEDED(result)) {
+            for (ATX_ListItem* item = ATX_List_GetFirstItem(modules);
+                 item && BLT_SUCCEEDED(result);
+                 item = ATX_ListItem_GetNext(item)) {
+                result = BLT_Decoder_RegisterModule(next.decoder, 
+                                                    (BLT_Module*)ATX_ListItem_GetData(item));
+            }
+            ATX_List_Destroy(modules);
+        }
+    }
+
+    // its output is a callback output that delivers the packets to us
+    if (BLT_SUCCEEDED(result)) {
+        NPT_String output_name = "callback-output:";
+        output_name += NPT_String::FromIntegerU((NPT_UInt64)(size_t)&ATX_BASE(&next, BLT_PacketConsumer));
+        result = BLT_Decoder_SetOutput(next.decoder, output_name, "audio/pcm");
+    }
+    if (BLT_SUCCEEDED(result)) {
+        result = BLT_Decoder_SetInput(next.decoder, name, type);
+    }
+
+    // let the cross fader know
+    if (BLT_SUCCEEDED(result)) {
+        result = SetNextSource(&ATX_BASE(&next, BLT_PacketProducer));
+    }
+    if (BLT_FAILED(result)) ReleaseTrackSource(next);
+
+    SendReply(BLT_DecoderServer_Message::COMMAND_ID_SET_NEXT_INPUT, result);
+}
+
+/*----------------------------------------------------------------------
+|    BLT_DecoderServer::SetNextSource
++---------------------------------------------------------------------*/
+BLT_Result
+BLT_DecoderServer::SetNextSource(BLT_PacketProducer* source)
+{
+    ATX_Properties*   properties = NULL;
+    ATX_PropertyValue value;
+    BLT_Result        result;
+
+    result = BLT_Decoder_GetProperties(m_Decoder, &properties);
+    if (BLT_FAILED(result)) return result;
+
+    // a NULL pointer means that there is no next track
+    value.type         = ATX_PROPERTY_VALUE_TYPE_POINTER;
+    value.data.pointer = source;
+    return ATX_Properties_SetProperty(properties, BLT_CROSS_FADER_NEXT_SOURCE, &value);
+}
+
+/*----------------------------------------------------------------------
+|    BLT_DecoderServer::ReleaseTrackSource
++---------------------------------------------------------------------*/
+void
+BLT_DecoderServer::ReleaseTrackSource(BLT_DecoderServer_TrackSource& source)
+{
+    FlushTrackSource(source);
+    if (source.decoder) {
+        BLT_Decoder_Destroy(source.decoder);
+        source.decoder = NULL;
+    }
+    source.started = false;
+}
+
+/*----------------------------------------------------------------------
+|    BLT_DecoderServer::FlushTrackSource
++---------------------------------------------------------------------*/
+void
+BLT_DecoderServer::FlushTrackSource(BLT_DecoderServer_TrackSource& source)
+{
+    for (; source.packet_count; source.packet_count--) {
+        BLT_MediaPacket_Release(source.packets[source.first]);
+        source.first = (source.first+1)%BLT_DECODER_SERVER_TRACK_SOURCE_QUEUE_SIZE;
+    }
+    source.first  = 0;
+    source.result = BLT_SUCCESS;
+}
+
+/*----------------------------------------------------------------------
+|    BLT_DecoderServer::PreRollTrackSources
+|
+|    Pump the decoders of the next tracks once each, unless they have
+|    enough packets queued. Returns true if one of them made progress.
++---------------------------------------------------------------------*/
+bool
+BLT_DecoderServer::PreRollTrackSources()
+{
+    bool progress = false;
+
+    for (unsigned int i=0; i<2; i++) {
+        BLT_DecoderServer_TrackSource& source = m_TrackSources[i];
+        if (source.decoder == NULL || BLT_FAILED(source.result)) continue;
+        if (source.packet_count >= BLT_PLAYER_TRACK_SOURCE_PRE_ROLL) continue;
+
+        BLT_Result result = BLT_Decoder_PumpPacketWithOptions(source.decoder, BLT_DECODER_PUMP_OPTION_NON_BLOCKING);
+        if (BLT_SUCCEEDED(result)) {
+            progress = true;
+        } else if (result != BLT_ERROR_WOULD_BLOCK && result != BLT_ERROR_PORT_HAS_NO_DATA) {
+            // the cross fader gets the end of stream, or the error, once
+            // it has pulled all the packets
+            source.result = result;
+        }
+    }
+
+    return progress;
+}
+
+/*----------------------------------------------------------------------
+|    BLT_DecoderServer::CancelNextTracks
++---------------------------------------------------------------------*/
+void
+BLT_DecoderServer::CancelNextTracks()
+{
+    ATX_Properties* properties = NULL;
+
+    // removing the property makes the cross fader drop both tracks
+    if (BLT_SUCCEEDED(BLT_Decoder_GetProperties(m_Decoder, &properties))) {
+        ATX_Properties_SetProperty(properties, BLT_CROSS_FADER_NEXT_SOURCE, NULL);
+    }
+    ReleaseTrackSource(m_TrackSources[0]);
+    ReleaseTrackSource(m_TrackSources[1]);
+}
+
+/*----------------------------------------------------------------------
+|    BLT_DecoderServer::GetFeedDecoder
++---------------------------------------------------------------------*/
+BLT_Decoder*
+BLT_DecoderServer::GetFeedDecoder()
+{
+    // once the cross fader pulls from the next track, the main
+    // decoder has reached the end of its input
+    BLT_DecoderServer_TrackSource& feed = m_TrackSources[1-m_NextTrackSource];
+    return feed.decoder?feed.decoder:m_Decoder;
+}
+
+/*----------------------------------------------------------------------
+|    BLT_DecoderServer::CheckTrackTransition
++---------------------------------------------------------------------*/
+void
+BLT_DecoderServer::CheckTrackTransition()
+{
+    BLT_DecoderServer_TrackSource& next = m_TrackSources[m_NextTrackSource];
+    BLT_DecoderStatus              status;
+
+    if (next.decoder == NULL || !next.started) return;
+    ATX_LOG_FINE("next track started");
+
+    // the previous track is no longer needed
+    ReleaseTrackSource(m_TrackSources[1-m_NextTrackSource]);
+    m_NextTrackSource = 1-m_NextTrackSource;
+    SetNextSource(NULL);
+
+    // the client now hears about the new track
+    BLT_Decoder_SetEventListener(next.decoder, 
+                                 &ATX_BASE(&m_EventListener, 
+                                           BLT_EventListener));
+    if (BLT_SUCCEEDED(BLT_Decoder_GetStatus(next.decoder, &status))) {
+        m_Client->PostMessage(
+            new BLT_DecoderClient_StreamInfoNotificationMessage(
+                BLT_STREAM_INFO_MASK_ALL,
+                status.stream_info));
+    }
+}
+
 /*----------------------------------------------------------------------
 |    BLT_DecoderServer::SetOutput
 +---------------------------------------------------------------------*/
@@ -593,7 +859,16 @@ BLT_DecoderServer::OnSeekToTimeCommand(BLT_UInt64 time)
 {
     BLT_Result result;
     ATX_LOG_FINE_1("[%d]", (int)time);
-    result = BLT_Decoder_SeekToTime(m_Decoder, time);
+    if (GetFeedDecoder() != m_Decoder) {
+        // seek in the track that is heard, and flush what the main
+        // decoder holds without taking it back from the end
+        BLT_DecoderServer_TrackSource& feed = m_TrackSources[1-m_NextTrackSource];
+        FlushTrackSource(feed);
+        result = BLT_Decoder_SeekToTime(feed.decoder, time);
+        if (BLT_SUCCEEDED(result)) result = BLT_Decoder_Flush(m_Decoder, time);
+    } else {
+        result = BLT_Decoder_SeekToTime(m_Decoder, time);
+    }
     if (BLT_SUCCEEDED(result)) {
         UpdateStatus();
 
@@ -622,7 +897,21 @@ BLT_DecoderServer::OnSeekToPositionCommand(BLT_UInt64 offset, BLT_UInt64 range)
 {
     BLT_Result result;
     ATX_LOG_FINE_2("[%d:%d]", (int)offset, (int)range);
-    result = BLT_Decoder_SeekToPosition(m_Decoder, offset, range);
+    if (GetFeedDecoder() != m_Decoder) {
+        // same as when seeking to a time
+        BLT_DecoderServer_TrackSource& feed = m_TrackSources[1-m_NextTrackSource];
+        FlushTrackSource(feed);
+        result = BLT_Decoder_SeekToPosition(feed.decoder, offset, range);
+        if (BLT_SUCCEEDED(result)) {
+            BLT_DecoderStatus status;
+            result = BLT_Decoder_GetStatus(feed.decoder, &status);
+            if (BLT_SUCCEEDED(result)) {
+                result = BLT_Decoder_Flush(m_Decoder, BLT_TimeStamp_ToMillis(status.time_stamp));
+            }
+        }
+    } else {
+        result = BLT_Decoder_SeekToPosition(m_Decoder, offset, range);
+    }
     if (BLT_SUCCEEDED(result)) {
         UpdateStatus();
 
@@ -675,6 +964,9 @@ BLT_DecoderServer::OnAddNodeCommand(BLT_CString name)
     BLT_Result result;
     ATX_LOG_FINE_1("node name = %s", name);
     result = BLT_Decoder_AddNodeByName(m_Decoder, NULL, name);
+    if (BLT_SUCCEEDED(result) && ATX_StringsEqual(name, BLT_CROSS_FADER_MODULE_NAME)) {
+        m_CrossFaderAdded = true;
+    }
     SendReply(BLT_DecoderServer_Message::COMMAND_ID_ADD_NODE, result);
 }
 
@@ -861,6 +1153,53 @@ BLT_DecoderServer_PropertyListenerWrapper_OnPropertyChanged(
     self->outer->OnPropertyChanged(self->scope, self->source, name, value);
 }
 
+/*----------------------------------------------------------------------
+|    BLT_DecoderServer_TrackSource_GetPacket
++---------------------------------------------------------------------*/
+BLT_METHOD
+BLT_DecoderServer_TrackSource_GetPacket(
+    BLT_PacketProducer* _self,
+    BLT_MediaPacket**   packet)
+{
+    BLT_DecoderServer_TrackSource* self = ATX_SELF(BLT_DecoderServer_TrackSource, BLT_PacketProducer);
+
+    *packet = NULL;
+    if (self->decoder == NULL) return BLT_ERROR_EOS;
+    self->started = true;
+
+    // the decoder is pumped by the server, not here: when the queue is
+    // empty, the cross fader retries on the next pump of the main decoder
+    if (self->packet_count == 0) {
+        return BLT_FAILED(self->result)?self->result:BLT_ERROR_WOULD_BLOCK;
+    }
+    *packet = self->packets[self->first];
+    self->first = (self->first+1)%BLT_DECODER_SERVER_TRACK_SOURCE_QUEUE_SIZE;
+    self->packet_count--;
+
+    return BLT_SUCCESS;
+}
+
+/*----------------------------------------------------------------------
+|    BLT_DecoderServer_TrackSource_PutPacket
++---------------------------------------------------------------------*/
+BLT_METHOD
+BLT_DecoderServer_TrackSource_PutPacket(
+    BLT_PacketConsumer* _self,
+    BLT_MediaPacket*    packet)
+{
+    BLT_DecoderServer_TrackSource* self = ATX_SELF(BLT_DecoderServer_TrackSource, BLT_PacketConsumer);
+
+    // the server stops pumping well before the queue is full
+    if (self->packet_count == BLT_DECODER_SERVER_TRACK_SOURCE_QUEUE_SIZE) {
+        return BLT_ERROR_OUT_OF_RESOURCES;
+    }
+    self->packets[(self->first+self->packet_count)%BLT_DECODER_SERVER_TRACK_SOURCE_QUEUE_SIZE] = packet;
+    self->packet_count++;
+    BLT_MediaPacket_AddReference(packet);
+
+    return BLT_SUCCESS;
+}
+
 /*----------------------------------------------------------------------
 |   BLT_DecoderServer_PropertyValueWrapper::BLT_DecoderServer_PropertyValueWrapper
 +---------------------------------------------------------------------*/
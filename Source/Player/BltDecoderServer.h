@@ -15,11 +15,14 @@
 +---------------------------------------------------------------------*/
 #include "Neptune.h"
 #include "BltDecoder.h"
+#include "BltPacketProducer.h"
+#include "BltPacketConsumer.h"
 
 /*----------------------------------------------------------------------
 |   constants
 +---------------------------------------------------------------------*/
 const BLT_Size BLT_DECODER_SERVER_DEFAULT_POSITION_UPDATE_RANGE = 400;
+const unsigned int BLT_DECODER_SERVER_TRACK_SOURCE_QUEUE_SIZE = 16;
 
 /*----------------------------------------------------------------------
 |   BLT_DecoderServer_PropertyValueWrapper
@@ -44,6 +47,7 @@ public:
     virtual ~BLT_DecoderServer_MessageHandler() {}
 
     virtual void OnSetInputCommand(BLT_CString name, BLT_CString type) = 0;
+    virtual void OnSetNextInputCommand(BLT_CString name, BLT_CString type) = 0;
     virtual void OnSetOutputCommand(BLT_CString name, BLT_CString type) = 0;
     virtual void OnSetVolumeCommand(float volume) = 0;
     virtual void OnPlayCommand() = 0;
@@ -83,7 +87,8 @@ public:
         COMMAND_ID_ADD_NODE,
         COMMAND_ID_SET_PROPERTY,
         COMMAND_ID_LOAD_PLUGIN,
-        COMMAND_ID_LOAD_PLUGINS
+        COMMAND_ID_LOAD_PLUGINS,
+        COMMAND_ID_SET_NEXT_INPUT
     } CommandId;
 
     // functions
@@ -126,6 +131,29 @@ private:
     BLT_StringObject m_Type;
 };
 
+/*----------------------------------------------------------------------
+|   BLT_DecoderServer_SetNextInputCommandMessage
++---------------------------------------------------------------------*/
+class BLT_DecoderServer_SetNextInputCommandMessage :
+    public BLT_DecoderServer_Message
+{
+public:
+    // methods
+    BLT_DecoderServer_SetNextInputCommandMessage(BLT_CString name, 
+                                                 BLT_CString type) :
+        BLT_DecoderServer_Message(COMMAND_ID_SET_NEXT_INPUT),
+        m_Name(BLT_SAFE_STRING(name)), m_Type(BLT_SAFE_STRING(type)) {}
+    NPT_Result Deliver(BLT_DecoderServer_MessageHandler* handler) {
+        handler->OnSetNextInputCommand(m_Name.GetChars(), m_Type.GetChars());
+        return NPT_SUCCESS;
+    }
+
+private:
+    // members
+    BLT_StringObject m_Name;
+    BLT_StringObject m_Type;
+};
+
 /*----------------------------------------------------------------------
 |   BLT_DecoderServer_SetOutputCommandMessage
 +---------------------------------------------------------------------*/
@@ -413,6 +441,28 @@ typedef struct {
     BLT_DecoderServer* outer;
 } BLT_DecoderServer_PropertyListenerWrapper;
 
+/*----------------------------------------------------------------------
+|   BLT_DecoderServer_TrackSource
++---------------------------------------------------------------------*/
+// A decoder for the track that follows the one being played. Its output
+// is a callback output that queues the packets, and the cross fader of
+// the main decoder pulls them from the queue. The server pumps the
+// decoder between the pumps of the main decoder, to keep a few packets
+// ahead, so the cross fader never waits for it to decode.
+typedef struct {
+    // ATX-style interfaces
+    ATX_IMPLEMENTS(BLT_PacketProducer);
+    ATX_IMPLEMENTS(BLT_PacketConsumer);
+
+    // members
+    BLT_Decoder*     decoder;
+    BLT_MediaPacket* packets[BLT_DECODER_SERVER_TRACK_SOURCE_QUEUE_SIZE]; // received from the decoder's output
+    unsigned int     first;         // index of the oldest packet
+    unsigned int     packet_count;
+    BLT_Result       result;        // why the decoder stopped, if it did
+    bool             started;       // the cross fader has pulled from it
+} BLT_DecoderServer_TrackSource;
+
 /*----------------------------------------------------------------------
 |   BLT_DecoderServer
 +---------------------------------------------------------------------*/
@@ -468,6 +518,7 @@ class BLT_DecoderServer : public NPT_Thread,
     BLT_DecoderServer(NPT_MessageReceiver* client);
     virtual ~BLT_DecoderServer();
     virtual BLT_Result SetInput(BLT_CString name, BLT_CString type = NULL);
+    virtual BLT_Result SetNextInput(BLT_CString name, BLT_CString type = NULL);
     virtual BLT_Result SetOutput(BLT_CString name, BLT_CString type = NULL);
     virtual BLT_Result SetVolume(float volume);
     virtual BLT_Result Play();
@@ -491,6 +542,7 @@ class BLT_DecoderServer : public NPT_Thread,
 
     // BLT_DecoderServer_MessageHandler methods
     virtual void OnSetInputCommand(BLT_CString name, BLT_CString type);
+    virtual void OnSetNextInputCommand(BLT_CString name, BLT_CString type);
     virtual void OnSetOutputCommand(BLT_CString name, BLT_CString type);
     virtual void OnSetVolumeCommand(float volume);
     virtual void OnPlayCommand();
@@ -528,6 +580,13 @@ class BLT_DecoderServer : public NPT_Thread,
     BLT_Result UpdateStatus();
     BLT_Result NotifyPosition();
     BLT_Result NotifyTimeCode();
+    BLT_Result SetNextSource(BLT_PacketProducer* source);
+    void       ReleaseTrackSource(BLT_DecoderServer_TrackSource& source);
+    void       FlushTrackSource(BLT_DecoderServer_TrackSource& source);
+    bool       PreRollTrackSources();
+    void       CancelNextTracks();
+    void       CheckTrackTransition();
+    BLT_Decoder* GetFeedDecoder();
     virtual void SetupIsComplete() {} // called when Run method of thread has finished setup but not yet entered loop
 
     // members
@@ -542,6 +601,11 @@ class BLT_DecoderServer : public NPT_Thread,
     BLT_DecoderServer_EventListenerWrapper    m_EventListener;
     BLT_DecoderServer_PropertyListenerWrapper m_CorePropertyListener;
     BLT_DecoderServer_PropertyListenerWrapper m_StreamPropertyListener;
+
+    // the track being fed to the cross fader, and the one after it
+    BLT_DecoderServer_TrackSource m_TrackSources[2];
+    unsigned int                  m_NextTrackSource;
+    bool                          m_CrossFaderAdded;
 };
 
 #endif /* _BLT_DECODER_SERVER_H_ */
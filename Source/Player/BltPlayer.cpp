@@ -37,7 +37,8 @@ NPT_DEFINE_DYNAMIC_CAST_ANCHOR(BLT_Player)
 +---------------------------------------------------------------------*/
 BLT_Player::BLT_Player(NPT_MessageQueue* queue) :
     BLT_DecoderClient(queue),
-    m_Listener(NULL)
+    m_Listener(NULL),
+    m_AnalysisRing(NULL)
 {
     // create a decoder server
     m_Server = new BLT_DecoderServer(this);
@@ -52,6 +53,9 @@ BLT_Player::~BLT_Player()
     ATX_LOG_FINE("BLT_Player::~BLT_Player");
 
     Shutdown();
+
+    // the decoder thread is gone, nobody writes to the ring anymore
+    if (m_AnalysisRing) BLT_AnalysisRing_Destroy(m_AnalysisRing);
 }
 
 /*----------------------------------------------------------------------
@@ -120,6 +124,17 @@ BLT_Player::SetInput(BLT_CString name, BLT_CString type)
     return m_Server->SetInput(name, type);
 }
 
+/*----------------------------------------------------------------------
+|    BLT_Player::SetNextInput
++---------------------------------------------------------------------*/
+BLT_Result 
+BLT_Player::SetNextInput(BLT_CString name, BLT_CString type)
+{
+    ATX_LOG_FINE_2("BLT_Player::SetNextInput - name=%s, type=%s", BLT_SAFE_STRING(name), BLT_SAFE_STRING(type));
+    if (m_Server == NULL) return BLT_ERROR_INVALID_STATE;
+    return m_Server->SetNextInput(name, type);
+}
+
 /*----------------------------------------------------------------------
 |    BLT_Player::SetOutput
 +---------------------------------------------------------------------*/
@@ -258,6 +273,63 @@ BLT_Player::SetProperty(BLT_PropertyScope        scope,
     return m_Server->SetProperty(scope, target, name, value);
 }
 
+/*----------------------------------------------------------------------
+|    BLT_Player::EnableAnalysis
++---------------------------------------------------------------------*/
+BLT_Result 
+BLT_Player::EnableAnalysis(BLT_Flags flags)
+{
+    ATX_PropertyValue value;
+    BLT_Result        result;
+
+    ATX_LOG_FINE_1("BLT_Player::EnableAnalysis - flags=%x", flags);
+    if (m_Server == NULL) return BLT_ERROR_INVALID_STATE;
+    if (m_AnalysisRing) return BLT_SUCCESS;
+
+    // create the ring
+    result = BLT_AnalysisRing_Create(BLT_ANALYSIS_RING_DEFAULT_SIZE, flags, &m_AnalysisRing);
+    if (BLT_FAILED(result)) return result;
+
+    // let the tap node find the ring, and add the node
+    value.type         = ATX_PROPERTY_VALUE_TYPE_POINTER;
+    value.data.pointer = m_AnalysisRing;
+    result = m_Server->SetProperty(BLT_PROPERTY_SCOPE_CORE, NULL, BLT_ANALYSIS_RING_PROPERTY, &value);
+    if (BLT_SUCCEEDED(result)) {
+        result = m_Server->AddNode(BLT_ANALYSIS_TAP_MODULE_NAME);
+        if (BLT_FAILED(result)) {
+            // don't leave the property pointing to the ring we destroy
+            m_Server->SetProperty(BLT_PROPERTY_SCOPE_CORE, NULL, BLT_ANALYSIS_RING_PROPERTY, NULL);
+        }
+    }
+    if (BLT_FAILED(result)) {
+        // so that the next call tries again
+        BLT_AnalysisRing_Destroy(m_AnalysisRing);
+        m_AnalysisRing = NULL;
+    }
+
+    return result;
+}
+
+/*----------------------------------------------------------------------
+|    BLT_Player::ReadAnalysis
++---------------------------------------------------------------------*/
+BLT_Result 
+BLT_Player::ReadAnalysis(BLT_UInt32& cursor, BLT_AnalysisFrame& frame)
+{
+    if (m_AnalysisRing == NULL) return BLT_ERROR_INVALID_STATE;
+    return BLT_AnalysisRing_Read(m_AnalysisRing, &cursor, &frame);
+}
+
+/*----------------------------------------------------------------------
+|    BLT_Player::ReadLatestAnalysis
++---------------------------------------------------------------------*/
+BLT_Result 
+BLT_Player::ReadLatestAnalysis(BLT_AnalysisFrame& frame)
+{
+    if (m_AnalysisRing == NULL) return BLT_ERROR_INVALID_STATE;
+    return BLT_AnalysisRing_ReadLatest(m_AnalysisRing, &frame);
+}
+
 /*----------------------------------------------------------------------
 |    BLT_Player::LoadPlugin
 +---------------------------------------------------------------------*/
@@ -399,6 +471,15 @@ BLT_Player_SetInput(BLT_Player* self, BLT_CString name, BLT_CString mime_type)
     return self->SetInput(name, mime_type);
 }
 
+/*----------------------------------------------------------------------
+|    BLT_Player_SetNextInput
++---------------------------------------------------------------------*/
+BLT_Result
+BLT_Player_SetNextInput(BLT_Player* self, BLT_CString name, BLT_CString mime_type)
+{
+    return self->SetNextInput(name, mime_type);
+}
+
 /*----------------------------------------------------------------------
 |    BLT_Player_Play
 +---------------------------------------------------------------------*/
@@ -408,3 +489,30 @@ BLT_Player_Play(BLT_Player* self)
     return self->Play();
 }
 
+/*----------------------------------------------------------------------
+|    BLT_Player_EnableAnalysis
++---------------------------------------------------------------------*/
+BLT_Result
+BLT_Player_EnableAnalysis(BLT_Player* self, BLT_Flags flags)
+{
+    return self->EnableAnalysis(flags);
+}
+
+/*----------------------------------------------------------------------
+|    BLT_Player_ReadAnalysis
++---------------------------------------------------------------------*/
+BLT_Result
+BLT_Player_ReadAnalysis(BLT_Player* self, BLT_UInt32* cursor, BLT_AnalysisFrame* frame)
+{
+    return self->ReadAnalysis(*cursor, *frame);
+}
+
+/*----------------------------------------------------------------------
+|    BLT_Player_ReadLatestAnalysis
++---------------------------------------------------------------------*/
+BLT_Result
+BLT_Player_ReadLatestAnalysis(BLT_Player* self, BLT_AnalysisFrame* frame)
+{
+    return self->ReadLatestAnalysis(*frame);
+}
+
@@ -21,6 +21,7 @@
 |   includes
 +---------------------------------------------------------------------*/
 #include "BltDecoder.h"
+#include "BltAnalysisRing.h"
 
 #if defined(__cplusplus)
 #include "Neptune.h"
@@ -114,6 +115,19 @@ class BLT_Player : public BLT_DecoderClient
      */
     virtual BLT_Result SetInput(BLT_CString name, BLT_CString type = NULL);
 
+    /**
+     * Set the input that plays when the current one ends.
+     * The next input is opened and decoded ahead of time, and the end of
+     * the current input is mixed with its start by a cross fader node,
+     * which is added to the decoding stream the first time this method
+     * is called (see BltCrossFade.h for the properties that control the
+     * fade). Setting an input with SetInput drops the next input.
+     * @param name Name of the next input, or NULL or an empty string to
+     * clear it.
+     * @param type Mime-type of the next input, if known, or NULL
+     */
+    virtual BLT_Result SetNextInput(BLT_CString name, BLT_CString type = NULL);
+
     /**
      * Set the output of the decoder.
      * @param name Name of the output
@@ -224,6 +238,35 @@ class BLT_Player : public BLT_DecoderClient
                                    const char*              name,
                                    const ATX_PropertyValue* value);
 
+    /**
+     * Enable the real-time analysis of the audio being decoded (levels
+     * and spectrum, for meters and visualizations).
+     * This creates the analysis ring and adds an analysis tap node to the
+     * decoding stream. Once enabled, the analysis stays enabled until the
+     * player is destroyed; calling this method again has no effect.
+     * The analysis frames are read with ReadAnalysis or ReadLatestAnalysis.
+     * @param flags Combination of BLT_ANALYSIS_RING_FLAG_XXX flags.
+     */
+    virtual BLT_Result EnableAnalysis(BLT_Flags flags = BLT_ANALYSIS_RING_FLAG_SPECTRUM);
+
+    /**
+     * Read the next analysis frame.
+     * This method may be called from any thread, and never blocks.
+     * @param cursor Cursor of the reader, which should start at 0 (see
+     * BLT_AnalysisRing_Read).
+     * @param frame Frame in which the analysis is copied.
+     * @return BLT_SUCCESS if a frame was copied, BLT_ERROR_WOULD_BLOCK if
+     * there is no new frame, BLT_ERROR_INVALID_STATE if the analysis is
+     * not enabled.
+     */
+    BLT_Result ReadAnalysis(BLT_UInt32& cursor, BLT_AnalysisFrame& frame);
+
+    /**
+     * Read the most recent analysis frame.
+     * This method may be called from any thread, and never blocks.
+     */
+    BLT_Result ReadLatestAnalysis(BLT_AnalysisFrame& frame);
+
     /**
      * Load and Register a plugin.
      * @param name Name of a plugin (filename of the plugin or special name)
@@ -306,6 +349,11 @@ private:
      * Object that will handle notification callbacks, if not NULL.
      */
     BLT_DecoderClient_MessageHandler* m_Listener;
+
+    /**
+     * Ring to which the analysis tap node writes, if the analysis is enabled.
+     */
+    BLT_AnalysisRing* m_AnalysisRing;
 };
 #endif
 
@@ -344,7 +392,8 @@ typedef enum {
     BLT_PLAYER_COMMAND_ID_ADD_NODE,
     BLT_PLAYER_COMMAND_ID_SET_PROPERTY,
     BLT_PLAYER_COMMAND_ID_LOAD_PLUGIN,
-    BLT_PLAYER_COMMAND_ID_LOAD_PLUGINS
+    BLT_PLAYER_COMMAND_ID_LOAD_PLUGINS,
+    BLT_PLAYER_COMMAND_ID_SET_NEXT_INPUT
 } BLT_Player_CommandId;
 
 typedef enum {
@@ -425,9 +474,18 @@ BLT_Result BLT_Player_PumpMessage(BLT_Player* player, BLT_UInt32 timeout);
 BLT_Result BLT_Player_SetInput(BLT_Player* player,
                                BLT_CString name, 
                                BLT_CString mime_type);
+BLT_Result BLT_Player_SetNextInput(BLT_Player* player,
+                                   BLT_CString name, 
+                                   BLT_CString mime_type);
 BLT_Result BLT_Player_Play(BLT_Player* player);
 BLT_Result BLT_Player_Stop(BLT_Player* player);
 BLT_Result BLT_Player_Pause(BLT_Player* player);
+BLT_Result BLT_Player_EnableAnalysis(BLT_Player* player, BLT_Flags flags);
+BLT_Result BLT_Player_ReadAnalysis(BLT_Player*        player,
+                                   BLT_UInt32*        cursor,
+                                   BLT_AnalysisFrame* frame);
+BLT_Result BLT_Player_ReadLatestAnalysis(BLT_Player*        player,
+                                         BLT_AnalysisFrame* frame);
 
 #if defined(__cplusplus)
 }
@@ -464,6 +522,8 @@ public:
             return BLT_PLAYER_COMMAND_ID_LOAD_PLUGIN;
           case BLT_DecoderServer_Message::COMMAND_ID_LOAD_PLUGINS:
             return BLT_PLAYER_COMMAND_ID_LOAD_PLUGINS;
+          case BLT_DecoderServer_Message::COMMAND_ID_SET_NEXT_INPUT:
+            return BLT_PLAYER_COMMAND_ID_SET_NEXT_INPUT;
         }
         return (BLT_Player_CommandId)(-1);
     }
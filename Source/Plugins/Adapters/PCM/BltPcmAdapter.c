@@ -17,6 +17,8 @@
 #include "BltMediaNode.h"
 #include "BltMedia.h"
 #include "BltPcm.h"
+#include "BltPcmFloat.h"
+#include "BltRequantizer.h"
 #include "BltPacketProducer.h"
 #include "BltPacketConsumer.h"
 #include "BltStream.h"
@@ -26,6 +28,12 @@
 +---------------------------------------------------------------------*/
 ATX_SET_LOCAL_LOGGER("bluetune.plugins.adapters.pcm")
 
+/*----------------------------------------------------------------------
+|    constants
++---------------------------------------------------------------------*/
+/* number of frames converted and requantized at a time */
+#define BLT_PCM_ADAPTER_BLOCK_SIZE 256
+
 /*----------------------------------------------------------------------
 |    types
 +---------------------------------------------------------------------*/
@@ -54,6 +62,13 @@ typedef struct {
     /* members */
     PcmAdapterInput  input;
     PcmAdapterOutput output;
+    struct {
+        BLT_PcmMediaType in_format;
+        BLT_PcmMediaType out_format;
+        BLT_Boolean      requantize;
+        BLT_Requantizer  requantizer;
+        float            samples[BLT_PCM_ADAPTER_BLOCK_SIZE*BLT_REQUANTIZER_MAX_CHANNELS];
+    } state;
 } PcmAdapter;
 
 /*----------------------------------------------------------------------
@@ -63,6 +78,115 @@ ATX_DECLARE_INTERFACE_MAP(PcmAdapterModule, BLT_Module)
 ATX_DECLARE_INTERFACE_MAP(PcmAdapter, BLT_MediaNode)
 ATX_DECLARE_INTERFACE_MAP(PcmAdapter, ATX_Referenceable)
 
+/*----------------------------------------------------------------------
+|    PcmAdapter_Configure
++---------------------------------------------------------------------*/
+static void
+PcmAdapter_Configure(PcmAdapter* self, const BLT_PcmMediaType* in_format)
+{
+    BLT_PcmMediaType*      out_format = &self->state.out_format;
+    BLT_RequantizerShaping shaping    = BLT_REQUANTIZER_SHAPING_NONE;
+    ATX_Properties*        properties;
+
+    self->state.in_format  = *in_format;
+    self->state.requantize = BLT_FALSE;
+
+    /* resolve the unspecified output parameters */
+    *out_format = self->output.pcm_type;
+    if (out_format->bits_per_sample == 0) {
+        out_format->bits_per_sample = in_format->bits_per_sample;
+    }
+    if (out_format->channel_count == 0) {
+        out_format->channel_count = in_format->channel_count;
+    }
+    if (out_format->sample_rate == 0) {
+        out_format->sample_rate = in_format->sample_rate;
+    }
+
+    /* only narrowing to an integer format loses resolution */
+    if (out_format->sample_format == BLT_PCM_SAMPLE_FORMAT_FLOAT_LE ||
+        out_format->sample_format == BLT_PCM_SAMPLE_FORMAT_FLOAT_BE ||
+        out_format->bits_per_sample > 24) {
+        return;
+    }
+    if (in_format->sample_format != BLT_PCM_SAMPLE_FORMAT_FLOAT_LE &&
+        in_format->sample_format != BLT_PCM_SAMPLE_FORMAT_FLOAT_BE &&
+        in_format->bits_per_sample <= out_format->bits_per_sample) {
+        return;
+    }
+    if (in_format->channel_count != out_format->channel_count ||
+        !BLT_PcmFloat_SupportsFormat(in_format) ||
+        !BLT_PcmFloat_SupportsFormat(out_format)) {
+        return;
+    }
+
+    /* get the noise shaping setting */
+    if (BLT_SUCCEEDED(BLT_Core_GetProperties(ATX_BASE(self, BLT_BaseMediaNode).core,
+                                             &properties))) {
+        ATX_PropertyValue property;
+        if (ATX_SUCCEEDED(ATX_Properties_GetProperty(properties,
+                                                     BLT_PCM_ADAPTER_NOISE_SHAPING,
+                                                     &property)) &&
+            property.type == ATX_PROPERTY_VALUE_TYPE_INTEGER) {
+            shaping = (BLT_RequantizerShaping)property.data.integer;
+        }
+    }
+
+    if (BLT_SUCCEEDED(BLT_Requantizer_Init(&self->state.requantizer,
+                                           out_format->channel_count,
+                                           out_format->bits_per_sample,
+                                           shaping))) {
+        ATX_LOG_FINE_3("PcmAdapter::Configure - requantizing %d to %d bits, shaping %d",
+                       in_format->bits_per_sample,
+                       out_format->bits_per_sample,
+                       shaping);
+        self->state.requantize = BLT_TRUE;
+    }
+}
+
+/*----------------------------------------------------------------------
+|    PcmAdapter_Requantize
++---------------------------------------------------------------------*/
+static BLT_Result
+PcmAdapter_Requantize(PcmAdapter* self, BLT_MediaPacket* packet)
+{
+    const BLT_PcmMediaType* in_format      = &self->state.in_format;
+    const BLT_PcmMediaType* out_format     = &self->state.out_format;
+    BLT_Cardinal            channel_count  = in_format->channel_count;
+    BLT_Size                in_frame_size  = channel_count*in_format->bits_per_sample/8;
+    BLT_Size                out_frame_size = channel_count*out_format->bits_per_sample/8;
+    BLT_Cardinal            frame_count    = BLT_MediaPacket_GetPayloadSize(packet)/in_frame_size;
+    const unsigned char*    in;
+    unsigned char*          out;
+    BLT_Result              result;
+
+    /* allocate the output packet */
+    result = BLT_Core_CreateMediaPacket(ATX_BASE(self, BLT_BaseMediaNode).core,
+                                        frame_count*out_frame_size,
+                                        (const BLT_MediaType*)out_format,
+                                        &self->output.packet);
+    if (BLT_FAILED(result)) return result;
+    BLT_MediaPacket_SetPayloadSize(self->output.packet, frame_count*out_frame_size);
+
+    /* go through a float buffer, one block at a time */
+    in  = (const unsigned char*)BLT_MediaPacket_GetPayloadBuffer(packet);
+    out = (unsigned char*)BLT_MediaPacket_GetPayloadBuffer(self->output.packet);
+    while (frame_count) {
+        BLT_Cardinal chunk = frame_count;
+        if (chunk > BLT_PCM_ADAPTER_BLOCK_SIZE) chunk = BLT_PCM_ADAPTER_BLOCK_SIZE;
+
+        BLT_PcmFloat_Import(in_format, in, chunk*channel_count, self->state.samples);
+        BLT_Requantizer_Process(&self->state.requantizer, self->state.samples, chunk);
+        BLT_PcmFloat_Export(out_format, self->state.samples, chunk*channel_count, out);
+
+        in          += chunk*in_frame_size;
+        out         += chunk*out_frame_size;
+        frame_count -= chunk;
+    }
+
+    return BLT_SUCCESS;
+}
+
 /*----------------------------------------------------------------------
 |    PcmAdapterInput_PutPacket
 +---------------------------------------------------------------------*/
@@ -70,14 +194,30 @@ BLT_METHOD
 PcmAdapterInput_PutPacket(BLT_PacketConsumer* _self,
                           BLT_MediaPacket*    packet)
 {
-    PcmAdapter* self = ATX_SELF_M(input, PcmAdapter, BLT_PacketConsumer);
-    BLT_Result  result;
+    PcmAdapter*             self = ATX_SELF_M(input, PcmAdapter, BLT_PacketConsumer);
+    const BLT_PcmMediaType* media_type;
+    BLT_Result              result;
+
+    /* check for a format change */
+    result = BLT_MediaPacket_GetMediaType(packet, (const BLT_MediaType**)(const void*)&media_type);
+    if (BLT_FAILED(result)) return result;
+    if (media_type->base.id == BLT_MEDIA_TYPE_ID_AUDIO_PCM &&
+        (media_type->sample_rate     != self->state.in_format.sample_rate     ||
+         media_type->channel_count   != self->state.in_format.channel_count   ||
+         media_type->bits_per_sample != self->state.in_format.bits_per_sample ||
+         media_type->sample_format   != self->state.in_format.sample_format)) {
+        PcmAdapter_Configure(self, media_type);
+    }
 
     /* transform the packet data */
-    result =  BLT_Pcm_ConvertMediaPacket(ATX_BASE(self, BLT_BaseMediaNode).core,
-                                         packet, 
-                                         &self->output.pcm_type, 
-                                         &self->output.packet);
+    if (media_type->base.id == BLT_MEDIA_TYPE_ID_AUDIO_PCM && self->state.requantize) {
+        result = PcmAdapter_Requantize(self, packet);
+    } else {
+        result = BLT_Pcm_ConvertMediaPacket(ATX_BASE(self, BLT_BaseMediaNode).core,
+                                            packet,
+                                            &self->output.pcm_type,
+                                            &self->output.packet);
+    }
     if (BLT_FAILED(result)) {
         ATX_LOG_WARNING_1("PcmAdapterInput::PutPacket - failed to convert PCM (%d)", result);
     }
@@ -21,6 +21,8 @@
  * needs to be transformed before it can be consumed by another media node.
  * This includes, for example, going from single channel to stereo, or from 
  * 24-bit samples to 16-bit samples, or floating point samples to integer samples.
+ * When samples are narrowed to 24 bits or less, they are requantized with
+ * TPDF dither rather than truncated (see BltRequantizer.h).
  * @{ 
  */
 
@@ -30,6 +32,16 @@
 #include "BltTypes.h"
 #include "BltModule.h"
 
+/*----------------------------------------------------------------------
+|   constants
++---------------------------------------------------------------------*/
+/**
+ * Core property: noise shaping applied when narrowing samples
+ * (integer, one of BLT_RequantizerShaping). Read when a node starts
+ * converting a new format. Defaults to flat dither.
+ */
+#define BLT_PCM_ADAPTER_NOISE_SHAPING "Plugins.PcmAdapter.NoiseShaping"
+
 /*----------------------------------------------------------------------
 |   module
 +---------------------------------------------------------------------*/
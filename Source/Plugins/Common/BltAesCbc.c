@@ -0,0 +1,281 @@
+/*****************************************************************
+|
+|   BlueTune - AES-CBC
+|
+|   (c) 2002-2012 Gilles Boccon-Gibod
+|   Author: Gilles Boccon-Gibod (bok@bok.net)
+|
+ ****************************************************************/
+
+/*----------------------------------------------------------------------
+|   includes
++---------------------------------------------------------------------*/
+#include "Atomix.h"
+#include "BltTypes.h"
+#include "BltErrors.h"
+#include "BltAesCbc.h"
+
+/* the compiler must let us use the AES instructions without making */
+/* the whole build depend on them                                  */
+#if defined(_MSC_VER) && (defined(_M_IX86) || defined(_M_X64))
+#define BLT_AES_CBC_X86
+#define BLT_AES_CBC_X86_TARGET
+#include <intrin.h>
+#include <wmmintrin.h>
+#elif (defined(__i386__) || defined(__x86_64__)) && \
+      (defined(__clang__) || (defined(__GNUC__) && (__GNUC__ > 4 || (__GNUC__ == 4 && __GNUC_MINOR__ >= 9))))
+#define BLT_AES_CBC_X86
+#define BLT_AES_CBC_X86_TARGET __attribute__((target("aes,sse2")))
+#include <cpuid.h>
+#include <wmmintrin.h>
+#elif defined(BLT_CONFIG_ENABLE_ARM_AES) && (defined(__aarch64__) || defined(__arm__)) && \
+      (defined(__ARM_FEATURE_CRYPTO) || defined(__ARM_FEATURE_AES))
+#define BLT_AES_CBC_ARM
+#include <arm_neon.h>
+#endif
+
+/*----------------------------------------------------------------------
+|   constants
++---------------------------------------------------------------------*/
+#define BLT_AES_CBC_ROUNDS 10 /* AES-128 */
+
+/*----------------------------------------------------------------------
+|   types
++---------------------------------------------------------------------*/
+struct BLT_AesCbc {
+    BLT_UInt8 round_keys[BLT_AES_CBC_ROUNDS+1][BLT_AES_CBC_BLOCK_SIZE];
+};
+
+#if defined(BLT_AES_CBC_X86)
+/*----------------------------------------------------------------------
+|   BLT_AesCbc_CpuHasAes
++---------------------------------------------------------------------*/
+static BLT_Boolean
+BLT_AesCbc_CpuHasAes(void)
+{
+#if defined(_MSC_VER)
+    int info[4];
+    __cpuid(info, 1);
+    return (info[2] & (1<<25)) ? BLT_TRUE : BLT_FALSE;
+#else
+    unsigned int eax, ebx, ecx, edx;
+    if (!__get_cpuid(1, &eax, &ebx, &ecx, &edx)) return BLT_FALSE;
+    return (ecx & (1<<25)) ? BLT_TRUE : BLT_FALSE;
+#endif
+}
+
+/*----------------------------------------------------------------------
+|   BLT_AesCbc_ExpandKeyStep
++---------------------------------------------------------------------*/
+BLT_AES_CBC_X86_TARGET
+static __m128i
+BLT_AesCbc_ExpandKeyStep(__m128i key, __m128i assist)
+{
+    assist = _mm_shuffle_epi32(assist, 0xFF);
+    key    = _mm_xor_si128(key, _mm_slli_si128(key, 4));
+    key    = _mm_xor_si128(key, _mm_slli_si128(key, 4));
+    key    = _mm_xor_si128(key, _mm_slli_si128(key, 4));
+    return _mm_xor_si128(key, assist);
+}
+
+/*----------------------------------------------------------------------
+|   BLT_AesCbc_ExpandKey
++---------------------------------------------------------------------*/
+BLT_AES_CBC_X86_TARGET
+static void
+BLT_AesCbc_ExpandKey(BLT_AesCbc* self, const BLT_UInt8* key)
+{
+    __m128i round_keys[BLT_AES_CBC_ROUNDS+1];
+    int     i;
+
+    /* the round constant must be an immediate */
+    round_keys[0] = _mm_loadu_si128((const __m128i*)key);
+#define BLT_AES_CBC_EXPAND(n, rcon) \
+    round_keys[n] = BLT_AesCbc_ExpandKeyStep(round_keys[n-1], _mm_aeskeygenassist_si128(round_keys[n-1], rcon))
+    BLT_AES_CBC_EXPAND( 1, 0x01);
+    BLT_AES_CBC_EXPAND( 2, 0x02);
+    BLT_AES_CBC_EXPAND( 3, 0x04);
+    BLT_AES_CBC_EXPAND( 4, 0x08);
+    BLT_AES_CBC_EXPAND( 5, 0x10);
+    BLT_AES_CBC_EXPAND( 6, 0x20);
+    BLT_AES_CBC_EXPAND( 7, 0x40);
+    BLT_AES_CBC_EXPAND( 8, 0x80);
+    BLT_AES_CBC_EXPAND( 9, 0x1B);
+    BLT_AES_CBC_EXPAND(10, 0x36);
+#undef BLT_AES_CBC_EXPAND
+
+    for (i=0; i<=BLT_AES_CBC_ROUNDS; i++) {
+        _mm_storeu_si128((__m128i*)self->round_keys[i], round_keys[i]);
+    }
+}
+
+/*----------------------------------------------------------------------
+|   BLT_AesCbc_EncryptBlocks
++---------------------------------------------------------------------*/
+BLT_AES_CBC_X86_TARGET
+static void
+BLT_AesCbc_EncryptBlocks(BLT_AesCbc*      self,
+                         const BLT_UInt8* iv,
+                         const BLT_UInt8* in,
+                         BLT_UInt8*       out,
+                         BLT_Cardinal     block_count)
+{
+    __m128i round_keys[BLT_AES_CBC_ROUNDS+1];
+    __m128i chain = _mm_loadu_si128((const __m128i*)iv);
+    int     i;
+
+    for (i=0; i<=BLT_AES_CBC_ROUNDS; i++) {
+        round_keys[i] = _mm_loadu_si128((const __m128i*)self->round_keys[i]);
+    }
+
+    /* each block depends on the previous one, so there is no */
+    /* parallelism to exploit within a packet                  */
+    while (block_count--) {
+        chain = _mm_xor_si128(chain, _mm_loadu_si128((const __m128i*)in));
+        chain = _mm_xor_si128(chain, round_keys[0]);
+        for (i=1; i<BLT_AES_CBC_ROUNDS; i++) {
+            chain = _mm_aesenc_si128(chain, round_keys[i]);
+        }
+        chain = _mm_aesenclast_si128(chain, round_keys[BLT_AES_CBC_ROUNDS]);
+        _mm_storeu_si128((__m128i*)out, chain);
+        in  += BLT_AES_CBC_BLOCK_SIZE;
+        out += BLT_AES_CBC_BLOCK_SIZE;
+    }
+}
+#endif /* BLT_AES_CBC_X86 */
+
+#if defined(BLT_AES_CBC_ARM)
+/*----------------------------------------------------------------------
+|   BLT_AesCbc_SubWord
++---------------------------------------------------------------------*/
+static BLT_UInt32
+BLT_AesCbc_SubWord(BLT_UInt32 word)
+{
+    /* AESE with a zero key is SubBytes after ShiftRows, and ShiftRows */
+    /* does nothing when all the columns are the same                 */
+    uint8x16_t block = vreinterpretq_u8_u32(vdupq_n_u32(word));
+    block = vaeseq_u8(block, vdupq_n_u8(0));
+    return vgetq_lane_u32(vreinterpretq_u32_u8(block), 0);
+}
+
+/*----------------------------------------------------------------------
+|   BLT_AesCbc_ExpandKey
++---------------------------------------------------------------------*/
+static void
+BLT_AesCbc_ExpandKey(BLT_AesCbc* self, const BLT_UInt8* key)
+{
+    static const BLT_UInt8 rcon[BLT_AES_CBC_ROUNDS] = {
+        0x01, 0x02, 0x04, 0x08, 0x10, 0x20, 0x40, 0x80, 0x1B, 0x36
+    };
+    BLT_UInt32 words[4*(BLT_AES_CBC_ROUNDS+1)];
+    int        i;
+
+    /* words in memory order, so this works for either byte order */
+    ATX_CopyMemory(words, key, BLT_AES_CBC_KEY_SIZE);
+    for (i=4; i<4*(BLT_AES_CBC_ROUNDS+1); i++) {
+        BLT_UInt32 word = words[i-1];
+        if (i%4 == 0) {
+            BLT_UInt8 bytes[4];
+            BLT_UInt8 first;
+            word = BLT_AesCbc_SubWord(word);
+            ATX_CopyMemory(bytes, &word, 4);
+            first    = bytes[0];
+            bytes[0] = (BLT_UInt8)(bytes[1]^rcon[i/4-1]);
+            bytes[1] = bytes[2];
+            bytes[2] = bytes[3];
+            bytes[3] = first;
+            ATX_CopyMemory(&word, bytes, 4);
+        }
+        words[i] = words[i-4]^word;
+    }
+    ATX_CopyMemory(self->round_keys, words, sizeof(self->round_keys));
+}
+
+/*----------------------------------------------------------------------
+|   BLT_AesCbc_EncryptBlocks
++---------------------------------------------------------------------*/
+static void
+BLT_AesCbc_EncryptBlocks(BLT_AesCbc*      self,
+                         const BLT_UInt8* iv,
+                         const BLT_UInt8* in,
+                         BLT_UInt8*       out,
+                         BLT_Cardinal     block_count)
+{
+    uint8x16_t round_keys[BLT_AES_CBC_ROUNDS+1];
+    uint8x16_t chain = vld1q_u8(iv);
+    int        i;
+
+    for (i=0; i<=BLT_AES_CBC_ROUNDS; i++) {
+        round_keys[i] = vld1q_u8(self->round_keys[i]);
+    }
+
+    while (block_count--) {
+        chain = veorq_u8(chain, vld1q_u8(in));
+        for (i=0; i<BLT_AES_CBC_ROUNDS-1; i++) {
+            chain = vaesmcq_u8(vaeseq_u8(chain, round_keys[i]));
+        }
+        chain = vaeseq_u8(chain, round_keys[BLT_AES_CBC_ROUNDS-1]);
+        chain = veorq_u8(chain, round_keys[BLT_AES_CBC_ROUNDS]);
+        vst1q_u8(out, chain);
+        in  += BLT_AES_CBC_BLOCK_SIZE;
+        out += BLT_AES_CBC_BLOCK_SIZE;
+    }
+}
+#endif /* BLT_AES_CBC_ARM */
+
+/*----------------------------------------------------------------------
+|   BLT_AesCbc_Create
++---------------------------------------------------------------------*/
+BLT_Result
+BLT_AesCbc_Create(const BLT_UInt8* key, BLT_AesCbc** cipher)
+{
+#if defined(BLT_AES_CBC_X86) || defined(BLT_AES_CBC_ARM)
+    BLT_AesCbc* self;
+
+    *cipher = NULL;
+#if defined(BLT_AES_CBC_X86)
+    if (!BLT_AesCbc_CpuHasAes()) return BLT_ERROR_NOT_SUPPORTED;
+#endif
+    self = (BLT_AesCbc*)ATX_AllocateZeroMemory(sizeof(BLT_AesCbc));
+    if (self == NULL) return BLT_ERROR_OUT_OF_MEMORY;
+    BLT_AesCbc_ExpandKey(self, key);
+
+    *cipher = self;
+    return BLT_SUCCESS;
+#else
+    ATX_COMPILER_UNUSED(key);
+    *cipher = NULL;
+    return BLT_ERROR_NOT_SUPPORTED;
+#endif
+}
+
+/*----------------------------------------------------------------------
+|   BLT_AesCbc_Destroy
++---------------------------------------------------------------------*/
+void
+BLT_AesCbc_Destroy(BLT_AesCbc* self)
+{
+    ATX_FreeMemory(self);
+}
+
+/*----------------------------------------------------------------------
+|   BLT_AesCbc_Encrypt
++---------------------------------------------------------------------*/
+void
+BLT_AesCbc_Encrypt(BLT_AesCbc*      self,
+                   const BLT_UInt8* iv,
+                   const BLT_UInt8* in,
+                   BLT_UInt8*       out,
+                   BLT_Cardinal     block_count)
+{
+#if defined(BLT_AES_CBC_X86) || defined(BLT_AES_CBC_ARM)
+    BLT_AesCbc_EncryptBlocks(self, iv, in, out, block_count);
+#else
+    /* can't be called, there is no way to create one */
+    ATX_COMPILER_UNUSED(self);
+    ATX_COMPILER_UNUSED(iv);
+    ATX_COMPILER_UNUSED(in);
+    ATX_COMPILER_UNUSED(out);
+    ATX_COMPILER_UNUSED(block_count);
+#endif
+}
@@ -0,0 +1,68 @@
+/*****************************************************************
+|
+|   BlueTune - AES-CBC
+|
+|   (c) 2002-2012 Gilles Boccon-Gibod
+|   Author: Gilles Boccon-Gibod (bok@bok.net)
+|
+ ****************************************************************/
+/** @file
+ * AES-CBC: AES-128 encryption in CBC mode with the AES instructions of
+ * the CPU (AES-NI on x86, the crypto extension on ARMv8).
+ * The instructions are detected at runtime on x86, and at compile time
+ * on ARM. When they are not available, creating a cipher fails with
+ * BLT_ERROR_NOT_SUPPORTED and callers keep using a software cipher.
+ * The ARM version is only built when BLT_CONFIG_ENABLE_ARM_AES is
+ * defined, until it has been run against the test vectors of AesCbcTest
+ * on the target.
+ */
+
+#ifndef _BLT_AES_CBC_H_
+#define _BLT_AES_CBC_H_
+
+/*----------------------------------------------------------------------
+|   includes
++---------------------------------------------------------------------*/
+#include "BltTypes.h"
+
+/*----------------------------------------------------------------------
+|   constants
++---------------------------------------------------------------------*/
+#define BLT_AES_CBC_BLOCK_SIZE 16
+#define BLT_AES_CBC_KEY_SIZE   16
+
+/*----------------------------------------------------------------------
+|   types
++---------------------------------------------------------------------*/
+typedef struct BLT_AesCbc BLT_AesCbc;
+
+/*----------------------------------------------------------------------
+|   prototypes
++---------------------------------------------------------------------*/
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/**
+ * Create a cipher for a 128 bit key.
+ * @return BLT_ERROR_NOT_SUPPORTED if the CPU can't do it in hardware.
+ */
+BLT_Result BLT_AesCbc_Create(const BLT_UInt8* key, BLT_AesCbc** cipher);
+
+void BLT_AesCbc_Destroy(BLT_AesCbc* self);
+
+/**
+ * Encrypt whole blocks, chaining from 'iv'. The output may be the same
+ * buffer as the input.
+ */
+void BLT_AesCbc_Encrypt(BLT_AesCbc*      self,
+                        const BLT_UInt8* iv,
+                        const BLT_UInt8* in,
+                        BLT_UInt8*       out,
+                        BLT_Cardinal     block_count);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* _BLT_AES_CBC_H_ */
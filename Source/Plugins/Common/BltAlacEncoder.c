@@ -0,0 +1,498 @@
+/*****************************************************************
+|
+|   BlueTune - ALAC Encoder
+|
+|   (c) 2002-2012 Gilles Boccon-Gibod
+|   Author: Gilles Boccon-Gibod (bok@bok.net)
+|
+ ****************************************************************/
+
+/*----------------------------------------------------------------------
+|   includes
++---------------------------------------------------------------------*/
+#include "Atomix.h"
+#include "BltTypes.h"
+#include "BltErrors.h"
+#include "BltAlacEncoder.h"
+
+/*----------------------------------------------------------------------
+|   constants
++---------------------------------------------------------------------*/
+#define BLT_ALAC_ELEMENT_CPE           1
+#define BLT_ALAC_ELEMENT_END           7
+#define BLT_ALAC_HEADER_BITS           55 /* element, has_size, escape, size */
+#define BLT_ALAC_PREDICTOR_HEADER_BITS 16 /* mode, shift, pb factor, order  */
+#define BLT_ALAC_MIX_BITS              2
+#define BLT_ALAC_MAX_MIX_RES           4
+#define BLT_ALAC_PB_FACTOR             4  /* pb = pb factor*RICE_HISTORY_MULT/4 */
+#define BLT_ALAC_QUANT                 9
+#define BLT_ALAC_MAX_ORDER             8
+#define BLT_ALAC_ORDER_COUNT           2
+#define BLT_ALAC_CHANNEL_BITS          (BLT_ALAC_ENCODER_BIT_DEPTH+1) /* room for the side channel */
+#define BLT_ALAC_MAX_PREFIX            9  /* unary prefix that announces a raw value */
+
+/* predictor orders tried on each frame */
+static const unsigned int BLT_AlacEncoder_Orders[BLT_ALAC_ORDER_COUNT] = { 4, 8 };
+
+/*----------------------------------------------------------------------
+|   macros
++---------------------------------------------------------------------*/
+#define BLT_ALAC_SIGN_EXTEND(v, bits) \
+    (((BLT_Int32)((BLT_UInt32)(v) << (32-(bits)))) >> (32-(bits)))
+
+/*----------------------------------------------------------------------
+|   types
++---------------------------------------------------------------------*/
+struct BLT_AlacEncoder {
+    BLT_Cardinal frame_length;
+    BLT_Boolean  compress;
+    BLT_Int32*   channels[2];  /* after stereo mixing                  */
+    BLT_Int32*   residuals[2]; /* of the predictor chosen for a channel */
+    BLT_Int32*   trial;        /* of the predictor being tried          */
+
+    /* where the adaptive predictors start on the next frame */
+    BLT_Int16    coefs[2][BLT_ALAC_ORDER_COUNT][BLT_ALAC_MAX_ORDER];
+};
+
+/* big-endian bit packer, flushing 32 bits at a time */
+typedef struct {
+    BLT_UInt8*   out;
+    BLT_UInt64   bits;  /* the pending bits are the low 'count' bits */
+    unsigned int count;
+} BLT_AlacBitWriter;
+
+/*----------------------------------------------------------------------
+|   BLT_AlacBitWriter_Write
++---------------------------------------------------------------------*/
+static void
+BLT_AlacBitWriter_Write(BLT_AlacBitWriter* self, BLT_UInt32 value, unsigned int count)
+{
+    /* value must fit in count bits, count must be at most 32 */
+    self->bits   = (self->bits << count) | value;
+    self->count += count;
+    if (self->count >= 32) {
+        BLT_UInt32 word;
+        self->count -= 32;
+        word = (BLT_UInt32)(self->bits >> self->count);
+        self->out[0] = (BLT_UInt8)(word>>24);
+        self->out[1] = (BLT_UInt8)(word>>16);
+        self->out[2] = (BLT_UInt8)(word>> 8);
+        self->out[3] = (BLT_UInt8)(word    );
+        self->out += 4;
+    }
+}
+
+/*----------------------------------------------------------------------
+|   BLT_AlacBitWriter_Flush
++---------------------------------------------------------------------*/
+static void
+BLT_AlacBitWriter_Flush(BLT_AlacBitWriter* self)
+{
+    /* pad the last byte with zeros */
+    while (self->count >= 8) {
+        self->count -= 8;
+        *self->out++ = (BLT_UInt8)(self->bits >> self->count);
+    }
+    if (self->count) {
+        *self->out++ = (BLT_UInt8)(self->bits << (8-self->count));
+        self->count = 0;
+    }
+}
+
+/*----------------------------------------------------------------------
+|   BLT_AlacEncoder_Log2
++---------------------------------------------------------------------*/
+static unsigned int
+BLT_AlacEncoder_Log2(BLT_UInt32 value)
+{
+    unsigned int result = 0;
+    while (value >>= 1) ++result;
+    return result;
+}
+
+/*----------------------------------------------------------------------
+|   BLT_AlacEncoder_CodeScalar
+|
+|   Rice code with parameter k, with the quirks of the decoder: the
+|   remainder is taken modulo 2^k-1 so that it never needs all k bits
+|   to be zero, and a remainder of 0 only takes k-1 bits.
++---------------------------------------------------------------------*/
+static unsigned int
+BLT_AlacEncoder_CodeScalar(BLT_UInt32         value,
+                           unsigned int       k,
+                           unsigned int       raw_bits,
+                           BLT_AlacBitWriter* writer)
+{
+    BLT_UInt32 divisor  = (1UL<<k)-1;
+    BLT_UInt32 quotient = value/divisor;
+    BLT_UInt32 remainder;
+    BLT_UInt32 prefix;
+
+    if (quotient >= BLT_ALAC_MAX_PREFIX) {
+        /* too large, send it raw after an escape prefix */
+        if (writer) {
+            BLT_AlacBitWriter_Write(writer,
+                                    ((1UL<<BLT_ALAC_MAX_PREFIX)-1) << raw_bits | value,
+                                    BLT_ALAC_MAX_PREFIX+raw_bits);
+        }
+        return BLT_ALAC_MAX_PREFIX+raw_bits;
+    }
+
+    /* unary quotient: that many ones, then a zero */
+    prefix = (1UL<<(quotient+1))-2;
+    if (k == 1) {
+        if (writer) BLT_AlacBitWriter_Write(writer, prefix, quotient+1);
+        return quotient+1;
+    }
+    remainder = value-quotient*divisor;
+    if (remainder == 0) {
+        if (writer) BLT_AlacBitWriter_Write(writer, prefix << (k-1), quotient+k);
+        return quotient+k;
+    } else {
+        if (writer) BLT_AlacBitWriter_Write(writer, prefix << k | (remainder+1), quotient+1+k);
+        return quotient+1+k;
+    }
+}
+
+/*----------------------------------------------------------------------
+|   BLT_AlacEncoder_CodeResiduals
+|
+|   Adaptive Golomb coding of the residuals of one channel. Returns the
+|   number of bits, and writes them if there is a writer.
++---------------------------------------------------------------------*/
+static BLT_Cardinal
+BLT_AlacEncoder_CodeResiduals(const BLT_Int32*   residuals,
+                              BLT_Cardinal       count,
+                              BLT_AlacBitWriter* writer)
+{
+    BLT_UInt32   history       = BLT_ALAC_ENCODER_INITIAL_HISTORY;
+    BLT_UInt32   multiplier    = BLT_ALAC_PB_FACTOR*BLT_ALAC_ENCODER_RICE_HISTORY_MULT/4;
+    BLT_UInt32   sign_modifier = 0;
+    BLT_Cardinal bit_count     = 0;
+    BLT_Cardinal i;
+
+    for (i=0; i<count; i++) {
+        BLT_Int32    residual = residuals[i];
+        BLT_UInt32   value;
+        unsigned int k;
+
+        /* fold the sign into the lowest bit */
+        value = residual < 0 ?
+                ((BLT_UInt32)(~residual) << 1) | 1 :
+                (BLT_UInt32)residual << 1;
+
+        /* the parameter follows the mean of the recent values */
+        k = BLT_AlacEncoder_Log2((history >> 9)+3);
+        if (k > BLT_ALAC_ENCODER_RICE_LIMIT) k = BLT_ALAC_ENCODER_RICE_LIMIT;
+        bit_count += BLT_AlacEncoder_CodeScalar(value-sign_modifier,
+                                                k,
+                                                BLT_ALAC_CHANNEL_BITS,
+                                                writer);
+        sign_modifier = 0;
+        if (value > 0xFFFF) {
+            history = 0xFFFF;
+        } else {
+            history += value*multiplier-((history*multiplier) >> 9);
+        }
+
+        /* when the values get small, the decoder expects a run of zeros */
+        if (history < 128 && i+1 < count) {
+            BLT_Cardinal run = 0;
+            while (i+1+run < count && residuals[i+1+run] == 0 && run < 0xFFFF) {
+                ++run;
+            }
+            k = 7-BLT_AlacEncoder_Log2(history)+((history+16) >> 6);
+            if (k > BLT_ALAC_ENCODER_RICE_LIMIT) k = BLT_ALAC_ENCODER_RICE_LIMIT;
+            bit_count += BLT_AlacEncoder_CodeScalar(run, k, 16, writer);
+            i += run;
+
+            /* the value after a run is never 0, so it is sent minus one */
+            sign_modifier = 1;
+            history       = 0;
+        }
+    }
+
+    return bit_count;
+}
+
+/*----------------------------------------------------------------------
+|   BLT_AlacEncoder_Predict
+|
+|   Runs the adaptive predictor of the decoder backwards. The
+|   coefficients are updated in place, exactly as the decoder will.
++---------------------------------------------------------------------*/
+static void
+BLT_AlacEncoder_Predict(const BLT_Int32* samples,
+                        BLT_Int32*       residuals,
+                        BLT_Cardinal     count,
+                        BLT_Int16*       coefs,
+                        unsigned int     order)
+{
+    BLT_Cardinal i;
+
+    if (count == 0) return;
+    residuals[0] = samples[0];
+
+    /* warm up with a first order predictor */
+    for (i=1; i <= order && i < count; i++) {
+        residuals[i] = BLT_ALAC_SIGN_EXTEND(samples[i]-samples[i-1], BLT_ALAC_CHANNEL_BITS);
+    }
+
+    for (; i<count; i++) {
+        const BLT_Int32* past = &samples[i-order];
+        BLT_Int32        base = samples[i-order-1];
+        BLT_UInt32       sum  = 0;
+        BLT_Int32        prediction;
+        BLT_Int32        error;
+        unsigned int     j;
+
+        /* the products may wrap, as they do in the decoder */
+        for (j=0; j<order; j++) {
+            sum += (BLT_UInt32)(past[j]-base)*(BLT_UInt32)coefs[j];
+        }
+        prediction = (BLT_Int32)(((ATX_Int64)(BLT_Int32)sum+(1<<(BLT_ALAC_QUANT-1))) >> BLT_ALAC_QUANT);
+        error = BLT_ALAC_SIGN_EXTEND(samples[i]-base-prediction, BLT_ALAC_CHANNEL_BITS);
+        residuals[i] = error;
+
+        /* sign-sign LMS update, oldest sample first, which stops when */
+        /* the error reduced at each step changes sign. The steps after */
+        /* the stop are masked rather than skipped, so the only serial  */
+        /* work is one subtraction per step                             */
+        {
+            BLT_Int32 error_sign = (error > 0)-(error < 0);
+            BLT_Int32 remaining  = error*error_sign;
+            BLT_Int32 active     = -1;
+            for (j=0; j<order; j++) {
+                BLT_Int32 delta     = base-past[j];
+                BLT_Int32 magnitude = delta < 0 ? -delta : delta;
+                BLT_Int32 sign      = ((delta > 0)-(delta < 0))*error_sign;
+                active   &= -(BLT_Int32)(remaining > 0);
+                coefs[j]  = (BLT_Int16)(coefs[j]-(sign & active));
+                remaining -= (((magnitude*error_sign) >> BLT_ALAC_QUANT)*error_sign)*(BLT_Int32)(j+1);
+            }
+        }
+    }
+}
+
+/*----------------------------------------------------------------------
+|   BLT_AlacEncoder_ChooseMix
+|
+|   Picks the stereo mix weight (in 1/4ths) for which the channels are
+|   the smoothest, as a cheap estimate of how well they predict.
++---------------------------------------------------------------------*/
+static unsigned int
+BLT_AlacEncoder_ChooseMix(const BLT_Int16* samples, BLT_Cardinal count)
+{
+    BLT_UInt64   costs[BLT_ALAC_MAX_MIX_RES+1];
+    BLT_UInt64   side_cost = 0;
+    unsigned int best = 0;
+    unsigned int w;
+    BLT_Cardinal i;
+
+    for (w=0; w<=BLT_ALAC_MAX_MIX_RES; w++) costs[w] = 0;
+    for (i=2; i<count; i++) {
+        BLT_Int32 left  = samples[2*i  ]-2*samples[2*i-2]+samples[2*i-4];
+        BLT_Int32 right = samples[2*i+1]-2*samples[2*i-1]+samples[2*i-3];
+        BLT_Int32 side  = left-right;
+
+        costs[0]  += (BLT_UInt32)(left  < 0 ? -left  : left);
+        costs[0]  += (BLT_UInt32)(right < 0 ? -right : right);
+        side_cost += (BLT_UInt32)(side  < 0 ? -side  : side);
+        for (w=1; w<=BLT_ALAC_MAX_MIX_RES; w++) {
+            BLT_Int32 mix = right+((side*(BLT_Int32)w) >> BLT_ALAC_MIX_BITS);
+            costs[w] += (BLT_UInt32)(mix < 0 ? -mix : mix);
+        }
+    }
+    for (w=1; w<=BLT_ALAC_MAX_MIX_RES; w++) {
+        if (costs[w]+side_cost < costs[best]) best = w;
+    }
+
+    return best;
+}
+
+/*----------------------------------------------------------------------
+|   BLT_AlacEncoder_Create
++---------------------------------------------------------------------*/
+BLT_Result
+BLT_AlacEncoder_Create(BLT_Cardinal      frame_length,
+                       BLT_Boolean       compress,
+                       BLT_AlacEncoder** encoder)
+{
+    BLT_AlacEncoder* self;
+    BLT_Int32*       buffers;
+
+    *encoder = NULL;
+    if (frame_length == 0 || frame_length > BLT_ALAC_ENCODER_MAX_FRAME_LENGTH) {
+        return BLT_ERROR_INVALID_PARAMETERS;
+    }
+
+    /* the struct and the 5 sample buffers in one block */
+    self = (BLT_AlacEncoder*)ATX_AllocateZeroMemory(sizeof(BLT_AlacEncoder)+
+                                                    5*frame_length*sizeof(BLT_Int32));
+    if (self == NULL) return BLT_ERROR_OUT_OF_MEMORY;
+    buffers = (BLT_Int32*)(self+1);
+    self->frame_length = frame_length;
+    self->compress     = compress;
+    self->channels[0]  = buffers;
+    self->channels[1]  = buffers+frame_length;
+    self->residuals[0] = buffers+2*frame_length;
+    self->residuals[1] = buffers+3*frame_length;
+    self->trial        = buffers+4*frame_length;
+    BLT_AlacEncoder_Reset(self);
+
+    *encoder = self;
+    return BLT_SUCCESS;
+}
+
+/*----------------------------------------------------------------------
+|   BLT_AlacEncoder_Destroy
++---------------------------------------------------------------------*/
+void
+BLT_AlacEncoder_Destroy(BLT_AlacEncoder* self)
+{
+    ATX_FreeMemory(self);
+}
+
+/*----------------------------------------------------------------------
+|   BLT_AlacEncoder_Reset
++---------------------------------------------------------------------*/
+void
+BLT_AlacEncoder_Reset(BLT_AlacEncoder* self)
+{
+    unsigned int c, o;
+
+    /* start from a second order predictor: 2*x[n-1] - x[n-2] */
+    ATX_SetMemory(self->coefs, 0, sizeof(self->coefs));
+    for (c=0; c<2; c++) {
+        for (o=0; o<BLT_ALAC_ORDER_COUNT; o++) {
+            unsigned int order = BLT_AlacEncoder_Orders[o];
+            self->coefs[c][o][order-1] =  2<<BLT_ALAC_QUANT;
+            self->coefs[c][o][order-2] = -(1<<BLT_ALAC_QUANT);
+        }
+    }
+}
+
+/*----------------------------------------------------------------------
+|   BLT_AlacEncoder_GetMaxFrameSize
++---------------------------------------------------------------------*/
+BLT_Size
+BLT_AlacEncoder_GetMaxFrameSize(const BLT_AlacEncoder* self)
+{
+    return (BLT_ALAC_HEADER_BITS+32*self->frame_length+3+7)/8;
+}
+
+/*----------------------------------------------------------------------
+|   BLT_AlacEncoder_WriteHeader
++---------------------------------------------------------------------*/
+static void
+BLT_AlacEncoder_WriteHeader(BLT_AlacBitWriter* writer,
+                            BLT_Cardinal       frame_count,
+                            BLT_Boolean        escape)
+{
+    /* element type, instance tag and 12 unused bits */
+    BLT_AlacBitWriter_Write(writer, BLT_ALAC_ELEMENT_CPE, 3);
+    BLT_AlacBitWriter_Write(writer, 0, 16);
+
+    /* has_size, no shifted bytes, escape flag */
+    BLT_AlacBitWriter_Write(writer, 0x8 | (escape?1:0), 4);
+    BLT_AlacBitWriter_Write(writer, frame_count, 32);
+}
+
+/*----------------------------------------------------------------------
+|   BLT_AlacEncoder_EncodeFrame
++---------------------------------------------------------------------*/
+BLT_Size
+BLT_AlacEncoder_EncodeFrame(BLT_AlacEncoder* self,
+                            const BLT_Int16* samples,
+                            BLT_Cardinal     frame_count,
+                            BLT_UInt8*       frame)
+{
+    BLT_AlacBitWriter writer;
+    BLT_Cardinal      raw_bits = BLT_ALAC_HEADER_BITS+32*frame_count;
+    BLT_Cardinal      i;
+
+    if (frame_count > self->frame_length) frame_count = self->frame_length;
+    writer.out   = frame;
+    writer.bits  = 0;
+    writer.count = 0;
+
+    if (self->compress && frame_count) {
+        BLT_Int16    adapted[2][BLT_ALAC_MAX_ORDER];
+        unsigned int chosen[2];
+        unsigned int mix_res = BLT_AlacEncoder_ChooseMix(samples, frame_count);
+        BLT_Cardinal bits = BLT_ALAC_HEADER_BITS+16+2*BLT_ALAC_PREDICTOR_HEADER_BITS;
+        unsigned int c, o, j;
+
+        /* mix: the decoder rebuilds R = u-(v*w >> 2) and L = v+R */
+        if (mix_res) {
+            for (i=0; i<frame_count; i++) {
+                BLT_Int32 side = samples[2*i]-samples[2*i+1];
+                self->channels[0][i] = samples[2*i+1]+((side*(BLT_Int32)mix_res) >> BLT_ALAC_MIX_BITS);
+                self->channels[1][i] = side;
+            }
+        } else {
+            for (i=0; i<frame_count; i++) {
+                self->channels[0][i] = samples[2*i  ];
+                self->channels[1][i] = samples[2*i+1];
+            }
+        }
+
+        /* try each predictor order on each channel, keep the smallest */
+        for (c=0; c<2; c++) {
+            BLT_Cardinal best_bits = 0;
+            for (o=0; o<BLT_ALAC_ORDER_COUNT; o++) {
+                unsigned int order = BLT_AlacEncoder_Orders[o];
+                BLT_Int16    trial_coefs[BLT_ALAC_MAX_ORDER];
+                BLT_Cardinal trial_bits;
+
+                ATX_CopyMemory(trial_coefs, self->coefs[c][o], sizeof(trial_coefs));
+                BLT_AlacEncoder_Predict(self->channels[c], self->trial, frame_count, trial_coefs, order);
+                trial_bits = 16*order+BLT_AlacEncoder_CodeResiduals(self->trial, frame_count, NULL);
+                if (o == 0 || trial_bits < best_bits) {
+                    BLT_Int32* swap = self->residuals[c];
+                    self->residuals[c] = self->trial;
+                    self->trial        = swap;
+                    ATX_CopyMemory(adapted[c], trial_coefs, sizeof(trial_coefs));
+                    chosen[c] = o;
+                    best_bits = trial_bits;
+                }
+            }
+            bits += best_bits;
+        }
+
+        if (bits < raw_bits) {
+            BLT_AlacEncoder_WriteHeader(&writer, frame_count, BLT_FALSE);
+            BLT_AlacBitWriter_Write(&writer, mix_res ? BLT_ALAC_MIX_BITS : 0, 8);
+            BLT_AlacBitWriter_Write(&writer, mix_res, 8);
+            for (c=0; c<2; c++) {
+                unsigned int order = BLT_AlacEncoder_Orders[chosen[c]];
+                BLT_AlacBitWriter_Write(&writer, BLT_ALAC_QUANT, 8); /* mode 0 */
+                BLT_AlacBitWriter_Write(&writer, BLT_ALAC_PB_FACTOR << 5 | order, 8);
+
+                /* the newest sample's coefficient goes first */
+                for (j=order; j--;) {
+                    BLT_AlacBitWriter_Write(&writer, (BLT_UInt16)self->coefs[c][chosen[c]][j], 16);
+                }
+            }
+            for (c=0; c<2; c++) {
+                BLT_AlacEncoder_CodeResiduals(self->residuals[c], frame_count, &writer);
+                ATX_CopyMemory(self->coefs[c][chosen[c]], adapted[c], sizeof(adapted[c]));
+            }
+            BLT_AlacBitWriter_Write(&writer, BLT_ALAC_ELEMENT_END, 3);
+            BLT_AlacBitWriter_Flush(&writer);
+            return (BLT_Size)(writer.out-frame);
+        }
+    }
+
+    /* uncompressed: both channels of a frame in one 32 bit word */
+    BLT_AlacEncoder_WriteHeader(&writer, frame_count, BLT_TRUE);
+    for (i=0; i<frame_count; i++) {
+        BLT_AlacBitWriter_Write(&writer,
+                                (BLT_UInt32)(BLT_UInt16)samples[2*i] << 16 | (BLT_UInt16)samples[2*i+1],
+                                32);
+    }
+    BLT_AlacBitWriter_Write(&writer, BLT_ALAC_ELEMENT_END, 3);
+    BLT_AlacBitWriter_Flush(&writer);
+
+    return (BLT_Size)(writer.out-frame);
+}
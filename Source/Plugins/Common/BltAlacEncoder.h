@@ -0,0 +1,98 @@
+/*****************************************************************
+|
+|   BlueTune - ALAC Encoder
+|
+|   (c) 2002-2012 Gilles Boccon-Gibod
+|   Author: Gilles Boccon-Gibod (bok@bok.net)
+|
+ ****************************************************************/
+/** @file
+ * ALAC Encoder: encodes frames of 16-bit stereo PCM into Apple Lossless
+ * frames, as carried by RAOP.
+ * Each frame is mixed to a mid/side pair when that helps, run through
+ * the adaptive predictor of the format (the decoder adapts the
+ * coefficients as it goes, so the encoder only has to pick where they
+ * start from) and Rice coded. The coefficients reached at the end of a
+ * frame are the starting point of the next one. A frame that would not
+ * be smaller than the raw samples is stored uncompressed.
+ * The encoder only produces the frame bitstream: the stream parameters
+ * that the decoder needs (the "magic cookie", or the RAOP fmtp line)
+ * must use the values of the constants below.
+ */
+
+#ifndef _BLT_ALAC_ENCODER_H_
+#define _BLT_ALAC_ENCODER_H_
+
+/*----------------------------------------------------------------------
+|   includes
++---------------------------------------------------------------------*/
+#include "BltTypes.h"
+
+/*----------------------------------------------------------------------
+|   constants
++---------------------------------------------------------------------*/
+#define BLT_ALAC_ENCODER_MAX_FRAME_LENGTH  4096
+
+/* stream parameters, in the order of the fmtp line */
+#define BLT_ALAC_ENCODER_BIT_DEPTH         16
+#define BLT_ALAC_ENCODER_RICE_HISTORY_MULT 40  /* pb */
+#define BLT_ALAC_ENCODER_INITIAL_HISTORY   10  /* mb */
+#define BLT_ALAC_ENCODER_RICE_LIMIT        14  /* kb */
+#define BLT_ALAC_ENCODER_CHANNEL_COUNT     2
+#define BLT_ALAC_ENCODER_MAX_RUN           255
+
+/*----------------------------------------------------------------------
+|   types
++---------------------------------------------------------------------*/
+typedef struct BLT_AlacEncoder BLT_AlacEncoder;
+
+/*----------------------------------------------------------------------
+|   prototypes
++---------------------------------------------------------------------*/
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/**
+ * Create an encoder.
+ * @param frame_length Maximum number of frames per ALAC frame, at most
+ * BLT_ALAC_ENCODER_MAX_FRAME_LENGTH.
+ * @param compress If false, every frame is stored uncompressed, for
+ * receivers that can't keep up with decoding.
+ */
+BLT_Result BLT_AlacEncoder_Create(BLT_Cardinal      frame_length,
+                                  BLT_Boolean       compress,
+                                  BLT_AlacEncoder** encoder);
+
+void BLT_AlacEncoder_Destroy(BLT_AlacEncoder* self);
+
+/**
+ * Forget the predictor state carried from frame to frame, for example
+ * after a seek.
+ */
+void BLT_AlacEncoder_Reset(BLT_AlacEncoder* self);
+
+/**
+ * Size of the largest frame the encoder can produce, which is the size
+ * of an uncompressed frame of frame_length frames.
+ */
+BLT_Size BLT_AlacEncoder_GetMaxFrameSize(const BLT_AlacEncoder* self);
+
+/**
+ * Encode one ALAC frame.
+ * @param samples Interleaved stereo samples, in native byte order.
+ * @param frame_count Number of stereo frames, at most the frame length
+ * of the encoder. Shorter frames carry their size.
+ * @param frame Buffer of at least BLT_AlacEncoder_GetMaxFrameSize bytes.
+ * @return The size of the encoded frame, in bytes.
+ */
+BLT_Size BLT_AlacEncoder_EncodeFrame(BLT_AlacEncoder* self,
+                                     const BLT_Int16* samples,
+                                     BLT_Cardinal     frame_count,
+                                     BLT_UInt8*       frame);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* _BLT_ALAC_ENCODER_H_ */
@@ -156,9 +156,25 @@ BLT_Builtins_RegisterModules(BLT_Core* core)
     BLT_REGISTER_BUILTIN(GainControlFilter)
 #endif
 
+#if defined(BLT_CONFIG_MODULES_ENABLE_LIMITER_FILTER)
+    BLT_REGISTER_BUILTIN(LimiterFilter)
+#endif
+#if defined(BLT_CONFIG_MODULES_ENABLE_LOUDNESS_ANALYZER_FILTER)
+    BLT_REGISTER_BUILTIN(LoudnessAnalyzerFilter)
+#endif
+
 #if defined(BLT_CONFIG_MODULES_ENABLE_FINGERPRINT_FILTER)
     BLT_REGISTER_BUILTIN(FingerprintFilter)
 #endif
+#if defined(BLT_CONFIG_MODULES_ENABLE_EQUALIZER_FILTER)
+    BLT_REGISTER_BUILTIN(EqualizerFilter)
+#endif
+#if defined(BLT_CONFIG_MODULES_ENABLE_ANALYSIS_TAP_FILTER)
+    BLT_REGISTER_BUILTIN(AnalysisTapFilter)
+#endif
+#if defined(BLT_CONFIG_MODULES_ENABLE_TIME_STRETCH_FILTER)
+    BLT_REGISTER_BUILTIN(TimeStretchFilter)
+#endif
 
 #if defined(BLT_CONFIG_MODULES_ENABLE_FILTER_HOST)
     BLT_REGISTER_BUILTIN(FilterHost)
@@ -248,6 +264,10 @@ BLT_Builtins_RegisterModules(BLT_Core* core)
     BLT_REGISTER_BUILTIN(RaopOutput)
 #endif
 
+#if defined(BLT_CONFIG_MODULES_ENABLE_TEE_OUTPUT)
+    BLT_REGISTER_BUILTIN(TeeOutput)
+#endif
+
 #if defined(BLT_CONFIG_MODULES_ENABLE_OSX_AUDIO_UNITS_OUTPUT)
     BLT_REGISTER_BUILTIN(OsxAudioUnitsOutput)
 #endif
@@ -280,6 +300,10 @@ BLT_Builtins_RegisterModules(BLT_Core* core)
     BLT_REGISTER_BUILTIN(NullOutput)
 #endif
 
+#if defined(BLT_CONFIG_MODULES_ENABLE_CALLBACK_OUTPUT)
+    BLT_REGISTER_BUILTIN(CallbackOutput)
+#endif
+
     return BLT_SUCCESS;
 }
 
@@ -0,0 +1,209 @@
+/*****************************************************************
+|
+|   BlueTune - Cross Fading
+|
+|   (c) 2002-2012 Gilles Boccon-Gibod
+|   Author: Gilles Boccon-Gibod (bok@bok.net)
+|
+ ****************************************************************/
+
+/*----------------------------------------------------------------------
+|   includes
++---------------------------------------------------------------------*/
+#include <math.h>
+
+#include "Atomix.h"
+#include "BltTypes.h"
+#include "BltSimd.h"
+#include "BltCrossFade.h"
+
+/*----------------------------------------------------------------------
+|   constants
++---------------------------------------------------------------------*/
+#define BLT_CROSS_FADE_HALF_PI 1.57079632679489661923
+
+/*----------------------------------------------------------------------
+|   BLT_CrossFade_ComputeGains
++---------------------------------------------------------------------*/
+void
+BLT_CrossFade_ComputeGains(BLT_CrossFadeCurve curve,
+                           float*             gains,
+                           BLT_Cardinal       frame_count)
+{
+    BLT_Ordinal i;
+
+    /* the gains are sampled in the middle of each frame, so that the */
+    /* table is exactly symmetric: gains[i]^2+gains[n-1-i]^2 = 1 for  */
+    /* the constant power curves, gains[i]+gains[n-1-i] = 1 otherwise */
+    for (i=0; i<frame_count; i++) {
+        double x = ((double)i+0.5)/(double)frame_count;
+        switch (curve) {
+            case BLT_CROSS_FADE_CURVE_SQUARE_ROOT:
+                gains[i] = (float)sqrt(x);
+                break;
+
+            case BLT_CROSS_FADE_CURVE_LINEAR:
+                gains[i] = (float)x;
+                break;
+
+            default:
+                gains[i] = (float)sin(BLT_CROSS_FADE_HALF_PI*x);
+                break;
+        }
+    }
+}
+
+/*----------------------------------------------------------------------
+|   BLT_CrossFade_Mix
+|
+|   With SSE2 or NEON, mono is mixed 4 frames at a time, with the fade
+|   out gains reversed in the register, stereo 2 frames at a time, and
+|   other layouts 4 channels of a frame at a time. The products are
+|   added as in the scalar loops, so the results are the same.
++---------------------------------------------------------------------*/
+void
+BLT_CrossFade_Mix(float*       out,
+                  const float* in,
+                  const float* gains,
+                  BLT_Cardinal frame_count,
+                  BLT_Cardinal channel_count)
+{
+    BLT_Ordinal i = 0;
+    BLT_Ordinal c;
+
+    switch (channel_count) {
+        case 1:
+#if defined(BLT_SIMD_SSE2)
+            for (; i+4<=frame_count; i += 4) {
+                __m128 g_out = _mm_loadu_ps(gains+frame_count-4-i);
+                g_out = _mm_shuffle_ps(g_out, g_out, _MM_SHUFFLE(0,1,2,3));
+                _mm_storeu_ps(out+i, _mm_add_ps(_mm_mul_ps(_mm_loadu_ps(out+i), g_out),
+                                                _mm_mul_ps(_mm_loadu_ps(in+i), _mm_loadu_ps(gains+i))));
+            }
+#elif defined(BLT_SIMD_NEON)
+            for (; i+4<=frame_count; i += 4) {
+                float32x4_t g_out = vld1q_f32(gains+frame_count-4-i);
+                g_out = vrev64q_f32(vcombine_f32(vget_high_f32(g_out), vget_low_f32(g_out)));
+                vst1q_f32(out+i, vaddq_f32(vmulq_f32(vld1q_f32(out+i), g_out),
+                                           vmulq_f32(vld1q_f32(in+i), vld1q_f32(gains+i))));
+            }
+#endif
+            for (; i<frame_count; i++) {
+                out[i] = out[i]*gains[frame_count-1-i]+in[i]*gains[i];
+            }
+            break;
+
+        case 2:
+#if defined(BLT_SIMD_SSE2)
+            for (; i+2<=frame_count; i += 2) {
+                __m128 g_out = _mm_loadl_pi(_mm_setzero_ps(), (const __m64*)(gains+frame_count-2-i));
+                __m128 g_in  = _mm_loadl_pi(_mm_setzero_ps(), (const __m64*)(gains+i));
+                g_out = _mm_shuffle_ps(g_out, g_out, _MM_SHUFFLE(0,0,1,1));
+                g_in  = _mm_unpacklo_ps(g_in, g_in);
+                _mm_storeu_ps(out+2*i, _mm_add_ps(_mm_mul_ps(_mm_loadu_ps(out+2*i), g_out),
+                                                  _mm_mul_ps(_mm_loadu_ps(in+2*i), g_in)));
+            }
+#elif defined(BLT_SIMD_NEON)
+            for (; i+2<=frame_count; i += 2) {
+                float32x2_t g_out = vld1_f32(gains+frame_count-2-i);
+                float32x2_t g_in  = vld1_f32(gains+i);
+                vst1q_f32(out+2*i,
+                          vaddq_f32(vmulq_f32(vld1q_f32(out+2*i),
+                                              vcombine_f32(vdup_lane_f32(g_out, 1), vdup_lane_f32(g_out, 0))),
+                                    vmulq_f32(vld1q_f32(in+2*i),
+                                              vcombine_f32(vdup_lane_f32(g_in, 0), vdup_lane_f32(g_in, 1)))));
+            }
+#endif
+            for (; i<frame_count; i++) {
+                float g_out = gains[frame_count-1-i];
+                float g_in  = gains[i];
+                out[2*i  ] = out[2*i  ]*g_out+in[2*i  ]*g_in;
+                out[2*i+1] = out[2*i+1]*g_out+in[2*i+1]*g_in;
+            }
+            break;
+
+        default:
+            for (; i<frame_count; i++) {
+                float g_out = gains[frame_count-1-i];
+                float g_in  = gains[i];
+                c = 0;
+#if defined(BLT_SIMD_SSE2)
+                {
+                    __m128 v_out = _mm_set1_ps(g_out);
+                    __m128 v_in  = _mm_set1_ps(g_in);
+                    for (; c+4<=channel_count; c += 4) {
+                        _mm_storeu_ps(out+c, _mm_add_ps(_mm_mul_ps(_mm_loadu_ps(out+c), v_out),
+                                                        _mm_mul_ps(_mm_loadu_ps(in+c), v_in)));
+                    }
+                }
+#elif defined(BLT_SIMD_NEON)
+                for (; c+4<=channel_count; c += 4) {
+                    vst1q_f32(out+c, vaddq_f32(vmulq_n_f32(vld1q_f32(out+c), g_out),
+                                               vmulq_n_f32(vld1q_f32(in+c), g_in)));
+                }
+#endif
+                for (; c<channel_count; c++) {
+                    out[c] = out[c]*g_out+in[c]*g_in;
+                }
+                out += channel_count;
+                in  += channel_count;
+            }
+            break;
+    }
+}
+
+/*----------------------------------------------------------------------
+|   BLT_CrossFade_IsSilentFrame
++---------------------------------------------------------------------*/
+static BLT_Boolean
+BLT_CrossFade_IsSilentFrame(const float* frame,
+                            BLT_Cardinal channel_count,
+                            float        threshold)
+{
+    BLT_Ordinal c;
+
+    for (c=0; c<channel_count; c++) {
+        if (frame[c] >= threshold || frame[c] <= -threshold) return BLT_FALSE;
+    }
+    return BLT_TRUE;
+}
+
+/*----------------------------------------------------------------------
+|   BLT_CrossFade_GetLeadingSilence
++---------------------------------------------------------------------*/
+BLT_Cardinal
+BLT_CrossFade_GetLeadingSilence(const float* samples,
+                                BLT_Cardinal frame_count,
+                                BLT_Cardinal channel_count,
+                                float        threshold)
+{
+    BLT_Cardinal silence = 0;
+
+    while (silence < frame_count &&
+           BLT_CrossFade_IsSilentFrame(samples+silence*channel_count,
+                                       channel_count,
+                                       threshold)) {
+        ++silence;
+    }
+    return silence;
+}
+
+/*----------------------------------------------------------------------
+|   BLT_CrossFade_GetTrailingSilence
++---------------------------------------------------------------------*/
+BLT_Cardinal
+BLT_CrossFade_GetTrailingSilence(const float* samples,
+                                 BLT_Cardinal frame_count,
+                                 BLT_Cardinal channel_count,
+                                 float        threshold)
+{
+    BLT_Cardinal silence = 0;
+
+    while (silence < frame_count &&
+           BLT_CrossFade_IsSilentFrame(samples+(frame_count-1-silence)*channel_count,
+                                       channel_count,
+                                       threshold)) {
+        ++silence;
+    }
+    return silence;
+}
@@ -0,0 +1,122 @@
+/*****************************************************************
+|
+|   BlueTune - Cross Fading
+|
+|   (c) 2002-2012 Gilles Boccon-Gibod
+|   Author: Gilles Boccon-Gibod (bok@bok.net)
+|
+ ****************************************************************/
+/** @file
+ * Mixing of the end of one track with the start of the next one.
+ * The gain curves are symmetric: the fade out gain of a frame is the
+ * fade in gain of the frame at the same distance from the other end,
+ * so the same table serves both tracks.
+ * The cross fader module (see BltCrossFader.h) and the player share
+ * the names defined here.
+ */
+
+#ifndef _BLT_CROSS_FADE_H_
+#define _BLT_CROSS_FADE_H_
+
+/*----------------------------------------------------------------------
+|   includes
++---------------------------------------------------------------------*/
+#include "BltTypes.h"
+
+/*----------------------------------------------------------------------
+|   constants
++---------------------------------------------------------------------*/
+#define BLT_CROSS_FADER_MODULE_NAME "com.axiosys.general.cross-fader"
+
+/**
+ * Core property: pointer to a BLT_PacketProducer that produces the PCM
+ * packets of the track that follows the one that is playing, or NULL.
+ * The object must remain valid for as long as the cross fader exists.
+ * Removing the property also stops the cross fader from playing a next
+ * track that has already started.
+ */
+#define BLT_CROSS_FADER_NEXT_SOURCE       "Plugins.CrossFader.NextSource"
+
+/**
+ * Core property: length of the cross fade, in milliseconds (integer).
+ * Defaults to BLT_CROSS_FADE_DEFAULT_DURATION. 0 joins the tracks
+ * without overlapping them.
+ */
+#define BLT_CROSS_FADER_DURATION          "Plugins.CrossFader.Duration"
+
+/**
+ * Core property: shape of the fade (integer, one of BLT_CrossFadeCurve).
+ */
+#define BLT_CROSS_FADER_CURVE             "Plugins.CrossFader.Curve"
+
+/**
+ * Core property: level, in dBFS (integer), under which the audio at
+ * the end of a track and at the start of the next one is treated as
+ * silence, and left out of the overlap.
+ */
+#define BLT_CROSS_FADER_SILENCE_THRESHOLD "Plugins.CrossFader.SilenceThreshold"
+
+#define BLT_CROSS_FADE_DEFAULT_DURATION          5000  /* ms   */
+#define BLT_CROSS_FADE_MAX_DURATION              12000 /* ms   */
+#define BLT_CROSS_FADE_DEFAULT_SILENCE_THRESHOLD (-60) /* dBFS */
+#define BLT_CROSS_FADE_MIN_SILENCE_THRESHOLD     (-144)
+#define BLT_CROSS_FADE_MAX_SILENCE_THRESHOLD     (-20)
+#define BLT_CROSS_FADE_MAX_CHANNELS              8
+
+/*----------------------------------------------------------------------
+|   types
++---------------------------------------------------------------------*/
+typedef enum {
+    BLT_CROSS_FADE_CURVE_EQUAL_POWER, /**< sin/cos: constant power, the default */
+    BLT_CROSS_FADE_CURVE_SQUARE_ROOT, /**< sqrt: constant power, faster onset   */
+    BLT_CROSS_FADE_CURVE_LINEAR       /**< constant gain, for correlated tracks */
+} BLT_CrossFadeCurve;
+
+/*----------------------------------------------------------------------
+|   prototypes
++---------------------------------------------------------------------*/
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/**
+ * Fill a table with the fade in gains of a fade of frame_count frames.
+ * The fade out gain of frame i is gains[frame_count-1-i].
+ */
+void BLT_CrossFade_ComputeGains(BLT_CrossFadeCurve curve,
+                                float*             gains,
+                                BLT_Cardinal       frame_count);
+
+/**
+ * Mix two runs of interleaved samples:
+ * out[i] = out[i]*gains[frame_count-1-i] + in[i]*gains[i]
+ */
+void BLT_CrossFade_Mix(float*       out,
+                       const float* in,
+                       const float* gains,
+                       BLT_Cardinal frame_count,
+                       BLT_Cardinal channel_count);
+
+/**
+ * Number of frames at the start of a run of samples in which no sample
+ * reaches the threshold (a linear level).
+ */
+BLT_Cardinal BLT_CrossFade_GetLeadingSilence(const float* samples,
+                                             BLT_Cardinal frame_count,
+                                             BLT_Cardinal channel_count,
+                                             float        threshold);
+
+/**
+ * Number of frames at the end of a run of samples in which no sample
+ * reaches the threshold (a linear level).
+ */
+BLT_Cardinal BLT_CrossFade_GetTrailingSilence(const float* samples,
+                                              BLT_Cardinal frame_count,
+                                              BLT_Cardinal channel_count,
+                                              float        threshold);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* _BLT_CROSS_FADE_H_ */
@@ -0,0 +1,560 @@
+/*****************************************************************
+|
+|   BlueTune - Parametric Equalizer
+|
+|   (c) 2002-2012 Gilles Boccon-Gibod
+|   Author: Gilles Boccon-Gibod (bok@bok.net)
+|
+ ****************************************************************/
+
+/*----------------------------------------------------------------------
+|   includes
++---------------------------------------------------------------------*/
+#include <math.h>
+
+#include "Atomix.h"
+#include "BltTypes.h"
+#include "BltErrors.h"
+#include "BltSimd.h"
+#include "BltEqualizer.h"
+
+/*----------------------------------------------------------------------
+|   constants
++---------------------------------------------------------------------*/
+#define BLT_EQUALIZER_PI             3.14159265358979323846
+#define BLT_EQUALIZER_DENORMAL_LIMIT 1e-20f
+
+/* keep the corner frequencies away from Nyquist */
+#define BLT_EQUALIZER_MAX_RELATIVE_FREQUENCY 0.45
+
+static const BLT_BiquadCoefficients BLT_Equalizer_Identity = {
+    1.0f, 0.0f, 0.0f, 0.0f, 0.0f
+};
+
+/*----------------------------------------------------------------------
+|   BLT_Equalizer_Init
++---------------------------------------------------------------------*/
+BLT_Result
+BLT_Equalizer_Init(BLT_Equalizer* self,
+                   BLT_Cardinal   sample_rate,
+                   BLT_Cardinal   channel_count)
+{
+    ATX_SetMemory(self, 0, sizeof(*self));
+    if (channel_count == 0 || channel_count > BLT_EQUALIZER_MAX_CHANNELS ||
+        sample_rate == 0) {
+        return BLT_ERROR_NOT_SUPPORTED;
+    }
+    self->sample_rate   = sample_rate;
+    self->channel_count = channel_count;
+    self->gain          = 1.0f;
+    self->target_gain   = 1.0f;
+
+    return BLT_SUCCESS;
+}
+
+/*----------------------------------------------------------------------
+|   BLT_Equalizer_Reset
++---------------------------------------------------------------------*/
+void
+BLT_Equalizer_Reset(BLT_Equalizer* self)
+{
+    BLT_Ordinal b;
+
+    ATX_SetMemory(self->z1, 0, sizeof(self->z1));
+    ATX_SetMemory(self->z2, 0, sizeof(self->z2));
+    for (b=0; b<BLT_EQUALIZER_MAX_BANDS; b++) {
+        self->current[b] = self->target[b];
+    }
+    self->band_count = self->target_band_count;
+    self->gain       = self->target_gain;
+    self->ramp       = 0;
+}
+
+/*----------------------------------------------------------------------
+|   BLT_Equalizer_ComputeCoefficients
++---------------------------------------------------------------------*/
+static void
+BLT_Equalizer_ComputeCoefficients(const BLT_EqualizerBand* band,
+                                  BLT_Cardinal             sample_rate,
+                                  BLT_BiquadCoefficients*  c)
+{
+    double frequency = band->frequency;
+    double gain      = band->gain;
+    double q         = band->q;
+    double max_frequency = BLT_EQUALIZER_MAX_RELATIVE_FREQUENCY*(double)sample_rate;
+    double w0, cos_w0, alpha, a, sqrt_a;
+    double b0, b1, b2, a0, a1, a2;
+
+    /* clamp the parameters */
+    if (frequency > max_frequency) frequency = max_frequency;
+    if (frequency < BLT_EQUALIZER_MIN_FREQUENCY) frequency = BLT_EQUALIZER_MIN_FREQUENCY;
+    if (gain >  BLT_EQUALIZER_MAX_GAIN) gain =  BLT_EQUALIZER_MAX_GAIN;
+    if (gain < -BLT_EQUALIZER_MAX_GAIN) gain = -BLT_EQUALIZER_MAX_GAIN;
+    if (!(q >= BLT_EQUALIZER_MIN_Q)) q = BLT_EQUALIZER_MIN_Q;
+    if (q > BLT_EQUALIZER_MAX_Q) q = BLT_EQUALIZER_MAX_Q;
+
+    /* a band with no gain does nothing, don't spend time on it */
+    if (gain == 0.0 && (band->type == BLT_EQUALIZER_BAND_PEAK       ||
+                        band->type == BLT_EQUALIZER_BAND_LOW_SHELF  ||
+                        band->type == BLT_EQUALIZER_BAND_HIGH_SHELF)) {
+        *c = BLT_Equalizer_Identity;
+        return;
+    }
+
+    w0     = 2.0*BLT_EQUALIZER_PI*frequency/(double)sample_rate;
+    cos_w0 = cos(w0);
+    alpha  = sin(w0)/(2.0*q);
+    a      = pow(10.0, gain/40.0);
+    sqrt_a = sqrt(a);
+
+    switch (band->type) {
+        case BLT_EQUALIZER_BAND_LOW_SHELF:
+            b0 =      a*((a+1.0) - (a-1.0)*cos_w0 + 2.0*sqrt_a*alpha);
+            b1 =  2.0*a*((a-1.0) - (a+1.0)*cos_w0);
+            b2 =      a*((a+1.0) - (a-1.0)*cos_w0 - 2.0*sqrt_a*alpha);
+            a0 =         (a+1.0) + (a-1.0)*cos_w0 + 2.0*sqrt_a*alpha;
+            a1 =   -2.0*((a-1.0) + (a+1.0)*cos_w0);
+            a2 =         (a+1.0) + (a-1.0)*cos_w0 - 2.0*sqrt_a*alpha;
+            break;
+
+        case BLT_EQUALIZER_BAND_HIGH_SHELF:
+            b0 =      a*((a+1.0) + (a-1.0)*cos_w0 + 2.0*sqrt_a*alpha);
+            b1 = -2.0*a*((a-1.0) + (a+1.0)*cos_w0);
+            b2 =      a*((a+1.0) + (a-1.0)*cos_w0 - 2.0*sqrt_a*alpha);
+            a0 =         (a+1.0) - (a-1.0)*cos_w0 + 2.0*sqrt_a*alpha;
+            a1 =    2.0*((a-1.0) - (a+1.0)*cos_w0);
+            a2 =         (a+1.0) - (a-1.0)*cos_w0 - 2.0*sqrt_a*alpha;
+            break;
+
+        case BLT_EQUALIZER_BAND_LOW_PASS:
+            b0 = (1.0-cos_w0)/2.0;
+            b1 =  1.0-cos_w0;
+            b2 = (1.0-cos_w0)/2.0;
+            a0 =  1.0+alpha;
+            a1 = -2.0*cos_w0;
+            a2 =  1.0-alpha;
+            break;
+
+        case BLT_EQUALIZER_BAND_HIGH_PASS:
+            b0 =  (1.0+cos_w0)/2.0;
+            b1 = -(1.0+cos_w0);
+            b2 =  (1.0+cos_w0)/2.0;
+            a0 =   1.0+alpha;
+            a1 =  -2.0*cos_w0;
+            a2 =   1.0-alpha;
+            break;
+
+        default: /* BLT_EQUALIZER_BAND_PEAK */
+            b0 =  1.0+alpha*a;
+            b1 = -2.0*cos_w0;
+            b2 =  1.0-alpha*a;
+            a0 =  1.0+alpha/a;
+            a1 = -2.0*cos_w0;
+            a2 =  1.0-alpha/a;
+            break;
+    }
+
+    c->b0 = (float)(b0/a0);
+    c->b1 = (float)(b1/a0);
+    c->b2 = (float)(b2/a0);
+    c->a1 = (float)(a1/a0);
+    c->a2 = (float)(a2/a0);
+}
+
+/*----------------------------------------------------------------------
+|   BLT_Equalizer_SetBands
++---------------------------------------------------------------------*/
+void
+BLT_Equalizer_SetBands(BLT_Equalizer*           self,
+                       const BLT_EqualizerBand* bands,
+                       BLT_Cardinal             band_count,
+                       float                    gain,
+                       BLT_Boolean              ramp)
+{
+    BLT_Ordinal b;
+
+    if (band_count > BLT_EQUALIZER_MAX_BANDS) band_count = BLT_EQUALIZER_MAX_BANDS;
+    if (gain >  BLT_EQUALIZER_MAX_GAIN) gain =  BLT_EQUALIZER_MAX_GAIN;
+    if (gain < -BLT_EQUALIZER_MAX_GAIN) gain = -BLT_EQUALIZER_MAX_GAIN;
+
+    for (b=0; b<BLT_EQUALIZER_MAX_BANDS; b++) {
+        if (b < band_count) {
+            BLT_Equalizer_ComputeCoefficients(&bands[b], self->sample_rate, &self->target[b]);
+        } else {
+            self->target[b] = BLT_Equalizer_Identity;
+        }
+    }
+    self->target_band_count = band_count;
+    self->target_gain       = (float)pow(10.0, gain/20.0);
+
+    if (!ramp) {
+        /* the states of the bands that stay are still valid */
+        for (b=band_count; b<BLT_EQUALIZER_MAX_BANDS; b++) {
+            ATX_SetMemory(self->z1[b], 0, sizeof(self->z1[b]));
+            ATX_SetMemory(self->z2[b], 0, sizeof(self->z2[b]));
+        }
+        for (b=0; b<BLT_EQUALIZER_MAX_BANDS; b++) {
+            self->current[b] = self->target[b];
+        }
+        self->band_count = band_count;
+        self->gain       = self->target_gain;
+        self->ramp       = 0;
+        return;
+    }
+
+    /* new bands start from a pass-through with no history */
+    for (b=self->band_count; b<band_count; b++) {
+        self->current[b] = BLT_Equalizer_Identity;
+        ATX_SetMemory(self->z1[b], 0, sizeof(self->z1[b]));
+        ATX_SetMemory(self->z2[b], 0, sizeof(self->z2[b]));
+    }
+    if (band_count > self->band_count) self->band_count = band_count;
+
+    /* interpolating the coefficients linearly keeps every intermediate
+       filter stable, because the set of stable (a1,a2) pairs is convex */
+    for (b=0; b<self->band_count; b++) {
+        const BLT_BiquadCoefficients* from = &self->current[b];
+        const BLT_BiquadCoefficients* to   = &self->target[b];
+        BLT_BiquadCoefficients*       step = &self->step[b];
+        step->b0 = (to->b0-from->b0)/(float)BLT_EQUALIZER_RAMP_LENGTH;
+        step->b1 = (to->b1-from->b1)/(float)BLT_EQUALIZER_RAMP_LENGTH;
+        step->b2 = (to->b2-from->b2)/(float)BLT_EQUALIZER_RAMP_LENGTH;
+        step->a1 = (to->a1-from->a1)/(float)BLT_EQUALIZER_RAMP_LENGTH;
+        step->a2 = (to->a2-from->a2)/(float)BLT_EQUALIZER_RAMP_LENGTH;
+    }
+    self->gain_step = (self->target_gain-self->gain)/(float)BLT_EQUALIZER_RAMP_LENGTH;
+    self->ramp      = BLT_EQUALIZER_RAMP_LENGTH;
+}
+
+/*----------------------------------------------------------------------
+|   BLT_Equalizer_IsFlat
++---------------------------------------------------------------------*/
+BLT_Boolean
+BLT_Equalizer_IsFlat(const BLT_Equalizer* self)
+{
+    BLT_Ordinal b;
+
+    if (self->ramp || self->gain != 1.0f) return BLT_FALSE;
+    for (b=0; b<self->band_count; b++) {
+        const BLT_BiquadCoefficients* c = &self->current[b];
+        if (c->b0 != 1.0f || c->b1 != 0.0f || c->b2 != 0.0f ||
+            c->a1 != 0.0f || c->a2 != 0.0f) {
+            return BLT_FALSE;
+        }
+    }
+
+    return BLT_TRUE;
+}
+
+#if defined(BLT_SIMD_SSE2)
+/*----------------------------------------------------------------------
+|   BLT_Equalizer_LoadLanes: loads 1 to 4 samples, without reading past them
++---------------------------------------------------------------------*/
+static __m128
+BLT_Equalizer_LoadLanes(const float* samples, BLT_Cardinal lanes)
+{
+    switch (lanes) {
+        case 4:  return _mm_loadu_ps(samples);
+        case 3:  return _mm_movelh_ps(_mm_loadl_pi(_mm_setzero_ps(), (const __m64*)samples),
+                                      _mm_load_ss(samples+2));
+        case 2:  return _mm_loadl_pi(_mm_setzero_ps(), (const __m64*)samples);
+        default: return _mm_load_ss(samples);
+    }
+}
+
+/*----------------------------------------------------------------------
+|   BLT_Equalizer_StoreLanes
++---------------------------------------------------------------------*/
+static void
+BLT_Equalizer_StoreLanes(float* samples, __m128 values, BLT_Cardinal lanes)
+{
+    switch (lanes) {
+        case 4:  _mm_storeu_ps(samples, values); break;
+        case 3:  _mm_storel_pi((__m64*)samples, values);
+                 _mm_store_ss(samples+2, _mm_movehl_ps(values, values)); break;
+        case 2:  _mm_storel_pi((__m64*)samples, values); break;
+        default: _mm_store_ss(samples, values); break;
+    }
+}
+#elif defined(BLT_SIMD_NEON)
+/*----------------------------------------------------------------------
+|   BLT_Equalizer_LoadLanes: loads 1 to 4 samples, without reading past them
++---------------------------------------------------------------------*/
+static float32x4_t
+BLT_Equalizer_LoadLanes(const float* samples, BLT_Cardinal lanes)
+{
+    switch (lanes) {
+        case 4:  return vld1q_f32(samples);
+        case 3:  return vcombine_f32(vld1_f32(samples), vld1_dup_f32(samples+2));
+        case 2:  return vcombine_f32(vld1_f32(samples), vdup_n_f32(0.0f));
+        default: return vld1q_dup_f32(samples);
+    }
+}
+
+/*----------------------------------------------------------------------
+|   BLT_Equalizer_StoreLanes
++---------------------------------------------------------------------*/
+static void
+BLT_Equalizer_StoreLanes(float* samples, float32x4_t values, BLT_Cardinal lanes)
+{
+    switch (lanes) {
+        case 4:  vst1q_f32(samples, values); break;
+        case 3:  vst1_f32(samples, vget_low_f32(values));
+                 vst1q_lane_f32(samples+2, values, 2); break;
+        case 2:  vst1_f32(samples, vget_low_f32(values)); break;
+        default: vst1q_lane_f32(samples, values, 0); break;
+    }
+}
+#endif
+
+/*----------------------------------------------------------------------
+|   BLT_Equalizer_FilterBand
+|
+|   Transposed direct form II. The filter is recursive in time, but the
+|   channels are independent: with SSE2 or NEON, they are filtered in
+|   groups of up to 4, one channel per lane, with the states kept in
+|   registers for the whole buffer. Two groups go through the same frame
+|   loop, so that one does not wait on the other. The lanes do the
+|   operations of the scalar loop, in the same order.
++---------------------------------------------------------------------*/
+static void
+BLT_Equalizer_FilterBand(const BLT_BiquadCoefficients* c,
+                         float*                        z1,
+                         float*                        z2,
+                         float*                        samples,
+                         BLT_Cardinal                  frame_count,
+                         BLT_Cardinal                  channel_count)
+{
+    const float b0 = c->b0;
+    const float b1 = c->b1;
+    const float b2 = c->b2;
+    const float a1 = c->a1;
+    const float a2 = c->a2;
+    BLT_Ordinal i;
+
+#if defined(BLT_SIMD_SSE2)
+    const __m128 vb0 = _mm_set1_ps(b0);
+    const __m128 vb1 = _mm_set1_ps(b1);
+    const __m128 vb2 = _mm_set1_ps(b2);
+    const __m128 va1 = _mm_set1_ps(a1);
+    const __m128 va2 = _mm_set1_ps(a2);
+    BLT_Ordinal  first;
+
+    for (first=0; first<channel_count; first += 8) {
+        BLT_Cardinal left   = channel_count-first;
+        BLT_Cardinal lanes  = left < 4 ? left : 4;
+        BLT_Cardinal lanes2 = left > 8 ? 4 : left-lanes;
+        __m128       s1     = BLT_Equalizer_LoadLanes(z1+first, lanes);
+        __m128       s2     = BLT_Equalizer_LoadLanes(z2+first, lanes);
+        float*       frame  = samples+first;
+        if (lanes2 == 0) {
+            for (i=0; i<frame_count; i++, frame += channel_count) {
+                __m128 x = BLT_Equalizer_LoadLanes(frame, lanes);
+                __m128 y = _mm_add_ps(_mm_mul_ps(vb0, x), s1);
+                s1 = _mm_add_ps(_mm_sub_ps(_mm_mul_ps(vb1, x), _mm_mul_ps(va1, y)), s2);
+                s2 = _mm_sub_ps(_mm_mul_ps(vb2, x), _mm_mul_ps(va2, y));
+                BLT_Equalizer_StoreLanes(frame, y, lanes);
+            }
+        } else {
+            __m128 t1 = BLT_Equalizer_LoadLanes(z1+first+4, lanes2);
+            __m128 t2 = BLT_Equalizer_LoadLanes(z2+first+4, lanes2);
+            for (i=0; i<frame_count; i++, frame += channel_count) {
+                __m128 x = _mm_loadu_ps(frame);
+                __m128 u = BLT_Equalizer_LoadLanes(frame+4, lanes2);
+                __m128 y = _mm_add_ps(_mm_mul_ps(vb0, x), s1);
+                __m128 v = _mm_add_ps(_mm_mul_ps(vb0, u), t1);
+                s1 = _mm_add_ps(_mm_sub_ps(_mm_mul_ps(vb1, x), _mm_mul_ps(va1, y)), s2);
+                t1 = _mm_add_ps(_mm_sub_ps(_mm_mul_ps(vb1, u), _mm_mul_ps(va1, v)), t2);
+                s2 = _mm_sub_ps(_mm_mul_ps(vb2, x), _mm_mul_ps(va2, y));
+                t2 = _mm_sub_ps(_mm_mul_ps(vb2, u), _mm_mul_ps(va2, v));
+                _mm_storeu_ps(frame, y);
+                BLT_Equalizer_StoreLanes(frame+4, v, lanes2);
+            }
+            BLT_Equalizer_StoreLanes(z1+first+4, t1, lanes2);
+            BLT_Equalizer_StoreLanes(z2+first+4, t2, lanes2);
+        }
+        BLT_Equalizer_StoreLanes(z1+first, s1, lanes);
+        BLT_Equalizer_StoreLanes(z2+first, s2, lanes);
+    }
+#elif defined(BLT_SIMD_NEON)
+    BLT_Ordinal first;
+
+    for (first=0; first<channel_count; first += 8) {
+        BLT_Cardinal left   = channel_count-first;
+        BLT_Cardinal lanes  = left < 4 ? left : 4;
+        BLT_Cardinal lanes2 = left > 8 ? 4 : left-lanes;
+        float32x4_t  s1     = BLT_Equalizer_LoadLanes(z1+first, lanes);
+        float32x4_t  s2     = BLT_Equalizer_LoadLanes(z2+first, lanes);
+        float*       frame  = samples+first;
+        if (lanes2 == 0) {
+            for (i=0; i<frame_count; i++, frame += channel_count) {
+                float32x4_t x = BLT_Equalizer_LoadLanes(frame, lanes);
+                float32x4_t y = vaddq_f32(vmulq_n_f32(x, b0), s1);
+                s1 = vaddq_f32(vsubq_f32(vmulq_n_f32(x, b1), vmulq_n_f32(y, a1)), s2);
+                s2 = vsubq_f32(vmulq_n_f32(x, b2), vmulq_n_f32(y, a2));
+                BLT_Equalizer_StoreLanes(frame, y, lanes);
+            }
+        } else {
+            float32x4_t t1 = BLT_Equalizer_LoadLanes(z1+first+4, lanes2);
+            float32x4_t t2 = BLT_Equalizer_LoadLanes(z2+first+4, lanes2);
+            for (i=0; i<frame_count; i++, frame += channel_count) {
+                float32x4_t x = vld1q_f32(frame);
+                float32x4_t u = BLT_Equalizer_LoadLanes(frame+4, lanes2);
+                float32x4_t y = vaddq_f32(vmulq_n_f32(x, b0), s1);
+                float32x4_t v = vaddq_f32(vmulq_n_f32(u, b0), t1);
+                s1 = vaddq_f32(vsubq_f32(vmulq_n_f32(x, b1), vmulq_n_f32(y, a1)), s2);
+                t1 = vaddq_f32(vsubq_f32(vmulq_n_f32(u, b1), vmulq_n_f32(v, a1)), t2);
+                s2 = vsubq_f32(vmulq_n_f32(x, b2), vmulq_n_f32(y, a2));
+                t2 = vsubq_f32(vmulq_n_f32(u, b2), vmulq_n_f32(v, a2));
+                vst1q_f32(frame, y);
+                BLT_Equalizer_StoreLanes(frame+4, v, lanes2);
+            }
+            BLT_Equalizer_StoreLanes(z1+first+4, t1, lanes2);
+            BLT_Equalizer_StoreLanes(z2+first+4, t2, lanes2);
+        }
+        BLT_Equalizer_StoreLanes(z1+first, s1, lanes);
+        BLT_Equalizer_StoreLanes(z2+first, s2, lanes);
+    }
+#else
+    BLT_Ordinal ch;
+
+    for (i=0; i<frame_count; i++) {
+        float* frame = samples+i*channel_count;
+        for (ch=0; ch<channel_count; ch++) {
+            float x = frame[ch];
+            float y = b0*x + z1[ch];
+            z1[ch]  = b1*x - a1*y + z2[ch];
+            z2[ch]  = b2*x - a2*y;
+            frame[ch] = y;
+        }
+    }
+#endif
+}
+
+/*----------------------------------------------------------------------
+|   BLT_Equalizer_FilterBandWithRamp
++---------------------------------------------------------------------*/
+static void
+BLT_Equalizer_FilterBandWithRamp(BLT_BiquadCoefficients*       c,
+                                 const BLT_BiquadCoefficients* step,
+                                 float*                        z1,
+                                 float*                        z2,
+                                 float*                        samples,
+                                 BLT_Cardinal                  frame_count,
+                                 BLT_Cardinal                  channel_count)
+{
+    float       b0 = c->b0;
+    float       b1 = c->b1;
+    float       b2 = c->b2;
+    float       a1 = c->a1;
+    float       a2 = c->a2;
+    BLT_Ordinal i;
+    BLT_Ordinal ch;
+
+    for (i=0; i<frame_count; i++) {
+        float* frame = samples+i*channel_count;
+        b0 += step->b0;
+        b1 += step->b1;
+        b2 += step->b2;
+        a1 += step->a1;
+        a2 += step->a2;
+        for (ch=0; ch<channel_count; ch++) {
+            float x = frame[ch];
+            float y = b0*x + z1[ch];
+            z1[ch]  = b1*x - a1*y + z2[ch];
+            z2[ch]  = b2*x - a2*y;
+            frame[ch] = y;
+        }
+    }
+    c->b0 = b0;
+    c->b1 = b1;
+    c->b2 = b2;
+    c->a1 = a1;
+    c->a2 = a2;
+}
+
+/*----------------------------------------------------------------------
+|   BLT_Equalizer_Process
++---------------------------------------------------------------------*/
+void
+BLT_Equalizer_Process(BLT_Equalizer* self,
+                      float*         samples,
+                      BLT_Cardinal   frame_count)
+{
+    BLT_Cardinal channel_count = self->channel_count;
+    BLT_Ordinal  b;
+    BLT_Ordinal  i;
+
+    while (frame_count) {
+        BLT_Cardinal chunk = frame_count;
+        BLT_Cardinal sample_count;
+
+        if (self->ramp) {
+            /* move towards the target settings */
+            if (chunk > self->ramp) chunk = self->ramp;
+            sample_count = chunk*channel_count;
+            for (b=0; b<self->band_count; b++) {
+                BLT_Equalizer_FilterBandWithRamp(&self->current[b],
+                                                 &self->step[b],
+                                                 self->z1[b],
+                                                 self->z2[b],
+                                                 samples,
+                                                 chunk,
+                                                 channel_count);
+            }
+            for (i=0; i<sample_count; i += channel_count) {
+                BLT_Ordinal ch;
+                self->gain += self->gain_step;
+                for (ch=0; ch<channel_count; ch++) {
+                    samples[i+ch] *= self->gain;
+                }
+            }
+            self->ramp -= chunk;
+            if (self->ramp == 0) {
+                /* land exactly on the target, and drop the bands that are gone */
+                for (b=0; b<BLT_EQUALIZER_MAX_BANDS; b++) {
+                    self->current[b] = self->target[b];
+                }
+                for (b=self->target_band_count; b<self->band_count; b++) {
+                    ATX_SetMemory(self->z1[b], 0, sizeof(self->z1[b]));
+                    ATX_SetMemory(self->z2[b], 0, sizeof(self->z2[b]));
+                }
+                self->band_count = self->target_band_count;
+                self->gain       = self->target_gain;
+            }
+        } else {
+            float gain = self->gain;
+            sample_count = chunk*channel_count;
+            for (b=0; b<self->band_count; b++) {
+                const BLT_BiquadCoefficients* c = &self->current[b];
+                if (c->b0 == 1.0f && c->b1 == 0.0f && c->b2 == 0.0f &&
+                    c->a1 == 0.0f && c->a2 == 0.0f) {
+                    continue;
+                }
+                BLT_Equalizer_FilterBand(c,
+                                         self->z1[b],
+                                         self->z2[b],
+                                         samples,
+                                         chunk,
+                                         channel_count);
+            }
+            if (gain != 1.0f) {
+                for (i=0; i<sample_count; i++) {
+                    samples[i] *= gain;
+                }
+            }
+        }
+
+        samples     += sample_count;
+        frame_count -= chunk;
+    }
+
+    /* don't let the filters decay into denormals during silence */
+    for (b=0; b<self->band_count; b++) {
+        BLT_Ordinal ch;
+        for (ch=0; ch<channel_count; ch++) {
+            if (fabs(self->z1[b][ch]) < BLT_EQUALIZER_DENORMAL_LIMIT) self->z1[b][ch] = 0.0f;
+            if (fabs(self->z2[b][ch]) < BLT_EQUALIZER_DENORMAL_LIMIT) self->z2[b][ch] = 0.0f;
+        }
+    }
+}
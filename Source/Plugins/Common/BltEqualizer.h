@@ -0,0 +1,128 @@
+/*****************************************************************
+|
+|   BlueTune - Parametric Equalizer
+|
+|   (c) 2002-2012 Gilles Boccon-Gibod
+|   Author: Gilles Boccon-Gibod (bok@bok.net)
+|
+ ****************************************************************/
+/** @file
+ * Parametric equalizer: a cascade of biquad filters (RBJ audio EQ
+ * cookbook) applied to each channel of interleaved float samples.
+ * When the bands change, the filter coefficients move to their new
+ * values over BLT_EQUALIZER_RAMP_LENGTH frames, so that changes made
+ * while the audio plays do not click.
+ */
+
+#ifndef _BLT_EQUALIZER_H_
+#define _BLT_EQUALIZER_H_
+
+/*----------------------------------------------------------------------
+|   includes
++---------------------------------------------------------------------*/
+#include "BltTypes.h"
+
+/*----------------------------------------------------------------------
+|   constants
++---------------------------------------------------------------------*/
+#define BLT_EQUALIZER_MAX_BANDS    16
+#define BLT_EQUALIZER_MAX_CHANNELS 8
+#define BLT_EQUALIZER_RAMP_LENGTH  256 /* frames */
+
+#define BLT_EQUALIZER_MIN_FREQUENCY 10.0f   /* Hz  */
+#define BLT_EQUALIZER_MAX_GAIN      24.0f   /* dB  */
+#define BLT_EQUALIZER_MIN_Q         0.1f
+#define BLT_EQUALIZER_MAX_Q         20.0f
+
+/*----------------------------------------------------------------------
+|   types
++---------------------------------------------------------------------*/
+typedef enum {
+    BLT_EQUALIZER_BAND_PEAK,
+    BLT_EQUALIZER_BAND_LOW_SHELF,
+    BLT_EQUALIZER_BAND_HIGH_SHELF,
+    BLT_EQUALIZER_BAND_LOW_PASS,
+    BLT_EQUALIZER_BAND_HIGH_PASS
+} BLT_EqualizerBandType;
+
+typedef struct {
+    BLT_EqualizerBandType type;
+    float                 frequency; /**< Center or corner frequency, in Hz    */
+    float                 gain;      /**< In dB, ignored by pass filters       */
+    float                 q;         /**< Quality factor (shelf slope for shelves) */
+} BLT_EqualizerBand;
+
+/* normalized biquad coefficients (a0 = 1) */
+typedef struct {
+    float b0, b1, b2, a1, a2;
+} BLT_BiquadCoefficients;
+
+typedef struct {
+    BLT_Cardinal           sample_rate;
+    BLT_Cardinal           channel_count;
+    BLT_Cardinal           band_count;        /* bands being processed */
+    BLT_Cardinal           target_band_count; /* bands after the ramp  */
+    BLT_Cardinal           ramp;              /* ramp frames left      */
+    float                  gain;
+    float                  gain_step;
+    float                  target_gain;
+    BLT_BiquadCoefficients current[BLT_EQUALIZER_MAX_BANDS];
+    BLT_BiquadCoefficients step[BLT_EQUALIZER_MAX_BANDS];
+    BLT_BiquadCoefficients target[BLT_EQUALIZER_MAX_BANDS];
+
+    /* filter states, per band, with the channels next to each other */
+    float                  z1[BLT_EQUALIZER_MAX_BANDS][BLT_EQUALIZER_MAX_CHANNELS];
+    float                  z2[BLT_EQUALIZER_MAX_BANDS][BLT_EQUALIZER_MAX_CHANNELS];
+} BLT_Equalizer;
+
+/*----------------------------------------------------------------------
+|   prototypes
++---------------------------------------------------------------------*/
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/**
+ * Initialize an equalizer with no bands.
+ * Returns BLT_ERROR_NOT_SUPPORTED if there are more than
+ * BLT_EQUALIZER_MAX_CHANNELS channels.
+ */
+BLT_Result BLT_Equalizer_Init(BLT_Equalizer* self,
+                              BLT_Cardinal   sample_rate,
+                              BLT_Cardinal   channel_count);
+
+/**
+ * Clear the filter states, and finish any ramp.
+ */
+void BLT_Equalizer_Reset(BLT_Equalizer* self);
+
+/**
+ * Set the bands, and a gain (in dB) applied after them.
+ * Frequencies, gains and Q values are clamped to the supported ranges,
+ * and only the first BLT_EQUALIZER_MAX_BANDS bands are used.
+ * @param ramp If BLT_TRUE, move from the current settings over
+ * BLT_EQUALIZER_RAMP_LENGTH frames, otherwise switch immediately.
+ */
+void BLT_Equalizer_SetBands(BLT_Equalizer*           self,
+                            const BLT_EqualizerBand* bands,
+                            BLT_Cardinal             band_count,
+                            float                    gain,
+                            BLT_Boolean              ramp);
+
+/**
+ * Returns BLT_TRUE if the equalizer leaves the audio unchanged.
+ */
+BLT_Boolean BLT_Equalizer_IsFlat(const BLT_Equalizer* self);
+
+/**
+ * Filter interleaved float samples in place.
+ */
+void BLT_Equalizer_Process(BLT_Equalizer* self,
+                           float*         samples,
+                           BLT_Cardinal   frame_count);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* _BLT_EQUALIZER_H_ */
@@ -0,0 +1,308 @@
+/*****************************************************************
+|
+|   BlueTune - Fast Fourier Transform
+|
+|   (c) 2002-2012 Gilles Boccon-Gibod
+|   Author: Gilles Boccon-Gibod (bok@bok.net)
+|
+ ****************************************************************/
+
+/*----------------------------------------------------------------------
+|   includes
++---------------------------------------------------------------------*/
+#include <math.h>
+
+#include "Atomix.h"
+#include "BltTypes.h"
+#include "BltErrors.h"
+#include "BltSimd.h"
+#include "BltFft.h"
+
+/*----------------------------------------------------------------------
+|   constants
++---------------------------------------------------------------------*/
+#define BLT_FFT_MIN_SIZE 4
+#define BLT_FFT_MAX_SIZE 65536
+#define BLT_FFT_PI       3.14159265358979323846
+
+/*----------------------------------------------------------------------
+|   types
++---------------------------------------------------------------------*/
+/* A real signal of size samples is transformed as a complex signal of */
+/* size/2 points (even samples in the real part, odd samples in the   */
+/* imaginary part), and the two interleaved spectra are then split.   */
+/* The complex data is kept in separate real and imaginary arrays, so */
+/* that the butterflies of a stage, from the third one on, can be done */
+/* 4 at a time with SSE2 or NEON.                                     */
+struct BLT_Fft {
+    BLT_Cardinal  size;
+    BLT_Cardinal  half;
+    BLT_Cardinal* reverse;     /* bit reversal permutation          */
+    float*        twiddles_r;  /* per stage twiddle factors, stored */
+    float*        twiddles_i;  /* at offset span-1                  */
+    float*        split_r;     /* twiddle factors of the final split */
+    float*        split_i;
+    float*        work_r;
+    float*        work_i;
+};
+
+/*----------------------------------------------------------------------
+|   BLT_Fft_Create
++---------------------------------------------------------------------*/
+BLT_Result
+BLT_Fft_Create(BLT_Cardinal size, BLT_Fft** fft)
+{
+    BLT_Fft*     self;
+    BLT_Cardinal half = size/2;
+    BLT_Cardinal bits = 0;
+    BLT_Cardinal span;
+    BLT_Cardinal i;
+
+    *fft = NULL;
+
+    /* check the size */
+    if (size < BLT_FFT_MIN_SIZE || size > BLT_FFT_MAX_SIZE || (size & (size-1))) {
+        return BLT_ERROR_INVALID_PARAMETERS;
+    }
+    while ((1U<<bits) < half) ++bits;
+
+    /* allocate the object and all its tables in one block */
+    self = (BLT_Fft*)ATX_AllocateZeroMemory(sizeof(BLT_Fft)+
+                                            half*sizeof(BLT_Cardinal)+
+                                            6*half*sizeof(float));
+    if (self == NULL) return BLT_ERROR_OUT_OF_MEMORY;
+    self->size       = size;
+    self->half       = half;
+    self->reverse    = (BLT_Cardinal*)(self+1);
+    self->twiddles_r = (float*)(self->reverse+half);
+    self->twiddles_i = self->twiddles_r+half;
+    self->split_r    = self->twiddles_i+half;
+    self->split_i    = self->split_r+half;
+    self->work_r     = self->split_i+half;
+    self->work_i     = self->work_r+half;
+
+    /* bit reversal */
+    for (i=0; i<half; i++) {
+        BLT_Cardinal reversed = 0;
+        BLT_Cardinal b;
+        for (b=0; b<bits; b++) {
+            if (i & (1U<<b)) reversed |= 1U<<(bits-1-b);
+        }
+        self->reverse[i] = reversed;
+    }
+
+    /* twiddle factors for the butterflies of each stage */
+    for (span=1; span<half; span <<= 1) {
+        for (i=0; i<span; i++) {
+            self->twiddles_r[span-1+i] = (float)cos(BLT_FFT_PI*(double)i/(double)span);
+            self->twiddles_i[span-1+i] = (float)-sin(BLT_FFT_PI*(double)i/(double)span);
+        }
+    }
+
+    /* twiddle factors for the final split */
+    for (i=0; i<half; i++) {
+        self->split_r[i] = (float)cos(2.0*BLT_FFT_PI*(double)i/(double)size);
+        self->split_i[i] = (float)-sin(2.0*BLT_FFT_PI*(double)i/(double)size);
+    }
+
+    *fft = self;
+    return BLT_SUCCESS;
+}
+
+/*----------------------------------------------------------------------
+|   BLT_Fft_Destroy
++---------------------------------------------------------------------*/
+void
+BLT_Fft_Destroy(BLT_Fft* self)
+{
+    if (self) ATX_FreeMemory(self);
+}
+
+/*----------------------------------------------------------------------
+|   BLT_Fft_Transform
++---------------------------------------------------------------------*/
+static void
+BLT_Fft_Transform(BLT_Fft* self, const float* samples)
+{
+    float*       work_r = self->work_r;
+    float*       work_i = self->work_i;
+    BLT_Cardinal half   = self->half;
+    BLT_Cardinal span;
+    BLT_Cardinal start;
+    BLT_Cardinal i;
+
+    /* load the samples as complex points, in bit reversed order */
+    for (i=0; i<half; i++) {
+        BLT_Cardinal reversed = self->reverse[i];
+        work_r[reversed] = samples[2*i];
+        work_i[reversed] = samples[2*i+1];
+    }
+
+    /* first stage: all the twiddle factors are 1 */
+    for (i=0; i<half; i+=2) {
+        float ar = work_r[i];
+        float ai = work_i[i];
+        float br = work_r[i+1];
+        float bi = work_i[i+1];
+        work_r[i]   = ar+br;
+        work_i[i]   = ai+bi;
+        work_r[i+1] = ar-br;
+        work_i[i+1] = ai-bi;
+    }
+
+    /* other stages */
+    for (span=2; span<half; span <<= 1) {
+        const float* twiddles_r = self->twiddles_r+span-1;
+        const float* twiddles_i = self->twiddles_i+span-1;
+        for (start=0; start<half; start += 2*span) {
+            float* a_r = work_r+start;
+            float* a_i = work_i+start;
+            float* b_r = a_r+span;
+            float* b_i = a_i+span;
+            i = 0;
+#if defined(BLT_SIMD_SSE2)
+            for (; i+4 <= span; i += 4) {
+                __m128 t_r = _mm_loadu_ps(twiddles_r+i);
+                __m128 t_i = _mm_loadu_ps(twiddles_i+i);
+                __m128 v_r = _mm_loadu_ps(b_r+i);
+                __m128 v_i = _mm_loadu_ps(b_i+i);
+                __m128 u_r = _mm_loadu_ps(a_r+i);
+                __m128 u_i = _mm_loadu_ps(a_i+i);
+                __m128 x_r = _mm_sub_ps(_mm_mul_ps(v_r, t_r), _mm_mul_ps(v_i, t_i));
+                __m128 x_i = _mm_add_ps(_mm_mul_ps(v_r, t_i), _mm_mul_ps(v_i, t_r));
+                _mm_storeu_ps(b_r+i, _mm_sub_ps(u_r, x_r));
+                _mm_storeu_ps(b_i+i, _mm_sub_ps(u_i, x_i));
+                _mm_storeu_ps(a_r+i, _mm_add_ps(u_r, x_r));
+                _mm_storeu_ps(a_i+i, _mm_add_ps(u_i, x_i));
+            }
+#elif defined(BLT_SIMD_NEON)
+            for (; i+4 <= span; i += 4) {
+                float32x4_t t_r = vld1q_f32(twiddles_r+i);
+                float32x4_t t_i = vld1q_f32(twiddles_i+i);
+                float32x4_t v_r = vld1q_f32(b_r+i);
+                float32x4_t v_i = vld1q_f32(b_i+i);
+                float32x4_t u_r = vld1q_f32(a_r+i);
+                float32x4_t u_i = vld1q_f32(a_i+i);
+                float32x4_t x_r = vsubq_f32(vmulq_f32(v_r, t_r), vmulq_f32(v_i, t_i));
+                float32x4_t x_i = vaddq_f32(vmulq_f32(v_r, t_i), vmulq_f32(v_i, t_r));
+                vst1q_f32(b_r+i, vsubq_f32(u_r, x_r));
+                vst1q_f32(b_i+i, vsubq_f32(u_i, x_i));
+                vst1q_f32(a_r+i, vaddq_f32(u_r, x_r));
+                vst1q_f32(a_i+i, vaddq_f32(u_i, x_i));
+            }
+#endif
+            for (; i<span; i++) {
+                float x_r = b_r[i]*twiddles_r[i]-b_i[i]*twiddles_i[i];
+                float x_i = b_r[i]*twiddles_i[i]+b_i[i]*twiddles_r[i];
+                b_r[i]  = a_r[i]-x_r;
+                b_i[i]  = a_i[i]-x_i;
+                a_r[i] += x_r;
+                a_i[i] += x_i;
+            }
+        }
+    }
+}
+
+/*----------------------------------------------------------------------
+|   BLT_Fft_Forward
++---------------------------------------------------------------------*/
+void
+BLT_Fft_Forward(BLT_Fft*     self,
+                const float* samples,
+                float*       real,
+                float*       imaginary)
+{
+    const float* work_r = self->work_r;
+    const float* work_i = self->work_i;
+    BLT_Cardinal half   = self->half;
+    BLT_Cardinal k;
+
+    BLT_Fft_Transform(self, samples);
+
+    /* split the spectra of the even and odd samples */
+    real[0]         = work_r[0]+work_i[0];
+    imaginary[0]    = 0.0f;
+    real[half]      = work_r[0]-work_i[0];
+    imaginary[half] = 0.0f;
+    for (k=1; k<half; k++) {
+        float even_r = 0.5f*(work_r[k]+work_r[half-k]);
+        float even_i = 0.5f*(work_i[k]-work_i[half-k]);
+        float odd_r  = 0.5f*(work_i[k]+work_i[half-k]);
+        float odd_i  = 0.5f*(work_r[half-k]-work_r[k]);
+        real[k]      = even_r+self->split_r[k]*odd_r-self->split_i[k]*odd_i;
+        imaginary[k] = even_i+self->split_r[k]*odd_i+self->split_i[k]*odd_r;
+    }
+}
+
+/*----------------------------------------------------------------------
+|   BLT_Fft_GetPowerSpectrum
++---------------------------------------------------------------------*/
+void
+BLT_Fft_GetPowerSpectrum(BLT_Fft*     self,
+                         const float* samples,
+                         float*       power)
+{
+    const float* work_r = self->work_r;
+    const float* work_i = self->work_i;
+    BLT_Cardinal half   = self->half;
+    BLT_Cardinal k;
+
+    BLT_Fft_Transform(self, samples);
+
+    power[0]    = (work_r[0]+work_i[0])*(work_r[0]+work_i[0]);
+    power[half] = (work_r[0]-work_i[0])*(work_r[0]-work_i[0]);
+    k = 1;
+
+    /* 4 bins at a time, with the mirrored points loaded in reverse */
+#if defined(BLT_SIMD_SSE2)
+    {
+        const __m128 one_half = _mm_set1_ps(0.5f);
+        for (; k+4 <= half; k += 4) {
+            __m128 p_r    = _mm_loadu_ps(work_r+k);
+            __m128 p_i    = _mm_loadu_ps(work_i+k);
+            __m128 q_r    = _mm_loadu_ps(work_r+half-k-3);
+            __m128 q_i    = _mm_loadu_ps(work_i+half-k-3);
+            __m128 s_r    = _mm_loadu_ps(self->split_r+k);
+            __m128 s_i    = _mm_loadu_ps(self->split_i+k);
+            __m128 even_r, even_i, odd_r, odd_i, x_r, x_i;
+            q_r    = _mm_shuffle_ps(q_r, q_r, _MM_SHUFFLE(0, 1, 2, 3));
+            q_i    = _mm_shuffle_ps(q_i, q_i, _MM_SHUFFLE(0, 1, 2, 3));
+            even_r = _mm_mul_ps(one_half, _mm_add_ps(p_r, q_r));
+            even_i = _mm_mul_ps(one_half, _mm_sub_ps(p_i, q_i));
+            odd_r  = _mm_mul_ps(one_half, _mm_add_ps(p_i, q_i));
+            odd_i  = _mm_mul_ps(one_half, _mm_sub_ps(q_r, p_r));
+            x_r    = _mm_sub_ps(_mm_add_ps(even_r, _mm_mul_ps(s_r, odd_r)), _mm_mul_ps(s_i, odd_i));
+            x_i    = _mm_add_ps(_mm_add_ps(even_i, _mm_mul_ps(s_r, odd_i)), _mm_mul_ps(s_i, odd_r));
+            _mm_storeu_ps(power+k, _mm_add_ps(_mm_mul_ps(x_r, x_r), _mm_mul_ps(x_i, x_i)));
+        }
+    }
+#elif defined(BLT_SIMD_NEON)
+    for (; k+4 <= half; k += 4) {
+        float32x4_t p_r = vld1q_f32(work_r+k);
+        float32x4_t p_i = vld1q_f32(work_i+k);
+        float32x4_t q_r = vld1q_f32(work_r+half-k-3);
+        float32x4_t q_i = vld1q_f32(work_i+half-k-3);
+        float32x4_t s_r = vld1q_f32(self->split_r+k);
+        float32x4_t s_i = vld1q_f32(self->split_i+k);
+        float32x4_t even_r, even_i, odd_r, odd_i, x_r, x_i;
+        q_r    = vrev64q_f32(vcombine_f32(vget_high_f32(q_r), vget_low_f32(q_r)));
+        q_i    = vrev64q_f32(vcombine_f32(vget_high_f32(q_i), vget_low_f32(q_i)));
+        even_r = vmulq_n_f32(vaddq_f32(p_r, q_r), 0.5f);
+        even_i = vmulq_n_f32(vsubq_f32(p_i, q_i), 0.5f);
+        odd_r  = vmulq_n_f32(vaddq_f32(p_i, q_i), 0.5f);
+        odd_i  = vmulq_n_f32(vsubq_f32(q_r, p_r), 0.5f);
+        x_r    = vsubq_f32(vaddq_f32(even_r, vmulq_f32(s_r, odd_r)), vmulq_f32(s_i, odd_i));
+        x_i    = vaddq_f32(vaddq_f32(even_i, vmulq_f32(s_r, odd_i)), vmulq_f32(s_i, odd_r));
+        vst1q_f32(power+k, vaddq_f32(vmulq_f32(x_r, x_r), vmulq_f32(x_i, x_i)));
+    }
+#endif
+    for (; k<half; k++) {
+        float even_r = 0.5f*(work_r[k]+work_r[half-k]);
+        float even_i = 0.5f*(work_i[k]-work_i[half-k]);
+        float odd_r  = 0.5f*(work_i[k]+work_i[half-k]);
+        float odd_i  = 0.5f*(work_r[half-k]-work_r[k]);
+        float x_r    = even_r+self->split_r[k]*odd_r-self->split_i[k]*odd_i;
+        float x_i    = even_i+self->split_r[k]*odd_i+self->split_i[k]*odd_r;
+        power[k] = x_r*x_r+x_i*x_i;
+    }
+}
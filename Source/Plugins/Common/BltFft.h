@@ -0,0 +1,66 @@
+/*****************************************************************
+|
+|   BlueTune - Fast Fourier Transform
+|
+|   (c) 2002-2012 Gilles Boccon-Gibod
+|   Author: Gilles Boccon-Gibod (bok@bok.net)
+|
+ ****************************************************************/
+/** @file
+ * Forward FFT of real signals, for spectral analysis.
+ */
+
+#ifndef _BLT_FFT_H_
+#define _BLT_FFT_H_
+
+/*----------------------------------------------------------------------
+|   includes
++---------------------------------------------------------------------*/
+#include "BltTypes.h"
+
+/*----------------------------------------------------------------------
+|   types
++---------------------------------------------------------------------*/
+typedef struct BLT_Fft BLT_Fft;
+
+/*----------------------------------------------------------------------
+|   prototypes
++---------------------------------------------------------------------*/
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/**
+ * Create a transform for a given size.
+ * @param size Number of real input samples. Must be a power of 2,
+ * between 4 and 65536.
+ */
+BLT_Result BLT_Fft_Create(BLT_Cardinal size, BLT_Fft** fft);
+
+void BLT_Fft_Destroy(BLT_Fft* self);
+
+/**
+ * Compute the spectrum of size real samples.
+ * The real and imaginary parts of the size/2+1 bins, from DC to the
+ * Nyquist frequency, are written to the real and imaginary arrays.
+ * A transform object uses internal scratch buffers, so it cannot be
+ * used by several threads at the same time.
+ */
+void BLT_Fft_Forward(BLT_Fft*     self,
+                     const float* samples,
+                     float*       real,
+                     float*       imaginary);
+
+/**
+ * Compute the power (squared magnitude) of the size/2+1 bins of the
+ * spectrum of size real samples.
+ */
+void BLT_Fft_GetPowerSpectrum(BLT_Fft*     self,
+                              const float* samples,
+                              float*       power);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* _BLT_FFT_H_ */
@@ -0,0 +1,417 @@
+/*****************************************************************
+|
+|   BlueTune - Audio Fingerprint
+|
+|   (c) 2002-2012 Gilles Boccon-Gibod
+|   Author: Gilles Boccon-Gibod (bok@bok.net)
+|
+ ****************************************************************/
+
+/*----------------------------------------------------------------------
+|   includes
++---------------------------------------------------------------------*/
+#include <math.h>
+
+#include "Atomix.h"
+#include "BltTypes.h"
+#include "BltErrors.h"
+#include "BltFft.h"
+#include "BltFingerprint.h"
+
+/*----------------------------------------------------------------------
+|   constants
++---------------------------------------------------------------------*/
+#define BLT_FINGERPRINT_PI 3.14159265358979323846
+
+/* the anti-aliasing filter is an 8th order Butterworth low pass, made */
+/* of 4 biquads. Everything that would alias below the top band is     */
+/* attenuated by more than 30dB                                         */
+#define BLT_FINGERPRINT_LOW_PASS_SECTIONS  4
+#define BLT_FINGERPRINT_LOW_PASS_FREQUENCY 2200.0
+
+/*----------------------------------------------------------------------
+|   types
++---------------------------------------------------------------------*/
+typedef struct {
+    double b0, b1, b2, a1, a2;
+} BLT_FingerprintBiquad;
+
+struct BLT_Fingerprinter {
+    /* input */
+    BLT_Cardinal          channel_count;
+    float                 channel_scale;
+    BLT_FingerprintBiquad low_pass[BLT_FINGERPRINT_LOW_PASS_SECTIONS];
+    double                low_pass_state[BLT_FINGERPRINT_LOW_PASS_SECTIONS][2];
+
+    /* resampler: position of the next output sample, in input samples */
+    /* after the previous input sample                                 */
+    double                step;
+    double                position;
+    float                 previous;
+
+    /* frames */
+    float                 ring[BLT_FINGERPRINT_FRAME_SIZE];
+    BLT_Cardinal          ring_position;
+    BLT_Cardinal          frame_countdown;
+    float                 window[BLT_FINGERPRINT_FRAME_SIZE];
+    float                 frame[BLT_FINGERPRINT_FRAME_SIZE];
+    float                 power[BLT_FINGERPRINT_FRAME_SIZE/2+1];
+    BLT_Fft*              fft;
+
+    /* bands */
+    BLT_Cardinal          band_edges[BLT_FINGERPRINT_BAND_COUNT+1];
+    float                 energies[2][BLT_FINGERPRINT_BAND_COUNT];
+    BLT_Cardinal          frame_count;
+
+    /* output */
+    BLT_UInt32*           sub_fingerprints;
+    BLT_Cardinal          count;
+    BLT_Cardinal          max_count;
+};
+
+/*----------------------------------------------------------------------
+|   BLT_Fingerprinter_Create
++---------------------------------------------------------------------*/
+BLT_Result
+BLT_Fingerprinter_Create(BLT_Cardinal max_count, BLT_Fingerprinter** fingerprinter)
+{
+    BLT_Fingerprinter* self;
+    BLT_Result         result;
+    unsigned int       i;
+
+    *fingerprinter = NULL;
+    if (max_count == 0) return BLT_ERROR_INVALID_PARAMETERS;
+
+    /* allocate the object and the sub-fingerprints in one block */
+    self = (BLT_Fingerprinter*)ATX_AllocateZeroMemory(sizeof(BLT_Fingerprinter)+
+                                                      max_count*sizeof(BLT_UInt32));
+    if (self == NULL) return BLT_ERROR_OUT_OF_MEMORY;
+    self->sub_fingerprints = (BLT_UInt32*)(self+1);
+    self->max_count        = max_count;
+
+    result = BLT_Fft_Create(BLT_FINGERPRINT_FRAME_SIZE, &self->fft);
+    if (BLT_FAILED(result)) {
+        ATX_FreeMemory(self);
+        return result;
+    }
+
+    /* Hann window */
+    for (i=0; i<BLT_FINGERPRINT_FRAME_SIZE; i++) {
+        self->window[i] = (float)(0.5-0.5*cos(2.0*BLT_FINGERPRINT_PI*(double)i/(double)BLT_FINGERPRINT_FRAME_SIZE));
+    }
+
+    /* logarithmically spaced bands */
+    for (i=0; i<=BLT_FINGERPRINT_BAND_COUNT; i++) {
+        double frequency = BLT_FINGERPRINT_MIN_FREQUENCY*
+                           pow((double)BLT_FINGERPRINT_MAX_FREQUENCY/(double)BLT_FINGERPRINT_MIN_FREQUENCY,
+                               (double)i/(double)BLT_FINGERPRINT_BAND_COUNT);
+        self->band_edges[i] = (BLT_Cardinal)floor(0.5+frequency*(double)BLT_FINGERPRINT_FRAME_SIZE/
+                                                      (double)BLT_FINGERPRINT_SAMPLE_RATE);
+    }
+
+    *fingerprinter = self;
+    return BLT_SUCCESS;
+}
+
+/*----------------------------------------------------------------------
+|   BLT_Fingerprinter_Destroy
++---------------------------------------------------------------------*/
+void
+BLT_Fingerprinter_Destroy(BLT_Fingerprinter* self)
+{
+    if (self == NULL) return;
+    BLT_Fft_Destroy(self->fft);
+    ATX_FreeMemory(self);
+}
+
+/*----------------------------------------------------------------------
+|   BLT_Fingerprinter_SetFormat
++---------------------------------------------------------------------*/
+BLT_Result
+BLT_Fingerprinter_SetFormat(BLT_Fingerprinter* self,
+                            BLT_Cardinal       sample_rate,
+                            BLT_Cardinal       channel_count)
+{
+    double       w0;
+    double       cos_w0;
+    unsigned int i;
+
+    if (channel_count == 0) return BLT_ERROR_INVALID_PARAMETERS;
+    if (sample_rate < BLT_FINGERPRINT_MIN_INPUT_SAMPLE_RATE) return BLT_ERROR_NOT_SUPPORTED;
+
+    self->channel_count = channel_count;
+    self->channel_scale = 1.0f/(float)channel_count;
+    self->step          = (double)sample_rate/(double)BLT_FINGERPRINT_SAMPLE_RATE;
+
+    /* Butterworth sections: Q = 1/(2cos(theta)) for the pole angles */
+    w0     = 2.0*BLT_FINGERPRINT_PI*BLT_FINGERPRINT_LOW_PASS_FREQUENCY/(double)sample_rate;
+    cos_w0 = cos(w0);
+    for (i=0; i<BLT_FINGERPRINT_LOW_PASS_SECTIONS; i++) {
+        double theta = BLT_FINGERPRINT_PI*(double)(2*i+1)/(double)(4*BLT_FINGERPRINT_LOW_PASS_SECTIONS);
+        double q     = 1.0/(2.0*cos(theta));
+        double alpha = sin(w0)/(2.0*q);
+        double a0    = 1.0+alpha;
+        self->low_pass[i].b0 = (1.0-cos_w0)/2.0/a0;
+        self->low_pass[i].b1 = (1.0-cos_w0)/a0;
+        self->low_pass[i].b2 = (1.0-cos_w0)/2.0/a0;
+        self->low_pass[i].a1 = -2.0*cos_w0/a0;
+        self->low_pass[i].a2 = (1.0-alpha)/a0;
+    }
+
+    BLT_Fingerprinter_Reset(self);
+
+    return BLT_SUCCESS;
+}
+
+/*----------------------------------------------------------------------
+|   BLT_Fingerprinter_Reset
++---------------------------------------------------------------------*/
+void
+BLT_Fingerprinter_Reset(BLT_Fingerprinter* self)
+{
+    ATX_SetMemory(self->low_pass_state, 0, sizeof(self->low_pass_state));
+    self->position        = 1.0;
+    self->previous        = 0.0f;
+    self->ring_position   = 0;
+    self->frame_countdown = BLT_FINGERPRINT_FRAME_SIZE;
+    self->frame_count     = 0;
+    self->count           = 0;
+}
+
+/*----------------------------------------------------------------------
+|   BLT_Fingerprinter_ProcessFrame
++---------------------------------------------------------------------*/
+static void
+BLT_Fingerprinter_ProcessFrame(BLT_Fingerprinter* self)
+{
+    const float* ring        = self->ring;
+    const float* window      = self->window;
+    float*       frame       = self->frame;
+    float*       energies    = self->energies[self->frame_count&1];
+    const float* previous    = self->energies[(self->frame_count+1)&1];
+    BLT_Cardinal first       = self->ring_position;
+    BLT_Cardinal first_count = BLT_FINGERPRINT_FRAME_SIZE-first;
+    BLT_UInt32   bits        = 0;
+    unsigned int i;
+
+    /* unroll the ring, oldest sample first, and apply the window */
+    for (i=0; i<first_count; i++) {
+        frame[i] = ring[first+i]*window[i];
+    }
+    for (i=0; i<first; i++) {
+        frame[first_count+i] = ring[i]*window[first_count+i];
+    }
+
+    /* energy of each band */
+    BLT_Fft_GetPowerSpectrum(self->fft, frame, self->power);
+    for (i=0; i<BLT_FINGERPRINT_BAND_COUNT; i++) {
+        float        energy = 0.0f;
+        BLT_Cardinal bin;
+        for (bin=self->band_edges[i]; bin<self->band_edges[i+1]; bin++) {
+            energy += self->power[bin];
+        }
+        energies[i] = energy;
+    }
+
+    /* one bit per pair of adjacent bands */
+    if (self->frame_count++ == 0) return;
+    for (i=0; i<BLT_FINGERPRINT_BAND_COUNT-1; i++) {
+        if ((energies[i]-energies[i+1])-(previous[i]-previous[i+1]) > 0.0f) {
+            bits |= (BLT_UInt32)1<<i;
+        }
+    }
+    if (self->count < self->max_count) {
+        self->sub_fingerprints[self->count++] = bits;
+    }
+}
+
+/*----------------------------------------------------------------------
+|   BLT_Fingerprinter_Process
++---------------------------------------------------------------------*/
+void
+BLT_Fingerprinter_Process(BLT_Fingerprinter* self,
+                          const float*       samples,
+                          BLT_Cardinal       frame_count)
+{
+    BLT_Cardinal channel_count = self->channel_count;
+    double       position      = self->position;
+    float        previous      = self->previous;
+    BLT_Cardinal i;
+
+    /* once we have all we need, there's nothing left to do */
+    if (self->count >= self->max_count || channel_count == 0) return;
+
+    for (i=0; i<frame_count; i++) {
+        double       sample = 0.0;
+        float        current;
+        unsigned int s;
+
+        /* downmix */
+        for (s=0; s<channel_count; s++) {
+            sample += samples[s];
+        }
+        samples += channel_count;
+        sample *= self->channel_scale;
+
+        /* low pass */
+        for (s=0; s<BLT_FINGERPRINT_LOW_PASS_SECTIONS; s++) {
+            const BLT_FingerprintBiquad* biquad = &self->low_pass[s];
+            double*                      state  = self->low_pass_state[s];
+            double                       output = biquad->b0*sample+state[0];
+            state[0] = biquad->b1*sample-biquad->a1*output+state[1];
+            state[1] = biquad->b2*sample-biquad->a2*output;
+            sample = output;
+        }
+        current = (float)sample;
+
+        /* resample, by linear interpolation */
+        while (position <= 1.0) {
+            self->ring[self->ring_position] = previous+(current-previous)*(float)position;
+            if (++self->ring_position == BLT_FINGERPRINT_FRAME_SIZE) self->ring_position = 0;
+            if (--self->frame_countdown == 0) {
+                BLT_Fingerprinter_ProcessFrame(self);
+                self->frame_countdown = BLT_FINGERPRINT_FRAME_STEP;
+            }
+            position += self->step;
+        }
+        position -= 1.0;
+        previous  = current;
+    }
+
+    /* flush denormals out of the filter states during silences */
+    for (i=0; i<BLT_FINGERPRINT_LOW_PASS_SECTIONS; i++) {
+        if (fabs(self->low_pass_state[i][0]) < 1.0e-30) self->low_pass_state[i][0] = 0.0;
+        if (fabs(self->low_pass_state[i][1]) < 1.0e-30) self->low_pass_state[i][1] = 0.0;
+    }
+
+    self->position = position;
+    self->previous = previous;
+}
+
+/*----------------------------------------------------------------------
+|   BLT_Fingerprinter_GetCount
++---------------------------------------------------------------------*/
+BLT_Cardinal
+BLT_Fingerprinter_GetCount(const BLT_Fingerprinter* self)
+{
+    return self->count;
+}
+
+/*----------------------------------------------------------------------
+|   BLT_Fingerprinter_GetSubFingerprints
++---------------------------------------------------------------------*/
+const BLT_UInt32*
+BLT_Fingerprinter_GetSubFingerprints(const BLT_Fingerprinter* self)
+{
+    return self->sub_fingerprints;
+}
+
+/*----------------------------------------------------------------------
+|   BLT_Fingerprint_CountBits
++---------------------------------------------------------------------*/
+static unsigned int
+BLT_Fingerprint_CountBits(BLT_UInt32 x)
+{
+    x = x-((x>>1) & 0x55555555);
+    x = (x & 0x33333333)+((x>>2) & 0x33333333);
+    x = (x+(x>>4)) & 0x0F0F0F0F;
+    return (unsigned int)((x*0x01010101)>>24);
+}
+
+/*----------------------------------------------------------------------
+|   BLT_Fingerprint_Compare
++---------------------------------------------------------------------*/
+double
+BLT_Fingerprint_Compare(const BLT_UInt32* a,
+                        BLT_Cardinal      a_count,
+                        const BLT_UInt32* b,
+                        BLT_Cardinal      b_count,
+                        BLT_Cardinal      max_offset,
+                        int*              offset)
+{
+    /* alignments that only overlap a little are meaningless */
+    BLT_Cardinal min_overlap = (a_count < b_count ? a_count : b_count)/2;
+    double       best        = 1.0;
+    int          o;
+
+    if (offset) *offset = 0;
+    if (min_overlap == 0) min_overlap = 1;
+
+    for (o = -(int)max_offset; o <= (int)max_offset; o++) {
+        BLT_Cardinal a_start = o < 0 ? (BLT_Cardinal)-o : 0;
+        BLT_Cardinal b_start = o > 0 ? (BLT_Cardinal)o  : 0;
+        BLT_Cardinal overlap;
+        BLT_Cardinal errors = 0;
+        BLT_Cardinal i;
+        double       rate;
+
+        if (a_start >= a_count || b_start >= b_count) continue;
+        overlap = a_count-a_start;
+        if (overlap > b_count-b_start) overlap = b_count-b_start;
+        if (overlap < min_overlap) continue;
+
+        for (i=0; i<overlap; i++) {
+            errors += BLT_Fingerprint_CountBits(a[a_start+i]^b[b_start+i]);
+        }
+        rate = (double)errors/(32.0*(double)overlap);
+        if (rate < best) {
+            best = rate;
+            if (offset) *offset = o;
+        }
+    }
+
+    return best;
+}
+
+/*----------------------------------------------------------------------
+|   BLT_Fingerprint_Format
++---------------------------------------------------------------------*/
+void
+BLT_Fingerprint_Format(const BLT_UInt32* sub_fingerprints,
+                       BLT_Cardinal      count,
+                       char*             string)
+{
+    static const char hex[] = "0123456789abcdef";
+    BLT_Cardinal      i;
+
+    for (i=0; i<count; i++) {
+        BLT_UInt32 value = sub_fingerprints[i];
+        int        shift;
+        for (shift=28; shift >= 0; shift -= 4) {
+            *string++ = hex[(value>>shift) & 0xF];
+        }
+    }
+    *string = '\0';
+}
+
+/*----------------------------------------------------------------------
+|   BLT_Fingerprint_Parse
++---------------------------------------------------------------------*/
+BLT_Cardinal
+BLT_Fingerprint_Parse(const char*  string,
+                      BLT_UInt32*  sub_fingerprints,
+                      BLT_Cardinal max_count)
+{
+    BLT_Cardinal count = 0;
+
+    while (count < max_count) {
+        BLT_UInt32   value = 0;
+        unsigned int i;
+        for (i=0; i<BLT_FINGERPRINT_FORMATTED_SIZE; i++) {
+            char c = string[i];
+            if (c >= '0' && c <= '9') {
+                value = (value<<4) | (BLT_UInt32)(c-'0');
+            } else if (c >= 'a' && c <= 'f') {
+                value = (value<<4) | (BLT_UInt32)(c-'a'+10);
+            } else if (c >= 'A' && c <= 'F') {
+                value = (value<<4) | (BLT_UInt32)(c-'A'+10);
+            } else {
+                return count;
+            }
+        }
+        sub_fingerprints[count++] = value;
+        string += BLT_FINGERPRINT_FORMATTED_SIZE;
+    }
+
+    return count;
+}
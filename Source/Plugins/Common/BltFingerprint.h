@@ -0,0 +1,140 @@
+/*****************************************************************
+|
+|   BlueTune - Audio Fingerprint
+|
+|   (c) 2002-2012 Gilles Boccon-Gibod
+|   Author: Gilles Boccon-Gibod (bok@bok.net)
+|
+ ****************************************************************/
+/** @file
+ * Audio fingerprint: a sequence of 32-bit sub-fingerprints, one every
+ * 23ms, that is robust to lossy encoding, resampling, gain changes and
+ * small time offsets, so that two copies of the same recording can be
+ * matched by counting the bits that differ.
+ *
+ * The audio is downmixed to mono and resampled to 5512Hz. Overlapping
+ * frames of 371ms are windowed, their spectrum is split into 33
+ * logarithmic bands between 300Hz and 2000Hz, and each bit of a
+ * sub-fingerprint is the sign of the change, from one frame to the
+ * next, of the energy difference between two adjacent bands.
+ */
+
+#ifndef _BLT_FINGERPRINT_H_
+#define _BLT_FINGERPRINT_H_
+
+/*----------------------------------------------------------------------
+|   includes
++---------------------------------------------------------------------*/
+#include "BltTypes.h"
+
+/*----------------------------------------------------------------------
+|   constants
++---------------------------------------------------------------------*/
+#define BLT_FINGERPRINT_SAMPLE_RATE   5512
+#define BLT_FINGERPRINT_FRAME_SIZE    2048 /* samples at 5512Hz */
+#define BLT_FINGERPRINT_FRAME_STEP    128  /* samples at 5512Hz */
+#define BLT_FINGERPRINT_BAND_COUNT    33
+#define BLT_FINGERPRINT_MIN_FREQUENCY 300
+#define BLT_FINGERPRINT_MAX_FREQUENCY 2000
+
+/** Lowest supported input sample rate */
+#define BLT_FINGERPRINT_MIN_INPUT_SAMPLE_RATE 8000
+
+/** Number of sub-fingerprints covering a duration in seconds */
+#define BLT_FINGERPRINT_COUNT_FOR_DURATION(seconds) \
+    ((seconds)*BLT_FINGERPRINT_SAMPLE_RATE/BLT_FINGERPRINT_FRAME_STEP)
+
+/** Number of characters of a formatted sub-fingerprint */
+#define BLT_FINGERPRINT_FORMATTED_SIZE 8
+
+/*----------------------------------------------------------------------
+|   types
++---------------------------------------------------------------------*/
+typedef struct BLT_Fingerprinter BLT_Fingerprinter;
+
+/*----------------------------------------------------------------------
+|   prototypes
++---------------------------------------------------------------------*/
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/**
+ * Create a fingerprinter.
+ * @param max_count Maximum number of sub-fingerprints kept: the audio
+ * that follows is ignored.
+ */
+BLT_Result BLT_Fingerprinter_Create(BLT_Cardinal max_count, BLT_Fingerprinter** fingerprinter);
+
+void BLT_Fingerprinter_Destroy(BLT_Fingerprinter* self);
+
+/**
+ * Set the format of the input, and start a new fingerprint.
+ * Returns BLT_ERROR_NOT_SUPPORTED if the sample rate is lower than
+ * BLT_FINGERPRINT_MIN_INPUT_SAMPLE_RATE.
+ */
+BLT_Result BLT_Fingerprinter_SetFormat(BLT_Fingerprinter* self,
+                                       BLT_Cardinal       sample_rate,
+                                       BLT_Cardinal       channel_count);
+
+/**
+ * Start a new fingerprint.
+ */
+void BLT_Fingerprinter_Reset(BLT_Fingerprinter* self);
+
+/**
+ * Process a buffer of interleaved float samples.
+ */
+void BLT_Fingerprinter_Process(BLT_Fingerprinter* self,
+                               const float*       samples,
+                               BLT_Cardinal       frame_count);
+
+/**
+ * Number of sub-fingerprints computed since the last reset.
+ */
+BLT_Cardinal BLT_Fingerprinter_GetCount(const BLT_Fingerprinter* self);
+
+/**
+ * Sub-fingerprints computed since the last reset.
+ */
+const BLT_UInt32* BLT_Fingerprinter_GetSubFingerprints(const BLT_Fingerprinter* self);
+
+/**
+ * Compare two fingerprints.
+ * The fingerprints are aligned with all the offsets up to max_offset
+ * sub-fingerprints, in both directions.
+ * @param offset Set to the offset of the best alignment (index in b of
+ * the first sub-fingerprint of a). May be NULL.
+ * @return Bit error rate of the best alignment, from 0.0 (identical)
+ * to 1.0. Fingerprints of unrelated audio are around 0.5, and copies
+ * of the same audio usually stay under 0.35.
+ */
+double BLT_Fingerprint_Compare(const BLT_UInt32* a,
+                               BLT_Cardinal      a_count,
+                               const BLT_UInt32* b,
+                               BLT_Cardinal      b_count,
+                               BLT_Cardinal      max_offset,
+                               int*              offset);
+
+/**
+ * Format sub-fingerprints as hexadecimal text.
+ * @param string Buffer of at least count*BLT_FINGERPRINT_FORMATTED_SIZE+1
+ * characters.
+ */
+void BLT_Fingerprint_Format(const BLT_UInt32* sub_fingerprints,
+                            BLT_Cardinal      count,
+                            char*             string);
+
+/**
+ * Parse sub-fingerprints formatted with BLT_Fingerprint_Format.
+ * @return The number of sub-fingerprints parsed, up to max_count.
+ */
+BLT_Cardinal BLT_Fingerprint_Parse(const char*  string,
+                                   BLT_UInt32*  sub_fingerprints,
+                                   BLT_Cardinal max_count);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* _BLT_FINGERPRINT_H_ */
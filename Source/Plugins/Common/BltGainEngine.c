@@ -0,0 +1,376 @@
+/*****************************************************************
+|
+|   BlueTune - PCM Gain Engine
+|
+|   (c) 2002-2012 Gilles Boccon-Gibod
+|   Author: Gilles Boccon-Gibod (bok@bok.net)
+|
+ ****************************************************************/
+
+/*----------------------------------------------------------------------
+|   includes
++---------------------------------------------------------------------*/
+#include <math.h>
+
+#include "Atomix.h"
+#include "BltTypes.h"
+#include "BltErrors.h"
+#include "BltPcm.h"
+#include "BltSimd.h"
+#include "BltGainEngine.h"
+
+/*----------------------------------------------------------------------
+|   constants
++---------------------------------------------------------------------*/
+/* 16-bit samples are scaled with a Q12 gain so that the product of a */
+/* sample and the largest gain still fits in 32 bits                  */
+#define BLT_GAIN_ENGINE_GAIN_BITS_16 12
+
+/*----------------------------------------------------------------------
+|   BLT_GainEngine_Init
++---------------------------------------------------------------------*/
+void
+BLT_GainEngine_Init(BLT_GainEngine*         self,
+                    BLT_GainEngineRampShape ramp_shape,
+                    BLT_UInt32              ramp_duration)
+{
+    ATX_SetMemory(self, 0, sizeof(*self));
+    self->gain          = BLT_GAIN_ENGINE_UNITY_GAIN;
+    self->target_gain   = BLT_GAIN_ENGINE_UNITY_GAIN;
+    self->ramp_shape    = ramp_shape;
+    self->ramp_duration = ramp_duration;
+}
+
+/*----------------------------------------------------------------------
+|   BLT_GainEngine_SetGain
++---------------------------------------------------------------------*/
+void
+BLT_GainEngine_SetGain(BLT_GainEngine* self, BLT_UInt32 gain)
+{
+    if (gain > BLT_GAIN_ENGINE_MAX_GAIN) gain = BLT_GAIN_ENGINE_MAX_GAIN;
+    if (gain == self->target_gain) return;
+
+    /* the ramp is planned on the next call to Process, when we know */
+    /* the sample rate, starting from wherever we are now            */
+    self->target_gain  = gain;
+    self->ramp_pending = BLT_TRUE;
+}
+
+/*----------------------------------------------------------------------
+|   BLT_GainEngine_ResetGain
++---------------------------------------------------------------------*/
+void
+BLT_GainEngine_ResetGain(BLT_GainEngine* self, BLT_UInt32 gain)
+{
+    if (gain > BLT_GAIN_ENGINE_MAX_GAIN) gain = BLT_GAIN_ENGINE_MAX_GAIN;
+    self->gain         = gain;
+    self->target_gain  = gain;
+    self->ramp_blocks  = 0;
+    self->ramp_pending = BLT_FALSE;
+}
+
+/*----------------------------------------------------------------------
+|   BLT_GainEngine_IsUnity
++---------------------------------------------------------------------*/
+BLT_Boolean
+BLT_GainEngine_IsUnity(const BLT_GainEngine* self)
+{
+    return (self->gain        == BLT_GAIN_ENGINE_UNITY_GAIN &&
+            self->target_gain == BLT_GAIN_ENGINE_UNITY_GAIN &&
+            self->ramp_blocks == 0)?BLT_TRUE:BLT_FALSE;
+}
+
+/*----------------------------------------------------------------------
+|   BLT_GainEngine_DbToGain
+|
+|   The input parameter is the gain expressed in 100th of decibels
++---------------------------------------------------------------------*/
+BLT_UInt32
+BLT_GainEngine_DbToGain(int gain)
+{
+    double f = (double)BLT_GAIN_ENGINE_UNITY_GAIN*pow(10.0, ((double)gain)/2000.0);
+    if (f >= (double)BLT_GAIN_ENGINE_MAX_GAIN) return BLT_GAIN_ENGINE_MAX_GAIN;
+    return (BLT_UInt32)(f+0.5);
+}
+
+/*----------------------------------------------------------------------
+|   BLT_GainEngine_SupportsFormat
++---------------------------------------------------------------------*/
+BLT_Boolean
+BLT_GainEngine_SupportsFormat(const BLT_PcmMediaType* format)
+{
+    if (format->channel_count == 0) return BLT_FALSE;
+    switch (format->bits_per_sample) {
+      case 16:
+        return format->sample_format == BLT_PCM_SAMPLE_FORMAT_SIGNED_INT_NE;
+
+      case 24:
+        return format->sample_format == BLT_PCM_SAMPLE_FORMAT_SIGNED_INT_LE ||
+               format->sample_format == BLT_PCM_SAMPLE_FORMAT_SIGNED_INT_BE;
+
+      case 32:
+        return format->sample_format == BLT_PCM_SAMPLE_FORMAT_SIGNED_INT_NE ||
+               format->sample_format == BLT_PCM_SAMPLE_FORMAT_FLOAT_NE;
+
+      default:
+        return BLT_FALSE;
+    }
+}
+
+/*----------------------------------------------------------------------
+|   BLT_GainEngine_PlanRamp
++---------------------------------------------------------------------*/
+static void
+BLT_GainEngine_PlanRamp(BLT_GainEngine* self, BLT_UInt32 sample_rate)
+{
+    BLT_Cardinal frames;
+
+    self->ramp_pending = BLT_FALSE;
+    if (self->gain == self->target_gain ||
+        self->ramp_duration == 0        ||
+        sample_rate == 0) {
+        self->gain        = self->target_gain;
+        self->ramp_blocks = 0;
+        return;
+    }
+
+    frames = (sample_rate*self->ramp_duration)/1000;
+    self->ramp_blocks = (frames+BLT_GAIN_ENGINE_RAMP_BLOCK_SIZE-1)/BLT_GAIN_ENGINE_RAMP_BLOCK_SIZE;
+    if (self->ramp_blocks == 0) self->ramp_blocks = 1;
+    self->ramp_gain = (float)self->gain;
+
+    /* an exponential ramp is linear in dB, which sounds more even, but */
+    /* it cannot start or end at 0                                     */
+    if (self->ramp_shape == BLT_GAIN_ENGINE_RAMP_EXPONENTIAL &&
+        self->gain && self->target_gain) {
+        self->ramp_multiply = BLT_TRUE;
+        self->ramp_step     = (float)pow((double)self->target_gain/(double)self->gain,
+                                         1.0/(double)self->ramp_blocks);
+    } else {
+        self->ramp_multiply = BLT_FALSE;
+        self->ramp_step     = ((float)self->target_gain-(float)self->gain)/(float)self->ramp_blocks;
+    }
+}
+
+/*----------------------------------------------------------------------
+|   BLT_GainEngine_StepRamp
++---------------------------------------------------------------------*/
+static void
+BLT_GainEngine_StepRamp(BLT_GainEngine* self)
+{
+    if (--self->ramp_blocks == 0) {
+        /* land exactly on the target */
+        self->gain = self->target_gain;
+        return;
+    }
+    if (self->ramp_multiply) {
+        self->ramp_gain *= self->ramp_step;
+    } else {
+        self->ramp_gain += self->ramp_step;
+    }
+    self->gain = (BLT_UInt32)(self->ramp_gain+0.5f);
+}
+
+/*----------------------------------------------------------------------
+|   BLT_GainEngine_Apply16
++---------------------------------------------------------------------*/
+static void
+BLT_GainEngine_Apply16(BLT_Int16* samples, BLT_Cardinal count, BLT_UInt32 gain)
+{
+    BLT_Int32    factor = (BLT_Int32)(gain>>(BLT_GAIN_ENGINE_GAIN_BITS-BLT_GAIN_ENGINE_GAIN_BITS_16));
+    BLT_Cardinal i = 0;
+
+#if defined(BLT_SIMD_SSE2)
+    {
+        /* the factor can be 32768, so it is multiplied as an unsigned */
+        /* 16-bit value: the high half of the signed product is the    */
+        /* unsigned one minus the factor where the sample is negative. */
+        /* The pack saturates like the scalar clamp does.              */
+        __m128i f = _mm_set1_epi16((short)factor);
+        for (; i+8 <= count; i += 8) {
+            __m128i s  = _mm_loadu_si128((const __m128i*)(samples+i));
+            __m128i lo = _mm_mullo_epi16(s, f);
+            __m128i hi = _mm_sub_epi16(_mm_mulhi_epu16(s, f),
+                                       _mm_and_si128(_mm_srai_epi16(s, 15), f));
+            __m128i p0 = _mm_srai_epi32(_mm_unpacklo_epi16(lo, hi), BLT_GAIN_ENGINE_GAIN_BITS_16);
+            __m128i p1 = _mm_srai_epi32(_mm_unpackhi_epi16(lo, hi), BLT_GAIN_ENGINE_GAIN_BITS_16);
+            _mm_storeu_si128((__m128i*)(samples+i), _mm_packs_epi32(p0, p1));
+        }
+    }
+#elif defined(BLT_SIMD_NEON)
+    for (; i+8 <= count; i += 8) {
+        int16x8_t s  = vld1q_s16(samples+i);
+        int32x4_t p0 = vshrq_n_s32(vmulq_n_s32(vmovl_s16(vget_low_s16(s)),  factor), BLT_GAIN_ENGINE_GAIN_BITS_16);
+        int32x4_t p1 = vshrq_n_s32(vmulq_n_s32(vmovl_s16(vget_high_s16(s)), factor), BLT_GAIN_ENGINE_GAIN_BITS_16);
+        vst1q_s16(samples+i, vcombine_s16(vqmovn_s32(p0), vqmovn_s32(p1)));
+    }
+#endif
+
+    if (gain <= BLT_GAIN_ENGINE_UNITY_GAIN) {
+        /* attenuation cannot overflow */
+        for (; i<count; i++) {
+            samples[i] = (BLT_Int16)((samples[i]*factor)>>BLT_GAIN_ENGINE_GAIN_BITS_16);
+        }
+    } else {
+        for (; i<count; i++) {
+            BLT_Int32 value = (samples[i]*factor)>>BLT_GAIN_ENGINE_GAIN_BITS_16;
+            value = value >  32767 ?  32767 : value;
+            value = value < -32768 ? -32768 : value;
+            samples[i] = (BLT_Int16)value;
+        }
+    }
+}
+
+/*----------------------------------------------------------------------
+|   BLT_GainEngine_Apply24
+|
+|   Packed 24-bit samples and 32-bit integer samples (below) stay scalar:
+|   they need a signed 32x32->64 bit multiply and a 64-bit arithmetic
+|   shift, which SSE2 does not have.
++---------------------------------------------------------------------*/
+static void
+BLT_GainEngine_Apply24(unsigned char* samples,
+                       BLT_Cardinal   count,
+                       BLT_UInt32     gain,
+                       BLT_Boolean    big_endian)
+{
+    /* byte offsets of the low and high bytes */
+    unsigned int lo = big_endian?2:0;
+    unsigned int hi = big_endian?0:2;
+    BLT_Cardinal i;
+
+    for (i=0; i<count; i++, samples += 3) {
+        ATX_Int64 value = (ATX_Int32)(((ATX_UInt32)samples[lo]      ) |
+                                      ((ATX_UInt32)samples[1]  <<  8) |
+                                      ((ATX_UInt32)samples[hi] << 16));
+        value = ((value ^ 0x800000)-0x800000); /* sign extension */
+        value = (value*gain)>>BLT_GAIN_ENGINE_GAIN_BITS;
+        value = value >  0x7FFFFF ?  0x7FFFFF : value;
+        value = value < -0x800000 ? -0x800000 : value;
+        samples[lo] = (unsigned char)(value      );
+        samples[1]  = (unsigned char)(value >>  8);
+        samples[hi] = (unsigned char)(value >> 16);
+    }
+}
+
+/*----------------------------------------------------------------------
+|   BLT_GainEngine_Apply32
++---------------------------------------------------------------------*/
+static void
+BLT_GainEngine_Apply32(BLT_Int32* samples, BLT_Cardinal count, BLT_UInt32 gain)
+{
+    BLT_Cardinal i;
+
+    if (gain <= BLT_GAIN_ENGINE_UNITY_GAIN) {
+        for (i=0; i<count; i++) {
+            samples[i] = (BLT_Int32)(((ATX_Int64)samples[i]*gain)>>BLT_GAIN_ENGINE_GAIN_BITS);
+        }
+    } else {
+        for (i=0; i<count; i++) {
+            ATX_Int64 value = ((ATX_Int64)samples[i]*gain)>>BLT_GAIN_ENGINE_GAIN_BITS;
+            value = value > (ATX_Int64)0x7FFFFFFF ? (ATX_Int64)0x7FFFFFFF : value;
+            value = value < -(ATX_Int64)0x80000000 ? -(ATX_Int64)0x80000000 : value;
+            samples[i] = (BLT_Int32)value;
+        }
+    }
+}
+
+/*----------------------------------------------------------------------
+|   BLT_GainEngine_ApplyFloat
++---------------------------------------------------------------------*/
+static void
+BLT_GainEngine_ApplyFloat(float* samples, BLT_Cardinal count, BLT_UInt32 gain)
+{
+    float        factor = (float)gain/(float)BLT_GAIN_ENGINE_UNITY_GAIN;
+    BLT_Cardinal i = 0;
+
+#if defined(BLT_SIMD_SSE2)
+    {
+        __m128 f = _mm_set1_ps(factor);
+        for (; i+4 <= count; i += 4) {
+            _mm_storeu_ps(samples+i, _mm_mul_ps(_mm_loadu_ps(samples+i), f));
+        }
+    }
+#elif defined(BLT_SIMD_NEON)
+    for (; i+4 <= count; i += 4) {
+        vst1q_f32(samples+i, vmulq_n_f32(vld1q_f32(samples+i), factor));
+    }
+#endif
+
+    for (; i<count; i++) {
+        samples[i] *= factor;
+    }
+}
+
+/*----------------------------------------------------------------------
+|   BLT_GainEngine_Apply
++---------------------------------------------------------------------*/
+static void
+BLT_GainEngine_Apply(const BLT_PcmMediaType* format,
+                     unsigned char*          samples,
+                     BLT_Cardinal            count,
+                     BLT_UInt32              gain)
+{
+    switch (format->bits_per_sample) {
+      case 16:
+        BLT_GainEngine_Apply16((BLT_Int16*)samples, count, gain);
+        break;
+
+      case 24:
+        BLT_GainEngine_Apply24(samples, count, gain,
+                               format->sample_format == BLT_PCM_SAMPLE_FORMAT_SIGNED_INT_BE);
+        break;
+
+      case 32:
+        if (format->sample_format == BLT_PCM_SAMPLE_FORMAT_FLOAT_NE) {
+            BLT_GainEngine_ApplyFloat((float*)samples, count, gain);
+        } else {
+            BLT_GainEngine_Apply32((BLT_Int32*)samples, count, gain);
+        }
+        break;
+    }
+}
+
+/*----------------------------------------------------------------------
+|   BLT_GainEngine_Process
++---------------------------------------------------------------------*/
+BLT_Result
+BLT_GainEngine_Process(BLT_GainEngine*         self,
+                       const BLT_PcmMediaType* format,
+                       void*                   samples,
+                       BLT_Size                size)
+{
+    unsigned char* block = (unsigned char*)samples;
+    BLT_Cardinal   frame_size;
+    BLT_Cardinal   frame_count;
+
+    /* check the format */
+    if (!BLT_GainEngine_SupportsFormat(format)) return BLT_ERROR_NOT_SUPPORTED;
+    frame_size  = (format->bits_per_sample/8)*format->channel_count;
+    frame_count = size/frame_size;
+
+    /* start a new ramp if the gain was changed */
+    if (self->ramp_pending) {
+        BLT_GainEngine_PlanRamp(self, format->sample_rate);
+    }
+
+    while (frame_count) {
+        BLT_Cardinal frames = frame_count;
+
+        /* while ramping, the gain is constant over a block */
+        if (self->ramp_blocks && frames > BLT_GAIN_ENGINE_RAMP_BLOCK_SIZE) {
+            frames = BLT_GAIN_ENGINE_RAMP_BLOCK_SIZE;
+        }
+        if (self->gain != BLT_GAIN_ENGINE_UNITY_GAIN) {
+            BLT_GainEngine_Apply(format, block, frames*format->channel_count, self->gain);
+        }
+        if (self->ramp_blocks) {
+            BLT_GainEngine_StepRamp(self);
+        }
+
+        block       += frames*frame_size;
+        frame_count -= frames;
+    }
+
+    return BLT_SUCCESS;
+}
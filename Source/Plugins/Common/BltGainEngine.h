@@ -0,0 +1,122 @@
+/*****************************************************************
+|
+|   BlueTune - PCM Gain Engine
+|
+|   (c) 2002-2012 Gilles Boccon-Gibod
+|   Author: Gilles Boccon-Gibod (bok@bok.net)
+|
+ ****************************************************************/
+/** @file
+ * PCM gain engine: applies a fixed-point gain to PCM samples, with
+ * smooth ramps when the gain changes.
+ */
+
+#ifndef _BLT_GAIN_ENGINE_H_
+#define _BLT_GAIN_ENGINE_H_
+
+/*----------------------------------------------------------------------
+|   includes
++---------------------------------------------------------------------*/
+#include "BltTypes.h"
+#include "BltPcm.h"
+
+/*----------------------------------------------------------------------
+|   constants
++---------------------------------------------------------------------*/
+/** Number of fractional bits of a gain value */
+#define BLT_GAIN_ENGINE_GAIN_BITS  16
+
+/** Gain value that represents a factor of 1.0 */
+#define BLT_GAIN_ENGINE_UNITY_GAIN (1<<BLT_GAIN_ENGINE_GAIN_BITS)
+
+/** Largest gain value (x8, a bit more than +18dB) */
+#define BLT_GAIN_ENGINE_MAX_GAIN   (8*BLT_GAIN_ENGINE_UNITY_GAIN)
+
+/**
+ * Number of frames processed with the same gain while ramping.
+ * Smaller blocks make smoother ramps, larger blocks keep the inner
+ * loops long enough to be efficient.
+ */
+#define BLT_GAIN_ENGINE_RAMP_BLOCK_SIZE       32
+
+#define BLT_GAIN_ENGINE_DEFAULT_RAMP_DURATION 20 /* ms */
+
+/*----------------------------------------------------------------------
+|   types
++---------------------------------------------------------------------*/
+typedef enum {
+    BLT_GAIN_ENGINE_RAMP_LINEAR,
+    BLT_GAIN_ENGINE_RAMP_EXPONENTIAL
+} BLT_GainEngineRampShape;
+
+typedef struct {
+    BLT_UInt32              gain;          /**< Current gain          */
+    BLT_UInt32              target_gain;   /**< Gain to ramp to       */
+    BLT_GainEngineRampShape ramp_shape;
+    BLT_UInt32              ramp_duration; /**< Ramp duration, in ms  */
+    BLT_Cardinal            ramp_blocks;   /**< Blocks left to ramp   */
+    BLT_Boolean             ramp_pending;  /**< Ramp not planned yet  */
+    BLT_Boolean             ramp_multiply; /**< Step is a ratio       */
+    float                   ramp_step;     /**< Per-block delta/ratio */
+    float                   ramp_gain;     /**< Exact ramp position   */
+} BLT_GainEngine;
+
+/*----------------------------------------------------------------------
+|   prototypes
++---------------------------------------------------------------------*/
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/**
+ * Initialize a gain engine, with a unity gain.
+ * @param ramp_duration Duration of the ramps, in milliseconds. A value of
+ * 0 means that gain changes are applied instantly.
+ */
+void BLT_GainEngine_Init(BLT_GainEngine*         self,
+                         BLT_GainEngineRampShape ramp_shape,
+                         BLT_UInt32              ramp_duration);
+
+/**
+ * Set the gain that the engine should ramp to.
+ * @param gain Gain value (BLT_GAIN_ENGINE_UNITY_GAIN means no change).
+ */
+void BLT_GainEngine_SetGain(BLT_GainEngine* self, BLT_UInt32 gain);
+
+/**
+ * Set the gain immediately, without a ramp.
+ */
+void BLT_GainEngine_ResetGain(BLT_GainEngine* self, BLT_UInt32 gain);
+
+/**
+ * Returns BLT_TRUE if the engine would leave samples unmodified.
+ */
+BLT_Boolean BLT_GainEngine_IsUnity(const BLT_GainEngine* self);
+
+/**
+ * Convert a gain in hundredths of decibels to a gain value.
+ */
+BLT_UInt32 BLT_GainEngine_DbToGain(int gain);
+
+/**
+ * Returns BLT_TRUE if the engine can process samples of the given format.
+ * Supported formats are 16, 24 and 32 bit signed integers, and 32 bit
+ * floats. 16 and 32 bit integers, and floats, must be native-endian;
+ * 24 bit integers may be in either byte order.
+ */
+BLT_Boolean BLT_GainEngine_SupportsFormat(const BLT_PcmMediaType* format);
+
+/**
+ * Apply the gain, in place, to a buffer of PCM samples.
+ * @param size Size of the buffer, in bytes.
+ */
+BLT_Result BLT_GainEngine_Process(BLT_GainEngine*         self,
+                                  const BLT_PcmMediaType* format,
+                                  void*                   samples,
+                                  BLT_Size                size);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* _BLT_GAIN_ENGINE_H_ */
@@ -0,0 +1,395 @@
+/*****************************************************************
+|
+|   BlueTune - Loudness Meter
+|
+|   (c) 2002-2012 Gilles Boccon-Gibod
+|   Author: Gilles Boccon-Gibod (bok@bok.net)
+|
+ ****************************************************************/
+
+/*----------------------------------------------------------------------
+|   includes
++---------------------------------------------------------------------*/
+#include <math.h>
+
+#include "Atomix.h"
+#include "BltTypes.h"
+#include "BltErrors.h"
+#include "BltPcm.h"
+#include "BltSimd.h"
+#include "BltLoudness.h"
+
+/*----------------------------------------------------------------------
+|   constants
++---------------------------------------------------------------------*/
+#define BLT_LOUDNESS_SURROUND_WEIGHT 1.41253754462275 /* +1.5 dB */
+#define BLT_LOUDNESS_RELATIVE_GATE   (-10.0)
+#define BLT_LOUDNESS_BIN_WIDTH       0.1
+#define BLT_LOUDNESS_DENORMAL_LIMIT  1.0e-30
+
+#define BLT_LOUDNESS_SURROUND_SPEAKERS (BLT_PCM_SPEAKER_BACK_LEFT   | \
+                                        BLT_PCM_SPEAKER_BACK_RIGHT  | \
+                                        BLT_PCM_SPEAKER_BACK_CENTER | \
+                                        BLT_PCM_SPEAKER_SIDE_LEFT   | \
+                                        BLT_PCM_SPEAKER_SIDE_RIGHT)
+
+/* channel masks assumed when none is given, by channel count */
+static const BLT_UInt32 BLT_LoudnessMeter_DefaultChannelMasks[BLT_LOUDNESS_METER_MAX_CHANNELS+1] = {
+    0,
+    BLT_CHANNEL_MASK_MONO,
+    BLT_CHANNEL_MASK_STEREO,
+    BLT_CHANNEL_MASK_STEREO | BLT_PCM_SPEAKER_FRONT_CENTER,
+    BLT_CHANNEL_MASK_QUAD,
+    BLT_CHANNEL_MASK_QUAD | BLT_PCM_SPEAKER_FRONT_CENTER,
+    BLT_CHANNEL_MASK_5POINT1,
+    BLT_CHANNEL_MASK_5POINT1 | BLT_PCM_SPEAKER_BACK_CENTER,
+    BLT_CHANNEL_MASK_7POINT1_SURROUND
+};
+
+/*----------------------------------------------------------------------
+|   BLT_Loudness_FromMeanSquare
++---------------------------------------------------------------------*/
+static double
+BLT_Loudness_FromMeanSquare(double mean_square)
+{
+    return -0.691+10.0*log10(mean_square);
+}
+
+/*----------------------------------------------------------------------
+|   BLT_LoudnessMeter_Init
++---------------------------------------------------------------------*/
+BLT_Result
+BLT_LoudnessMeter_Init(BLT_LoudnessMeter* self,
+                       BLT_Cardinal       sample_rate,
+                       BLT_Cardinal       channel_count,
+                       BLT_UInt32         channel_mask)
+{
+    double      k;
+    double      q;
+    double      a0;
+    double      vh;
+    double      vb;
+    BLT_Ordinal c;
+    BLT_Ordinal bit;
+    BLT_Result  result;
+
+    ATX_SetMemory(self, 0, sizeof(*self));
+    if (sample_rate == 0 || channel_count == 0) return BLT_ERROR_INVALID_PARAMETERS;
+    result = BLT_TruePeakMeter_Init(&self->true_peak, channel_count);
+    if (BLT_FAILED(result)) return result;
+    self->sample_rate   = sample_rate;
+    self->channel_count = channel_count;
+    self->block_size    = (sample_rate+5)/10;
+
+    /* the i-th channel is the i-th bit set in the mask */
+    if (channel_mask == 0) channel_mask = BLT_LoudnessMeter_DefaultChannelMasks[channel_count];
+    for (c=0, bit=0; c<channel_count; c++, bit++) {
+        while (bit < 32 && !(channel_mask & (1<<bit))) ++bit;
+        if (bit >= 32) {
+            self->weights[c] = 1.0;
+        } else if ((1<<bit) == BLT_PCM_SPEAKER_LOW_FREQUENCY) {
+            self->weights[c] = 0.0;
+        } else if ((1<<bit) & BLT_LOUDNESS_SURROUND_SPEAKERS) {
+            self->weights[c] = BLT_LOUDNESS_SURROUND_WEIGHT;
+        } else {
+            self->weights[c] = 1.0;
+        }
+    }
+
+    /* K-weighting, stage 1: high shelf (+4 dB above ~1.7 kHz), with */
+    /* the analog prototype of BS.1770 mapped to this sample rate    */
+    k  = tan(3.14159265358979323846*1681.974450955533/(double)sample_rate);
+    q  = 0.7071752369554196;
+    vh = pow(10.0, 3.999843853973347/20.0);
+    vb = pow(vh, 0.4996667741545416);
+    a0 = 1.0+k/q+k*k;
+    self->shelf.b0 = (vh+vb*k/q+k*k)/a0;
+    self->shelf.b1 = 2.0*(k*k-vh)/a0;
+    self->shelf.b2 = (vh-vb*k/q+k*k)/a0;
+    self->shelf.a1 = 2.0*(k*k-1.0)/a0;
+    self->shelf.a2 = (1.0-k/q+k*k)/a0;
+
+    /* stage 2: high pass (RLB weighting) */
+    k  = tan(3.14159265358979323846*38.13547087602444/(double)sample_rate);
+    q  = 0.5003270373238773;
+    a0 = 1.0+k/q+k*k;
+    self->high_pass.b0 = 1.0;
+    self->high_pass.b1 = -2.0;
+    self->high_pass.b2 = 1.0;
+    self->high_pass.a1 = 2.0*(k*k-1.0)/a0;
+    self->high_pass.a2 = (1.0-k/q+k*k)/a0;
+
+    return BLT_SUCCESS;
+}
+
+/*----------------------------------------------------------------------
+|   BLT_LoudnessMeter_Reset
++---------------------------------------------------------------------*/
+void
+BLT_LoudnessMeter_Reset(BLT_LoudnessMeter* self)
+{
+    ATX_SetMemory(self->shelf_state,     0, sizeof(self->shelf_state));
+    ATX_SetMemory(self->high_pass_state, 0, sizeof(self->high_pass_state));
+    ATX_SetMemory(self->energy,          0, sizeof(self->energy));
+    ATX_SetMemory(self->blocks,          0, sizeof(self->blocks));
+    ATX_SetMemory(self->histogram,       0, sizeof(self->histogram));
+    self->block_position = 0;
+    self->block_count    = 0;
+    BLT_TruePeakMeter_Reset(&self->true_peak);
+}
+
+/*----------------------------------------------------------------------
+|   BLT_LoudnessMeter_GetMeanSquare
++---------------------------------------------------------------------*/
+static double
+BLT_LoudnessMeter_GetMeanSquare(const BLT_LoudnessMeter* self, BLT_Cardinal block_count)
+{
+    double      sum = 0.0;
+    BLT_Ordinal i;
+
+    for (i=1; i<=block_count; i++) {
+        sum += self->blocks[(self->block_count-i)%BLT_LOUDNESS_METER_SHORT_TERM_BLOCKS];
+    }
+
+    return sum/(double)block_count;
+}
+
+/*----------------------------------------------------------------------
+|   BLT_LoudnessMeter_EndBlock
++---------------------------------------------------------------------*/
+static void
+BLT_LoudnessMeter_EndBlock(BLT_LoudnessMeter* self)
+{
+    double      sum = 0.0;
+    BLT_Ordinal c;
+
+    /* weighted mean square of the sub-block */
+    for (c=0; c<self->channel_count; c++) {
+        sum += self->weights[c]*self->energy[c];
+        self->energy[c] = 0.0;
+    }
+    self->blocks[self->block_count%BLT_LOUDNESS_METER_SHORT_TERM_BLOCKS] = sum/(double)self->block_size;
+    self->block_count++;
+    self->block_position = 0;
+
+    /* the gating blocks are 400ms long, and overlap by 75% */
+    if (self->block_count >= BLT_LOUDNESS_METER_MOMENTARY_BLOCKS) {
+        double mean_square = BLT_LoudnessMeter_GetMeanSquare(self, BLT_LOUDNESS_METER_MOMENTARY_BLOCKS);
+        if (mean_square > 0.0) {
+            double loudness = BLT_Loudness_FromMeanSquare(mean_square);
+            if (loudness > BLT_LOUDNESS_ABSOLUTE_GATE) {
+                int bin = (int)((loudness-BLT_LOUDNESS_ABSOLUTE_GATE)/BLT_LOUDNESS_BIN_WIDTH);
+                if (bin >= BLT_LOUDNESS_METER_HISTOGRAM_BINS) bin = BLT_LOUDNESS_METER_HISTOGRAM_BINS-1;
+                self->histogram[bin].energy += mean_square;
+                self->histogram[bin].count++;
+            }
+        }
+    }
+
+    /* don't let the filters decay into denormals during silence */
+    for (c=0; c<self->channel_count; c++) {
+        if (fabs(self->shelf_state[0][c])     < BLT_LOUDNESS_DENORMAL_LIMIT) self->shelf_state[0][c]     = 0.0;
+        if (fabs(self->shelf_state[1][c])     < BLT_LOUDNESS_DENORMAL_LIMIT) self->shelf_state[1][c]     = 0.0;
+        if (fabs(self->high_pass_state[0][c]) < BLT_LOUDNESS_DENORMAL_LIMIT) self->high_pass_state[0][c] = 0.0;
+        if (fabs(self->high_pass_state[1][c]) < BLT_LOUDNESS_DENORMAL_LIMIT) self->high_pass_state[1][c] = 0.0;
+    }
+}
+
+/*----------------------------------------------------------------------
+|   BLT_LoudnessMeter_Filter
+|
+|   The filters are recursive in time, but the channels are independent:
+|   with SSE2, or NEON on 64-bit ARM, two channels are filtered at once,
+|   one in each lane of a vector of doubles, with the state kept in
+|   registers for the whole run. The operations are those of the scalar
+|   loop, in the same order. The filters use transposed direct form II.
++---------------------------------------------------------------------*/
+static void
+BLT_LoudnessMeter_Filter(BLT_LoudnessMeter* self,
+                         const float*       frames,
+                         BLT_Cardinal       frame_count)
+{
+    const BLT_LoudnessBiquad shelf         = self->shelf;
+    const BLT_LoudnessBiquad high_pass     = self->high_pass;
+    BLT_Cardinal             channel_count = self->channel_count;
+    double*                  s1 = self->shelf_state[0];
+    double*                  s2 = self->shelf_state[1];
+    double*                  h1 = self->high_pass_state[0];
+    double*                  h2 = self->high_pass_state[1];
+    double*                  energy = self->energy;
+    BLT_Ordinal              c = 0;
+    BLT_Ordinal              i;
+
+#if defined(BLT_SIMD_SSE2)
+    for (; c+2 <= channel_count; c += 2) {
+        const __m128d sb0 = _mm_set1_pd(shelf.b0),     sb1 = _mm_set1_pd(shelf.b1);
+        const __m128d sb2 = _mm_set1_pd(shelf.b2),     sa1 = _mm_set1_pd(shelf.a1);
+        const __m128d sa2 = _mm_set1_pd(shelf.a2);
+        const __m128d hb0 = _mm_set1_pd(high_pass.b0), hb1 = _mm_set1_pd(high_pass.b1);
+        const __m128d hb2 = _mm_set1_pd(high_pass.b2), ha1 = _mm_set1_pd(high_pass.a1);
+        const __m128d ha2 = _mm_set1_pd(high_pass.a2);
+        __m128d vs1 = _mm_loadu_pd(s1+c), vs2 = _mm_loadu_pd(s2+c);
+        __m128d vh1 = _mm_loadu_pd(h1+c), vh2 = _mm_loadu_pd(h2+c);
+        __m128d ve  = _mm_loadu_pd(energy+c);
+        const float* frame = frames+c;
+        for (i=0; i<frame_count; i++, frame += channel_count) {
+            __m128d x = _mm_set_pd((double)frame[1], (double)frame[0]);
+            __m128d y = _mm_add_pd(_mm_mul_pd(sb0, x), vs1);
+            __m128d z;
+            vs1 = _mm_add_pd(_mm_sub_pd(_mm_mul_pd(sb1, x), _mm_mul_pd(sa1, y)), vs2);
+            vs2 = _mm_sub_pd(_mm_mul_pd(sb2, x), _mm_mul_pd(sa2, y));
+            z   = _mm_add_pd(_mm_mul_pd(hb0, y), vh1);
+            vh1 = _mm_add_pd(_mm_sub_pd(_mm_mul_pd(hb1, y), _mm_mul_pd(ha1, z)), vh2);
+            vh2 = _mm_sub_pd(_mm_mul_pd(hb2, y), _mm_mul_pd(ha2, z));
+            ve  = _mm_add_pd(ve, _mm_mul_pd(z, z));
+        }
+        _mm_storeu_pd(s1+c, vs1); _mm_storeu_pd(s2+c, vs2);
+        _mm_storeu_pd(h1+c, vh1); _mm_storeu_pd(h2+c, vh2);
+        _mm_storeu_pd(energy+c, ve);
+    }
+#elif defined(BLT_SIMD_NEON) && defined(__aarch64__)
+    for (; c+2 <= channel_count; c += 2) {
+        float64x2_t vs1 = vld1q_f64(s1+c), vs2 = vld1q_f64(s2+c);
+        float64x2_t vh1 = vld1q_f64(h1+c), vh2 = vld1q_f64(h2+c);
+        float64x2_t ve  = vld1q_f64(energy+c);
+        const float* frame = frames+c;
+        for (i=0; i<frame_count; i++, frame += channel_count) {
+            float64x2_t x = vcvt_f64_f32(vld1_f32(frame));
+            float64x2_t y = vaddq_f64(vmulq_n_f64(x, shelf.b0), vs1);
+            float64x2_t z;
+            vs1 = vaddq_f64(vsubq_f64(vmulq_n_f64(x, shelf.b1), vmulq_n_f64(y, shelf.a1)), vs2);
+            vs2 = vsubq_f64(vmulq_n_f64(x, shelf.b2), vmulq_n_f64(y, shelf.a2));
+            z   = vaddq_f64(vmulq_n_f64(y, high_pass.b0), vh1);
+            vh1 = vaddq_f64(vsubq_f64(vmulq_n_f64(y, high_pass.b1), vmulq_n_f64(z, high_pass.a1)), vh2);
+            vh2 = vsubq_f64(vmulq_n_f64(y, high_pass.b2), vmulq_n_f64(z, high_pass.a2));
+            ve  = vaddq_f64(ve, vmulq_f64(z, z));
+        }
+        vst1q_f64(s1+c, vs1); vst1q_f64(s2+c, vs2);
+        vst1q_f64(h1+c, vh1); vst1q_f64(h2+c, vh2);
+        vst1q_f64(energy+c, ve);
+    }
+#endif
+
+    /* the channels left, if any */
+    for (i=0; c<channel_count && i<frame_count; i++) {
+        const float* frame = frames+i*channel_count;
+        BLT_Ordinal  k;
+        for (k=c; k<channel_count; k++) {
+            double x = (double)frame[k];
+            double y = shelf.b0*x+s1[k];
+            double z;
+            s1[k] = shelf.b1*x-shelf.a1*y+s2[k];
+            s2[k] = shelf.b2*x-shelf.a2*y;
+            z     = high_pass.b0*y+h1[k];
+            h1[k] = high_pass.b1*y-high_pass.a1*z+h2[k];
+            h2[k] = high_pass.b2*y-high_pass.a2*z;
+            energy[k] += z*z;
+        }
+    }
+}
+
+/*----------------------------------------------------------------------
+|   BLT_LoudnessMeter_Process
++---------------------------------------------------------------------*/
+void
+BLT_LoudnessMeter_Process(BLT_LoudnessMeter* self,
+                          const float*       samples,
+                          BLT_Cardinal       frame_count)
+{
+    const float* frames = samples;
+    BLT_Cardinal left   = frame_count;
+
+    /* true peak, on the whole buffer at once */
+    BLT_TruePeakMeter_Process(&self->true_peak, samples, frame_count, NULL);
+
+    while (left) {
+        BLT_Cardinal run = self->block_size-self->block_position;
+        if (run > left) run = left;
+
+        BLT_LoudnessMeter_Filter(self, frames, run);
+
+        frames += run*self->channel_count;
+        left   -= run;
+        self->block_position += run;
+        if (self->block_position == self->block_size) {
+            BLT_LoudnessMeter_EndBlock(self);
+        }
+    }
+}
+
+/*----------------------------------------------------------------------
+|   BLT_LoudnessMeter_GetMomentary
++---------------------------------------------------------------------*/
+BLT_Result
+BLT_LoudnessMeter_GetMomentary(const BLT_LoudnessMeter* self, double* loudness)
+{
+    double mean_square;
+
+    if (self->block_count < BLT_LOUDNESS_METER_MOMENTARY_BLOCKS) return BLT_FAILURE;
+    mean_square = BLT_LoudnessMeter_GetMeanSquare(self, BLT_LOUDNESS_METER_MOMENTARY_BLOCKS);
+    if (mean_square <= 0.0) return BLT_FAILURE;
+    *loudness = BLT_Loudness_FromMeanSquare(mean_square);
+
+    return BLT_SUCCESS;
+}
+
+/*----------------------------------------------------------------------
+|   BLT_LoudnessMeter_GetShortTerm
++---------------------------------------------------------------------*/
+BLT_Result
+BLT_LoudnessMeter_GetShortTerm(const BLT_LoudnessMeter* self, double* loudness)
+{
+    double mean_square;
+
+    if (self->block_count < BLT_LOUDNESS_METER_SHORT_TERM_BLOCKS) return BLT_FAILURE;
+    mean_square = BLT_LoudnessMeter_GetMeanSquare(self, BLT_LOUDNESS_METER_SHORT_TERM_BLOCKS);
+    if (mean_square <= 0.0) return BLT_FAILURE;
+    *loudness = BLT_Loudness_FromMeanSquare(mean_square);
+
+    return BLT_SUCCESS;
+}
+
+/*----------------------------------------------------------------------
+|   BLT_LoudnessMeter_GetIntegrated
++---------------------------------------------------------------------*/
+BLT_Result
+BLT_LoudnessMeter_GetIntegrated(const BLT_LoudnessMeter* self, double* loudness)
+{
+    double     energy = 0.0;
+    BLT_UInt32 count  = 0;
+    double     gate;
+    int        first;
+    int        bin;
+
+    /* loudness of the blocks above the absolute gate */
+    for (bin=0; bin<BLT_LOUDNESS_METER_HISTOGRAM_BINS; bin++) {
+        energy += self->histogram[bin].energy;
+        count  += self->histogram[bin].count;
+    }
+    if (count == 0) return BLT_FAILURE;
+
+    /* keep the blocks above the relative gate. A bin is kept when its */
+    /* center is above the gate                                        */
+    gate  = BLT_Loudness_FromMeanSquare(energy/(double)count)+BLT_LOUDNESS_RELATIVE_GATE;
+    first = (int)floor((gate-BLT_LOUDNESS_ABSOLUTE_GATE)/BLT_LOUDNESS_BIN_WIDTH-0.5)+1;
+    if (first < 0) first = 0;
+    energy = 0.0;
+    count  = 0;
+    for (bin=first; bin<BLT_LOUDNESS_METER_HISTOGRAM_BINS; bin++) {
+        energy += self->histogram[bin].energy;
+        count  += self->histogram[bin].count;
+    }
+    if (count == 0) return BLT_FAILURE;
+    *loudness = BLT_Loudness_FromMeanSquare(energy/(double)count);
+
+    return BLT_SUCCESS;
+}
+
+/*----------------------------------------------------------------------
+|   BLT_LoudnessMeter_GetTruePeak
++---------------------------------------------------------------------*/
+float
+BLT_LoudnessMeter_GetTruePeak(const BLT_LoudnessMeter* self)
+{
+    return self->true_peak.peak;
+}
@@ -0,0 +1,140 @@
+/*****************************************************************
+|
+|   BlueTune - Loudness Meter
+|
+|   (c) 2002-2012 Gilles Boccon-Gibod
+|   Author: Gilles Boccon-Gibod (bok@bok.net)
+|
+ ****************************************************************/
+/** @file
+ * Loudness meter: measures the momentary, short-term and integrated
+ * loudness of a signal as specified in ITU-R BS.1770 and EBU R128,
+ * as well as its true peak.
+ */
+
+#ifndef _BLT_LOUDNESS_H_
+#define _BLT_LOUDNESS_H_
+
+/*----------------------------------------------------------------------
+|   includes
++---------------------------------------------------------------------*/
+#include "BltTypes.h"
+#include "BltTruePeak.h"
+
+/*----------------------------------------------------------------------
+|   constants
++---------------------------------------------------------------------*/
+#define BLT_LOUDNESS_METER_MAX_CHANNELS BLT_TRUE_PEAK_METER_MAX_CHANNELS
+
+/** Reference loudness of ReplayGain 2.0, in LUFS */
+#define BLT_LOUDNESS_REPLAY_GAIN_REFERENCE (-18.0)
+
+/** Blocks quieter than this are ignored by the integrated loudness */
+#define BLT_LOUDNESS_ABSOLUTE_GATE         (-70.0)
+
+/* sub-blocks of 100ms: momentary loudness is measured over 4, and */
+/* short-term loudness over 30                                     */
+#define BLT_LOUDNESS_METER_MOMENTARY_BLOCKS  4
+#define BLT_LOUDNESS_METER_SHORT_TERM_BLOCKS 30
+
+/* the gated blocks are accumulated in a histogram with bins of */
+/* 0.1 LU, from the absolute gate up to +30 LUFS                */
+#define BLT_LOUDNESS_METER_HISTOGRAM_BINS    1000
+
+/*----------------------------------------------------------------------
+|   types
++---------------------------------------------------------------------*/
+typedef struct {
+    double       b0, b1, b2, a1, a2;
+} BLT_LoudnessBiquad;
+
+typedef struct {
+    BLT_Cardinal       channel_count;
+    BLT_Cardinal       sample_rate;
+    double             weights[BLT_LOUDNESS_METER_MAX_CHANNELS];
+
+    /* K-weighting filter: a high shelf followed by a high pass */
+    BLT_LoudnessBiquad shelf;
+    BLT_LoudnessBiquad high_pass;
+    double             shelf_state[2][BLT_LOUDNESS_METER_MAX_CHANNELS];
+    double             high_pass_state[2][BLT_LOUDNESS_METER_MAX_CHANNELS];
+
+    /* energy of the current 100ms sub-block */
+    double             energy[BLT_LOUDNESS_METER_MAX_CHANNELS];
+    BLT_Cardinal       block_size;
+    BLT_Cardinal       block_position;
+
+    /* mean square of the last 30 sub-blocks */
+    double             blocks[BLT_LOUDNESS_METER_SHORT_TERM_BLOCKS];
+    BLT_Cardinal       block_count;
+
+    /* gated blocks */
+    struct {
+        double       energy;
+        BLT_UInt32   count;
+    }                  histogram[BLT_LOUDNESS_METER_HISTOGRAM_BINS];
+
+    BLT_TruePeakMeter  true_peak;
+} BLT_LoudnessMeter;
+
+/*----------------------------------------------------------------------
+|   prototypes
++---------------------------------------------------------------------*/
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/**
+ * Initialize a meter.
+ * @param channel_mask BLT_PCM_SPEAKER_XXX bits of the channels, used to
+ * weight the surround channels and ignore the LFE channel. When 0, the
+ * usual WAVE channel order is assumed.
+ * Returns BLT_ERROR_NOT_SUPPORTED if there are more than
+ * BLT_LOUDNESS_METER_MAX_CHANNELS channels.
+ */
+BLT_Result BLT_LoudnessMeter_Init(BLT_LoudnessMeter* self,
+                                  BLT_Cardinal       sample_rate,
+                                  BLT_Cardinal       channel_count,
+                                  BLT_UInt32         channel_mask);
+
+/**
+ * Forget everything measured so far.
+ */
+void BLT_LoudnessMeter_Reset(BLT_LoudnessMeter* self);
+
+/**
+ * Measure a buffer of interleaved float samples.
+ */
+void BLT_LoudnessMeter_Process(BLT_LoudnessMeter* self,
+                               const float*       samples,
+                               BLT_Cardinal       frame_count);
+
+/**
+ * Loudness of the last 400ms, in LUFS.
+ * Returns BLT_FAILURE if less than 400ms have been measured.
+ */
+BLT_Result BLT_LoudnessMeter_GetMomentary(const BLT_LoudnessMeter* self, double* loudness);
+
+/**
+ * Loudness of the last 3s, in LUFS.
+ * Returns BLT_FAILURE if less than 3s have been measured.
+ */
+BLT_Result BLT_LoudnessMeter_GetShortTerm(const BLT_LoudnessMeter* self, double* loudness);
+
+/**
+ * Gated loudness of everything measured since the last reset, in LUFS.
+ * Returns BLT_FAILURE if nothing louder than the absolute gate has been
+ * measured.
+ */
+BLT_Result BLT_LoudnessMeter_GetIntegrated(const BLT_LoudnessMeter* self, double* loudness);
+
+/**
+ * Largest true peak since the last reset, as a linear value.
+ */
+float BLT_LoudnessMeter_GetTruePeak(const BLT_LoudnessMeter* self);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* _BLT_LOUDNESS_H_ */
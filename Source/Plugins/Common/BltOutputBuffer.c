@@ -0,0 +1,428 @@
+/*****************************************************************
+|
+|   BlueTune - Output Buffer
+|
+|   (c) 2002-2012 Gilles Boccon-Gibod
+|   Author: Gilles Boccon-Gibod (bok@bok.net)
+|
+ ****************************************************************/
+
+/*----------------------------------------------------------------------
+|   includes
++---------------------------------------------------------------------*/
+#include "Atomix.h"
+#include "BltTypes.h"
+#include "BltErrors.h"
+#include "BltMemoryBarrier.h"
+#include "BltOutputBuffer.h"
+
+/*----------------------------------------------------------------------
+|   constants
++---------------------------------------------------------------------*/
+#define BLT_OUTPUT_BUFFER_MAX_CAPACITY  0x40000000
+#define BLT_OUTPUT_BUFFER_MAX_FRAME_SIZE 64
+
+/*----------------------------------------------------------------------
+|   types
++---------------------------------------------------------------------*/
+/* written by the consumer only */
+typedef struct {
+    BLT_UInt64   frames_read;
+    BLT_Cardinal underruns;
+    BLT_UInt64   underrun_frames;
+    BLT_Cardinal delay;
+    ATX_Int64    delay_time;
+    BLT_Boolean  delay_running;
+} BLT_OutputBufferDeviceState;
+
+struct BLT_OutputBuffer {
+    BLT_Cardinal     capacity;       /* frames, a power of 2 */
+    BLT_Cardinal     full_threshold;
+    BLT_PcmMediaType format;
+    BLT_Size         frame_size;
+    unsigned char    silence[BLT_OUTPUT_BUFFER_MAX_FRAME_SIZE];
+    unsigned char*   samples;
+
+    /* free running frame counters, modulo 2^32 */
+    volatile BLT_UInt32 write_count; /* written by the producer */
+    volatile BLT_UInt32 read_count;  /* written by the consumer */
+
+    /* producer state */
+    volatile BLT_Boolean draining;
+    BLT_UInt64           frames_written;
+    BLT_UInt64           time_base_frame; /* value of frames_written at time_base */
+    BLT_UInt64           time_base;       /* ns */
+    BLT_Cardinal         overruns;
+    BLT_UInt64           overrun_frames;
+    BLT_Cardinal         max_fill;
+    BLT_Cardinal         reported_underruns;
+
+    /* consumer state, odd sequence numbers while it changes */
+    volatile BLT_UInt32         device_sequence;
+    BLT_OutputBufferDeviceState device;
+};
+
+/*----------------------------------------------------------------------
+|   BLT_OutputBuffer_Create
++---------------------------------------------------------------------*/
+BLT_Result
+BLT_OutputBuffer_Create(BLT_Cardinal       capacity,
+                        BLT_Cardinal       full_threshold,
+                        BLT_OutputBuffer** buffer)
+{
+    BLT_OutputBuffer* self;
+    BLT_Cardinal      size = 1;
+
+    *buffer = NULL;
+    if (capacity == 0 || capacity > BLT_OUTPUT_BUFFER_MAX_CAPACITY) {
+        return BLT_ERROR_INVALID_PARAMETERS;
+    }
+    while (size < capacity) size <<= 1;
+
+    self = (BLT_OutputBuffer*)ATX_AllocateZeroMemory(sizeof(BLT_OutputBuffer));
+    if (self == NULL) return BLT_ERROR_OUT_OF_MEMORY;
+    self->capacity       = size;
+    self->full_threshold = full_threshold ? full_threshold : size-size/4;
+    if (self->full_threshold > size) self->full_threshold = size;
+    BLT_PcmMediaType_Init(&self->format);
+
+    *buffer = self;
+    return BLT_SUCCESS;
+}
+
+/*----------------------------------------------------------------------
+|   BLT_OutputBuffer_Destroy
++---------------------------------------------------------------------*/
+void
+BLT_OutputBuffer_Destroy(BLT_OutputBuffer* self)
+{
+    if (self == NULL) return;
+    if (self->samples) ATX_FreeMemory(self->samples);
+    ATX_FreeMemory(self);
+}
+
+/*----------------------------------------------------------------------
+|   BLT_OutputBuffer_SetFormat
++---------------------------------------------------------------------*/
+BLT_Result
+BLT_OutputBuffer_SetFormat(BLT_OutputBuffer*       self,
+                           const BLT_PcmMediaType* format)
+{
+    BLT_Size    frame_size  = format->channel_count*format->bits_per_sample/8;
+    BLT_Size    sample_size = format->bits_per_sample/8;
+    BLT_Ordinal i;
+
+    if (format->sample_rate == 0 || frame_size == 0 ||
+        frame_size > BLT_OUTPUT_BUFFER_MAX_FRAME_SIZE) {
+        return BLT_ERROR_INVALID_MEDIA_FORMAT;
+    }
+
+    /* (re)allocate the samples if the frame size changes */
+    if (frame_size != self->frame_size || self->samples == NULL) {
+        if (self->samples) ATX_FreeMemory(self->samples);
+        self->frame_size = 0;
+        self->samples    = (unsigned char*)ATX_AllocateMemory(self->capacity*frame_size);
+        if (self->samples == NULL) return BLT_ERROR_OUT_OF_MEMORY;
+        self->frame_size = frame_size;
+    }
+    self->format = *format;
+
+    /* unsigned samples are silent half way up their range */
+    ATX_SetMemory(self->silence, 0, sizeof(self->silence));
+    if (format->sample_format == BLT_PCM_SAMPLE_FORMAT_UNSIGNED_INT_LE) {
+        for (i=sample_size-1; i<frame_size; i+=sample_size) self->silence[i] = 0x80;
+    } else if (format->sample_format == BLT_PCM_SAMPLE_FORMAT_UNSIGNED_INT_BE) {
+        for (i=0; i<frame_size; i+=sample_size) self->silence[i] = 0x80;
+    }
+
+    BLT_OutputBuffer_Reset(self);
+
+    return BLT_SUCCESS;
+}
+
+/*----------------------------------------------------------------------
+|   BLT_OutputBuffer_Reset
++---------------------------------------------------------------------*/
+void
+BLT_OutputBuffer_Reset(BLT_OutputBuffer* self)
+{
+    self->write_count = 0;
+    self->read_count  = 0;
+    self->draining    = BLT_FALSE;
+
+    /* frames written from now on follow on from the ones dropped */
+    if (self->format.sample_rate) {
+        self->time_base += ((self->frames_written-self->time_base_frame)*1000000000)/
+                           self->format.sample_rate;
+    }
+    self->time_base_frame = self->frames_written;
+
+    /* what the device had is gone too */
+    self->device_sequence++;
+    BLT_MEMORY_BARRIER();
+    self->device.delay         = 0;
+    self->device.delay_running = BLT_FALSE;
+    BLT_MEMORY_BARRIER();
+    self->device_sequence++;
+}
+
+/*----------------------------------------------------------------------
+|   BLT_OutputBuffer_GetCapacity
++---------------------------------------------------------------------*/
+BLT_Cardinal
+BLT_OutputBuffer_GetCapacity(const BLT_OutputBuffer* self)
+{
+    return self->capacity;
+}
+
+/*----------------------------------------------------------------------
+|   BLT_OutputBuffer_GetFill
++---------------------------------------------------------------------*/
+BLT_Cardinal
+BLT_OutputBuffer_GetFill(const BLT_OutputBuffer* self)
+{
+    BLT_UInt32 fill = self->write_count-self->read_count;
+    BLT_MEMORY_BARRIER();
+    return fill;
+}
+
+/*----------------------------------------------------------------------
+|   BLT_OutputBuffer_GetDeviceState
++---------------------------------------------------------------------*/
+static void
+BLT_OutputBuffer_GetDeviceState(const BLT_OutputBuffer*      self,
+                                BLT_OutputBufferDeviceState* state)
+{
+    for (;;) {
+        BLT_UInt32 sequence = self->device_sequence;
+        BLT_MEMORY_BARRIER();
+        if ((sequence&1) == 0) {
+            *state = self->device;
+            BLT_MEMORY_BARRIER();
+            if (self->device_sequence == sequence) return;
+        }
+    }
+}
+
+/*----------------------------------------------------------------------
+|   BLT_OutputBuffer_SetMediaTime
++---------------------------------------------------------------------*/
+void
+BLT_OutputBuffer_SetMediaTime(BLT_OutputBuffer* self,
+                              BLT_TimeStamp     media_time)
+{
+    self->time_base_frame = self->frames_written;
+    self->time_base       = BLT_TimeStamp_ToNanos(media_time);
+}
+
+/*----------------------------------------------------------------------
+|   BLT_OutputBuffer_Write
++---------------------------------------------------------------------*/
+BLT_Cardinal
+BLT_OutputBuffer_Write(BLT_OutputBuffer* self,
+                       const void*       samples,
+                       BLT_Cardinal      frame_count)
+{
+    const unsigned char* source = (const unsigned char*)samples;
+    BLT_UInt32           write_count = self->write_count;
+    BLT_Cardinal         fill = BLT_OutputBuffer_GetFill(self);
+    BLT_Cardinal         space = self->capacity-fill;
+    BLT_Cardinal         done;
+
+    if (self->samples == NULL) return 0;
+    if (frame_count > space) frame_count = space;
+
+    /* copy, in two runs when the samples wrap around */
+    for (done=0; done<frame_count;) {
+        BLT_Cardinal position = (write_count+done)&(self->capacity-1);
+        BLT_Cardinal run      = self->capacity-position;
+        if (run > frame_count-done) run = frame_count-done;
+        ATX_CopyMemory(self->samples+position*self->frame_size,
+                       source+done*self->frame_size,
+                       run*self->frame_size);
+        done += run;
+    }
+
+    /* publish the frames */
+    BLT_MEMORY_BARRIER();
+    self->write_count     = write_count+frame_count;
+    self->frames_written += frame_count;
+    if (frame_count) self->draining = BLT_FALSE;
+    if (fill+frame_count > self->max_fill) self->max_fill = fill+frame_count;
+
+    return frame_count;
+}
+
+/*----------------------------------------------------------------------
+|   BLT_OutputBuffer_ReportOverrun
++---------------------------------------------------------------------*/
+void
+BLT_OutputBuffer_ReportOverrun(BLT_OutputBuffer* self,
+                               BLT_Cardinal      lost_frames)
+{
+    if (lost_frames == 0) return;
+    self->overruns++;
+    self->overrun_frames += lost_frames;
+}
+
+/*----------------------------------------------------------------------
+|   BLT_OutputBuffer_SetDraining
++---------------------------------------------------------------------*/
+void
+BLT_OutputBuffer_SetDraining(BLT_OutputBuffer* self)
+{
+    self->draining = BLT_TRUE;
+}
+
+/*----------------------------------------------------------------------
+|   BLT_OutputBuffer_GetStatus
++---------------------------------------------------------------------*/
+void
+BLT_OutputBuffer_GetStatus(BLT_OutputBuffer*     self,
+                           ATX_Int64             now,
+                           BLT_OutputNodeStatus* status)
+{
+    BLT_OutputBufferDeviceState device;
+    BLT_Cardinal                fill;
+    BLT_UInt64                  latency;
+    BLT_UInt64                  heard;
+    BLT_UInt32                  sample_rate = self->format.sample_rate;
+
+    BLT_OutputBuffer_GetDeviceState(self, &device);
+    fill = BLT_OutputBuffer_GetFill(self);
+
+    /* the device keeps playing after it measured its delay */
+    latency = device.delay;
+    if (device.delay_running && now > device.delay_time && sample_rate) {
+        BLT_UInt64 elapsed = ((BLT_UInt64)(now-device.delay_time)*sample_rate)/1000000000;
+        latency = elapsed < latency ? latency-elapsed : 0;
+    }
+    latency += fill;
+
+    /* media time of the frame being heard, which cannot be earlier */
+    /* than the media time of the first frame written since then    */
+    status->flags      = 0;
+    status->media_time = BLT_TimeStamp_FromNanos(self->time_base);
+    heard = latency < self->frames_written ? self->frames_written-latency : 0;
+    if (heard > self->time_base_frame && sample_rate) {
+        status->media_time = BLT_TimeStamp_FromNanos(self->time_base+
+                                                     ((heard-self->time_base_frame)*1000000000)/sample_rate);
+    }
+
+    if (fill >= self->full_threshold) {
+        status->flags |= BLT_OUTPUT_NODE_STATUS_QUEUE_FULL;
+    }
+    if (device.underruns != self->reported_underruns) {
+        status->flags |= BLT_OUTPUT_NODE_STATUS_UNDERFLOW;
+        self->reported_underruns = device.underruns;
+    }
+}
+
+/*----------------------------------------------------------------------
+|   BLT_OutputBuffer_GetStats
++---------------------------------------------------------------------*/
+void
+BLT_OutputBuffer_GetStats(const BLT_OutputBuffer* self,
+                          BLT_OutputBufferStats*  stats)
+{
+    BLT_OutputBufferDeviceState device;
+
+    BLT_OutputBuffer_GetDeviceState(self, &device);
+    stats->frames_written  = self->frames_written;
+    stats->frames_read     = device.frames_read;
+    stats->underruns       = device.underruns;
+    stats->underrun_frames = device.underrun_frames;
+    stats->overruns        = self->overruns;
+    stats->overrun_frames  = self->overrun_frames;
+    stats->fill            = BLT_OutputBuffer_GetFill(self);
+    stats->max_fill        = self->max_fill;
+    stats->device_delay    = device.delay;
+}
+
+/*----------------------------------------------------------------------
+|   BLT_OutputBuffer_Read
++---------------------------------------------------------------------*/
+BLT_Cardinal
+BLT_OutputBuffer_Read(BLT_OutputBuffer* self,
+                      void*             samples,
+                      BLT_Cardinal      frame_count,
+                      BLT_Boolean       pad)
+{
+    unsigned char* destination = (unsigned char*)samples;
+    BLT_UInt32     read_count  = self->read_count;
+    BLT_Cardinal   available   = BLT_OutputBuffer_GetFill(self);
+    BLT_Cardinal   copied;
+    BLT_Cardinal   done;
+
+    copied = frame_count < available ? frame_count : available;
+    for (done=0; done<copied;) {
+        BLT_Cardinal position = (read_count+done)&(self->capacity-1);
+        BLT_Cardinal run      = self->capacity-position;
+        if (run > copied-done) run = copied-done;
+        ATX_CopyMemory(destination+done*self->frame_size,
+                       self->samples+position*self->frame_size,
+                       run*self->frame_size);
+        done += run;
+    }
+
+    /* give the space back to the producer */
+    BLT_MEMORY_BARRIER();
+    self->read_count = read_count+copied;
+
+    if (pad) {
+        BLT_Cardinal missing = frame_count-copied;
+        for (done=copied; done<frame_count; done++) {
+            ATX_CopyMemory(destination+done*self->frame_size, self->silence, self->frame_size);
+        }
+        self->device_sequence++;
+        BLT_MEMORY_BARRIER();
+        self->device.frames_read += frame_count;
+        if (missing && !self->draining) {
+            self->device.underruns++;
+            self->device.underrun_frames += missing;
+        }
+        BLT_MEMORY_BARRIER();
+        self->device_sequence++;
+    } else if (copied) {
+        self->device_sequence++;
+        BLT_MEMORY_BARRIER();
+        self->device.frames_read += copied;
+        BLT_MEMORY_BARRIER();
+        self->device_sequence++;
+    }
+
+    return copied;
+}
+
+/*----------------------------------------------------------------------
+|   BLT_OutputBuffer_ReportUnderrun
++---------------------------------------------------------------------*/
+void
+BLT_OutputBuffer_ReportUnderrun(BLT_OutputBuffer* self,
+                                BLT_Cardinal      lost_frames)
+{
+    self->device_sequence++;
+    BLT_MEMORY_BARRIER();
+    self->device.underruns++;
+    self->device.underrun_frames += lost_frames;
+    BLT_MEMORY_BARRIER();
+    self->device_sequence++;
+}
+
+/*----------------------------------------------------------------------
+|   BLT_OutputBuffer_SetDeviceDelay
++---------------------------------------------------------------------*/
+void
+BLT_OutputBuffer_SetDeviceDelay(BLT_OutputBuffer* self,
+                                BLT_Cardinal      delay,
+                                ATX_Int64         now,
+                                BLT_Boolean       running)
+{
+    self->device_sequence++;
+    BLT_MEMORY_BARRIER();
+    self->device.delay         = delay;
+    self->device.delay_time    = now;
+    self->device.delay_running = running;
+    BLT_MEMORY_BARRIER();
+    self->device_sequence++;
+}
@@ -0,0 +1,185 @@
+/*****************************************************************
+|
+|   BlueTune - Output Buffer
+|
+|   (c) 2002-2012 Gilles Boccon-Gibod
+|   Author: Gilles Boccon-Gibod (bok@bok.net)
+|
+ ****************************************************************/
+/** @file
+ * Output Buffer: a bounded PCM FIFO between an output node and the
+ * device it feeds, with the bookkeeping that every audio output needs:
+ * the media time of the frame being heard (the render clock), the
+ * latency of the buffer and of the device, and underrun and overrun
+ * statistics.
+ * The node writes to the buffer from the stream thread (the producer)
+ * and the device side reads from it, from the same thread or from its
+ * own render thread (the consumer). Neither side ever waits for the
+ * other: an output that needs to block until there is room does so
+ * with its own means.
+ * The buffer never reads the system clock. Times are passed in by the
+ * caller, so that a simulated device clock gives deterministic results.
+ */
+
+#ifndef _BLT_OUTPUT_BUFFER_H_
+#define _BLT_OUTPUT_BUFFER_H_
+
+/*----------------------------------------------------------------------
+|   includes
++---------------------------------------------------------------------*/
+#include "BltTypes.h"
+#include "BltTime.h"
+#include "BltPcm.h"
+#include "BltOutputNode.h"
+
+/*----------------------------------------------------------------------
+|   types
++---------------------------------------------------------------------*/
+typedef struct {
+    BLT_UInt64   frames_written;
+    BLT_UInt64   frames_read;     /**< including the silence inserted by underruns */
+    BLT_Cardinal underruns;       /**< times the device side found too few frames  */
+    BLT_UInt64   underrun_frames; /**< frames of silence played because of them    */
+    BLT_Cardinal overruns;        /**< times the producer dropped frames           */
+    BLT_UInt64   overrun_frames;  /**< frames dropped because of them              */
+    BLT_Cardinal fill;            /**< frames in the buffer                        */
+    BLT_Cardinal max_fill;        /**< highest fill since the buffer was created   */
+    BLT_Cardinal device_delay;    /**< frames read but not yet heard               */
+} BLT_OutputBufferStats;
+
+typedef struct BLT_OutputBuffer BLT_OutputBuffer;
+
+/*----------------------------------------------------------------------
+|   prototypes
++---------------------------------------------------------------------*/
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/**
+ * Create a buffer.
+ * @param capacity Number of frames that the buffer can hold, rounded up
+ * to a power of 2.
+ * @param full_threshold Fill, in frames, from which the status of the
+ * buffer has the BLT_OUTPUT_NODE_STATUS_QUEUE_FULL flag, or 0 for 3/4
+ * of the capacity.
+ */
+BLT_Result BLT_OutputBuffer_Create(BLT_Cardinal       capacity,
+                                   BLT_Cardinal       full_threshold,
+                                   BLT_OutputBuffer** buffer);
+
+void BLT_OutputBuffer_Destroy(BLT_OutputBuffer* self);
+
+/**
+ * Set the format of the frames, and empty the buffer.
+ * The consumer must not be reading while the format changes.
+ */
+BLT_Result BLT_OutputBuffer_SetFormat(BLT_OutputBuffer*       self,
+                                      const BLT_PcmMediaType* format);
+
+/**
+ * Empty the buffer, for example after a seek or when the output stops.
+ * The consumer must not be reading while the buffer is reset.
+ * The statistics are kept, and frames written next follow on from the
+ * dropped ones in media time, unless a new media time is set.
+ */
+void BLT_OutputBuffer_Reset(BLT_OutputBuffer* self);
+
+BLT_Cardinal BLT_OutputBuffer_GetCapacity(const BLT_OutputBuffer* self);
+
+/**
+ * Number of frames in the buffer. May be called from either side.
+ */
+BLT_Cardinal BLT_OutputBuffer_GetFill(const BLT_OutputBuffer* self);
+
+/*----------------------------------------------------------------------
+|   producer side
++---------------------------------------------------------------------*/
+
+/**
+ * Set the media time of the next frame written, typically the time
+ * stamp of the packet about to be written. Frames written without a
+ * new media time follow on from the previous ones.
+ */
+void BLT_OutputBuffer_SetMediaTime(BLT_OutputBuffer* self,
+                                   BLT_TimeStamp     media_time);
+
+/**
+ * Copy frames to the buffer.
+ * @return The number of frames copied, which is less than frame_count
+ * if the buffer does not have room for all of them. The producer then
+ * waits and writes the rest, or drops them and reports an overrun.
+ */
+BLT_Cardinal BLT_OutputBuffer_Write(BLT_OutputBuffer* self,
+                                    const void*       samples,
+                                    BLT_Cardinal      frame_count);
+
+/**
+ * Count frames that the producer dropped because the buffer was full.
+ */
+void BLT_OutputBuffer_ReportOverrun(BLT_OutputBuffer* self,
+                                    BLT_Cardinal      lost_frames);
+
+/**
+ * Tell the buffer that no more frames are coming for now (end of
+ * stream or drain), so that running out of frames is not an underrun.
+ * Writing frames clears the condition.
+ */
+void BLT_OutputBuffer_SetDraining(BLT_OutputBuffer* self);
+
+/**
+ * Compute the status of an output node fed through this buffer: the
+ * media time of the frame being heard at time 'now', and the
+ * BLT_OUTPUT_NODE_STATUS_QUEUE_FULL and BLT_OUTPUT_NODE_STATUS_UNDERFLOW
+ * flags. The underflow flag is reported once for each series of
+ * underruns.
+ * @param now Current time, in nanoseconds, on the clock used by the
+ * consumer in BLT_OutputBuffer_SetDeviceDelay.
+ */
+void BLT_OutputBuffer_GetStatus(BLT_OutputBuffer*     self,
+                                ATX_Int64             now,
+                                BLT_OutputNodeStatus* status);
+
+void BLT_OutputBuffer_GetStats(const BLT_OutputBuffer* self,
+                               BLT_OutputBufferStats*  stats);
+
+/*----------------------------------------------------------------------
+|   consumer side
++---------------------------------------------------------------------*/
+
+/**
+ * Copy frames from the buffer.
+ * @param pad If true, the frames that the buffer does not have are
+ * replaced by silence, and counted as an underrun unless the buffer is
+ * draining. If false, only the frames in the buffer are copied.
+ * @return The number of frames taken from the buffer, not counting
+ * the silence.
+ */
+BLT_Cardinal BLT_OutputBuffer_Read(BLT_OutputBuffer* self,
+                                   void*             samples,
+                                   BLT_Cardinal      frame_count,
+                                   BLT_Boolean       pad);
+
+/**
+ * Count an underrun detected by the device itself.
+ * @param lost_frames Frames of silence played, if known.
+ */
+void BLT_OutputBuffer_ReportUnderrun(BLT_OutputBuffer* self,
+                                     BLT_Cardinal      lost_frames);
+
+/**
+ * Publish the latency of the device: the frames it has read from the
+ * buffer that have not been heard yet, measured at time 'now' (in
+ * nanoseconds). While the device is running, the render clock
+ * extrapolates from the last measurement.
+ */
+void BLT_OutputBuffer_SetDeviceDelay(BLT_OutputBuffer* self,
+                                     BLT_Cardinal      delay,
+                                     ATX_Int64         now,
+                                     BLT_Boolean       running);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* _BLT_OUTPUT_BUFFER_H_ */
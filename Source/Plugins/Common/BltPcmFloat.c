@@ -0,0 +1,183 @@
+/*****************************************************************
+|
+|   BlueTune - PCM Float Conversion
+|
+|   (c) 2002-2012 Gilles Boccon-Gibod
+|   Author: Gilles Boccon-Gibod (bok@bok.net)
+|
+ ****************************************************************/
+
+/*----------------------------------------------------------------------
+|   includes
++---------------------------------------------------------------------*/
+#include "Atomix.h"
+#include "BltTypes.h"
+#include "BltPcm.h"
+#include "BltPcmFloat.h"
+
+/*----------------------------------------------------------------------
+|   constants
++---------------------------------------------------------------------*/
+#define BLT_PCM_FLOAT_SCALE_8  128.0f
+#define BLT_PCM_FLOAT_SCALE_16 32768.0f
+#define BLT_PCM_FLOAT_SCALE_24 8388608.0f
+#define BLT_PCM_FLOAT_SCALE_32 2147483648.0
+
+/*----------------------------------------------------------------------
+|   BLT_PcmFloat_SupportsFormat
++---------------------------------------------------------------------*/
+BLT_Boolean
+BLT_PcmFloat_SupportsFormat(const BLT_PcmMediaType* format)
+{
+    if (format->channel_count == 0) return BLT_FALSE;
+    switch (format->bits_per_sample) {
+      case 8:
+        return format->sample_format == BLT_PCM_SAMPLE_FORMAT_UNSIGNED_INT_LE ||
+               format->sample_format == BLT_PCM_SAMPLE_FORMAT_UNSIGNED_INT_BE;
+
+      case 16:
+        return format->sample_format == BLT_PCM_SAMPLE_FORMAT_SIGNED_INT_NE;
+
+      case 24:
+        return format->sample_format == BLT_PCM_SAMPLE_FORMAT_SIGNED_INT_LE ||
+               format->sample_format == BLT_PCM_SAMPLE_FORMAT_SIGNED_INT_BE;
+
+      case 32:
+        return format->sample_format == BLT_PCM_SAMPLE_FORMAT_SIGNED_INT_NE ||
+               format->sample_format == BLT_PCM_SAMPLE_FORMAT_FLOAT_NE;
+
+      default:
+        return BLT_FALSE;
+    }
+}
+
+/*----------------------------------------------------------------------
+|   BLT_PcmFloat_Import
++---------------------------------------------------------------------*/
+void
+BLT_PcmFloat_Import(const BLT_PcmMediaType* format,
+                    const void*             samples,
+                    BLT_Cardinal            sample_count,
+                    float*                  buffer)
+{
+    BLT_Cardinal i;
+
+    switch (format->bits_per_sample) {
+      case 8: {
+        const unsigned char* in = (const unsigned char*)samples;
+        for (i=0; i<sample_count; i++) {
+            buffer[i] = (float)((int)in[i]-128)*(1.0f/BLT_PCM_FLOAT_SCALE_8);
+        }
+        break;
+      }
+
+      case 16: {
+        const BLT_Int16* in = (const BLT_Int16*)samples;
+        for (i=0; i<sample_count; i++) {
+            buffer[i] = (float)in[i]*(1.0f/BLT_PCM_FLOAT_SCALE_16);
+        }
+        break;
+      }
+
+      case 24: {
+        const unsigned char* in = (const unsigned char*)samples;
+        unsigned int lo = format->sample_format == BLT_PCM_SAMPLE_FORMAT_SIGNED_INT_BE?2:0;
+        unsigned int hi = 2-lo;
+        for (i=0; i<sample_count; i++, in += 3) {
+            BLT_Int32 value = (BLT_Int32)(((BLT_UInt32)in[lo]      ) |
+                                          ((BLT_UInt32)in[1]  <<  8) |
+                                          ((BLT_UInt32)in[hi] << 16));
+            value = (value ^ 0x800000)-0x800000; /* sign extension */
+            buffer[i] = (float)value*(1.0f/BLT_PCM_FLOAT_SCALE_24);
+        }
+        break;
+      }
+
+      case 32:
+        if (format->sample_format == BLT_PCM_SAMPLE_FORMAT_FLOAT_NE) {
+            ATX_CopyMemory(buffer, samples, sample_count*sizeof(float));
+        } else {
+            const BLT_Int32* in = (const BLT_Int32*)samples;
+            for (i=0; i<sample_count; i++) {
+                buffer[i] = (float)((double)in[i]*(1.0/BLT_PCM_FLOAT_SCALE_32));
+            }
+        }
+        break;
+
+      default:
+        ATX_SetMemory(buffer, 0, sample_count*sizeof(float));
+        break;
+    }
+}
+
+/*----------------------------------------------------------------------
+|   BLT_PcmFloat_Export
++---------------------------------------------------------------------*/
+void
+BLT_PcmFloat_Export(const BLT_PcmMediaType* format,
+                    const float*            buffer,
+                    BLT_Cardinal            sample_count,
+                    void*                   samples)
+{
+    BLT_Cardinal i;
+
+    /* the conditional expressions below compile to min/max/select */
+    /* instructions, so the loops stay free of branches            */
+    switch (format->bits_per_sample) {
+      case 8: {
+        unsigned char* out = (unsigned char*)samples;
+        for (i=0; i<sample_count; i++) {
+            float value = buffer[i]*BLT_PCM_FLOAT_SCALE_8;
+            value = value >  127.0f ?  127.0f : value;
+            value = value < -128.0f ? -128.0f : value;
+            out[i] = (unsigned char)((int)(value + (value >= 0.0f ? 0.5f : -0.5f))+128);
+        }
+        break;
+      }
+
+      case 16: {
+        BLT_Int16* out = (BLT_Int16*)samples;
+        for (i=0; i<sample_count; i++) {
+            float value = buffer[i]*BLT_PCM_FLOAT_SCALE_16;
+            value = value >  32767.0f ?  32767.0f : value;
+            value = value < -32768.0f ? -32768.0f : value;
+            out[i] = (BLT_Int16)(value + (value >= 0.0f ? 0.5f : -0.5f));
+        }
+        break;
+      }
+
+      case 24: {
+        unsigned char* out = (unsigned char*)samples;
+        unsigned int   lo = format->sample_format == BLT_PCM_SAMPLE_FORMAT_SIGNED_INT_BE?2:0;
+        unsigned int   hi = 2-lo;
+        for (i=0; i<sample_count; i++, out += 3) {
+            float     value = buffer[i]*BLT_PCM_FLOAT_SCALE_24;
+            BLT_Int32 sample;
+            value = value >  8388607.0f ?  8388607.0f : value;
+            value = value < -8388608.0f ? -8388608.0f : value;
+            sample = (BLT_Int32)(value + (value >= 0.0f ? 0.5f : -0.5f));
+            out[lo] = (unsigned char)(sample      );
+            out[1]  = (unsigned char)(sample >>  8);
+            out[hi] = (unsigned char)(sample >> 16);
+        }
+        break;
+      }
+
+      case 32:
+        if (format->sample_format == BLT_PCM_SAMPLE_FORMAT_FLOAT_NE) {
+            ATX_CopyMemory(samples, buffer, sample_count*sizeof(float));
+        } else {
+            BLT_Int32* out = (BLT_Int32*)samples;
+            for (i=0; i<sample_count; i++) {
+                double value = (double)buffer[i]*BLT_PCM_FLOAT_SCALE_32;
+                value = value >  2147483647.0 ?  2147483647.0 : value;
+                value = value < -2147483648.0 ? -2147483648.0 : value;
+                out[i] = (BLT_Int32)(value + (value >= 0.0 ? 0.5 : -0.5));
+            }
+        }
+        break;
+
+      default:
+        break;
+    }
+}
@@ -0,0 +1,62 @@
+/*****************************************************************
+|
+|   BlueTune - PCM Float Conversion
+|
+|   (c) 2002-2012 Gilles Boccon-Gibod
+|   Author: Gilles Boccon-Gibod (bok@bok.net)
+|
+ ****************************************************************/
+/** @file
+ * Conversion of PCM samples to and from normalized 32 bit floats, for
+ * nodes that process audio in floating point internally.
+ */
+
+#ifndef _BLT_PCM_FLOAT_H_
+#define _BLT_PCM_FLOAT_H_
+
+/*----------------------------------------------------------------------
+|   includes
++---------------------------------------------------------------------*/
+#include "BltTypes.h"
+#include "BltPcm.h"
+
+/*----------------------------------------------------------------------
+|   prototypes
++---------------------------------------------------------------------*/
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/**
+ * Returns BLT_TRUE if samples of the given format can be converted.
+ * Supported formats are 8 bit unsigned integers, 16, 24 and 32 bit
+ * signed integers, and 32 bit floats. 16 and 32 bit integers, and
+ * floats, must be native-endian; 24 bit integers may be in either byte
+ * order.
+ */
+BLT_Boolean BLT_PcmFloat_SupportsFormat(const BLT_PcmMediaType* format);
+
+/**
+ * Convert samples to floats in the range [-1.0, 1.0[.
+ * @param sample_count Number of samples (frames times channels).
+ */
+void BLT_PcmFloat_Import(const BLT_PcmMediaType* format,
+                         const void*             samples,
+                         BLT_Cardinal            sample_count,
+                         float*                  buffer);
+
+/**
+ * Convert floats back to samples, rounding and saturating integer
+ * formats.
+ * @param sample_count Number of samples (frames times channels).
+ */
+void BLT_PcmFloat_Export(const BLT_PcmMediaType* format,
+                         const float*            buffer,
+                         BLT_Cardinal            sample_count,
+                         void*                   samples);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* _BLT_PCM_FLOAT_H_ */
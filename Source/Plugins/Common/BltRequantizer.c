@@ -0,0 +1,280 @@
+/*****************************************************************
+|
+|   BlueTune - Requantizer
+|
+|   (c) 2002-2012 Gilles Boccon-Gibod
+|   Author: Gilles Boccon-Gibod (bok@bok.net)
+|
+ ****************************************************************/
+
+/*----------------------------------------------------------------------
+|   includes
++---------------------------------------------------------------------*/
+#include <math.h>
+
+#include "Atomix.h"
+#include "BltTypes.h"
+#include "BltErrors.h"
+#include "BltSimd.h"
+#include "BltRequantizer.h"
+
+/*----------------------------------------------------------------------
+|   constants
++---------------------------------------------------------------------*/
+static const BLT_UInt32 BLT_Requantizer_Seeds[BLT_REQUANTIZER_GENERATORS] = {
+    0x9E3779B9, 0x7F4A7C15, 0xF39CC060, 0x5CEDC834
+};
+
+/* error feedback filters: the noise transfer function is */
+/* 1 - (taps[0]*z^-1 + taps[1]*z^-2 + ...)                  */
+static const float BLT_Requantizer_FirstOrderTaps[1] = {
+    1.0f
+};
+
+/* Lipshitz, Vanderkooy, Wannamaker: "Minimally Audible Noise Shaping" */
+static const float BLT_Requantizer_WeightedTaps[BLT_REQUANTIZER_MAX_TAPS] = {
+    2.033f, -2.165f, 1.959f, -1.590f, 0.6149f
+};
+
+/*----------------------------------------------------------------------
+|   BLT_Requantizer_Init
++---------------------------------------------------------------------*/
+BLT_Result
+BLT_Requantizer_Init(BLT_Requantizer*       self,
+                     BLT_Cardinal           channel_count,
+                     BLT_Cardinal           bits_per_sample,
+                     BLT_RequantizerShaping shaping)
+{
+    if (channel_count == 0 || channel_count > BLT_REQUANTIZER_MAX_CHANNELS) {
+        return BLT_ERROR_NOT_SUPPORTED;
+    }
+    if (bits_per_sample < 8 || bits_per_sample > 24) {
+        return BLT_ERROR_NOT_SUPPORTED;
+    }
+
+    self->channel_count = channel_count;
+    self->scale         = (float)(1L<<(bits_per_sample-1));
+    self->minimum       = -self->scale;
+    self->maximum       = self->scale-1.0f;
+    self->generator     = 0;
+    ATX_CopyMemory(self->random, BLT_Requantizer_Seeds, sizeof(self->random));
+    switch (shaping) {
+        case BLT_REQUANTIZER_SHAPING_FIRST_ORDER:
+            self->taps      = BLT_Requantizer_FirstOrderTaps;
+            self->tap_count = 1;
+            break;
+
+        case BLT_REQUANTIZER_SHAPING_WEIGHTED:
+            self->taps      = BLT_Requantizer_WeightedTaps;
+            self->tap_count = BLT_REQUANTIZER_MAX_TAPS;
+            break;
+
+        default:
+            self->taps      = NULL;
+            self->tap_count = 0;
+            break;
+    }
+    BLT_Requantizer_Reset(self);
+
+    return BLT_SUCCESS;
+}
+
+/*----------------------------------------------------------------------
+|   BLT_Requantizer_Reset
++---------------------------------------------------------------------*/
+void
+BLT_Requantizer_Reset(BLT_Requantizer* self)
+{
+    ATX_SetMemory(self->errors, 0, sizeof(self->errors));
+}
+
+/*----------------------------------------------------------------------
+|   BLT_Requantizer_Round
+|
+|   Adds the dither to a value in steps and rounds it. The dither is the
+|   difference of two uniform values in [0,1[, taken from the two halves
+|   of one xorshift output, which gives a triangular distribution over
+|   ]-1,1[ steps. The sum is exact in double precision, so the vector
+|   versions below get the same results.
++---------------------------------------------------------------------*/
+static float
+BLT_Requantizer_Round(float target, BLT_UInt32* random)
+{
+    BLT_UInt32 x = *random;
+
+    x ^= x<<13;
+    x ^= x>>17;
+    x ^= x<<5;
+    *random = x;
+
+    return (float)floor((double)target +
+                        (double)((BLT_Int32)(x&0xFFFF)-(BLT_Int32)(x>>16))*(1.0/65536.0) +
+                        0.5);
+}
+
+#if defined(BLT_SIMD_SSE2)
+/*----------------------------------------------------------------------
+|   BLT_Requantizer_Floor
+|
+|   SSE2 has no floor: truncate, then step down where that went up.
++---------------------------------------------------------------------*/
+static __m128d
+BLT_Requantizer_Floor(__m128d x)
+{
+    __m128d t = _mm_cvtepi32_pd(_mm_cvttpd_epi32(x));
+    return _mm_sub_pd(t, _mm_and_pd(_mm_cmpgt_pd(t, x), _mm_set1_pd(1.0)));
+}
+#endif
+
+/*----------------------------------------------------------------------
+|   BLT_Requantizer_Process
+|
+|   Without noise shaping, the samples are independent: with SSE2 or
+|   NEON (on 64 bit ARM, which has double precision vectors) the four
+|   generators step together and 4 samples are rounded at a time. With
+|   noise shaping, each sample depends on the error of the previous one
+|   in its channel, so that stays a scalar loop.
++---------------------------------------------------------------------*/
+void
+BLT_Requantizer_Process(BLT_Requantizer* self,
+                        float*           samples,
+                        BLT_Cardinal     frame_count)
+{
+    float        scale     = self->scale;
+    float        step      = 1.0f/self->scale;
+    float        minimum   = self->minimum;
+    float        maximum   = self->maximum;
+    BLT_Ordinal  generator = self->generator;
+    BLT_Ordinal  i = 0;
+    BLT_Ordinal  c;
+    BLT_Ordinal  k;
+
+    if (self->tap_count == 0) {
+        BLT_Cardinal sample_count = frame_count*self->channel_count;
+
+#if defined(BLT_SIMD_SSE2) || (defined(BLT_SIMD_NEON) && defined(__aarch64__))
+        /* up to the first generator */
+        for (; generator && i<sample_count; i++) {
+            float value = BLT_Requantizer_Round(samples[i]*scale, &self->random[generator]);
+            generator = (generator+1)%BLT_REQUANTIZER_GENERATORS;
+            if (value < minimum) value = minimum;
+            if (value > maximum) value = maximum;
+            samples[i] = value*step;
+        }
+#endif
+#if defined(BLT_SIMD_SSE2)
+        {
+            __m128i random   = _mm_loadu_si128((const __m128i*)self->random);
+            __m128i low_mask = _mm_set1_epi32(0xFFFF);
+            __m128  v_scale  = _mm_set1_ps(scale);
+            __m128  v_step   = _mm_set1_ps(step);
+            __m128  v_min    = _mm_set1_ps(minimum);
+            __m128  v_max    = _mm_set1_ps(maximum);
+            __m128  v_range  = _mm_set1_ps(scale+2.0f);
+            __m128  v_unit   = _mm_set1_ps(1.0f/65536.0f);
+            __m128d v_half   = _mm_set1_pd(0.5);
+            for (; i+4<=sample_count; i += 4) {
+                __m128  target;
+                __m128  dither;
+                __m128d low;
+                __m128d high;
+                __m128  value;
+
+                random = _mm_xor_si128(random, _mm_slli_epi32(random, 13));
+                random = _mm_xor_si128(random, _mm_srli_epi32(random, 17));
+                random = _mm_xor_si128(random, _mm_slli_epi32(random, 5));
+                dither = _mm_mul_ps(_mm_cvtepi32_ps(_mm_sub_epi32(_mm_and_si128(random, low_mask),
+                                                                  _mm_srli_epi32(random, 16))),
+                                    v_unit);
+
+                /* beyond 2 steps out of range the result saturates anyway, */
+                /* and the conversions to integers need it to stay small    */
+                target = _mm_mul_ps(_mm_loadu_ps(samples+i), v_scale);
+                target = _mm_min_ps(_mm_max_ps(target, _mm_sub_ps(_mm_setzero_ps(), v_range)), v_range);
+
+                low  = _mm_add_pd(_mm_add_pd(_mm_cvtps_pd(target), _mm_cvtps_pd(dither)), v_half);
+                high = _mm_add_pd(_mm_add_pd(_mm_cvtps_pd(_mm_movehl_ps(target, target)),
+                                             _mm_cvtps_pd(_mm_movehl_ps(dither, dither))),
+                                  v_half);
+                value = _mm_movelh_ps(_mm_cvtpd_ps(BLT_Requantizer_Floor(low)),
+                                      _mm_cvtpd_ps(BLT_Requantizer_Floor(high)));
+                value = _mm_min_ps(_mm_max_ps(value, v_min), v_max);
+                _mm_storeu_ps(samples+i, _mm_mul_ps(value, v_step));
+            }
+            _mm_storeu_si128((__m128i*)self->random, random);
+        }
+#elif defined(BLT_SIMD_NEON) && defined(__aarch64__)
+        {
+            uint32x4_t  random   = vld1q_u32(self->random);
+            uint32x4_t  low_mask = vdupq_n_u32(0xFFFF);
+            float32x4_t v_min    = vdupq_n_f32(minimum);
+            float32x4_t v_max    = vdupq_n_f32(maximum);
+            float64x2_t v_half   = vdupq_n_f64(0.5);
+            for (; i+4<=sample_count; i += 4) {
+                float32x4_t target;
+                float32x4_t dither;
+                float64x2_t low;
+                float64x2_t high;
+                float32x4_t value;
+
+                random = veorq_u32(random, vshlq_n_u32(random, 13));
+                random = veorq_u32(random, vshrq_n_u32(random, 17));
+                random = veorq_u32(random, vshlq_n_u32(random, 5));
+                dither = vmulq_n_f32(vcvtq_f32_s32(vsubq_s32(vreinterpretq_s32_u32(vandq_u32(random, low_mask)),
+                                                             vreinterpretq_s32_u32(vshrq_n_u32(random, 16)))),
+                                     1.0f/65536.0f);
+
+                target = vmulq_n_f32(vld1q_f32(samples+i), scale);
+                low  = vaddq_f64(vaddq_f64(vcvt_f64_f32(vget_low_f32(target)),
+                                           vcvt_f64_f32(vget_low_f32(dither))),
+                                 v_half);
+                high = vaddq_f64(vaddq_f64(vcvt_high_f64_f32(target),
+                                           vcvt_high_f64_f32(dither)),
+                                 v_half);
+                value = vcombine_f32(vcvt_f32_f64(vrndmq_f64(low)), vcvt_f32_f64(vrndmq_f64(high)));
+                value = vminq_f32(vmaxq_f32(value, v_min), v_max);
+                vst1q_f32(samples+i, vmulq_n_f32(value, step));
+            }
+            vst1q_u32(self->random, random);
+        }
+#endif
+        for (; i<sample_count; i++) {
+            float value = BLT_Requantizer_Round(samples[i]*scale, &self->random[generator]);
+            generator = (generator+1)%BLT_REQUANTIZER_GENERATORS;
+            if (value < minimum) value = minimum;
+            if (value > maximum) value = maximum;
+            samples[i] = value*step;
+        }
+    } else {
+        const float* taps      = self->taps;
+        BLT_Cardinal tap_count = self->tap_count;
+        for (i=0; i<frame_count; i++) {
+            for (c=0; c<self->channel_count; c++) {
+                float* errors = self->errors[c];
+                float  target = *samples*scale;
+                float  value;
+
+                /* subtract the filtered past errors */
+                for (k=0; k<tap_count; k++) {
+                    target -= taps[k]*errors[k];
+                }
+
+                value = BLT_Requantizer_Round(target, &self->random[generator]);
+                generator = (generator+1)%BLT_REQUANTIZER_GENERATORS;
+
+                /* the error is measured before saturating, so that it */
+                /* stays within 1.5 steps and the filter stays stable  */
+                for (k=tap_count-1; k>0; k--) {
+                    errors[k] = errors[k-1];
+                }
+                errors[0] = value-target;
+
+                if (value < minimum) value = minimum;
+                if (value > maximum) value = maximum;
+                *samples++ = value*step;
+            }
+        }
+    }
+
+    self->generator = generator;
+}
@@ -0,0 +1,97 @@
+/*****************************************************************
+|
+|   BlueTune - Requantizer
+|
+|   (c) 2002-2012 Gilles Boccon-Gibod
+|   Author: Gilles Boccon-Gibod (bok@bok.net)
+|
+ ****************************************************************/
+/** @file
+ * Requantizer: rounds float samples to the grid of a narrower integer
+ * format with TPDF (triangular) dither, so that the quantization error
+ * becomes a constant, signal-independent noise floor instead of
+ * distortion. The noise can optionally be shaped by an error feedback
+ * filter, which moves it away from the frequencies where the ear is
+ * most sensitive.
+ */
+
+#ifndef _BLT_REQUANTIZER_H_
+#define _BLT_REQUANTIZER_H_
+
+/*----------------------------------------------------------------------
+|   includes
++---------------------------------------------------------------------*/
+#include "BltTypes.h"
+
+/*----------------------------------------------------------------------
+|   constants
++---------------------------------------------------------------------*/
+#define BLT_REQUANTIZER_MAX_CHANNELS 8
+#define BLT_REQUANTIZER_MAX_TAPS     5
+#define BLT_REQUANTIZER_GENERATORS   4
+
+/*----------------------------------------------------------------------
+|   types
++---------------------------------------------------------------------*/
+typedef enum {
+    BLT_REQUANTIZER_SHAPING_NONE,        /**< flat TPDF dither                          */
+    BLT_REQUANTIZER_SHAPING_FIRST_ORDER, /**< 6 dB/octave high pass, for any rate       */
+    BLT_REQUANTIZER_SHAPING_WEIGHTED     /**< 5 tap E-weighted curve, for 44.1/48 kHz   */
+} BLT_RequantizerShaping;
+
+typedef struct {
+    BLT_Cardinal channel_count;
+    BLT_Cardinal tap_count;
+    const float* taps;
+    float        scale;   /* steps per unit of the float samples */
+    float        minimum; /* in steps */
+    float        maximum; /* in steps */
+
+    /* dither generators: sample n of the stream uses generator */
+    /* n%BLT_REQUANTIZER_GENERATORS, so that they can run side  */
+    /* by side in vector registers                              */
+    BLT_UInt32   random[BLT_REQUANTIZER_GENERATORS];
+    BLT_Ordinal  generator; /* generator of the next sample */
+
+    /* past quantization errors, per channel, the most recent first */
+    float        errors[BLT_REQUANTIZER_MAX_CHANNELS][BLT_REQUANTIZER_MAX_TAPS];
+} BLT_Requantizer;
+
+/*----------------------------------------------------------------------
+|   prototypes
++---------------------------------------------------------------------*/
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/**
+ * Initialize a requantizer for a target sample width.
+ * Returns BLT_ERROR_NOT_SUPPORTED if there are more than
+ * BLT_REQUANTIZER_MAX_CHANNELS channels, or if the width is not between
+ * 8 and 24 bits.
+ */
+BLT_Result BLT_Requantizer_Init(BLT_Requantizer*       self,
+                                BLT_Cardinal           channel_count,
+                                BLT_Cardinal           bits_per_sample,
+                                BLT_RequantizerShaping shaping);
+
+/**
+ * Clear the error history of the noise shaping filter.
+ */
+void BLT_Requantizer_Reset(BLT_Requantizer* self);
+
+/**
+ * Requantize a buffer of interleaved float samples in place.
+ * The samples are replaced by exact multiples of the target step,
+ * saturated to the range of the target format, so that
+ * BLT_PcmFloat_Export writes them without further rounding.
+ */
+void BLT_Requantizer_Process(BLT_Requantizer* self,
+                             float*           samples,
+                             BLT_Cardinal     frame_count);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* _BLT_REQUANTIZER_H_ */
@@ -0,0 +1,458 @@
+/*****************************************************************
+|
+|   BlueTune - Time Stretching
+|
+|   (c) 2002-2012 Gilles Boccon-Gibod
+|   Author: Gilles Boccon-Gibod (bok@bok.net)
+|
+ ****************************************************************/
+
+/*----------------------------------------------------------------------
+|   includes
++---------------------------------------------------------------------*/
+#include <math.h>
+
+#include "Atomix.h"
+#include "BltTypes.h"
+#include "BltErrors.h"
+#include "BltSimd.h"
+#include "BltTimeStretch.h"
+
+/*----------------------------------------------------------------------
+|   constants
++---------------------------------------------------------------------*/
+#define BLT_TIME_STRETCH_PI 3.14159265358979323846
+
+/* the segments are 25ms long, and overlap by half */
+#define BLT_TIME_STRETCH_HOPS_PER_SECOND 80
+
+/* segments move by up to 10ms to line up with the previous one */
+#define BLT_TIME_STRETCH_TOLERANCES_PER_SECOND 100
+
+/* the alignment is searched every few frames, then refined */
+#define BLT_TIME_STRETCH_SEARCH_STEP 4
+
+/*----------------------------------------------------------------------
+|   types
++---------------------------------------------------------------------*/
+/* all the positions are in frames from the start of the input buffer, */
+/* which is origin frames after the last reset                         */
+struct BLT_TimeStretch {
+    BLT_Cardinal channel_count;
+    BLT_Cardinal hop;          /* output frames per step, half a segment    */
+    BLT_Cardinal tolerance;    /* max distance a segment may move           */
+    BLT_Cardinal capacity;     /* size of the input buffer                  */
+    BLT_Cardinal fill;         /* frames in the input buffer                */
+    ATX_Int64    origin;       /* input frame of the start of the buffer    */
+    double       position;     /* input position of the next segment        */
+    long         previous;     /* start of the previous segment             */
+    BLT_Boolean  started;      /* a first segment was output                */
+    BLT_Boolean  flushing;
+    BLT_Cardinal tail;         /* next frame to output when flushing        */
+    float*       window;       /* rising half of the window, hop frames     */
+    float*       input;        /* capacity frames                           */
+    float*       mono;         /* capacity samples, for the alignment       */
+    float*       overlap;      /* second half of the previous segment       */
+};
+
+/*----------------------------------------------------------------------
+|   BLT_TimeStretch_Create
++---------------------------------------------------------------------*/
+BLT_Result
+BLT_TimeStretch_Create(BLT_Cardinal      sample_rate,
+                       BLT_Cardinal      channel_count,
+                       BLT_TimeStretch** stretch)
+{
+    BLT_TimeStretch* self;
+    BLT_Cardinal     hop;
+    BLT_Cardinal     tolerance;
+    BLT_Cardinal     capacity;
+    BLT_Ordinal      i;
+
+    *stretch = NULL;
+    if (channel_count == 0 || channel_count > BLT_TIME_STRETCH_MAX_CHANNELS ||
+        sample_rate == 0) {
+        return BLT_ERROR_NOT_SUPPORTED;
+    }
+
+    hop       = sample_rate/BLT_TIME_STRETCH_HOPS_PER_SECOND;
+    tolerance = sample_rate/BLT_TIME_STRETCH_TOLERANCES_PER_SECOND;
+    if (hop < 16) hop = 16;
+    if (tolerance < BLT_TIME_STRETCH_SEARCH_STEP) tolerance = BLT_TIME_STRETCH_SEARCH_STEP;
+
+    /* what one step needs at the fastest rate, twice over, so that */
+    /* there is always room for new input once the steps are done   */
+    capacity = 2*(2*hop+(BLT_Cardinal)(BLT_TIME_STRETCH_MAX_RATE*hop)+3*tolerance);
+
+    /* allocate everything at once */
+    self = (BLT_TimeStretch*)ATX_AllocateZeroMemory(sizeof(BLT_TimeStretch)+
+                                                    sizeof(float)*(hop                      +
+                                                                   capacity*channel_count   +
+                                                                   capacity                 +
+                                                                   hop*channel_count));
+    if (self == NULL) return BLT_ERROR_OUT_OF_MEMORY;
+    self->channel_count = channel_count;
+    self->hop           = hop;
+    self->tolerance     = tolerance;
+    self->capacity      = capacity;
+    self->window        = (float*)(void*)(self+1);
+    self->input         = self->window+hop;
+    self->mono          = self->input+capacity*channel_count;
+    self->overlap       = self->mono+capacity;
+
+    /* Hann window over a segment: the rising half and the falling half */
+    /* of two overlapping segments always add up to 1                  */
+    for (i=0; i<hop; i++) {
+        self->window[i] = (float)(0.5-0.5*cos(BLT_TIME_STRETCH_PI*(double)i/(double)hop));
+    }
+
+    *stretch = self;
+    return BLT_SUCCESS;
+}
+
+/*----------------------------------------------------------------------
+|   BLT_TimeStretch_Destroy
++---------------------------------------------------------------------*/
+void
+BLT_TimeStretch_Destroy(BLT_TimeStretch* self)
+{
+    if (self) ATX_FreeMemory(self);
+}
+
+/*----------------------------------------------------------------------
+|   BLT_TimeStretch_Reset
++---------------------------------------------------------------------*/
+void
+BLT_TimeStretch_Reset(BLT_TimeStretch* self)
+{
+    self->fill     = 0;
+    self->origin   = 0;
+    self->position = 0.0;
+    self->previous = 0;
+    self->started  = BLT_FALSE;
+    self->flushing = BLT_FALSE;
+    self->tail     = 0;
+}
+
+/*----------------------------------------------------------------------
+|   BLT_TimeStretch_GetHopSize
++---------------------------------------------------------------------*/
+BLT_Cardinal
+BLT_TimeStretch_GetHopSize(const BLT_TimeStretch* self)
+{
+    return self->hop;
+}
+
+/*----------------------------------------------------------------------
+|   BLT_TimeStretch_GetBufferedFrames
++---------------------------------------------------------------------*/
+BLT_Cardinal
+BLT_TimeStretch_GetBufferedFrames(const BLT_TimeStretch* self)
+{
+    return self->fill;
+}
+
+/*----------------------------------------------------------------------
+|   BLT_TimeStretch_GetPosition
++---------------------------------------------------------------------*/
+double
+BLT_TimeStretch_GetPosition(const BLT_TimeStretch* self)
+{
+    return (double)self->origin+(self->flushing?(double)self->tail:self->position);
+}
+
+/*----------------------------------------------------------------------
+|   BLT_TimeStretch_Write
++---------------------------------------------------------------------*/
+BLT_Cardinal
+BLT_TimeStretch_Write(BLT_TimeStretch* self,
+                      const float*     samples,
+                      BLT_Cardinal     frame_count)
+{
+    BLT_Cardinal channel_count = self->channel_count;
+    float*       mono;
+    float        scale = 1.0f/(float)channel_count;
+    BLT_Ordinal  i;
+    BLT_Ordinal  c;
+
+    /* no new input until the flush is complete */
+    if (self->flushing) return 0;
+
+    if (frame_count > self->capacity-self->fill) frame_count = self->capacity-self->fill;
+    ATX_CopyMemory(self->input+self->fill*channel_count,
+                   samples,
+                   frame_count*channel_count*sizeof(float));
+
+    /* the alignment is done on a mono mix */
+    mono = self->mono+self->fill;
+    if (channel_count == 1) {
+        ATX_CopyMemory(mono, samples, frame_count*sizeof(float));
+    } else {
+        for (i=0; i<frame_count; i++) {
+            float mix = 0.0f;
+            for (c=0; c<channel_count; c++) mix += samples[i*channel_count+c];
+            mono[i] = mix*scale;
+        }
+    }
+    self->fill += frame_count;
+
+    return frame_count;
+}
+
+/*----------------------------------------------------------------------
+|   BLT_TimeStretch_Correlate
+|
+|   Four partial sums, one per lane with SSE2 or NEON. The leftover
+|   samples go to the first one.
++---------------------------------------------------------------------*/
+static float
+BLT_TimeStretch_Correlate(const float* a,
+                          const float* b,
+                          BLT_Cardinal count,
+                          float*       energy)
+{
+    float       dot[4]    = {0.0f, 0.0f, 0.0f, 0.0f};
+    float       power[4]  = {0.0f, 0.0f, 0.0f, 0.0f};
+    BLT_Ordinal i;
+
+#if defined(BLT_SIMD_SSE2)
+    __m128 vdot   = _mm_setzero_ps();
+    __m128 vpower = _mm_setzero_ps();
+    for (i=0; i+4<=count; i += 4) {
+        __m128 x = _mm_loadu_ps(a+i);
+        vdot   = _mm_add_ps(vdot,   _mm_mul_ps(x, _mm_loadu_ps(b+i)));
+        vpower = _mm_add_ps(vpower, _mm_mul_ps(x, x));
+    }
+    _mm_storeu_ps(dot,   vdot);
+    _mm_storeu_ps(power, vpower);
+#elif defined(BLT_SIMD_NEON)
+    float32x4_t vdot   = vdupq_n_f32(0.0f);
+    float32x4_t vpower = vdupq_n_f32(0.0f);
+    for (i=0; i+4<=count; i += 4) {
+        float32x4_t x = vld1q_f32(a+i);
+        vdot   = vaddq_f32(vdot,   vmulq_f32(x, vld1q_f32(b+i)));
+        vpower = vaddq_f32(vpower, vmulq_f32(x, x));
+    }
+    vst1q_f32(dot,   vdot);
+    vst1q_f32(power, vpower);
+#else
+    for (i=0; i+4<=count; i += 4) {
+        dot[0]   += a[i  ]*b[i  ];
+        dot[1]   += a[i+1]*b[i+1];
+        dot[2]   += a[i+2]*b[i+2];
+        dot[3]   += a[i+3]*b[i+3];
+        power[0] += a[i  ]*a[i  ];
+        power[1] += a[i+1]*a[i+1];
+        power[2] += a[i+2]*a[i+2];
+        power[3] += a[i+3]*a[i+3];
+    }
+#endif
+    for (; i<count; i++) {
+        dot[0]   += a[i]*b[i];
+        power[0] += a[i]*a[i];
+    }
+
+    *energy = (power[0]+power[1])+(power[2]+power[3]);
+    return (dot[0]+dot[1])+(dot[2]+dot[3]);
+}
+
+/*----------------------------------------------------------------------
+|   BLT_TimeStretch_Score
++---------------------------------------------------------------------*/
+static float
+BLT_TimeStretch_Score(const BLT_TimeStretch* self,
+                      long                   start,
+                      const float*           target)
+{
+    float energy;
+    float dot = BLT_TimeStretch_Correlate(self->mono+start, target, self->hop, &energy);
+
+    /* normalized, so that louder segments are not preferred */
+    return dot/(float)sqrt(energy+1e-9f);
+}
+
+/*----------------------------------------------------------------------
+|   BLT_TimeStretch_Align
+|
+|   Find the start of the segment, near the nominal position, whose
+|   first half looks the most like what would have followed the
+|   previous segment in the input.
++---------------------------------------------------------------------*/
+static long
+BLT_TimeStretch_Align(const BLT_TimeStretch* self, long nominal)
+{
+    const float* target = self->mono+self->previous+self->hop;
+    long         first  = nominal-(long)self->tolerance;
+    long         last   = nominal+(long)self->tolerance;
+    long         best   = nominal;
+    float        best_score;
+    long         coarse;
+    long         start;
+
+    if (first < 0) first = 0;
+    best_score = BLT_TimeStretch_Score(self, best, target);
+
+    /* coarse search */
+    for (start=first; start<=last; start += BLT_TIME_STRETCH_SEARCH_STEP) {
+        float score = BLT_TimeStretch_Score(self, start, target);
+        if (score > best_score) {
+            best_score = score;
+            best       = start;
+        }
+    }
+
+    /* refine around the best coarse match */
+    coarse = best;
+    for (start  = coarse-(BLT_TIME_STRETCH_SEARCH_STEP-1);
+         start <= coarse+(BLT_TIME_STRETCH_SEARCH_STEP-1);
+         start++) {
+        float score;
+        if (start < first || start > last || start == coarse) continue;
+        score = BLT_TimeStretch_Score(self, start, target);
+        if (score > best_score) {
+            best_score = score;
+            best       = start;
+        }
+    }
+
+    return best;
+}
+
+/*----------------------------------------------------------------------
+|   BLT_TimeStretch_Compact
++---------------------------------------------------------------------*/
+static void
+BLT_TimeStretch_Compact(BLT_TimeStretch* self)
+{
+    BLT_Cardinal channel_count = self->channel_count;
+    long         keep;
+    BLT_Cardinal remaining;
+    BLT_Ordinal  i;
+
+    /* the input before the next search window, and before what */
+    /* follows the previous segment, is not needed anymore      */
+    if (!self->started) return;
+    keep = (long)floor(self->position+0.5)-(long)self->tolerance;
+    if (keep > self->previous+(long)self->hop) keep = self->previous+(long)self->hop;
+    if (keep <= 0) return;
+    if (keep > (long)self->fill) keep = (long)self->fill;
+
+    remaining = self->fill-(BLT_Cardinal)keep;
+    for (i=0; i<remaining*channel_count; i++) {
+        self->input[i] = self->input[keep*channel_count+i];
+    }
+    for (i=0; i<remaining; i++) {
+        self->mono[i] = self->mono[keep+i];
+    }
+    self->fill      = remaining;
+    self->origin   += keep;
+    self->position -= (double)keep;
+    self->previous -= keep;
+}
+
+/*----------------------------------------------------------------------
+|   BLT_TimeStretch_Process
++---------------------------------------------------------------------*/
+BLT_Cardinal
+BLT_TimeStretch_Process(BLT_TimeStretch* self,
+                        double           rate,
+                        float*           output,
+                        BLT_Cardinal     max_frames)
+{
+    BLT_Cardinal channel_count = self->channel_count;
+    BLT_Cardinal hop           = self->hop;
+    BLT_Cardinal produced      = 0;
+
+    if (self->flushing) return 0;
+    if (rate < BLT_TIME_STRETCH_MIN_RATE) rate = BLT_TIME_STRETCH_MIN_RATE;
+    if (rate > BLT_TIME_STRETCH_MAX_RATE) rate = BLT_TIME_STRETCH_MAX_RATE;
+
+    while (produced+hop <= max_frames) {
+        const float* window = self->window;
+        float*       out    = output+produced*channel_count;
+        const float* segment;
+        long         start;
+        BLT_Ordinal  i;
+        BLT_Ordinal  c;
+
+        if (!self->started) {
+            /* the first segment is the start of the input, as is */
+            if (self->fill < 2*hop) break;
+            start = 0;
+            ATX_CopyMemory(out, self->input, hop*channel_count*sizeof(float));
+            self->started = BLT_TRUE;
+        } else {
+            long nominal = (long)floor(self->position+0.5);
+            if (nominal+(long)(self->tolerance+2*hop) > (long)self->fill ||
+                self->previous+(long)(2*hop) > (long)self->fill) {
+                break;
+            }
+            start = BLT_TimeStretch_Align(self, nominal);
+
+            /* rising half of this segment over the falling half of the last */
+            segment = self->input+start*channel_count;
+            for (i=0; i<hop; i++) {
+                for (c=0; c<channel_count; c++) {
+                    out[i*channel_count+c] = self->overlap[i*channel_count+c]+
+                                             window[i]*segment[i*channel_count+c];
+                }
+            }
+        }
+
+        /* keep the falling half for the next step */
+        segment = self->input+(start+hop)*channel_count;
+        for (i=0; i<hop; i++) {
+            for (c=0; c<channel_count; c++) {
+                self->overlap[i*channel_count+c] = (1.0f-window[i])*segment[i*channel_count+c];
+            }
+        }
+
+        self->previous  = start;
+        self->position += rate*(double)hop;
+        produced       += hop;
+    }
+
+    BLT_TimeStretch_Compact(self);
+
+    return produced;
+}
+
+/*----------------------------------------------------------------------
+|   BLT_TimeStretch_Flush
++---------------------------------------------------------------------*/
+BLT_Cardinal
+BLT_TimeStretch_Flush(BLT_TimeStretch* self,
+                      float*           output,
+                      BLT_Cardinal     max_frames)
+{
+    BLT_Cardinal channel_count = self->channel_count;
+    BLT_Cardinal count;
+
+    if (!self->flushing) {
+        /* the falling half of the last segment, plus the rising half of */
+        /* the next one taken right where it left off, is the input      */
+        /* itself, so the input can be output as is from there           */
+        self->tail     = self->started ? (BLT_Cardinal)(self->previous+(long)self->hop) : 0;
+        self->flushing = BLT_TRUE;
+    }
+
+    count = self->fill-self->tail;
+    if (count > max_frames) count = max_frames;
+    ATX_CopyMemory(output,
+                   self->input+self->tail*channel_count,
+                   count*channel_count*sizeof(float));
+    self->tail += count;
+
+    if (self->tail == self->fill) {
+        /* start over, at the end of the input */
+        self->origin  += self->fill;
+        self->fill     = 0;
+        self->position = 0.0;
+        self->previous = 0;
+        self->started  = BLT_FALSE;
+        self->flushing = BLT_FALSE;
+        self->tail     = 0;
+    }
+
+    return count;
+}
@@ -0,0 +1,119 @@
+/*****************************************************************
+|
+|   BlueTune - Time Stretching
+|
+|   (c) 2002-2012 Gilles Boccon-Gibod
+|   Author: Gilles Boccon-Gibod (bok@bok.net)
+|
+ ****************************************************************/
+/** @file
+ * Change the speed of audio without changing its pitch, with WSOLA
+ * (Waveform Similarity Overlap-Add).
+ * The output is built from overlapping windowed segments of the input.
+ * The segments are taken every hop*rate input frames and laid out every
+ * hop output frames; each one is moved by a few milliseconds, so that it
+ * lines up with the waveform of the segment before it.
+ */
+
+#ifndef _BLT_TIME_STRETCH_H_
+#define _BLT_TIME_STRETCH_H_
+
+/*----------------------------------------------------------------------
+|   includes
++---------------------------------------------------------------------*/
+#include "BltTypes.h"
+
+/*----------------------------------------------------------------------
+|   constants
++---------------------------------------------------------------------*/
+#define BLT_TIME_STRETCH_MAX_CHANNELS 8
+#define BLT_TIME_STRETCH_MIN_RATE     0.25
+#define BLT_TIME_STRETCH_MAX_RATE     4.0
+
+/*----------------------------------------------------------------------
+|   types
++---------------------------------------------------------------------*/
+typedef struct BLT_TimeStretch BLT_TimeStretch;
+
+/*----------------------------------------------------------------------
+|   prototypes
++---------------------------------------------------------------------*/
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/**
+ * Create a time stretcher for interleaved float samples.
+ * All the memory it needs is allocated here.
+ */
+BLT_Result BLT_TimeStretch_Create(BLT_Cardinal      sample_rate,
+                                  BLT_Cardinal      channel_count,
+                                  BLT_TimeStretch** stretch);
+
+void BLT_TimeStretch_Destroy(BLT_TimeStretch* self);
+
+/**
+ * Discard all the buffered input, and start counting the input frames
+ * from 0 again.
+ */
+void BLT_TimeStretch_Reset(BLT_TimeStretch* self);
+
+/**
+ * Number of output frames produced by each step of the algorithm.
+ * BLT_TimeStretch_Process never produces less than that in one step.
+ */
+BLT_Cardinal BLT_TimeStretch_GetHopSize(const BLT_TimeStretch* self);
+
+/**
+ * Number of input frames written and not yet fully consumed.
+ */
+BLT_Cardinal BLT_TimeStretch_GetBufferedFrames(const BLT_TimeStretch* self);
+
+/**
+ * Position of the next output frame in the input, in frames since the
+ * last reset. This is the media time of the output.
+ */
+double BLT_TimeStretch_GetPosition(const BLT_TimeStretch* self);
+
+/**
+ * Add input frames.
+ * @return The number of frames that fit in the input buffer. When it
+ * is less than frame_count, call BLT_TimeStretch_Process until it
+ * returns 0, and write the remaining frames.
+ */
+BLT_Cardinal BLT_TimeStretch_Write(BLT_TimeStretch* self,
+                                   const float*     samples,
+                                   BLT_Cardinal     frame_count);
+
+/**
+ * Produce output from the buffered input.
+ * @param rate Playback rate: 2.0 plays twice as fast. It may change
+ * between calls. It is clamped between BLT_TIME_STRETCH_MIN_RATE and
+ * BLT_TIME_STRETCH_MAX_RATE.
+ * @param max_frames Capacity of the output buffer, in frames. At least
+ * one hop is needed to make progress.
+ * @return The number of frames written to the output buffer, 0 when
+ * more input is needed.
+ */
+BLT_Cardinal BLT_TimeStretch_Process(BLT_TimeStretch* self,
+                                     double           rate,
+                                     float*           output,
+                                     BLT_Cardinal     max_frames);
+
+/**
+ * Output the input frames that the algorithm still holds, at their
+ * original speed, so that nothing is lost at the end of a stream or
+ * when going back to the normal rate. Output produced after this
+ * continues seamlessly with the input that follows.
+ * @return The number of frames written to the output buffer. Call
+ * again until it returns 0.
+ */
+BLT_Cardinal BLT_TimeStretch_Flush(BLT_TimeStretch* self,
+                                   float*           output,
+                                   BLT_Cardinal     max_frames);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* _BLT_TIME_STRETCH_H_ */
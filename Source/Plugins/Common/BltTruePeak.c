@@ -0,0 +1,180 @@
+/*****************************************************************
+|
+|   BlueTune - True Peak Meter
+|
+|   (c) 2002-2012 Gilles Boccon-Gibod
+|   Author: Gilles Boccon-Gibod (bok@bok.net)
+|
+ ****************************************************************/
+
+/*----------------------------------------------------------------------
+|   includes
++---------------------------------------------------------------------*/
+#include "Atomix.h"
+#include "BltTypes.h"
+#include "BltErrors.h"
+#include "BltSimd.h"
+#include "BltTruePeak.h"
+
+/*----------------------------------------------------------------------
+|   constants
++---------------------------------------------------------------------*/
+/* number of frames filtered at a time */
+#define BLT_TRUE_PEAK_METER_BLOCK_SIZE 256
+
+/* ITU-R BS.1770-4 Annex 2, 4x oversampling, 48 taps in 4 phases */
+static const float BLT_TruePeakMeter_Coefficients[BLT_TRUE_PEAK_METER_PHASES]
+                                                 [BLT_TRUE_PEAK_METER_TAPS] = {
+    { 0.0017089843750f,  0.0109863281250f, -0.0196533203125f,  0.0332031250000f,
+     -0.0594482421875f,  0.1373291015625f,  0.9721679687500f, -0.1022949218750f,
+      0.0476074218750f, -0.0266113281250f,  0.0148925781250f, -0.0083007812500f },
+    {-0.0291748046875f,  0.0292968750000f, -0.0517578125000f,  0.0891113281250f,
+     -0.1665039062500f,  0.4650878906250f,  0.7797851562500f, -0.2003173828125f,
+      0.1015625000000f, -0.0582275390625f,  0.0330810546875f, -0.0189208984375f },
+    {-0.0189208984375f,  0.0330810546875f, -0.0582275390625f,  0.1015625000000f,
+     -0.2003173828125f,  0.7797851562500f,  0.4650878906250f, -0.1665039062500f,
+      0.0891113281250f, -0.0517578125000f,  0.0292968750000f, -0.0291748046875f },
+    {-0.0083007812500f,  0.0148925781250f, -0.0266113281250f,  0.0476074218750f,
+     -0.1022949218750f,  0.9721679687500f,  0.1373291015625f, -0.0594482421875f,
+      0.0332031250000f, -0.0196533203125f,  0.0109863281250f,  0.0017089843750f }
+};
+
+/*----------------------------------------------------------------------
+|   BLT_TruePeakMeter_Init
++---------------------------------------------------------------------*/
+BLT_Result
+BLT_TruePeakMeter_Init(BLT_TruePeakMeter* self, BLT_Cardinal channel_count)
+{
+    ATX_SetMemory(self, 0, sizeof(*self));
+    if (channel_count > BLT_TRUE_PEAK_METER_MAX_CHANNELS) {
+        return BLT_ERROR_NOT_SUPPORTED;
+    }
+    self->channel_count = channel_count;
+
+    return BLT_SUCCESS;
+}
+
+/*----------------------------------------------------------------------
+|   BLT_TruePeakMeter_Reset
++---------------------------------------------------------------------*/
+void
+BLT_TruePeakMeter_Reset(BLT_TruePeakMeter* self)
+{
+    ATX_SetMemory(self->history, 0, sizeof(self->history));
+    self->peak = 0.0f;
+}
+
+/*----------------------------------------------------------------------
+|   BLT_TruePeakMeter_ProcessBlock
+|
+|   The samples themselves are points of the waveform too. They are
+|   included because the filter does not pass them through exactly (the
+|   center taps are 0.97), and would read a lone full scale sample up to
+|   0.25 dB low.
++---------------------------------------------------------------------*/
+static void
+BLT_TruePeakMeter_ProcessBlock(BLT_TruePeakMeter* self,
+                               const float*       samples,
+                               BLT_Cardinal       frame_count,
+                               float*             peaks)
+{
+    /* one channel at a time, with its history in front of it */
+    float        line[BLT_TRUE_PEAK_METER_TAPS-1+BLT_TRUE_PEAK_METER_BLOCK_SIZE];
+    BLT_Cardinal channel_count = self->channel_count;
+    BLT_Ordinal  c;
+    BLT_Ordinal  p;
+    BLT_Ordinal  t;
+    BLT_Ordinal  i;
+
+    for (i=0; i<frame_count; i++) peaks[i] = 0.0f;
+
+    for (c=0; c<channel_count; c++) {
+        const float* input = &line[BLT_TRUE_PEAK_METER_TAPS-1];
+
+        /* deinterleave the channel after its history */
+        ATX_CopyMemory(line, self->history[c], sizeof(self->history[c]));
+        for (i=0; i<frame_count; i++) {
+            line[BLT_TRUE_PEAK_METER_TAPS-1+i] = samples[i*channel_count+c];
+        }
+
+        /* 4 frames at a time, with the sums in registers */
+        i = 0;
+#if defined(BLT_SIMD_SSE2)
+        {
+            const __m128 sign = _mm_set1_ps(-0.0f);
+            for (; i+4 <= frame_count; i += 4) {
+                __m128 peak = _mm_andnot_ps(sign, _mm_loadu_ps(input+i-BLT_TRUE_PEAK_METER_DELAY));
+                for (p=0; p<BLT_TRUE_PEAK_METER_PHASES; p++) {
+                    const float* coefficients = BLT_TruePeakMeter_Coefficients[p];
+                    __m128       acc = _mm_setzero_ps();
+                    for (t=0; t<BLT_TRUE_PEAK_METER_TAPS; t++) {
+                        acc = _mm_add_ps(acc, _mm_mul_ps(_mm_set1_ps(coefficients[t]),
+                                                         _mm_loadu_ps(input+i-t)));
+                    }
+                    peak = _mm_max_ps(peak, _mm_andnot_ps(sign, acc));
+                }
+                _mm_storeu_ps(peaks+i, _mm_max_ps(peak, _mm_loadu_ps(peaks+i)));
+            }
+        }
+#elif defined(BLT_SIMD_NEON)
+        for (; i+4 <= frame_count; i += 4) {
+            float32x4_t peak = vabsq_f32(vld1q_f32(input+i-BLT_TRUE_PEAK_METER_DELAY));
+            for (p=0; p<BLT_TRUE_PEAK_METER_PHASES; p++) {
+                const float* coefficients = BLT_TruePeakMeter_Coefficients[p];
+                float32x4_t  acc = vdupq_n_f32(0.0f);
+                for (t=0; t<BLT_TRUE_PEAK_METER_TAPS; t++) {
+                    acc = vaddq_f32(acc, vmulq_n_f32(vld1q_f32(input+i-t), coefficients[t]));
+                }
+                peak = vmaxq_f32(peak, vabsq_f32(acc));
+            }
+            vst1q_f32(peaks+i, vmaxq_f32(peak, vld1q_f32(peaks+i)));
+        }
+#endif
+        for (; i<frame_count; i++) {
+            const float* x    = input+i;
+            float        peak = x[-BLT_TRUE_PEAK_METER_DELAY];
+            peak = peak < 0.0f ? -peak : peak;
+            for (p=0; p<BLT_TRUE_PEAK_METER_PHASES; p++) {
+                const float* coefficients = BLT_TruePeakMeter_Coefficients[p];
+                float        acc = 0.0f;
+                for (t=0; t<BLT_TRUE_PEAK_METER_TAPS; t++) {
+                    acc += coefficients[t]*x[-(int)t];
+                }
+                acc  = acc < 0.0f ? -acc : acc;
+                peak = acc > peak ? acc : peak;
+            }
+            peaks[i] = peak > peaks[i] ? peak : peaks[i];
+        }
+
+        /* keep the last samples for the next block */
+        ATX_CopyMemory(self->history[c], &line[frame_count], sizeof(self->history[c]));
+    }
+
+    /* update the overall peak */
+    for (i=0; i<frame_count; i++) {
+        self->peak = peaks[i] > self->peak ? peaks[i] : self->peak;
+    }
+}
+
+/*----------------------------------------------------------------------
+|   BLT_TruePeakMeter_Process
++---------------------------------------------------------------------*/
+void
+BLT_TruePeakMeter_Process(BLT_TruePeakMeter* self,
+                          const float*       samples,
+                          BLT_Cardinal       frame_count,
+                          float*             peaks)
+{
+    float block_peaks[BLT_TRUE_PEAK_METER_BLOCK_SIZE];
+
+    while (frame_count) {
+        BLT_Cardinal chunk = frame_count;
+        if (chunk > BLT_TRUE_PEAK_METER_BLOCK_SIZE) chunk = BLT_TRUE_PEAK_METER_BLOCK_SIZE;
+
+        BLT_TruePeakMeter_ProcessBlock(self, samples, chunk, peaks?peaks:block_peaks);
+
+        samples     += chunk*self->channel_count;
+        frame_count -= chunk;
+        if (peaks) peaks += chunk;
+    }
+}
@@ -0,0 +1,80 @@
+/*****************************************************************
+|
+|   BlueTune - True Peak Meter
+|
+|   (c) 2002-2012 Gilles Boccon-Gibod
+|   Author: Gilles Boccon-Gibod (bok@bok.net)
+|
+ ****************************************************************/
+/** @file
+ * True peak meter: estimates the peak level of a signal between
+ * samples, by oversampling it 4 times with the polyphase interpolation
+ * filter of ITU-R BS.1770.
+ */
+
+#ifndef _BLT_TRUE_PEAK_H_
+#define _BLT_TRUE_PEAK_H_
+
+/*----------------------------------------------------------------------
+|   includes
++---------------------------------------------------------------------*/
+#include "BltTypes.h"
+
+/*----------------------------------------------------------------------
+|   constants
++---------------------------------------------------------------------*/
+#define BLT_TRUE_PEAK_METER_MAX_CHANNELS 8
+#define BLT_TRUE_PEAK_METER_PHASES       4
+#define BLT_TRUE_PEAK_METER_TAPS         12
+
+/**
+ * Latency of the meter, in frames: the peak value computed for a frame
+ * covers the interval between the samples that entered the meter
+ * BLT_TRUE_PEAK_METER_DELAY+1 and BLT_TRUE_PEAK_METER_DELAY frames before.
+ */
+#define BLT_TRUE_PEAK_METER_DELAY        5
+
+/*----------------------------------------------------------------------
+|   types
++---------------------------------------------------------------------*/
+typedef struct {
+    BLT_Cardinal channel_count;
+    float        history[BLT_TRUE_PEAK_METER_MAX_CHANNELS][BLT_TRUE_PEAK_METER_TAPS-1];
+    float        peak; /**< Largest peak since the last reset */
+} BLT_TruePeakMeter;
+
+/*----------------------------------------------------------------------
+|   prototypes
++---------------------------------------------------------------------*/
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/**
+ * Initialize a meter for a number of channels.
+ * Returns BLT_ERROR_NOT_SUPPORTED if there are more than
+ * BLT_TRUE_PEAK_METER_MAX_CHANNELS channels.
+ */
+BLT_Result BLT_TruePeakMeter_Init(BLT_TruePeakMeter* self, BLT_Cardinal channel_count);
+
+/**
+ * Clear the filter history and the peak value.
+ */
+void BLT_TruePeakMeter_Reset(BLT_TruePeakMeter* self);
+
+/**
+ * Measure a buffer of interleaved float samples.
+ * @param peaks If not NULL, receives one value per frame: the largest
+ * absolute oversampled value across all channels (see
+ * BLT_TRUE_PEAK_METER_DELAY for how these values line up with the input).
+ */
+void BLT_TruePeakMeter_Process(BLT_TruePeakMeter* self,
+                               const float*       samples,
+                               BLT_Cardinal       frame_count,
+                               float*             peaks);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* _BLT_TRUE_PEAK_H_ */
@@ -10,6 +10,13 @@
 /*----------------------------------------------------------------------
 |   includes
 +---------------------------------------------------------------------*/
+#if defined(_WIN32)
+#include <windows.h>
+#else
+#include <pthread.h>
+#include <unistd.h>
+#endif
+
 #include "Atomix.h"
 #include "BltConfig.h"
 #include "BltCore.h"
@@ -36,10 +43,50 @@ ATX_SET_LOCAL_LOGGER("bluetune.plugins.decoders.ffmpeg")
 |   constants
 +---------------------------------------------------------------------*/
 #define BLT_FFMPEG_INPUT_PADDING_SIZE  256
+#define BLT_FFMPEG_MAX_THREADS         16
+#define BLT_FFMPEG_LINE_ALIGNMENT      64 /* so that chroma lines are 32-byte aligned */
+
+/*----------------------------------------------------------------------
+|   locks
++---------------------------------------------------------------------*/
+#if defined(_WIN32)
+typedef CRITICAL_SECTION FfmpegDecoderLock;
+#define FfmpegDecoderLock_Init(lock)    InitializeCriticalSection(lock)
+#define FfmpegDecoderLock_Destroy(lock) DeleteCriticalSection(lock)
+#define FfmpegDecoderLock_Lock(lock)    EnterCriticalSection(lock)
+#define FfmpegDecoderLock_Unlock(lock)  LeaveCriticalSection(lock)
+#else
+typedef pthread_mutex_t FfmpegDecoderLock;
+#define FfmpegDecoderLock_Init(lock)    pthread_mutex_init(lock, NULL)
+#define FfmpegDecoderLock_Destroy(lock) pthread_mutex_destroy(lock)
+#define FfmpegDecoderLock_Lock(lock)    pthread_mutex_lock(lock)
+#define FfmpegDecoderLock_Unlock(lock)  pthread_mutex_unlock(lock)
+#endif
 
 /*----------------------------------------------------------------------
 |    types
 +---------------------------------------------------------------------*/
+typedef struct FfmpegDecoderPicturePool FfmpegDecoderPicturePool;
+
+/* a buffer that the codec decodes into, and that the packets it is */
+/* output in point to                                               */
+typedef struct FfmpegDecoderPicture {
+    struct FfmpegDecoderPicture* next; /* in the list of free pictures */
+    FfmpegDecoderPicturePool*    pool;
+    unsigned int                 reference_count;
+    BLT_UInt8*                   buffer;
+    BLT_Size                     size;
+} FfmpegDecoderPicture;
+
+/* the pictures are shared by the codec, which may decode on several  */
+/* threads, and the packets, which may be released on other threads, */
+/* so the pool has a lock, and lives until the last picture is freed  */
+struct FfmpegDecoderPicturePool {
+    FfmpegDecoderLock     lock;
+    unsigned int          reference_count; /* the decoder's and the pictures' in use */
+    FfmpegDecoderPicture* free_pictures;
+};
+
 typedef struct {
     /* base class */
     ATX_EXTENDS(BLT_BaseModule);
@@ -74,12 +121,14 @@ typedef struct {
     ATX_EXTENDS(BLT_BaseMediaNode);
 
     /* members */
-    FfmpegDecoderModule*  module;
-    FfmpegDecoderInput    input;
-    FfmpegDecoderOutput   output;
-    AVCodecContext*       codec_context;
-    AVCodecParserContext* parser_context;
-    AVFrame*              frame;
+    FfmpegDecoderModule*      module;
+    FfmpegDecoderInput        input;
+    FfmpegDecoderOutput       output;
+    AVCodecContext*           codec_context;
+    AVCodecParserContext*     parser_context;
+    AVFrame*                  frame;
+    FfmpegDecoderPicturePool* pool;
+    unsigned int              thread_count;
 } FfmpegDecoder;
 
 /*----------------------------------------------------------------------
@@ -94,20 +143,176 @@ ATX_DECLARE_INTERFACE_MAP(FfmpegDecoderModule, BLT_Module)
 ATX_DECLARE_INTERFACE_MAP(FfmpegDecoder, BLT_MediaNode)
 ATX_DECLARE_INTERFACE_MAP(FfmpegDecoder, ATX_Referenceable)
 
+/*----------------------------------------------------------------------
+|   FfmpegDecoderPicturePool_Create
++---------------------------------------------------------------------*/
+static BLT_Result
+FfmpegDecoderPicturePool_Create(FfmpegDecoderPicturePool** pool)
+{
+    *pool = (FfmpegDecoderPicturePool*)ATX_AllocateZeroMemory(sizeof(FfmpegDecoderPicturePool));
+    if (*pool == NULL) return BLT_ERROR_OUT_OF_MEMORY;
+    FfmpegDecoderLock_Init(&(*pool)->lock);
+    (*pool)->reference_count = 1;
+
+    return BLT_SUCCESS;
+}
+
+/*----------------------------------------------------------------------
+|   FfmpegDecoderPicturePool_Release
+|
+|   Called with the lock held, which is released.
++---------------------------------------------------------------------*/
+static void
+FfmpegDecoderPicturePool_Release(FfmpegDecoderPicturePool* self)
+{
+    FfmpegDecoderPicture* picture;
+
+    if (--self->reference_count) {
+        FfmpegDecoderLock_Unlock(&self->lock);
+        return;
+    }
+    FfmpegDecoderLock_Unlock(&self->lock);
+
+    /* nobody uses the pool anymore */
+    while ((picture = self->free_pictures)) {
+        self->free_pictures = picture->next;
+        av_free(picture->buffer);
+        ATX_FreeMemory(picture);
+    }
+    FfmpegDecoderLock_Destroy(&self->lock);
+    ATX_FreeMemory(self);
+}
+
+/*----------------------------------------------------------------------
+|   FfmpegDecoderPicturePool_GetPicture
++---------------------------------------------------------------------*/
+static FfmpegDecoderPicture*
+FfmpegDecoderPicturePool_GetPicture(FfmpegDecoderPicturePool* self, BLT_Size size)
+{
+    FfmpegDecoderPicture* picture;
+
+    /* reuse a free picture */
+    FfmpegDecoderLock_Lock(&self->lock);
+    while ((picture = self->free_pictures)) {
+        self->free_pictures = picture->next;
+        if (picture->size == size) break;
+
+        /* from before a change of picture size */
+        av_free(picture->buffer);
+        ATX_FreeMemory(picture);
+    }
+    ++self->reference_count;
+    FfmpegDecoderLock_Unlock(&self->lock);
+
+    /* or allocate a new one */
+    if (picture == NULL) {
+        picture = (FfmpegDecoderPicture*)ATX_AllocateZeroMemory(sizeof(FfmpegDecoderPicture));
+        if (picture) {
+            picture->pool   = self;
+            picture->size   = size;
+            picture->buffer = av_malloc(size);
+            if (picture->buffer == NULL) {
+                ATX_FreeMemory(picture);
+                picture = NULL;
+            }
+        }
+        if (picture == NULL) {
+            FfmpegDecoderLock_Lock(&self->lock);
+            FfmpegDecoderPicturePool_Release(self);
+            return NULL;
+        }
+    }
+    picture->next            = NULL;
+    picture->reference_count = 1;
+
+    return picture;
+}
+
+/*----------------------------------------------------------------------
+|   FfmpegDecoderPicture_AddReference
++---------------------------------------------------------------------*/
+static void
+FfmpegDecoderPicture_AddReference(FfmpegDecoderPicture* self)
+{
+    FfmpegDecoderLock_Lock(&self->pool->lock);
+    ++self->reference_count;
+    FfmpegDecoderLock_Unlock(&self->pool->lock);
+}
+
+/*----------------------------------------------------------------------
+|   FfmpegDecoderPicture_Release
++---------------------------------------------------------------------*/
+static void
+FfmpegDecoderPicture_Release(FfmpegDecoderPicture* self)
+{
+    FfmpegDecoderPicturePool* pool = self->pool;
+
+    FfmpegDecoderLock_Lock(&pool->lock);
+    if (--self->reference_count) {
+        FfmpegDecoderLock_Unlock(&pool->lock);
+        return;
+    }
+
+    /* back to the pool */
+    self->next = pool->free_pictures;
+    pool->free_pictures = self;
+    FfmpegDecoderPicturePool_Release(pool);
+}
+
+/*----------------------------------------------------------------------
+|   FfmpegDecoder_PictureDestruct
+|
+|   Called when a packet that points to a picture is destroyed.
++---------------------------------------------------------------------*/
+static void
+FfmpegDecoder_PictureDestruct(BLT_Any instance, BLT_Any buffer)
+{
+    ATX_COMPILER_UNUSED(buffer);
+    FfmpegDecoderPicture_Release((FfmpegDecoderPicture*)instance);
+}
+
 /*----------------------------------------------------------------------
 |   FfmpegDecoder_GetBufferCallback
+|
+|   Gives the codec a picture from the pool to decode into, so that it
+|   can be passed on without copying it. This may be called from the
+|   codec's threads.
 +---------------------------------------------------------------------*/
 static int 
 FfmpegDecoder_GetBufferCallback(struct AVCodecContext* context, 
                                 AVFrame*               pic) 
 {
-    int ret = avcodec_default_get_buffer(context, pic);
-    if (context->opaque) {
-        BLT_TimeStamp *pts = av_malloc(sizeof(BLT_TimeStamp));
-        *pts = BLT_TimeStamp_FromNanos(*(int64_t*)context->opaque);
-        pic->opaque = pts;
-    }
-    return ret;
+    FfmpegDecoder*        self   = (FfmpegDecoder*)context->opaque;
+    int                   width  = context->width;
+    int                   height = context->height;
+    unsigned int          pitch;
+    unsigned int          chroma_size;
+    FfmpegDecoderPicture* picture;
+
+    /* the codec works on whole macroblocks */
+    avcodec_align_dimensions(context, &width, &height);
+    pitch       = (width+BLT_FFMPEG_LINE_ALIGNMENT-1)&~(BLT_FFMPEG_LINE_ALIGNMENT-1);
+    chroma_size = (pitch/2)*((height+1)/2);
+
+    picture = FfmpegDecoderPicturePool_GetPicture(self->pool, pitch*height+2*chroma_size);
+    if (picture == NULL) return -1;
+
+    pic->data[0]     = picture->buffer;
+    pic->data[1]     = picture->buffer+pitch*height;
+    pic->data[2]     = picture->buffer+pitch*height+chroma_size;
+    pic->data[3]     = NULL;
+    pic->linesize[0] = pitch;
+    pic->linesize[1] = pitch/2;
+    pic->linesize[2] = pitch/2;
+    pic->linesize[3] = 0;
+    pic->type        = FF_BUFFER_TYPE_USER;
+    pic->opaque      = picture;
+    pic->age         = 256*256*256*64; /* the content is unknown */
+
+    /* the timestamp of the input goes through the codec with the picture */
+    pic->reordered_opaque = context->reordered_opaque;
+
+    return 0;
 }
 
 /*----------------------------------------------------------------------
@@ -128,8 +333,35 @@ static void
 FfmpegDecoder_ReleaseBufferCallback(struct AVCodecContext* context, 
                                     AVFrame*               pic) 
 {
-    if (pic && pic->opaque) av_freep(&pic->opaque);
-    avcodec_default_release_buffer(context, pic);
+    unsigned int i;
+
+    ATX_COMPILER_UNUSED(context);
+    if (pic->opaque) {
+        /* the packets may still be using it */
+        FfmpegDecoderPicture_Release((FfmpegDecoderPicture*)pic->opaque);
+        pic->opaque = NULL;
+    }
+    for (i=0; i<4; i++) {
+        pic->data[i] = NULL;
+    }
+}
+
+/*----------------------------------------------------------------------
+|   FfmpegDecoder_GetProcessorCount
++---------------------------------------------------------------------*/
+static unsigned int
+FfmpegDecoder_GetProcessorCount(void)
+{
+#if defined(_WIN32)
+    SYSTEM_INFO info;
+    GetSystemInfo(&info);
+    return info.dwNumberOfProcessors;
+#elif defined(_SC_NPROCESSORS_ONLN)
+    long count = sysconf(_SC_NPROCESSORS_ONLN);
+    return count > 0 ? (unsigned int)count : 1;
+#else
+    return 1;
+#endif
 }
 
 /*----------------------------------------------------------------------
@@ -143,8 +375,62 @@ FfmpegDecoder_ListItemDestruct(ATX_ListDataDestructor* self, ATX_Any data, ATX_U
     BLT_MediaPacket_Release((BLT_MediaPacket*)data);
 }
 
+/*----------------------------------------------------------------------
+|   FfmpegDecoder_OutputPicture
+|
+|   Queues a packet that points to the decoded picture, and that keeps
+|   the picture's buffer from being reused until it is released.
++---------------------------------------------------------------------*/
+static BLT_Result
+FfmpegDecoder_OutputPicture(FfmpegDecoder* self)
+{
+    FfmpegDecoderPicture*           picture = (FfmpegDecoderPicture*)self->frame->opaque;
+    BLT_MediaPacket*                packet  = NULL;
+    BLT_MediaPacketBufferDestructor destructor;
+    BLT_Result                      result;
+    unsigned int                    i;
+
+    if (picture == NULL) return BLT_ERROR_INTERNAL;
+
+    ATX_LOG_FINEST_2("decoded frame width=%d, height=%d",
+                      self->codec_context->width, 
+                      self->codec_context->height);
+    self->output.media_type.width  = self->codec_context->width;
+    self->output.media_type.height = self->codec_context->height;
+    self->output.media_type.format = BLT_PIXEL_FORMAT_YV12;
+    self->output.media_type.flags  = 0;
+    for (i=0; i<3; i++) {
+        self->output.media_type.planes[i].offset         = (BLT_UInt32)(self->frame->data[i]-picture->buffer);
+        self->output.media_type.planes[i].bytes_per_line = self->frame->linesize[i];
+    }
+
+    /* the packet holds a reference to the picture */
+    destructor.instance = picture;
+    destructor.Destruct = FfmpegDecoder_PictureDestruct;
+    result = BLT_MediaPacket_CreateWithBuffer(picture->buffer,
+                                              picture->size,
+                                              &self->output.media_type.base,
+                                              &destructor,
+                                              &packet);
+    if (BLT_FAILED(result)) {
+        ATX_LOG_WARNING_1("BLT_MediaPacket_CreateWithBuffer returned %d", result);
+        return result;
+    }
+    FfmpegDecoderPicture_AddReference(picture);
+
+    /* the timestamp of the input went through the codec with the picture */
+    BLT_MediaPacket_SetTimeStamp(packet, BLT_TimeStamp_FromNanos(self->frame->reordered_opaque));
+
+    ATX_List_AddData(self->output.pictures, packet);
+
+    return BLT_SUCCESS;
+}
+
 /*----------------------------------------------------------------------
 |   FfmpegDecoder_DecodePicture
+|
+|   With a NULL packet, outputs one of the pictures that the codec is
+|   holding back, or returns BLT_ERROR_PORT_HAS_NO_DATA if there are none.
 +---------------------------------------------------------------------*/
 static BLT_Result
 FfmpegDecoder_DecodePicture(FfmpegDecoder* self, BLT_MediaPacket* packet)
@@ -174,6 +460,16 @@ FfmpegDecoder_DecodePicture(FfmpegDecoder* self, BLT_MediaPacket* packet)
                          (float)BLT_MediaPacket_GetTimeStamp(packet).nanoseconds/1000000000.0f);
     } else {
         ATX_LOG_FINEST("flushing delayed frames");
+        
+        /* an empty input gets one of the delayed pictures out of the codec */
+        self->codec_context->reordered_opaque = 0;
+        av_result = avcodec_decode_video(self->codec_context, 
+                                         self->frame, 
+                                         &got_picture, 
+                                         NULL, 
+                                         0);
+        if (av_result < 0 || !got_picture) return BLT_ERROR_PORT_HAS_NO_DATA;
+        return FfmpegDecoder_OutputPicture(self);
     }
     
     while (packet_size) {
@@ -210,7 +506,7 @@ FfmpegDecoder_DecodePicture(FfmpegDecoder* self, BLT_MediaPacket* packet)
         
         /* feed the codec */
         ATX_LOG_FINE_1("decoding video frame (%d bytes)", frame_buffer_size);
-        self->codec_context->opaque = &frame_ts;
+        self->codec_context->reordered_opaque = frame_ts;
         av_result = avcodec_decode_video(self->codec_context, 
                                          self->frame, 
                                          &got_picture, 
@@ -220,66 +516,47 @@ FfmpegDecoder_DecodePicture(FfmpegDecoder* self, BLT_MediaPacket* packet)
             ATX_LOG_FINE_1("avcodec_decode_video returned %d", av_result);
             continue;
         }
-        if (got_picture) {
-            BLT_MediaPacket* picture = NULL;
-            BLT_Result       result;
-            unsigned int     plane_size[3];
-            unsigned int     padding_size[3] = {0,0,0};
-            unsigned int     picture_size = 0;
-            unsigned char*   picture_buffer;
-            unsigned int     i;
-        
-            ATX_LOG_FINEST_2("decoded frame width=%d, height=%d",
-                              self->codec_context->width, 
-                              self->codec_context->height);
-            self->output.media_type.width  = self->codec_context->width;
-            self->output.media_type.height = self->codec_context->height;
-            self->output.media_type.format = BLT_PIXEL_FORMAT_YV12;
-            self->output.media_type.flags  = 0;
-            for (i=0; i<3; i++) {
-                if (i==0) {
-                    /* Y' plane */
-                    plane_size[i] = self->frame->linesize[i]*self->codec_context->height;
-                } else {
-                    /* Cb and Cr planes */
-                    plane_size[i] = self->frame->linesize[i]*self->codec_context->height/2;
-                }
-                if (plane_size[i]%16) {
-                    padding_size[i] = 16-(plane_size[i]%16);
-                }
-                self->output.media_type.planes[i].offset = picture_size;
-                self->output.media_type.planes[i].bytes_per_line = self->frame->linesize[i];
-                picture_size += plane_size[i]+padding_size[i];
-            }
-
-            result = BLT_Core_CreateMediaPacket(ATX_BASE(self, BLT_BaseMediaNode).core, 
-                                                picture_size, 
-                                                &self->output.media_type.base, 
-                                                &picture);
-            if (BLT_FAILED(result)) {
-                ATX_LOG_WARNING_1("BLT_Core_CreateMediaPacket returned %d", result);
-                continue;
-            }
-            
-            /* retrieve the timestamp from the frame */
-            if (self->frame->opaque) {
-                BLT_TimeStamp* pts = (BLT_TimeStamp*)self->frame->opaque;
-                if (pts) BLT_MediaPacket_SetTimeStamp(picture, *pts);
-            }
+        if (got_picture) FfmpegDecoder_OutputPicture(self);
+    } 
+    
+    return BLT_SUCCESS;
+}
 
-            /* setup the picture buffer */
-            BLT_MediaPacket_SetPayloadSize(picture, picture_size);
-            picture_buffer = BLT_MediaPacket_GetPayloadBuffer(picture);
-            for (i=0; i<3; i++) {
-                ATX_CopyMemory(picture_buffer+self->output.media_type.planes[i].offset, 
-                               self->frame->data[i], 
-                               plane_size[i]);
+/*----------------------------------------------------------------------
+|   FfmpegDecoder_Drain
+|
+|   Outputs all the pictures that the codec is holding back.
++---------------------------------------------------------------------*/
+static void
+FfmpegDecoder_Drain(FfmpegDecoder* self)
+{
+    /* the parser holds on to the last frame until it sees the next one */
+    if (self->parser_context) {
+        uint8_t* frame_buffer      = NULL;
+        int      frame_buffer_size = 0;
+        int      got_picture       = 0;
+        
+        av_parser_parse(self->parser_context, 
+                        self->codec_context,
+                        &frame_buffer,
+                        &frame_buffer_size,
+                        NULL,
+                        0,
+                        AV_NOPTS_VALUE,
+                        AV_NOPTS_VALUE);
+        if (frame_buffer != NULL && frame_buffer_size != 0) {
+            self->codec_context->reordered_opaque = self->parser_context->pts;
+            if (avcodec_decode_video(self->codec_context, 
+                                     self->frame, 
+                                     &got_picture, 
+                                     frame_buffer, 
+                                     frame_buffer_size) >= 0 && got_picture) {
+                FfmpegDecoder_OutputPicture(self);
             }
-            ATX_List_AddData(self->output.pictures, picture);
         }
-    } 
+    }
     
-    return BLT_SUCCESS;
+    while (BLT_SUCCEEDED(FfmpegDecoder_DecodePicture(self, NULL))) {}
 }
 
 /*----------------------------------------------------------------------
@@ -322,10 +599,7 @@ FfmpegDecoderInput_PutPacket(BLT_PacketConsumer* _self,
             
         /* release any previous delayed pictures, codec and frame */
         if (self->codec_context) {
-            BLT_Result result;
-            do {
-                result = FfmpegDecoder_DecodePicture(self, NULL);
-            } while (BLT_SUCCEEDED(result));
+            FfmpegDecoder_Drain(self);
             avcodec_close(self->codec_context);
             av_free(self->codec_context);
             self->codec_context = NULL;
@@ -360,7 +634,15 @@ FfmpegDecoderInput_PutPacket(BLT_PacketConsumer* _self,
         self->codec_context->skip_idct         = AVDISCARD_DEFAULT;
         self->codec_context->skip_loop_filter  = AVDISCARD_DEFAULT;
         self->codec_context->error_concealment = 3;
+        self->codec_context->flags            |= CODEC_FLAG_EMU_EDGE; /* the pictures have no edges */
+        self->codec_context->opaque            = self;
+#if defined(FF_THREAD_FRAME)
+        self->codec_context->thread_count          = self->thread_count;
+        self->codec_context->thread_type           = FF_THREAD_FRAME | FF_THREAD_SLICE;
+        self->codec_context->thread_safe_callbacks = 1;
+#else
         self->codec_context->thread_count      = 1;
+#endif
         
         /* setup the callbacks */
         self->codec_context->get_buffer     = FfmpegDecoder_GetBufferCallback;
@@ -383,6 +665,15 @@ FfmpegDecoderInput_PutPacket(BLT_PacketConsumer* _self,
             }
         }
         
+#if !defined(FF_THREAD_FRAME)
+        /* this libavcodec only has slice threading */
+        if (self->thread_count > 1) {
+            if (avcodec_thread_init(self->codec_context, self->thread_count) < 0) {
+                ATX_LOG_WARNING("FfmpegDecoderInput::PutPacket - avcodec_thread_init failed");
+            }
+        }
+#endif
+
         /* open the codec */
         av_result = avcodec_open(self->codec_context, codec);
         if (av_result < 0) {
@@ -427,6 +718,17 @@ FfmpegDecoderInput_PutPacket(BLT_PacketConsumer* _self,
     
     /* decode a picture */
     FfmpegDecoder_DecodePicture(self, packet);
+    
+    /* at the end of the stream, get the delayed pictures out too */
+    if (BLT_MediaPacket_GetFlags(packet) & BLT_MEDIA_PACKET_FLAG_END_OF_STREAM) {
+        ATX_ListItem* last;
+        FfmpegDecoder_Drain(self);
+        last = ATX_List_GetLastItem(self->output.pictures);
+        if (last) {
+            BLT_MediaPacket_SetFlags((BLT_MediaPacket*)ATX_ListItem_GetData(last), 
+                                     BLT_MEDIA_PACKET_FLAG_END_OF_STREAM);
+        }
+    }
                      
     return BLT_SUCCESS;
 }
@@ -529,6 +831,32 @@ FfmpegDecoder_SetupPorts(FfmpegDecoder* self)
     return BLT_SUCCESS;
 }
 
+/*----------------------------------------------------------------------
+|    FfmpegDecoder_GetThreadCount
++---------------------------------------------------------------------*/
+static unsigned int
+FfmpegDecoder_GetThreadCount(BLT_Core* core)
+{
+    ATX_Properties*   properties = NULL;
+    ATX_PropertyValue value;
+    unsigned int      thread_count = 0;
+
+    if (BLT_SUCCEEDED(BLT_Core_GetProperties(core, &properties)) &&
+        ATX_SUCCEEDED(ATX_Properties_GetProperty(properties, 
+                                                 BLT_FFMPEG_DECODER_THREAD_COUNT, 
+                                                 &value)) &&
+        value.type == ATX_PROPERTY_VALUE_TYPE_INTEGER &&
+        value.data.integer >= 0) {
+        thread_count = value.data.integer;
+    }
+    
+    /* 0 means one per processor */
+    if (thread_count == 0) thread_count = FfmpegDecoder_GetProcessorCount();
+    if (thread_count > BLT_FFMPEG_MAX_THREADS) thread_count = BLT_FFMPEG_MAX_THREADS;
+    
+    return thread_count;
+}
+
 /*----------------------------------------------------------------------
 |    FfmpegDecoder_Create
 +---------------------------------------------------------------------*/
@@ -562,10 +890,20 @@ FfmpegDecoder_Create(BLT_Module*              module,
 
     /* construct the object */
     self->module = (FfmpegDecoderModule*)module;
+    self->thread_count = FfmpegDecoder_GetThreadCount(core);
+    ATX_LOG_FINE_1("decoding with %d threads", self->thread_count);
+    result = FfmpegDecoderPicturePool_Create(&self->pool);
+    if (BLT_FAILED(result)) {
+        ATX_FreeMemory(self);
+        *object = NULL;
+        return result;
+    }
     
     /* setup the input and output ports */
     result = FfmpegDecoder_SetupPorts(self);
     if (BLT_FAILED(result)) {
+        FfmpegDecoderLock_Lock(&self->pool->lock);
+        FfmpegDecoderPicturePool_Release(self->pool);
         ATX_FreeMemory(self);
         *object = NULL;
         return result;
@@ -610,6 +948,10 @@ FfmpegDecoder_Destroy(FfmpegDecoder* self)
     /* free buffered pictures */
     ATX_List_Destroy(self->output.pictures);
 
+    /* the pool goes away with the last picture that is still in use */
+    FfmpegDecoderLock_Lock(&self->pool->lock);
+    FfmpegDecoderPicturePool_Release(self->pool);
+
     /* destruct the inherited object */
     BLT_BaseMediaNode_Destruct(&ATX_BASE(self, BLT_BaseMediaNode));
     
@@ -16,6 +16,9 @@
  * @defgroup ffmpeg_decoder_module FFMPEG Decoder Module 
  * Plugin module creates media nodes capable of decoding the different 
  * media types supported by the FFMPEG avcodec library.
+ * The codec decodes straight into pooled buffers, which the output
+ * packets point to; a buffer is reused once the codec and all the
+ * packets pointing to it have released it.
  * @{ 
  */
 
@@ -25,6 +28,17 @@
 #include "BltTypes.h"
 #include "BltModule.h"
 
+/*----------------------------------------------------------------------
+|   constants
++---------------------------------------------------------------------*/
+/**
+ * Core property: number of threads the codec decodes with (integer).
+ * 0, the default, uses one per processor. With a libavcodec that has
+ * frame threading, several frames are decoded at once, otherwise the
+ * slices of a frame are. Read when a node is created.
+ */
+#define BLT_FFMPEG_DECODER_THREAD_COUNT "Plugins.FfmpegDecoder.ThreadCount"
+
 /*----------------------------------------------------------------------
 |   module
 +---------------------------------------------------------------------*/
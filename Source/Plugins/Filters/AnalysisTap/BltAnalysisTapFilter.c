@@ -0,0 +1,693 @@
+/*****************************************************************
+|
+|   Analysis Tap Filter Module
+|
+|   (c) 2002-2012 Gilles Boccon-Gibod
+|   Author: Gilles Boccon-Gibod (bok@bok.net)
+|
+ ****************************************************************/
+
+/*----------------------------------------------------------------------
+|   includes
++---------------------------------------------------------------------*/
+#include <math.h>
+
+#include "Atomix.h"
+#include "BltConfig.h"
+#include "BltCore.h"
+#include "BltAnalysisTapFilter.h"
+#include "BltAnalysisRing.h"
+#include "BltFft.h"
+#include "BltPcmFloat.h"
+#include "BltMediaNode.h"
+#include "BltMedia.h"
+#include "BltPcm.h"
+#include "BltPacketProducer.h"
+#include "BltPacketConsumer.h"
+
+/*----------------------------------------------------------------------
+|   logging
++---------------------------------------------------------------------*/
+ATX_SET_LOCAL_LOGGER("bluetune.plugins.filters.analysis-tap")
+
+/*----------------------------------------------------------------------
+|    constants
++---------------------------------------------------------------------*/
+/* number of frames converted at a time */
+#define BLT_ANALYSIS_TAP_FILTER_CHUNK_SIZE 256
+
+#define BLT_ANALYSIS_TAP_FILTER_PI 3.14159265358979323846
+
+/*----------------------------------------------------------------------
+|    types
++---------------------------------------------------------------------*/
+typedef BLT_BaseModule AnalysisTapFilterModule;
+
+typedef struct {
+    /* interfaces */
+    ATX_IMPLEMENTS(BLT_MediaPort);
+    ATX_IMPLEMENTS(BLT_PacketConsumer);
+} AnalysisTapFilterInput;
+
+typedef struct {
+    /* interfaces */
+    ATX_IMPLEMENTS(BLT_MediaPort);
+    ATX_IMPLEMENTS(BLT_PacketProducer);
+
+    /* members */
+    BLT_MediaPacket* packet;
+} AnalysisTapFilterOutput;
+
+typedef struct {
+    /* base class */
+    ATX_EXTENDS(BLT_BaseMediaNode);
+
+    /* members */
+    AnalysisTapFilterInput  input;
+    AnalysisTapFilterOutput output;
+    BLT_AnalysisRing*       ring;
+    BLT_Fft*                fft;
+    struct {
+        BLT_PcmMediaType format;
+        BLT_Cardinal     fill;       /* frames in the current block  */
+        BLT_TimeStamp    time_stamp; /* of the start of the block    */
+        double           energy[BLT_ANALYSIS_MAX_CHANNELS];
+        float            peak[BLT_ANALYSIS_MAX_CHANNELS];
+    } state;
+
+    /* everything the analysis needs is allocated up front, so that */
+    /* no memory is allocated while the audio flows                  */
+    float samples[BLT_ANALYSIS_TAP_FILTER_CHUNK_SIZE*BLT_ANALYSIS_MAX_CHANNELS];
+    float mono[BLT_ANALYSIS_BLOCK_SIZE];
+    float window[BLT_ANALYSIS_BLOCK_SIZE];
+    float power[BLT_ANALYSIS_BLOCK_SIZE/2+1];
+} AnalysisTapFilter;
+
+/*----------------------------------------------------------------------
+|   forward declarations
++---------------------------------------------------------------------*/
+ATX_DECLARE_INTERFACE_MAP(AnalysisTapFilterModule, BLT_Module)
+ATX_DECLARE_INTERFACE_MAP(AnalysisTapFilter, BLT_MediaNode)
+ATX_DECLARE_INTERFACE_MAP(AnalysisTapFilter, ATX_Referenceable)
+
+/*----------------------------------------------------------------------
+|    AnalysisTapFilter_ResetBlock
++---------------------------------------------------------------------*/
+static void
+AnalysisTapFilter_ResetBlock(AnalysisTapFilter* self)
+{
+    BLT_Ordinal c;
+
+    self->state.fill = 0;
+    for (c=0; c<BLT_ANALYSIS_MAX_CHANNELS; c++) {
+        self->state.energy[c] = 0.0;
+        self->state.peak[c]   = 0.0f;
+    }
+}
+
+/*----------------------------------------------------------------------
+|    AnalysisTapFilter_PublishBlock
++---------------------------------------------------------------------*/
+static void
+AnalysisTapFilter_PublishBlock(AnalysisTapFilter* self)
+{
+    BLT_AnalysisFrame* frame = BLT_AnalysisRing_BeginWrite(self->ring);
+    BLT_Cardinal       channel_count = self->state.format.channel_count;
+    BLT_Ordinal        c;
+    BLT_Ordinal        i;
+
+    frame->time_stamp    = self->state.time_stamp;
+    frame->sample_rate   = self->state.format.sample_rate;
+    frame->channel_count = channel_count;
+    frame->sample_count  = BLT_ANALYSIS_BLOCK_SIZE;
+    for (c=0; c<BLT_ANALYSIS_MAX_CHANNELS; c++) {
+        if (c < channel_count) {
+            frame->rms[c]  = (float)sqrt(self->state.energy[c]/(double)BLT_ANALYSIS_BLOCK_SIZE);
+            frame->peak[c] = self->state.peak[c];
+        } else {
+            frame->rms[c]  = 0.0f;
+            frame->peak[c] = 0.0f;
+        }
+    }
+
+    if ((BLT_AnalysisRing_GetFlags(self->ring) & BLT_ANALYSIS_RING_FLAG_SPECTRUM) && self->fft) {
+        /* a sine wave of amplitude A peaks at A*N/4 with a Hann window */
+        const float scale = 4.0f/(float)BLT_ANALYSIS_BLOCK_SIZE;
+
+        for (i=0; i<BLT_ANALYSIS_BLOCK_SIZE; i++) {
+            self->mono[i] *= self->window[i];
+        }
+        BLT_Fft_GetPowerSpectrum(self->fft, self->mono, self->power);
+        for (i=0; i<BLT_ANALYSIS_SPECTRUM_SIZE; i++) {
+            frame->spectrum[i] = (float)sqrt(self->power[i])*scale;
+        }
+        frame->spectrum_size = BLT_ANALYSIS_SPECTRUM_SIZE;
+    } else {
+        frame->spectrum_size = 0;
+    }
+
+    BLT_AnalysisRing_EndWrite(self->ring);
+    AnalysisTapFilter_ResetBlock(self);
+}
+
+/*----------------------------------------------------------------------
+|    AnalysisTapFilter_Analyze
++---------------------------------------------------------------------*/
+static void
+AnalysisTapFilter_Analyze(AnalysisTapFilter* self,
+                          BLT_Cardinal       frame_count,
+                          BLT_TimeStamp      time_stamp,
+                          BLT_Cardinal       offset)
+{
+    BLT_Cardinal channel_count = self->state.format.channel_count;
+    float        mix_scale     = 1.0f/(float)channel_count;
+    const float* samples       = self->samples;
+
+    while (frame_count) {
+        BLT_Cardinal chunk = BLT_ANALYSIS_BLOCK_SIZE-self->state.fill;
+        BLT_Ordinal  c;
+        BLT_Ordinal  i;
+
+        if (chunk > frame_count) chunk = frame_count;
+        if (self->state.fill == 0) {
+            self->state.time_stamp = BLT_TimeStamp_Add(time_stamp,
+                BLT_TimeStamp_FromSamples(offset, self->state.format.sample_rate));
+        }
+
+        /* levels, one channel at a time */
+        for (c=0; c<channel_count; c++) {
+            float energy = 0.0f;
+            float peak   = self->state.peak[c];
+            for (i=0; i<chunk; i++) {
+                float x = samples[i*channel_count+c];
+                energy += x*x;
+                if (x < 0.0f) x = -x;
+                if (x > peak) peak = x;
+            }
+            self->state.energy[c] += energy;
+            self->state.peak[c]    = peak;
+        }
+
+        /* mono mix for the spectrum */
+        for (i=0; i<chunk; i++) {
+            float mix = 0.0f;
+            for (c=0; c<channel_count; c++) {
+                mix += samples[i*channel_count+c];
+            }
+            self->mono[self->state.fill+i] = mix*mix_scale;
+        }
+
+        self->state.fill += chunk;
+        if (self->state.fill == BLT_ANALYSIS_BLOCK_SIZE) {
+            AnalysisTapFilter_PublishBlock(self);
+        }
+
+        samples     += chunk*channel_count;
+        offset      += chunk;
+        frame_count -= chunk;
+    }
+}
+
+/*----------------------------------------------------------------------
+|    AnalysisTapFilterInput_PutPacket
++---------------------------------------------------------------------*/
+BLT_METHOD
+AnalysisTapFilterInput_PutPacket(BLT_PacketConsumer* _self,
+                                 BLT_MediaPacket*    packet)
+{
+    AnalysisTapFilter*   self = ATX_SELF_M(input, AnalysisTapFilter, BLT_PacketConsumer);
+    BLT_PcmMediaType*    media_type;
+    const unsigned char* payload;
+    BLT_Cardinal         frame_size;
+    BLT_Cardinal         frame_count;
+    BLT_Ordinal          offset;
+    BLT_TimeStamp        time_stamp;
+    BLT_Result           result;
+
+    /* get the media type */
+    result = BLT_MediaPacket_GetMediaType(packet, (const BLT_MediaType**)(const void*)&media_type);
+    if (BLT_FAILED(result)) return result;
+
+    /* check the media type */
+    if (media_type->base.id != BLT_MEDIA_TYPE_ID_AUDIO_PCM) {
+        return BLT_ERROR_INVALID_MEDIA_TYPE;
+    }
+
+    /* keep the packet */
+    self->output.packet = packet;
+    BLT_MediaPacket_AddReference(packet);
+
+    /* nothing to do if nobody is listening, or if we can't read the samples */
+    if (self->ring == NULL) return BLT_SUCCESS;
+    if (!BLT_PcmFloat_SupportsFormat(media_type) ||
+        media_type->channel_count == 0           ||
+        media_type->channel_count > BLT_ANALYSIS_MAX_CHANNELS) {
+        return BLT_SUCCESS;
+    }
+
+    /* start a new block when the format changes */
+    if (self->state.format.sample_rate     != media_type->sample_rate     ||
+        self->state.format.channel_count   != media_type->channel_count   ||
+        self->state.format.bits_per_sample != media_type->bits_per_sample ||
+        self->state.format.sample_format   != media_type->sample_format) {
+        self->state.format = *media_type;
+        AnalysisTapFilter_ResetBlock(self);
+    }
+
+    payload     = (const unsigned char*)BLT_MediaPacket_GetPayloadBuffer(packet);
+    frame_size  = media_type->channel_count*media_type->bits_per_sample/8;
+    frame_count = BLT_MediaPacket_GetPayloadSize(packet)/frame_size;
+    time_stamp  = BLT_MediaPacket_GetTimeStamp(packet);
+    for (offset=0; offset<frame_count; offset += BLT_ANALYSIS_TAP_FILTER_CHUNK_SIZE) {
+        BLT_Cardinal chunk = frame_count-offset;
+        if (chunk > BLT_ANALYSIS_TAP_FILTER_CHUNK_SIZE) chunk = BLT_ANALYSIS_TAP_FILTER_CHUNK_SIZE;
+
+        BLT_PcmFloat_Import(media_type,
+                            payload+offset*frame_size,
+                            chunk*media_type->channel_count,
+                            self->samples);
+        AnalysisTapFilter_Analyze(self, chunk, time_stamp, offset);
+    }
+
+    return BLT_SUCCESS;
+}
+
+/*----------------------------------------------------------------------
+|   AnalysisTapFilterInput_QueryMediaType
++---------------------------------------------------------------------*/
+BLT_METHOD
+AnalysisTapFilterInput_QueryMediaType(BLT_MediaPort*         self,
+                                      BLT_Ordinal            index,
+                                      const BLT_MediaType**  media_type)
+{
+    BLT_COMPILER_UNUSED(self);
+    if (index == 0) {
+        *media_type = &BLT_GenericPcmMediaType;
+        return BLT_SUCCESS;
+    } else {
+        *media_type = NULL;
+        return BLT_FAILURE;
+    }
+}
+
+/*----------------------------------------------------------------------
+|   GetInterface implementation
++---------------------------------------------------------------------*/
+ATX_BEGIN_GET_INTERFACE_IMPLEMENTATION(AnalysisTapFilterInput)
+    ATX_GET_INTERFACE_ACCEPT(AnalysisTapFilterInput, BLT_MediaPort)
+    ATX_GET_INTERFACE_ACCEPT(AnalysisTapFilterInput, BLT_PacketConsumer)
+ATX_END_GET_INTERFACE_IMPLEMENTATION
+
+/*----------------------------------------------------------------------
+|    BLT_PacketConsumer interface
++---------------------------------------------------------------------*/
+ATX_BEGIN_INTERFACE_MAP(AnalysisTapFilterInput, BLT_PacketConsumer)
+    AnalysisTapFilterInput_PutPacket
+ATX_END_INTERFACE_MAP
+
+/*----------------------------------------------------------------------
+|    BLT_MediaPort interface
++---------------------------------------------------------------------*/
+BLT_MEDIA_PORT_IMPLEMENT_SIMPLE_TEMPLATE(AnalysisTapFilterInput,
+                                         "input",
+                                         PACKET,
+                                         IN)
+ATX_BEGIN_INTERFACE_MAP(AnalysisTapFilterInput, BLT_MediaPort)
+    AnalysisTapFilterInput_GetName,
+    AnalysisTapFilterInput_GetProtocol,
+    AnalysisTapFilterInput_GetDirection,
+    AnalysisTapFilterInput_QueryMediaType
+ATX_END_INTERFACE_MAP
+
+/*----------------------------------------------------------------------
+|    AnalysisTapFilterOutput_GetPacket
++---------------------------------------------------------------------*/
+BLT_METHOD
+AnalysisTapFilterOutput_GetPacket(BLT_PacketProducer* _self,
+                                  BLT_MediaPacket**   packet)
+{
+    AnalysisTapFilter* self = ATX_SELF_M(output, AnalysisTapFilter, BLT_PacketProducer);
+
+    if (self->output.packet) {
+        *packet = self->output.packet;
+        self->output.packet = NULL;
+        return BLT_SUCCESS;
+    } else {
+        *packet = NULL;
+        return BLT_ERROR_PORT_HAS_NO_DATA;
+    }
+}
+
+/*----------------------------------------------------------------------
+|   AnalysisTapFilterOutput_QueryMediaType
++---------------------------------------------------------------------*/
+BLT_METHOD
+AnalysisTapFilterOutput_QueryMediaType(BLT_MediaPort*         self,
+                                       BLT_Ordinal            index,
+                                       const BLT_MediaType**  media_type)
+{
+    BLT_COMPILER_UNUSED(self);
+    if (index == 0) {
+        *media_type = &BLT_GenericPcmMediaType;
+        return BLT_SUCCESS;
+    } else {
+        *media_type = NULL;
+        return BLT_FAILURE;
+    }
+}
+
+/*----------------------------------------------------------------------
+|   GetInterface implementation
++---------------------------------------------------------------------*/
+ATX_BEGIN_GET_INTERFACE_IMPLEMENTATION(AnalysisTapFilterOutput)
+    ATX_GET_INTERFACE_ACCEPT(AnalysisTapFilterOutput, BLT_MediaPort)
+    ATX_GET_INTERFACE_ACCEPT(AnalysisTapFilterOutput, BLT_PacketProducer)
+ATX_END_GET_INTERFACE_IMPLEMENTATION
+
+/*----------------------------------------------------------------------
+|    BLT_MediaPort interface
++---------------------------------------------------------------------*/
+BLT_MEDIA_PORT_IMPLEMENT_SIMPLE_TEMPLATE(AnalysisTapFilterOutput,
+                                         "output",
+                                         PACKET,
+                                         OUT)
+ATX_BEGIN_INTERFACE_MAP(AnalysisTapFilterOutput, BLT_MediaPort)
+    AnalysisTapFilterOutput_GetName,
+    AnalysisTapFilterOutput_GetProtocol,
+    AnalysisTapFilterOutput_GetDirection,
+    AnalysisTapFilterOutput_QueryMediaType
+ATX_END_INTERFACE_MAP
+
+/*----------------------------------------------------------------------
+|    BLT_PacketProducer interface
++---------------------------------------------------------------------*/
+ATX_BEGIN_INTERFACE_MAP(AnalysisTapFilterOutput, BLT_PacketProducer)
+    AnalysisTapFilterOutput_GetPacket
+ATX_END_INTERFACE_MAP
+
+/*----------------------------------------------------------------------
+|    AnalysisTapFilter_Create
++---------------------------------------------------------------------*/
+static BLT_Result
+AnalysisTapFilter_Create(BLT_Module*              module,
+                         BLT_Core*                core,
+                         BLT_ModuleParametersType parameters_type,
+                         BLT_AnyConst             parameters,
+                         BLT_MediaNode**          object)
+{
+    AnalysisTapFilter* self;
+    BLT_Ordinal        i;
+    BLT_Result         result;
+
+    ATX_LOG_FINE("AnalysisTapFilter::Create");
+
+    /* check parameters */
+    if (parameters == NULL ||
+        parameters_type != BLT_MODULE_PARAMETERS_TYPE_MEDIA_NODE_CONSTRUCTOR) {
+        return BLT_ERROR_INVALID_PARAMETERS;
+    }
+
+    /* allocate memory for the object */
+    self = ATX_AllocateZeroMemory(sizeof(AnalysisTapFilter));
+    if (self == NULL) {
+        *object = NULL;
+        return BLT_ERROR_OUT_OF_MEMORY;
+    }
+
+    /* construct the inherited object */
+    BLT_BaseMediaNode_Construct(&ATX_BASE(self, BLT_BaseMediaNode), module, core);
+
+    /* construct the object */
+    result = BLT_Fft_Create(BLT_ANALYSIS_BLOCK_SIZE, &self->fft);
+    if (BLT_FAILED(result)) {
+        BLT_BaseMediaNode_Destruct(&ATX_BASE(self, BLT_BaseMediaNode));
+        ATX_FreeMemory(self);
+        *object = NULL;
+        return result;
+    }
+    for (i=0; i<BLT_ANALYSIS_BLOCK_SIZE; i++) {
+        self->window[i] = (float)(0.5-0.5*cos(2.0*BLT_ANALYSIS_TAP_FILTER_PI*(double)i/
+                                              (double)BLT_ANALYSIS_BLOCK_SIZE));
+    }
+
+    /* setup interfaces */
+    ATX_SET_INTERFACE_EX(self, AnalysisTapFilter, BLT_BaseMediaNode, BLT_MediaNode);
+    ATX_SET_INTERFACE_EX(self, AnalysisTapFilter, BLT_BaseMediaNode, ATX_Referenceable);
+    ATX_SET_INTERFACE(&self->input,  AnalysisTapFilterInput,  BLT_MediaPort);
+    ATX_SET_INTERFACE(&self->input,  AnalysisTapFilterInput,  BLT_PacketConsumer);
+    ATX_SET_INTERFACE(&self->output, AnalysisTapFilterOutput, BLT_MediaPort);
+    ATX_SET_INTERFACE(&self->output, AnalysisTapFilterOutput, BLT_PacketProducer);
+    *object = &ATX_BASE_EX(self, BLT_BaseMediaNode, BLT_MediaNode);
+
+    return BLT_SUCCESS;
+}
+
+/*----------------------------------------------------------------------
+|    AnalysisTapFilter_Destroy
++---------------------------------------------------------------------*/
+static BLT_Result
+AnalysisTapFilter_Destroy(AnalysisTapFilter* self)
+{
+    ATX_LOG_FINE("AnalysisTapFilter::Destroy");
+
+    /* release any input packet we may hold */
+    if (self->output.packet) {
+        BLT_MediaPacket_Release(self->output.packet);
+    }
+
+    /* free the transform */
+    BLT_Fft_Destroy(self->fft);
+
+    /* destruct the inherited object */
+    BLT_BaseMediaNode_Destruct(&ATX_BASE(self, BLT_BaseMediaNode));
+
+    /* free the object memory */
+    ATX_FreeMemory((void*)self);
+
+    return BLT_SUCCESS;
+}
+
+/*----------------------------------------------------------------------
+|   AnalysisTapFilter_GetPortByName
++---------------------------------------------------------------------*/
+BLT_METHOD
+AnalysisTapFilter_GetPortByName(BLT_MediaNode*  _self,
+                                BLT_CString     name,
+                                BLT_MediaPort** port)
+{
+    AnalysisTapFilter* self = ATX_SELF_EX(AnalysisTapFilter, BLT_BaseMediaNode, BLT_MediaNode);
+
+    if (ATX_StringsEqual(name, "input")) {
+        *port = &ATX_BASE(&self->input, BLT_MediaPort);
+        return BLT_SUCCESS;
+    } else if (ATX_StringsEqual(name, "output")) {
+        *port = &ATX_BASE(&self->output, BLT_MediaPort);
+        return BLT_SUCCESS;
+    } else {
+        *port = NULL;
+        return BLT_ERROR_NO_SUCH_PORT;
+    }
+}
+
+/*----------------------------------------------------------------------
+|    AnalysisTapFilter_Activate
++---------------------------------------------------------------------*/
+BLT_METHOD
+AnalysisTapFilter_Activate(BLT_MediaNode* _self, BLT_Stream* stream)
+{
+    AnalysisTapFilter* self = ATX_SELF_EX(AnalysisTapFilter, BLT_BaseMediaNode, BLT_MediaNode);
+    ATX_Properties*    properties;
+
+    /* keep a reference to the stream */
+    ATX_BASE(self, BLT_BaseMediaNode).context = stream;
+
+    /* find the ring to write to */
+    self->ring = NULL;
+    if (BLT_SUCCEEDED(BLT_Core_GetProperties(ATX_BASE(self, BLT_BaseMediaNode).core,
+                                             &properties))) {
+        ATX_PropertyValue value;
+        if (ATX_SUCCEEDED(ATX_Properties_GetProperty(properties,
+                                                     BLT_ANALYSIS_RING_PROPERTY,
+                                                     &value)) &&
+            value.type == ATX_PROPERTY_VALUE_TYPE_POINTER) {
+            self->ring = (BLT_AnalysisRing*)value.data.pointer;
+        } else {
+            ATX_LOG_FINE("AnalysisTapFilter::Activate - no analysis ring");
+        }
+    }
+
+    /* start from scratch */
+    ATX_SetMemory(&self->state.format, 0, sizeof(self->state.format));
+    AnalysisTapFilter_ResetBlock(self);
+
+    return BLT_SUCCESS;
+}
+
+/*----------------------------------------------------------------------
+|    AnalysisTapFilter_Deactivate
++---------------------------------------------------------------------*/
+BLT_METHOD
+AnalysisTapFilter_Deactivate(BLT_MediaNode* _self)
+{
+    AnalysisTapFilter* self = ATX_SELF_EX(AnalysisTapFilter, BLT_BaseMediaNode, BLT_MediaNode);
+
+    /* we're detached from the stream */
+    ATX_BASE(self, BLT_BaseMediaNode).context = NULL;
+    self->ring = NULL;
+
+    return BLT_SUCCESS;
+}
+
+/*----------------------------------------------------------------------
+|    AnalysisTapFilter_Seek
++---------------------------------------------------------------------*/
+BLT_METHOD
+AnalysisTapFilter_Seek(BLT_MediaNode* _self,
+                       BLT_SeekMode*  mode,
+                       BLT_SeekPoint* point)
+{
+    AnalysisTapFilter* self = ATX_SELF_EX(AnalysisTapFilter, BLT_BaseMediaNode, BLT_MediaNode);
+
+    BLT_COMPILER_UNUSED(mode);
+    BLT_COMPILER_UNUSED(point);
+
+    if (self->output.packet) {
+        BLT_MediaPacket_Release(self->output.packet);
+        self->output.packet = NULL;
+    }
+
+    /* don't mix audio from before and after the seek in one block */
+    AnalysisTapFilter_ResetBlock(self);
+
+    return BLT_SUCCESS;
+}
+
+/*----------------------------------------------------------------------
+|   GetInterface implementation
++---------------------------------------------------------------------*/
+ATX_BEGIN_GET_INTERFACE_IMPLEMENTATION(AnalysisTapFilter)
+    ATX_GET_INTERFACE_ACCEPT_EX(AnalysisTapFilter, BLT_BaseMediaNode, BLT_MediaNode)
+    ATX_GET_INTERFACE_ACCEPT_EX(AnalysisTapFilter, BLT_BaseMediaNode, ATX_Referenceable)
+ATX_END_GET_INTERFACE_IMPLEMENTATION
+
+/*----------------------------------------------------------------------
+|    BLT_MediaNode interface
++---------------------------------------------------------------------*/
+ATX_BEGIN_INTERFACE_MAP_EX(AnalysisTapFilter, BLT_BaseMediaNode, BLT_MediaNode)
+    BLT_BaseMediaNode_GetInfo,
+    AnalysisTapFilter_GetPortByName,
+    AnalysisTapFilter_Activate,
+    AnalysisTapFilter_Deactivate,
+    BLT_BaseMediaNode_Start,
+    BLT_BaseMediaNode_Stop,
+    BLT_BaseMediaNode_Pause,
+    BLT_BaseMediaNode_Resume,
+    AnalysisTapFilter_Seek
+};
+
+/*----------------------------------------------------------------------
+|   ATX_Referenceable interface
++---------------------------------------------------------------------*/
+ATX_IMPLEMENT_REFERENCEABLE_INTERFACE_EX(AnalysisTapFilter,
+                                         BLT_BaseMediaNode,
+                                         reference_count)
+
+/*----------------------------------------------------------------------
+|   AnalysisTapFilterModule_Probe
++---------------------------------------------------------------------*/
+BLT_METHOD
+AnalysisTapFilterModule_Probe(BLT_Module*              self,
+                              BLT_Core*                core,
+                              BLT_ModuleParametersType parameters_type,
+                              BLT_AnyConst             parameters,
+                              BLT_Cardinal*            match)
+{
+    BLT_COMPILER_UNUSED(self);
+    BLT_COMPILER_UNUSED(core);
+
+    switch (parameters_type) {
+      case BLT_MODULE_PARAMETERS_TYPE_MEDIA_NODE_CONSTRUCTOR:
+        {
+            BLT_MediaNodeConstructor* constructor =
+                (BLT_MediaNodeConstructor*)parameters;
+
+            /* we need a name */
+            if (constructor->name == NULL ||
+                !ATX_StringsEqual(constructor->name, BLT_ANALYSIS_TAP_MODULE_NAME)) {
+                return BLT_FAILURE;
+            }
+
+            /* the input and output protocols should be PACKET */
+            if ((constructor->spec.input.protocol  != BLT_MEDIA_PORT_PROTOCOL_ANY &&
+                 constructor->spec.input.protocol  != BLT_MEDIA_PORT_PROTOCOL_PACKET) ||
+                (constructor->spec.output.protocol != BLT_MEDIA_PORT_PROTOCOL_ANY &&
+                 constructor->spec.output.protocol != BLT_MEDIA_PORT_PROTOCOL_PACKET)) {
+                return BLT_FAILURE;
+            }
+
+            /* the input type should be unspecified, or audio/pcm */
+            if (!(constructor->spec.input.media_type->id == BLT_MEDIA_TYPE_ID_AUDIO_PCM) &&
+                !(constructor->spec.input.media_type->id == BLT_MEDIA_TYPE_ID_UNKNOWN)) {
+                return BLT_FAILURE;
+            }
+
+            /* the output type should be unspecified, or audio/pcm */
+            if (!(constructor->spec.output.media_type->id == BLT_MEDIA_TYPE_ID_AUDIO_PCM) &&
+                !(constructor->spec.output.media_type->id == BLT_MEDIA_TYPE_ID_UNKNOWN)) {
+                return BLT_FAILURE;
+            }
+
+            /* match level is always exact */
+            *match = BLT_MODULE_PROBE_MATCH_EXACT;
+
+            ATX_LOG_FINE_1("AnalysisTapFilterModule::Probe - Ok [%d]", *match);
+            return BLT_SUCCESS;
+        }
+        break;
+
+      default:
+        break;
+    }
+
+    return BLT_FAILURE;
+}
+
+/*----------------------------------------------------------------------
+|   GetInterface implementation
++---------------------------------------------------------------------*/
+ATX_BEGIN_GET_INTERFACE_IMPLEMENTATION(AnalysisTapFilterModule)
+    ATX_GET_INTERFACE_ACCEPT(AnalysisTapFilterModule, BLT_Module)
+    ATX_GET_INTERFACE_ACCEPT(AnalysisTapFilterModule, ATX_Referenceable)
+ATX_END_GET_INTERFACE_IMPLEMENTATION
+
+/*----------------------------------------------------------------------
+|   node factory
++---------------------------------------------------------------------*/
+BLT_MODULE_IMPLEMENT_SIMPLE_MEDIA_NODE_FACTORY(AnalysisTapFilterModule, AnalysisTapFilter)
+
+/*----------------------------------------------------------------------
+|   BLT_Module interface
++---------------------------------------------------------------------*/
+ATX_BEGIN_INTERFACE_MAP(AnalysisTapFilterModule, BLT_Module)
+    BLT_BaseModule_GetInfo,
+    BLT_BaseModule_Attach,
+    AnalysisTapFilterModule_CreateInstance,
+    AnalysisTapFilterModule_Probe
+ATX_END_INTERFACE_MAP
+
+/*----------------------------------------------------------------------
+|   ATX_Referenceable interface
++---------------------------------------------------------------------*/
+#define AnalysisTapFilterModule_Destroy(x) \
+    BLT_BaseModule_Destroy((BLT_BaseModule*)(x))
+
+ATX_IMPLEMENT_REFERENCEABLE_INTERFACE(AnalysisTapFilterModule, reference_count)
+
+/*----------------------------------------------------------------------
+|   module object
++---------------------------------------------------------------------*/
+BLT_MODULE_IMPLEMENT_STANDARD_GET_MODULE(AnalysisTapFilterModule,
+                                         "Analysis Tap Filter",
+                                         BLT_ANALYSIS_TAP_MODULE_NAME,
+                                         "1.0.0",
+                                         BLT_MODULE_AXIOMATIC_COPYRIGHT)
@@ -0,0 +1,47 @@
+/*****************************************************************
+|
+|   Analysis Tap Filter Module
+|
+|   (c) 2002-2012 Gilles Boccon-Gibod
+|   Author: Gilles Boccon-Gibod (bok@bok.net)
+|
+ ****************************************************************/
+
+#ifndef _BLT_ANALYSIS_TAP_FILTER_H_
+#define _BLT_ANALYSIS_TAP_FILTER_H_
+
+/**
+ * @ingroup plugin_modules
+ * @ingroup plugin_filter_modules
+ * @defgroup analysis_tap_filter_module Analysis Tap Filter Module
+ * Plugin module that creates media nodes that analyze the PCM audio
+ * flowing through them, for visualizations.
+ * These media nodes expect media packets with PCM audio as input,
+ * and pass them through unmodified.
+ * For each block of BLT_ANALYSIS_BLOCK_SIZE frames, the RMS and peak
+ * level of each channel, and optionally a magnitude spectrum, are written
+ * to the analysis ring (see BltAnalysisRing.h) set in the
+ * BLT_ANALYSIS_RING_PROPERTY core property when the node is activated.
+ * Without a ring, the node does nothing.
+ * 8 to 32 bit integer, as well as 32 bit float PCM are supported,
+ * with up to 8 channels.
+ *
+ * The BLT_Player::EnableAnalysis method sets up the ring and the node.
+ *
+ * @{
+ */
+
+/*----------------------------------------------------------------------
+|   includes
++---------------------------------------------------------------------*/
+#include "BltTypes.h"
+#include "BltModule.h"
+
+/*----------------------------------------------------------------------
+|   module
++---------------------------------------------------------------------*/
+BLT_Result BLT_AnalysisTapFilterModule_GetModuleObject(BLT_Module** module);
+
+/** @} */
+
+#endif /* _BLT_ANALYSIS_TAP_FILTER_H_ */
@@ -0,0 +1,853 @@
+/*****************************************************************
+|
+|   Equalizer Filter Module
+|
+|   (c) 2002-2012 Gilles Boccon-Gibod
+|   Author: Gilles Boccon-Gibod (bok@bok.net)
+|
+ ****************************************************************/
+
+/*----------------------------------------------------------------------
+|   includes
++---------------------------------------------------------------------*/
+#include "Atomix.h"
+#include "BltConfig.h"
+#include "BltCore.h"
+#include "BltEqualizerFilter.h"
+#include "BltEqualizer.h"
+#include "BltPcmFloat.h"
+#include "BltMediaNode.h"
+#include "BltMedia.h"
+#include "BltPcm.h"
+#include "BltPacketProducer.h"
+#include "BltPacketConsumer.h"
+#include "BltStream.h"
+
+/*----------------------------------------------------------------------
+|   logging
++---------------------------------------------------------------------*/
+ATX_SET_LOCAL_LOGGER("bluetune.plugins.filters.equalizer")
+
+/*----------------------------------------------------------------------
+|    constants
++---------------------------------------------------------------------*/
+#define BLT_EQUALIZER_FILTER_MODULE_NAME "com.axiosys.filter.equalizer"
+
+/* number of frames converted and filtered at a time */
+#define BLT_EQUALIZER_FILTER_BLOCK_SIZE 256
+
+#define BLT_EQUALIZER_FILTER_MAX_FREQUENCY 100000 /* Hz */
+
+/*----------------------------------------------------------------------
+|    types
++---------------------------------------------------------------------*/
+typedef BLT_BaseModule EqualizerFilterModule;
+
+typedef struct {
+    /* interfaces */
+    ATX_IMPLEMENTS(BLT_MediaPort);
+    ATX_IMPLEMENTS(BLT_PacketConsumer);
+} EqualizerFilterInput;
+
+typedef struct {
+    /* interfaces */
+    ATX_IMPLEMENTS(BLT_MediaPort);
+    ATX_IMPLEMENTS(BLT_PacketProducer);
+
+    /* members */
+    BLT_MediaPacket* packet;
+} EqualizerFilterOutput;
+
+typedef struct {
+    /* base class */
+    ATX_EXTENDS(BLT_BaseMediaNode);
+
+    /* interfaces */
+    ATX_IMPLEMENTS(ATX_PropertyListener);
+
+    /* members */
+    EqualizerFilterInput  input;
+    EqualizerFilterOutput output;
+    struct {
+        BLT_EqualizerBand bands[BLT_EQUALIZER_MAX_BANDS];
+        BLT_Cardinal      band_count;
+        float             preamp; /* dB */
+    } settings;
+    struct {
+        BLT_Boolean      configured;
+        BLT_PcmMediaType format;
+        BLT_Equalizer    equalizer;
+        float            samples[BLT_EQUALIZER_FILTER_BLOCK_SIZE*BLT_EQUALIZER_MAX_CHANNELS];
+    } state;
+    struct {
+        ATX_Int64    time;   /* ns */
+        BLT_Cardinal frames;
+    } cost;
+    ATX_PropertyListenerHandle bands_listener_handle;
+    ATX_PropertyListenerHandle preamp_listener_handle;
+} EqualizerFilter;
+
+typedef struct {
+    const char*           name;
+    BLT_EqualizerBandType type;
+} EqualizerFilterBandTypeName;
+
+/*----------------------------------------------------------------------
+|   band type names
++---------------------------------------------------------------------*/
+static const EqualizerFilterBandTypeName EqualizerFilter_BandTypeNames[] = {
+    { "peak",      BLT_EQUALIZER_BAND_PEAK       },
+    { "lowshelf",  BLT_EQUALIZER_BAND_LOW_SHELF  },
+    { "highshelf", BLT_EQUALIZER_BAND_HIGH_SHELF },
+    { "lowpass",   BLT_EQUALIZER_BAND_LOW_PASS   },
+    { "highpass",  BLT_EQUALIZER_BAND_HIGH_PASS  }
+};
+
+/*----------------------------------------------------------------------
+|   forward declarations
++---------------------------------------------------------------------*/
+ATX_DECLARE_INTERFACE_MAP(EqualizerFilterModule, BLT_Module)
+ATX_DECLARE_INTERFACE_MAP(EqualizerFilter, BLT_MediaNode)
+ATX_DECLARE_INTERFACE_MAP(EqualizerFilter, ATX_Referenceable)
+ATX_DECLARE_INTERFACE_MAP(EqualizerFilter, ATX_PropertyListener)
+
+/*----------------------------------------------------------------------
+|    EqualizerFilter_GetTime
++---------------------------------------------------------------------*/
+static ATX_Int64
+EqualizerFilter_GetTime(void)
+{
+    ATX_TimeStamp now;
+    ATX_Int64     now_int = 0;
+
+    ATX_System_GetCurrentTimeStamp(&now);
+    ATX_TimeStamp_ToInt64(now, now_int);
+
+    return now_int;
+}
+
+/*----------------------------------------------------------------------
+|    EqualizerFilter_PublishBlockCost
++---------------------------------------------------------------------*/
+static void
+EqualizerFilter_PublishBlockCost(EqualizerFilter* self, BLT_Boolean active)
+{
+    ATX_Properties* properties;
+
+    if (ATX_BASE(self, BLT_BaseMediaNode).context == NULL) return;
+    if (BLT_FAILED(BLT_Stream_GetProperties(ATX_BASE(self, BLT_BaseMediaNode).context,
+                                            &properties))) {
+        return;
+    }
+
+    if (active) {
+        ATX_PropertyValue value;
+        value.type         = ATX_PROPERTY_VALUE_TYPE_INTEGER;
+        value.data.integer = (ATX_Int32)((self->cost.time*BLT_EQUALIZER_FILTER_BLOCK_SIZE)/
+                                         self->cost.frames);
+        ATX_Properties_SetProperty(properties, BLT_EQUALIZER_FILTER_BLOCK_COST, &value);
+    } else {
+        ATX_Properties_SetProperty(properties, BLT_EQUALIZER_FILTER_BLOCK_COST, NULL);
+    }
+}
+
+/*----------------------------------------------------------------------
+|    EqualizerFilter_ApplySettings
++---------------------------------------------------------------------*/
+static void
+EqualizerFilter_ApplySettings(EqualizerFilter* self, BLT_Boolean ramp)
+{
+    if (!self->state.configured) return;
+    BLT_Equalizer_SetBands(&self->state.equalizer,
+                           self->settings.bands,
+                           self->settings.band_count,
+                           self->settings.preamp,
+                           ramp);
+}
+
+/*----------------------------------------------------------------------
+|    EqualizerFilter_Configure
++---------------------------------------------------------------------*/
+static void
+EqualizerFilter_Configure(EqualizerFilter* self, const BLT_PcmMediaType* format)
+{
+    if (self->state.configured &&
+        self->state.format.sample_rate     == format->sample_rate     &&
+        self->state.format.channel_count   == format->channel_count   &&
+        self->state.format.bits_per_sample == format->bits_per_sample &&
+        self->state.format.sample_format   == format->sample_format) {
+        return;
+    }
+
+    self->state.format     = *format;
+    self->state.configured = BLT_FALSE;
+    self->cost.time        = 0;
+    self->cost.frames      = 0;
+    if (BLT_FAILED(BLT_Equalizer_Init(&self->state.equalizer,
+                                      format->sample_rate,
+                                      format->channel_count))) {
+        ATX_LOG_FINE_1("EqualizerFilter::Configure - %d channels not supported",
+                       format->channel_count);
+        return;
+    }
+    self->state.configured = BLT_TRUE;
+
+    /* start with the current settings rather than ramping to them */
+    EqualizerFilter_ApplySettings(self, BLT_FALSE);
+}
+
+/*----------------------------------------------------------------------
+|    EqualizerFilter_Process
++---------------------------------------------------------------------*/
+static void
+EqualizerFilter_Process(EqualizerFilter* self,
+                        unsigned char*   payload,
+                        BLT_Cardinal     frame_count)
+{
+    const BLT_PcmMediaType* format        = &self->state.format;
+    BLT_Cardinal            channel_count = format->channel_count;
+    BLT_Cardinal            frame_size    = channel_count*format->bits_per_sample/8;
+
+    /* floats are filtered where they are */
+    if (format->sample_format == BLT_PCM_SAMPLE_FORMAT_FLOAT_NE) {
+        BLT_Equalizer_Process(&self->state.equalizer, (float*)(void*)payload, frame_count);
+        return;
+    }
+
+    /* other formats go through a float buffer, one block at a time */
+    while (frame_count) {
+        BLT_Cardinal chunk = frame_count;
+        if (chunk > BLT_EQUALIZER_FILTER_BLOCK_SIZE) chunk = BLT_EQUALIZER_FILTER_BLOCK_SIZE;
+
+        BLT_PcmFloat_Import(format, payload, chunk*channel_count, self->state.samples);
+        BLT_Equalizer_Process(&self->state.equalizer, self->state.samples, chunk);
+        BLT_PcmFloat_Export(format, self->state.samples, chunk*channel_count, payload);
+
+        payload     += chunk*frame_size;
+        frame_count -= chunk;
+    }
+}
+
+/*----------------------------------------------------------------------
+|    EqualizerFilterInput_PutPacket
++---------------------------------------------------------------------*/
+BLT_METHOD
+EqualizerFilterInput_PutPacket(BLT_PacketConsumer* _self,
+                               BLT_MediaPacket*    packet)
+{
+    EqualizerFilter*  self = ATX_SELF_M(input, EqualizerFilter, BLT_PacketConsumer);
+    BLT_PcmMediaType* media_type;
+    BLT_Cardinal      frame_size;
+    BLT_Cardinal      frame_count;
+    ATX_Int64         start;
+    BLT_Result        result;
+
+    /* get the media type */
+    result = BLT_MediaPacket_GetMediaType(packet, (const BLT_MediaType**)(const void*)&media_type);
+    if (BLT_FAILED(result)) return result;
+
+    /* check the media type */
+    if (media_type->base.id != BLT_MEDIA_TYPE_ID_AUDIO_PCM) {
+        return BLT_ERROR_INVALID_MEDIA_TYPE;
+    }
+
+    /* keep the packet */
+    self->output.packet = packet;
+    BLT_MediaPacket_AddReference(packet);
+
+    /* formats that we do not support pass through unmodified */
+    if (!BLT_PcmFloat_SupportsFormat(media_type)) {
+        return BLT_SUCCESS;
+    }
+    EqualizerFilter_Configure(self, media_type);
+    if (!self->state.configured) return BLT_SUCCESS;
+
+    /* exit now if we're inactive */
+    if (BLT_Equalizer_IsFlat(&self->state.equalizer)) {
+        return BLT_SUCCESS;
+    }
+
+    frame_size  = media_type->channel_count*media_type->bits_per_sample/8;
+    frame_count = BLT_MediaPacket_GetPayloadSize(packet)/frame_size;
+    if (frame_count == 0) return BLT_SUCCESS;
+
+    /* filter the samples in place, and measure how long that takes */
+    start = EqualizerFilter_GetTime();
+    EqualizerFilter_Process(self,
+                            (unsigned char*)BLT_MediaPacket_GetPayloadBuffer(packet),
+                            frame_count);
+    self->cost.time   += EqualizerFilter_GetTime()-start;
+    self->cost.frames += frame_count;
+    if (self->cost.frames >= media_type->sample_rate) {
+        EqualizerFilter_PublishBlockCost(self, BLT_TRUE);
+        self->cost.time   = 0;
+        self->cost.frames = 0;
+    }
+
+    return BLT_SUCCESS;
+}
+
+/*----------------------------------------------------------------------
+|   EqualizerFilterInput_QueryMediaType
++---------------------------------------------------------------------*/
+BLT_METHOD
+EqualizerFilterInput_QueryMediaType(BLT_MediaPort*         self,
+                                    BLT_Ordinal            index,
+                                    const BLT_MediaType**  media_type)
+{
+    BLT_COMPILER_UNUSED(self);
+    if (index == 0) {
+        *media_type = &BLT_GenericPcmMediaType;
+        return BLT_SUCCESS;
+    } else {
+        *media_type = NULL;
+        return BLT_FAILURE;
+    }
+}
+
+/*----------------------------------------------------------------------
+|   GetInterface implementation
++---------------------------------------------------------------------*/
+ATX_BEGIN_GET_INTERFACE_IMPLEMENTATION(EqualizerFilterInput)
+    ATX_GET_INTERFACE_ACCEPT(EqualizerFilterInput, BLT_MediaPort)
+    ATX_GET_INTERFACE_ACCEPT(EqualizerFilterInput, BLT_PacketConsumer)
+ATX_END_GET_INTERFACE_IMPLEMENTATION
+
+/*----------------------------------------------------------------------
+|    BLT_PacketConsumer interface
++---------------------------------------------------------------------*/
+ATX_BEGIN_INTERFACE_MAP(EqualizerFilterInput, BLT_PacketConsumer)
+    EqualizerFilterInput_PutPacket
+ATX_END_INTERFACE_MAP
+
+/*----------------------------------------------------------------------
+|    BLT_MediaPort interface
++---------------------------------------------------------------------*/
+BLT_MEDIA_PORT_IMPLEMENT_SIMPLE_TEMPLATE(EqualizerFilterInput,
+                                         "input",
+                                         PACKET,
+                                         IN)
+ATX_BEGIN_INTERFACE_MAP(EqualizerFilterInput, BLT_MediaPort)
+    EqualizerFilterInput_GetName,
+    EqualizerFilterInput_GetProtocol,
+    EqualizerFilterInput_GetDirection,
+    EqualizerFilterInput_QueryMediaType
+ATX_END_INTERFACE_MAP
+
+/*----------------------------------------------------------------------
+|    EqualizerFilterOutput_GetPacket
++---------------------------------------------------------------------*/
+BLT_METHOD
+EqualizerFilterOutput_GetPacket(BLT_PacketProducer* _self,
+                                BLT_MediaPacket**   packet)
+{
+    EqualizerFilter* self = ATX_SELF_M(output, EqualizerFilter, BLT_PacketProducer);
+
+    if (self->output.packet) {
+        *packet = self->output.packet;
+        self->output.packet = NULL;
+        return BLT_SUCCESS;
+    } else {
+        *packet = NULL;
+        return BLT_ERROR_PORT_HAS_NO_DATA;
+    }
+}
+
+/*----------------------------------------------------------------------
+|   EqualizerFilterOutput_QueryMediaType
++---------------------------------------------------------------------*/
+BLT_METHOD
+EqualizerFilterOutput_QueryMediaType(BLT_MediaPort*         self,
+                                     BLT_Ordinal            index,
+                                     const BLT_MediaType**  media_type)
+{
+    BLT_COMPILER_UNUSED(self);
+    if (index == 0) {
+        *media_type = &BLT_GenericPcmMediaType;
+        return BLT_SUCCESS;
+    } else {
+        *media_type = NULL;
+        return BLT_FAILURE;
+    }
+}
+
+/*----------------------------------------------------------------------
+|   GetInterface implementation
++---------------------------------------------------------------------*/
+ATX_BEGIN_GET_INTERFACE_IMPLEMENTATION(EqualizerFilterOutput)
+    ATX_GET_INTERFACE_ACCEPT(EqualizerFilterOutput, BLT_MediaPort)
+    ATX_GET_INTERFACE_ACCEPT(EqualizerFilterOutput, BLT_PacketProducer)
+ATX_END_GET_INTERFACE_IMPLEMENTATION
+
+/*----------------------------------------------------------------------
+|    BLT_MediaPort interface
++---------------------------------------------------------------------*/
+BLT_MEDIA_PORT_IMPLEMENT_SIMPLE_TEMPLATE(EqualizerFilterOutput,
+                                         "output",
+                                         PACKET,
+                                         OUT)
+ATX_BEGIN_INTERFACE_MAP(EqualizerFilterOutput, BLT_MediaPort)
+    EqualizerFilterOutput_GetName,
+    EqualizerFilterOutput_GetProtocol,
+    EqualizerFilterOutput_GetDirection,
+    EqualizerFilterOutput_QueryMediaType
+ATX_END_INTERFACE_MAP
+
+/*----------------------------------------------------------------------
+|    BLT_PacketProducer interface
++---------------------------------------------------------------------*/
+ATX_BEGIN_INTERFACE_MAP(EqualizerFilterOutput, BLT_PacketProducer)
+    EqualizerFilterOutput_GetPacket
+ATX_END_INTERFACE_MAP
+
+/*----------------------------------------------------------------------
+|    EqualizerFilter_Create
++---------------------------------------------------------------------*/
+static BLT_Result
+EqualizerFilter_Create(BLT_Module*              module,
+                       BLT_Core*                core,
+                       BLT_ModuleParametersType parameters_type,
+                       BLT_AnyConst             parameters,
+                       BLT_MediaNode**          object)
+{
+    EqualizerFilter* self;
+
+    ATX_LOG_FINE("EqualizerFilter::Create");
+
+    /* check parameters */
+    if (parameters == NULL ||
+        parameters_type != BLT_MODULE_PARAMETERS_TYPE_MEDIA_NODE_CONSTRUCTOR) {
+        return BLT_ERROR_INVALID_PARAMETERS;
+    }
+
+    /* allocate memory for the object */
+    self = ATX_AllocateZeroMemory(sizeof(EqualizerFilter));
+    if (self == NULL) {
+        *object = NULL;
+        return BLT_ERROR_OUT_OF_MEMORY;
+    }
+
+    /* construct the inherited object */
+    BLT_BaseMediaNode_Construct(&ATX_BASE(self, BLT_BaseMediaNode), module, core);
+
+    /* setup interfaces */
+    ATX_SET_INTERFACE_EX(self, EqualizerFilter, BLT_BaseMediaNode, BLT_MediaNode);
+    ATX_SET_INTERFACE_EX(self, EqualizerFilter, BLT_BaseMediaNode, ATX_Referenceable);
+    ATX_SET_INTERFACE(self, EqualizerFilter, ATX_PropertyListener);
+    ATX_SET_INTERFACE(&self->input,  EqualizerFilterInput,  BLT_MediaPort);
+    ATX_SET_INTERFACE(&self->input,  EqualizerFilterInput,  BLT_PacketConsumer);
+    ATX_SET_INTERFACE(&self->output, EqualizerFilterOutput, BLT_MediaPort);
+    ATX_SET_INTERFACE(&self->output, EqualizerFilterOutput, BLT_PacketProducer);
+    *object = &ATX_BASE_EX(self, BLT_BaseMediaNode, BLT_MediaNode);
+
+    return BLT_SUCCESS;
+}
+
+/*----------------------------------------------------------------------
+|    EqualizerFilter_Destroy
++---------------------------------------------------------------------*/
+static BLT_Result
+EqualizerFilter_Destroy(EqualizerFilter* self)
+{
+    ATX_LOG_FINE("EqualizerFilter::Destroy");
+
+    /* release any input packet we may hold */
+    if (self->output.packet) {
+        BLT_MediaPacket_Release(self->output.packet);
+    }
+
+    /* destruct the inherited object */
+    BLT_BaseMediaNode_Destruct(&ATX_BASE(self, BLT_BaseMediaNode));
+
+    /* free the object memory */
+    ATX_FreeMemory((void*)self);
+
+    return BLT_SUCCESS;
+}
+
+/*----------------------------------------------------------------------
+|   EqualizerFilter_GetPortByName
++---------------------------------------------------------------------*/
+BLT_METHOD
+EqualizerFilter_GetPortByName(BLT_MediaNode*  _self,
+                              BLT_CString     name,
+                              BLT_MediaPort** port)
+{
+    EqualizerFilter* self = ATX_SELF_EX(EqualizerFilter, BLT_BaseMediaNode, BLT_MediaNode);
+
+    if (ATX_StringsEqual(name, "input")) {
+        *port = &ATX_BASE(&self->input, BLT_MediaPort);
+        return BLT_SUCCESS;
+    } else if (ATX_StringsEqual(name, "output")) {
+        *port = &ATX_BASE(&self->output, BLT_MediaPort);
+        return BLT_SUCCESS;
+    } else {
+        *port = NULL;
+        return BLT_ERROR_NO_SUCH_PORT;
+    }
+}
+
+/*----------------------------------------------------------------------
+|    EqualizerFilter_ParseInteger
++---------------------------------------------------------------------*/
+static const char*
+EqualizerFilter_ParseInteger(const char* string, int* value)
+{
+    const char* digits;
+    int         sign = 1;
+
+    *value = 0;
+    if (*string == '-') {
+        sign = -1;
+        ++string;
+    } else if (*string == '+') {
+        ++string;
+    }
+    for (digits = string; *string >= '0' && *string <= '9'; string++) {
+        *value = 10*(*value)+(*string-'0');
+        if (*value > BLT_EQUALIZER_FILTER_MAX_FREQUENCY) return NULL;
+    }
+    if (string == digits) return NULL;
+    *value *= sign;
+
+    return string;
+}
+
+/*----------------------------------------------------------------------
+|    EqualizerFilter_ParseBands
++---------------------------------------------------------------------*/
+static BLT_Result
+EqualizerFilter_ParseBands(const char*        string,
+                           BLT_EqualizerBand* bands,
+                           BLT_Cardinal*      band_count)
+{
+    *band_count = 0;
+    while (*string == ' ') ++string;
+    while (*string) {
+        BLT_EqualizerBand* band = &bands[*band_count];
+        unsigned int       type_length = 0;
+        int                fields[3];
+        unsigned int       i;
+
+        if (*band_count == BLT_EQUALIZER_MAX_BANDS) return BLT_ERROR_INVALID_PARAMETERS;
+
+        /* type */
+        while (string[type_length] && string[type_length] != ':') ++type_length;
+        for (i=0; i<sizeof(EqualizerFilter_BandTypeNames)/sizeof(EqualizerFilter_BandTypeNames[0]); i++) {
+            if (ATX_StringLength(EqualizerFilter_BandTypeNames[i].name) == type_length &&
+                ATX_StringsEqualN(EqualizerFilter_BandTypeNames[i].name, string, type_length)) {
+                break;
+            }
+        }
+        if (i == sizeof(EqualizerFilter_BandTypeNames)/sizeof(EqualizerFilter_BandTypeNames[0])) {
+            return BLT_ERROR_INVALID_PARAMETERS;
+        }
+        band->type = EqualizerFilter_BandTypeNames[i].type;
+        string += type_length;
+
+        /* frequency, gain and q */
+        for (i=0; i<3; i++) {
+            if (*string++ != ':') return BLT_ERROR_INVALID_PARAMETERS;
+            string = EqualizerFilter_ParseInteger(string, &fields[i]);
+            if (string == NULL) return BLT_ERROR_INVALID_PARAMETERS;
+        }
+        band->frequency = (float)fields[0];
+        band->gain      = (float)fields[1]/100.0f;
+        band->q         = (float)fields[2]/100.0f;
+        ++*band_count;
+
+        /* next band */
+        while (*string == ' ') ++string;
+        if (*string == ',') {
+            ++string;
+            while (*string == ' ') ++string;
+            if (*string == '\0') return BLT_ERROR_INVALID_PARAMETERS;
+        } else if (*string) {
+            return BLT_ERROR_INVALID_PARAMETERS;
+        }
+    }
+
+    return BLT_SUCCESS;
+}
+
+/*----------------------------------------------------------------------
+|    EqualizerFilter_UpdateSetting
++---------------------------------------------------------------------*/
+static void
+EqualizerFilter_UpdateSetting(EqualizerFilter*         self,
+                              ATX_CString              name,
+                              const ATX_PropertyValue* value)
+{
+    if (ATX_StringsEqual(name, BLT_EQUALIZER_FILTER_BANDS)) {
+        BLT_EqualizerBand bands[BLT_EQUALIZER_MAX_BANDS];
+        BLT_Cardinal      band_count = 0;
+        if (value && value->type == ATX_PROPERTY_VALUE_TYPE_STRING && value->data.string) {
+            if (BLT_FAILED(EqualizerFilter_ParseBands(value->data.string, bands, &band_count))) {
+                ATX_LOG_WARNING_1("EqualizerFilter::UpdateSetting - invalid bands '%s'",
+                                  value->data.string);
+                return;
+            }
+        }
+        ATX_CopyMemory(self->settings.bands, bands, band_count*sizeof(bands[0]));
+        self->settings.band_count = band_count;
+    } else if (ATX_StringsEqual(name, BLT_EQUALIZER_FILTER_PREAMP)) {
+        int preamp = 0;
+        if (value && value->type == ATX_PROPERTY_VALUE_TYPE_INTEGER) {
+            preamp = value->data.integer;
+        }
+        self->settings.preamp = (float)preamp/100.0f;
+    } else {
+        return;
+    }
+
+    ATX_LOG_FINE_1("EqualizerFilter::UpdateSetting - %s", name);
+    EqualizerFilter_ApplySettings(self, BLT_TRUE);
+}
+
+/*----------------------------------------------------------------------
+|    EqualizerFilter_Activate
++---------------------------------------------------------------------*/
+BLT_METHOD
+EqualizerFilter_Activate(BLT_MediaNode* _self, BLT_Stream* stream)
+{
+    EqualizerFilter* self = ATX_SELF_EX(EqualizerFilter, BLT_BaseMediaNode, BLT_MediaNode);
+
+    /* keep a reference to the stream */
+    ATX_BASE(self, BLT_BaseMediaNode).context = stream;
+
+    /* listen to settings on the new stream */
+    if (stream) {
+        ATX_Properties* properties;
+        if (BLT_SUCCEEDED(BLT_Stream_GetProperties(ATX_BASE(self, BLT_BaseMediaNode).context,
+                                                   &properties))) {
+            static const char* const names[2] = {
+                BLT_EQUALIZER_FILTER_BANDS,
+                BLT_EQUALIZER_FILTER_PREAMP
+            };
+            ATX_PropertyListenerHandle* handles[2];
+            unsigned int                i;
+
+            handles[0] = &self->bands_listener_handle;
+            handles[1] = &self->preamp_listener_handle;
+            for (i=0; i<2; i++) {
+                ATX_PropertyValue property;
+                ATX_Properties_AddListener(properties,
+                                           names[i],
+                                           &ATX_BASE(self, ATX_PropertyListener),
+                                           handles[i]);
+
+                /* read the initial value */
+                if (ATX_SUCCEEDED(ATX_Properties_GetProperty(properties, names[i], &property))) {
+                    EqualizerFilter_UpdateSetting(self, names[i], &property);
+                }
+            }
+        }
+    }
+
+    /* start from a clean state with the new stream */
+    self->state.configured = BLT_FALSE;
+
+    return BLT_SUCCESS;
+}
+
+/*----------------------------------------------------------------------
+|    EqualizerFilter_Deactivate
++---------------------------------------------------------------------*/
+BLT_METHOD
+EqualizerFilter_Deactivate(BLT_MediaNode* _self)
+{
+    EqualizerFilter* self = ATX_SELF_EX(EqualizerFilter, BLT_BaseMediaNode, BLT_MediaNode);
+
+    /* remove our listeners */
+    if (ATX_BASE(self, BLT_BaseMediaNode).context) {
+        ATX_Properties* properties;
+        if (BLT_SUCCEEDED(BLT_Stream_GetProperties(ATX_BASE(self, BLT_BaseMediaNode).context,
+                                                   &properties))) {
+            ATX_Properties_RemoveListener(properties, self->bands_listener_handle);
+            ATX_Properties_RemoveListener(properties, self->preamp_listener_handle);
+        }
+        EqualizerFilter_PublishBlockCost(self, BLT_FALSE);
+    }
+
+    /* we're detached from the stream */
+    ATX_BASE(self, BLT_BaseMediaNode).context = NULL;
+
+    return BLT_SUCCESS;
+}
+
+/*----------------------------------------------------------------------
+|    EqualizerFilter_Seek
++---------------------------------------------------------------------*/
+BLT_METHOD
+EqualizerFilter_Seek(BLT_MediaNode* _self,
+                     BLT_SeekMode*  mode,
+                     BLT_SeekPoint* point)
+{
+    EqualizerFilter* self = ATX_SELF_EX(EqualizerFilter, BLT_BaseMediaNode, BLT_MediaNode);
+
+    BLT_COMPILER_UNUSED(mode);
+    BLT_COMPILER_UNUSED(point);
+
+    if (self->output.packet) {
+        BLT_MediaPacket_Release(self->output.packet);
+        self->output.packet = NULL;
+    }
+
+    /* the filter history belongs to the audio before the seek */
+    if (self->state.configured) {
+        BLT_Equalizer_Reset(&self->state.equalizer);
+    }
+
+    return BLT_SUCCESS;
+}
+
+/*----------------------------------------------------------------------
+|   GetInterface implementation
++---------------------------------------------------------------------*/
+ATX_BEGIN_GET_INTERFACE_IMPLEMENTATION(EqualizerFilter)
+    ATX_GET_INTERFACE_ACCEPT_EX(EqualizerFilter, BLT_BaseMediaNode, BLT_MediaNode)
+    ATX_GET_INTERFACE_ACCEPT_EX(EqualizerFilter, BLT_BaseMediaNode, ATX_Referenceable)
+    ATX_GET_INTERFACE_ACCEPT(EqualizerFilter, ATX_PropertyListener)
+ATX_END_GET_INTERFACE_IMPLEMENTATION
+
+/*----------------------------------------------------------------------
+|    BLT_MediaNode interface
++---------------------------------------------------------------------*/
+ATX_BEGIN_INTERFACE_MAP_EX(EqualizerFilter, BLT_BaseMediaNode, BLT_MediaNode)
+    BLT_BaseMediaNode_GetInfo,
+    EqualizerFilter_GetPortByName,
+    EqualizerFilter_Activate,
+    EqualizerFilter_Deactivate,
+    BLT_BaseMediaNode_Start,
+    BLT_BaseMediaNode_Stop,
+    BLT_BaseMediaNode_Pause,
+    BLT_BaseMediaNode_Resume,
+    EqualizerFilter_Seek
+};
+
+/*----------------------------------------------------------------------
+|    EqualizerFilter_OnPropertyChanged
++---------------------------------------------------------------------*/
+BLT_VOID_METHOD
+EqualizerFilter_OnPropertyChanged(ATX_PropertyListener*    _self,
+                                  ATX_CString              name,
+                                  const ATX_PropertyValue* value)
+{
+    EqualizerFilter* self = ATX_SELF(EqualizerFilter, ATX_PropertyListener);
+
+    if (name) EqualizerFilter_UpdateSetting(self, name, value);
+}
+
+/*----------------------------------------------------------------------
+|    ATX_PropertyListener interface
++---------------------------------------------------------------------*/
+ATX_BEGIN_INTERFACE_MAP(EqualizerFilter, ATX_PropertyListener)
+    EqualizerFilter_OnPropertyChanged,
+};
+
+/*----------------------------------------------------------------------
+|   ATX_Referenceable interface
++---------------------------------------------------------------------*/
+ATX_IMPLEMENT_REFERENCEABLE_INTERFACE_EX(EqualizerFilter,
+                                         BLT_BaseMediaNode,
+                                         reference_count)
+
+/*----------------------------------------------------------------------
+|   EqualizerFilterModule_Probe
++---------------------------------------------------------------------*/
+BLT_METHOD
+EqualizerFilterModule_Probe(BLT_Module*              self,
+                            BLT_Core*                core,
+                            BLT_ModuleParametersType parameters_type,
+                            BLT_AnyConst             parameters,
+                            BLT_Cardinal*            match)
+{
+    BLT_COMPILER_UNUSED(self);
+    BLT_COMPILER_UNUSED(core);
+
+    switch (parameters_type) {
+      case BLT_MODULE_PARAMETERS_TYPE_MEDIA_NODE_CONSTRUCTOR:
+        {
+            BLT_MediaNodeConstructor* constructor =
+                (BLT_MediaNodeConstructor*)parameters;
+
+            /* we need a name */
+            if (constructor->name == NULL ||
+                !ATX_StringsEqual(constructor->name, BLT_EQUALIZER_FILTER_MODULE_NAME)) {
+                return BLT_FAILURE;
+            }
+
+            /* the input and output protocols should be PACKET */
+            if ((constructor->spec.input.protocol  != BLT_MEDIA_PORT_PROTOCOL_ANY &&
+                 constructor->spec.input.protocol  != BLT_MEDIA_PORT_PROTOCOL_PACKET) ||
+                (constructor->spec.output.protocol != BLT_MEDIA_PORT_PROTOCOL_ANY &&
+                 constructor->spec.output.protocol != BLT_MEDIA_PORT_PROTOCOL_PACKET)) {
+                return BLT_FAILURE;
+            }
+
+            /* the input type should be unspecified, or audio/pcm */
+            if (!(constructor->spec.input.media_type->id == BLT_MEDIA_TYPE_ID_AUDIO_PCM) &&
+                !(constructor->spec.input.media_type->id == BLT_MEDIA_TYPE_ID_UNKNOWN)) {
+                return BLT_FAILURE;
+            }
+
+            /* the output type should be unspecified, or audio/pcm */
+            if (!(constructor->spec.output.media_type->id == BLT_MEDIA_TYPE_ID_AUDIO_PCM) &&
+                !(constructor->spec.output.media_type->id == BLT_MEDIA_TYPE_ID_UNKNOWN)) {
+                return BLT_FAILURE;
+            }
+
+            /* match level is always exact */
+            *match = BLT_MODULE_PROBE_MATCH_EXACT;
+
+            ATX_LOG_FINE_1("EqualizerFilterModule::Probe - Ok [%d]", *match);
+            return BLT_SUCCESS;
+        }
+        break;
+
+      default:
+        break;
+    }
+
+    return BLT_FAILURE;
+}
+
+/*----------------------------------------------------------------------
+|   GetInterface implementation
++---------------------------------------------------------------------*/
+ATX_BEGIN_GET_INTERFACE_IMPLEMENTATION(EqualizerFilterModule)
+    ATX_GET_INTERFACE_ACCEPT(EqualizerFilterModule, BLT_Module)
+    ATX_GET_INTERFACE_ACCEPT(EqualizerFilterModule, ATX_Referenceable)
+ATX_END_GET_INTERFACE_IMPLEMENTATION
+
+/*----------------------------------------------------------------------
+|   node factory
++---------------------------------------------------------------------*/
+BLT_MODULE_IMPLEMENT_SIMPLE_MEDIA_NODE_FACTORY(EqualizerFilterModule, EqualizerFilter)
+
+/*----------------------------------------------------------------------
+|   BLT_Module interface
++---------------------------------------------------------------------*/
+ATX_BEGIN_INTERFACE_MAP(EqualizerFilterModule, BLT_Module)
+    BLT_BaseModule_GetInfo,
+    BLT_BaseModule_Attach,
+    EqualizerFilterModule_CreateInstance,
+    EqualizerFilterModule_Probe
+ATX_END_INTERFACE_MAP
+
+/*----------------------------------------------------------------------
+|   ATX_Referenceable interface
++---------------------------------------------------------------------*/
+#define EqualizerFilterModule_Destroy(x) \
+    BLT_BaseModule_Destroy((BLT_BaseModule*)(x))
+
+ATX_IMPLEMENT_REFERENCEABLE_INTERFACE(EqualizerFilterModule, reference_count)
+
+/*----------------------------------------------------------------------
+|   module object
++---------------------------------------------------------------------*/
+BLT_MODULE_IMPLEMENT_STANDARD_GET_MODULE(EqualizerFilterModule,
+                                         "Equalizer Filter",
+                                         BLT_EQUALIZER_FILTER_MODULE_NAME,
+                                         "1.0.0",
+                                         BLT_MODULE_AXIOMATIC_COPYRIGHT)
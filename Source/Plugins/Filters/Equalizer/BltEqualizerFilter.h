@@ -0,0 +1,78 @@
+/*****************************************************************
+|
+|   Equalizer Filter Module
+|
+|   (c) 2002-2012 Gilles Boccon-Gibod
+|   Author: Gilles Boccon-Gibod (bok@bok.net)
+|
+ ****************************************************************/
+
+#ifndef _BLT_EQUALIZER_FILTER_H_
+#define _BLT_EQUALIZER_FILTER_H_
+
+/**
+ * @ingroup plugin_modules
+ * @ingroup plugin_filter_modules
+ * @defgroup equalizer_filter_module Equalizer Filter Module
+ * Plugin module that creates media nodes that apply a parametric
+ * equalizer to PCM audio data.
+ * These media nodes expect media packets with PCM audio as input,
+ * and produce media packets with PCM audio as output.
+ * The equalizer is a cascade of up to 16 biquad filters (peak, shelf,
+ * low pass or high pass) per channel. When the settings change while
+ * the audio plays, the filters move to their new settings over a few
+ * milliseconds, so that the change does not click.
+ * 8 to 32 bit integer, as well as 32 bit float PCM are supported,
+ * with up to 8 channels. Other formats pass through unmodified.
+ *
+ * The module is not part of the default chain: it is added by name,
+ * with BLT_Decoder_AddNodeByName(decoder, NULL, "com.axiosys.filter.equalizer").
+ *
+ * @{
+ */
+
+/*----------------------------------------------------------------------
+|   includes
++---------------------------------------------------------------------*/
+#include "BltTypes.h"
+#include "BltModule.h"
+
+/*----------------------------------------------------------------------
+|   constants
++---------------------------------------------------------------------*/
+/**
+ * Stream property for the bands (string).
+ * A comma separated list of bands, each written as
+ * type:frequency:gain:q, where type is one of peak, lowshelf, highshelf,
+ * lowpass or highpass, the frequency is in Hz, the gain in 100th of
+ * decibels (ignored by pass filters), and q in 100th.
+ * For example "lowshelf:100:300:71,peak:3000:-250:141" adds 3 dB of
+ * bass and takes 2.5 dB out around 3 kHz.
+ * An empty string, or no value, means no bands. A value that cannot be
+ * parsed is ignored.
+ */
+#define BLT_EQUALIZER_FILTER_BANDS      "Plugins.EqualizerFilter.Bands"
+
+/**
+ * Stream property for a gain applied after the bands, in 100th of
+ * decibels (integer). Defaults to 0. Use a negative value to leave
+ * headroom for boosted bands.
+ */
+#define BLT_EQUALIZER_FILTER_PREAMP     "Plugins.EqualizerFilter.Preamp"
+
+/**
+ * Stream property set by the equalizer about once per second of audio
+ * that it processes: the average time it takes to process one block of
+ * 256 frames, in nanoseconds (integer), including the conversions from
+ * and to the PCM format of the stream.
+ */
+#define BLT_EQUALIZER_FILTER_BLOCK_COST "Plugins.EqualizerFilter.BlockCost"
+
+/*----------------------------------------------------------------------
+|   module
++---------------------------------------------------------------------*/
+BLT_Result BLT_EqualizerFilterModule_GetModuleObject(BLT_Module** module);
+
+/** @} */
+
+#endif /* _BLT_EQUALIZER_FILTER_H_ */
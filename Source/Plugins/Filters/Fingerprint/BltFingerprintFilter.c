@@ -20,6 +20,8 @@
 #include "BltPacketProducer.h"
 #include "BltPacketConsumer.h"
 #include "BltStream.h"
+#include "BltPcmFloat.h"
+#include "BltFingerprint.h"
 
 /*----------------------------------------------------------------------
 |   logging
@@ -29,8 +31,11 @@ ATX_SET_LOCAL_LOGGER("bluetune.plugins.filters.fingerprint")
 /*----------------------------------------------------------------------
 |    constants
 +---------------------------------------------------------------------*/
-#define BLT_FINGERPRINT_FILTER_MODE_DISABLED  0
-#define BLT_FINGERPRINT_FILTER_MODE_ENABLED   1
+#define BLT_FINGERPRINT_FILTER_MAX_CHANNELS   8
+#define BLT_FINGERPRINT_FILTER_BLOCK_SIZE     256 /* frames */
+
+/* publish an update about once per second of audio */
+#define BLT_FINGERPRINT_FILTER_UPDATE_COUNT   BLT_FINGERPRINT_COUNT_FOR_DURATION(1)
 
 /*----------------------------------------------------------------------
 |    types
@@ -64,7 +69,12 @@ typedef struct {
     FingerprintFilterOutput    output;
     ATX_UInt32                 mode;
     ATX_PropertyListenerHandle property_listener_handle;
-    ATX_UInt32                 fingerprint_value;
+    BLT_Fingerprinter*         fingerprinter;
+    BLT_PcmMediaType           format;
+    BLT_Boolean                configured;
+    BLT_Cardinal               published_count;
+    float                      samples[BLT_FINGERPRINT_FILTER_BLOCK_SIZE*
+                                       BLT_FINGERPRINT_FILTER_MAX_CHANNELS];
 } FingerprintFilter;
 
 /*----------------------------------------------------------------------
@@ -75,6 +85,54 @@ ATX_DECLARE_INTERFACE_MAP(FingerprintFilter, BLT_MediaNode)
 ATX_DECLARE_INTERFACE_MAP(FingerprintFilter, ATX_Referenceable)
 ATX_DECLARE_INTERFACE_MAP(FingerprintFilter, ATX_PropertyListener)
 
+/*----------------------------------------------------------------------
+|    FingerprintFilter_Publish
++---------------------------------------------------------------------*/
+static void
+FingerprintFilter_Publish(FingerprintFilter* self,
+                          const char*        name,
+                          BLT_Cardinal       first,
+                          BLT_Cardinal       count)
+{
+    ATX_Properties*   stream_properties = NULL;
+    ATX_PropertyValue property;
+    char*             string;
+
+    if (ATX_BASE(self, BLT_BaseMediaNode).context == NULL) return;
+    if (BLT_FAILED(BLT_Stream_GetProperties(ATX_BASE(self, BLT_BaseMediaNode).context,
+                                            &stream_properties))) {
+        return;
+    }
+
+    string = (char*)ATX_AllocateMemory(count*BLT_FINGERPRINT_FORMATTED_SIZE+1);
+    if (string == NULL) return;
+    BLT_Fingerprint_Format(BLT_Fingerprinter_GetSubFingerprints(self->fingerprinter)+first,
+                           count,
+                           string);
+    property.type        = ATX_PROPERTY_VALUE_TYPE_STRING;
+    property.data.string = string;
+    ATX_Properties_SetProperty(stream_properties, name, &property);
+    ATX_FreeMemory(string);
+}
+
+/*----------------------------------------------------------------------
+|    FingerprintFilter_PublishUpdate
++---------------------------------------------------------------------*/
+static void
+FingerprintFilter_PublishUpdate(FingerprintFilter* self, BLT_Boolean flush)
+{
+    BLT_Cardinal count = BLT_Fingerprinter_GetCount(self->fingerprinter);
+
+    if (count < self->published_count+(flush?1:BLT_FINGERPRINT_FILTER_UPDATE_COUNT)) {
+        return;
+    }
+    FingerprintFilter_Publish(self,
+                              BLT_FINGERPRINT_FILTER_UPDATE,
+                              self->published_count,
+                              count-self->published_count);
+    self->published_count = count;
+}
+
 /*----------------------------------------------------------------------
 |    FingerprintFilterInput_PutPacket
 +---------------------------------------------------------------------*/
@@ -82,10 +140,13 @@ BLT_METHOD
 FingerprintFilterInput_PutPacket(BLT_PacketConsumer* _self,
                                  BLT_MediaPacket*    packet)
 {
-    FingerprintFilter* self = ATX_SELF_M(input, FingerprintFilter, BLT_PacketConsumer);
-    BLT_PcmMediaType*  media_type;
-    BLT_Flags          packet_flags;
-    BLT_Result         result;
+    FingerprintFilter*   self = ATX_SELF_M(input, FingerprintFilter, BLT_PacketConsumer);
+    BLT_PcmMediaType*    media_type;
+    BLT_Flags            packet_flags;
+    const unsigned char* payload;
+    BLT_Cardinal         frame_count;
+    BLT_Size             frame_size;
+    BLT_Result           result;
 
     /* get the media type */
     result = BLT_MediaPacket_GetMediaType(packet, (const BLT_MediaType**)(const void*)&media_type);
@@ -105,37 +166,55 @@ FingerprintFilterInput_PutPacket(BLT_PacketConsumer* _self,
         return BLT_SUCCESS;
     }
 
-    /* for now, we only support 16-bit */
-    if (media_type->bits_per_sample != 16) {
+    /* check that we can convert the samples */
+    if (!BLT_PcmFloat_SupportsFormat(media_type) ||
+        media_type->channel_count > BLT_FINGERPRINT_FILTER_MAX_CHANNELS) {
         return BLT_SUCCESS;
     }
 
-    /* process the PCM data */
-    /* TODO: implement actual fingerprint here */
+    /* a new format, or a new stream, starts a new fingerprint */
     packet_flags = BLT_MediaPacket_GetFlags(packet);
-    ATX_LOG_FINE_1("processing packet - flags=%d", packet_flags);
-    if (packet_flags & BLT_MEDIA_PACKET_FLAG_START_OF_STREAM) {
-        /* reset the fingerprint value */
-        self->fingerprint_value = 0;
+    ATX_LOG_FINER_1("processing packet - flags=%d", packet_flags);
+    if (!self->configured ||
+        self->format.sample_rate     != media_type->sample_rate     ||
+        self->format.channel_count   != media_type->channel_count   ||
+        self->format.bits_per_sample != media_type->bits_per_sample ||
+        self->format.sample_format   != media_type->sample_format) {
+        self->configured = BLT_SUCCEEDED(BLT_Fingerprinter_SetFormat(self->fingerprinter,
+                                                                     media_type->sample_rate,
+                                                                     media_type->channel_count));
+        self->format          = *media_type;
+        self->published_count = 0;
+    } else if (packet_flags & BLT_MEDIA_PACKET_FLAG_START_OF_STREAM) {
+        BLT_Fingerprinter_Reset(self->fingerprinter);
+        self->published_count = 0;
     }
-    /* dummy example: fingerprint value = total number of PCM samples */
-    if (media_type->channel_count) {
-        ATX_UInt32 sample_count = BLT_MediaPacket_GetPayloadSize(packet)/(media_type->channel_count*media_type->bits_per_sample/8);
-        self->fingerprint_value += sample_count;
+    if (!self->configured) return BLT_SUCCESS;
+
+    /* process the PCM data, converted to float in small blocks */
+    payload     = (const unsigned char*)BLT_MediaPacket_GetPayloadBuffer(packet);
+    frame_size  = media_type->channel_count*media_type->bits_per_sample/8;
+    if (frame_size == 0) return BLT_SUCCESS;
+    frame_count = BLT_MediaPacket_GetPayloadSize(packet)/frame_size;
+    while (frame_count) {
+        BLT_Cardinal chunk = frame_count;
+        if (chunk > BLT_FINGERPRINT_FILTER_BLOCK_SIZE) chunk = BLT_FINGERPRINT_FILTER_BLOCK_SIZE;
+        BLT_PcmFloat_Import(media_type, payload, chunk*media_type->channel_count, self->samples);
+        BLT_Fingerprinter_Process(self->fingerprinter, self->samples, chunk);
+        payload     += chunk*frame_size;
+        frame_count -= chunk;
     }
+    FingerprintFilter_PublishUpdate(self, BLT_FALSE);
+
     if (packet_flags & BLT_MEDIA_PACKET_FLAG_END_OF_STREAM) {
-        /* emit the fingerprint as a stream property */
-        /* as a dummy example, the fingerprint value is the string 'FP:XXXX' where XXXX is the PCM sample count */
-        /* measured during the fingerprint measuring phase */
-        ATX_Properties*   stream_properties = NULL;
-        ATX_PropertyValue fingerprint_property;
-        char              fingerprint_string[64];
-        ATX_FormatStringN(fingerprint_string, sizeof(fingerprint_string), "FP:%d", self->fingerprint_value);
-        BLT_Stream_GetProperties(ATX_BASE(self, BLT_BaseMediaNode).context, &stream_properties);
-        fingerprint_property.type        = ATX_PROPERTY_VALUE_TYPE_STRING;
-        fingerprint_property.data.string = fingerprint_string;
-        ATX_Properties_SetProperty(stream_properties, "dummy.fingerprint", &fingerprint_property);
-        self->fingerprint_value = 0;
+        /* emit the rest of the sub-fingerprints, and the whole fingerprint */
+        FingerprintFilter_PublishUpdate(self, BLT_TRUE);
+        FingerprintFilter_Publish(self,
+                                  BLT_FINGERPRINT_FILTER_VALUE,
+                                  0,
+                                  BLT_Fingerprinter_GetCount(self->fingerprinter));
+        BLT_Fingerprinter_Reset(self->fingerprinter);
+        self->published_count = 0;
     }
     
     return BLT_SUCCESS;
@@ -265,6 +344,7 @@ FingerprintFilter_Create(BLT_Module*              module,
                          BLT_MediaNode**          object)
 {
     FingerprintFilter* self;
+    BLT_Result         result;
 
     /* check parameters */
     if (parameters == NULL || 
@@ -279,6 +359,15 @@ FingerprintFilter_Create(BLT_Module*              module,
         return BLT_ERROR_OUT_OF_MEMORY;
     }
 
+    /* create the fingerprint engine */
+    result = BLT_Fingerprinter_Create(BLT_FINGERPRINT_COUNT_FOR_DURATION(BLT_FINGERPRINT_FILTER_MAX_DURATION),
+                                      &self->fingerprinter);
+    if (BLT_FAILED(result)) {
+        ATX_FreeMemory(self);
+        *object = NULL;
+        return result;
+    }
+
     /* construct the inherited object */
     BLT_BaseMediaNode_Construct(&ATX_BASE(self, BLT_BaseMediaNode), module, core);
 
@@ -306,6 +395,9 @@ FingerprintFilter_Destroy(FingerprintFilter* self)
         BLT_MediaPacket_Release(self->output.packet);
     }
 
+    /* destroy the fingerprint engine */
+    BLT_Fingerprinter_Destroy(self->fingerprinter);
+
     /* destruct the inherited object */
     BLT_BaseMediaNode_Destruct(&ATX_BASE(self, BLT_BaseMediaNode));
 
@@ -416,6 +508,10 @@ FingerprintFilter_Seek(BLT_MediaNode* _self,
         self->output.packet = NULL;
     }
 
+    /* the sub-fingerprints would not be contiguous anymore */
+    BLT_Fingerprinter_Reset(self->fingerprinter);
+    self->published_count = 0;
+
     return BLT_SUCCESS;
 }
 
@@ -559,5 +655,5 @@ ATX_IMPLEMENT_REFERENCEABLE_INTERFACE(FingerprintFilterModule, reference_count)
 BLT_MODULE_IMPLEMENT_STANDARD_GET_MODULE(FingerprintFilterModule,
                                          "Fingerprint Filter",
                                          "com.axiosys.filter.fingerprint",
-                                         "1.0.0",
+                                         "2.0.0",
                                          BLT_MODULE_AXIOMATIC_COPYRIGHT)
@@ -18,6 +18,12 @@
  * that passes through it.
  * These media nodes expect media packets with PCM audio as input, 
  * and produce media packets with PCM audio as output.
+ * The audio passes through unmodified. When enabled (see
+ * BLT_FINGERPRINT_FILTER_MODE), the node computes the fingerprint of
+ * the first BLT_FINGERPRINT_FILTER_MAX_DURATION seconds of each stream
+ * (see BltFingerprint.h), and publishes it as stream properties.
+ * 8 to 32 bit integer and float PCM are supported, at any sample rate
+ * from 8kHz, with up to 8 channels.
  *
  * @{ 
  */
@@ -31,8 +37,31 @@
 /*----------------------------------------------------------------------
 |   constants
 +---------------------------------------------------------------------*/
+/**
+ * Core property (integer) that enables the fingerprint computation.
+ */
 #define BLT_FINGERPRINT_FILTER_MODE "plugins.filters.fingerprint.mode"
 
+#define BLT_FINGERPRINT_FILTER_MODE_DISABLED  0
+#define BLT_FINGERPRINT_FILTER_MODE_ENABLED   1
+
+/**
+ * Stream property (string) with the sub-fingerprints computed since the
+ * last update, formatted with BLT_Fingerprint_Format. It is updated
+ * about once per second of audio, so that listeners can match a stream
+ * while it plays.
+ */
+#define BLT_FINGERPRINT_FILTER_UPDATE "plugins.filters.fingerprint.update"
+
+/**
+ * Stream property (string) with the complete fingerprint, formatted with
+ * BLT_Fingerprint_Format, set at the end of the stream.
+ */
+#define BLT_FINGERPRINT_FILTER_VALUE  "plugins.filters.fingerprint.value"
+
+/** Duration, in seconds, after which the audio is no longer fingerprinted */
+#define BLT_FINGERPRINT_FILTER_MAX_DURATION 120
+
 /*----------------------------------------------------------------------
 |   module
 +---------------------------------------------------------------------*/
@@ -17,6 +17,7 @@
 #include "BltCore.h"
 #include "BltGainControlFilter.h"
 #include "BltReplayGain.h"
+#include "BltGainEngine.h"
 #include "BltMediaNode.h"
 #include "BltMedia.h"
 #include "BltPcm.h"
@@ -34,9 +35,6 @@ ATX_SET_LOCAL_LOGGER("bluetune.plugins.filters.gain-control")
 +---------------------------------------------------------------------*/
 #define BLT_GAIN_CONTROL_FILTER_MODULE_NAME "com.axiosys.filter.gain-control"
 
-#define BLT_GAIN_CONTROL_FILTER_FACTOR_RANGE 1024
-#define BLT_GAIN_CONTROL_FILTER_MAX_FACTOR   16*1024
-
 #define BLT_GAIN_CONTROL_REPLAY_GAIN_TRACK_VALUE_SET 1
 #define BLT_GAIN_CONTROL_REPLAY_GAIN_ALBUM_VALUE_SET 2
 
@@ -48,12 +46,6 @@ ATX_SET_LOCAL_LOGGER("bluetune.plugins.filters.gain-control")
 +---------------------------------------------------------------------*/
 typedef BLT_BaseModule GainControlFilterModule;
 
-typedef enum {
-    BLT_GAIN_CONTROL_FILTER_MODE_INACTIVE,
-    BLT_GAIN_CONTROL_FILTER_MODE_AMPLIFY,
-    BLT_GAIN_CONTROL_FILTER_MODE_ATTENUATE
-} GainControlMode;
-
 typedef struct {
     /* interfaces */
     ATX_IMPLEMENTS(BLT_MediaPort);
@@ -79,15 +71,19 @@ typedef struct {
     /* members */
     GainControlFilterInput  input;
     GainControlFilterOutput output;
-    GainControlMode         mode;
-    unsigned short          factor;
+    BLT_GainEngine          engine;
     struct {
         BLT_Flags flags;
         int       track_gain;
         int       album_gain;
     } replay_gain_info;
+    double                  volume;
+    BLT_Boolean             handoff_present;
+    float                   handoff_gain;
     ATX_PropertyListenerHandle track_gain_listener_handle;
     ATX_PropertyListenerHandle album_gain_listener_handle;
+    ATX_PropertyListenerHandle volume_listener_handle;
+    ATX_PropertyListenerHandle handoff_listener_handle;
 } GainControlFilter;
 
 /*----------------------------------------------------------------------
@@ -107,8 +103,6 @@ GainControlFilterInput_PutPacket(BLT_PacketConsumer* _self,
 {
     GainControlFilter* self = ATX_SELF_M(input, GainControlFilter, BLT_PacketConsumer);
     BLT_PcmMediaType*  media_type;
-    BLT_Cardinal       sample_count;
-    short*             pcm;
     BLT_Result         result;
 
     /* get the media type */
@@ -125,34 +119,20 @@ GainControlFilterInput_PutPacket(BLT_PacketConsumer* _self,
     BLT_MediaPacket_AddReference(packet);
 
     /* exit now if we're inactive */
-    if (self->mode == BLT_GAIN_CONTROL_FILTER_MODE_INACTIVE ||
-        self->factor == 0) {
+    if (BLT_GainEngine_IsUnity(&self->engine)) {
         return BLT_SUCCESS;
     }
 
-    /* for now, we only support 16-bit */
-    if (media_type->bits_per_sample != 16) {
+    /* formats that the engine does not support pass through unmodified */
+    if (!BLT_GainEngine_SupportsFormat(media_type)) {
         return BLT_SUCCESS;
     }
 
-    /* adjust the gain */
-    pcm = (short*)BLT_MediaPacket_GetPayloadBuffer(packet);
-    sample_count = BLT_MediaPacket_GetPayloadSize(packet)/2;
-    if (self->mode == BLT_GAIN_CONTROL_FILTER_MODE_AMPLIFY) {
-        register unsigned short factor = self->factor;
-        while (sample_count--) {
-            *pcm = (*pcm * factor) / BLT_GAIN_CONTROL_FILTER_FACTOR_RANGE;
-            pcm++;
-        }
-    } else {
-        register unsigned short factor = self->factor;
-        while (sample_count--) {
-            *pcm = (*pcm * BLT_GAIN_CONTROL_FILTER_FACTOR_RANGE)/factor;
-            pcm++;
-        }
-    }
-
-    return BLT_SUCCESS;
+    /* adjust the gain (replay gain and volume combined) */
+    return BLT_GainEngine_Process(&self->engine,
+                                  media_type,
+                                  BLT_MediaPacket_GetPayloadBuffer(packet),
+                                  BLT_MediaPacket_GetPayloadSize(packet));
 }
 
 /*----------------------------------------------------------------------
@@ -298,6 +278,12 @@ GainControlFilter_Create(BLT_Module*              module,
     /* construct the inherited object */
     BLT_BaseMediaNode_Construct(&ATX_BASE(self, BLT_BaseMediaNode), module, core);
 
+    /* construct the object */
+    BLT_GainEngine_Init(&self->engine,
+                        BLT_GAIN_ENGINE_RAMP_EXPONENTIAL,
+                        BLT_GAIN_ENGINE_DEFAULT_RAMP_DURATION);
+    self->volume = 1.0;
+
     /* setup interfaces */
     ATX_SET_INTERFACE_EX(self, GainControlFilter, BLT_BaseMediaNode, BLT_MediaNode);
     ATX_SET_INTERFACE_EX(self, GainControlFilter, BLT_BaseMediaNode, ATX_Referenceable);
@@ -356,32 +342,36 @@ GainControlFilter_GetPortByName(BLT_MediaNode*  _self,
 }
 
 /*----------------------------------------------------------------------
-|    GainControlFilter_DbToFactor
-|
-|    The input parameter is the gain expressed in 100th of decibels
+|    GainControlFilter_SetHandoffGain
 +---------------------------------------------------------------------*/
-static unsigned short
-GainControlFilter_DbToFactor(int gain)
+static void
+GainControlFilter_SetHandoffGain(GainControlFilter* self, float gain)
 {
-    double f = 
-        (double)BLT_GAIN_CONTROL_FILTER_FACTOR_RANGE *
-        pow(10.0, ((double)gain)/2000);
-    unsigned int factor = (unsigned int)f; 
-    if (f >= BLT_GAIN_CONTROL_FILTER_FACTOR_RANGE && 
-        f <= BLT_GAIN_CONTROL_FILTER_MAX_FACTOR) {
-        return (unsigned short)factor;    
-    } else {
-        return BLT_GAIN_CONTROL_FILTER_FACTOR_RANGE;
+    ATX_Properties*   properties;
+    ATX_PropertyValue value;
+
+    if (gain == self->handoff_gain) return;
+    if (ATX_BASE(self, BLT_BaseMediaNode).context == NULL) return;
+    if (BLT_FAILED(BLT_Stream_GetProperties(ATX_BASE(self, BLT_BaseMediaNode).context, 
+                                            &properties))) {
+        return;
     }
+
+    self->handoff_gain = gain;
+    value.type    = ATX_PROPERTY_VALUE_TYPE_FLOAT;
+    value.data.fp = gain;
+    ATX_Properties_SetProperty(properties, BLT_STREAM_PROPERTY_HANDOFF_GAIN, &value);
 }
 
 /*----------------------------------------------------------------------
-|    GainControlFilter_UpdateReplayGain
+|    GainControlFilter_UpdateGain
 +---------------------------------------------------------------------*/
 static void
-GainControlFilter_UpdateReplayGain(GainControlFilter* self)
+GainControlFilter_UpdateGain(GainControlFilter* self)
 {
-    int gain_value = 0;
+    int    gain_value = 0;
+    double gain;
+
     if (self->replay_gain_info.flags & BLT_GAIN_CONTROL_REPLAY_GAIN_ALBUM_VALUE_SET) {
         gain_value = self->replay_gain_info.album_gain;   
     } else if (self->replay_gain_info.flags & BLT_GAIN_CONTROL_REPLAY_GAIN_TRACK_VALUE_SET) {
@@ -389,28 +379,28 @@ GainControlFilter_UpdateReplayGain(GainControlFilter* self)
     } else {
         gain_value = 0;
     }
-    
-    /* if the gain is 0, deactivate the filter */
-    if (gain_value == 0) {
-        /* disable the filter */
-        if (self->factor != 0) {
-            ATX_LOG_FINE("GainControlFilter::UpdateReplayGain - filter now inactive");
+    if (gain_value < BLT_GAIN_CONTROL_REPLAY_GAIN_MIN) gain_value = BLT_GAIN_CONTROL_REPLAY_GAIN_MIN;
+    if (gain_value > BLT_GAIN_CONTROL_REPLAY_GAIN_MAX) gain_value = BLT_GAIN_CONTROL_REPLAY_GAIN_MAX;
+
+    /* combine the replay gain and the volume into a single gain */
+    gain = (double)BLT_GainEngine_DbToGain(gain_value)*self->volume;
+    if (gain > (double)BLT_GAIN_ENGINE_MAX_GAIN) gain = (double)BLT_GAIN_ENGINE_MAX_GAIN;
+    if (gain < 0.0) gain = 0.0;
+
+    /* when a limiter follows, let it do the amplification, so that */
+    /* peaks above full scale are limited rather than clipped       */
+    if (self->handoff_present) {
+        float handoff_gain = 1.0f;
+        if (gain > (double)BLT_GAIN_ENGINE_UNITY_GAIN) {
+            handoff_gain = (float)(gain/(double)BLT_GAIN_ENGINE_UNITY_GAIN);
+            gain = (double)BLT_GAIN_ENGINE_UNITY_GAIN;
         }
-        self->factor = 0;
-        self->mode = BLT_GAIN_CONTROL_FILTER_MODE_INACTIVE;
-        return;
-    }
-
-    /* convert the gain value into a mode and a factor */
-    if (gain_value > 0) {
-        self->mode = BLT_GAIN_CONTROL_FILTER_MODE_AMPLIFY;
-        self->factor = GainControlFilter_DbToFactor(gain_value);
-        ATX_LOG_FINE_1("GainControlFilter::UpdateReplayGain - filter amplification = %d", self->factor);
-    } else {
-        self->mode = BLT_GAIN_CONTROL_FILTER_MODE_ATTENUATE;
-        self->factor = GainControlFilter_DbToFactor(-gain_value);
-        ATX_LOG_FINE_1("GainControlFilter::UpdateReplayGain - filter attenuation = %d", self->factor);
+        GainControlFilter_SetHandoffGain(self, handoff_gain);
     }
+    BLT_GainEngine_SetGain(&self->engine, (BLT_UInt32)(gain+0.5));
+    
+    ATX_LOG_FINE_3("GainControlFilter::UpdateGain - replay gain = %d, volume = %f, gain = %d", 
+                   gain_value, self->volume, self->engine.target_gain);
 }
 
 /*----------------------------------------------------------------------
@@ -427,7 +417,7 @@ GainControlFilter_UpdateReplayGainTrackValue(GainControlFilter*           self,
         self->replay_gain_info.track_gain = 0;
         self->replay_gain_info.flags &= ~BLT_GAIN_CONTROL_REPLAY_GAIN_TRACK_VALUE_SET;
     }
-    GainControlFilter_UpdateReplayGain(self);
+    GainControlFilter_UpdateGain(self);
 }
 
 /*----------------------------------------------------------------------
@@ -444,7 +434,46 @@ GainControlFilter_UpdateReplayGainAlbumValue(GainControlFilter*           self,
         self->replay_gain_info.album_gain = 0;
         self->replay_gain_info.flags &= ~BLT_GAIN_CONTROL_REPLAY_GAIN_ALBUM_VALUE_SET;
     }
-    GainControlFilter_UpdateReplayGain(self);
+    GainControlFilter_UpdateGain(self);
+}
+
+/*----------------------------------------------------------------------
+|    GainControlFilter_UpdateVolume
++---------------------------------------------------------------------*/
+static void
+GainControlFilter_UpdateVolume(GainControlFilter*       self,
+                               const ATX_PropertyValue* value)
+{
+    if (value == NULL) {
+        self->volume = 1.0;
+    } else if (value->type == ATX_PROPERTY_VALUE_TYPE_INTEGER) {
+        /* in 100th of decibels */
+        self->volume = pow(10.0, ((double)value->data.integer)/2000.0);
+    } else if (value->type == ATX_PROPERTY_VALUE_TYPE_FLOAT) {
+        /* linear */
+        self->volume = value->data.fp < 0.0f ? 0.0 : (double)value->data.fp;
+    } else {
+        return;
+    }
+    GainControlFilter_UpdateGain(self);
+}
+
+/*----------------------------------------------------------------------
+|    GainControlFilter_UpdateHandoff
++---------------------------------------------------------------------*/
+static void
+GainControlFilter_UpdateHandoff(GainControlFilter*       self,
+                                const ATX_PropertyValue* value)
+{
+    BLT_Boolean present = (value && 
+                           value->type == ATX_PROPERTY_VALUE_TYPE_INTEGER && 
+                           value->data.integer != 0)?BLT_TRUE:BLT_FALSE;
+    if (present == self->handoff_present) return;
+
+    /* the handoff gain property may hold a stale value: always publish */
+    self->handoff_present = present;
+    self->handoff_gain    = -1.0f;
+    GainControlFilter_UpdateGain(self);
 }
 
 /*----------------------------------------------------------------------
@@ -472,6 +501,14 @@ GainControlFilter_Activate(BLT_MediaNode* _self, BLT_Stream* stream)
                                        BLT_REPLAY_GAIN_ALBUM_GAIN_VALUE,
                                        &ATX_BASE(self, ATX_PropertyListener),
                                        &self->album_gain_listener_handle);
+            ATX_Properties_AddListener(properties, 
+                                       BLT_GAIN_CONTROL_FILTER_VOLUME,
+                                       &ATX_BASE(self, ATX_PropertyListener),
+                                       &self->volume_listener_handle);
+            ATX_Properties_AddListener(properties, 
+                                       BLT_STREAM_PROPERTY_GAIN_HANDOFF,
+                                       &ATX_BASE(self, ATX_PropertyListener),
+                                       &self->handoff_listener_handle);
 
             /* read the initial values of the replay gain info */
             self->replay_gain_info.flags = 0;
@@ -487,11 +524,27 @@ GainControlFilter_Activate(BLT_MediaNode* _self, BLT_Stream* stream)
             }
             if (ATX_SUCCEEDED(ATX_Properties_GetProperty(
                     properties,
-                    BLT_REPLAY_GAIN_TRACK_GAIN_VALUE,
+                    BLT_REPLAY_GAIN_ALBUM_GAIN_VALUE,
                     &property)) &&
                 property.type == ATX_PROPERTY_VALUE_TYPE_INTEGER) {
                 GainControlFilter_UpdateReplayGainAlbumValue(self, &property.data);
             }
+            if (ATX_SUCCEEDED(ATX_Properties_GetProperty(
+                    properties,
+                    BLT_GAIN_CONTROL_FILTER_VOLUME,
+                    &property))) {
+                GainControlFilter_UpdateVolume(self, &property);
+            }
+            if (ATX_SUCCEEDED(ATX_Properties_GetProperty(
+                    properties,
+                    BLT_STREAM_PROPERTY_GAIN_HANDOFF,
+                    &property))) {
+                GainControlFilter_UpdateHandoff(self, &property);
+            }
+
+            /* start at the right level rather than ramping to it */
+            GainControlFilter_UpdateGain(self);
+            BLT_GainEngine_ResetGain(&self->engine, self->engine.target_gain);
         }
     }
 
@@ -510,6 +563,8 @@ GainControlFilter_Deactivate(BLT_MediaNode* _self)
     self->replay_gain_info.flags      = 0;
     self->replay_gain_info.album_gain = 0;
     self->replay_gain_info.track_gain = 0;
+    self->volume                      = 1.0;
+    self->handoff_present             = BLT_FALSE;
 
     /* remove our listener */
     if (ATX_BASE(self, BLT_BaseMediaNode).context) {
@@ -520,7 +575,17 @@ GainControlFilter_Deactivate(BLT_MediaNode* _self)
                                           self->track_gain_listener_handle);
             ATX_Properties_RemoveListener(properties, 
                                           self->album_gain_listener_handle);
+            ATX_Properties_RemoveListener(properties, 
+                                          self->volume_listener_handle);
+            ATX_Properties_RemoveListener(properties, 
+                                          self->handoff_listener_handle);
+
+            /* the gain we handed over goes away with us */
+            if (self->handoff_gain > 1.0f) {
+                ATX_Properties_SetProperty(properties, BLT_STREAM_PROPERTY_HANDOFF_GAIN, NULL);
+            }
         }
+        self->handoff_gain = -1.0f;
     }
 
     /* we're detached from the stream */
@@ -584,6 +649,14 @@ GainControlFilter_OnPropertyChanged(ATX_PropertyListener*    _self,
 {
     GainControlFilter* self = ATX_SELF(GainControlFilter, ATX_PropertyListener);
 
+    if (name && ATX_StringsEqual(name, BLT_GAIN_CONTROL_FILTER_VOLUME)) {
+        GainControlFilter_UpdateVolume(self, value);
+        return;
+    }
+    if (name && ATX_StringsEqual(name, BLT_STREAM_PROPERTY_GAIN_HANDOFF)) {
+        GainControlFilter_UpdateHandoff(self, value);
+        return;
+    }
     if (name && 
         (value == NULL || value->type == ATX_PROPERTY_VALUE_TYPE_INTEGER)) {
         if (ATX_StringsEqual(name, BLT_REPLAY_GAIN_TRACK_GAIN_VALUE)) {
@@ -705,5 +778,5 @@ ATX_IMPLEMENT_REFERENCEABLE_INTERFACE(GainControlFilterModule, reference_count)
 BLT_MODULE_IMPLEMENT_STANDARD_GET_MODULE(GainControlFilterModule,
                                          "Gain Control Filter",
                                          BLT_GAIN_CONTROL_FILTER_MODULE_NAME,
-                                         "1.3.0",
+                                         "1.5.0",
                                          BLT_MODULE_AXIOMATIC_COPYRIGHT)
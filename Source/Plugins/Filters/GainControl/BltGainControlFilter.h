@@ -1,46 +1,60 @@
-/*****************************************************************
-|
-|   Gain Control Filter Module
-|
-|   (c) 2002-2006 Gilles Boccon-Gibod
-|   Author: Gilles Boccon-Gibod (bok@bok.net)
-|
- ****************************************************************/
-
-#ifndef _BLT_GAIN_CONTROL_FILTER_H_
-#define _BLT_GAIN_CONTROL_FILTER_H_
-
-/**
- * @ingroup plugin_modules
- * @ingroup plugin_filter_modules
- * @defgroup gain_control_filter_module Gain Control Filter Module 
- * Plugin module that create media nodes that perform gain control on
- * PCM audio data.
- * These media nodes expect media packets with PCM audio as input, 
- * and produce media packets with PCM audio as output.
- * They amplify or attenuate the PCM audio by a variable gain factor. 
- * These media nodes listen for ReplayGain values set by other nodes in 
- * the chain when they are found in certain media format or meta-data.
- *
- * @{ 
- */
-
-/*----------------------------------------------------------------------
-|   includes
-+---------------------------------------------------------------------*/
-#include "BltTypes.h"
-#include "BltModule.h"
-
-/*----------------------------------------------------------------------
-|   constants
-+---------------------------------------------------------------------*/
-#define BLT_GAIN_CONTROL_FILTER_OPTION_DO_REPLAY_GAIN "Plugins.GainControlFilter.DoReplayGain"
-
-/*----------------------------------------------------------------------
-|   module
-+---------------------------------------------------------------------*/
-BLT_Result BLT_GainControlFilterModule_GetModuleObject(BLT_Module** module);
-
-/** @} */
-
-#endif /* _BLT_GAIN_CONTROL_FILTER_H_ */
+/*****************************************************************
+|
+|   Gain Control Filter Module
+|
+|   (c) 2002-2006 Gilles Boccon-Gibod
+|   Author: Gilles Boccon-Gibod (bok@bok.net)
+|
+ ****************************************************************/
+
+#ifndef _BLT_GAIN_CONTROL_FILTER_H_
+#define _BLT_GAIN_CONTROL_FILTER_H_
+
+/**
+ * @ingroup plugin_modules
+ * @ingroup plugin_filter_modules
+ * @defgroup gain_control_filter_module Gain Control Filter Module 
+ * Plugin module that create media nodes that perform gain control on
+ * PCM audio data.
+ * These media nodes expect media packets with PCM audio as input, 
+ * and produce media packets with PCM audio as output.
+ * They amplify or attenuate the PCM audio by a variable gain factor. 
+ * Gain changes are applied with a short ramp, to avoid clicks.
+ * 16, 24 and 32 bit integer, as well as 32 bit float PCM are supported.
+ * These media nodes listen for ReplayGain values set by other nodes in 
+ * the chain when they are found in certain media format or meta-data.
+ * When a node that limits peaks, like a limiter filter node, is active
+ * in the same stream (see BLT_STREAM_PROPERTY_GAIN_HANDOFF), the part
+ * of the gain above unity is handed to it through
+ * BLT_STREAM_PROPERTY_HANDOFF_GAIN rather than applied here, so that
+ * amplified peaks are limited instead of clipped.
+ *
+ * @{ 
+ */
+
+/*----------------------------------------------------------------------
+|   includes
++---------------------------------------------------------------------*/
+#include "BltTypes.h"
+#include "BltModule.h"
+
+/*----------------------------------------------------------------------
+|   constants
++---------------------------------------------------------------------*/
+#define BLT_GAIN_CONTROL_FILTER_OPTION_DO_REPLAY_GAIN "Plugins.GainControlFilter.DoReplayGain"
+
+/**
+ * Stream property used to set a volume that is applied in the same pass
+ * as the ReplayGain adjustment. Integer values are in 100th of decibels,
+ * floating point values are linear factors (0.0 mutes the stream).
+ */
+#define BLT_GAIN_CONTROL_FILTER_VOLUME                "Plugins.GainControlFilter.Volume"
+
+/*----------------------------------------------------------------------
+|   module
++---------------------------------------------------------------------*/
+BLT_Result BLT_GainControlFilterModule_GetModuleObject(BLT_Module** module);
+
+/** @} */
+
+#endif /* _BLT_GAIN_CONTROL_FILTER_H_ */
@@ -0,0 +1,1220 @@
+/*****************************************************************
+|
+|   Limiter Filter Module
+|
+|   (c) 2002-2012 Gilles Boccon-Gibod
+|   Author: Gilles Boccon-Gibod (bok@bok.net)
+|
+ ****************************************************************/
+
+/*----------------------------------------------------------------------
+|   includes
++---------------------------------------------------------------------*/
+#include <math.h>
+
+#include "Atomix.h"
+#include "BltConfig.h"
+#include "BltCore.h"
+#include "BltLimiterFilter.h"
+#include "BltPcmFloat.h"
+#include "BltTruePeak.h"
+#include "BltMediaNode.h"
+#include "BltMedia.h"
+#include "BltPcm.h"
+#include "BltPacketProducer.h"
+#include "BltPacketConsumer.h"
+#include "BltStream.h"
+
+/*----------------------------------------------------------------------
+|   logging
++---------------------------------------------------------------------*/
+ATX_SET_LOCAL_LOGGER("bluetune.plugins.filters.limiter")
+
+/*----------------------------------------------------------------------
+|    constants
++---------------------------------------------------------------------*/
+#define BLT_LIMITER_FILTER_MODULE_NAME "com.axiosys.filter.limiter"
+
+#define BLT_LIMITER_FILTER_BLOCK_SIZE         256 /* frames */
+
+#define BLT_LIMITER_FILTER_DEFAULT_CEILING    (-100)
+#define BLT_LIMITER_FILTER_DEFAULT_LOOK_AHEAD 5
+#define BLT_LIMITER_FILTER_DEFAULT_RELEASE    100
+#define BLT_LIMITER_FILTER_MIN_CEILING        (-2000)
+#define BLT_LIMITER_FILTER_MAX_LOOK_AHEAD     50
+#define BLT_LIMITER_FILTER_MAX_RELEASE        5000
+#define BLT_LIMITER_FILTER_MAX_INPUT_GAIN     8.0f
+
+/*----------------------------------------------------------------------
+|    types
++---------------------------------------------------------------------*/
+typedef BLT_BaseModule LimiterFilterModule;
+
+typedef struct {
+    /* interfaces */
+    ATX_IMPLEMENTS(BLT_MediaPort);
+    ATX_IMPLEMENTS(BLT_PacketConsumer);
+} LimiterFilterInput;
+
+typedef struct {
+    /* interfaces */
+    ATX_IMPLEMENTS(BLT_MediaPort);
+    ATX_IMPLEMENTS(BLT_PacketProducer);
+
+    /* members */
+    ATX_List* packets;
+} LimiterFilterOutput;
+
+/* processing state. The gain for a frame is computed in 4 steps:    */
+/* 1. true peak of the input, through BLT_TruePeakMeter              */
+/* 2. max of the peaks over the look-ahead window (van Herk/Gil-     */
+/*    Werman: running max of the current segment of the window size, */
+/*    combined with the suffix max of the previous segment)          */
+/* 3. gain needed to keep that max under the ceiling, released with  */
+/*    a one-pole filter when it rises                                */
+/* 4. moving average of that gain over the look-ahead window, so     */
+/*    that the gain ramps down to its lowest value before the peak   */
+/*    leaves the delay line                                          */
+typedef struct {
+    BLT_Boolean       configured;
+    BLT_PcmMediaType  format;
+    BLT_Cardinal      look_ahead;     /* look-ahead window, in frames    */
+    BLT_Cardinal      latency;        /* delay of the audio, in frames   */
+    BLT_Cardinal      trim;           /* output frames left to drop      */
+    float             release;        /* release filter coefficient      */
+    float             envelope;
+    float             input_gain;     /* input gain currently applied    */
+    BLT_TruePeakMeter meter;
+
+    /* delay line, latency frames */
+    float*            delay;
+    BLT_Ordinal       delay_position;
+
+    /* sliding window max, look_ahead+1 frames */
+    float*            segment;
+    float*            segment_suffix;
+    float             segment_prefix;
+    BLT_Ordinal       segment_position;
+
+    /* moving average, look_ahead frames */
+    float*            average;
+    double            average_sum;
+    BLT_Ordinal       average_position;
+
+    /* work buffers for one block */
+    float*            samples;
+    float*            gains;
+    void*             memory;
+} LimiterFilterState;
+
+typedef struct {
+    /* base class */
+    ATX_EXTENDS(BLT_BaseMediaNode);
+
+    /* interfaces */
+    ATX_IMPLEMENTS(ATX_PropertyListener);
+
+    /* members */
+    LimiterFilterInput  input;
+    LimiterFilterOutput output;
+    LimiterFilterState  state;
+    struct {
+        float        ceiling;      /* linear                 */
+        BLT_Cardinal look_ahead;   /* ms                     */
+        BLT_Cardinal release;      /* ms                     */
+        float        input_gain;   /* linear                 */
+        float        handoff_gain; /* linear, from upstream  */
+    } settings;
+    ATX_PropertyListenerHandle ceiling_listener_handle;
+    ATX_PropertyListenerHandle look_ahead_listener_handle;
+    ATX_PropertyListenerHandle release_listener_handle;
+    ATX_PropertyListenerHandle input_gain_listener_handle;
+    ATX_PropertyListenerHandle handoff_gain_listener_handle;
+} LimiterFilter;
+
+/*----------------------------------------------------------------------
+|   forward declarations
++---------------------------------------------------------------------*/
+ATX_DECLARE_INTERFACE_MAP(LimiterFilterModule, BLT_Module)
+ATX_DECLARE_INTERFACE_MAP(LimiterFilter, BLT_MediaNode)
+ATX_DECLARE_INTERFACE_MAP(LimiterFilter, ATX_Referenceable)
+ATX_DECLARE_INTERFACE_MAP(LimiterFilter, ATX_PropertyListener)
+
+/*----------------------------------------------------------------------
+|    LimiterFilter_PublishLatency
+|
+|    Other nodes may hold media back too, so the stream latency is a
+|    sum: this node takes out the share it added before, which it keeps
+|    in its own latency property, and adds the new one.
++---------------------------------------------------------------------*/
+static void
+LimiterFilter_PublishLatency(LimiterFilter* self, BLT_Boolean active)
+{
+    ATX_Properties*   properties;
+    ATX_PropertyValue value;
+    ATX_Int32         latency = 0;
+    ATX_Int32         total   = 0;
+
+    if (ATX_BASE(self, BLT_BaseMediaNode).context == NULL) return;
+    if (BLT_FAILED(BLT_Stream_GetProperties(ATX_BASE(self, BLT_BaseMediaNode).context,
+                                            &properties))) {
+        return;
+    }
+
+    /* the properties are cleared for each new input, and with them */
+    /* the share of this node                                       */
+    if (ATX_SUCCEEDED(ATX_Properties_GetProperty(properties, BLT_STREAM_PROPERTY_LATENCY, &value)) &&
+        value.type == ATX_PROPERTY_VALUE_TYPE_INTEGER) {
+        total = value.data.integer;
+    }
+    if (ATX_SUCCEEDED(ATX_Properties_GetProperty(properties, BLT_LIMITER_FILTER_LATENCY, &value)) &&
+        value.type == ATX_PROPERTY_VALUE_TYPE_INTEGER) {
+        total -= value.data.integer;
+    }
+
+    if (active) {
+        if (self->state.configured) {
+            latency = (ATX_Int32)((self->state.latency*1000+self->state.format.sample_rate-1)/
+                                  self->state.format.sample_rate);
+        } else {
+            latency = (ATX_Int32)self->settings.look_ahead;
+        }
+        value.type         = ATX_PROPERTY_VALUE_TYPE_INTEGER;
+        value.data.integer = latency;
+        ATX_Properties_SetProperty(properties, BLT_LIMITER_FILTER_LATENCY, &value);
+    } else {
+        ATX_Properties_SetProperty(properties, BLT_LIMITER_FILTER_LATENCY, NULL);
+    }
+
+    total += latency;
+    if (total > 0) {
+        value.type         = ATX_PROPERTY_VALUE_TYPE_INTEGER;
+        value.data.integer = total;
+        ATX_Properties_SetProperty(properties, BLT_STREAM_PROPERTY_LATENCY, &value);
+    } else {
+        ATX_Properties_SetProperty(properties, BLT_STREAM_PROPERTY_LATENCY, NULL);
+    }
+}
+
+/*----------------------------------------------------------------------
+|    LimiterFilter_PublishHandoff
++---------------------------------------------------------------------*/
+static void
+LimiterFilter_PublishHandoff(LimiterFilter* self, BLT_Boolean active)
+{
+    ATX_Properties* properties;
+
+    if (ATX_BASE(self, BLT_BaseMediaNode).context == NULL) return;
+    if (BLT_FAILED(BLT_Stream_GetProperties(ATX_BASE(self, BLT_BaseMediaNode).context,
+                                            &properties))) {
+        return;
+    }
+
+    if (active) {
+        ATX_PropertyValue value;
+        value.type         = ATX_PROPERTY_VALUE_TYPE_INTEGER;
+        value.data.integer = 1;
+        ATX_Properties_SetProperty(properties, BLT_STREAM_PROPERTY_GAIN_HANDOFF, &value);
+    } else {
+        ATX_Properties_SetProperty(properties, BLT_STREAM_PROPERTY_GAIN_HANDOFF, NULL);
+    }
+}
+
+/*----------------------------------------------------------------------
+|    LimiterFilter_GetInputGain
+|
+|    The gain applied before limiting: our own, and the one handed over
+|    by the nodes upstream.
++---------------------------------------------------------------------*/
+static float
+LimiterFilter_GetInputGain(LimiterFilter* self)
+{
+    float gain = self->settings.input_gain*self->settings.handoff_gain;
+    if (gain > BLT_LIMITER_FILTER_MAX_INPUT_GAIN) gain = BLT_LIMITER_FILTER_MAX_INPUT_GAIN;
+    return gain;
+}
+
+/*----------------------------------------------------------------------
+|    LimiterFilter_UpdateReleaseCoefficient
++---------------------------------------------------------------------*/
+static void
+LimiterFilter_UpdateReleaseCoefficient(LimiterFilter* self)
+{
+    if (!self->state.configured) return;
+    self->state.release = (float)(1.0-exp(-1000.0/((double)self->settings.release*
+                                                    (double)self->state.format.sample_rate)));
+}
+
+/*----------------------------------------------------------------------
+|    LimiterFilter_ResetState
++---------------------------------------------------------------------*/
+static void
+LimiterFilter_ResetState(LimiterFilter* self)
+{
+    LimiterFilterState* state = &self->state;
+    BLT_Ordinal         i;
+
+    if (!state->configured) return;
+
+    ATX_SetMemory(state->delay, 0, state->latency*state->format.channel_count*sizeof(float));
+    ATX_SetMemory(state->segment, 0, (state->look_ahead+1)*sizeof(float));
+    ATX_SetMemory(state->segment_suffix, 0, (state->look_ahead+2)*sizeof(float));
+    for (i=0; i<state->look_ahead; i++) state->average[i] = 1.0f;
+    state->delay_position   = 0;
+    state->segment_prefix   = 0.0f;
+    state->segment_position = 0;
+    state->average_sum      = (double)state->look_ahead;
+    state->average_position = 0;
+    state->envelope         = 1.0f;
+    state->input_gain       = LimiterFilter_GetInputGain(self);
+    state->trim             = state->latency;
+    BLT_TruePeakMeter_Reset(&state->meter);
+
+    /* the stream properties are cleared when a new input is set */
+    LimiterFilter_PublishLatency(self, BLT_TRUE);
+    LimiterFilter_PublishHandoff(self, BLT_TRUE);
+}
+
+/*----------------------------------------------------------------------
+|    LimiterFilter_FreeState
++---------------------------------------------------------------------*/
+static void
+LimiterFilter_FreeState(LimiterFilter* self)
+{
+    if (self->state.memory) ATX_FreeMemory(self->state.memory);
+    ATX_SetMemory(&self->state, 0, sizeof(self->state));
+}
+
+/*----------------------------------------------------------------------
+|    LimiterFilter_Configure
++---------------------------------------------------------------------*/
+static BLT_Result
+LimiterFilter_Configure(LimiterFilter* self, const BLT_PcmMediaType* format)
+{
+    LimiterFilterState* state = &self->state;
+    BLT_PcmMediaType    new_format = *format; /* format may point into state */
+    BLT_Cardinal        channel_count = new_format.channel_count;
+    BLT_Cardinal        look_ahead;
+    BLT_Cardinal        latency;
+    float*              buffer;
+
+    LimiterFilter_FreeState(self);
+
+    look_ahead = (self->settings.look_ahead*new_format.sample_rate)/1000;
+    if (look_ahead == 0) look_ahead = 1;
+    latency = look_ahead+BLT_TRUE_PEAK_METER_DELAY;
+
+    /* all the buffers in one allocation */
+    state->memory = ATX_AllocateMemory(sizeof(float)*(latency*channel_count +  /* delay          */
+                                                      look_ahead+1          +  /* segment        */
+                                                      look_ahead+2          +  /* segment_suffix */
+                                                      look_ahead            +  /* average        */
+                                                      BLT_LIMITER_FILTER_BLOCK_SIZE*channel_count +
+                                                      BLT_LIMITER_FILTER_BLOCK_SIZE));
+    if (state->memory == NULL) return BLT_ERROR_OUT_OF_MEMORY;
+    buffer = (float*)state->memory;
+    state->delay          = buffer; buffer += latency*channel_count;
+    state->segment        = buffer; buffer += look_ahead+1;
+    state->segment_suffix = buffer; buffer += look_ahead+2;
+    state->average        = buffer; buffer += look_ahead;
+    state->samples        = buffer; buffer += BLT_LIMITER_FILTER_BLOCK_SIZE*channel_count;
+    state->gains          = buffer;
+
+    BLT_TruePeakMeter_Init(&state->meter, channel_count);
+    state->format     = new_format;
+    state->look_ahead = look_ahead;
+    state->latency    = latency;
+    state->configured = BLT_TRUE;
+    LimiterFilter_UpdateReleaseCoefficient(self);
+    LimiterFilter_ResetState(self);
+
+    ATX_LOG_FINE_3("LimiterFilter::Configure - %d Hz, %d channels, latency = %d frames",
+                   (int)new_format.sample_rate, (int)channel_count, (int)latency);
+
+    return BLT_SUCCESS;
+}
+
+/*----------------------------------------------------------------------
+|    LimiterFilter_Restart
++---------------------------------------------------------------------*/
+static void
+LimiterFilter_Restart(LimiterFilter* self)
+{
+    if (!self->state.configured) return;
+
+    /* a new look-ahead window can only be applied when starting over */
+    if ((self->settings.look_ahead*self->state.format.sample_rate)/1000 != self->state.look_ahead) {
+        if (BLT_FAILED(LimiterFilter_Configure(self, &self->state.format))) {
+            LimiterFilter_FreeState(self);
+        }
+    } else {
+        LimiterFilter_ResetState(self);
+    }
+}
+
+/*----------------------------------------------------------------------
+|    LimiterFilter_ProcessBlock
++---------------------------------------------------------------------*/
+static void
+LimiterFilter_ProcessBlock(LimiterFilter* self, BLT_Cardinal frame_count)
+{
+    LimiterFilterState* state         = &self->state;
+    BLT_Cardinal        channel_count = state->format.channel_count;
+    BLT_Cardinal        window        = state->look_ahead+1;
+    float*              samples       = state->samples;
+    float*              gains         = state->gains;
+    BLT_Ordinal         i;
+    BLT_Ordinal         j;
+    BLT_Ordinal         c;
+    float               input_gain    = LimiterFilter_GetInputGain(self);
+
+    /* input gain, ramped over the block when it changes */
+    if (state->input_gain != input_gain) {
+        float gain = state->input_gain;
+        float step = (input_gain-gain)/(float)frame_count;
+        for (i=0; i<frame_count; i++) {
+            gain += step;
+            for (c=0; c<channel_count; c++) {
+                samples[i*channel_count+c] *= gain;
+            }
+        }
+        state->input_gain = input_gain;
+    } else if (state->input_gain != 1.0f) {
+        float gain = state->input_gain;
+        for (i=0; i<frame_count*channel_count; i++) {
+            samples[i] *= gain;
+        }
+    }
+
+    /* true peaks */
+    BLT_TruePeakMeter_Process(&state->meter, samples, frame_count, gains);
+
+    /* max over the window, in runs that stop at segment boundaries */
+    for (i=0; i<frame_count;) {
+        BLT_Cardinal run     = window-state->segment_position;
+        float*       segment = state->segment+state->segment_position;
+        const float* suffix  = state->segment_suffix+state->segment_position+1;
+        float        prefix  = state->segment_prefix;
+        if (run > frame_count-i) run = frame_count-i;
+
+        for (j=0; j<run; j++) {
+            float peak = gains[i+j];
+            segment[j] = peak;
+            prefix = peak > prefix ? peak : prefix;
+            gains[i+j] = suffix[j] > prefix ? suffix[j] : prefix;
+        }
+        state->segment_prefix    = prefix;
+        state->segment_position += run;
+        i += run;
+
+        if (state->segment_position == window) {
+            /* the segment is complete, the next one needs its suffix max */
+            float* complete = state->segment_suffix;
+            complete[window] = 0.0f;
+            for (j=window; j--;) {
+                complete[j] = state->segment[j] > complete[j+1] ? state->segment[j] : complete[j+1];
+            }
+            state->segment_prefix   = 0.0f;
+            state->segment_position = 0;
+        }
+    }
+
+    /* gain needed to stay under the ceiling: instant attack, slow release */
+    {
+        float ceiling  = self->settings.ceiling;
+        float release  = state->release;
+        float envelope = state->envelope;
+        for (i=0; i<frame_count; i++) {
+            float peak   = gains[i] > ceiling ? gains[i] : ceiling;
+            float target = ceiling/peak;
+            envelope += (target-envelope)*release;
+            envelope  = target < envelope ? target : envelope;
+            gains[i]  = envelope;
+        }
+        state->envelope = envelope;
+    }
+
+    /* moving average of the gain */
+    for (i=0; i<frame_count;) {
+        BLT_Cardinal run     = state->look_ahead-state->average_position;
+        float*       average = state->average+state->average_position;
+        double       sum     = state->average_sum;
+        double       scale   = 1.0/(double)state->look_ahead;
+        if (run > frame_count-i) run = frame_count-i;
+
+        for (j=0; j<run; j++) {
+            sum += (double)gains[i+j]-(double)average[j];
+            average[j] = gains[i+j];
+            gains[i+j] = (float)(sum*scale);
+        }
+        state->average_sum       = sum;
+        state->average_position += run;
+        i += run;
+
+        if (state->average_position == state->look_ahead) {
+            /* recompute the sum now and then so that errors don't add up */
+            sum = 0.0;
+            for (j=0; j<state->look_ahead; j++) sum += state->average[j];
+            state->average_sum      = sum;
+            state->average_position = 0;
+        }
+    }
+
+    /* delay the samples and apply the gain */
+    for (i=0; i<frame_count;) {
+        BLT_Cardinal run    = state->latency-state->delay_position;
+        float*       delay  = state->delay+state->delay_position*channel_count;
+        float*       io     = samples+i*channel_count;
+        const float* gain   = gains+i;
+        if (run > frame_count-i) run = frame_count-i;
+
+        for (j=0; j<run; j++) {
+            for (c=0; c<channel_count; c++) {
+                float sample = io[j*channel_count+c];
+                io[j*channel_count+c]    = delay[j*channel_count+c]*gain[j];
+                delay[j*channel_count+c] = sample;
+            }
+        }
+        state->delay_position += run;
+        i += run;
+        if (state->delay_position == state->latency) state->delay_position = 0;
+    }
+}
+
+/*----------------------------------------------------------------------
+|    LimiterFilter_Render
++---------------------------------------------------------------------*/
+static BLT_Result
+LimiterFilter_Render(LimiterFilter*    self,
+                     const void*       input,
+                     BLT_Cardinal      input_frames,
+                     BLT_Boolean       flush,
+                     BLT_MediaPacket** output,
+                     BLT_Cardinal*     dropped_frames)
+{
+    LimiterFilterState* state         = &self->state;
+    BLT_Cardinal        channel_count = state->format.channel_count;
+    BLT_Size            frame_size    = channel_count*state->format.bits_per_sample/8;
+    BLT_Cardinal        total_frames  = input_frames+(flush?state->latency:0);
+    BLT_Cardinal        dropped       = state->trim < total_frames ? state->trim : total_frames;
+    BLT_Size            output_size   = (total_frames-dropped)*frame_size;
+    unsigned char*      out;
+    BLT_Ordinal         processed;
+    BLT_Result          result;
+
+    *dropped_frames = dropped;
+    result = BLT_Core_CreateMediaPacket(ATX_BASE(self, BLT_BaseMediaNode).core,
+                                        output_size,
+                                        (const BLT_MediaType*)&state->format,
+                                        output);
+    if (BLT_FAILED(result)) return result;
+    BLT_MediaPacket_SetPayloadSize(*output, output_size);
+    out = (unsigned char*)BLT_MediaPacket_GetPayloadBuffer(*output);
+
+    for (processed=0; processed<total_frames;) {
+        BLT_Cardinal chunk = total_frames-processed;
+        BLT_Cardinal real  = 0;
+        BLT_Cardinal skip;
+        if (chunk > BLT_LIMITER_FILTER_BLOCK_SIZE) chunk = BLT_LIMITER_FILTER_BLOCK_SIZE;
+
+        /* input samples, then silence to push out the delay line */
+        if (processed < input_frames) {
+            real = input_frames-processed;
+            if (real > chunk) real = chunk;
+            BLT_PcmFloat_Import(&state->format,
+                                (const unsigned char*)input+processed*frame_size,
+                                real*channel_count,
+                                state->samples);
+        }
+        if (real < chunk) {
+            ATX_SetMemory(state->samples+real*channel_count, 0, (chunk-real)*channel_count*sizeof(float));
+        }
+
+        LimiterFilter_ProcessBlock(self, chunk);
+
+        /* the first frames out of the delay line are not audio */
+        skip = state->trim < chunk ? state->trim : chunk;
+        state->trim -= skip;
+        BLT_PcmFloat_Export(&state->format,
+                            state->samples+skip*channel_count,
+                            (chunk-skip)*channel_count,
+                            out);
+        out += (chunk-skip)*frame_size;
+        processed += chunk;
+    }
+
+    return BLT_SUCCESS;
+}
+
+/*----------------------------------------------------------------------
+|    LimiterFilter_QueuePacket
++---------------------------------------------------------------------*/
+static BLT_Result
+LimiterFilter_QueuePacket(LimiterFilter* self, BLT_MediaPacket* packet)
+{
+    BLT_Result result = ATX_List_AddData(self->output.packets, packet);
+    if (BLT_FAILED(result)) BLT_MediaPacket_Release(packet);
+    return result;
+}
+
+/*----------------------------------------------------------------------
+|    LimiterFilter_Drain
++---------------------------------------------------------------------*/
+static BLT_Result
+LimiterFilter_Drain(LimiterFilter* self)
+{
+    BLT_MediaPacket* packet = NULL;
+    BLT_Cardinal     dropped;
+    BLT_Size         frame_size;
+    BLT_Cardinal     sample_rate;
+    BLT_Result       result;
+
+    /* nothing to do if no audio went in since the last reset */
+    if (!self->state.configured || self->state.trim == self->state.latency) {
+        return BLT_SUCCESS;
+    }
+
+    frame_size  = self->state.format.channel_count*self->state.format.bits_per_sample/8;
+    sample_rate = self->state.format.sample_rate;
+    result = LimiterFilter_Render(self, NULL, 0, BLT_TRUE, &packet, &dropped);
+    LimiterFilter_Restart(self);
+    if (BLT_FAILED(result)) return result;
+    BLT_MediaPacket_SetDuration(packet,
+        BLT_TimeStamp_FromSamples(BLT_MediaPacket_GetPayloadSize(packet)/frame_size,
+                                  sample_rate));
+
+    return LimiterFilter_QueuePacket(self, packet);
+}
+
+/*----------------------------------------------------------------------
+|    LimiterFilterInput_PutPacket
++---------------------------------------------------------------------*/
+BLT_METHOD
+LimiterFilterInput_PutPacket(BLT_PacketConsumer* _self,
+                             BLT_MediaPacket*    packet)
+{
+    LimiterFilter*    self = ATX_SELF_M(input, LimiterFilter, BLT_PacketConsumer);
+    BLT_PcmMediaType* media_type;
+    BLT_Flags         flags = BLT_MediaPacket_GetFlags(packet);
+    BLT_MediaPacket*  output = NULL;
+    BLT_Size          frame_size;
+    BLT_Cardinal      latency;
+    BLT_Cardinal      dropped = 0;
+    BLT_TimeStamp     time_stamp;
+    BLT_Result        result;
+
+    /* get the media type */
+    result = BLT_MediaPacket_GetMediaType(packet, (const BLT_MediaType**)(const void*)&media_type);
+    if (BLT_FAILED(result)) return result;
+
+    /* check the media type */
+    if (media_type->base.id != BLT_MEDIA_TYPE_ID_AUDIO_PCM) {
+        return BLT_ERROR_INVALID_MEDIA_TYPE;
+    }
+
+    /* formats that we can't process pass through unmodified */
+    if (!BLT_PcmFloat_SupportsFormat(media_type) ||
+        media_type->channel_count > BLT_TRUE_PEAK_METER_MAX_CHANNELS ||
+        media_type->sample_rate == 0) {
+        LimiterFilter_Drain(self);
+        BLT_MediaPacket_AddReference(packet);
+        return LimiterFilter_QueuePacket(self, packet);
+    }
+
+    /* a new format, or a new stream, starts from scratch */
+    if (!self->state.configured ||
+        self->state.format.sample_rate     != media_type->sample_rate     ||
+        self->state.format.channel_count   != media_type->channel_count   ||
+        self->state.format.bits_per_sample != media_type->bits_per_sample ||
+        self->state.format.sample_format   != media_type->sample_format) {
+        LimiterFilter_Drain(self);
+        result = LimiterFilter_Configure(self, media_type);
+        if (BLT_FAILED(result)) return result;
+    } else if (flags & BLT_MEDIA_PACKET_FLAG_START_OF_STREAM) {
+        LimiterFilter_Drain(self);
+        if (!self->state.configured) return BLT_ERROR_OUT_OF_MEMORY;
+    }
+
+    /* process the samples, and the tail of the delay line at the end */
+    frame_size = media_type->channel_count*media_type->bits_per_sample/8;
+    latency    = self->state.latency;
+    result = LimiterFilter_Render(self,
+                                  BLT_MediaPacket_GetPayloadBuffer(packet),
+                                  BLT_MediaPacket_GetPayloadSize(packet)/frame_size,
+                                  (flags & BLT_MEDIA_PACKET_FLAG_END_OF_STREAM)?BLT_TRUE:BLT_FALSE,
+                                  &output,
+                                  &dropped);
+    if (flags & BLT_MEDIA_PACKET_FLAG_END_OF_STREAM) {
+        LimiterFilter_Restart(self);
+    }
+    if (BLT_FAILED(result)) return result;
+
+    /* drop empty packets, unless they carry flags */
+    if (BLT_MediaPacket_GetPayloadSize(output) == 0 && flags == 0) {
+        BLT_MediaPacket_Release(output);
+        return BLT_SUCCESS;
+    }
+
+    /* the output starts latency-dropped frames before the input */
+    BLT_MediaPacket_SetFlags(output, flags);
+    time_stamp = BLT_MediaPacket_GetTimeStamp(packet);
+    if (time_stamp.seconds || time_stamp.nanoseconds) {
+        BLT_TimeStamp delay = BLT_TimeStamp_FromSamples(latency-dropped,
+                                                        media_type->sample_rate);
+        if (BLT_TimeStamp_IsLaterOrEqual(time_stamp, delay)) {
+            time_stamp = BLT_TimeStamp_Sub(time_stamp, delay);
+        }
+        BLT_MediaPacket_SetTimeStamp(output, time_stamp);
+    }
+    BLT_MediaPacket_SetDuration(output,
+                                BLT_TimeStamp_FromSamples(BLT_MediaPacket_GetPayloadSize(output)/frame_size,
+                                                          media_type->sample_rate));
+
+    return LimiterFilter_QueuePacket(self, output);
+}
+
+/*----------------------------------------------------------------------
+|   LimiterFilterInput_QueryMediaType
++---------------------------------------------------------------------*/
+BLT_METHOD
+LimiterFilterInput_QueryMediaType(BLT_MediaPort*         self,
+                                  BLT_Ordinal            index,
+                                  const BLT_MediaType**  media_type)
+{
+    BLT_COMPILER_UNUSED(self);
+    if (index == 0) {
+        *media_type = &BLT_GenericPcmMediaType;
+        return BLT_SUCCESS;
+    } else {
+        *media_type = NULL;
+        return BLT_FAILURE;
+    }
+}
+
+/*----------------------------------------------------------------------
+|   GetInterface implementation
++---------------------------------------------------------------------*/
+ATX_BEGIN_GET_INTERFACE_IMPLEMENTATION(LimiterFilterInput)
+    ATX_GET_INTERFACE_ACCEPT(LimiterFilterInput, BLT_MediaPort)
+    ATX_GET_INTERFACE_ACCEPT(LimiterFilterInput, BLT_PacketConsumer)
+ATX_END_GET_INTERFACE_IMPLEMENTATION
+
+/*----------------------------------------------------------------------
+|    BLT_PacketConsumer interface
++---------------------------------------------------------------------*/
+ATX_BEGIN_INTERFACE_MAP(LimiterFilterInput, BLT_PacketConsumer)
+    LimiterFilterInput_PutPacket
+ATX_END_INTERFACE_MAP
+
+/*----------------------------------------------------------------------
+|    BLT_MediaPort interface
++---------------------------------------------------------------------*/
+BLT_MEDIA_PORT_IMPLEMENT_SIMPLE_TEMPLATE(LimiterFilterInput,
+                                         "input",
+                                         PACKET,
+                                         IN)
+ATX_BEGIN_INTERFACE_MAP(LimiterFilterInput, BLT_MediaPort)
+    LimiterFilterInput_GetName,
+    LimiterFilterInput_GetProtocol,
+    LimiterFilterInput_GetDirection,
+    LimiterFilterInput_QueryMediaType
+ATX_END_INTERFACE_MAP
+
+/*----------------------------------------------------------------------
+|    LimiterFilterOutput_GetPacket
++---------------------------------------------------------------------*/
+BLT_METHOD
+LimiterFilterOutput_GetPacket(BLT_PacketProducer* _self,
+                              BLT_MediaPacket**   packet)
+{
+    LimiterFilter* self = ATX_SELF_M(output, LimiterFilter, BLT_PacketProducer);
+    ATX_ListItem*  item;
+
+    item = ATX_List_GetFirstItem(self->output.packets);
+    if (item) {
+        *packet = ATX_ListItem_GetData(item);
+        ATX_List_RemoveItem(self->output.packets, item);
+        return BLT_SUCCESS;
+    } else {
+        *packet = NULL;
+        return BLT_ERROR_PORT_HAS_NO_DATA;
+    }
+}
+
+/*----------------------------------------------------------------------
+|   LimiterFilterOutput_QueryMediaType
++---------------------------------------------------------------------*/
+BLT_METHOD
+LimiterFilterOutput_QueryMediaType(BLT_MediaPort*         self,
+                                   BLT_Ordinal            index,
+                                   const BLT_MediaType**  media_type)
+{
+    BLT_COMPILER_UNUSED(self);
+    if (index == 0) {
+        *media_type = &BLT_GenericPcmMediaType;
+        return BLT_SUCCESS;
+    } else {
+        *media_type = NULL;
+        return BLT_FAILURE;
+    }
+}
+
+/*----------------------------------------------------------------------
+|   GetInterface implementation
++---------------------------------------------------------------------*/
+ATX_BEGIN_GET_INTERFACE_IMPLEMENTATION(LimiterFilterOutput)
+    ATX_GET_INTERFACE_ACCEPT(LimiterFilterOutput, BLT_MediaPort)
+    ATX_GET_INTERFACE_ACCEPT(LimiterFilterOutput, BLT_PacketProducer)
+ATX_END_GET_INTERFACE_IMPLEMENTATION
+
+/*----------------------------------------------------------------------
+|    BLT_MediaPort interface
++---------------------------------------------------------------------*/
+BLT_MEDIA_PORT_IMPLEMENT_SIMPLE_TEMPLATE(LimiterFilterOutput,
+                                         "output",
+                                         PACKET,
+                                         OUT)
+ATX_BEGIN_INTERFACE_MAP(LimiterFilterOutput, BLT_MediaPort)
+    LimiterFilterOutput_GetName,
+    LimiterFilterOutput_GetProtocol,
+    LimiterFilterOutput_GetDirection,
+    LimiterFilterOutput_QueryMediaType
+ATX_END_INTERFACE_MAP
+
+/*----------------------------------------------------------------------
+|    BLT_PacketProducer interface
++---------------------------------------------------------------------*/
+ATX_BEGIN_INTERFACE_MAP(LimiterFilterOutput, BLT_PacketProducer)
+    LimiterFilterOutput_GetPacket
+ATX_END_INTERFACE_MAP
+
+/*----------------------------------------------------------------------
+|    LimiterFilter_ClearOutput
++---------------------------------------------------------------------*/
+static void
+LimiterFilter_ClearOutput(LimiterFilter* self)
+{
+    ATX_ListItem* item = ATX_List_GetFirstItem(self->output.packets);
+    while (item) {
+        BLT_MediaPacket* packet = ATX_ListItem_GetData(item);
+        if (packet) BLT_MediaPacket_Release(packet);
+        item = ATX_ListItem_GetNext(item);
+    }
+    ATX_List_Clear(self->output.packets);
+}
+
+/*----------------------------------------------------------------------
+|    LimiterFilter_Create
++---------------------------------------------------------------------*/
+static BLT_Result
+LimiterFilter_Create(BLT_Module*              module,
+                     BLT_Core*                core,
+                     BLT_ModuleParametersType parameters_type,
+                     BLT_AnyConst             parameters,
+                     BLT_MediaNode**          object)
+{
+    LimiterFilter* self;
+    BLT_Result     result;
+
+    ATX_LOG_FINE("LimiterFilter::Create");
+
+    /* check parameters */
+    if (parameters == NULL ||
+        parameters_type != BLT_MODULE_PARAMETERS_TYPE_MEDIA_NODE_CONSTRUCTOR) {
+        return BLT_ERROR_INVALID_PARAMETERS;
+    }
+
+    /* allocate memory for the object */
+    self = ATX_AllocateZeroMemory(sizeof(LimiterFilter));
+    if (self == NULL) {
+        *object = NULL;
+        return BLT_ERROR_OUT_OF_MEMORY;
+    }
+
+    /* construct the inherited object */
+    BLT_BaseMediaNode_Construct(&ATX_BASE(self, BLT_BaseMediaNode), module, core);
+
+    /* construct the object */
+    result = ATX_List_Create(&self->output.packets);
+    if (BLT_FAILED(result)) {
+        BLT_BaseMediaNode_Destruct(&ATX_BASE(self, BLT_BaseMediaNode));
+        ATX_FreeMemory(self);
+        *object = NULL;
+        return result;
+    }
+    self->settings.ceiling    = (float)pow(10.0, BLT_LIMITER_FILTER_DEFAULT_CEILING/2000.0);
+    self->settings.look_ahead = BLT_LIMITER_FILTER_DEFAULT_LOOK_AHEAD;
+    self->settings.release    = BLT_LIMITER_FILTER_DEFAULT_RELEASE;
+    self->settings.input_gain   = 1.0f;
+    self->settings.handoff_gain = 1.0f;
+
+    /* setup interfaces */
+    ATX_SET_INTERFACE_EX(self, LimiterFilter, BLT_BaseMediaNode, BLT_MediaNode);
+    ATX_SET_INTERFACE_EX(self, LimiterFilter, BLT_BaseMediaNode, ATX_Referenceable);
+    ATX_SET_INTERFACE(self, LimiterFilter, ATX_PropertyListener);
+    ATX_SET_INTERFACE(&self->input,  LimiterFilterInput,  BLT_MediaPort);
+    ATX_SET_INTERFACE(&self->input,  LimiterFilterInput,  BLT_PacketConsumer);
+    ATX_SET_INTERFACE(&self->output, LimiterFilterOutput, BLT_MediaPort);
+    ATX_SET_INTERFACE(&self->output, LimiterFilterOutput, BLT_PacketProducer);
+    *object = &ATX_BASE_EX(self, BLT_BaseMediaNode, BLT_MediaNode);
+
+    return BLT_SUCCESS;
+}
+
+/*----------------------------------------------------------------------
+|    LimiterFilter_Destroy
++---------------------------------------------------------------------*/
+static BLT_Result
+LimiterFilter_Destroy(LimiterFilter* self)
+{
+    ATX_LOG_FINE("LimiterFilter::Destroy");
+
+    /* release any output packet we may hold */
+    LimiterFilter_ClearOutput(self);
+    ATX_List_Destroy(self->output.packets);
+
+    /* free the processing state */
+    LimiterFilter_FreeState(self);
+
+    /* destruct the inherited object */
+    BLT_BaseMediaNode_Destruct(&ATX_BASE(self, BLT_BaseMediaNode));
+
+    /* free the object memory */
+    ATX_FreeMemory((void*)self);
+
+    return BLT_SUCCESS;
+}
+
+/*----------------------------------------------------------------------
+|   LimiterFilter_GetPortByName
++---------------------------------------------------------------------*/
+BLT_METHOD
+LimiterFilter_GetPortByName(BLT_MediaNode*  _self,
+                            BLT_CString     name,
+                            BLT_MediaPort** port)
+{
+    LimiterFilter* self = ATX_SELF_EX(LimiterFilter, BLT_BaseMediaNode, BLT_MediaNode);
+
+    if (ATX_StringsEqual(name, "input")) {
+        *port = &ATX_BASE(&self->input, BLT_MediaPort);
+        return BLT_SUCCESS;
+    } else if (ATX_StringsEqual(name, "output")) {
+        *port = &ATX_BASE(&self->output, BLT_MediaPort);
+        return BLT_SUCCESS;
+    } else {
+        *port = NULL;
+        return BLT_ERROR_NO_SUCH_PORT;
+    }
+}
+
+/*----------------------------------------------------------------------
+|    LimiterFilter_UpdateSetting
++---------------------------------------------------------------------*/
+static void
+LimiterFilter_UpdateSetting(LimiterFilter*           self,
+                            ATX_CString              name,
+                            const ATX_PropertyValue* value)
+{
+    if (ATX_StringsEqual(name, BLT_LIMITER_FILTER_CEILING)) {
+        int ceiling = BLT_LIMITER_FILTER_DEFAULT_CEILING;
+        if (value && value->type == ATX_PROPERTY_VALUE_TYPE_INTEGER) {
+            ceiling = value->data.integer;
+        }
+        if (ceiling < BLT_LIMITER_FILTER_MIN_CEILING) ceiling = BLT_LIMITER_FILTER_MIN_CEILING;
+        if (ceiling > 0) ceiling = 0;
+        self->settings.ceiling = (float)pow(10.0, ((double)ceiling)/2000.0);
+    } else if (ATX_StringsEqual(name, BLT_LIMITER_FILTER_LOOK_AHEAD)) {
+        int look_ahead = BLT_LIMITER_FILTER_DEFAULT_LOOK_AHEAD;
+        if (value && value->type == ATX_PROPERTY_VALUE_TYPE_INTEGER) {
+            look_ahead = value->data.integer;
+        }
+        if (look_ahead < 1) look_ahead = 1;
+        if (look_ahead > BLT_LIMITER_FILTER_MAX_LOOK_AHEAD) look_ahead = BLT_LIMITER_FILTER_MAX_LOOK_AHEAD;
+        self->settings.look_ahead = (BLT_Cardinal)look_ahead;
+    } else if (ATX_StringsEqual(name, BLT_LIMITER_FILTER_RELEASE)) {
+        int release = BLT_LIMITER_FILTER_DEFAULT_RELEASE;
+        if (value && value->type == ATX_PROPERTY_VALUE_TYPE_INTEGER) {
+            release = value->data.integer;
+        }
+        if (release < 1) release = 1;
+        if (release > BLT_LIMITER_FILTER_MAX_RELEASE) release = BLT_LIMITER_FILTER_MAX_RELEASE;
+        self->settings.release = (BLT_Cardinal)release;
+        LimiterFilter_UpdateReleaseCoefficient(self);
+    } else if (ATX_StringsEqual(name, BLT_LIMITER_FILTER_INPUT_GAIN)) {
+        float gain = 1.0f;
+        if (value && value->type == ATX_PROPERTY_VALUE_TYPE_INTEGER) {
+            /* in 100th of decibels */
+            gain = (float)pow(10.0, ((double)value->data.integer)/2000.0);
+        } else if (value && value->type == ATX_PROPERTY_VALUE_TYPE_FLOAT) {
+            /* linear */
+            gain = value->data.fp;
+        }
+        if (gain < 0.0f) gain = 0.0f;
+        if (gain > BLT_LIMITER_FILTER_MAX_INPUT_GAIN) gain = BLT_LIMITER_FILTER_MAX_INPUT_GAIN;
+        self->settings.input_gain = gain;
+    } else if (ATX_StringsEqual(name, BLT_STREAM_PROPERTY_HANDOFF_GAIN)) {
+        float gain = 1.0f;
+        if (value && value->type == ATX_PROPERTY_VALUE_TYPE_FLOAT && value->data.fp > 1.0f) {
+            gain = value->data.fp;
+        }
+        if (gain > BLT_LIMITER_FILTER_MAX_INPUT_GAIN) gain = BLT_LIMITER_FILTER_MAX_INPUT_GAIN;
+        self->settings.handoff_gain = gain;
+    } else {
+        return;
+    }
+
+    ATX_LOG_FINE_1("LimiterFilter::UpdateSetting - %s", name);
+}
+
+/*----------------------------------------------------------------------
+|    LimiterFilter_Activate
++---------------------------------------------------------------------*/
+BLT_METHOD
+LimiterFilter_Activate(BLT_MediaNode* _self, BLT_Stream* stream)
+{
+    LimiterFilter* self = ATX_SELF_EX(LimiterFilter, BLT_BaseMediaNode, BLT_MediaNode);
+
+    /* keep a reference to the stream */
+    ATX_BASE(self, BLT_BaseMediaNode).context = stream;
+
+    /* listen to settings on the new stream */
+    if (stream) {
+        ATX_Properties* properties;
+        if (BLT_SUCCEEDED(BLT_Stream_GetProperties(ATX_BASE(self, BLT_BaseMediaNode).context,
+                                                   &properties))) {
+            static const char* const names[5] = {
+                BLT_LIMITER_FILTER_CEILING,
+                BLT_LIMITER_FILTER_LOOK_AHEAD,
+                BLT_LIMITER_FILTER_RELEASE,
+                BLT_LIMITER_FILTER_INPUT_GAIN,
+                BLT_STREAM_PROPERTY_HANDOFF_GAIN
+            };
+            ATX_PropertyListenerHandle* handles[5];
+            unsigned int                i;
+
+            handles[0] = &self->ceiling_listener_handle;
+            handles[1] = &self->look_ahead_listener_handle;
+            handles[2] = &self->release_listener_handle;
+            handles[3] = &self->input_gain_listener_handle;
+            handles[4] = &self->handoff_gain_listener_handle;
+            for (i=0; i<5; i++) {
+                ATX_PropertyValue property;
+                ATX_Properties_AddListener(properties,
+                                           names[i],
+                                           &ATX_BASE(self, ATX_PropertyListener),
+                                           handles[i]);
+
+                /* read the initial value */
+                if (ATX_SUCCEEDED(ATX_Properties_GetProperty(properties, names[i], &property))) {
+                    LimiterFilter_UpdateSetting(self, names[i], &property);
+                }
+            }
+        }
+
+        /* let the other nodes know that we're here */
+        LimiterFilter_PublishLatency(self, BLT_TRUE);
+        LimiterFilter_PublishHandoff(self, BLT_TRUE);
+    }
+
+    return BLT_SUCCESS;
+}
+
+/*----------------------------------------------------------------------
+|    LimiterFilter_Deactivate
++---------------------------------------------------------------------*/
+BLT_METHOD
+LimiterFilter_Deactivate(BLT_MediaNode* _self)
+{
+    LimiterFilter* self = ATX_SELF_EX(LimiterFilter, BLT_BaseMediaNode, BLT_MediaNode);
+
+    /* remove our listeners */
+    if (ATX_BASE(self, BLT_BaseMediaNode).context) {
+        ATX_Properties* properties;
+        if (BLT_SUCCEEDED(BLT_Stream_GetProperties(ATX_BASE(self, BLT_BaseMediaNode).context,
+                                                   &properties))) {
+            ATX_Properties_RemoveListener(properties, self->ceiling_listener_handle);
+            ATX_Properties_RemoveListener(properties, self->look_ahead_listener_handle);
+            ATX_Properties_RemoveListener(properties, self->release_listener_handle);
+            ATX_Properties_RemoveListener(properties, self->input_gain_listener_handle);
+            ATX_Properties_RemoveListener(properties, self->handoff_gain_listener_handle);
+        }
+        LimiterFilter_PublishLatency(self, BLT_FALSE);
+        LimiterFilter_PublishHandoff(self, BLT_FALSE);
+    }
+
+    /* we're detached from the stream */
+    ATX_BASE(self, BLT_BaseMediaNode).context = NULL;
+
+    return BLT_SUCCESS;
+}
+
+/*----------------------------------------------------------------------
+|    LimiterFilter_Seek
++---------------------------------------------------------------------*/
+BLT_METHOD
+LimiterFilter_Seek(BLT_MediaNode* _self,
+                   BLT_SeekMode*  mode,
+                   BLT_SeekPoint* point)
+{
+    LimiterFilter* self = ATX_SELF_EX(LimiterFilter, BLT_BaseMediaNode, BLT_MediaNode);
+
+    BLT_COMPILER_UNUSED(mode);
+    BLT_COMPILER_UNUSED(point);
+
+    /* discard everything we hold */
+    LimiterFilter_ClearOutput(self);
+    LimiterFilter_Restart(self);
+
+    return BLT_SUCCESS;
+}
+
+/*----------------------------------------------------------------------
+|   GetInterface implementation
++---------------------------------------------------------------------*/
+ATX_BEGIN_GET_INTERFACE_IMPLEMENTATION(LimiterFilter)
+    ATX_GET_INTERFACE_ACCEPT_EX(LimiterFilter, BLT_BaseMediaNode, BLT_MediaNode)
+    ATX_GET_INTERFACE_ACCEPT_EX(LimiterFilter, BLT_BaseMediaNode, ATX_Referenceable)
+    ATX_GET_INTERFACE_ACCEPT(LimiterFilter, ATX_PropertyListener)
+ATX_END_GET_INTERFACE_IMPLEMENTATION
+
+/*----------------------------------------------------------------------
+|    BLT_MediaNode interface
++---------------------------------------------------------------------*/
+ATX_BEGIN_INTERFACE_MAP_EX(LimiterFilter, BLT_BaseMediaNode, BLT_MediaNode)
+    BLT_BaseMediaNode_GetInfo,
+    LimiterFilter_GetPortByName,
+    LimiterFilter_Activate,
+    LimiterFilter_Deactivate,
+    BLT_BaseMediaNode_Start,
+    BLT_BaseMediaNode_Stop,
+    BLT_BaseMediaNode_Pause,
+    BLT_BaseMediaNode_Resume,
+    LimiterFilter_Seek
+};
+
+/*----------------------------------------------------------------------
+|    LimiterFilter_OnPropertyChanged
++---------------------------------------------------------------------*/
+BLT_VOID_METHOD
+LimiterFilter_OnPropertyChanged(ATX_PropertyListener*    _self,
+                                ATX_CString              name,
+                                const ATX_PropertyValue* value)
+{
+    LimiterFilter* self = ATX_SELF(LimiterFilter, ATX_PropertyListener);
+
+    if (name) LimiterFilter_UpdateSetting(self, name, value);
+}
+
+/*----------------------------------------------------------------------
+|    ATX_PropertyListener interface
++---------------------------------------------------------------------*/
+ATX_BEGIN_INTERFACE_MAP(LimiterFilter, ATX_PropertyListener)
+    LimiterFilter_OnPropertyChanged,
+};
+
+/*----------------------------------------------------------------------
+|   ATX_Referenceable interface
++---------------------------------------------------------------------*/
+ATX_IMPLEMENT_REFERENCEABLE_INTERFACE_EX(LimiterFilter,
+                                         BLT_BaseMediaNode,
+                                         reference_count)
+
+/*----------------------------------------------------------------------
+|   LimiterFilterModule_Probe
++---------------------------------------------------------------------*/
+BLT_METHOD
+LimiterFilterModule_Probe(BLT_Module*              self,
+                          BLT_Core*                core,
+                          BLT_ModuleParametersType parameters_type,
+                          BLT_AnyConst             parameters,
+                          BLT_Cardinal*            match)
+{
+    BLT_COMPILER_UNUSED(self);
+    BLT_COMPILER_UNUSED(core);
+
+    switch (parameters_type) {
+      case BLT_MODULE_PARAMETERS_TYPE_MEDIA_NODE_CONSTRUCTOR:
+        {
+            BLT_MediaNodeConstructor* constructor =
+                (BLT_MediaNodeConstructor*)parameters;
+
+            /* we need a name */
+            if (constructor->name == NULL ||
+                !ATX_StringsEqual(constructor->name, BLT_LIMITER_FILTER_MODULE_NAME)) {
+                return BLT_FAILURE;
+            }
+
+            /* the input and output protocols should be PACKET */
+            if ((constructor->spec.input.protocol  != BLT_MEDIA_PORT_PROTOCOL_ANY &&
+                 constructor->spec.input.protocol  != BLT_MEDIA_PORT_PROTOCOL_PACKET) ||
+                (constructor->spec.output.protocol != BLT_MEDIA_PORT_PROTOCOL_ANY &&
+                 constructor->spec.output.protocol != BLT_MEDIA_PORT_PROTOCOL_PACKET)) {
+                return BLT_FAILURE;
+            }
+
+            /* the input type should be unspecified, or audio/pcm */
+            if (!(constructor->spec.input.media_type->id == BLT_MEDIA_TYPE_ID_AUDIO_PCM) &&
+                !(constructor->spec.input.media_type->id == BLT_MEDIA_TYPE_ID_UNKNOWN)) {
+                return BLT_FAILURE;
+            }
+
+            /* the output type should be unspecified, or audio/pcm */
+            if (!(constructor->spec.output.media_type->id == BLT_MEDIA_TYPE_ID_AUDIO_PCM) &&
+                !(constructor->spec.output.media_type->id == BLT_MEDIA_TYPE_ID_UNKNOWN)) {
+                return BLT_FAILURE;
+            }
+
+            /* match level is always exact */
+            *match = BLT_MODULE_PROBE_MATCH_EXACT;
+
+            ATX_LOG_FINE_1("LimiterFilterModule::Probe - Ok [%d]", *match);
+            return BLT_SUCCESS;
+        }
+        break;
+
+      default:
+        break;
+    }
+
+    return BLT_FAILURE;
+}
+
+/*----------------------------------------------------------------------
+|   GetInterface implementation
++---------------------------------------------------------------------*/
+ATX_BEGIN_GET_INTERFACE_IMPLEMENTATION(LimiterFilterModule)
+    ATX_GET_INTERFACE_ACCEPT(LimiterFilterModule, BLT_Module)
+    ATX_GET_INTERFACE_ACCEPT(LimiterFilterModule, ATX_Referenceable)
+ATX_END_GET_INTERFACE_IMPLEMENTATION
+
+/*----------------------------------------------------------------------
+|   node factory
++---------------------------------------------------------------------*/
+BLT_MODULE_IMPLEMENT_SIMPLE_MEDIA_NODE_FACTORY(LimiterFilterModule, LimiterFilter)
+
+/*----------------------------------------------------------------------
+|   BLT_Module interface
++---------------------------------------------------------------------*/
+ATX_BEGIN_INTERFACE_MAP(LimiterFilterModule, BLT_Module)
+    BLT_BaseModule_GetInfo,
+    BLT_BaseModule_Attach,
+    LimiterFilterModule_CreateInstance,
+    LimiterFilterModule_Probe
+ATX_END_INTERFACE_MAP
+
+/*----------------------------------------------------------------------
+|   ATX_Referenceable interface
++---------------------------------------------------------------------*/
+#define LimiterFilterModule_Destroy(x) \
+    BLT_BaseModule_Destroy((BLT_BaseModule*)(x))
+
+ATX_IMPLEMENT_REFERENCEABLE_INTERFACE(LimiterFilterModule, reference_count)
+
+/*----------------------------------------------------------------------
+|   module object
++---------------------------------------------------------------------*/
+BLT_MODULE_IMPLEMENT_STANDARD_GET_MODULE(LimiterFilterModule,
+                                         "Limiter Filter",
+                                         BLT_LIMITER_FILTER_MODULE_NAME,
+                                         "1.0.0",
+                                         BLT_MODULE_AXIOMATIC_COPYRIGHT)
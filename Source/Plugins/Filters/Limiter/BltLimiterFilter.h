@@ -0,0 +1,90 @@
+/*****************************************************************
+|
+|   Limiter Filter Module
+|
+|   (c) 2002-2012 Gilles Boccon-Gibod
+|   Author: Gilles Boccon-Gibod (bok@bok.net)
+|
+ ****************************************************************/
+
+#ifndef _BLT_LIMITER_FILTER_H_
+#define _BLT_LIMITER_FILTER_H_
+
+/**
+ * @ingroup plugin_modules
+ * @ingroup plugin_filter_modules
+ * @defgroup limiter_filter_module Limiter Filter Module
+ * Plugin module that creates media nodes that limit the true peak level
+ * of PCM audio data.
+ * These media nodes expect media packets with PCM audio as input,
+ * and produce media packets with PCM audio as output.
+ * The audio is delayed by a short look-ahead window, so that the gain
+ * can be reduced smoothly before a peak rather than clipping it. Peaks
+ * are measured on a 4x oversampled signal, so that peaks between samples
+ * are also kept under the ceiling.
+ * The time stamps of the output packets are those of the audio they
+ * carry, and the delay is reported as the latency of the stream and
+ * decoder status (see BLT_STREAM_PROPERTY_LATENCY).
+ * 8 to 32 bit integer, as well as 32 bit float PCM are supported,
+ * with up to 8 channels. Other formats pass through unmodified.
+ *
+ * While a limiter node is active, it announces itself with
+ * BLT_STREAM_PROPERTY_GAIN_HANDOFF, and a gain control filter node in
+ * the same stream does not amplify the audio itself, but hands the
+ * amplification over to the limiter through
+ * BLT_STREAM_PROPERTY_HANDOFF_GAIN, so that ReplayGain and volume
+ * boosts never clip. The handed over gain is applied on top of
+ * BLT_LIMITER_FILTER_INPUT_GAIN.
+ *
+ * @{
+ */
+
+/*----------------------------------------------------------------------
+|   includes
++---------------------------------------------------------------------*/
+#include "BltTypes.h"
+#include "BltModule.h"
+
+/*----------------------------------------------------------------------
+|   constants
++---------------------------------------------------------------------*/
+/**
+ * Stream property for the ceiling, in 100th of dBTP (integer).
+ * Defaults to -100 (-1 dBTP).
+ */
+#define BLT_LIMITER_FILTER_CEILING    "Plugins.LimiterFilter.Ceiling"
+
+/**
+ * Stream property for the look-ahead window, in milliseconds (integer).
+ * Defaults to 5. Changes take effect after the next seek, or at the
+ * start of the next stream.
+ */
+#define BLT_LIMITER_FILTER_LOOK_AHEAD "Plugins.LimiterFilter.LookAhead"
+
+/**
+ * Stream property for the release time, in milliseconds (integer).
+ * Defaults to 100.
+ */
+#define BLT_LIMITER_FILTER_RELEASE    "Plugins.LimiterFilter.Release"
+
+/**
+ * Stream property for a gain applied before limiting. Integer values are
+ * in 100th of decibels, floating point values are linear factors.
+ */
+#define BLT_LIMITER_FILTER_INPUT_GAIN "Plugins.LimiterFilter.InputGain"
+
+/**
+ * Stream property set by the limiter while it is active: the delay it
+ * adds to the audio, in milliseconds (integer). This is its share of
+ * BLT_STREAM_PROPERTY_LATENCY.
+ */
+#define BLT_LIMITER_FILTER_LATENCY    "Plugins.LimiterFilter.Latency"
+
+/*----------------------------------------------------------------------
+|   module
++---------------------------------------------------------------------*/
+BLT_Result BLT_LimiterFilterModule_GetModuleObject(BLT_Module** module);
+
+/** @} */
+
+#endif /* _BLT_LIMITER_FILTER_H_ */
@@ -0,0 +1,723 @@
+/*****************************************************************
+|
+|   Loudness Analyzer Filter Module
+|
+|   (c) 2002-2012 Gilles Boccon-Gibod
+|   Author: Gilles Boccon-Gibod (bok@bok.net)
+|
+ ****************************************************************/
+
+/*----------------------------------------------------------------------
+|   includes
++---------------------------------------------------------------------*/
+#include <math.h>
+
+#include "Atomix.h"
+#include "BltConfig.h"
+#include "BltCore.h"
+#include "BltLoudnessAnalyzerFilter.h"
+#include "BltLoudness.h"
+#include "BltPcmFloat.h"
+#include "BltMediaNode.h"
+#include "BltMedia.h"
+#include "BltPcm.h"
+#include "BltPacketProducer.h"
+#include "BltPacketConsumer.h"
+#include "BltStream.h"
+
+/*----------------------------------------------------------------------
+|   logging
++---------------------------------------------------------------------*/
+ATX_SET_LOCAL_LOGGER("bluetune.plugins.filters.loudness-analyzer")
+
+/*----------------------------------------------------------------------
+|    constants
++---------------------------------------------------------------------*/
+#define BLT_LOUDNESS_ANALYZER_FILTER_MODULE_NAME "com.axiosys.filter.loudness-analyzer"
+
+#define BLT_LOUDNESS_ANALYZER_FILTER_BLOCK_SIZE         256 /* frames          */
+#define BLT_LOUDNESS_ANALYZER_FILTER_INTEGRATED_PERIOD  10  /* 100ms sub-blocks */
+
+/*----------------------------------------------------------------------
+|    types
++---------------------------------------------------------------------*/
+typedef BLT_BaseModule LoudnessAnalyzerFilterModule;
+
+typedef struct {
+    /* interfaces */
+    ATX_IMPLEMENTS(BLT_MediaPort);
+    ATX_IMPLEMENTS(BLT_PacketConsumer);
+} LoudnessAnalyzerFilterInput;
+
+typedef struct {
+    /* interfaces */
+    ATX_IMPLEMENTS(BLT_MediaPort);
+    ATX_IMPLEMENTS(BLT_PacketProducer);
+
+    /* members */
+    BLT_MediaPacket* packet;
+} LoudnessAnalyzerFilterOutput;
+
+typedef struct {
+    /* base class */
+    ATX_EXTENDS(BLT_BaseMediaNode);
+
+    /* interfaces */
+    ATX_IMPLEMENTS(ATX_PropertyListener);
+
+    /* members */
+    LoudnessAnalyzerFilterInput  input;
+    LoudnessAnalyzerFilterOutput output;
+    BLT_Boolean                  batch;
+    BLT_Boolean                  configured;
+    BLT_Boolean                  complete;     /* measuring since the start */
+    BLT_PcmMediaType             format;
+    BLT_Cardinal                 published_block_count;
+    BLT_LoudnessMeter            meter;
+    float                        samples[BLT_LOUDNESS_ANALYZER_FILTER_BLOCK_SIZE*
+                                         BLT_LOUDNESS_METER_MAX_CHANNELS];
+    ATX_PropertyListenerHandle   batch_listener_handle;
+} LoudnessAnalyzerFilter;
+
+/*----------------------------------------------------------------------
+|   forward declarations
++---------------------------------------------------------------------*/
+ATX_DECLARE_INTERFACE_MAP(LoudnessAnalyzerFilterModule, BLT_Module)
+ATX_DECLARE_INTERFACE_MAP(LoudnessAnalyzerFilter, BLT_MediaNode)
+ATX_DECLARE_INTERFACE_MAP(LoudnessAnalyzerFilter, ATX_Referenceable)
+ATX_DECLARE_INTERFACE_MAP(LoudnessAnalyzerFilter, ATX_PropertyListener)
+
+/*----------------------------------------------------------------------
+|    LoudnessAnalyzerFilter_SetProperty
++---------------------------------------------------------------------*/
+static void
+LoudnessAnalyzerFilter_SetProperty(ATX_Properties* properties,
+                                   const char*     name,
+                                   double          value,
+                                   BLT_Boolean     valid)
+{
+    ATX_PropertyValue property;
+
+    if (!valid) {
+        ATX_Properties_SetProperty(properties, name, NULL);
+        return;
+    }
+
+    /* in 100th of LU or dB */
+    property.type         = ATX_PROPERTY_VALUE_TYPE_INTEGER;
+    property.data.integer = (ATX_Int32)floor(value*100.0+0.5);
+    ATX_Properties_SetProperty(properties, name, &property);
+}
+
+/*----------------------------------------------------------------------
+|    LoudnessAnalyzerFilter_Publish
++---------------------------------------------------------------------*/
+static void
+LoudnessAnalyzerFilter_Publish(LoudnessAnalyzerFilter* self, BLT_Boolean end_of_stream)
+{
+    ATX_Properties* properties;
+    double          loudness = 0.0;
+    BLT_Result      result;
+    float           peak;
+
+    if (ATX_BASE(self, BLT_BaseMediaNode).context == NULL) return;
+    if (BLT_FAILED(BLT_Stream_GetProperties(ATX_BASE(self, BLT_BaseMediaNode).context,
+                                            &properties))) {
+        return;
+    }
+
+    if (!self->batch) {
+        result = BLT_LoudnessMeter_GetMomentary(&self->meter, &loudness);
+        LoudnessAnalyzerFilter_SetProperty(properties,
+                                           BLT_LOUDNESS_ANALYZER_FILTER_MOMENTARY,
+                                           loudness,
+                                           BLT_SUCCEEDED(result));
+        result = BLT_LoudnessMeter_GetShortTerm(&self->meter, &loudness);
+        LoudnessAnalyzerFilter_SetProperty(properties,
+                                           BLT_LOUDNESS_ANALYZER_FILTER_SHORT_TERM,
+                                           loudness,
+                                           BLT_SUCCEEDED(result));
+    }
+
+    /* the gated loudness is more expensive, and changes slowly */
+    if (end_of_stream ||
+        self->meter.block_count >= self->published_block_count+BLT_LOUDNESS_ANALYZER_FILTER_INTEGRATED_PERIOD) {
+        self->published_block_count = self->meter.block_count;
+
+        peak = BLT_LoudnessMeter_GetTruePeak(&self->meter);
+        LoudnessAnalyzerFilter_SetProperty(properties,
+                                           BLT_LOUDNESS_ANALYZER_FILTER_TRUE_PEAK,
+                                           peak > 0.0f ? 20.0*log10(peak) : 0.0,
+                                           peak > 0.0f);
+        result = BLT_LoudnessMeter_GetIntegrated(&self->meter, &loudness);
+        LoudnessAnalyzerFilter_SetProperty(properties,
+                                           BLT_LOUDNESS_ANALYZER_FILTER_INTEGRATED,
+                                           loudness,
+                                           BLT_SUCCEEDED(result));
+
+        /* the track gain only makes sense for a complete measurement */
+        if (end_of_stream && self->complete && BLT_SUCCEEDED(result)) {
+            LoudnessAnalyzerFilter_SetProperty(properties,
+                                               BLT_LOUDNESS_ANALYZER_FILTER_TRACK_GAIN,
+                                               BLT_LOUDNESS_REPLAY_GAIN_REFERENCE-loudness,
+                                               BLT_TRUE);
+            ATX_LOG_FINE_2("LoudnessAnalyzerFilter::Publish - integrated = %d, peak = %d",
+                           (int)(loudness*100.0), (int)(peak*100000.0f));
+        }
+    }
+}
+
+/*----------------------------------------------------------------------
+|    LoudnessAnalyzerFilter_Reset
++---------------------------------------------------------------------*/
+static void
+LoudnessAnalyzerFilter_Reset(LoudnessAnalyzerFilter* self, BLT_Boolean complete)
+{
+    if (self->configured) BLT_LoudnessMeter_Reset(&self->meter);
+    self->complete              = complete;
+    self->published_block_count = 0;
+}
+
+/*----------------------------------------------------------------------
+|    LoudnessAnalyzerFilter_Analyze
++---------------------------------------------------------------------*/
+static void
+LoudnessAnalyzerFilter_Analyze(LoudnessAnalyzerFilter* self,
+                               const unsigned char*    payload,
+                               BLT_Cardinal            frame_count)
+{
+    BLT_Cardinal channel_count = self->format.channel_count;
+    BLT_Size     frame_size    = channel_count*self->format.bits_per_sample/8;
+    BLT_Cardinal block_count   = self->meter.block_count;
+
+    while (frame_count) {
+        BLT_Cardinal chunk = frame_count;
+        if (chunk > BLT_LOUDNESS_ANALYZER_FILTER_BLOCK_SIZE) {
+            chunk = BLT_LOUDNESS_ANALYZER_FILTER_BLOCK_SIZE;
+        }
+
+        BLT_PcmFloat_Import(&self->format, payload, chunk*channel_count, self->samples);
+        BLT_LoudnessMeter_Process(&self->meter, self->samples, chunk);
+
+        payload     += chunk*frame_size;
+        frame_count -= chunk;
+    }
+
+    /* publish at most once per packet, when a sub-block was completed */
+    if (!self->batch && self->meter.block_count != block_count) {
+        LoudnessAnalyzerFilter_Publish(self, BLT_FALSE);
+    }
+}
+
+/*----------------------------------------------------------------------
+|    LoudnessAnalyzerFilterInput_PutPacket
++---------------------------------------------------------------------*/
+BLT_METHOD
+LoudnessAnalyzerFilterInput_PutPacket(BLT_PacketConsumer* _self,
+                                      BLT_MediaPacket*    packet)
+{
+    LoudnessAnalyzerFilter* self = ATX_SELF_M(input, LoudnessAnalyzerFilter, BLT_PacketConsumer);
+    BLT_PcmMediaType*       media_type;
+    BLT_Flags               flags;
+    BLT_Result              result;
+
+    /* get the media type */
+    result = BLT_MediaPacket_GetMediaType(packet, (const BLT_MediaType**)(const void*)&media_type);
+    if (BLT_FAILED(result)) return result;
+
+    /* check the media type */
+    if (media_type->base.id != BLT_MEDIA_TYPE_ID_AUDIO_PCM) {
+        return BLT_ERROR_INVALID_MEDIA_TYPE;
+    }
+
+    /* keep the packet, it passes through unmodified */
+    self->output.packet = packet;
+    BLT_MediaPacket_AddReference(packet);
+
+    /* formats that we can't measure are ignored */
+    if (!BLT_PcmFloat_SupportsFormat(media_type) ||
+        media_type->channel_count > BLT_LOUDNESS_METER_MAX_CHANNELS ||
+        media_type->sample_rate == 0) {
+        self->complete = BLT_FALSE;
+        return BLT_SUCCESS;
+    }
+
+    /* a new format starts a new measurement */
+    flags = BLT_MediaPacket_GetFlags(packet);
+    if (!self->configured ||
+        self->format.sample_rate     != media_type->sample_rate     ||
+        self->format.channel_count   != media_type->channel_count   ||
+        self->format.channel_mask    != media_type->channel_mask    ||
+        self->format.bits_per_sample != media_type->bits_per_sample ||
+        self->format.sample_format   != media_type->sample_format) {
+        result = BLT_LoudnessMeter_Init(&self->meter,
+                                        media_type->sample_rate,
+                                        media_type->channel_count,
+                                        media_type->channel_mask);
+        if (BLT_FAILED(result)) {
+            self->configured = BLT_FALSE;
+            return BLT_SUCCESS;
+        }
+        self->format                = *media_type;
+        self->configured            = BLT_TRUE;
+        self->complete              = (flags & BLT_MEDIA_PACKET_FLAG_START_OF_STREAM)?BLT_TRUE:BLT_FALSE;
+        self->published_block_count = 0;
+    } else if (flags & BLT_MEDIA_PACKET_FLAG_START_OF_STREAM) {
+        LoudnessAnalyzerFilter_Reset(self, BLT_TRUE);
+    }
+
+    /* measure */
+    LoudnessAnalyzerFilter_Analyze(self,
+                                   (const unsigned char*)BLT_MediaPacket_GetPayloadBuffer(packet),
+                                   BLT_MediaPacket_GetPayloadSize(packet)/
+                                   (media_type->channel_count*media_type->bits_per_sample/8));
+
+    /* final results */
+    if (flags & BLT_MEDIA_PACKET_FLAG_END_OF_STREAM) {
+        LoudnessAnalyzerFilter_Publish(self, BLT_TRUE);
+        LoudnessAnalyzerFilter_Reset(self, BLT_FALSE);
+    }
+
+    return BLT_SUCCESS;
+}
+
+/*----------------------------------------------------------------------
+|   LoudnessAnalyzerFilterInput_QueryMediaType
++---------------------------------------------------------------------*/
+BLT_METHOD
+LoudnessAnalyzerFilterInput_QueryMediaType(BLT_MediaPort*         self,
+                                           BLT_Ordinal            index,
+                                           const BLT_MediaType**  media_type)
+{
+    BLT_COMPILER_UNUSED(self);
+    if (index == 0) {
+        *media_type = &BLT_GenericPcmMediaType;
+        return BLT_SUCCESS;
+    } else {
+        *media_type = NULL;
+        return BLT_FAILURE;
+    }
+}
+
+/*----------------------------------------------------------------------
+|   GetInterface implementation
++---------------------------------------------------------------------*/
+ATX_BEGIN_GET_INTERFACE_IMPLEMENTATION(LoudnessAnalyzerFilterInput)
+    ATX_GET_INTERFACE_ACCEPT(LoudnessAnalyzerFilterInput, BLT_MediaPort)
+    ATX_GET_INTERFACE_ACCEPT(LoudnessAnalyzerFilterInput, BLT_PacketConsumer)
+ATX_END_GET_INTERFACE_IMPLEMENTATION
+
+/*----------------------------------------------------------------------
+|    BLT_PacketConsumer interface
++---------------------------------------------------------------------*/
+ATX_BEGIN_INTERFACE_MAP(LoudnessAnalyzerFilterInput, BLT_PacketConsumer)
+    LoudnessAnalyzerFilterInput_PutPacket
+ATX_END_INTERFACE_MAP
+
+/*----------------------------------------------------------------------
+|    BLT_MediaPort interface
++---------------------------------------------------------------------*/
+BLT_MEDIA_PORT_IMPLEMENT_SIMPLE_TEMPLATE(LoudnessAnalyzerFilterInput,
+                                         "input",
+                                         PACKET,
+                                         IN)
+ATX_BEGIN_INTERFACE_MAP(LoudnessAnalyzerFilterInput, BLT_MediaPort)
+    LoudnessAnalyzerFilterInput_GetName,
+    LoudnessAnalyzerFilterInput_GetProtocol,
+    LoudnessAnalyzerFilterInput_GetDirection,
+    LoudnessAnalyzerFilterInput_QueryMediaType
+ATX_END_INTERFACE_MAP
+
+/*----------------------------------------------------------------------
+|    LoudnessAnalyzerFilterOutput_GetPacket
++---------------------------------------------------------------------*/
+BLT_METHOD
+LoudnessAnalyzerFilterOutput_GetPacket(BLT_PacketProducer* _self,
+                                       BLT_MediaPacket**   packet)
+{
+    LoudnessAnalyzerFilter* self = ATX_SELF_M(output, LoudnessAnalyzerFilter, BLT_PacketProducer);
+
+    if (self->output.packet) {
+        *packet = self->output.packet;
+        self->output.packet = NULL;
+        return BLT_SUCCESS;
+    } else {
+        *packet = NULL;
+        return BLT_ERROR_PORT_HAS_NO_DATA;
+    }
+}
+
+/*----------------------------------------------------------------------
+|   LoudnessAnalyzerFilterOutput_QueryMediaType
++---------------------------------------------------------------------*/
+BLT_METHOD
+LoudnessAnalyzerFilterOutput_QueryMediaType(BLT_MediaPort*         self,
+                                            BLT_Ordinal            index,
+                                            const BLT_MediaType**  media_type)
+{
+    BLT_COMPILER_UNUSED(self);
+    if (index == 0) {
+        *media_type = &BLT_GenericPcmMediaType;
+        return BLT_SUCCESS;
+    } else {
+        *media_type = NULL;
+        return BLT_FAILURE;
+    }
+}
+
+/*----------------------------------------------------------------------
+|   GetInterface implementation
++---------------------------------------------------------------------*/
+ATX_BEGIN_GET_INTERFACE_IMPLEMENTATION(LoudnessAnalyzerFilterOutput)
+    ATX_GET_INTERFACE_ACCEPT(LoudnessAnalyzerFilterOutput, BLT_MediaPort)
+    ATX_GET_INTERFACE_ACCEPT(LoudnessAnalyzerFilterOutput, BLT_PacketProducer)
+ATX_END_GET_INTERFACE_IMPLEMENTATION
+
+/*----------------------------------------------------------------------
+|    BLT_MediaPort interface
++---------------------------------------------------------------------*/
+BLT_MEDIA_PORT_IMPLEMENT_SIMPLE_TEMPLATE(LoudnessAnalyzerFilterOutput,
+                                         "output",
+                                         PACKET,
+                                         OUT)
+ATX_BEGIN_INTERFACE_MAP(LoudnessAnalyzerFilterOutput, BLT_MediaPort)
+    LoudnessAnalyzerFilterOutput_GetName,
+    LoudnessAnalyzerFilterOutput_GetProtocol,
+    LoudnessAnalyzerFilterOutput_GetDirection,
+    LoudnessAnalyzerFilterOutput_QueryMediaType
+ATX_END_INTERFACE_MAP
+
+/*----------------------------------------------------------------------
+|    BLT_PacketProducer interface
++---------------------------------------------------------------------*/
+ATX_BEGIN_INTERFACE_MAP(LoudnessAnalyzerFilterOutput, BLT_PacketProducer)
+    LoudnessAnalyzerFilterOutput_GetPacket
+ATX_END_INTERFACE_MAP
+
+/*----------------------------------------------------------------------
+|    LoudnessAnalyzerFilter_Create
++---------------------------------------------------------------------*/
+static BLT_Result
+LoudnessAnalyzerFilter_Create(BLT_Module*              module,
+                              BLT_Core*                core,
+                              BLT_ModuleParametersType parameters_type,
+                              BLT_AnyConst             parameters,
+                              BLT_MediaNode**          object)
+{
+    LoudnessAnalyzerFilter* self;
+
+    ATX_LOG_FINE("LoudnessAnalyzerFilter::Create");
+
+    /* check parameters */
+    if (parameters == NULL ||
+        parameters_type != BLT_MODULE_PARAMETERS_TYPE_MEDIA_NODE_CONSTRUCTOR) {
+        return BLT_ERROR_INVALID_PARAMETERS;
+    }
+
+    /* allocate memory for the object */
+    self = ATX_AllocateZeroMemory(sizeof(LoudnessAnalyzerFilter));
+    if (self == NULL) {
+        *object = NULL;
+        return BLT_ERROR_OUT_OF_MEMORY;
+    }
+
+    /* construct the inherited object */
+    BLT_BaseMediaNode_Construct(&ATX_BASE(self, BLT_BaseMediaNode), module, core);
+
+    /* setup interfaces */
+    ATX_SET_INTERFACE_EX(self, LoudnessAnalyzerFilter, BLT_BaseMediaNode, BLT_MediaNode);
+    ATX_SET_INTERFACE_EX(self, LoudnessAnalyzerFilter, BLT_BaseMediaNode, ATX_Referenceable);
+    ATX_SET_INTERFACE(self, LoudnessAnalyzerFilter, ATX_PropertyListener);
+    ATX_SET_INTERFACE(&self->input,  LoudnessAnalyzerFilterInput,  BLT_MediaPort);
+    ATX_SET_INTERFACE(&self->input,  LoudnessAnalyzerFilterInput,  BLT_PacketConsumer);
+    ATX_SET_INTERFACE(&self->output, LoudnessAnalyzerFilterOutput, BLT_MediaPort);
+    ATX_SET_INTERFACE(&self->output, LoudnessAnalyzerFilterOutput, BLT_PacketProducer);
+    *object = &ATX_BASE_EX(self, BLT_BaseMediaNode, BLT_MediaNode);
+
+    return BLT_SUCCESS;
+}
+
+/*----------------------------------------------------------------------
+|    LoudnessAnalyzerFilter_Destroy
++---------------------------------------------------------------------*/
+static BLT_Result
+LoudnessAnalyzerFilter_Destroy(LoudnessAnalyzerFilter* self)
+{
+    ATX_LOG_FINE("LoudnessAnalyzerFilter::Destroy");
+
+    /* release any input packet we may hold */
+    if (self->output.packet) {
+        BLT_MediaPacket_Release(self->output.packet);
+    }
+
+    /* destruct the inherited object */
+    BLT_BaseMediaNode_Destruct(&ATX_BASE(self, BLT_BaseMediaNode));
+
+    /* free the object memory */
+    ATX_FreeMemory((void*)self);
+
+    return BLT_SUCCESS;
+}
+
+/*----------------------------------------------------------------------
+|   LoudnessAnalyzerFilter_GetPortByName
++---------------------------------------------------------------------*/
+BLT_METHOD
+LoudnessAnalyzerFilter_GetPortByName(BLT_MediaNode*  _self,
+                                     BLT_CString     name,
+                                     BLT_MediaPort** port)
+{
+    LoudnessAnalyzerFilter* self = ATX_SELF_EX(LoudnessAnalyzerFilter, BLT_BaseMediaNode, BLT_MediaNode);
+
+    if (ATX_StringsEqual(name, "input")) {
+        *port = &ATX_BASE(&self->input, BLT_MediaPort);
+        return BLT_SUCCESS;
+    } else if (ATX_StringsEqual(name, "output")) {
+        *port = &ATX_BASE(&self->output, BLT_MediaPort);
+        return BLT_SUCCESS;
+    } else {
+        *port = NULL;
+        return BLT_ERROR_NO_SUCH_PORT;
+    }
+}
+
+/*----------------------------------------------------------------------
+|    LoudnessAnalyzerFilter_Activate
++---------------------------------------------------------------------*/
+BLT_METHOD
+LoudnessAnalyzerFilter_Activate(BLT_MediaNode* _self, BLT_Stream* stream)
+{
+    LoudnessAnalyzerFilter* self = ATX_SELF_EX(LoudnessAnalyzerFilter, BLT_BaseMediaNode, BLT_MediaNode);
+
+    /* keep a reference to the stream */
+    ATX_BASE(self, BLT_BaseMediaNode).context = stream;
+
+    /* listen to core properties */
+    if (stream) {
+        ATX_Properties* properties;
+        if (BLT_SUCCEEDED(BLT_Core_GetProperties(ATX_BASE(self, BLT_BaseMediaNode).core, &properties))) {
+            ATX_PropertyValue property;
+            ATX_Properties_AddListener(properties,
+                                       BLT_LOUDNESS_ANALYZER_FILTER_BATCH,
+                                       &ATX_BASE(self, ATX_PropertyListener),
+                                       &self->batch_listener_handle);
+
+            /* read the initial value of the property */
+            self->batch = BLT_FALSE;
+            if (ATX_SUCCEEDED(ATX_Properties_GetProperty(properties,
+                                                         BLT_LOUDNESS_ANALYZER_FILTER_BATCH,
+                                                         &property)) &&
+                property.type == ATX_PROPERTY_VALUE_TYPE_INTEGER) {
+                self->batch = property.data.integer?BLT_TRUE:BLT_FALSE;
+            }
+        }
+    }
+
+    return BLT_SUCCESS;
+}
+
+/*----------------------------------------------------------------------
+|    LoudnessAnalyzerFilter_Deactivate
++---------------------------------------------------------------------*/
+BLT_METHOD
+LoudnessAnalyzerFilter_Deactivate(BLT_MediaNode* _self)
+{
+    LoudnessAnalyzerFilter* self = ATX_SELF_EX(LoudnessAnalyzerFilter, BLT_BaseMediaNode, BLT_MediaNode);
+
+    /* reset */
+    self->batch = BLT_FALSE;
+
+    /* remove our listener */
+    if (ATX_BASE(self, BLT_BaseMediaNode).context) {
+        ATX_Properties* properties;
+        if (BLT_SUCCEEDED(BLT_Core_GetProperties(ATX_BASE(self, BLT_BaseMediaNode).core, &properties))) {
+            ATX_Properties_RemoveListener(properties, self->batch_listener_handle);
+        }
+    }
+
+    /* we're detached from the stream */
+    ATX_BASE(self, BLT_BaseMediaNode).context = NULL;
+
+    return BLT_SUCCESS;
+}
+
+/*----------------------------------------------------------------------
+|    LoudnessAnalyzerFilter_Seek
++---------------------------------------------------------------------*/
+BLT_METHOD
+LoudnessAnalyzerFilter_Seek(BLT_MediaNode* _self,
+                            BLT_SeekMode*  mode,
+                            BLT_SeekPoint* point)
+{
+    LoudnessAnalyzerFilter* self = ATX_SELF_EX(LoudnessAnalyzerFilter, BLT_BaseMediaNode, BLT_MediaNode);
+
+    BLT_COMPILER_UNUSED(mode);
+    BLT_COMPILER_UNUSED(point);
+
+    if (self->output.packet) {
+        BLT_MediaPacket_Release(self->output.packet);
+        self->output.packet = NULL;
+    }
+
+    /* what follows is not the whole stream anymore */
+    LoudnessAnalyzerFilter_Reset(self, BLT_FALSE);
+
+    return BLT_SUCCESS;
+}
+
+/*----------------------------------------------------------------------
+|   GetInterface implementation
++---------------------------------------------------------------------*/
+ATX_BEGIN_GET_INTERFACE_IMPLEMENTATION(LoudnessAnalyzerFilter)
+    ATX_GET_INTERFACE_ACCEPT_EX(LoudnessAnalyzerFilter, BLT_BaseMediaNode, BLT_MediaNode)
+    ATX_GET_INTERFACE_ACCEPT_EX(LoudnessAnalyzerFilter, BLT_BaseMediaNode, ATX_Referenceable)
+    ATX_GET_INTERFACE_ACCEPT(LoudnessAnalyzerFilter, ATX_PropertyListener)
+ATX_END_GET_INTERFACE_IMPLEMENTATION
+
+/*----------------------------------------------------------------------
+|    BLT_MediaNode interface
++---------------------------------------------------------------------*/
+ATX_BEGIN_INTERFACE_MAP_EX(LoudnessAnalyzerFilter, BLT_BaseMediaNode, BLT_MediaNode)
+    BLT_BaseMediaNode_GetInfo,
+    LoudnessAnalyzerFilter_GetPortByName,
+    LoudnessAnalyzerFilter_Activate,
+    LoudnessAnalyzerFilter_Deactivate,
+    BLT_BaseMediaNode_Start,
+    BLT_BaseMediaNode_Stop,
+    BLT_BaseMediaNode_Pause,
+    BLT_BaseMediaNode_Resume,
+    LoudnessAnalyzerFilter_Seek
+};
+
+/*----------------------------------------------------------------------
+|    LoudnessAnalyzerFilter_OnPropertyChanged
++---------------------------------------------------------------------*/
+BLT_VOID_METHOD
+LoudnessAnalyzerFilter_OnPropertyChanged(ATX_PropertyListener*    _self,
+                                         ATX_CString              name,
+                                         const ATX_PropertyValue* value)
+{
+    LoudnessAnalyzerFilter* self = ATX_SELF(LoudnessAnalyzerFilter, ATX_PropertyListener);
+
+    if (name && ATX_StringsEqual(name, BLT_LOUDNESS_ANALYZER_FILTER_BATCH)) {
+        if (value && value->type == ATX_PROPERTY_VALUE_TYPE_INTEGER) {
+            self->batch = value->data.integer?BLT_TRUE:BLT_FALSE;
+        } else {
+            self->batch = BLT_FALSE;
+        }
+    }
+}
+
+/*----------------------------------------------------------------------
+|    ATX_PropertyListener interface
++---------------------------------------------------------------------*/
+ATX_BEGIN_INTERFACE_MAP(LoudnessAnalyzerFilter, ATX_PropertyListener)
+    LoudnessAnalyzerFilter_OnPropertyChanged,
+};
+
+/*----------------------------------------------------------------------
+|   ATX_Referenceable interface
++---------------------------------------------------------------------*/
+ATX_IMPLEMENT_REFERENCEABLE_INTERFACE_EX(LoudnessAnalyzerFilter,
+                                         BLT_BaseMediaNode,
+                                         reference_count)
+
+/*----------------------------------------------------------------------
+|   LoudnessAnalyzerFilterModule_Probe
++---------------------------------------------------------------------*/
+BLT_METHOD
+LoudnessAnalyzerFilterModule_Probe(BLT_Module*              self,
+                                   BLT_Core*                core,
+                                   BLT_ModuleParametersType parameters_type,
+                                   BLT_AnyConst             parameters,
+                                   BLT_Cardinal*            match)
+{
+    BLT_COMPILER_UNUSED(self);
+    BLT_COMPILER_UNUSED(core);
+
+    switch (parameters_type) {
+      case BLT_MODULE_PARAMETERS_TYPE_MEDIA_NODE_CONSTRUCTOR:
+        {
+            BLT_MediaNodeConstructor* constructor =
+                (BLT_MediaNodeConstructor*)parameters;
+
+            /* we need a name */
+            if (constructor->name == NULL ||
+                !ATX_StringsEqual(constructor->name, BLT_LOUDNESS_ANALYZER_FILTER_MODULE_NAME)) {
+                return BLT_FAILURE;
+            }
+
+            /* the input and output protocols should be PACKET */
+            if ((constructor->spec.input.protocol  != BLT_MEDIA_PORT_PROTOCOL_ANY &&
+                 constructor->spec.input.protocol  != BLT_MEDIA_PORT_PROTOCOL_PACKET) ||
+                (constructor->spec.output.protocol != BLT_MEDIA_PORT_PROTOCOL_ANY &&
+                 constructor->spec.output.protocol != BLT_MEDIA_PORT_PROTOCOL_PACKET)) {
+                return BLT_FAILURE;
+            }
+
+            /* the input type should be unspecified, or audio/pcm */
+            if (!(constructor->spec.input.media_type->id == BLT_MEDIA_TYPE_ID_AUDIO_PCM) &&
+                !(constructor->spec.input.media_type->id == BLT_MEDIA_TYPE_ID_UNKNOWN)) {
+                return BLT_FAILURE;
+            }
+
+            /* the output type should be unspecified, or audio/pcm */
+            if (!(constructor->spec.output.media_type->id == BLT_MEDIA_TYPE_ID_AUDIO_PCM) &&
+                !(constructor->spec.output.media_type->id == BLT_MEDIA_TYPE_ID_UNKNOWN)) {
+                return BLT_FAILURE;
+            }
+
+            /* match level is always exact */
+            *match = BLT_MODULE_PROBE_MATCH_EXACT;
+
+            ATX_LOG_FINE_1("LoudnessAnalyzerFilterModule::Probe - Ok [%d]", *match);
+            return BLT_SUCCESS;
+        }
+        break;
+
+      default:
+        break;
+    }
+
+    return BLT_FAILURE;
+}
+
+/*----------------------------------------------------------------------
+|   GetInterface implementation
++---------------------------------------------------------------------*/
+ATX_BEGIN_GET_INTERFACE_IMPLEMENTATION(LoudnessAnalyzerFilterModule)
+    ATX_GET_INTERFACE_ACCEPT(LoudnessAnalyzerFilterModule, BLT_Module)
+    ATX_GET_INTERFACE_ACCEPT(LoudnessAnalyzerFilterModule, ATX_Referenceable)
+ATX_END_GET_INTERFACE_IMPLEMENTATION
+
+/*----------------------------------------------------------------------
+|   node factory
++---------------------------------------------------------------------*/
+BLT_MODULE_IMPLEMENT_SIMPLE_MEDIA_NODE_FACTORY(LoudnessAnalyzerFilterModule, LoudnessAnalyzerFilter)
+
+/*----------------------------------------------------------------------
+|   BLT_Module interface
++---------------------------------------------------------------------*/
+ATX_BEGIN_INTERFACE_MAP(LoudnessAnalyzerFilterModule, BLT_Module)
+    BLT_BaseModule_GetInfo,
+    BLT_BaseModule_Attach,
+    LoudnessAnalyzerFilterModule_CreateInstance,
+    LoudnessAnalyzerFilterModule_Probe
+ATX_END_INTERFACE_MAP
+
+/*----------------------------------------------------------------------
+|   ATX_Referenceable interface
++---------------------------------------------------------------------*/
+#define LoudnessAnalyzerFilterModule_Destroy(x) \
+    BLT_BaseModule_Destroy((BLT_BaseModule*)(x))
+
+ATX_IMPLEMENT_REFERENCEABLE_INTERFACE(LoudnessAnalyzerFilterModule, reference_count)
+
+/*----------------------------------------------------------------------
+|   module object
++---------------------------------------------------------------------*/
+BLT_MODULE_IMPLEMENT_STANDARD_GET_MODULE(LoudnessAnalyzerFilterModule,
+                                         "Loudness Analyzer Filter",
+                                         BLT_LOUDNESS_ANALYZER_FILTER_MODULE_NAME,
+                                         "1.0.0",
+                                         BLT_MODULE_AXIOMATIC_COPYRIGHT)
@@ -0,0 +1,90 @@
+/*****************************************************************
+|
+|   Loudness Analyzer Filter Module
+|
+|   (c) 2002-2012 Gilles Boccon-Gibod
+|   Author: Gilles Boccon-Gibod (bok@bok.net)
+|
+ ****************************************************************/
+
+#ifndef _BLT_LOUDNESS_ANALYZER_FILTER_H_
+#define _BLT_LOUDNESS_ANALYZER_FILTER_H_
+
+/**
+ * @ingroup plugin_modules
+ * @ingroup plugin_filter_modules
+ * @defgroup loudness_analyzer_filter_module Loudness Analyzer Filter Module
+ * Plugin module that creates media nodes that measure the loudness of
+ * PCM audio data, as specified by EBU R128 and ITU-R BS.1770.
+ * These media nodes expect media packets with PCM audio as input,
+ * and pass them through unmodified.
+ * The momentary, short-term and integrated loudness, as well as the true
+ * peak, are published as stream properties while the stream plays. At
+ * the end of a stream that was measured from start to end, the
+ * ReplayGain 2.0 track gain is published as well, in the same units as
+ * BLT_REPLAY_GAIN_TRACK_GAIN_VALUE, so that it can be stored and used by
+ * the gain control filter the next time the stream is played.
+ * To measure the stream as it was mastered, these nodes should be added
+ * before any gain control filter node.
+ * 8 to 32 bit integer, as well as 32 bit float PCM are supported,
+ * with up to 8 channels. Other formats are not measured.
+ *
+ * @{
+ */
+
+/*----------------------------------------------------------------------
+|   includes
++---------------------------------------------------------------------*/
+#include "BltTypes.h"
+#include "BltModule.h"
+
+/*----------------------------------------------------------------------
+|   constants
++---------------------------------------------------------------------*/
+/**
+ * Stream property for the loudness of the last 400ms, in 100th of LUFS
+ * (integer). Updated every 100ms.
+ */
+#define BLT_LOUDNESS_ANALYZER_FILTER_MOMENTARY  "Plugins.LoudnessAnalyzerFilter.Momentary"
+
+/**
+ * Stream property for the loudness of the last 3s, in 100th of LUFS
+ * (integer). Updated every 100ms.
+ */
+#define BLT_LOUDNESS_ANALYZER_FILTER_SHORT_TERM "Plugins.LoudnessAnalyzerFilter.ShortTerm"
+
+/**
+ * Stream property for the integrated loudness since the start of the
+ * stream (or the last seek), in 100th of LUFS (integer). Updated every
+ * second, and at the end of the stream.
+ */
+#define BLT_LOUDNESS_ANALYZER_FILTER_INTEGRATED "Plugins.LoudnessAnalyzerFilter.Integrated"
+
+/**
+ * Stream property for the largest true peak since the start of the
+ * stream (or the last seek), in 100th of dBTP (integer).
+ */
+#define BLT_LOUDNESS_ANALYZER_FILTER_TRUE_PEAK  "Plugins.LoudnessAnalyzerFilter.TruePeak"
+
+/**
+ * Stream property set at the end of a stream that was measured in full:
+ * the ReplayGain 2.0 track gain, in 100th of dB (integer).
+ */
+#define BLT_LOUDNESS_ANALYZER_FILTER_TRACK_GAIN "Plugins.LoudnessAnalyzerFilter.TrackGain"
+
+/**
+ * Core property that, when set to a non-zero integer, selects the batch
+ * mode: the results are only published at the end of each stream. Used
+ * when scanning files faster than real time (with a null output), where
+ * nobody looks at the intermediate values.
+ */
+#define BLT_LOUDNESS_ANALYZER_FILTER_BATCH      "Plugins.LoudnessAnalyzerFilter.Batch"
+
+/*----------------------------------------------------------------------
+|   module
++---------------------------------------------------------------------*/
+BLT_Result BLT_LoudnessAnalyzerFilterModule_GetModuleObject(BLT_Module** module);
+
+/** @} */
+
+#endif /* _BLT_LOUDNESS_ANALYZER_FILTER_H_ */
@@ -0,0 +1,917 @@
+/*****************************************************************
+|
+|   Time Stretch Filter Module
+|
+|   (c) 2002-2012 Gilles Boccon-Gibod
+|   Author: Gilles Boccon-Gibod (bok@bok.net)
+|
+ ****************************************************************/
+
+/*----------------------------------------------------------------------
+|   includes
++---------------------------------------------------------------------*/
+#include <math.h>
+
+#include "Atomix.h"
+#include "BltConfig.h"
+#include "BltCore.h"
+#include "BltTimeStretchFilter.h"
+#include "BltPcmFloat.h"
+#include "BltTimeStretch.h"
+#include "BltMediaNode.h"
+#include "BltMedia.h"
+#include "BltPcm.h"
+#include "BltPacketProducer.h"
+#include "BltPacketConsumer.h"
+#include "BltStream.h"
+
+/*----------------------------------------------------------------------
+|   logging
++---------------------------------------------------------------------*/
+ATX_SET_LOCAL_LOGGER("bluetune.plugins.filters.time-stretch")
+
+/*----------------------------------------------------------------------
+|    constants
++---------------------------------------------------------------------*/
+#define BLT_TIME_STRETCH_FILTER_MODULE_NAME "com.axiosys.filter.time-stretch"
+
+#define BLT_TIME_STRETCH_FILTER_BLOCK_SIZE   256 /* frames */
+
+#define BLT_TIME_STRETCH_FILTER_DEFAULT_RATE 100
+#define BLT_TIME_STRETCH_FILTER_MIN_RATE     50
+#define BLT_TIME_STRETCH_FILTER_MAX_RATE     300
+
+/*----------------------------------------------------------------------
+|    types
++---------------------------------------------------------------------*/
+typedef BLT_BaseModule TimeStretchFilterModule;
+
+typedef struct {
+    /* interfaces */
+    ATX_IMPLEMENTS(BLT_MediaPort);
+    ATX_IMPLEMENTS(BLT_PacketConsumer);
+} TimeStretchFilterInput;
+
+typedef struct {
+    /* interfaces */
+    ATX_IMPLEMENTS(BLT_MediaPort);
+    ATX_IMPLEMENTS(BLT_PacketProducer);
+
+    /* members */
+    ATX_List* packets;
+} TimeStretchFilterOutput;
+
+typedef struct {
+    BLT_Boolean      configured;
+    BLT_Boolean      active;     /* stretching, as opposed to passing through  */
+    BLT_PcmMediaType format;
+    BLT_TimeStretch* stretch;
+    BLT_TimeStamp    base;       /* media time of the first frame stretched    */
+
+    /* work buffers */
+    float*           samples;    /* one block of input                         */
+    float*           output;     /* one hop of output                          */
+    void*            memory;
+} TimeStretchFilterState;
+
+typedef struct {
+    /* base class */
+    ATX_EXTENDS(BLT_BaseMediaNode);
+
+    /* interfaces */
+    ATX_IMPLEMENTS(ATX_PropertyListener);
+
+    /* members */
+    TimeStretchFilterInput     input;
+    TimeStretchFilterOutput    output;
+    TimeStretchFilterState     state;
+    BLT_TimeStamp              next_time_stamp; /* media time after the last output */
+    struct {
+        double rate;
+    } settings;
+    ATX_PropertyListenerHandle rate_listener_handle;
+} TimeStretchFilter;
+
+/*----------------------------------------------------------------------
+|   forward declarations
++---------------------------------------------------------------------*/
+ATX_DECLARE_INTERFACE_MAP(TimeStretchFilterModule, BLT_Module)
+ATX_DECLARE_INTERFACE_MAP(TimeStretchFilter, BLT_MediaNode)
+ATX_DECLARE_INTERFACE_MAP(TimeStretchFilter, ATX_Referenceable)
+ATX_DECLARE_INTERFACE_MAP(TimeStretchFilter, ATX_PropertyListener)
+
+/*----------------------------------------------------------------------
+|    TimeStretchFilter_FreeState
++---------------------------------------------------------------------*/
+static void
+TimeStretchFilter_FreeState(TimeStretchFilter* self)
+{
+    BLT_TimeStretch_Destroy(self->state.stretch);
+    if (self->state.memory) ATX_FreeMemory(self->state.memory);
+    ATX_SetMemory(&self->state, 0, sizeof(self->state));
+}
+
+/*----------------------------------------------------------------------
+|    TimeStretchFilter_Configure
++---------------------------------------------------------------------*/
+static BLT_Result
+TimeStretchFilter_Configure(TimeStretchFilter* self, const BLT_PcmMediaType* format)
+{
+    TimeStretchFilterState* state = &self->state;
+    BLT_Cardinal            channel_count = format->channel_count;
+    BLT_Cardinal            hop;
+    BLT_Result              result;
+
+    TimeStretchFilter_FreeState(self);
+
+    result = BLT_TimeStretch_Create(format->sample_rate, channel_count, &state->stretch);
+    if (BLT_FAILED(result)) return result;
+    hop = BLT_TimeStretch_GetHopSize(state->stretch);
+
+    /* all the buffers in one allocation */
+    state->memory = ATX_AllocateMemory(sizeof(float)*channel_count*
+                                       (BLT_TIME_STRETCH_FILTER_BLOCK_SIZE+hop));
+    if (state->memory == NULL) {
+        TimeStretchFilter_FreeState(self);
+        return BLT_ERROR_OUT_OF_MEMORY;
+    }
+    state->samples = (float*)state->memory;
+    state->output  = state->samples+BLT_TIME_STRETCH_FILTER_BLOCK_SIZE*channel_count;
+
+    state->format     = *format;
+    state->configured = BLT_TRUE;
+
+    ATX_LOG_FINE_3("TimeStretchFilter::Configure - %d Hz, %d channels, hop = %d frames",
+                   (int)format->sample_rate, (int)channel_count, (int)hop);
+
+    return BLT_SUCCESS;
+}
+
+/*----------------------------------------------------------------------
+|    TimeStretchFilter_Restart
++---------------------------------------------------------------------*/
+static void
+TimeStretchFilter_Restart(TimeStretchFilter* self)
+{
+    if (!self->state.configured) return;
+    BLT_TimeStretch_Reset(self->state.stretch);
+    self->state.active = BLT_FALSE;
+}
+
+/*----------------------------------------------------------------------
+|    TimeStretchFilter_PublishRate
+|
+|    Lets the stream scale the durations of our packets to media time.
+|    The stream properties are cleared when a new input is set, so the
+|    current value is checked rather than remembered.
++---------------------------------------------------------------------*/
+static void
+TimeStretchFilter_PublishRate(TimeStretchFilter* self, double rate)
+{
+    ATX_Properties*   properties;
+    ATX_PropertyValue value;
+
+    if (ATX_BASE(self, BLT_BaseMediaNode).context == NULL) return;
+    if (BLT_FAILED(BLT_Stream_GetProperties(ATX_BASE(self, BLT_BaseMediaNode).context,
+                                            &properties))) {
+        return;
+    }
+
+    /* nothing to do when the property is already right */
+    if (ATX_SUCCEEDED(ATX_Properties_GetProperty(properties, BLT_STREAM_PROPERTY_MEDIA_RATE, &value))) {
+        if (value.type == ATX_PROPERTY_VALUE_TYPE_FLOAT && value.data.fp == (float)rate) return;
+    } else {
+        if (rate == 1.0) return;
+    }
+
+    if (rate != 1.0) {
+        value.type    = ATX_PROPERTY_VALUE_TYPE_FLOAT;
+        value.data.fp = (float)rate;
+        ATX_Properties_SetProperty(properties, BLT_STREAM_PROPERTY_MEDIA_RATE, &value);
+    } else {
+        ATX_Properties_SetProperty(properties, BLT_STREAM_PROPERTY_MEDIA_RATE, NULL);
+    }
+}
+
+/*----------------------------------------------------------------------
+|    TimeStretchFilter_Render
++---------------------------------------------------------------------*/
+static BLT_Result
+TimeStretchFilter_Render(TimeStretchFilter* self,
+                         const void*        input,
+                         BLT_Cardinal       input_frames,
+                         BLT_Boolean        flush,
+                         BLT_MediaPacket**  output)
+{
+    TimeStretchFilterState* state         = &self->state;
+    BLT_Cardinal            channel_count = state->format.channel_count;
+    BLT_Cardinal            sample_rate   = state->format.sample_rate;
+    BLT_Size                frame_size    = channel_count*state->format.bits_per_sample/8;
+    BLT_Cardinal            hop           = BLT_TimeStretch_GetHopSize(state->stretch);
+    BLT_Cardinal            available     = BLT_TimeStretch_GetBufferedFrames(state->stretch)+input_frames;
+    double                  rate          = self->settings.rate;
+    BLT_Cardinal            max_frames;
+    ATX_Int64               media_start;
+    ATX_Int64               media_end;
+    unsigned char*          out;
+    BLT_Size                out_size = 0;
+    BLT_Ordinal             offset;
+    BLT_Cardinal            count;
+    BLT_TimeStamp           time_stamp;
+    BLT_Result              result;
+
+    /* at most one step per analysis hop, and the rest as is when flushing */
+    max_frames = ((BLT_Cardinal)((double)available/(rate*(double)hop))+4)*hop;
+    if (flush) max_frames += available;
+    result = BLT_Core_CreateMediaPacket(ATX_BASE(self, BLT_BaseMediaNode).core,
+                                        max_frames*frame_size,
+                                        (const BLT_MediaType*)&state->format,
+                                        output);
+    if (BLT_FAILED(result)) return result;
+    out = (unsigned char*)BLT_MediaPacket_GetPayloadBuffer(*output);
+
+    media_start = (ATX_Int64)floor(BLT_TimeStretch_GetPosition(state->stretch)+0.5);
+    for (offset=0; offset<input_frames;) {
+        BLT_Cardinal chunk   = input_frames-offset;
+        BLT_Cardinal written = 0;
+        if (chunk > BLT_TIME_STRETCH_FILTER_BLOCK_SIZE) chunk = BLT_TIME_STRETCH_FILTER_BLOCK_SIZE;
+
+        BLT_PcmFloat_Import(&state->format,
+                            (const unsigned char*)input+offset*frame_size,
+                            chunk*channel_count,
+                            state->samples);
+        while (written < chunk) {
+            BLT_Cardinal accepted = BLT_TimeStretch_Write(state->stretch,
+                                                          state->samples+written*channel_count,
+                                                          chunk-written);
+            BLT_Cardinal produced = 0;
+            while (out_size+hop*frame_size <= max_frames*frame_size &&
+                   (count = BLT_TimeStretch_Process(state->stretch, rate, state->output, hop))) {
+                BLT_PcmFloat_Export(&state->format, state->output, count*channel_count, out+out_size);
+                out_size += count*frame_size;
+                produced += count;
+            }
+            written += accepted;
+
+            /* the input buffer is always large enough, but never loop forever */
+            if (accepted == 0 && produced == 0) break;
+        }
+        offset += chunk;
+    }
+
+    /* what's left of the input is output as is */
+    if (flush) {
+        while (out_size+hop*frame_size <= max_frames*frame_size &&
+               (count = BLT_TimeStretch_Flush(state->stretch, state->output, hop))) {
+            BLT_PcmFloat_Export(&state->format, state->output, count*channel_count, out+out_size);
+            out_size += count*frame_size;
+        }
+    }
+    media_end = (ATX_Int64)floor(BLT_TimeStretch_GetPosition(state->stretch)+0.5);
+    BLT_MediaPacket_SetPayloadSize(*output, out_size);
+
+    /* the packet starts at media_start in media time, and lasts as */
+    /* long as the audio it carries                                 */
+    time_stamp = BLT_TimeStamp_Add(state->base, BLT_TimeStamp_FromSamples(media_start, sample_rate));
+    BLT_MediaPacket_SetTimeStamp(*output, time_stamp);
+    BLT_MediaPacket_SetDuration(*output, BLT_TimeStamp_FromSamples(out_size/frame_size, sample_rate));
+    self->next_time_stamp = BLT_TimeStamp_Add(state->base, BLT_TimeStamp_FromSamples(media_end, sample_rate));
+
+    return BLT_SUCCESS;
+}
+
+/*----------------------------------------------------------------------
+|    TimeStretchFilter_QueuePacket
++---------------------------------------------------------------------*/
+static BLT_Result
+TimeStretchFilter_QueuePacket(TimeStretchFilter* self, BLT_MediaPacket* packet)
+{
+    BLT_Result result = ATX_List_AddData(self->output.packets, packet);
+    if (BLT_FAILED(result)) BLT_MediaPacket_Release(packet);
+    return result;
+}
+
+/*----------------------------------------------------------------------
+|    TimeStretchFilter_Drain
++---------------------------------------------------------------------*/
+static BLT_Result
+TimeStretchFilter_Drain(TimeStretchFilter* self)
+{
+    BLT_MediaPacket* packet = NULL;
+    BLT_Result       result;
+
+    /* nothing to do if we're not stretching */
+    if (!self->state.configured || !self->state.active) return BLT_SUCCESS;
+
+    result = TimeStretchFilter_Render(self, NULL, 0, BLT_TRUE, &packet);
+    self->state.active = BLT_FALSE;
+    if (BLT_FAILED(result)) return result;
+    if (BLT_MediaPacket_GetPayloadSize(packet) == 0) {
+        BLT_MediaPacket_Release(packet);
+        return BLT_SUCCESS;
+    }
+
+    return TimeStretchFilter_QueuePacket(self, packet);
+}
+
+/*----------------------------------------------------------------------
+|    TimeStretchFilter_PassThrough
++---------------------------------------------------------------------*/
+static BLT_Result
+TimeStretchFilter_PassThrough(TimeStretchFilter*      self,
+                              BLT_MediaPacket*        packet,
+                              const BLT_PcmMediaType* media_type)
+{
+    BLT_TimeStamp time_stamp = BLT_MediaPacket_GetTimeStamp(packet);
+
+    TimeStretchFilter_PublishRate(self, 1.0);
+
+    /* keep track of the media time, in case we start stretching */
+    if (time_stamp.seconds || time_stamp.nanoseconds) {
+        self->next_time_stamp = time_stamp;
+    }
+    if (media_type->sample_rate && media_type->channel_count && media_type->bits_per_sample) {
+        BLT_Cardinal frame_count = BLT_MediaPacket_GetPayloadSize(packet)/
+                                   (media_type->channel_count*media_type->bits_per_sample/8);
+        self->next_time_stamp = BLT_TimeStamp_Add(self->next_time_stamp,
+            BLT_TimeStamp_FromSamples(frame_count, media_type->sample_rate));
+    }
+
+    BLT_MediaPacket_AddReference(packet);
+    return TimeStretchFilter_QueuePacket(self, packet);
+}
+
+/*----------------------------------------------------------------------
+|    TimeStretchFilterInput_PutPacket
++---------------------------------------------------------------------*/
+BLT_METHOD
+TimeStretchFilterInput_PutPacket(BLT_PacketConsumer* _self,
+                                 BLT_MediaPacket*    packet)
+{
+    TimeStretchFilter* self = ATX_SELF_M(input, TimeStretchFilter, BLT_PacketConsumer);
+    BLT_PcmMediaType*  media_type;
+    BLT_Flags          flags = BLT_MediaPacket_GetFlags(packet);
+    BLT_MediaPacket*   output = NULL;
+    BLT_Size           frame_size;
+    BLT_Result         result;
+
+    /* get the media type */
+    result = BLT_MediaPacket_GetMediaType(packet, (const BLT_MediaType**)(const void*)&media_type);
+    if (BLT_FAILED(result)) return result;
+
+    /* check the media type */
+    if (media_type->base.id != BLT_MEDIA_TYPE_ID_AUDIO_PCM) {
+        return BLT_ERROR_INVALID_MEDIA_TYPE;
+    }
+
+    /* formats that we can't process pass through unmodified */
+    if (!BLT_PcmFloat_SupportsFormat(media_type) ||
+        media_type->channel_count == 0 ||
+        media_type->channel_count > BLT_TIME_STRETCH_MAX_CHANNELS ||
+        media_type->sample_rate == 0) {
+        TimeStretchFilter_Drain(self);
+        return TimeStretchFilter_PassThrough(self, packet, media_type);
+    }
+
+    /* a new format, or a new stream, starts from scratch */
+    if (!self->state.configured ||
+        self->state.format.sample_rate     != media_type->sample_rate     ||
+        self->state.format.channel_count   != media_type->channel_count   ||
+        self->state.format.bits_per_sample != media_type->bits_per_sample ||
+        self->state.format.sample_format   != media_type->sample_format) {
+        TimeStretchFilter_Drain(self);
+        result = TimeStretchFilter_Configure(self, media_type);
+        if (BLT_FAILED(result)) return result;
+    } else if (flags & BLT_MEDIA_PACKET_FLAG_START_OF_STREAM) {
+        TimeStretchFilter_Drain(self);
+    }
+
+    /* at the normal rate, there is nothing to do once the stretcher is empty */
+    if (self->settings.rate == 1.0) {
+        TimeStretchFilter_Drain(self);
+        return TimeStretchFilter_PassThrough(self, packet, media_type);
+    }
+
+    /* start stretching where the media is now */
+    if (!self->state.active) {
+        BLT_TimeStamp time_stamp = BLT_MediaPacket_GetTimeStamp(packet);
+        BLT_TimeStretch_Reset(self->state.stretch);
+        if (time_stamp.seconds || time_stamp.nanoseconds) {
+            self->state.base = time_stamp;
+        } else {
+            self->state.base = self->next_time_stamp;
+        }
+        self->state.active = BLT_TRUE;
+    }
+
+    /* stretch the samples, and output the rest at the end */
+    frame_size = media_type->channel_count*media_type->bits_per_sample/8;
+    result = TimeStretchFilter_Render(self,
+                                      BLT_MediaPacket_GetPayloadBuffer(packet),
+                                      BLT_MediaPacket_GetPayloadSize(packet)/frame_size,
+                                      (flags & BLT_MEDIA_PACKET_FLAG_END_OF_STREAM)?BLT_TRUE:BLT_FALSE,
+                                      &output);
+    if (flags & BLT_MEDIA_PACKET_FLAG_END_OF_STREAM) {
+        TimeStretchFilter_Restart(self);
+    }
+    if (BLT_FAILED(result)) return result;
+    TimeStretchFilter_PublishRate(self, self->settings.rate);
+
+    /* drop empty packets, unless they carry flags */
+    if (BLT_MediaPacket_GetPayloadSize(output) == 0 && flags == 0) {
+        BLT_MediaPacket_Release(output);
+        return BLT_SUCCESS;
+    }
+    BLT_MediaPacket_SetFlags(output, flags);
+
+    return TimeStretchFilter_QueuePacket(self, output);
+}
+
+/*----------------------------------------------------------------------
+|   TimeStretchFilterInput_QueryMediaType
++---------------------------------------------------------------------*/
+BLT_METHOD
+TimeStretchFilterInput_QueryMediaType(BLT_MediaPort*         self,
+                                      BLT_Ordinal            index,
+                                      const BLT_MediaType**  media_type)
+{
+    BLT_COMPILER_UNUSED(self);
+    if (index == 0) {
+        *media_type = &BLT_GenericPcmMediaType;
+        return BLT_SUCCESS;
+    } else {
+        *media_type = NULL;
+        return BLT_FAILURE;
+    }
+}
+
+/*----------------------------------------------------------------------
+|   GetInterface implementation
++---------------------------------------------------------------------*/
+ATX_BEGIN_GET_INTERFACE_IMPLEMENTATION(TimeStretchFilterInput)
+    ATX_GET_INTERFACE_ACCEPT(TimeStretchFilterInput, BLT_MediaPort)
+    ATX_GET_INTERFACE_ACCEPT(TimeStretchFilterInput, BLT_PacketConsumer)
+ATX_END_GET_INTERFACE_IMPLEMENTATION
+
+/*----------------------------------------------------------------------
+|    BLT_PacketConsumer interface
++---------------------------------------------------------------------*/
+ATX_BEGIN_INTERFACE_MAP(TimeStretchFilterInput, BLT_PacketConsumer)
+    TimeStretchFilterInput_PutPacket
+ATX_END_INTERFACE_MAP
+
+/*----------------------------------------------------------------------
+|    BLT_MediaPort interface
++---------------------------------------------------------------------*/
+BLT_MEDIA_PORT_IMPLEMENT_SIMPLE_TEMPLATE(TimeStretchFilterInput,
+                                         "input",
+                                         PACKET,
+                                         IN)
+ATX_BEGIN_INTERFACE_MAP(TimeStretchFilterInput, BLT_MediaPort)
+    TimeStretchFilterInput_GetName,
+    TimeStretchFilterInput_GetProtocol,
+    TimeStretchFilterInput_GetDirection,
+    TimeStretchFilterInput_QueryMediaType
+ATX_END_INTERFACE_MAP
+
+/*----------------------------------------------------------------------
+|    TimeStretchFilterOutput_GetPacket
++---------------------------------------------------------------------*/
+BLT_METHOD
+TimeStretchFilterOutput_GetPacket(BLT_PacketProducer* _self,
+                                  BLT_MediaPacket**   packet)
+{
+    TimeStretchFilter* self = ATX_SELF_M(output, TimeStretchFilter, BLT_PacketProducer);
+    ATX_ListItem*  item;
+
+    item = ATX_List_GetFirstItem(self->output.packets);
+    if (item) {
+        *packet = ATX_ListItem_GetData(item);
+        ATX_List_RemoveItem(self->output.packets, item);
+        return BLT_SUCCESS;
+    } else {
+        *packet = NULL;
+        return BLT_ERROR_PORT_HAS_NO_DATA;
+    }
+}
+
+/*----------------------------------------------------------------------
+|   TimeStretchFilterOutput_QueryMediaType
++---------------------------------------------------------------------*/
+BLT_METHOD
+TimeStretchFilterOutput_QueryMediaType(BLT_MediaPort*         self,
+                                       BLT_Ordinal            index,
+                                       const BLT_MediaType**  media_type)
+{
+    BLT_COMPILER_UNUSED(self);
+    if (index == 0) {
+        *media_type = &BLT_GenericPcmMediaType;
+        return BLT_SUCCESS;
+    } else {
+        *media_type = NULL;
+        return BLT_FAILURE;
+    }
+}
+
+/*----------------------------------------------------------------------
+|   GetInterface implementation
++---------------------------------------------------------------------*/
+ATX_BEGIN_GET_INTERFACE_IMPLEMENTATION(TimeStretchFilterOutput)
+    ATX_GET_INTERFACE_ACCEPT(TimeStretchFilterOutput, BLT_MediaPort)
+    ATX_GET_INTERFACE_ACCEPT(TimeStretchFilterOutput, BLT_PacketProducer)
+ATX_END_GET_INTERFACE_IMPLEMENTATION
+
+/*----------------------------------------------------------------------
+|    BLT_MediaPort interface
++---------------------------------------------------------------------*/
+BLT_MEDIA_PORT_IMPLEMENT_SIMPLE_TEMPLATE(TimeStretchFilterOutput,
+                                         "output",
+                                         PACKET,
+                                         OUT)
+ATX_BEGIN_INTERFACE_MAP(TimeStretchFilterOutput, BLT_MediaPort)
+    TimeStretchFilterOutput_GetName,
+    TimeStretchFilterOutput_GetProtocol,
+    TimeStretchFilterOutput_GetDirection,
+    TimeStretchFilterOutput_QueryMediaType
+ATX_END_INTERFACE_MAP
+
+/*----------------------------------------------------------------------
+|    BLT_PacketProducer interface
++---------------------------------------------------------------------*/
+ATX_BEGIN_INTERFACE_MAP(TimeStretchFilterOutput, BLT_PacketProducer)
+    TimeStretchFilterOutput_GetPacket
+ATX_END_INTERFACE_MAP
+
+/*----------------------------------------------------------------------
+|    TimeStretchFilter_ClearOutput
++---------------------------------------------------------------------*/
+static void
+TimeStretchFilter_ClearOutput(TimeStretchFilter* self)
+{
+    ATX_ListItem* item = ATX_List_GetFirstItem(self->output.packets);
+    while (item) {
+        BLT_MediaPacket* packet = ATX_ListItem_GetData(item);
+        if (packet) BLT_MediaPacket_Release(packet);
+        item = ATX_ListItem_GetNext(item);
+    }
+    ATX_List_Clear(self->output.packets);
+}
+
+/*----------------------------------------------------------------------
+|    TimeStretchFilter_Create
++---------------------------------------------------------------------*/
+static BLT_Result
+TimeStretchFilter_Create(BLT_Module*              module,
+                         BLT_Core*                core,
+                         BLT_ModuleParametersType parameters_type,
+                         BLT_AnyConst             parameters,
+                         BLT_MediaNode**          object)
+{
+    TimeStretchFilter* self;
+    BLT_Result     result;
+
+    ATX_LOG_FINE("TimeStretchFilter::Create");
+
+    /* check parameters */
+    if (parameters == NULL ||
+        parameters_type != BLT_MODULE_PARAMETERS_TYPE_MEDIA_NODE_CONSTRUCTOR) {
+        return BLT_ERROR_INVALID_PARAMETERS;
+    }
+
+    /* allocate memory for the object */
+    self = ATX_AllocateZeroMemory(sizeof(TimeStretchFilter));
+    if (self == NULL) {
+        *object = NULL;
+        return BLT_ERROR_OUT_OF_MEMORY;
+    }
+
+    /* construct the inherited object */
+    BLT_BaseMediaNode_Construct(&ATX_BASE(self, BLT_BaseMediaNode), module, core);
+
+    /* construct the object */
+    result = ATX_List_Create(&self->output.packets);
+    if (BLT_FAILED(result)) {
+        BLT_BaseMediaNode_Destruct(&ATX_BASE(self, BLT_BaseMediaNode));
+        ATX_FreeMemory(self);
+        *object = NULL;
+        return result;
+    }
+    self->settings.rate = BLT_TIME_STRETCH_FILTER_DEFAULT_RATE/100.0;
+
+    /* setup interfaces */
+    ATX_SET_INTERFACE_EX(self, TimeStretchFilter, BLT_BaseMediaNode, BLT_MediaNode);
+    ATX_SET_INTERFACE_EX(self, TimeStretchFilter, BLT_BaseMediaNode, ATX_Referenceable);
+    ATX_SET_INTERFACE(self, TimeStretchFilter, ATX_PropertyListener);
+    ATX_SET_INTERFACE(&self->input,  TimeStretchFilterInput,  BLT_MediaPort);
+    ATX_SET_INTERFACE(&self->input,  TimeStretchFilterInput,  BLT_PacketConsumer);
+    ATX_SET_INTERFACE(&self->output, TimeStretchFilterOutput, BLT_MediaPort);
+    ATX_SET_INTERFACE(&self->output, TimeStretchFilterOutput, BLT_PacketProducer);
+    *object = &ATX_BASE_EX(self, BLT_BaseMediaNode, BLT_MediaNode);
+
+    return BLT_SUCCESS;
+}
+
+/*----------------------------------------------------------------------
+|    TimeStretchFilter_Destroy
++---------------------------------------------------------------------*/
+static BLT_Result
+TimeStretchFilter_Destroy(TimeStretchFilter* self)
+{
+    ATX_LOG_FINE("TimeStretchFilter::Destroy");
+
+    /* release any output packet we may hold */
+    TimeStretchFilter_ClearOutput(self);
+    ATX_List_Destroy(self->output.packets);
+
+    /* free the processing state */
+    TimeStretchFilter_FreeState(self);
+
+    /* destruct the inherited object */
+    BLT_BaseMediaNode_Destruct(&ATX_BASE(self, BLT_BaseMediaNode));
+
+    /* free the object memory */
+    ATX_FreeMemory((void*)self);
+
+    return BLT_SUCCESS;
+}
+
+/*----------------------------------------------------------------------
+|   TimeStretchFilter_GetPortByName
++---------------------------------------------------------------------*/
+BLT_METHOD
+TimeStretchFilter_GetPortByName(BLT_MediaNode*  _self,
+                                BLT_CString     name,
+                                BLT_MediaPort** port)
+{
+    TimeStretchFilter* self = ATX_SELF_EX(TimeStretchFilter, BLT_BaseMediaNode, BLT_MediaNode);
+
+    if (ATX_StringsEqual(name, "input")) {
+        *port = &ATX_BASE(&self->input, BLT_MediaPort);
+        return BLT_SUCCESS;
+    } else if (ATX_StringsEqual(name, "output")) {
+        *port = &ATX_BASE(&self->output, BLT_MediaPort);
+        return BLT_SUCCESS;
+    } else {
+        *port = NULL;
+        return BLT_ERROR_NO_SUCH_PORT;
+    }
+}
+
+/*----------------------------------------------------------------------
+|    TimeStretchFilter_UpdateSetting
++---------------------------------------------------------------------*/
+static void
+TimeStretchFilter_UpdateSetting(TimeStretchFilter*       self,
+                                ATX_CString              name,
+                                const ATX_PropertyValue* value)
+{
+    if (ATX_StringsEqual(name, BLT_TIME_STRETCH_FILTER_RATE)) {
+        double rate = BLT_TIME_STRETCH_FILTER_DEFAULT_RATE/100.0;
+        if (value && value->type == ATX_PROPERTY_VALUE_TYPE_INTEGER) {
+            /* in percent */
+            rate = value->data.integer/100.0;
+        } else if (value && value->type == ATX_PROPERTY_VALUE_TYPE_FLOAT) {
+            rate = value->data.fp;
+        }
+        if (rate < BLT_TIME_STRETCH_FILTER_MIN_RATE/100.0) rate = BLT_TIME_STRETCH_FILTER_MIN_RATE/100.0;
+        if (rate > BLT_TIME_STRETCH_FILTER_MAX_RATE/100.0) rate = BLT_TIME_STRETCH_FILTER_MAX_RATE/100.0;
+
+        /* the new rate applies from the next packet on */
+        self->settings.rate = rate;
+    } else {
+        return;
+    }
+
+    ATX_LOG_FINE_1("TimeStretchFilter::UpdateSetting - %s", name);
+}
+
+/*----------------------------------------------------------------------
+|    TimeStretchFilter_Activate
++---------------------------------------------------------------------*/
+BLT_METHOD
+TimeStretchFilter_Activate(BLT_MediaNode* _self, BLT_Stream* stream)
+{
+    TimeStretchFilter* self = ATX_SELF_EX(TimeStretchFilter, BLT_BaseMediaNode, BLT_MediaNode);
+
+    /* keep a reference to the stream */
+    ATX_BASE(self, BLT_BaseMediaNode).context = stream;
+
+    /* listen to settings on the new stream */
+    if (stream) {
+        ATX_Properties* properties;
+        if (BLT_SUCCEEDED(BLT_Stream_GetProperties(ATX_BASE(self, BLT_BaseMediaNode).context,
+                                                   &properties))) {
+            ATX_PropertyValue property;
+            ATX_Properties_AddListener(properties,
+                                       BLT_TIME_STRETCH_FILTER_RATE,
+                                       &ATX_BASE(self, ATX_PropertyListener),
+                                       &self->rate_listener_handle);
+
+            /* read the initial value */
+            if (ATX_SUCCEEDED(ATX_Properties_GetProperty(properties,
+                                                         BLT_TIME_STRETCH_FILTER_RATE,
+                                                         &property))) {
+                TimeStretchFilter_UpdateSetting(self, BLT_TIME_STRETCH_FILTER_RATE, &property);
+            }
+        }
+    }
+
+    return BLT_SUCCESS;
+}
+
+/*----------------------------------------------------------------------
+|    TimeStretchFilter_Deactivate
++---------------------------------------------------------------------*/
+BLT_METHOD
+TimeStretchFilter_Deactivate(BLT_MediaNode* _self)
+{
+    TimeStretchFilter* self = ATX_SELF_EX(TimeStretchFilter, BLT_BaseMediaNode, BLT_MediaNode);
+
+    /* remove our listener */
+    if (ATX_BASE(self, BLT_BaseMediaNode).context) {
+        ATX_Properties* properties;
+        if (BLT_SUCCEEDED(BLT_Stream_GetProperties(ATX_BASE(self, BLT_BaseMediaNode).context,
+                                                   &properties))) {
+            ATX_Properties_RemoveListener(properties, self->rate_listener_handle);
+        }
+        TimeStretchFilter_PublishRate(self, 1.0);
+    }
+
+    /* we're detached from the stream */
+    ATX_BASE(self, BLT_BaseMediaNode).context = NULL;
+
+    return BLT_SUCCESS;
+}
+
+/*----------------------------------------------------------------------
+|    TimeStretchFilter_Seek
++---------------------------------------------------------------------*/
+BLT_METHOD
+TimeStretchFilter_Seek(BLT_MediaNode* _self,
+                       BLT_SeekMode*  mode,
+                       BLT_SeekPoint* point)
+{
+    TimeStretchFilter* self = ATX_SELF_EX(TimeStretchFilter, BLT_BaseMediaNode, BLT_MediaNode);
+
+    BLT_COMPILER_UNUSED(mode);
+
+    /* discard everything we hold */
+    TimeStretchFilter_ClearOutput(self);
+    TimeStretchFilter_Restart(self);
+
+    /* the media resumes at the seek point */
+    self->next_time_stamp = point->time_stamp;
+
+    return BLT_SUCCESS;
+}
+
+/*----------------------------------------------------------------------
+|   GetInterface implementation
++---------------------------------------------------------------------*/
+ATX_BEGIN_GET_INTERFACE_IMPLEMENTATION(TimeStretchFilter)
+    ATX_GET_INTERFACE_ACCEPT_EX(TimeStretchFilter, BLT_BaseMediaNode, BLT_MediaNode)
+    ATX_GET_INTERFACE_ACCEPT_EX(TimeStretchFilter, BLT_BaseMediaNode, ATX_Referenceable)
+    ATX_GET_INTERFACE_ACCEPT(TimeStretchFilter, ATX_PropertyListener)
+ATX_END_GET_INTERFACE_IMPLEMENTATION
+
+/*----------------------------------------------------------------------
+|    BLT_MediaNode interface
++---------------------------------------------------------------------*/
+ATX_BEGIN_INTERFACE_MAP_EX(TimeStretchFilter, BLT_BaseMediaNode, BLT_MediaNode)
+    BLT_BaseMediaNode_GetInfo,
+    TimeStretchFilter_GetPortByName,
+    TimeStretchFilter_Activate,
+    TimeStretchFilter_Deactivate,
+    BLT_BaseMediaNode_Start,
+    BLT_BaseMediaNode_Stop,
+    BLT_BaseMediaNode_Pause,
+    BLT_BaseMediaNode_Resume,
+    TimeStretchFilter_Seek
+};
+
+/*----------------------------------------------------------------------
+|    TimeStretchFilter_OnPropertyChanged
++---------------------------------------------------------------------*/
+BLT_VOID_METHOD
+TimeStretchFilter_OnPropertyChanged(ATX_PropertyListener*    _self,
+                                    ATX_CString              name,
+                                    const ATX_PropertyValue* value)
+{
+    TimeStretchFilter* self = ATX_SELF(TimeStretchFilter, ATX_PropertyListener);
+
+    if (name) TimeStretchFilter_UpdateSetting(self, name, value);
+}
+
+/*----------------------------------------------------------------------
+|    ATX_PropertyListener interface
++---------------------------------------------------------------------*/
+ATX_BEGIN_INTERFACE_MAP(TimeStretchFilter, ATX_PropertyListener)
+    TimeStretchFilter_OnPropertyChanged,
+};
+
+/*----------------------------------------------------------------------
+|   ATX_Referenceable interface
++---------------------------------------------------------------------*/
+ATX_IMPLEMENT_REFERENCEABLE_INTERFACE_EX(TimeStretchFilter,
+                                         BLT_BaseMediaNode,
+                                         reference_count)
+
+/*----------------------------------------------------------------------
+|   TimeStretchFilterModule_Probe
++---------------------------------------------------------------------*/
+BLT_METHOD
+TimeStretchFilterModule_Probe(BLT_Module*              self,
+                              BLT_Core*                core,
+                              BLT_ModuleParametersType parameters_type,
+                              BLT_AnyConst             parameters,
+                              BLT_Cardinal*            match)
+{
+    BLT_COMPILER_UNUSED(self);
+    BLT_COMPILER_UNUSED(core);
+
+    switch (parameters_type) {
+      case BLT_MODULE_PARAMETERS_TYPE_MEDIA_NODE_CONSTRUCTOR:
+        {
+            BLT_MediaNodeConstructor* constructor =
+                (BLT_MediaNodeConstructor*)parameters;
+
+            /* we need a name */
+            if (constructor->name == NULL ||
+                !ATX_StringsEqual(constructor->name, BLT_TIME_STRETCH_FILTER_MODULE_NAME)) {
+                return BLT_FAILURE;
+            }
+
+            /* the input and output protocols should be PACKET */
+            if ((constructor->spec.input.protocol  != BLT_MEDIA_PORT_PROTOCOL_ANY &&
+                 constructor->spec.input.protocol  != BLT_MEDIA_PORT_PROTOCOL_PACKET) ||
+                (constructor->spec.output.protocol != BLT_MEDIA_PORT_PROTOCOL_ANY &&
+                 constructor->spec.output.protocol != BLT_MEDIA_PORT_PROTOCOL_PACKET)) {
+                return BLT_FAILURE;
+            }
+
+            /* the input type should be unspecified, or audio/pcm */
+            if (!(constructor->spec.input.media_type->id == BLT_MEDIA_TYPE_ID_AUDIO_PCM) &&
+                !(constructor->spec.input.media_type->id == BLT_MEDIA_TYPE_ID_UNKNOWN)) {
+                return BLT_FAILURE;
+            }
+
+            /* the output type should be unspecified, or audio/pcm */
+            if (!(constructor->spec.output.media_type->id == BLT_MEDIA_TYPE_ID_AUDIO_PCM) &&
+                !(constructor->spec.output.media_type->id == BLT_MEDIA_TYPE_ID_UNKNOWN)) {
+                return BLT_FAILURE;
+            }
+
+            /* match level is always exact */
+            *match = BLT_MODULE_PROBE_MATCH_EXACT;
+
+            ATX_LOG_FINE_1("TimeStretchFilterModule::Probe - Ok [%d]", *match);
+            return BLT_SUCCESS;
+        }
+        break;
+
+      default:
+        break;
+    }
+
+    return BLT_FAILURE;
+}
+
+/*----------------------------------------------------------------------
+|   GetInterface implementation
++---------------------------------------------------------------------*/
+ATX_BEGIN_GET_INTERFACE_IMPLEMENTATION(TimeStretchFilterModule)
+    ATX_GET_INTERFACE_ACCEPT(TimeStretchFilterModule, BLT_Module)
+    ATX_GET_INTERFACE_ACCEPT(TimeStretchFilterModule, ATX_Referenceable)
+ATX_END_GET_INTERFACE_IMPLEMENTATION
+
+/*----------------------------------------------------------------------
+|   node factory
++---------------------------------------------------------------------*/
+BLT_MODULE_IMPLEMENT_SIMPLE_MEDIA_NODE_FACTORY(TimeStretchFilterModule, TimeStretchFilter)
+
+/*----------------------------------------------------------------------
+|   BLT_Module interface
++---------------------------------------------------------------------*/
+ATX_BEGIN_INTERFACE_MAP(TimeStretchFilterModule, BLT_Module)
+    BLT_BaseModule_GetInfo,
+    BLT_BaseModule_Attach,
+    TimeStretchFilterModule_CreateInstance,
+    TimeStretchFilterModule_Probe
+ATX_END_INTERFACE_MAP
+
+/*----------------------------------------------------------------------
+|   ATX_Referenceable interface
++---------------------------------------------------------------------*/
+#define TimeStretchFilterModule_Destroy(x) \
+    BLT_BaseModule_Destroy((BLT_BaseModule*)(x))
+
+ATX_IMPLEMENT_REFERENCEABLE_INTERFACE(TimeStretchFilterModule, reference_count)
+
+/*----------------------------------------------------------------------
+|   module object
++---------------------------------------------------------------------*/
+BLT_MODULE_IMPLEMENT_STANDARD_GET_MODULE(TimeStretchFilterModule,
+                                         "Time Stretch Filter",
+                                         BLT_TIME_STRETCH_FILTER_MODULE_NAME,
+                                         "1.0.0",
+                                         BLT_MODULE_AXIOMATIC_COPYRIGHT)
@@ -0,0 +1,63 @@
+/*****************************************************************
+|
+|   Time Stretch Filter Module
+|
+|   (c) 2002-2012 Gilles Boccon-Gibod
+|   Author: Gilles Boccon-Gibod (bok@bok.net)
+|
+ ****************************************************************/
+
+#ifndef _BLT_TIME_STRETCH_FILTER_H_
+#define _BLT_TIME_STRETCH_FILTER_H_
+
+/**
+ * @ingroup plugin_modules
+ * @ingroup plugin_filter_modules
+ * @defgroup time_stretch_filter_module Time Stretch Filter Module
+ * Plugin module that creates media nodes that change the playback rate
+ * of PCM audio data without changing its pitch (see BltTimeStretch.h).
+ * These media nodes expect media packets with PCM audio as input,
+ * and produce media packets with PCM audio as output.
+ * The rate can change at any time while the audio plays. At the normal
+ * rate, the packets pass through unmodified.
+ *
+ * The time stamps of the output packets are in media time (the time of
+ * the input), and their durations are those of the audio they carry.
+ * While stretching, the node sets BLT_STREAM_PROPERTY_MEDIA_RATE, with
+ * which the stream scales the durations back to media time, so the time
+ * codes and positions reported by the decoder, and seeking, keep
+ * referring to the media whatever the rate.
+ *
+ * 8 to 32 bit integer, as well as 32 bit float PCM are supported,
+ * with up to 8 channels. Other formats pass through unmodified.
+ *
+ * The module is not part of the default chain: it is added by name,
+ * with BLT_Decoder_AddNodeByName(decoder, NULL, "com.axiosys.filter.time-stretch").
+ *
+ * @{
+ */
+
+/*----------------------------------------------------------------------
+|   includes
++---------------------------------------------------------------------*/
+#include "BltTypes.h"
+#include "BltModule.h"
+
+/*----------------------------------------------------------------------
+|   constants
++---------------------------------------------------------------------*/
+/**
+ * Stream property for the playback rate. Integer values are in percent,
+ * floating point values are factors (200 and 2.0 both play twice as
+ * fast). Defaults to 100, and is clamped between 50 and 300.
+ */
+#define BLT_TIME_STRETCH_FILTER_RATE "Plugins.TimeStretchFilter.Rate"
+
+/*----------------------------------------------------------------------
+|   module
++---------------------------------------------------------------------*/
+BLT_Result BLT_TimeStretchFilterModule_GetModuleObject(BLT_Module** module);
+
+/** @} */
+
+#endif /* _BLT_TIME_STRETCH_FILTER_H_ */
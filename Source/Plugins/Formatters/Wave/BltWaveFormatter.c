@@ -79,63 +79,62 @@ ATX_DECLARE_INTERFACE_MAP(WaveFormatter, BLT_MediaNode)
 ATX_DECLARE_INTERFACE_MAP(WaveFormatter, ATX_Referenceable)
 
 /*----------------------------------------------------------------------
-|    WaveFormatter_WriteWavHeader
+|    WaveFormatter_FormatWavHeader
 +---------------------------------------------------------------------*/
-static BLT_Result
-WaveFormatter_WriteWavHeader(WaveFormatter*          self, 
-                             const BLT_PcmMediaType* pcm_type)
+static void
+WaveFormatter_FormatWavHeader(WaveFormatter*          self, 
+                              const BLT_PcmMediaType* pcm_type,
+                              unsigned char*          header)
 {
-    unsigned char buffer[4];
-
     /* RIFF tag */
-    ATX_OutputStream_Write(self->output.stream, "RIFF", 4, NULL);
+    ATX_CopyMemory(header, "RIFF", 4);
 
     /* RIFF chunk size */
-    ATX_BytesFromInt32Le(buffer, (ATX_Size)self->input.size + 8+16+12);
-    ATX_OutputStream_Write(self->output.stream, buffer, 4, NULL);
+    ATX_BytesFromInt32Le(header+4, (ATX_Size)self->input.size + 8+16+12);
 
-    ATX_OutputStream_Write(self->output.stream, "WAVE", 4, NULL);
-
-    ATX_OutputStream_Write(self->output.stream, "fmt ", 4, NULL);
-
-    ATX_BytesFromInt32Le(buffer, 16L);
-    ATX_OutputStream_Write(self->output.stream, buffer, 4, NULL);
-
-    ATX_BytesFromInt16Le(buffer, WAVE_FORMAT_PCM);
-    ATX_OutputStream_Write(self->output.stream, buffer, 2, NULL);
+    ATX_CopyMemory(header+8,  "WAVE", 4);
+    ATX_CopyMemory(header+12, "fmt ", 4);
+    ATX_BytesFromInt32Le(header+16, 16L);
+    ATX_BytesFromInt16Le(header+20, WAVE_FORMAT_PCM);
 
     /* number of channels */
-    ATX_BytesFromInt16Le(buffer, (short)pcm_type->channel_count);        
-    ATX_OutputStream_Write(self->output.stream, buffer, 2, NULL);
+    ATX_BytesFromInt16Le(header+22, (short)pcm_type->channel_count);        
 
     /* sample rate */
-    ATX_BytesFromInt32Le(buffer, pcm_type->sample_rate);       
-    ATX_OutputStream_Write(self->output.stream, buffer, 4, NULL);
+    ATX_BytesFromInt32Le(header+24, pcm_type->sample_rate);       
 
     /* bytes per second */
-    ATX_BytesFromInt32Le(buffer, 
+    ATX_BytesFromInt32Le(header+28, 
                          pcm_type->sample_rate * 
                          pcm_type->channel_count * 
                          (pcm_type->bits_per_sample/8));
-    ATX_OutputStream_Write(self->output.stream, buffer, 4, NULL);
 
     /* alignment   */
-    ATX_BytesFromInt16Le(buffer, 
+    ATX_BytesFromInt16Le(header+32, 
                          (short)(pcm_type->channel_count * 
                                  (pcm_type->bits_per_sample/8)));     
-    ATX_OutputStream_Write(self->output.stream, buffer, 2, NULL);
 
     /* bits per sample */
-    ATX_BytesFromInt16Le(buffer, pcm_type->bits_per_sample);               
-    ATX_OutputStream_Write(self->output.stream, buffer, 2, NULL);
+    ATX_BytesFromInt16Le(header+34, pcm_type->bits_per_sample);               
 
-    ATX_OutputStream_Write(self->output.stream, "data", 4, NULL);
+    ATX_CopyMemory(header+36, "data", 4);
 
     /* data size */
-    ATX_BytesFromInt32Le(buffer, (ATX_Size)self->input.size);        
-    ATX_OutputStream_Write(self->output.stream, buffer, 4, NULL);
+    ATX_BytesFromInt32Le(header+40, (ATX_Size)self->input.size);        
+}
 
-    return BLT_SUCCESS;
+/*----------------------------------------------------------------------
+|    WaveFormatter_WriteWavHeader
++---------------------------------------------------------------------*/
+static BLT_Result
+WaveFormatter_WriteWavHeader(WaveFormatter*          self, 
+                             const BLT_PcmMediaType* pcm_type)
+{
+    unsigned char header[BLT_WAVE_FORMATTER_RIFF_HEADER_SIZE];
+
+    /* one write, rather than one per field */
+    WaveFormatter_FormatWavHeader(self, pcm_type, header);
+    return ATX_OutputStream_Write(self->output.stream, header, sizeof(header), NULL);
 }
 
 /*----------------------------------------------------------------------
@@ -144,22 +143,16 @@ WaveFormatter_WriteWavHeader(WaveFormatter*          self,
 static BLT_Result
 WaveFormatter_UpdateWavHeader(WaveFormatter* self)
 {
-    BLT_Result    result;
-    unsigned char buffer[4];
+    BLT_Result result;
 
     ATX_LOG_FINER_1("WaveFormatter::UpdateWavHeader - size = %lld", self->input.size);
 
-    result = ATX_OutputStream_Seek(self->output.stream, 4);
+    /* rewrite the whole header with one seek and one write */
+    result = ATX_OutputStream_Seek(self->output.stream, 0);
     if (BLT_FAILED(result)) return result;
-    ATX_BytesFromInt32Le(buffer, (ATX_Size)self->input.size + 8+16+12);
-    ATX_OutputStream_Write(self->output.stream, buffer, 4, NULL);
-
-    result = ATX_OutputStream_Seek(self->output.stream, 40);
+    result = WaveFormatter_WriteWavHeader(self, &self->input.media_type);
     if (BLT_FAILED(result)) return result;
 
-    ATX_BytesFromInt32Le(buffer, (ATX_Size)self->input.size);        
-    ATX_OutputStream_Write(self->output.stream, buffer, 4, NULL);
-
     ATX_LOG_FINER("WaveFormatter::UpdateWavHeader - updated");
 
     return BLT_SUCCESS;
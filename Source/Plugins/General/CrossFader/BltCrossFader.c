@@ -2,7 +2,7 @@
 |
 |   Cross Fader Module
 |
-|   (c) 2002-2006 Gilles Boccon-Gibod
+|   (c) 2002-2012 Gilles Boccon-Gibod
 |   Author: Gilles Boccon-Gibod (bok@bok.net)
 |
  ****************************************************************/
@@ -10,11 +10,14 @@
 /*----------------------------------------------------------------------
 |   includes
 +---------------------------------------------------------------------*/
+#include <math.h>
+
 #include "Atomix.h"
-#include "Fluo.h"
 #include "BltConfig.h"
 #include "BltCore.h"
 #include "BltCrossFader.h"
+#include "BltCrossFade.h"
+#include "BltPcmFloat.h"
 #include "BltMediaNode.h"
 #include "BltMedia.h"
 #include "BltPcm.h"
@@ -22,288 +25,733 @@
 #include "BltPacketConsumer.h"
 #include "BltStream.h"
 
-#include <math.h>
-
 /*----------------------------------------------------------------------
 |   logging
 +---------------------------------------------------------------------*/
 ATX_SET_LOCAL_LOGGER("bluetune.plugins.general.cross-fader")
 
 /*----------------------------------------------------------------------
-|   forward declarations
+|    types
 +---------------------------------------------------------------------*/
-ATX_DECLARE_SIMPLE_GET_INTERFACE_IMPLEMENTATION(CrossFaderModule)
-static const BLT_ModuleInterface CrossFaderModule_BLT_ModuleInterface;
-
-ATX_DECLARE_SIMPLE_GET_INTERFACE_IMPLEMENTATION(CrossFader)
-static const BLT_MediaNodeInterface CrossFader_BLT_MediaNodeInterface;
-static const ATX_PropertyListenerInterface 
-CrossFader_ATX_PropertyListenerInterface;
+typedef BLT_BaseModule CrossFaderModule;
 
-ATX_DECLARE_SIMPLE_GET_INTERFACE_IMPLEMENTATION(CrossFaderInputPort)
+typedef struct {
+    /* interfaces */
+    ATX_IMPLEMENTS(BLT_MediaPort);
+    ATX_IMPLEMENTS(BLT_PacketConsumer);
+} CrossFaderInput;
 
-ATX_DECLARE_SIMPLE_GET_INTERFACE_IMPLEMENTATION(CrossFaderOutputPort)
+typedef struct {
+    /* interfaces */
+    ATX_IMPLEMENTS(BLT_MediaPort);
+    ATX_IMPLEMENTS(BLT_PacketProducer);
 
-/*----------------------------------------------------------------------
-|    constants
-+---------------------------------------------------------------------*/
-#define CROSS_FADER_PACKET_SIZE 4096
+    /* members */
+    ATX_List* packets;
+} CrossFaderOutput;
 
-/*----------------------------------------------------------------------
-|    types
-+---------------------------------------------------------------------*/
 typedef struct {
-    BLT_BaseModule base;
-} CrossFaderModule;
+    BLT_Boolean      configured;
+    BLT_PcmMediaType format;
+    BLT_Size         frame_size;
+    BLT_Cardinal     capacity;        /* length of the fade, in frames             */
+
+    /* the last frames of the track, held back until the track ends */
+    unsigned char*   ring;            /* capacity frames                           */
+    BLT_Ordinal      ring_start;      /* oldest frame                              */
+    BLT_Cardinal     ring_count;
+    BLT_TimeStamp    ring_time_stamp; /* time stamp of the oldest frame            */
+    BLT_Flags        held_flags;      /* flags of the packets that the ring took   */
+
+    /* work buffers */
+    float*           tail;            /* end of the track, capacity frames         */
+    float*           head;            /* start of the next track, capacity frames  */
+    float*           gains;           /* capacity gains                            */
+    void*            memory;
+
+    /* output of the fade, allocated before it is needed */
+    BLT_MediaPacket* fade_packet;
+} CrossFaderState;
 
 typedef struct {
-    BLT_PcmMediaType media_type;
-    ATX_RingBuffer*  buffer;
-    ATX_Size         position;
-} CrossFaderInputPort;
+    BLT_Boolean      active;
+    BLT_Cardinal     tail_frames;     /* frames of the track to mix                */
+    BLT_Cardinal     head_frames;     /* frames of the next track collected        */
+    BLT_Cardinal     skipped_frames;  /* silence skipped at the start of the next  */
+    BLT_Boolean      ended;           /* the next track ended during the fade      */
+    BLT_MediaPacket* rest;            /* what was not collected of the last packet */
+} CrossFaderFade;
 
 typedef struct {
-    ATX_List* packets;
-} CrossFaderOutputPort;
+    /* base class */
+    ATX_EXTENDS(BLT_BaseMediaNode);
 
-typedef enum {
-    CROSS_FADER_STATE_IN_START,
-    CROSS_FADER_STATE_IN_MAIN
-} CrossFaderState;
+    /* interfaces */
+    ATX_IMPLEMENTS(ATX_PropertyListener);
 
-typedef struct {
-    BLT_BaseMediaNode          base;
-    BLT_Stream                 context;
-    CrossFaderInputPort        input;
-    CrossFaderOutputPort       output;
+    /* members */
+    CrossFaderInput            input;
+    CrossFaderOutput           output;
     CrossFaderState            state;
-    ATX_PropertyListenerHandle listener_handle;
+    CrossFaderFade             fade;
+    BLT_PacketProducer*        source;  /* track played in place of the input */
+    BLT_PacketProducer*        next;    /* track that follows                 */
+    BLT_TimeStamp              next_time_stamp;
+    struct {
+        BLT_Cardinal       duration;    /* ms     */
+        BLT_CrossFadeCurve curve;
+        float              threshold;   /* linear */
+    } settings;
+    ATX_PropertyListenerHandle listener_handles[4];
 } CrossFader;
 
 /*----------------------------------------------------------------------
-|    CrossFader_SetupInput
+|    constants
++---------------------------------------------------------------------*/
+static const char* const CrossFader_Settings[4] = {
+    BLT_CROSS_FADER_NEXT_SOURCE,
+    BLT_CROSS_FADER_DURATION,
+    BLT_CROSS_FADER_CURVE,
+    BLT_CROSS_FADER_SILENCE_THRESHOLD
+};
+
+/*----------------------------------------------------------------------
+|   forward declarations
++---------------------------------------------------------------------*/
+ATX_DECLARE_INTERFACE_MAP(CrossFaderModule, BLT_Module)
+ATX_DECLARE_INTERFACE_MAP(CrossFader, BLT_MediaNode)
+ATX_DECLARE_INTERFACE_MAP(CrossFader, ATX_Referenceable)
+ATX_DECLARE_INTERFACE_MAP(CrossFader, ATX_PropertyListener)
+
+/*----------------------------------------------------------------------
+|    CrossFader_GetCapacity
++---------------------------------------------------------------------*/
+static BLT_Cardinal
+CrossFader_GetCapacity(CrossFader* self, BLT_Cardinal sample_rate)
+{
+    return (BLT_Cardinal)(((ATX_UInt64)self->settings.duration*sample_rate)/1000);
+}
+
+/*----------------------------------------------------------------------
+|    CrossFader_PrepareFade
++---------------------------------------------------------------------*/
+static void
+CrossFader_PrepareFade(CrossFader* self)
+{
+    CrossFaderState* state = &self->state;
+
+    /* the fade packet is created as soon as a next track is known, */
+    /* so that nothing needs to be allocated when the track ends    */
+    if (!state->configured || state->capacity == 0 ||
+        self->next == NULL || state->fade_packet) {
+        return;
+    }
+    if (BLT_FAILED(BLT_Core_CreateMediaPacket(ATX_BASE(self, BLT_BaseMediaNode).core,
+                                              state->capacity*state->frame_size,
+                                              (const BLT_MediaType*)&state->format,
+                                              &state->fade_packet))) {
+        state->fade_packet = NULL;
+    }
+}
+
+/*----------------------------------------------------------------------
+|    CrossFader_GetFadePacket
 +---------------------------------------------------------------------*/
 static BLT_Result
-CrossFader_SetupInput(CrossFader* fader, BLT_PcmMediaType* media_type)
+CrossFader_GetFadePacket(CrossFader* self, BLT_MediaPacket** packet)
 {
-    ATX_Result result;
+    CrossFaderState* state = &self->state;
 
-    /* check the media type */
-    if (media_type->base.id != BLT_MEDIA_TYPE_ID_AUDIO_PCM) {
-        return BLT_ERROR_INVALID_MEDIA_TYPE;
+    if (state->fade_packet) {
+        *packet = state->fade_packet;
+        state->fade_packet = NULL;
+        return BLT_SUCCESS;
     }
+    return BLT_Core_CreateMediaPacket(ATX_BASE(self, BLT_BaseMediaNode).core,
+                                      state->capacity*state->frame_size,
+                                      (const BLT_MediaType*)&state->format,
+                                      packet);
+}
 
-    /* clone the media type parameters */
-    fader->input.media_type = *(BLT_PcmMediaType*)media_type;
-    BLT_Debug("CrossFader_SetupInput - %dHz, %dch\n", 
-              fader->input.media_type.sample_rate,
-              fader->input.media_type.channel_count);
+/*----------------------------------------------------------------------
+|    CrossFader_FreeState
++---------------------------------------------------------------------*/
+static void
+CrossFader_FreeState(CrossFader* self)
+{
+    if (self->state.fade_packet) BLT_MediaPacket_Release(self->state.fade_packet);
+    if (self->state.memory) ATX_FreeMemory(self->state.memory);
+    ATX_SetMemory(&self->state, 0, sizeof(self->state));
+}
 
-    /* reset the ring buffer */
-    if (fader->input.buffer) {
-        ATX_RingBuffer_Destroy(fader->input.buffer);
-        fader->input.buffer = NULL;
+/*----------------------------------------------------------------------
+|    CrossFader_Configure
++---------------------------------------------------------------------*/
+static BLT_Result
+CrossFader_Configure(CrossFader* self, const BLT_PcmMediaType* format)
+{
+    CrossFaderState* state         = &self->state;
+    BLT_Cardinal     channel_count = format->channel_count;
+    BLT_Cardinal     capacity      = CrossFader_GetCapacity(self, format->sample_rate);
+    BLT_Size         frame_size    = channel_count*format->bits_per_sample/8;
+
+    CrossFader_FreeState(self);
+
+    /* all the buffers in one allocation, the floats first */
+    if (capacity) {
+        state->memory = ATX_AllocateMemory(sizeof(float)*capacity*(2*channel_count+1)+
+                                           capacity*frame_size);
+        if (state->memory == NULL) return BLT_ERROR_OUT_OF_MEMORY;
+        state->tail  = (float*)state->memory;
+        state->head  = state->tail+capacity*channel_count;
+        state->gains = state->head+capacity*channel_count;
+        state->ring  = (unsigned char*)(state->gains+capacity);
     }
-    result = ATX_RingBuffer_Create(44100*4*10, &fader->input.buffer);
-    if (ATX_FAILED(result)) return result;
-    
-    /* reset other parameters */
-    fader->input.position = 0;
-    fader->state = CROSS_FADER_STATE_IN_START;
+
+    state->format     = *format;
+    state->frame_size = frame_size;
+    state->capacity   = capacity;
+    state->configured = BLT_TRUE;
+
+    ATX_LOG_FINE_3("CrossFader::Configure - %d Hz, %d channels, %d frames",
+                   (int)format->sample_rate, (int)channel_count, (int)capacity);
+
+    CrossFader_PrepareFade(self);
 
     return BLT_SUCCESS;
 }
 
 /*----------------------------------------------------------------------
-|    CrossFader_PromotePacket
+|    CrossFader_GetRingSegment
+|
+|    Returns how many of the count frames that start first frames after
+|    the oldest one are contiguous in the ring.
++---------------------------------------------------------------------*/
+static BLT_Cardinal
+CrossFader_GetRingSegment(const CrossFaderState* state,
+                          BLT_Ordinal            first,
+                          BLT_Cardinal           count,
+                          unsigned char**        frames)
+{
+    BLT_Ordinal  position = (state->ring_start+first)%state->capacity;
+    BLT_Cardinal chunk    = state->capacity-position;
+
+    *frames = state->ring+position*state->frame_size;
+    return chunk < count ? chunk : count;
+}
+
+/*----------------------------------------------------------------------
+|    CrossFader_CopyFromRing
++---------------------------------------------------------------------*/
+static void
+CrossFader_CopyFromRing(const CrossFaderState* state,
+                        BLT_Ordinal            first,
+                        BLT_Cardinal           count,
+                        unsigned char*         out)
+{
+    while (count) {
+        unsigned char* frames;
+        BLT_Cardinal   chunk = CrossFader_GetRingSegment(state, first, count, &frames);
+        ATX_CopyMemory(out, frames, chunk*state->frame_size);
+        out   += chunk*state->frame_size;
+        first += chunk;
+        count -= chunk;
+    }
+}
+
+/*----------------------------------------------------------------------
+|    CrossFader_QueuePacket
 +---------------------------------------------------------------------*/
 static BLT_Result
-CrossFader_PromotePacket(CrossFader* fader, BLT_Size size) 
+CrossFader_QueuePacket(CrossFader* self, BLT_MediaPacket* packet)
 {
+    BLT_Result result = ATX_List_AddData(self->output.packets, packet);
+    if (BLT_FAILED(result)) BLT_MediaPacket_Release(packet);
+    return result;
+}
+
+/*----------------------------------------------------------------------
+|    CrossFader_Discard
++---------------------------------------------------------------------*/
+static void
+CrossFader_Discard(CrossFader* self)
+{
+    self->state.ring_start = 0;
+    self->state.ring_count = 0;
+    self->state.held_flags = 0;
+    if (self->fade.rest) BLT_MediaPacket_Release(self->fade.rest);
+    ATX_SetMemory(&self->fade, 0, sizeof(self->fade));
+}
+
+/*----------------------------------------------------------------------
+|    CrossFader_Release
+|
+|    Outputs the frames held back, unmodified.
++---------------------------------------------------------------------*/
+static BLT_Result
+CrossFader_Release(CrossFader* self)
+{
+    CrossFaderState* state = &self->state;
     BLT_MediaPacket* packet;
-    unsigned char*   payload;
     BLT_Result       result;
 
-    ATX_LOG_FINER_1("CrossFader::PromotePacket - size = %d", size);
-    
-    /* create a packet */
-    result = BLT_Core_CreateMediaPacket(&fader->base.core,
-                                        size,
-                                        (const BLT_MediaType*)&fader->input.media_type,
-                                        &packet);
-    if (BLT_FAILED(result)) return result;
-
-    /* get the addr of the buffer */
-    payload = BLT_MediaPacket_GetPayloadBuffer(packet);
+    if (state->ring_count == 0) return BLT_SUCCESS;
 
-    /* read the data from the input ring buffer */
-    result = ATX_RingBuffer_Read(fader->input.buffer, payload, size);
+    result = CrossFader_GetFadePacket(self, &packet);
     if (BLT_FAILED(result)) {
-        BLT_MediaPacket_Release(packet);
+        CrossFader_Discard(self);
         return result;
     }
+    BLT_MediaPacket_SetPayloadSize(packet, state->ring_count*state->frame_size);
+    CrossFader_CopyFromRing(state,
+                            0,
+                            state->ring_count,
+                            (unsigned char*)BLT_MediaPacket_GetPayloadBuffer(packet));
+    BLT_MediaPacket_SetTimeStamp(packet, state->ring_time_stamp);
+    BLT_MediaPacket_SetDuration(packet,
+        BLT_TimeStamp_FromSamples(state->ring_count, state->format.sample_rate));
+    BLT_MediaPacket_SetFlags(packet, state->held_flags);
+    CrossFader_Discard(self);
+    CrossFader_PrepareFade(self);
+
+    return CrossFader_QueuePacket(self, packet);
+}
 
-    /* update the size of the packet */
-    BLT_MediaPacket_SetPayloadSize(packet, size);
+/*----------------------------------------------------------------------
+|    CrossFader_PassThrough
++---------------------------------------------------------------------*/
+static BLT_Result
+CrossFader_PassThrough(CrossFader*             self,
+                       BLT_MediaPacket*        packet,
+                       const BLT_PcmMediaType* media_type)
+{
+    BLT_TimeStamp time_stamp = BLT_MediaPacket_GetTimeStamp(packet);
 
-    /* make the packet ready for the output */
-    ATX_List_AddData(fader->output.packets, packet);
+    /* keep track of the media time, in case we start holding frames back */
+    if (time_stamp.seconds || time_stamp.nanoseconds) {
+        self->next_time_stamp = time_stamp;
+    }
+    if (media_type->sample_rate && media_type->channel_count && media_type->bits_per_sample) {
+        BLT_Cardinal frame_count = BLT_MediaPacket_GetPayloadSize(packet)/
+                                   (media_type->channel_count*media_type->bits_per_sample/8);
+        self->next_time_stamp = BLT_TimeStamp_Add(self->next_time_stamp,
+            BLT_TimeStamp_FromSamples(frame_count, media_type->sample_rate));
+    }
 
-    return BLT_SUCCESS;
+    /* without a fade, the next track simply follows this one */
+    if ((BLT_MediaPacket_GetFlags(packet) & BLT_MEDIA_PACKET_FLAG_END_OF_STREAM) &&
+        self->next) {
+        BLT_MediaPacket_ClearFlags(packet, BLT_MEDIA_PACKET_FLAG_END_OF_STREAM);
+        self->source = self->next;
+        self->next   = NULL;
+        ATX_LOG_FINE("CrossFader::PassThrough - next track, no fade");
+    }
+
+    BLT_MediaPacket_AddReference(packet);
+    return CrossFader_QueuePacket(self, packet);
+}
+
+/*----------------------------------------------------------------------
+|    CrossFader_CollectHead
+|
+|    Takes the start of the next track, after its leading silence.
+|    What can't be mixed is left in fade.rest.
++---------------------------------------------------------------------*/
+static void
+CrossFader_CollectHead(CrossFader* self, BLT_MediaPacket* packet)
+{
+    CrossFaderState*  state = &self->state;
+    CrossFaderFade*   fade  = &self->fade;
+    BLT_PcmMediaType* media_type;
+    BLT_Cardinal      channel_count = state->format.channel_count;
+    BLT_Size          frame_size;
+    BLT_Cardinal      frame_count;
+    BLT_Cardinal      count;
+    float*            head;
+
+    /* only the same rate and channels can be mixed */
+    if (BLT_FAILED(BLT_MediaPacket_GetMediaType(packet,
+                                                (const BLT_MediaType**)(const void*)&media_type)) ||
+        media_type->base.id       != BLT_MEDIA_TYPE_ID_AUDIO_PCM  ||
+        !BLT_PcmFloat_SupportsFormat(media_type)                  ||
+        media_type->sample_rate   != state->format.sample_rate    ||
+        media_type->channel_count != channel_count) {
+        fade->rest = packet;
+        return;
+    }
+    frame_size  = channel_count*media_type->bits_per_sample/8;
+    frame_count = BLT_MediaPacket_GetPayloadSize(packet)/frame_size;
+    count       = state->capacity-fade->head_frames;
+    if (count > frame_count) count = frame_count;
+
+    head = state->head+fade->head_frames*channel_count;
+    BLT_PcmFloat_Import(media_type,
+                        BLT_MediaPacket_GetPayloadBuffer(packet),
+                        count*channel_count,
+                        head);
+
+    /* skip the silence at the start, up to the length of the fade */
+    if (fade->head_frames == 0 && fade->skipped_frames < state->capacity) {
+        BLT_Cardinal silence = BLT_CrossFade_GetLeadingSilence(head,
+                                                               count,
+                                                               channel_count,
+                                                               self->settings.threshold);
+        BLT_Ordinal  i;
+        if (silence > state->capacity-fade->skipped_frames) {
+            silence = state->capacity-fade->skipped_frames;
+        }
+        for (i=0; i<(count-silence)*channel_count; i++) {
+            head[i] = head[i+silence*channel_count];
+        }
+        fade->skipped_frames += silence;
+        fade->head_frames    += count-silence;
+    } else {
+        fade->head_frames += count;
+    }
+
+    /* keep what doesn't fit for after the fade */
+    if (count < frame_count) {
+        BLT_MediaPacket_SetPayloadOffset(packet,
+                                         BLT_MediaPacket_GetPayloadOffset(packet)+count*frame_size);
+        BLT_MediaPacket_SetTimeStamp(packet,
+                                     BLT_TimeStamp_Add(BLT_MediaPacket_GetTimeStamp(packet),
+                                                       BLT_TimeStamp_FromSamples(count, media_type->sample_rate)));
+        fade->rest = packet;
+        return;
+    }
+
+    if (BLT_MediaPacket_GetFlags(packet) & BLT_MEDIA_PACKET_FLAG_END_OF_STREAM) {
+        fade->ended = BLT_TRUE;
+    }
+    BLT_MediaPacket_Release(packet);
 }
 
 /*----------------------------------------------------------------------
-|    CrossFader_Flush
+|    CrossFader_FinishFade
 +---------------------------------------------------------------------*/
 static BLT_Result
-CrossFader_Flush(CrossFader* fader)
+CrossFader_FinishFade(CrossFader* self)
 {
-    BLT_Size   buffered;
-    BLT_Result result;
+    CrossFaderState* state         = &self->state;
+    CrossFaderFade*  fade          = &self->fade;
+    BLT_Cardinal     channel_count = state->format.channel_count;
+    BLT_Size         frame_size    = state->frame_size;
+    BLT_Cardinal     tail_frames   = fade->tail_frames;
+    BLT_Cardinal     head_frames   = fade->head_frames;
+    BLT_Cardinal     overlap       = tail_frames < head_frames ? tail_frames : head_frames;
+    BLT_Cardinal     total         = tail_frames > head_frames ? tail_frames : head_frames;
+    BLT_MediaPacket* rest          = fade->rest;
+    BLT_MediaPacket* packet;
+    unsigned char*   out;
+    BLT_Result       result;
 
-    /* shortcut */
-    if (fader->input.buffer == NULL) return BLT_SUCCESS;
+    ATX_LOG_FINE_3("CrossFader::FinishFade - tail=%d, head=%d, skipped=%d",
+                   (int)tail_frames, (int)head_frames, (int)fade->skipped_frames);
 
-    /* see how much data we have */
-    buffered = ATX_RingBuffer_GetAvailable(fader->input.buffer);
-    
-    /* output the data as packets */
-    while (buffered) {
-        BLT_Size packet_size;
-        if (buffered >= CROSS_FADER_PACKET_SIZE) {
-            packet_size = CROSS_FADER_PACKET_SIZE;
+    if (fade->ended) self->source = NULL;
+    fade->rest = NULL;
+
+    result = CrossFader_GetFadePacket(self, &packet);
+    if (BLT_FAILED(result)) {
+        if (rest) BLT_MediaPacket_Release(rest);
+        CrossFader_Discard(self);
+        return result;
+    }
+    BLT_MediaPacket_SetPayloadSize(packet, total*frame_size);
+    out = (unsigned char*)BLT_MediaPacket_GetPayloadBuffer(packet);
+
+    /* the start of the tail, as is */
+    CrossFader_CopyFromRing(state, 0, tail_frames-overlap, out);
+
+    /* the end of the tail, mixed with the start of the head */
+    BLT_CrossFade_ComputeGains(self->settings.curve, state->gains, overlap);
+    BLT_CrossFade_Mix(state->tail+(tail_frames-overlap)*channel_count,
+                      state->head,
+                      state->gains,
+                      overlap,
+                      channel_count);
+    BLT_PcmFloat_Export(&state->format,
+                        state->tail+(tail_frames-overlap)*channel_count,
+                        overlap*channel_count,
+                        out+(tail_frames-overlap)*frame_size);
+
+    /* the rest of the head */
+    BLT_PcmFloat_Export(&state->format,
+                        state->head+overlap*channel_count,
+                        (head_frames-overlap)*channel_count,
+                        out+tail_frames*frame_size);
+
+    BLT_MediaPacket_SetTimeStamp(packet, state->ring_time_stamp);
+    BLT_MediaPacket_SetDuration(packet,
+        BLT_TimeStamp_FromSamples(total, state->format.sample_rate));
+    BLT_MediaPacket_SetFlags(packet,
+                             state->held_flags |
+                             (fade->ended?BLT_MEDIA_PACKET_FLAG_END_OF_STREAM:0));
+    self->next_time_stamp = BLT_TimeStamp_Add(state->ring_time_stamp,
+        BLT_TimeStamp_FromSamples(total, state->format.sample_rate));
+    CrossFader_Discard(self);
+    CrossFader_PrepareFade(self);
+
+    /* nothing to mix, and nothing to signal */
+    if (total == 0 && BLT_MediaPacket_GetFlags(packet) == 0) {
+        BLT_MediaPacket_Release(packet);
+        result = BLT_SUCCESS;
+    } else {
+        result = CrossFader_QueuePacket(self, packet);
+    }
+    if (rest) {
+        if (BLT_SUCCEEDED(result)) {
+            result = CrossFader_QueuePacket(self, rest);
         } else {
-            packet_size = buffered;
+            BLT_MediaPacket_Release(rest);
         }
-        result = CrossFader_PromotePacket(fader, packet_size);
-        if (BLT_FAILED(result)) return result;
-        buffered -= packet_size;
     }
 
-    return BLT_SUCCESS;
+    return result;
 }
 
 /*----------------------------------------------------------------------
-|    CrossFader_BufferPacket
+|    CrossFader_ContinueFade
 +---------------------------------------------------------------------*/
 static BLT_Result
-CrossFader_BufferPacket(CrossFader* fader, BLT_MediaPacket* packet)
+CrossFader_ContinueFade(CrossFader* self)
 {
-    BLT_Size   space;
-    BLT_Size   payload_size;
-    BLT_Any    payload_buffer;
-
-    /* quick check */
-    if (fader->input.buffer == NULL) return BLT_SUCCESS;
-
-    /* see how much data we have */
-    payload_size   = BLT_MediaPacket_GetPayloadSize(packet);
-    payload_buffer = BLT_MediaPacket_GetPayloadBuffer(packet);
-
-    /* shortcut */
-    if (payload_size == 0) return BLT_SUCCESS;
-
-    /* ensure that we have enough space in the buffer */
-    space = ATX_RingBuffer_GetSpace(fader->input.buffer);
-    if (space < payload_size) {
-        /* not enough space */
-        BLT_Size available = ATX_RingBuffer_GetAvailable(fader->input.buffer);
-        if (available >= payload_size) {
-            CrossFader_PromotePacket(fader, payload_size);
+    CrossFaderFade* fade = &self->fade;
+
+    while (fade->head_frames < self->state.capacity && !fade->rest && !fade->ended) {
+        BLT_MediaPacket* packet = NULL;
+        BLT_Result       result;
+
+        result = BLT_PacketProducer_GetPacket(self->source, &packet);
+        if (result == BLT_ERROR_PORT_HAS_NO_DATA || result == BLT_ERROR_WOULD_BLOCK) {
+            /* try again later, the fade has what it collected so far */
+            return BLT_ERROR_WOULD_BLOCK;
+        }
+        if (BLT_FAILED(result) || packet == NULL) {
+            fade->ended = BLT_TRUE;
+            break;
+        }
+        BLT_MediaPacket_ClearFlags(packet, BLT_MEDIA_PACKET_FLAG_START_OF_STREAM);
+        CrossFader_CollectHead(self, packet);
+    }
+
+    return CrossFader_FinishFade(self);
+}
+
+/*----------------------------------------------------------------------
+|    CrossFader_StartFade
++---------------------------------------------------------------------*/
+static BLT_Result
+CrossFader_StartFade(CrossFader* self)
+{
+    CrossFaderState* state         = &self->state;
+    BLT_Cardinal     channel_count = state->format.channel_count;
+    BLT_Ordinal      first;
+
+    self->source = self->next;
+    self->next   = NULL;
+
+    ATX_SetMemory(&self->fade, 0, sizeof(self->fade));
+    self->fade.active = BLT_TRUE;
+
+    /* the end of the track, without its trailing silence */
+    for (first=0; first<state->ring_count;) {
+        unsigned char* frames;
+        BLT_Cardinal   chunk = CrossFader_GetRingSegment(state,
+                                                         first,
+                                                         state->ring_count-first,
+                                                         &frames);
+        BLT_PcmFloat_Import(&state->format,
+                            frames,
+                            chunk*channel_count,
+                            state->tail+first*channel_count);
+        first += chunk;
+    }
+    self->fade.tail_frames = state->ring_count-
+                             BLT_CrossFade_GetTrailingSilence(state->tail,
+                                                              state->ring_count,
+                                                              channel_count,
+                                                              self->settings.threshold);
+
+    return CrossFader_ContinueFade(self);
+}
+
+/*----------------------------------------------------------------------
+|    CrossFader_Delay
+|
+|    Holds back the last capacity frames, so that they can be mixed
+|    with the next track when the stream ends. The packet leaves with
+|    the frames that come out of the ring in place of its own.
++---------------------------------------------------------------------*/
+static BLT_Result
+CrossFader_Delay(CrossFader* self, BLT_MediaPacket* packet)
+{
+    CrossFaderState* state       = &self->state;
+    BLT_Size         frame_size  = state->frame_size;
+    BLT_Flags        flags       = BLT_MediaPacket_GetFlags(packet);
+    BLT_Cardinal     frame_count = BLT_MediaPacket_GetPayloadSize(packet)/frame_size;
+    unsigned char*   frames      = (unsigned char*)BLT_MediaPacket_GetPayloadBuffer(packet);
+    unsigned char*   scratch;
+    BLT_Cardinal     count;
+    BLT_Ordinal      first;
+
+    /* the ring starts where the packet starts */
+    if (state->ring_count == 0) {
+        BLT_TimeStamp time_stamp = BLT_MediaPacket_GetTimeStamp(packet);
+        if (time_stamp.seconds || time_stamp.nanoseconds) {
+            state->ring_time_stamp = time_stamp;
         } else {
-            CrossFader_PromotePacket(fader, available);
+            state->ring_time_stamp = self->next_time_stamp;
+        }
+    }
+    self->next_time_stamp = BLT_TimeStamp_Add(state->ring_time_stamp,
+        BLT_TimeStamp_FromSamples(state->ring_count+frame_count, state->format.sample_rate));
+    state->held_flags |= flags & ~BLT_MEDIA_PACKET_FLAG_END_OF_STREAM;
+
+    /* fill the ring first */
+    count = state->capacity-state->ring_count;
+    if (count > frame_count) count = frame_count;
+    for (first=0; first<count;) {
+        unsigned char* slot;
+        BLT_Cardinal   chunk = CrossFader_GetRingSegment(state,
+                                                         state->ring_count,
+                                                         count-first,
+                                                         &slot);
+        ATX_CopyMemory(slot, frames+first*frame_size, chunk*frame_size);
+        state->ring_count += chunk;
+        first             += chunk;
+    }
+    frames      += count*frame_size;
+    frame_count -= count;
+
+    if (frame_count) {
+        BLT_MediaPacket_SetPayloadOffset(packet,
+                                         BLT_MediaPacket_GetPayloadOffset(packet)+count*frame_size);
+        BLT_MediaPacket_SetPayloadSize(packet, frame_count*frame_size);
+
+        /* the newest frames of the packet go to the ring, in place of */
+        /* the oldest ones, which come out at the start of the packet. */
+        /* The work buffers aren't used until the fade, so the newest  */
+        /* frames wait in there                                        */
+        count   = frame_count < state->capacity ? frame_count : state->capacity;
+        scratch = (unsigned char*)state->tail;
+        ATX_CopyMemory(scratch, frames+(frame_count-count)*frame_size, count*frame_size);
+
+        /* what is left of the packet moves after the frames of the ring, */
+        /* a block at a time from the end: the blocks are never larger    */
+        /* than the distance they move by, so they don't overlap          */
+        for (first=frame_count-count; first;) {
+            BLT_Cardinal chunk = first < count ? first : count;
+            first -= chunk;
+            ATX_CopyMemory(frames+(first+count)*frame_size,
+                           frames+first*frame_size,
+                           chunk*frame_size);
         }
-        space = ATX_RingBuffer_GetSpace(fader->input.buffer);
-        if (space < payload_size) {
-            /* we can't handle it */
-            return BLT_FAILURE;
+
+        for (first=0; first<count;) {
+            unsigned char* slot;
+            BLT_Cardinal   chunk = CrossFader_GetRingSegment(state, first, count-first, &slot);
+            ATX_CopyMemory(frames+first*frame_size, slot, chunk*frame_size);
+            ATX_CopyMemory(slot, scratch+first*frame_size, chunk*frame_size);
+            first += chunk;
         }
+        state->ring_start = (state->ring_start+count)%state->capacity;
+
+        BLT_MediaPacket_SetTimeStamp(packet, state->ring_time_stamp);
+        BLT_MediaPacket_SetDuration(packet,
+            BLT_TimeStamp_FromSamples(frame_count, state->format.sample_rate));
+        BLT_MediaPacket_ClearFlags(packet, BLT_MEDIA_PACKET_FLAG_END_OF_STREAM);
+        BLT_MediaPacket_SetFlags(packet, state->held_flags);
+        state->held_flags      = 0;
+        state->ring_time_stamp = BLT_TimeStamp_Add(state->ring_time_stamp,
+            BLT_TimeStamp_FromSamples(frame_count, state->format.sample_rate));
+
+        BLT_MediaPacket_AddReference(packet);
+        CrossFader_QueuePacket(self, packet);
     }
 
-    /* copy the data to the input buffer */
-    ATX_LOG_FINER_1("CrossFader::BufferPacket - buffering %d", payload_size);
-    ATX_RingBuffer_Write(fader->input.buffer, payload_buffer, payload_size);
+    /* the end of the track is mixed with the start of the next one */
+    if (flags & BLT_MEDIA_PACKET_FLAG_END_OF_STREAM) {
+        return CrossFader_StartFade(self);
+    }
 
     return BLT_SUCCESS;
 }
 
 /*----------------------------------------------------------------------
-|    CrossFaderInputPort_PutPacket
+|    CrossFader_Process
 +---------------------------------------------------------------------*/
-BLT_METHOD
-CrossFaderInputPort_PutPacket(BLT_PacketConsumerInstance* instance,
-                              BLT_MediaPacket*            packet)
+static BLT_Result
+CrossFader_Process(CrossFader* self, BLT_MediaPacket* packet)
 {
-    CrossFader*       fader = (CrossFader*)instance;
     BLT_PcmMediaType* media_type;
-    ATX_Result        result;
-
-    ATX_LOG_FINER_1("CrossFaderInputPort::PutPacket - state = %s",
-                    fader->state == CROSS_FADER_STATE_IN_START ? "START" :
-                    fader->state == CROSS_FADER_STATE_IN_MAIN ? "MAIN" :
-                    "???");
+    BLT_Result        result;
 
     /* get the media type */
-    result = BLT_MediaPacket_GetMediaType(packet, (const BLT_MediaType**)&media_type);
+    result = BLT_MediaPacket_GetMediaType(packet, (const BLT_MediaType**)(const void*)&media_type);
     if (BLT_FAILED(result)) return result;
 
-    /* check the if media type is PCM */
+    /* check the media type */
     if (media_type->base.id != BLT_MEDIA_TYPE_ID_AUDIO_PCM) {
         return BLT_ERROR_INVALID_MEDIA_TYPE;
     }
 
-    /* check if the media type has changed */
-    if (media_type->sample_rate     != fader->input.media_type.sample_rate     ||
-        media_type->channel_count   != fader->input.media_type.channel_count   ||
-        media_type->bits_per_sample != fader->input.media_type.bits_per_sample ||
-        media_type->sample_format   != fader->input.media_type.sample_format) {
-        /* media type has changed */
-        ATX_LOG_FINER("CrossFaderInputPort::PutPacket - new media type");
-        CrossFader_Flush(fader);
-        result = CrossFader_SetupInput(fader, media_type);
+    /* formats that we can't mix pass through unmodified */
+    if (!BLT_PcmFloat_SupportsFormat(media_type) ||
+        media_type->channel_count == 0 ||
+        media_type->channel_count > BLT_CROSS_FADE_MAX_CHANNELS ||
+        media_type->sample_rate == 0) {
+        CrossFader_Release(self);
+        return CrossFader_PassThrough(self, packet, media_type);
+    }
+
+    /* a new format, or a new duration, starts from scratch */
+    if (!self->state.configured ||
+        self->state.format.sample_rate     != media_type->sample_rate     ||
+        self->state.format.channel_count   != media_type->channel_count   ||
+        self->state.format.bits_per_sample != media_type->bits_per_sample ||
+        self->state.format.sample_format   != media_type->sample_format   ||
+        self->state.capacity != CrossFader_GetCapacity(self, media_type->sample_rate)) {
+        CrossFader_Release(self);
+        result = CrossFader_Configure(self, media_type);
         if (BLT_FAILED(result)) return result;
     }
+    
+    /* frames are only held back when there is something to mix them with */
+    if (self->next && self->state.capacity) {
+        return CrossFader_Delay(self, packet);
+    }
+    CrossFader_Release(self);
+    return CrossFader_PassThrough(self, packet, media_type);
+}
 
-    /* decide what to do with the packet */
-    switch (fader->state) {
-      case CROSS_FADER_STATE_IN_START:
-        {
-            unsigned int sample;
-            BLT_Size size = BLT_MediaPacket_GetPayloadSize(packet);
-            short* samples = (short*)BLT_MediaPacket_GetPayloadBuffer(packet);
-            float pos = (float)fader->input.position/(float)(44100*4*10);
-            float factor = (float)pow(10.0f, -(30.0f-pos*30.0f)/20.0f);
-            ATX_LOG_FINDER_1("CrossFaderInputPort::PutPacket - factor = %f", factor);
-            for (sample = 0; sample < size/2; sample++) {
-                *samples = (short)(((float)*samples)*factor);
-                samples++;
-            }
-            fader->input.position += size;
-            if (fader->input.position >= 44100*4*10) {
-                fader->input.position = 0;
-                fader->state = CROSS_FADER_STATE_IN_MAIN;
-            }
-        }
-        CrossFader_BufferPacket(fader, packet);
-        break;
+/*----------------------------------------------------------------------
+|    CrossFaderInput_PutPacket
++---------------------------------------------------------------------*/
+BLT_METHOD
+CrossFaderInput_PutPacket(BLT_PacketConsumer* _self,
+                          BLT_MediaPacket*    packet)
+{
+    CrossFader* self = ATX_SELF_M(input, CrossFader, BLT_PacketConsumer);
 
-      case CROSS_FADER_STATE_IN_MAIN:
-        CrossFader_BufferPacket(fader, packet);
-        break;
+    /* a new input replaces whatever we were playing */
+    if (BLT_MediaPacket_GetFlags(packet) & BLT_MEDIA_PACKET_FLAG_START_OF_STREAM) {
+        CrossFader_Discard(self);
+        self->source = NULL;
     }
 
-    return BLT_SUCCESS;
+    return CrossFader_Process(self, packet);
 }
 
 /*----------------------------------------------------------------------
-|   CrossFaderInputPort_QueryMediaType
+|   CrossFaderInput_QueryMediaType
 +---------------------------------------------------------------------*/
 BLT_METHOD
-CrossFaderInputPort_QueryMediaType(BLT_MediaPortInstance* instance,
-                                   BLT_Ordinal            index,
-                                   const BLT_MediaType**  media_type)
+CrossFaderInput_QueryMediaType(BLT_MediaPort*         self,
+                               BLT_Ordinal            index,
+                               const BLT_MediaType**  media_type)
 {
-    BLT_COMPILER_UNUSED(instance);
+    BLT_COMPILER_UNUSED(self);
     if (index == 0) {
         *media_type = &BLT_GenericPcmMediaType;
         return BLT_SUCCESS;
@@ -314,70 +762,95 @@ CrossFaderInputPort_QueryMediaType(BLT_MediaPortInstance* instance,
 }
 
 /*----------------------------------------------------------------------
-|    BLT_MediaPort interface
+|   GetInterface implementation
 +---------------------------------------------------------------------*/
-BLT_MEDIA_PORT_IMPLEMENT_SIMPLE_TEMPLATE(CrossFaderInputPort,
-                                         "input",
-                                         PACKET,
-                                         IN)
-static const BLT_MediaPortInterface
-CrossFaderInputPort_BLT_MediaPortInterface = {
-    CrossFaderInputPort_GetInterface,
-    CrossFaderInputPort_GetName,
-    CrossFaderInputPort_GetProtocol,
-    CrossFaderInputPort_GetDirection,
-    CrossFaderInputPort_QueryMediaType
-};
+ATX_BEGIN_GET_INTERFACE_IMPLEMENTATION(CrossFaderInput)
+    ATX_GET_INTERFACE_ACCEPT(CrossFaderInput, BLT_MediaPort)
+    ATX_GET_INTERFACE_ACCEPT(CrossFaderInput, BLT_PacketConsumer)
+ATX_END_GET_INTERFACE_IMPLEMENTATION
 
 /*----------------------------------------------------------------------
 |    BLT_PacketConsumer interface
 +---------------------------------------------------------------------*/
-static const BLT_PacketConsumerInterface
-CrossFaderInputPort_BLT_PacketConsumerInterface = {
-    CrossFaderInputPort_GetInterface,
-    CrossFaderInputPort_PutPacket
-};
+ATX_BEGIN_INTERFACE_MAP(CrossFaderInput, BLT_PacketConsumer)
+    CrossFaderInput_PutPacket
+ATX_END_INTERFACE_MAP
 
 /*----------------------------------------------------------------------
-|   standard GetInterface implementation
+|    BLT_MediaPort interface
 +---------------------------------------------------------------------*/
-ATX_BEGIN_SIMPLE_GET_INTERFACE_IMPLEMENTATION(CrossFaderInputPort)
-ATX_INTERFACE_MAP_ADD(CrossFaderInputPort, BLT_MediaPort)
-ATX_INTERFACE_MAP_ADD(CrossFaderInputPort, BLT_PacketConsumer)
-ATX_END_SIMPLE_GET_INTERFACE_IMPLEMENTATION(CrossFaderInputPort)
+BLT_MEDIA_PORT_IMPLEMENT_SIMPLE_TEMPLATE(CrossFaderInput,
+                                         "input",
+                                         PACKET,
+                                         IN)
+ATX_BEGIN_INTERFACE_MAP(CrossFaderInput, BLT_MediaPort)
+    CrossFaderInput_GetName,
+    CrossFaderInput_GetProtocol,
+    CrossFaderInput_GetDirection,
+    CrossFaderInput_QueryMediaType
+ATX_END_INTERFACE_MAP
 
 /*----------------------------------------------------------------------
-|    CrossFaderOutputPort_GetPacket
+|    CrossFaderOutput_GetPacket
 +---------------------------------------------------------------------*/
 BLT_METHOD
-CrossFaderOutputPort_GetPacket(BLT_PacketProducerInstance* instance,
-                               BLT_MediaPacket**           packet)
+CrossFaderOutput_GetPacket(BLT_PacketProducer* _self,
+                           BLT_MediaPacket**   packet)
 {
-    CrossFader*   fader = (CrossFader*)instance;
+    CrossFader*   self = ATX_SELF_M(output, CrossFader, BLT_PacketProducer);
     ATX_ListItem* item;
+    BLT_Result    result;
+
+    *packet = NULL;
+    for (;;) {
+        item = ATX_List_GetFirstItem(self->output.packets);
+        if (item) {
+            *packet = ATX_ListItem_GetData(item);
+            ATX_List_RemoveItem(self->output.packets, item);
+            return BLT_SUCCESS;
+        }
+
+        /* a fade waiting for the next track */
+        if (self->fade.active) {
+            result = CrossFader_ContinueFade(self);
+            if (BLT_FAILED(result)) return result;
+            continue;
+        }
+
+        /* once the input has ended, the next track is played from here */
+        if (self->source) {
+            BLT_MediaPacket* next_packet = NULL;
+            result = BLT_PacketProducer_GetPacket(self->source, &next_packet);
+            if (BLT_SUCCEEDED(result) && next_packet) {
+                BLT_MediaPacket_ClearFlags(next_packet, BLT_MEDIA_PACKET_FLAG_START_OF_STREAM);
+                result = CrossFader_Process(self, next_packet);
+                BLT_MediaPacket_Release(next_packet);
+                if (BLT_FAILED(result)) return result;
+                continue;
+            }
+            if (result == BLT_ERROR_PORT_HAS_NO_DATA || result == BLT_ERROR_WOULD_BLOCK) {
+                return BLT_ERROR_WOULD_BLOCK;
+            }
+
+            /* the track has ended */
+            self->source = NULL;
+            CrossFader_Release(self);
+            continue;
+        }
 
-    item = ATX_List_GetFirstItem(fader->output.packets);
-    if (item) {
-        *packet = ATX_ListItem_GetData(item);
-        ATX_List_RemoveItem(fader->output.packets, item);
-        ATX_LOG_FINER("CrossFaderInputPort_GetPacket - got one");
-        return BLT_SUCCESS;
-    } else {
-        *packet = NULL;
-        ATX_LOG_FINER("CrossFaderInputPort_GetPacket - no more data");
         return BLT_ERROR_PORT_HAS_NO_DATA;
     }
 }
 
 /*----------------------------------------------------------------------
-|   CrossFaderOutputPort_QueryMediaType
+|   CrossFaderOutput_QueryMediaType
 +---------------------------------------------------------------------*/
 BLT_METHOD
-CrossFaderOutputPort_QueryMediaType(BLT_MediaPortInstance* instance,
-                                    BLT_Ordinal            index,
-                                    const BLT_MediaType**  media_type)
+CrossFaderOutput_QueryMediaType(BLT_MediaPort*         self,
+                                BLT_Ordinal            index,
+                                const BLT_MediaType**  media_type)
 {
-    BLT_COMPILER_UNUSED(instance);
+    BLT_COMPILER_UNUSED(self);
     if (index == 0) {
         *media_type = &BLT_GenericPcmMediaType;
         return BLT_SUCCESS;
@@ -387,56 +860,48 @@ CrossFaderOutputPort_QueryMediaType(BLT_MediaPortInstance* instance,
     }
 }
 
+/*----------------------------------------------------------------------
+|   GetInterface implementation
++---------------------------------------------------------------------*/
+ATX_BEGIN_GET_INTERFACE_IMPLEMENTATION(CrossFaderOutput)
+    ATX_GET_INTERFACE_ACCEPT(CrossFaderOutput, BLT_MediaPort)
+    ATX_GET_INTERFACE_ACCEPT(CrossFaderOutput, BLT_PacketProducer)
+ATX_END_GET_INTERFACE_IMPLEMENTATION
+
 /*----------------------------------------------------------------------
 |    BLT_MediaPort interface
 +---------------------------------------------------------------------*/
-BLT_MEDIA_PORT_IMPLEMENT_SIMPLE_TEMPLATE(CrossFaderOutputPort,
+BLT_MEDIA_PORT_IMPLEMENT_SIMPLE_TEMPLATE(CrossFaderOutput,
                                          "output",
                                          PACKET,
                                          OUT)
-static const BLT_MediaPortInterface
-CrossFaderOutputPort_BLT_MediaPortInterface = {
-    CrossFaderOutputPort_GetInterface,
-    CrossFaderOutputPort_GetName,
-    CrossFaderOutputPort_GetProtocol,
-    CrossFaderOutputPort_GetDirection,
-    CrossFaderOutputPort_QueryMediaType
-};
+ATX_BEGIN_INTERFACE_MAP(CrossFaderOutput, BLT_MediaPort)
+    CrossFaderOutput_GetName,
+    CrossFaderOutput_GetProtocol,
+    CrossFaderOutput_GetDirection,
+    CrossFaderOutput_QueryMediaType
+ATX_END_INTERFACE_MAP
 
 /*----------------------------------------------------------------------
 |    BLT_PacketProducer interface
 +---------------------------------------------------------------------*/
-static const BLT_PacketProducerInterface
-CrossFaderOutputPort_BLT_PacketProducerInterface = {
-    CrossFaderOutputPort_GetInterface,
-    CrossFaderOutputPort_GetPacket
-};
+ATX_BEGIN_INTERFACE_MAP(CrossFaderOutput, BLT_PacketProducer)
+    CrossFaderOutput_GetPacket
+ATX_END_INTERFACE_MAP
 
 /*----------------------------------------------------------------------
-|   standard GetInterface implementation
+|    CrossFader_ClearOutput
 +---------------------------------------------------------------------*/
-ATX_BEGIN_SIMPLE_GET_INTERFACE_IMPLEMENTATION(CrossFaderOutputPort)
-ATX_INTERFACE_MAP_ADD(CrossFaderOutputPort, BLT_MediaPort)
-ATX_INTERFACE_MAP_ADD(CrossFaderOutputPort, BLT_PacketProducer)
-ATX_END_SIMPLE_GET_INTERFACE_IMPLEMENTATION(CrossFaderOutputPort)
-
-/*----------------------------------------------------------------------
-|    CrossFader_SetupPorts
-+---------------------------------------------------------------------*/
-static BLT_Result
-CrossFader_SetupPorts(CrossFader* fader)
+static void
+CrossFader_ClearOutput(CrossFader* self)
 {
-    ATX_Result result;
-
-    /* initialize the input */
-    fader->input.buffer = NULL;
-    BLT_PcmMediaType_Init(&fader->input.media_type);
-
-    /* create a list of output packets */
-    result = ATX_List_Create(&fader->output.packets);
-    if (ATX_FAILED(result)) return result;
-    
-    return BLT_SUCCESS;
+    ATX_ListItem* item = ATX_List_GetFirstItem(self->output.packets);
+    while (item) {
+        BLT_MediaPacket* packet = ATX_ListItem_GetData(item);
+        if (packet) BLT_MediaPacket_Release(packet);
+        item = ATX_ListItem_GetNext(item);
+    }
+    ATX_List_Clear(self->output.packets);
 }
 
 /*----------------------------------------------------------------------
@@ -446,10 +911,10 @@ static BLT_Result
 CrossFader_Create(BLT_Module*              module,
                   BLT_Core*                core, 
                   BLT_ModuleParametersType parameters_type,
-                  BLT_CString              parameters, 
-                  ATX_Object*              object)
+                  BLT_AnyConst             parameters,
+                  BLT_MediaNode**          object)
 {
-    CrossFader* fader;
+    CrossFader* self;
     BLT_Result  result;
 
     ATX_LOG_FINE("CrossFader::Create");
@@ -461,30 +926,36 @@ CrossFader_Create(BLT_Module*              module,
     }
 
     /* allocate memory for the object */
-    fader = ATX_AllocateZeroMemory(sizeof(CrossFader));
-    if (fader == NULL) {
-        ATX_CLEAR_OBJECT(object);
+    self = ATX_AllocateZeroMemory(sizeof(CrossFader));
+    if (self == NULL) {
+        *object = NULL;
         return BLT_ERROR_OUT_OF_MEMORY;
     }
 
     /* construct the inherited object */
-    BLT_BaseMediaNode_Construct(&fader->base, module, core);
+    BLT_BaseMediaNode_Construct(&ATX_BASE(self, BLT_BaseMediaNode), module, core);
 
     /* construct the object */
-    fader->state = CROSS_FADER_STATE_IN_START;
-
-    /* setup the input and output ports */
-    result = CrossFader_SetupPorts(fader);
+    result = ATX_List_Create(&self->output.packets);
     if (BLT_FAILED(result)) {
-        BLT_BaseMediaNode_Destruct(&fader->base);
-        ATX_FreeMemory(fader);
-        ATX_CLEAR_OBJECT(object);
+        BLT_BaseMediaNode_Destruct(&ATX_BASE(self, BLT_BaseMediaNode));
+        ATX_FreeMemory(self);
+        *object = NULL;
         return result;
     }
-
-    /* construct reference */
-    ATX_INSTANCE(object)  = (ATX_Instance*)fader;
-    ATX_INTERFACE(object) = (ATX_Interface*)&CrossFader_BLT_MediaNodeInterface;
+    self->settings.duration  = BLT_CROSS_FADE_DEFAULT_DURATION;
+    self->settings.curve     = BLT_CROSS_FADE_CURVE_EQUAL_POWER;
+    self->settings.threshold = (float)pow(10.0, BLT_CROSS_FADE_DEFAULT_SILENCE_THRESHOLD/20.0);
+
+    /* setup interfaces */
+    ATX_SET_INTERFACE_EX(self, CrossFader, BLT_BaseMediaNode, BLT_MediaNode);
+    ATX_SET_INTERFACE_EX(self, CrossFader, BLT_BaseMediaNode, ATX_Referenceable);
+    ATX_SET_INTERFACE(self, CrossFader, ATX_PropertyListener);
+    ATX_SET_INTERFACE(&self->input,  CrossFaderInput,  BLT_MediaPort);
+    ATX_SET_INTERFACE(&self->input,  CrossFaderInput,  BLT_PacketConsumer);
+    ATX_SET_INTERFACE(&self->output, CrossFaderOutput, BLT_MediaPort);
+    ATX_SET_INTERFACE(&self->output, CrossFaderOutput, BLT_PacketProducer);
+    *object = &ATX_BASE_EX(self, BLT_BaseMediaNode, BLT_MediaNode);
 
     return BLT_SUCCESS;
 }
@@ -493,161 +964,205 @@ CrossFader_Create(BLT_Module*              module,
 |    CrossFader_Destroy
 +---------------------------------------------------------------------*/
 static BLT_Result
-CrossFader_Destroy(CrossFader* fader)
+CrossFader_Destroy(CrossFader* self)
 { 
-    ATX_ListItem* item;
-
     ATX_LOG_FINE("CrossFader::Destroy");
 
     /* release any packet we may hold */
-    item = ATX_List_GetFirstItem(fader->output.packets);
-    while (item) {
-        BLT_MediaPacket* packet = ATX_ListItem_GetData(item);
-        if (packet) {
-            BLT_MediaPacket_Release(packet);
-        }
-        item = ATX_ListItem_GetNext(item);
-    }
-    ATX_List_Destroy(fader->output.packets);
-    
-    /* destroy the input buffer */
-    if (fader->input.buffer) {
-        ATX_RingBuffer_Destroy(fader->input.buffer);
-    }
+    CrossFader_ClearOutput(self);
+    ATX_List_Destroy(self->output.packets);
+    CrossFader_Discard(self);
+
+    /* free the processing state */
+    CrossFader_FreeState(self);
 
     /* destruct the inherited object */
-    BLT_BaseMediaNode_Destruct(&fader->base);
+    BLT_BaseMediaNode_Destruct(&ATX_BASE(self, BLT_BaseMediaNode));
 
     /* free the object memory */
-    ATX_FreeMemory(fader);
+    ATX_FreeMemory((void*)self);
 
     return BLT_SUCCESS;
 }
-                    
+
 /*----------------------------------------------------------------------
-|    CrossFader_Activate
+|   CrossFader_GetPortByName
 +---------------------------------------------------------------------*/
 BLT_METHOD
-CrossFader_Activate(BLT_MediaNodeInstance* instance, BLT_Stream* stream)
+CrossFader_GetPortByName(BLT_MediaNode*  _self,
+                         BLT_CString     name,
+                         BLT_MediaPort** port)
 {
-    ATX_Properties settings;
-    CrossFader*    fader = (CrossFader*)instance;
-
-    /* stop listening for settings on the current stream, if any */
-    if (!ATX_OBJECT_IS_NULL(&fader->context) &&
-        fader->listener_handle != NULL) {
-        if (BLT_SUCCEEDED(BLT_Core_GetSettings(&fader->base.core, 
-                                               &settings))) {
-            ATX_Properties_RemoveListener(&settings, fader->listener_handle);
-        }
-        fader->listener_handle = NULL;
-    }
+    CrossFader* self = ATX_SELF_EX(CrossFader, BLT_BaseMediaNode, BLT_MediaNode);
 
-    /* keep a reference to the stream */
-    fader->context = *stream;
+    if (ATX_StringsEqual(name, "input")) {
+        *port = &ATX_BASE(&self->input, BLT_MediaPort);
+        return BLT_SUCCESS;
+    } else if (ATX_StringsEqual(name, "output")) {
+        *port = &ATX_BASE(&self->output, BLT_MediaPort);
+        return BLT_SUCCESS;
+    } else {
+        *port = NULL;
+        return BLT_ERROR_NO_SUCH_PORT;
+    }
+}
 
-    /* listen to settings on the new stream */
-    if (BLT_SUCCEEDED(BLT_Core_GetSettings(&fader->base.core, 
-                                            &settings))) {
-        ATX_PropertyListener me;
-        ATX_INSTANCE(&me)  = (ATX_PropertyListenerInstance*)fader;
-        ATX_INTERFACE(&me) = &CrossFader_ATX_PropertyListenerInterface;
-        ATX_Properties_AddListener(&settings, 
-                                    "SomeSetting",
-                                    &me,
-                                    &fader->listener_handle);
+/*----------------------------------------------------------------------
+|    CrossFader_UpdateSetting
++---------------------------------------------------------------------*/
+static void
+CrossFader_UpdateSetting(CrossFader*              self,
+                         ATX_CString              name,
+                         const ATX_PropertyValue* value)
+{
+    if (ATX_StringsEqual(name, BLT_CROSS_FADER_NEXT_SOURCE)) {
+        BLT_PacketProducer* next = NULL;
+        if (value == NULL) {
+            /* the tracks are gone, including the one we may be playing */
+            CrossFader_Discard(self);
+            self->source = NULL;
+        } else if (value->type == ATX_PROPERTY_VALUE_TYPE_POINTER) {
+            next = (BLT_PacketProducer*)value->data.pointer;
+        }
+    
+        /* the track we're already playing is not a next track */
+        if (next == self->source) next = NULL;
+        self->next = next;
+        CrossFader_PrepareFade(self);
+    } else if (ATX_StringsEqual(name, BLT_CROSS_FADER_DURATION)) {
+        int duration = BLT_CROSS_FADE_DEFAULT_DURATION;
+        if (value && value->type == ATX_PROPERTY_VALUE_TYPE_INTEGER) {
+            duration = value->data.integer;
+        }
+        if (duration < 0) duration = 0;
+        if (duration > BLT_CROSS_FADE_MAX_DURATION) duration = BLT_CROSS_FADE_MAX_DURATION;
+
+        /* the buffers are resized with the next packet */
+        self->settings.duration = duration;
+    } else if (ATX_StringsEqual(name, BLT_CROSS_FADER_CURVE)) {
+        self->settings.curve = BLT_CROSS_FADE_CURVE_EQUAL_POWER;
+        if (value && value->type == ATX_PROPERTY_VALUE_TYPE_INTEGER &&
+            (value->data.integer == BLT_CROSS_FADE_CURVE_SQUARE_ROOT ||
+             value->data.integer == BLT_CROSS_FADE_CURVE_LINEAR)) {
+            self->settings.curve = (BLT_CrossFadeCurve)value->data.integer;
+        }
+    } else if (ATX_StringsEqual(name, BLT_CROSS_FADER_SILENCE_THRESHOLD)) {
+        int threshold = BLT_CROSS_FADE_DEFAULT_SILENCE_THRESHOLD;
+        if (value && value->type == ATX_PROPERTY_VALUE_TYPE_INTEGER) {
+            threshold = value->data.integer;
+        }
+        if (threshold < BLT_CROSS_FADE_MIN_SILENCE_THRESHOLD) threshold = BLT_CROSS_FADE_MIN_SILENCE_THRESHOLD;
+        if (threshold > BLT_CROSS_FADE_MAX_SILENCE_THRESHOLD) threshold = BLT_CROSS_FADE_MAX_SILENCE_THRESHOLD;
+        self->settings.threshold = (float)pow(10.0, threshold/20.0);
+    } else {
+        return;
     }
 
-    return BLT_SUCCESS;
+    ATX_LOG_FINE_1("CrossFader::UpdateSetting - %s", name);
 }
-
+                    
 /*----------------------------------------------------------------------
-|    CrossFader_Deactivate
+|    CrossFader_Activate
 +---------------------------------------------------------------------*/
 BLT_METHOD
-CrossFader_Deactivate(BLT_MediaNodeInstance* instance)
+CrossFader_Activate(BLT_MediaNode* _self, BLT_Stream* stream)
 {
-    ATX_Properties settings;
-    CrossFader*    fader = (CrossFader*)instance;
+    CrossFader* self = ATX_SELF_EX(CrossFader, BLT_BaseMediaNode, BLT_MediaNode);
 
-    /* remove our listener */
-    if (BLT_SUCCEEDED(BLT_Core_GetSettings(&fader->base.core, 
-                                            &settings))) {
-        ATX_Properties_RemoveListener(&settings, 
-                                        &fader->listener_handle);
+    /* keep a reference to the stream */
+    ATX_BASE(self, BLT_BaseMediaNode).context = stream;
+
+    /* listen to the settings, which are core properties */
+    if (stream) {
+        ATX_Properties* properties;
+        if (BLT_SUCCEEDED(BLT_Core_GetProperties(ATX_BASE(self, BLT_BaseMediaNode).core,
+                                                 &properties))) {
+            ATX_PropertyValue property;
+            unsigned int      i;
+            for (i=0; i<sizeof(CrossFader_Settings)/sizeof(CrossFader_Settings[0]); i++) {
+                ATX_Properties_AddListener(properties,
+                                           CrossFader_Settings[i],
+                                           &ATX_BASE(self, ATX_PropertyListener),
+                                           &self->listener_handles[i]);
+
+                /* read the initial value */
+                if (ATX_SUCCEEDED(ATX_Properties_GetProperty(properties,
+                                                             CrossFader_Settings[i],
+                                                             &property))) {
+                    CrossFader_UpdateSetting(self, CrossFader_Settings[i], &property);
+                }
+            }
+        }
     }
 
-    /* we're detached from the stream */
-    ATX_CLEAR_OBJECT(&fader->context);
-
     return BLT_SUCCESS;
 }
 
 /*----------------------------------------------------------------------
-|   CrossFader_GetPortByName
+|    CrossFader_Deactivate
 +---------------------------------------------------------------------*/
 BLT_METHOD
-CrossFader_GetPortByName(BLT_MediaNodeInstance* instance,
-                         BLT_CString            name,
-                         BLT_MediaPort*         port)
+CrossFader_Deactivate(BLT_MediaNode* _self)
 {
-    CrossFader* fader = (CrossFader*)instance;
-
-    if (ATX_StringsEqual(name, "input")) {
-        ATX_INSTANCE(port)  = (BLT_MediaPortInstance*)fader;
-        ATX_INTERFACE(port) = &CrossFaderInputPort_BLT_MediaPortInterface; 
-        return BLT_SUCCESS;
-    } else if (ATX_StringsEqual(name, "output")) {
-        ATX_INSTANCE(port)  = (BLT_MediaPortInstance*)fader;
-        ATX_INTERFACE(port) = &CrossFaderOutputPort_BLT_MediaPortInterface; 
-        return BLT_SUCCESS;
-    } else {
-        ATX_CLEAR_OBJECT(port);
-        return BLT_ERROR_NO_SUCH_PORT;
+    CrossFader* self = ATX_SELF_EX(CrossFader, BLT_BaseMediaNode, BLT_MediaNode);
+
+    /* remove our listeners */
+    if (ATX_BASE(self, BLT_BaseMediaNode).context) {
+        ATX_Properties* properties;
+        if (BLT_SUCCEEDED(BLT_Core_GetProperties(ATX_BASE(self, BLT_BaseMediaNode).core,
+                                                 &properties))) {
+            unsigned int i;
+            for (i=0; i<sizeof(self->listener_handles)/sizeof(self->listener_handles[0]); i++) {
+                ATX_Properties_RemoveListener(properties, self->listener_handles[i]);
+            }
+        }
     }
+
+    /* we're detached from the stream */
+    ATX_BASE(self, BLT_BaseMediaNode).context = NULL;
+    CrossFader_Discard(self);
+    self->source = NULL;
+    self->next   = NULL;
+
+    return BLT_SUCCESS;
 }
 
 /*----------------------------------------------------------------------
 |    CrossFader_Seek
 +---------------------------------------------------------------------*/
 BLT_METHOD
-CrossFader_Seek(BLT_MediaNodeInstance* instance,
-                BLT_SeekMode*          mode,
-                BLT_SeekPoint*         point)
+CrossFader_Seek(BLT_MediaNode* _self,
+                BLT_SeekMode*  mode,
+                BLT_SeekPoint* point)
 {
-    BLT_COMPILER_UNUSED(instance);
+    CrossFader* self = ATX_SELF_EX(CrossFader, BLT_BaseMediaNode, BLT_MediaNode);
+
     BLT_COMPILER_UNUSED(mode);
-    BLT_COMPILER_UNUSED(point);
-    /*CrossFader* fader = (CrossFader*)instance;*/
     
-    /* flush pending input packets */
-    /*CrossFaderInputPort_Flush(fader);*/
+    /* discard everything we hold, but keep playing the same track, */
+    /* which the player seeks by itself when it is not the input    */
+    CrossFader_ClearOutput(self);
+    CrossFader_Discard(self);
+
+    /* the media resumes at the seek point */
+    self->next_time_stamp = point->time_stamp;
 
     return BLT_SUCCESS;
 }
 
 /*----------------------------------------------------------------------
-|    CrossFader_OnPropertyChanged
+|   GetInterface implementation
 +---------------------------------------------------------------------*/
-BLT_VOID_METHOD
-CrossFader_OnPropertyChanged(ATX_PropertyListenerInstance* instance,
-                             ATX_CString                   name,
-                             ATX_PropertyType              type,
-                             const ATX_PropertyValue*      value)
-{
-    /*CrossFader* fader = (CrossFader*)instance;*/
-    BLT_COMPILER_UNUSED(instance);
-    BLT_COMPILER_UNUSED(type);
-    ATX_LOG_FINE_2("CrossFader::OnPropertyChanged - name=%s val=%d", 
-                   name ? name : "*", value ? value->integer : 0);
-}
+ATX_BEGIN_GET_INTERFACE_IMPLEMENTATION(CrossFader)
+    ATX_GET_INTERFACE_ACCEPT_EX(CrossFader, BLT_BaseMediaNode, BLT_MediaNode)
+    ATX_GET_INTERFACE_ACCEPT_EX(CrossFader, BLT_BaseMediaNode, ATX_Referenceable)
+    ATX_GET_INTERFACE_ACCEPT(CrossFader, ATX_PropertyListener)
+ATX_END_GET_INTERFACE_IMPLEMENTATION
 
 /*----------------------------------------------------------------------
 |    BLT_MediaNode interface
 +---------------------------------------------------------------------*/
-static const BLT_MediaNodeInterface
-CrossFader_BLT_MediaNodeInterface = {
-    CrossFader_GetInterface,
+ATX_BEGIN_INTERFACE_MAP_EX(CrossFader, BLT_BaseMediaNode, BLT_MediaNode)
     BLT_BaseMediaNode_GetInfo,
     CrossFader_GetPortByName,
     CrossFader_Activate,
@@ -659,41 +1174,45 @@ CrossFader_BLT_MediaNodeInterface = {
     CrossFader_Seek
 };
 
+/*----------------------------------------------------------------------
+|    CrossFader_OnPropertyChanged
++---------------------------------------------------------------------*/
+BLT_VOID_METHOD
+CrossFader_OnPropertyChanged(ATX_PropertyListener*    _self,
+                             ATX_CString              name,
+                             const ATX_PropertyValue* value)
+{
+    CrossFader* self = ATX_SELF(CrossFader, ATX_PropertyListener);
+
+    if (name) CrossFader_UpdateSetting(self, name, value);
+}
+
 /*----------------------------------------------------------------------
 |    ATX_PropertyListener interface
 +---------------------------------------------------------------------*/
-static const ATX_PropertyListenerInterface
-CrossFader_ATX_PropertyListenerInterface = {
-    CrossFader_GetInterface,
+ATX_BEGIN_INTERFACE_MAP(CrossFader, ATX_PropertyListener)
     CrossFader_OnPropertyChanged,
 };
 
 /*----------------------------------------------------------------------
 |   ATX_Referenceable interface
 +---------------------------------------------------------------------*/
-ATX_IMPLEMENT_SIMPLE_REFERENCEABLE_INTERFACE(CrossFader, base.reference_count)
-
-/*----------------------------------------------------------------------
-|   standard GetInterface implementation
-+---------------------------------------------------------------------*/
-ATX_BEGIN_SIMPLE_GET_INTERFACE_IMPLEMENTATION(CrossFader)
-ATX_INTERFACE_MAP_ADD(CrossFader, BLT_MediaNode)
-ATX_INTERFACE_MAP_ADD(CrossFader, ATX_PropertyListener)
-ATX_INTERFACE_MAP_ADD(CrossFader, ATX_Referenceable)
-ATX_END_SIMPLE_GET_INTERFACE_IMPLEMENTATION(CrossFader)
+ATX_IMPLEMENT_REFERENCEABLE_INTERFACE_EX(CrossFader,
+                                         BLT_BaseMediaNode,
+                                         reference_count)
 
 /*----------------------------------------------------------------------
 |   CrossFaderModule_Probe
 +---------------------------------------------------------------------*/
 BLT_METHOD
-CrossFaderModule_Probe(BLT_ModuleInstance*      instance, 
+CrossFaderModule_Probe(BLT_Module*              self,
                        BLT_Core*                core,
                        BLT_ModuleParametersType parameters_type,
                        BLT_AnyConst             parameters,
                        BLT_Cardinal*            match)
 {
+    BLT_COMPILER_UNUSED(self);
     BLT_COMPILER_UNUSED(core);
-    BLT_COMPILER_UNUSED(instance);
 
     switch (parameters_type) {
       case BLT_MODULE_PARAMETERS_TYPE_MEDIA_NODE_CONSTRUCTOR:
@@ -703,35 +1222,27 @@ CrossFaderModule_Probe(BLT_ModuleInstance*      instance,
 
             /* we need a name */
             if (constructor->name == NULL ||
-                !ATX_StringsEqual(constructor->name, "CrossFader")) {
+                !ATX_StringsEqual(constructor->name, BLT_CROSS_FADER_MODULE_NAME)) {
                 return BLT_FAILURE;
             }
 
             /* the input and output protocols should be PACKET */
-            if ((constructor->spec.input.protocol !=
-                 BLT_MEDIA_PORT_PROTOCOL_ANY &&
-                 constructor->spec.input.protocol != 
-                 BLT_MEDIA_PORT_PROTOCOL_PACKET) ||
-                (constructor->spec.output.protocol !=
-                 BLT_MEDIA_PORT_PROTOCOL_ANY &&
-                 constructor->spec.output.protocol != 
-                 BLT_MEDIA_PORT_PROTOCOL_PACKET)) {
+            if ((constructor->spec.input.protocol  != BLT_MEDIA_PORT_PROTOCOL_ANY &&
+                 constructor->spec.input.protocol  != BLT_MEDIA_PORT_PROTOCOL_PACKET) ||
+                (constructor->spec.output.protocol != BLT_MEDIA_PORT_PROTOCOL_ANY &&
+                 constructor->spec.output.protocol != BLT_MEDIA_PORT_PROTOCOL_PACKET)) {
                 return BLT_FAILURE;
             }
 
             /* the input type should be unspecified, or audio/pcm */
-            if (!(constructor->spec.input.media_type->id == 
-                  BLT_MEDIA_TYPE_ID_AUDIO_PCM) &&
-                !(constructor->spec.input.media_type->id ==
-                  BLT_MEDIA_TYPE_ID_UNKNOWN)) {
+            if (!(constructor->spec.input.media_type->id == BLT_MEDIA_TYPE_ID_AUDIO_PCM) &&
+                !(constructor->spec.input.media_type->id == BLT_MEDIA_TYPE_ID_UNKNOWN)) {
                 return BLT_FAILURE;
             }
 
             /* the output type should be unspecified, or audio/pcm */
-            if (!(constructor->spec.output.media_type->id == 
-                  BLT_MEDIA_TYPE_ID_AUDIO_PCM) &&
-                !(constructor->spec.output.media_type->id ==
-                  BLT_MEDIA_TYPE_ID_UNKNOWN)) {
+            if (!(constructor->spec.output.media_type->id == BLT_MEDIA_TYPE_ID_AUDIO_PCM) &&
+                !(constructor->spec.output.media_type->id == BLT_MEDIA_TYPE_ID_UNKNOWN)) {
                 return BLT_FAILURE;
             }
 
@@ -751,20 +1262,27 @@ CrossFaderModule_Probe(BLT_ModuleInstance*      instance,
 }
 
 /*----------------------------------------------------------------------
-|   template instantiations
+|   GetInterface implementation
++---------------------------------------------------------------------*/
+ATX_BEGIN_GET_INTERFACE_IMPLEMENTATION(CrossFaderModule)
+    ATX_GET_INTERFACE_ACCEPT(CrossFaderModule, BLT_Module)
+    ATX_GET_INTERFACE_ACCEPT(CrossFaderModule, ATX_Referenceable)
+ATX_END_GET_INTERFACE_IMPLEMENTATION
+
+/*----------------------------------------------------------------------
+|   node factory
 +---------------------------------------------------------------------*/
-BLT_MODULE_IMPLEMENT_SIMPLE_MEDIA_NODE_FACTORY(CrossFader)
+BLT_MODULE_IMPLEMENT_SIMPLE_MEDIA_NODE_FACTORY(CrossFaderModule, CrossFader)
 
 /*----------------------------------------------------------------------
 |   BLT_Module interface
 +---------------------------------------------------------------------*/
-static const BLT_ModuleInterface CrossFaderModule_BLT_ModuleInterface = {
-    CrossFaderModule_GetInterface,
+ATX_BEGIN_INTERFACE_MAP(CrossFaderModule, BLT_Module)
     BLT_BaseModule_GetInfo,
     BLT_BaseModule_Attach,
     CrossFaderModule_CreateInstance,
     CrossFaderModule_Probe
-};
+ATX_END_INTERFACE_MAP
 
 /*----------------------------------------------------------------------
 |   ATX_Referenceable interface
@@ -772,28 +1290,13 @@ static const BLT_ModuleInterface CrossFaderModule_BLT_ModuleInterface = {
 #define CrossFaderModule_Destroy(x) \
     BLT_BaseModule_Destroy((BLT_BaseModule*)(x))
 
-ATX_IMPLEMENT_SIMPLE_REFERENCEABLE_INTERFACE(CrossFaderModule, 
-                                             base.reference_count)
-
-/*----------------------------------------------------------------------
-|   standard GetInterface implementation
-+---------------------------------------------------------------------*/
-ATX_DECLARE_SIMPLE_GET_INTERFACE_IMPLEMENTATION(CrossFaderModule)
-ATX_BEGIN_SIMPLE_GET_INTERFACE_IMPLEMENTATION(CrossFaderModule) 
-ATX_INTERFACE_MAP_ADD(CrossFaderModule, BLT_Module)
-ATX_INTERFACE_MAP_ADD(CrossFaderModule, ATX_Referenceable)
-ATX_END_SIMPLE_GET_INTERFACE_IMPLEMENTATION(CrossFaderModule)
+ATX_IMPLEMENT_REFERENCEABLE_INTERFACE(CrossFaderModule, reference_count)
 
 /*----------------------------------------------------------------------
 |   module object
 +---------------------------------------------------------------------*/
-BLT_Result 
-BLT_CrossFaderModule_GetModuleObject(BLT_Module** object)
-{
-    if (object == NULL) return BLT_ERROR_INVALID_PARAMETERS;
-
-    return BLT_BaseModule_Create("CrossFader", NULL, 0,
-                                 &CrossFaderModule_BLT_ModuleInterface,
-                                 &CrossFaderModule_ATX_ReferenceableInterface,
-                                 object);
-}
+BLT_MODULE_IMPLEMENT_STANDARD_GET_MODULE(CrossFaderModule,
+                                         "Cross Fader",
+                                         BLT_CROSS_FADER_MODULE_NAME,
+                                         "1.0.0",
+                                         BLT_MODULE_AXIOMATIC_COPYRIGHT)
@@ -2,7 +2,7 @@
 |
 |   Cross Fader Module
 |
-|   (c) 2002-2006 Gilles Boccon-Gibod
+|   (c) 2002-2012 Gilles Boccon-Gibod
 |   Author: Gilles Boccon-Gibod (bok@bok.net)
 |
  ****************************************************************/
@@ -10,6 +10,30 @@
 #ifndef _BLT_CROSS_FADER_H_
 #define _BLT_CROSS_FADER_H_
 
+/**
+ * @ingroup plugin_modules
+ * @defgroup cross_fader_module Cross Fader Module
+ * Plugin module that creates media nodes that mix the end of a track
+ * with the start of the next one (see BltCrossFade.h).
+ * These media nodes expect media packets with PCM audio as input,
+ * and produce media packets with PCM audio as output.
+ *
+ * The next track is a BLT_PacketProducer set in the
+ * BLT_CROSS_FADER_NEXT_SOURCE core property, normally by the player
+ * (see BLT_Player::SetNextInput). While it is set, the node holds back
+ * the last frames of the input; when the input ends, they are mixed
+ * with the start of the next track, after leaving out the silence at
+ * the end of one and at the start of the other. The node then plays
+ * the next track in place of the input, until it ends or a new input
+ * starts.
+ *
+ * 8 to 32 bit integer, as well as 32 bit float PCM are supported,
+ * with up to 8 channels. Other formats pass through unmodified, and
+ * are followed by the next track without a fade.
+ *
+ * @{
+ */
+
 /*----------------------------------------------------------------------
 |   includes
 +---------------------------------------------------------------------*/
@@ -21,4 +45,6 @@
 +---------------------------------------------------------------------*/
 BLT_Result BLT_CrossFaderModule_GetModuleObject(BLT_Module** module);
 
+/** @} */
+
 #endif /* _BLT_CROSS_FADER_H_ */
@@ -10,6 +10,8 @@
 /*----------------------------------------------------------------------
 |   includes
 +---------------------------------------------------------------------*/
+#include <math.h>
+
 #include "Atomix.h"
 #include "BltConfig.h"
 #include "BltCore.h"
@@ -17,6 +19,8 @@
 #include "BltMediaNode.h"
 #include "BltMedia.h"
 #include "BltPcm.h"
+#include "BltPcmFloat.h"
+#include "BltSimd.h"
 #include "BltPacketProducer.h"
 #include "BltPacketConsumer.h"
 #include "BltStream.h"
@@ -26,6 +30,20 @@
 +---------------------------------------------------------------------*/
 ATX_SET_LOCAL_LOGGER("bluetune.plugins.general.silence-remover")
 
+/*----------------------------------------------------------------------
+|    constants
++---------------------------------------------------------------------*/
+#define BLT_SILENCE_REMOVER_DEFAULT_THRESHOLD    (-5400)
+#define BLT_SILENCE_REMOVER_DEFAULT_MIN_DURATION 1000
+#define BLT_SILENCE_REMOVER_MIN_THRESHOLD        (-12000)
+#define BLT_SILENCE_REMOVER_MAX_MIN_DURATION     30000
+
+/* longest silence held back in case it ends the stream, in ms */
+#define BLT_SILENCE_REMOVER_MAX_PENDING_DURATION 30000
+
+#define BLT_SILENCE_REMOVER_SCAN_BLOCK   32   /* samples */
+#define BLT_SILENCE_REMOVER_SCRATCH_SIZE 1024 /* samples */
+
 /*----------------------------------------------------------------------
 |    types
 +---------------------------------------------------------------------*/
@@ -37,7 +55,10 @@ typedef struct {
     ATX_IMPLEMENTS(BLT_PacketConsumer);
 
     /* members */
-    BLT_MediaPacket* pending;
+    ATX_List*    pending;         /* packets that may end the stream */
+    BLT_Size     pending_sound;   /* payload of the first pending packet up */
+                                  /* to its last non-silent frame          */
+    BLT_Cardinal pending_silence; /* frames of silence pending             */
 } SilenceRemoverInput;
 
 typedef struct {
@@ -54,113 +75,618 @@ typedef enum {
     SILENCE_REMOVER_STATE_IN_STREAM
 } SilenceRemoverState;
 
+typedef struct {
+    int          mode;
+    BLT_Cardinal min_duration;
+    ATX_Int32    threshold_16;
+    ATX_Int32    threshold_32;
+    float        threshold_float;
+} SilenceRemoverSettings;
+
+typedef struct SilenceRemoverScanner SilenceRemoverScanner;
+typedef BLT_Cardinal (*SilenceRemoverScanFunction)(const SilenceRemoverScanner* scanner,
+                                                   const void*                  samples,
+                                                   BLT_Cardinal                 sample_count);
+
+/* finds loud samples in the format of a packet. The find functions */
+/* return the index of the first (or last) sample at or above the   */
+/* threshold, or sample_count if there is none. find_quiet returns  */
+/* the index of the first sample under the threshold instead        */
+struct SilenceRemoverScanner {
+    const BLT_PcmMediaType*    media_type;
+    BLT_Cardinal               channel_count;
+    BLT_Size                   frame_size;
+    ATX_Int32                  threshold_int;
+    float                      threshold_float;
+    float*                     scratch;
+    SilenceRemoverScanFunction find_first;
+    SilenceRemoverScanFunction find_last;
+    SilenceRemoverScanFunction find_quiet;
+};
+
 typedef struct {
     /* base class */
     ATX_EXTENDS(BLT_BaseMediaNode);
 
+    /* interfaces */
+    ATX_IMPLEMENTS(ATX_PropertyListener);
+
     /* members */
-    SilenceRemoverState  state;
-    SilenceRemoverInput  input;
-    SilenceRemoverOutput output;
+    SilenceRemoverState        state;
+    SilenceRemoverSettings     settings;
+    SilenceRemoverInput        input;
+    SilenceRemoverOutput       output;
+    ATX_PropertyListenerHandle threshold_listener_handle;
+    ATX_PropertyListenerHandle mode_listener_handle;
+    ATX_PropertyListenerHandle min_duration_listener_handle;
+    float                      scratch[BLT_SILENCE_REMOVER_SCRATCH_SIZE];
 } SilenceRemover;
 
-/*----------------------------------------------------------------------
-|    constants
-+---------------------------------------------------------------------*/
-#define BLT_SILENCE_REMOVER_THRESHOLD 64
-
 /*----------------------------------------------------------------------
 |   forward declarations
 +---------------------------------------------------------------------*/
 ATX_DECLARE_INTERFACE_MAP(SilenceRemoverModule, BLT_Module)
 ATX_DECLARE_INTERFACE_MAP(SilenceRemover, BLT_MediaNode)
 ATX_DECLARE_INTERFACE_MAP(SilenceRemover, ATX_Referenceable)
+ATX_DECLARE_INTERFACE_MAP(SilenceRemover, ATX_PropertyListener)
 
 /*----------------------------------------------------------------------
-|    ScanPacket
+|    SilenceRemover_IsLoudBlock16
+|
+|    The scanning functions skip quiet blocks of samples, testing a whole
+|    block at a time with SSE2 or NEON, and only look at individual
+|    samples in the block where the audio starts.
 +---------------------------------------------------------------------*/
-static BLT_Result
-ScanPacket(BLT_MediaPacket* packet, 
-           BLT_Cardinal*    zero_head, 
-           BLT_Cardinal*    zero_tail)
+static int
+SilenceRemover_IsLoudBlock16(const ATX_Int16* block, ATX_Int32 threshold)
 {
-    BLT_PcmMediaType* media_type;
-    short*            pcm;
-    BLT_Cardinal      sample_count;
-    BLT_Ordinal       sample;
-    BLT_Cardinal      zero_head_count = 0;
-    BLT_Cardinal      non_zero_run = 0;
+#if defined(BLT_SIMD_SSE2)
+    /* threshold is between 1 and 32768 */
+    const __m128i above = _mm_set1_epi16((short)(threshold-1));
+    const __m128i below = _mm_set1_epi16((short)(1-threshold));
+    __m128i       loud  = _mm_setzero_si128();
+    unsigned int  j;
+    for (j=0; j<BLT_SILENCE_REMOVER_SCAN_BLOCK; j += 8) {
+        __m128i x = _mm_loadu_si128((const __m128i*)(block+j));
+        loud = _mm_or_si128(loud, _mm_or_si128(_mm_cmpgt_epi16(x, above),
+                                               _mm_cmplt_epi16(x, below)));
+    }
+    return _mm_movemask_epi8(loud);
+#elif defined(BLT_SIMD_NEON)
+    const int16x8_t above = vdupq_n_s16((ATX_Int16)(threshold-1));
+    const int16x8_t below = vdupq_n_s16((ATX_Int16)(1-threshold));
+    uint16x8_t      loud  = vdupq_n_u16(0);
+    uint16x4_t      half;
+    unsigned int    j;
+    for (j=0; j<BLT_SILENCE_REMOVER_SCAN_BLOCK; j += 8) {
+        int16x8_t x = vld1q_s16(block+j);
+        loud = vorrq_u16(loud, vorrq_u16(vcgtq_s16(x, above), vcltq_s16(x, below)));
+    }
+    half = vorr_u16(vget_low_u16(loud), vget_high_u16(loud));
+    return vget_lane_u64(vreinterpret_u64_u16(half), 0) != 0;
+#else
+    int          loud = 0;
+    unsigned int j;
+    for (j=0; j<BLT_SILENCE_REMOVER_SCAN_BLOCK; j++) {
+        loud |= (block[j] >= threshold) | (block[j] <= -threshold);
+    }
+    return loud;
+#endif
+}
 
-    /* default values */
-    *zero_head = 0;
-    *zero_tail = 0;
+/*----------------------------------------------------------------------
+|    SilenceRemover_IsLoudBlock32
++---------------------------------------------------------------------*/
+static int
+SilenceRemover_IsLoudBlock32(const ATX_Int32* block, ATX_Int32 threshold)
+{
+#if defined(BLT_SIMD_SSE2)
+    /* threshold is between 1 and 0x7FFFFFFF */
+    const __m128i above = _mm_set1_epi32(threshold-1);
+    const __m128i below = _mm_set1_epi32(1-threshold);
+    __m128i       loud  = _mm_setzero_si128();
+    unsigned int  j;
+    for (j=0; j<BLT_SILENCE_REMOVER_SCAN_BLOCK; j += 4) {
+        __m128i x = _mm_loadu_si128((const __m128i*)(block+j));
+        loud = _mm_or_si128(loud, _mm_or_si128(_mm_cmpgt_epi32(x, above),
+                                               _mm_cmplt_epi32(x, below)));
+    }
+    return _mm_movemask_epi8(loud);
+#elif defined(BLT_SIMD_NEON)
+    const int32x4_t above = vdupq_n_s32(threshold-1);
+    const int32x4_t below = vdupq_n_s32(1-threshold);
+    uint32x4_t      loud  = vdupq_n_u32(0);
+    uint32x2_t      half;
+    unsigned int    j;
+    for (j=0; j<BLT_SILENCE_REMOVER_SCAN_BLOCK; j += 4) {
+        int32x4_t x = vld1q_s32(block+j);
+        loud = vorrq_u32(loud, vorrq_u32(vcgtq_s32(x, above), vcltq_s32(x, below)));
+    }
+    half = vorr_u32(vget_low_u32(loud), vget_high_u32(loud));
+    return vget_lane_u64(vreinterpret_u64_u32(half), 0) != 0;
+#else
+    int          loud = 0;
+    unsigned int j;
+    for (j=0; j<BLT_SILENCE_REMOVER_SCAN_BLOCK; j++) {
+        loud |= (block[j] >= threshold) | (block[j] <= -threshold);
+    }
+    return loud;
+#endif
+}
 
-    /* get the media type */
-    BLT_MediaPacket_GetMediaType(packet, (const BLT_MediaType**)(const void*)&media_type);
-    /* check the media type */
-    if (media_type->base.id != BLT_MEDIA_TYPE_ID_AUDIO_PCM) {
-        return BLT_ERROR_INVALID_MEDIA_TYPE;
+/*----------------------------------------------------------------------
+|    SilenceRemover_IsLoudBlockFloat
++---------------------------------------------------------------------*/
+static int
+SilenceRemover_IsLoudBlockFloat(const float* block, float threshold)
+{
+#if defined(BLT_SIMD_SSE2)
+    const __m128 above = _mm_set1_ps(threshold);
+    const __m128 below = _mm_set1_ps(-threshold);
+    __m128       loud  = _mm_setzero_ps();
+    unsigned int j;
+    for (j=0; j<BLT_SILENCE_REMOVER_SCAN_BLOCK; j += 4) {
+        __m128 x = _mm_loadu_ps(block+j);
+        loud = _mm_or_ps(loud, _mm_or_ps(_mm_cmpge_ps(x, above), _mm_cmple_ps(x, below)));
+    }
+    return _mm_movemask_ps(loud);
+#elif defined(BLT_SIMD_NEON)
+    const float32x4_t above = vdupq_n_f32(threshold);
+    const float32x4_t below = vdupq_n_f32(-threshold);
+    uint32x4_t        loud  = vdupq_n_u32(0);
+    uint32x2_t        half;
+    unsigned int      j;
+    for (j=0; j<BLT_SILENCE_REMOVER_SCAN_BLOCK; j += 4) {
+        float32x4_t x = vld1q_f32(block+j);
+        loud = vorrq_u32(loud, vorrq_u32(vcgeq_f32(x, above), vcleq_f32(x, below)));
+    }
+    half = vorr_u32(vget_low_u32(loud), vget_high_u32(loud));
+    return vget_lane_u64(vreinterpret_u64_u32(half), 0) != 0;
+#else
+    int          loud = 0;
+    unsigned int j;
+    for (j=0; j<BLT_SILENCE_REMOVER_SCAN_BLOCK; j++) {
+        loud |= (block[j] >= threshold) | (block[j] <= -threshold);
     }
+    return loud;
+#endif
+}
 
-    /* for now, we only support 16-bit, stereo, PCM */
-    if (media_type->bits_per_sample != 16 || media_type->channel_count != 2) {
-        return BLT_SUCCESS;
+/*----------------------------------------------------------------------
+|    SilenceRemover_FindFirstLoud16
++---------------------------------------------------------------------*/
+static BLT_Cardinal
+SilenceRemover_FindFirstLoud16(const SilenceRemoverScanner* scanner,
+                               const void*                  samples,
+                               BLT_Cardinal                 sample_count)
+{
+    const ATX_Int16* pcm       = (const ATX_Int16*)samples;
+    ATX_Int32        threshold = scanner->threshold_int;
+    BLT_Cardinal     i = 0;
+
+    for (; i+BLT_SILENCE_REMOVER_SCAN_BLOCK <= sample_count; i += BLT_SILENCE_REMOVER_SCAN_BLOCK) {
+        if (SilenceRemover_IsLoudBlock16(pcm+i, threshold)) break;
+    }
+    for (; i<sample_count; i++) {
+        if (pcm[i] >= threshold || pcm[i] <= -threshold) return i;
     }
 
-    /* check for zero samples */
-    sample_count = BLT_MediaPacket_GetPayloadSize(packet)/4;
-    if (sample_count == 0) return BLT_SUCCESS;
-    pcm = BLT_MediaPacket_GetPayloadBuffer(packet);
-    for (sample = 0; sample < sample_count; sample++, pcm+=2) { 
-        if (pcm[0] > -BLT_SILENCE_REMOVER_THRESHOLD && 
-            pcm[0] <  BLT_SILENCE_REMOVER_THRESHOLD && 
-            pcm[1] > -BLT_SILENCE_REMOVER_THRESHOLD && 
-            pcm[1] <  BLT_SILENCE_REMOVER_THRESHOLD) {
-            if (sample == zero_head_count) {
-                zero_head_count++;
-            }
-        } else {
-            non_zero_run = sample+1;
+    return sample_count;
+}
+
+/*----------------------------------------------------------------------
+|    SilenceRemover_FindLastLoud16
++---------------------------------------------------------------------*/
+static BLT_Cardinal
+SilenceRemover_FindLastLoud16(const SilenceRemoverScanner* scanner,
+                              const void*                  samples,
+                              BLT_Cardinal                 sample_count)
+{
+    const ATX_Int16* pcm       = (const ATX_Int16*)samples;
+    ATX_Int32        threshold = scanner->threshold_int;
+    BLT_Cardinal     i = sample_count;
+
+    for (; i >= BLT_SILENCE_REMOVER_SCAN_BLOCK; i -= BLT_SILENCE_REMOVER_SCAN_BLOCK) {
+        if (SilenceRemover_IsLoudBlock16(pcm+i-BLT_SILENCE_REMOVER_SCAN_BLOCK, threshold)) break;
+    }
+    while (i--) {
+        if (pcm[i] >= threshold || pcm[i] <= -threshold) return i;
+    }
+
+    return sample_count;
+}
+
+/*----------------------------------------------------------------------
+|    SilenceRemover_FindFirstLoud32
++---------------------------------------------------------------------*/
+static BLT_Cardinal
+SilenceRemover_FindFirstLoud32(const SilenceRemoverScanner* scanner,
+                               const void*                  samples,
+                               BLT_Cardinal                 sample_count)
+{
+    const ATX_Int32* pcm       = (const ATX_Int32*)samples;
+    ATX_Int32        threshold = scanner->threshold_int;
+    BLT_Cardinal     i = 0;
+
+    for (; i+BLT_SILENCE_REMOVER_SCAN_BLOCK <= sample_count; i += BLT_SILENCE_REMOVER_SCAN_BLOCK) {
+        if (SilenceRemover_IsLoudBlock32(pcm+i, threshold)) break;
+    }
+    for (; i<sample_count; i++) {
+        if (pcm[i] >= threshold || pcm[i] <= -threshold) return i;
+    }
+
+    return sample_count;
+}
+
+/*----------------------------------------------------------------------
+|    SilenceRemover_FindLastLoud32
++---------------------------------------------------------------------*/
+static BLT_Cardinal
+SilenceRemover_FindLastLoud32(const SilenceRemoverScanner* scanner,
+                              const void*                  samples,
+                              BLT_Cardinal                 sample_count)
+{
+    const ATX_Int32* pcm       = (const ATX_Int32*)samples;
+    ATX_Int32        threshold = scanner->threshold_int;
+    BLT_Cardinal     i = sample_count;
+
+    for (; i >= BLT_SILENCE_REMOVER_SCAN_BLOCK; i -= BLT_SILENCE_REMOVER_SCAN_BLOCK) {
+        if (SilenceRemover_IsLoudBlock32(pcm+i-BLT_SILENCE_REMOVER_SCAN_BLOCK, threshold)) break;
+    }
+    while (i--) {
+        if (pcm[i] >= threshold || pcm[i] <= -threshold) return i;
+    }
+
+    return sample_count;
+}
+
+/*----------------------------------------------------------------------
+|    SilenceRemover_FindFirstLoudFloat
++---------------------------------------------------------------------*/
+static BLT_Cardinal
+SilenceRemover_FindFirstLoudFloat(const SilenceRemoverScanner* scanner,
+                                  const void*                  samples,
+                                  BLT_Cardinal                 sample_count)
+{
+    const float* pcm       = (const float*)samples;
+    float        threshold = scanner->threshold_float;
+    BLT_Cardinal i = 0;
+
+    for (; i+BLT_SILENCE_REMOVER_SCAN_BLOCK <= sample_count; i += BLT_SILENCE_REMOVER_SCAN_BLOCK) {
+        if (SilenceRemover_IsLoudBlockFloat(pcm+i, threshold)) break;
+    }
+    for (; i<sample_count; i++) {
+        if (pcm[i] >= threshold || pcm[i] <= -threshold) return i;
+    }
+
+    return sample_count;
+}
+
+/*----------------------------------------------------------------------
+|    SilenceRemover_FindLastLoudFloat
++---------------------------------------------------------------------*/
+static BLT_Cardinal
+SilenceRemover_FindLastLoudFloat(const SilenceRemoverScanner* scanner,
+                                 const void*                  samples,
+                                 BLT_Cardinal                 sample_count)
+{
+    const float* pcm       = (const float*)samples;
+    float        threshold = scanner->threshold_float;
+    BLT_Cardinal i = sample_count;
+
+    for (; i >= BLT_SILENCE_REMOVER_SCAN_BLOCK; i -= BLT_SILENCE_REMOVER_SCAN_BLOCK) {
+        if (SilenceRemover_IsLoudBlockFloat(pcm+i-BLT_SILENCE_REMOVER_SCAN_BLOCK, threshold)) break;
+    }
+    while (i--) {
+        if (pcm[i] >= threshold || pcm[i] <= -threshold) return i;
+    }
+
+    return sample_count;
+}
+
+/*----------------------------------------------------------------------
+|    SilenceRemover_FindFirstQuiet16
++---------------------------------------------------------------------*/
+static BLT_Cardinal
+SilenceRemover_FindFirstQuiet16(const SilenceRemoverScanner* scanner,
+                                const void*                  samples,
+                                BLT_Cardinal                 sample_count)
+{
+    const ATX_Int16* pcm       = (const ATX_Int16*)samples;
+    ATX_Int32        threshold = scanner->threshold_int;
+    BLT_Cardinal     i;
+
+    for (i=0; i<sample_count; i++) {
+        if (pcm[i] < threshold && pcm[i] > -threshold) return i;
+    }
+
+    return sample_count;
+}
+
+/*----------------------------------------------------------------------
+|    SilenceRemover_FindFirstQuiet32
++---------------------------------------------------------------------*/
+static BLT_Cardinal
+SilenceRemover_FindFirstQuiet32(const SilenceRemoverScanner* scanner,
+                                const void*                  samples,
+                                BLT_Cardinal                 sample_count)
+{
+    const ATX_Int32* pcm       = (const ATX_Int32*)samples;
+    ATX_Int32        threshold = scanner->threshold_int;
+    BLT_Cardinal     i;
+
+    for (i=0; i<sample_count; i++) {
+        if (pcm[i] < threshold && pcm[i] > -threshold) return i;
+    }
+
+    return sample_count;
+}
+
+/*----------------------------------------------------------------------
+|    SilenceRemover_FindFirstQuietFloat
++---------------------------------------------------------------------*/
+static BLT_Cardinal
+SilenceRemover_FindFirstQuietFloat(const SilenceRemoverScanner* scanner,
+                                   const void*                  samples,
+                                   BLT_Cardinal                 sample_count)
+{
+    const float* pcm       = (const float*)samples;
+    float        threshold = scanner->threshold_float;
+    BLT_Cardinal i;
+
+    for (i=0; i<sample_count; i++) {
+        if (pcm[i] < threshold && pcm[i] > -threshold) return i;
+    }
+
+    return sample_count;
+}
+
+/*----------------------------------------------------------------------
+|    SilenceRemover_FindFirstLoudConverted
+|
+|    Other formats are converted to floats, one block at a time
++---------------------------------------------------------------------*/
+static BLT_Cardinal
+SilenceRemover_FindFirstLoudConverted(const SilenceRemoverScanner* scanner,
+                                      const void*                  samples,
+                                      BLT_Cardinal                 sample_count)
+{
+    const unsigned char* pcm         = (const unsigned char*)samples;
+    BLT_Size             sample_size = scanner->media_type->bits_per_sample/8;
+    BLT_Cardinal         done        = 0;
+
+    while (done < sample_count) {
+        BLT_Cardinal chunk = sample_count-done;
+        BLT_Cardinal index;
+        if (chunk > BLT_SILENCE_REMOVER_SCRATCH_SIZE) chunk = BLT_SILENCE_REMOVER_SCRATCH_SIZE;
+        BLT_PcmFloat_Import(scanner->media_type, pcm+done*sample_size, chunk, scanner->scratch);
+        index = SilenceRemover_FindFirstLoudFloat(scanner, scanner->scratch, chunk);
+        if (index < chunk) return done+index;
+        done += chunk;
+    }
+
+    return sample_count;
+}
+
+/*----------------------------------------------------------------------
+|    SilenceRemover_FindLastLoudConverted
++---------------------------------------------------------------------*/
+static BLT_Cardinal
+SilenceRemover_FindLastLoudConverted(const SilenceRemoverScanner* scanner,
+                                     const void*                  samples,
+                                     BLT_Cardinal                 sample_count)
+{
+    const unsigned char* pcm         = (const unsigned char*)samples;
+    BLT_Size             sample_size = scanner->media_type->bits_per_sample/8;
+    BLT_Cardinal         left        = sample_count;
+
+    while (left) {
+        BLT_Cardinal chunk = left;
+        BLT_Cardinal index;
+        if (chunk > BLT_SILENCE_REMOVER_SCRATCH_SIZE) chunk = BLT_SILENCE_REMOVER_SCRATCH_SIZE;
+        left -= chunk;
+        BLT_PcmFloat_Import(scanner->media_type, pcm+left*sample_size, chunk, scanner->scratch);
+        index = SilenceRemover_FindLastLoudFloat(scanner, scanner->scratch, chunk);
+        if (index < chunk) return left+index;
+    }
+
+    return sample_count;
+}
+
+/*----------------------------------------------------------------------
+|    SilenceRemover_FindFirstQuietConverted
++---------------------------------------------------------------------*/
+static BLT_Cardinal
+SilenceRemover_FindFirstQuietConverted(const SilenceRemoverScanner* scanner,
+                                       const void*                  samples,
+                                       BLT_Cardinal                 sample_count)
+{
+    const unsigned char* pcm         = (const unsigned char*)samples;
+    BLT_Size             sample_size = scanner->media_type->bits_per_sample/8;
+    BLT_Cardinal         done        = 0;
+
+    while (done < sample_count) {
+        BLT_Cardinal chunk = sample_count-done;
+        BLT_Cardinal index;
+        if (chunk > BLT_SILENCE_REMOVER_SCRATCH_SIZE) chunk = BLT_SILENCE_REMOVER_SCRATCH_SIZE;
+        BLT_PcmFloat_Import(scanner->media_type, pcm+done*sample_size, chunk, scanner->scratch);
+        index = SilenceRemover_FindFirstQuietFloat(scanner, scanner->scratch, chunk);
+        if (index < chunk) return done+index;
+        done += chunk;
+    }
+
+    return sample_count;
+}
+
+/*----------------------------------------------------------------------
+|    SilenceRemover_SetupScanner
++---------------------------------------------------------------------*/
+static BLT_Boolean
+SilenceRemover_SetupScanner(SilenceRemover*          self,
+                            const BLT_PcmMediaType*  media_type,
+                            SilenceRemoverScanner*   scanner)
+{
+    if (!BLT_PcmFloat_SupportsFormat(media_type) || media_type->channel_count == 0) {
+        return BLT_FALSE;
+    }
+
+    scanner->media_type      = media_type;
+    scanner->channel_count   = media_type->channel_count;
+    scanner->frame_size      = media_type->channel_count*(media_type->bits_per_sample/8);
+    scanner->threshold_int   = 0;
+    scanner->threshold_float = self->settings.threshold_float;
+    scanner->scratch         = self->scratch;
+    if (media_type->bits_per_sample == 16 &&
+        media_type->sample_format == BLT_PCM_SAMPLE_FORMAT_SIGNED_INT_NE) {
+        scanner->threshold_int = self->settings.threshold_16;
+        scanner->find_first    = SilenceRemover_FindFirstLoud16;
+        scanner->find_last     = SilenceRemover_FindLastLoud16;
+        scanner->find_quiet    = SilenceRemover_FindFirstQuiet16;
+    } else if (media_type->bits_per_sample == 32 &&
+               media_type->sample_format == BLT_PCM_SAMPLE_FORMAT_SIGNED_INT_NE) {
+        scanner->threshold_int = self->settings.threshold_32;
+        scanner->find_first    = SilenceRemover_FindFirstLoud32;
+        scanner->find_last     = SilenceRemover_FindLastLoud32;
+        scanner->find_quiet    = SilenceRemover_FindFirstQuiet32;
+    } else if (media_type->bits_per_sample == 32 &&
+               media_type->sample_format == BLT_PCM_SAMPLE_FORMAT_FLOAT_NE) {
+        scanner->find_first    = SilenceRemover_FindFirstLoudFloat;
+        scanner->find_last     = SilenceRemover_FindLastLoudFloat;
+        scanner->find_quiet    = SilenceRemover_FindFirstQuietFloat;
+    } else {
+        /* 8 and 24 bit samples */
+        scanner->find_first    = SilenceRemover_FindFirstLoudConverted;
+        scanner->find_last     = SilenceRemover_FindLastLoudConverted;
+        scanner->find_quiet    = SilenceRemover_FindFirstQuietConverted;
+    }
+
+    return BLT_TRUE;
+}
+
+/*----------------------------------------------------------------------
+|    SilenceRemover_FindLoudFrame
+|
+|    Returns the index of the first frame with a loud sample, or
+|    frame_count if they are all silent
++---------------------------------------------------------------------*/
+static BLT_Cardinal
+SilenceRemover_FindLoudFrame(const SilenceRemoverScanner* scanner,
+                             const unsigned char*         frames,
+                             BLT_Cardinal                 frame_count)
+{
+    return scanner->find_first(scanner, frames, frame_count*scanner->channel_count)/
+           scanner->channel_count;
+}
+
+/*----------------------------------------------------------------------
+|    SilenceRemover_FindLastLoudFrame
++---------------------------------------------------------------------*/
+static BLT_Cardinal
+SilenceRemover_FindLastLoudFrame(const SilenceRemoverScanner* scanner,
+                                 const unsigned char*         frames,
+                                 BLT_Cardinal                 frame_count)
+{
+    return scanner->find_last(scanner, frames, frame_count*scanner->channel_count)/
+           scanner->channel_count;
+}
+
+/*----------------------------------------------------------------------
+|    SilenceRemover_FindSilentFrame
+|
+|    Scans the run for quiet samples, and only checks the other samples
+|    of the frames where one is found.
++---------------------------------------------------------------------*/
+static BLT_Cardinal
+SilenceRemover_FindSilentFrame(const SilenceRemoverScanner* scanner,
+                               const unsigned char*         frames,
+                               BLT_Cardinal                 frame_count)
+{
+    BLT_Cardinal channel_count = scanner->channel_count;
+    BLT_Size     sample_size   = scanner->frame_size/channel_count;
+    BLT_Cardinal sample_count  = frame_count*channel_count;
+    BLT_Cardinal i = 0;
+
+    while (i < sample_count) {
+        BLT_Cardinal frame;
+
+        i += scanner->find_quiet(scanner, frames+i*sample_size, sample_count-i);
+        if (i >= sample_count) break;
+        frame = i/channel_count;
+        if (channel_count == 1 ||
+            scanner->find_first(scanner,
+                                frames+frame*scanner->frame_size,
+                                channel_count) == channel_count) {
+            return frame;
         }
+        i = (frame+1)*channel_count;
     }
-    *zero_head = zero_head_count*4;
-    if (non_zero_run > 0) {
-        *zero_tail = (sample_count-non_zero_run)*4;
+
+    return frame_count;
+}
+
+/*----------------------------------------------------------------------
+|    SilenceRemover_CollapseSilences
+|
+|    Shortens the silences between first_loud and last_loud that are
+|    longer than max_silence frames, and returns the new frame count.
++---------------------------------------------------------------------*/
+static BLT_Cardinal
+SilenceRemover_CollapseSilences(const SilenceRemoverScanner* scanner,
+                                unsigned char*               frames,
+                                BLT_Cardinal                 frame_count,
+                                BLT_Cardinal                 first_loud,
+                                BLT_Cardinal*                last_loud,
+                                BLT_Cardinal                 max_silence)
+{
+    BLT_Size     frame_size = scanner->frame_size;
+    BLT_Cardinal position   = first_loud;
+
+    while (position < *last_loud) {
+        BLT_Cardinal start;
+        BLT_Cardinal end;
+
+        /* find the next silence, it always ends before the last loud frame */
+        start = position+SilenceRemover_FindSilentFrame(scanner,
+                                                        frames+position*frame_size,
+                                                        *last_loud-position);
+        if (start >= *last_loud) break;
+        end = start+SilenceRemover_FindLoudFrame(scanner,
+                                                 frames+start*frame_size,
+                                                 *last_loud-start);
+
+        if (end-start > max_silence) {
+            /* move the rest of the packet over the silence that is cut */
+            BLT_Cardinal         removed = end-start-max_silence;
+            unsigned char*       out     = frames+(start+max_silence)*frame_size;
+            const unsigned char* in      = frames+end*frame_size;
+            BLT_Size             size    = (frame_count-end)*frame_size;
+
+            ATX_LOG_FINER_1("SilenceRemover: collapsing %d frames", (int)removed);
+            ATX_MoveMemory(out, in, size);
+            frame_count -= removed;
+            *last_loud  -= removed;
+            end         -= removed;
+        }
+        position = end;
     }
 
-    return BLT_SUCCESS;     
+    return frame_count;
 }
 
 /*----------------------------------------------------------------------
-|    SilenceRemover_TrimPending
+|    SilenceRemover_AcceptPacket
 +---------------------------------------------------------------------*/
 static void
-SilenceRemover_TrimPending(SilenceRemover* self)
+SilenceRemover_AcceptPacket(SilenceRemover* self, BLT_MediaPacket* packet)
 {
-    BLT_MediaPacket* packet = self->input.pending;
-    short*           pcm;
-    BLT_Cardinal     sample_count;
-    BLT_Cardinal     skip = 0;
-    int              sample;
-
-    /* quick check */
-    if (!packet) return;
-
-    ATX_LOG_FINER("SilenceRemover: trimming pending packet");
-
-    /* remove silence at the end of the packet */
-    pcm = (short*)BLT_MediaPacket_GetPayloadBuffer(packet);
-    sample_count = BLT_MediaPacket_GetPayloadSize(packet)/4;
-    pcm += sample_count*2;
-    for (sample = sample_count-1; sample >= 0; sample--, pcm-=2) {
-        if (pcm[0] > -BLT_SILENCE_REMOVER_THRESHOLD && 
-            pcm[0] <  BLT_SILENCE_REMOVER_THRESHOLD && 
-            pcm[1] > -BLT_SILENCE_REMOVER_THRESHOLD && 
-            pcm[1] <  BLT_SILENCE_REMOVER_THRESHOLD) {
-            skip++;
-        }
+    BLT_Result result;
+    ATX_LOG_FINER("SilenceRemover: accepting packet");
+
+    /* add the packet to the output list */
+    result = ATX_List_AddData(self->output.packets, packet);
+    if (ATX_SUCCEEDED(result)) {
+        BLT_MediaPacket_AddReference(packet);
     }
-    BLT_MediaPacket_SetPayloadSize(packet, (sample_count-skip)*4);
 }
 
 /*----------------------------------------------------------------------
@@ -169,53 +695,206 @@ SilenceRemover_TrimPending(SilenceRemover* self)
 static void
 SilenceRemover_AcceptPending(SilenceRemover* self)
 {
-    BLT_MediaPacket* packet = self->input.pending;
-    BLT_Result       result;
+    ATX_ListItem* item;
 
-    if (packet != NULL) {
-        result = ATX_List_AddData(self->output.packets, packet);
-        if (ATX_FAILED(result)) {
+    while ((item = ATX_List_GetFirstItem(self->input.pending))) {
+        BLT_MediaPacket* packet = ATX_ListItem_GetData(item);
+        ATX_List_RemoveItem(self->input.pending, item);
+        if (ATX_FAILED(ATX_List_AddData(self->output.packets, packet))) {
             BLT_MediaPacket_Release(packet);
         }
-        self->input.pending = NULL;
         ATX_LOG_FINER("SilenceRemover: accepting pending packet");
-    } else {
-        ATX_LOG_FINER("SilenceRemover: no pending packet");
     }
+    self->input.pending_sound   = 0;
+    self->input.pending_silence = 0;
+}
+
+/*----------------------------------------------------------------------
+|    SilenceRemover_TrimPending
+|
+|    The pending silence is at the end of the stream: remove it
++---------------------------------------------------------------------*/
+static void
+SilenceRemover_TrimPending(SilenceRemover* self)
+{
+    BLT_Size      sound = self->input.pending_sound;
+    ATX_ListItem* item;
+
+    while ((item = ATX_List_GetFirstItem(self->input.pending))) {
+        BLT_MediaPacket* packet = ATX_ListItem_GetData(item);
+        ATX_List_RemoveItem(self->input.pending, item);
+
+        ATX_LOG_FINER("SilenceRemover: trimming pending packet");
+        BLT_MediaPacket_SetPayloadSize(packet, sound);
+        if (sound || BLT_MediaPacket_GetFlags(packet)) {
+            /* packet has sound or flags, don't discard it */
+            if (ATX_FAILED(ATX_List_AddData(self->output.packets, packet))) {
+                BLT_MediaPacket_Release(packet);
+            }
+        } else {
+            BLT_MediaPacket_Release(packet);
+        }
+
+        /* only the first pending packet can have sound */
+        sound = 0;
+    }
+    self->input.pending_sound   = 0;
+    self->input.pending_silence = 0;
 }
 
 /*----------------------------------------------------------------------
 |    SilenceRemover_HoldPacket
 +---------------------------------------------------------------------*/
 static void
-SilenceRemover_HoldPacket(SilenceRemover* self, BLT_MediaPacket* packet)
+SilenceRemover_HoldPacket(SilenceRemover*  self,
+                          BLT_MediaPacket* packet,
+                          BLT_Size         sound,
+                          BLT_Cardinal     silence)
 {
-    ATX_LOG_FINER("SilenceRemover: holding packet");
+    BLT_Boolean first = (ATX_List_GetFirstItem(self->input.pending) == NULL);
 
-    /* accept the previously pending packet if any */
-    SilenceRemover_AcceptPending(self);
+    ATX_LOG_FINER_1("SilenceRemover: holding packet, %d frames of silence", (int)silence);
 
-    /* hold the packet as a pending input */
-    self->input.pending = packet;
-    BLT_MediaPacket_AddReference(packet);
+    if (ATX_SUCCEEDED(ATX_List_AddData(self->input.pending, packet))) {
+        BLT_MediaPacket_AddReference(packet);
+        if (first) self->input.pending_sound = sound;
+        self->input.pending_silence += silence;
+    }
 }
 
 /*----------------------------------------------------------------------
-|    SilenceRemover_AcceptPacket
+|    SilenceRemover_GetMaxSilence
+|
+|    Longest silence kept when collapsing, in frames
++---------------------------------------------------------------------*/
+static BLT_Cardinal
+SilenceRemover_GetMaxSilence(SilenceRemover* self, BLT_Cardinal sample_rate)
+{
+    return (BLT_Cardinal)((double)self->settings.min_duration*(double)sample_rate/1000.0);
+}
+
+/*----------------------------------------------------------------------
+|    SilenceRemover_ProcessSilence
+|
+|    Process a packet in which all the frames are silent
 +---------------------------------------------------------------------*/
 static void
-SilenceRemover_AcceptPacket(SilenceRemover* self, BLT_MediaPacket* packet)
+SilenceRemover_ProcessSilence(SilenceRemover*              self,
+                              BLT_MediaPacket*             packet,
+                              const SilenceRemoverScanner* scanner,
+                              BLT_Cardinal                 frame_count)
 {
-    BLT_Result result;
-    ATX_LOG_FINER("SilenceRemover: accepting packet");
+    BLT_Cardinal sample_rate = scanner->media_type->sample_rate;
+    BLT_Cardinal max_silence = SilenceRemover_GetMaxSilence(self, sample_rate);
+
+    if (self->state == SILENCE_REMOVER_STATE_START_OF_STREAM) {
+        /* silence at the start of the stream */
+        if (BLT_MediaPacket_GetFlags(packet)) {
+            /* packet has flags, don't discard it, just empty it */
+            ATX_LOG_FINER("SilenceRemover: emptying packet");
+            BLT_MediaPacket_SetPayloadSize(packet, 0);
+            SilenceRemover_AcceptPacket(self, packet);
+        } else {
+            ATX_LOG_FINER("SilenceRemover: dropping packet");
+        }
+        return;
+    }
 
-    /* first, use any pending packet */
+    /* this silence may be the end of the stream, so hold it */
+    if (self->settings.mode == BLT_SILENCE_REMOVER_MODE_COLLAPSE) {
+        /* only keep up to the maximum length of a collapsed silence */
+        BLT_Cardinal room = 0;
+        if (self->input.pending_silence < max_silence) {
+            room = max_silence-self->input.pending_silence;
+        }
+        if (frame_count > room) {
+            frame_count = room;
+            BLT_MediaPacket_SetPayloadSize(packet, frame_count*scanner->frame_size);
+        }
+    }
+    if (frame_count == 0 && BLT_MediaPacket_GetFlags(packet) == 0) {
+        ATX_LOG_FINER("SilenceRemover: dropping packet");
+        return;
+    }
+    SilenceRemover_HoldPacket(self, packet, 0, frame_count);
+
+    /* don't hold on to long silences forever */
+    if (self->input.pending_silence >
+        BLT_SILENCE_REMOVER_MAX_PENDING_DURATION/1000*sample_rate) {
+        SilenceRemover_AcceptPending(self);
+    }
+}
+
+/*----------------------------------------------------------------------
+|    SilenceRemover_ProcessSound
+|
+|    Process a packet in which some of the frames are not silent
++---------------------------------------------------------------------*/
+static void
+SilenceRemover_ProcessSound(SilenceRemover*              self,
+                            BLT_MediaPacket*             packet,
+                            const SilenceRemoverScanner* scanner,
+                            BLT_Cardinal                 first_loud)
+{
+    BLT_Size       frame_size  = scanner->frame_size;
+    BLT_Cardinal   max_silence = SilenceRemover_GetMaxSilence(self, scanner->media_type->sample_rate);
+    BLT_Boolean    collapse    = (self->settings.mode == BLT_SILENCE_REMOVER_MODE_COLLAPSE);
+    BLT_Offset     payload_offset;
+    unsigned char* payload;
+    BLT_Cardinal   frame_count;
+    BLT_Cardinal   last_loud;
+    BLT_Cardinal   skip = 0;
+
+    /* the payload window starts at the first frame that we keep */
+    if (self->state == SILENCE_REMOVER_STATE_START_OF_STREAM) {
+        /* remove silence at the start of the stream */
+        skip = first_loud;
+        ATX_LOG_FINER("SilenceRemover: new state = IN_STREAM");
+        self->state = SILENCE_REMOVER_STATE_IN_STREAM;
+    } else if (collapse && first_loud) {
+        /* the pending silence ends in this packet, keep it short */
+        BLT_Cardinal keep = 0;
+        if (self->input.pending_silence < max_silence) {
+            keep = max_silence-self->input.pending_silence;
+        }
+        if (first_loud > keep) skip = first_loud-keep;
+    }
+    if (skip) {
+        payload_offset = BLT_MediaPacket_GetPayloadOffset(packet);
+        BLT_MediaPacket_SetPayloadOffset(packet, payload_offset+skip*frame_size);
+        first_loud -= skip;
+    }
+
+    /* what we held was not the end of the stream */
     SilenceRemover_AcceptPending(self);
 
-    /* add the packet to the output list */
-    result = ATX_List_AddData(self->output.packets, packet);
-    if (ATX_SUCCEEDED(result)) {
-        BLT_MediaPacket_AddReference(packet);
+    /* look for silence at the end of the packet */
+    payload     = (unsigned char*)BLT_MediaPacket_GetPayloadBuffer(packet);
+    frame_count = BLT_MediaPacket_GetPayloadSize(packet)/frame_size;
+    last_loud   = SilenceRemover_FindLastLoudFrame(scanner, payload, frame_count);
+
+    /* shorten the long silences in the middle of the packet */
+    if (collapse) {
+        frame_count = SilenceRemover_CollapseSilences(scanner,
+                                                      payload,
+                                                      frame_count,
+                                                      first_loud,
+                                                      &last_loud,
+                                                      max_silence);
+        BLT_MediaPacket_SetPayloadSize(packet, frame_count*frame_size);
+    }
+
+    if (last_loud+1 < frame_count) {
+        /* packet has some silence at the end */
+        BLT_Cardinal silence = frame_count-last_loud-1;
+        if (collapse && silence > max_silence) {
+            silence = max_silence;
+            BLT_MediaPacket_SetPayloadSize(packet, (last_loud+1+silence)*frame_size);
+        }
+        SilenceRemover_HoldPacket(self, packet, (last_loud+1)*frame_size, silence);
+    } else {
+        /* packet has no silence at the end */
+        SilenceRemover_AcceptPacket(self, packet);
     }
 }
 
@@ -226,85 +905,55 @@ BLT_METHOD
 SilenceRemoverInput_PutPacket(BLT_PacketConsumer* _self,
                               BLT_MediaPacket*    packet)
 {
-    SilenceRemover* self = ATX_SELF_M(input, SilenceRemover, BLT_PacketConsumer);
-    BLT_Flags       packet_flags;
-    BLT_Cardinal    zero_head = 0;
-    BLT_Cardinal    zero_tail = 0;
-    BLT_Offset      payload_offset;
-    BLT_Size        payload_size;
-    ATX_Result      result;
+    SilenceRemover*       self = ATX_SELF_M(input, SilenceRemover, BLT_PacketConsumer);
+    BLT_PcmMediaType*     media_type;
+    SilenceRemoverScanner scanner;
+    BLT_Flags             packet_flags;
+    BLT_Result            result;
 
     ATX_LOG_FINER("SilenceRemoverInput::PutPacket");
 
-    /* get the packet info */
-    packet_flags   = BLT_MediaPacket_GetFlags(packet);
-    payload_offset = BLT_MediaPacket_GetPayloadOffset(packet);
-    payload_size   = BLT_MediaPacket_GetPayloadSize(packet);
-
-    /* scan the packet for zeros */
-    if (payload_size != 0) {
-        result = ScanPacket(packet, &zero_head, &zero_tail);    
-        if (BLT_FAILED(result)) return result;
-        if (zero_head || zero_tail) {
-            ATX_LOG_FINER_2("SilenceRemoverInput::PutPacket zero_head=%d, zero_tail=%d",
-                            (int)zero_head, (int)zero_tail);
-        }
+    /* get the media type */
+    result = BLT_MediaPacket_GetMediaType(packet, (const BLT_MediaType**)(const void*)&media_type);
+    if (BLT_FAILED(result)) return result;
+
+    /* check the media type */
+    if (media_type->base.id != BLT_MEDIA_TYPE_ID_AUDIO_PCM) {
+        return BLT_ERROR_INVALID_MEDIA_TYPE;
+    }
+
+    /* a new stream starts, what we held was not the end of the previous one */
+    packet_flags = BLT_MediaPacket_GetFlags(packet);
+    if (packet_flags & BLT_MEDIA_PACKET_FLAG_START_OF_STREAM) {
+        SilenceRemover_AcceptPending(self);
+        ATX_LOG_FINER("SilenceRemover: new state = START_OF_STREAM");
+        self->state = SILENCE_REMOVER_STATE_START_OF_STREAM;
     }
 
     /* decide how to process the packet */
-    if (self->state == SILENCE_REMOVER_STATE_START_OF_STREAM) {
-        if (zero_head == payload_size) {
-            /* packet is all silence */
-            if (packet_flags != 0) {
-                /* packet has flags, don't discard it, just empty it */
-                ATX_LOG_FINER("SilenceRemover: emptying packet");
-                BLT_MediaPacket_SetPayloadSize(packet, 0);
-                SilenceRemover_AcceptPacket(self, packet);
-            } else {
-                ATX_LOG_FINER("SilenceRemover: dropping packet");
-            }
-        } else {
-            /* remove silence at the start of the packet */
-            BLT_MediaPacket_SetPayloadOffset(packet, payload_offset+zero_head);
-            SilenceRemover_AcceptPacket(self, packet);
+    if (SilenceRemover_SetupScanner(self, media_type, &scanner)) {
+        const unsigned char* payload     = BLT_MediaPacket_GetPayloadBuffer(packet);
+        BLT_Cardinal         frame_count = BLT_MediaPacket_GetPayloadSize(packet)/scanner.frame_size;
+        BLT_Cardinal         first_loud  = SilenceRemover_FindLoudFrame(&scanner, payload, frame_count);
 
-            /* we're now in the stream unless this is also the end */
-            if (!(packet_flags & BLT_MEDIA_PACKET_FLAG_END_OF_STREAM)) {
-                ATX_LOG_FINER("SilenceRemover: new state = IN_STREAM");
-                self->state =  SILENCE_REMOVER_STATE_IN_STREAM;
-            }
-        }
-    } else {
-        /* in stream */
-        if (zero_head == payload_size) {
-            /* packet is all silence */
+        if (first_loud == frame_count) {
             ATX_LOG_FINER("SilenceRemover: packet is all silence");
-            if (packet_flags) {
-                /* packet has flags, don't discard it, just empty it */
-                SilenceRemover_TrimPending(self);
-                BLT_MediaPacket_SetPayloadSize(packet, 0);
-                SilenceRemover_AcceptPacket(self, packet);
-            } else {
-                ATX_LOG_FINER("SilenceRemover: dropping packet");
-            }
+            SilenceRemover_ProcessSilence(self, packet, &scanner, frame_count);
         } else {
-            /* accept the pending packet */
-            SilenceRemover_AcceptPending(self);
-            if (zero_tail) {
-                /* packet has some silence at the end */
-                ATX_LOG_FINER("SilenceRemover: packet has silence at end");
-                SilenceRemover_HoldPacket(self, packet);
-            } else {
-                /* packet has no silence at the end */
-                ATX_LOG_FINER("SilenceRemover: packet has no silence at end");
-                SilenceRemover_AcceptPacket(self, packet);
-            }
-        }
-        if (packet_flags & BLT_MEDIA_PACKET_FLAG_END_OF_STREAM ||
-            packet_flags & BLT_MEDIA_PACKET_FLAG_START_OF_STREAM) {
-            ATX_LOG_FINER("SilenceRemover: new state = START_OF_STREAM");
-            self->state = SILENCE_REMOVER_STATE_START_OF_STREAM;
+            ATX_LOG_FINER_1("SilenceRemover: first sound at frame %d", (int)first_loud);
+            SilenceRemover_ProcessSound(self, packet, &scanner, first_loud);
         }
+    } else {
+        /* we can't scan this format, let the packet through */
+        SilenceRemover_AcceptPending(self);
+        SilenceRemover_AcceptPacket(self, packet);
+    }
+
+    /* the end of the stream is the end of the pending silence */
+    if (packet_flags & BLT_MEDIA_PACKET_FLAG_END_OF_STREAM) {
+        SilenceRemover_TrimPending(self);
+        ATX_LOG_FINER("SilenceRemover: new state = START_OF_STREAM");
+        self->state = SILENCE_REMOVER_STATE_START_OF_STREAM;
     }
 
     return BLT_SUCCESS;
@@ -425,6 +1074,56 @@ ATX_BEGIN_INTERFACE_MAP(SilenceRemoverOutput, BLT_PacketProducer)
     SilenceRemoverOutput_GetPacket
 ATX_END_INTERFACE_MAP
 
+/*----------------------------------------------------------------------
+|    SilenceRemover_UpdateSetting
++---------------------------------------------------------------------*/
+static void
+SilenceRemover_UpdateSetting(SilenceRemover*          self,
+                             ATX_CString              name,
+                             const ATX_PropertyValue* value)
+{
+    if (ATX_StringsEqual(name, BLT_SILENCE_REMOVER_THRESHOLD)) {
+        int    threshold = BLT_SILENCE_REMOVER_DEFAULT_THRESHOLD;
+        double level;
+        if (value && value->type == ATX_PROPERTY_VALUE_TYPE_INTEGER) {
+            threshold = value->data.integer;
+        }
+        if (threshold < BLT_SILENCE_REMOVER_MIN_THRESHOLD) threshold = BLT_SILENCE_REMOVER_MIN_THRESHOLD;
+        if (threshold > 0) threshold = 0;
+        level = pow(10.0, ((double)threshold)/2000.0);
+        self->settings.threshold_float = (float)level;
+        self->settings.threshold_16    = (ATX_Int32)(level*32768.0+0.5);
+        if (self->settings.threshold_16 < 1) self->settings.threshold_16 = 1;
+        if (level*2147483648.0 >= 2147483647.0) {
+            self->settings.threshold_32 = 0x7FFFFFFF;
+        } else {
+            self->settings.threshold_32 = (ATX_Int32)(level*2147483648.0+0.5);
+            if (self->settings.threshold_32 < 1) self->settings.threshold_32 = 1;
+        }
+    } else if (ATX_StringsEqual(name, BLT_SILENCE_REMOVER_MODE)) {
+        int mode = BLT_SILENCE_REMOVER_MODE_TRIM;
+        if (value && value->type == ATX_PROPERTY_VALUE_TYPE_INTEGER) {
+            mode = value->data.integer;
+        }
+        if (mode != BLT_SILENCE_REMOVER_MODE_COLLAPSE) mode = BLT_SILENCE_REMOVER_MODE_TRIM;
+        self->settings.mode = mode;
+    } else if (ATX_StringsEqual(name, BLT_SILENCE_REMOVER_MIN_DURATION)) {
+        int min_duration = BLT_SILENCE_REMOVER_DEFAULT_MIN_DURATION;
+        if (value && value->type == ATX_PROPERTY_VALUE_TYPE_INTEGER) {
+            min_duration = value->data.integer;
+        }
+        if (min_duration < 0) min_duration = 0;
+        if (min_duration > BLT_SILENCE_REMOVER_MAX_MIN_DURATION) {
+            min_duration = BLT_SILENCE_REMOVER_MAX_MIN_DURATION;
+        }
+        self->settings.min_duration = (BLT_Cardinal)min_duration;
+    } else {
+        return;
+    }
+
+    ATX_LOG_FINE_1("SilenceRemover::UpdateSetting - %s", name);
+}
+
 /*----------------------------------------------------------------------
 |    SilenceRemover_SetupPorts
 +---------------------------------------------------------------------*/
@@ -433,12 +1132,16 @@ SilenceRemover_SetupPorts(SilenceRemover* self)
 {
     ATX_Result result;
 
-    /* no pending packet yet */
-    self->input.pending = NULL;
+    /* create a list of pending packets */
+    result = ATX_List_Create(&self->input.pending);
+    if (ATX_FAILED(result)) return result;
 
     /* create a list of output packets */
     result = ATX_List_Create(&self->output.packets);
-    if (ATX_FAILED(result)) return result;
+    if (ATX_FAILED(result)) {
+        ATX_List_Destroy(self->input.pending);
+        return result;
+    }
     
     return BLT_SUCCESS;
 }
@@ -476,6 +1179,9 @@ SilenceRemover_Create(BLT_Module*              module,
 
     /* construct the object */
     self->state = SILENCE_REMOVER_STATE_START_OF_STREAM;
+    SilenceRemover_UpdateSetting(self, BLT_SILENCE_REMOVER_THRESHOLD,    NULL);
+    SilenceRemover_UpdateSetting(self, BLT_SILENCE_REMOVER_MODE,         NULL);
+    SilenceRemover_UpdateSetting(self, BLT_SILENCE_REMOVER_MIN_DURATION, NULL);
 
     /* setup the input and output ports */
     result = SilenceRemover_SetupPorts(self);
@@ -489,6 +1195,7 @@ SilenceRemover_Create(BLT_Module*              module,
     /* setup interfaces */
     ATX_SET_INTERFACE_EX(self, SilenceRemover, BLT_BaseMediaNode, BLT_MediaNode);
     ATX_SET_INTERFACE_EX(self, SilenceRemover, BLT_BaseMediaNode, ATX_Referenceable);
+    ATX_SET_INTERFACE(self, SilenceRemover, ATX_PropertyListener);
     ATX_SET_INTERFACE(&self->input,  SilenceRemoverInput,  BLT_MediaPort);
     ATX_SET_INTERFACE(&self->input,  SilenceRemoverInput,  BLT_PacketConsumer);
     ATX_SET_INTERFACE(&self->output, SilenceRemoverOutput, BLT_MediaPort);
@@ -498,6 +1205,25 @@ SilenceRemover_Create(BLT_Module*              module,
     return BLT_SUCCESS;
 }
 
+/*----------------------------------------------------------------------
+|    SilenceRemover_ReleasePending
++---------------------------------------------------------------------*/
+static void
+SilenceRemover_ReleasePending(SilenceRemover* self)
+{
+    ATX_ListItem* item = ATX_List_GetFirstItem(self->input.pending);
+    while (item) {
+        BLT_MediaPacket* packet = ATX_ListItem_GetData(item);
+        if (packet) {
+            BLT_MediaPacket_Release(packet);
+        }
+        item = ATX_ListItem_GetNext(item);
+    }
+    ATX_List_Clear(self->input.pending);
+    self->input.pending_sound   = 0;
+    self->input.pending_silence = 0;
+}
+
 /*----------------------------------------------------------------------
 |    SilenceRemover_Destroy
 +---------------------------------------------------------------------*/
@@ -509,9 +1235,8 @@ SilenceRemover_Destroy(SilenceRemover* self)
     ATX_LOG_FINE("SilenceRemover::Destroy");
 
     /* release any input packet we may hold */
-    if (self->input.pending) {
-        BLT_MediaPacket_Release(self->input.pending);
-    }
+    SilenceRemover_ReleasePending(self);
+    ATX_List_Destroy(self->input.pending);
 
     /* release any output packet we may hold */
     item = ATX_List_GetFirstItem(self->output.packets);
@@ -555,23 +1280,90 @@ SilenceRemover_GetPortByName(BLT_MediaNode*  _self,
     }
 }
 
+/*----------------------------------------------------------------------
+|    SilenceRemover_Activate
++---------------------------------------------------------------------*/
+BLT_METHOD
+SilenceRemover_Activate(BLT_MediaNode* _self, BLT_Stream* stream)
+{
+    SilenceRemover* self = ATX_SELF_EX(SilenceRemover, BLT_BaseMediaNode, BLT_MediaNode);
+
+    /* keep a reference to the stream */
+    ATX_BASE(self, BLT_BaseMediaNode).context = stream;
+
+    /* listen to settings on the new stream */
+    if (stream) {
+        ATX_Properties* properties;
+        if (BLT_SUCCEEDED(BLT_Stream_GetProperties(ATX_BASE(self, BLT_BaseMediaNode).context,
+                                                   &properties))) {
+            static const char* const names[3] = {
+                BLT_SILENCE_REMOVER_THRESHOLD,
+                BLT_SILENCE_REMOVER_MODE,
+                BLT_SILENCE_REMOVER_MIN_DURATION
+            };
+            ATX_PropertyListenerHandle* handles[3];
+            unsigned int                i;
+
+            handles[0] = &self->threshold_listener_handle;
+            handles[1] = &self->mode_listener_handle;
+            handles[2] = &self->min_duration_listener_handle;
+            for (i=0; i<3; i++) {
+                ATX_PropertyValue property;
+                ATX_Properties_AddListener(properties,
+                                           names[i],
+                                           &ATX_BASE(self, ATX_PropertyListener),
+                                           handles[i]);
+
+                /* read the initial value */
+                if (ATX_SUCCEEDED(ATX_Properties_GetProperty(properties, names[i], &property))) {
+                    SilenceRemover_UpdateSetting(self, names[i], &property);
+                }
+            }
+        }
+    }
+
+    return BLT_SUCCESS;
+}
+
+/*----------------------------------------------------------------------
+|    SilenceRemover_Deactivate
++---------------------------------------------------------------------*/
+BLT_METHOD
+SilenceRemover_Deactivate(BLT_MediaNode* _self)
+{
+    SilenceRemover* self = ATX_SELF_EX(SilenceRemover, BLT_BaseMediaNode, BLT_MediaNode);
+
+    /* remove our listeners */
+    if (ATX_BASE(self, BLT_BaseMediaNode).context) {
+        ATX_Properties* properties;
+        if (BLT_SUCCEEDED(BLT_Stream_GetProperties(ATX_BASE(self, BLT_BaseMediaNode).context,
+                                                   &properties))) {
+            ATX_Properties_RemoveListener(properties, self->threshold_listener_handle);
+            ATX_Properties_RemoveListener(properties, self->mode_listener_handle);
+            ATX_Properties_RemoveListener(properties, self->min_duration_listener_handle);
+        }
+    }
+
+    /* we're detached from the stream */
+    ATX_BASE(self, BLT_BaseMediaNode).context = NULL;
+
+    return BLT_SUCCESS;
+}
+
 /*----------------------------------------------------------------------
 |    SilenceRemover_Seek
 +---------------------------------------------------------------------*/
 BLT_METHOD
-SilenceRemover_Seek(BLT_MediaNode* instance,
+SilenceRemover_Seek(BLT_MediaNode* _self,
                     BLT_SeekMode*  mode,
                     BLT_SeekPoint* point)
 {
-    SilenceRemover* self = (SilenceRemover*)instance;
+    SilenceRemover* self = ATX_SELF_EX(SilenceRemover, BLT_BaseMediaNode, BLT_MediaNode);
     BLT_COMPILER_UNUSED(mode);
     BLT_COMPILER_UNUSED(point);
     
-    /* flush the pending packet */
-    if (self->input.pending) {
-        BLT_MediaPacket_Release(self->input.pending);
-    } 
-    self->input.pending = NULL;
+    /* flush the pending packets */
+    SilenceRemover_ReleasePending(self);
 
     return BLT_SUCCESS;
 }
@@ -582,6 +1374,7 @@ SilenceRemover_Seek(BLT_MediaNode* instance,
 ATX_BEGIN_GET_INTERFACE_IMPLEMENTATION(SilenceRemover)
     ATX_GET_INTERFACE_ACCEPT_EX(SilenceRemover, BLT_BaseMediaNode, BLT_MediaNode)
     ATX_GET_INTERFACE_ACCEPT_EX(SilenceRemover, BLT_BaseMediaNode, ATX_Referenceable)
+    ATX_GET_INTERFACE_ACCEPT(SilenceRemover, ATX_PropertyListener)
 ATX_END_GET_INTERFACE_IMPLEMENTATION
 
 /*----------------------------------------------------------------------
@@ -590,8 +1383,8 @@ ATX_END_GET_INTERFACE_IMPLEMENTATION
 ATX_BEGIN_INTERFACE_MAP_EX(SilenceRemover, BLT_BaseMediaNode, BLT_MediaNode)
     BLT_BaseMediaNode_GetInfo,
     SilenceRemover_GetPortByName,
-    BLT_BaseMediaNode_Activate,
-    BLT_BaseMediaNode_Deactivate,
+    SilenceRemover_Activate,
+    SilenceRemover_Deactivate,
     BLT_BaseMediaNode_Start,
     BLT_BaseMediaNode_Stop,
     BLT_BaseMediaNode_Pause,
@@ -599,6 +1392,26 @@ ATX_BEGIN_INTERFACE_MAP_EX(SilenceRemover, BLT_BaseMediaNode, BLT_MediaNode)
     SilenceRemover_Seek
 };
 
+/*----------------------------------------------------------------------
+|    SilenceRemover_OnPropertyChanged
++---------------------------------------------------------------------*/
+BLT_VOID_METHOD
+SilenceRemover_OnPropertyChanged(ATX_PropertyListener*    _self,
+                                 ATX_CString              name,
+                                 const ATX_PropertyValue* value)
+{
+    SilenceRemover* self = ATX_SELF(SilenceRemover, ATX_PropertyListener);
+
+    if (name) SilenceRemover_UpdateSetting(self, name, value);
+}
+
+/*----------------------------------------------------------------------
+|    ATX_PropertyListener interface
++---------------------------------------------------------------------*/
+ATX_BEGIN_INTERFACE_MAP(SilenceRemover, ATX_PropertyListener)
+    SilenceRemover_OnPropertyChanged,
+};
+
 /*----------------------------------------------------------------------
 |   ATX_Referenceable interface
 +---------------------------------------------------------------------*/
@@ -711,5 +1524,5 @@ ATX_IMPLEMENT_REFERENCEABLE_INTERFACE(SilenceRemoverModule, reference_count)
 BLT_MODULE_IMPLEMENT_STANDARD_GET_MODULE(SilenceRemoverModule,
                                          "Silence Remover",
                                          "com.axiosys.general.silence-remover",
-                                         "1.0.0",
+                                         "2.0.0",
                                          BLT_MODULE_AXIOMATIC_COPYRIGHT)
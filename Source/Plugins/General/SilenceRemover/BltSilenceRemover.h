@@ -16,6 +16,35 @@
 #include "BltTypes.h"
 #include "BltModule.h"
 
+/*----------------------------------------------------------------------
+|   constants
++---------------------------------------------------------------------*/
+/**
+ * Stream property for the level under which audio is considered silent,
+ * in 100th of dBFS (integer). Defaults to -5400 (-54 dBFS).
+ */
+#define BLT_SILENCE_REMOVER_THRESHOLD    "Plugins.SilenceRemover.Threshold"
+
+/**
+ * Stream property selecting which silences are removed (integer), one of
+ * the BLT_SILENCE_REMOVER_MODE_XXX values. Defaults to
+ * BLT_SILENCE_REMOVER_MODE_TRIM.
+ */
+#define BLT_SILENCE_REMOVER_MODE         "Plugins.SilenceRemover.Mode"
+
+/**
+ * Stream property for the duration above which a silence in the middle
+ * of a stream is collapsed, in milliseconds (integer). Collapsed silences
+ * are shortened to that duration. Defaults to 1000.
+ */
+#define BLT_SILENCE_REMOVER_MIN_DURATION "Plugins.SilenceRemover.MinDuration"
+
+/** Remove the silence at the start and at the end of streams */
+#define BLT_SILENCE_REMOVER_MODE_TRIM     0
+
+/** Also collapse the long silences in the middle of streams */
+#define BLT_SILENCE_REMOVER_MODE_COLLAPSE 1
+
 /*----------------------------------------------------------------------
 |   module
 +---------------------------------------------------------------------*/
@@ -0,0 +1,278 @@
+/*****************************************************************
+|
+|   BlueTune - HTTP Connection Pool
+|
+|   (c) 2002-2012 Gilles Boccon-Gibod
+|   Author: Gilles Boccon-Gibod (bok@bok.net)
+|
+****************************************************************/
+
+/*----------------------------------------------------------------------
+|   includes
++---------------------------------------------------------------------*/
+#include "Neptune.h"
+#include "Atomix.h"
+#include "BltTypes.h"
+#include "BltErrors.h"
+#include "BltCore.h"
+#include "BltHttpConnectionPool.h"
+
+/*----------------------------------------------------------------------
+|   logging
++---------------------------------------------------------------------*/
+ATX_SET_LOCAL_LOGGER("bluetune.plugins.inputs.network.http.pool")
+
+/*----------------------------------------------------------------------
+|   BLT_HttpConnection::BLT_HttpConnection
++---------------------------------------------------------------------*/
+BLT_HttpConnection::BLT_HttpConnection(const char*                key,
+                                       NPT_InputStreamReference&  input_stream,
+                                       NPT_OutputStreamReference& output_stream) :
+    m_Key(key),
+    m_InputStream(new NPT_BufferedInputStream(input_stream)),
+    m_OutputStream(output_stream),
+    m_Socket(BLT_SOCKET_FD_INVALID),
+    m_RequestCount(0)
+{
+    NPT_System::GetCurrentTimeStamp(m_LastUsed);
+}
+
+/*----------------------------------------------------------------------
+|   BLT_HttpConnectionPool::BLT_HttpConnectionPool
++---------------------------------------------------------------------*/
+BLT_HttpConnectionPool::BLT_HttpConnectionPool() :
+    m_ReferenceCount(1)
+{
+}
+
+/*----------------------------------------------------------------------
+|   BLT_HttpConnectionPool::~BLT_HttpConnectionPool
++---------------------------------------------------------------------*/
+BLT_HttpConnectionPool::~BLT_HttpConnectionPool()
+{
+    m_IdleConnections.Apply(NPT_ObjectDeleter<BLT_HttpConnection>());
+}
+
+/*----------------------------------------------------------------------
+|   BLT_HttpConnectionPool::AddReference
++---------------------------------------------------------------------*/
+void
+BLT_HttpConnectionPool::AddReference()
+{
+    NPT_AutoLock lock(m_Lock);
+    ++m_ReferenceCount;
+}
+
+/*----------------------------------------------------------------------
+|   BLT_HttpConnectionPool::Release
++---------------------------------------------------------------------*/
+void
+BLT_HttpConnectionPool::Release()
+{
+    bool last;
+    {
+        NPT_AutoLock lock(m_Lock);
+        last = (--m_ReferenceCount == 0);
+    }
+    if (last) delete this;
+}
+
+/*----------------------------------------------------------------------
+|   BLT_HttpConnectionPool::MakeKey
++---------------------------------------------------------------------*/
+NPT_String
+BLT_HttpConnectionPool::MakeKey(const NPT_HttpUrl& url)
+{
+    NPT_String key = url.GetHost();
+    key.MakeLowercase();
+    key += ":";
+    key += NPT_String::FromIntegerU(url.GetPort());
+
+    return key;
+}
+
+/*----------------------------------------------------------------------
+|   BLT_HttpConnectionPool::Connect
++---------------------------------------------------------------------*/
+NPT_Result
+BLT_HttpConnectionPool::Connect(const NPT_HttpUrl& url, BLT_HttpConnection*& connection)
+{
+    connection = NULL;
+
+    // resolve the hostname
+    NPT_IpAddress address;
+    NPT_Result result = address.ResolveName(url.GetHost(), BLT_HTTP_CONNECTION_POOL_CONNECT_TIMEOUT);
+    if (NPT_FAILED(result)) {
+        ATX_LOG_WARNING_2("failed to resolve %s (%d)", url.GetHost().GetChars(), result);
+        return result;
+    }
+
+    // connect
+    NPT_InputStreamReference  input_stream;
+    NPT_OutputStreamReference output_stream;
+    BLT_SocketFd              socket = BLT_SOCKET_FD_INVALID;
+    result = BLT_TcpSocket_Connect(NPT_SocketAddress(address, url.GetPort()),
+                                   BLT_HTTP_CONNECTION_POOL_CONNECT_TIMEOUT,
+                                   BLT_HTTP_CONNECTION_POOL_IO_TIMEOUT,
+                                   input_stream,
+                                   output_stream,
+                                   socket);
+    if (NPT_FAILED(result)) {
+        ATX_LOG_WARNING_2("failed to connect to %s (%d)", url.GetHost().GetChars(), result);
+        return result;
+    }
+
+    connection = new BLT_HttpConnection(MakeKey(url), input_stream, output_stream);
+    connection->m_Socket = socket;
+    ATX_LOG_FINE_1("new connection to %s", connection->m_Key.GetChars());
+
+    return NPT_SUCCESS;
+}
+
+/*----------------------------------------------------------------------
+|   BLT_HttpConnectionPool::Cleanup
++---------------------------------------------------------------------*/
+void
+BLT_HttpConnectionPool::Cleanup()
+{
+    NPT_TimeStamp now;
+    NPT_System::GetCurrentTimeStamp(now);
+
+    NPT_List<BLT_HttpConnection*>::Iterator it = m_IdleConnections.GetFirstItem();
+    while (it) {
+        BLT_HttpConnection* connection = *it;
+        NPT_List<BLT_HttpConnection*>::Iterator next = it;
+        ++next;
+        if (now.ToMillis()-connection->m_LastUsed.ToMillis() > BLT_HTTP_CONNECTION_POOL_MAX_IDLE_TIME) {
+            ATX_LOG_FINE_1("closing expired connection to %s", connection->m_Key.GetChars());
+            m_IdleConnections.Erase(it);
+            delete connection;
+        }
+        it = next;
+    }
+}
+
+/*----------------------------------------------------------------------
+|   BLT_HttpConnectionPool::Acquire
++---------------------------------------------------------------------*/
+NPT_Result
+BLT_HttpConnectionPool::Acquire(const NPT_HttpUrl&   url,
+                                BLT_HttpConnection*& connection,
+                                bool&                reused)
+{
+    NPT_String key = MakeKey(url);
+
+    connection = NULL;
+    reused     = false;
+
+    // look for an idle connection, most recently used first
+    {
+        NPT_AutoLock lock(m_Lock);
+        Cleanup();
+
+        NPT_List<BLT_HttpConnection*>::Iterator it = m_IdleConnections.GetLastItem();
+        while (it) {
+            if ((*it)->m_Key == key) {
+                connection = *it;
+                m_IdleConnections.Erase(it);
+                break;
+            }
+            --it;
+        }
+    }
+    if (connection) {
+        ATX_LOG_FINE_2("reusing connection to %s (%d requests so far)",
+                       key.GetChars(), connection->m_RequestCount);
+        reused = true;
+        return NPT_SUCCESS;
+    }
+
+    // nothing in the pool, make a new connection
+    return Connect(url, connection);
+}
+
+/*----------------------------------------------------------------------
+|   BLT_HttpConnectionPool::Recycle
++---------------------------------------------------------------------*/
+void
+BLT_HttpConnectionPool::Recycle(BLT_HttpConnection* connection)
+{
+    if (connection == NULL) return;
+
+    NPT_System::GetCurrentTimeStamp(connection->m_LastUsed);
+
+    NPT_AutoLock lock(m_Lock);
+    Cleanup();
+
+    // limit the number of idle connections per host by closing the oldest ones
+    unsigned int count = 0;
+    NPT_List<BLT_HttpConnection*>::Iterator it = m_IdleConnections.GetLastItem();
+    while (it) {
+        NPT_List<BLT_HttpConnection*>::Iterator previous = it;
+        --previous;
+        if ((*it)->m_Key == connection->m_Key &&
+            ++count >= BLT_HTTP_CONNECTION_POOL_MAX_IDLE_CONNECTIONS_PER_HOST) {
+            delete *it;
+            m_IdleConnections.Erase(it);
+        }
+        it = previous;
+    }
+
+    ATX_LOG_FINE_1("recycling connection to %s", connection->m_Key.GetChars());
+    m_IdleConnections.Add(connection);
+}
+
+/*----------------------------------------------------------------------
+|   BLT_HttpConnectionPool_Create
++---------------------------------------------------------------------*/
+BLT_Result
+BLT_HttpConnectionPool_Create(BLT_HttpConnectionPool** pool)
+{
+    *pool = new BLT_HttpConnectionPool();
+    return BLT_SUCCESS;
+}
+
+/*----------------------------------------------------------------------
+|   BLT_HttpConnectionPool_AddReference
++---------------------------------------------------------------------*/
+BLT_Result
+BLT_HttpConnectionPool_AddReference(BLT_HttpConnectionPool* self)
+{
+    if (self) self->AddReference();
+    return BLT_SUCCESS;
+}
+
+/*----------------------------------------------------------------------
+|   BLT_HttpConnectionPool_Release
++---------------------------------------------------------------------*/
+BLT_Result
+BLT_HttpConnectionPool_Release(BLT_HttpConnectionPool* self)
+{
+    if (self) self->Release();
+    return BLT_SUCCESS;
+}
+
+/*----------------------------------------------------------------------
+|   BLT_HttpConnectionPool_GetFromCore
++---------------------------------------------------------------------*/
+BLT_Result
+BLT_HttpConnectionPool_GetFromCore(BLT_Core*                core,
+                                   BLT_HttpConnectionPool** pool)
+{
+    ATX_Properties*   properties = NULL;
+    ATX_PropertyValue value;
+
+    *pool = NULL;
+    if (core == NULL) return BLT_ERROR_INVALID_PARAMETERS;
+
+    if (ATX_SUCCEEDED(BLT_Core_GetProperties(core, &properties)) &&
+        ATX_SUCCEEDED(ATX_Properties_GetProperty(properties, BLT_HTTP_CONNECTION_POOL_PROPERTY, &value)) &&
+        value.type == ATX_PROPERTY_VALUE_TYPE_POINTER &&
+        value.data.pointer != NULL) {
+        *pool = (BLT_HttpConnectionPool*)value.data.pointer;
+        (*pool)->AddReference();
+        return BLT_SUCCESS;
+    }
+
+    return ATX_ERROR_NO_SUCH_ITEM;
+}
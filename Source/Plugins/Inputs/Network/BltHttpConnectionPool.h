@@ -0,0 +1,139 @@
+/*****************************************************************
+|
+|   BlueTune - HTTP Connection Pool
+|
+|   (c) 2002-2012 Gilles Boccon-Gibod
+|   Author: Gilles Boccon-Gibod (bok@bok.net)
+|
+****************************************************************/
+
+#ifndef _BLT_HTTP_CONNECTION_POOL_H_
+#define _BLT_HTTP_CONNECTION_POOL_H_
+
+/*----------------------------------------------------------------------
+|   includes
++---------------------------------------------------------------------*/
+#include "BltTypes.h"
+#include "BltCore.h"
+
+/*----------------------------------------------------------------------
+|   constants
++---------------------------------------------------------------------*/
+/**
+ * Name of the core property under which the network input module
+ * publishes the address of the connection pool of a core.
+ */
+#define BLT_HTTP_CONNECTION_POOL_PROPERTY "NetworkInput.HttpConnectionPool"
+
+#define BLT_HTTP_CONNECTION_POOL_MAX_IDLE_CONNECTIONS_PER_HOST 4
+#define BLT_HTTP_CONNECTION_POOL_MAX_IDLE_TIME                 30000 /* ms */
+#define BLT_HTTP_CONNECTION_POOL_CONNECT_TIMEOUT               30000 /* ms */
+#define BLT_HTTP_CONNECTION_POOL_IO_TIMEOUT                    30000 /* ms */
+
+/*----------------------------------------------------------------------
+|   types
++---------------------------------------------------------------------*/
+typedef struct BLT_HttpConnectionPool BLT_HttpConnectionPool;
+
+/*----------------------------------------------------------------------
+|   functions
++---------------------------------------------------------------------*/
+#if defined(__cplusplus)
+extern "C" {
+#endif
+
+BLT_Result
+BLT_HttpConnectionPool_Create(BLT_HttpConnectionPool** pool);
+
+BLT_Result
+BLT_HttpConnectionPool_AddReference(BLT_HttpConnectionPool* self);
+
+BLT_Result
+BLT_HttpConnectionPool_Release(BLT_HttpConnectionPool* self);
+
+/**
+ * Get the connection pool published by the network input module
+ * attached to a core.
+ * The caller receives a new reference to the pool, or NULL if no pool
+ * has been published for this core.
+ */
+BLT_Result
+BLT_HttpConnectionPool_GetFromCore(BLT_Core*                core,
+                                   BLT_HttpConnectionPool** pool);
+
+#if defined(__cplusplus)
+}
+#endif
+
+/*----------------------------------------------------------------------
+|   C++ interface
++---------------------------------------------------------------------*/
+#if defined(__cplusplus)
+#include "Neptune.h"
+#include "BltNetworkSockets.h"
+
+/**
+ * Persistent (keep-alive) connection to an HTTP server.
+ */
+class BLT_HttpConnection {
+public:
+    BLT_HttpConnection(const char*                key,
+                       NPT_InputStreamReference&  input_stream,
+                       NPT_OutputStreamReference& output_stream);
+
+    // members
+    NPT_String                       m_Key;
+    NPT_BufferedInputStreamReference m_InputStream;
+    NPT_OutputStreamReference        m_OutputStream;
+    BLT_SocketFd                     m_Socket; // BLT_SOCKET_FD_INVALID if unknown
+    NPT_TimeStamp                    m_LastUsed;
+    unsigned int                     m_RequestCount;
+};
+
+/**
+ * Set of idle keep-alive connections, keyed by host:port.
+ * Connections are handed out to one user at a time, and returned
+ * to the pool once the last response received on them has been
+ * entirely consumed.
+ */
+struct BLT_HttpConnectionPool {
+public:
+    // methods
+    BLT_HttpConnectionPool();
+    ~BLT_HttpConnectionPool();
+
+    void       AddReference();
+    void       Release();
+
+    /**
+     * Get a connection to the host of a URL, either an idle one from
+     * the pool, or a newly established one.
+     * @param reused Set to true if the connection was taken from the pool
+     * (in which case the server may have closed it in the meantime).
+     */
+    NPT_Result Acquire(const NPT_HttpUrl&   url,
+                       BLT_HttpConnection*& connection,
+                       bool&                reused);
+
+    /**
+     * Return a connection to the pool. The pool takes ownership of the
+     * connection object.
+     */
+    void       Recycle(BLT_HttpConnection* connection);
+
+    static NPT_String MakeKey(const NPT_HttpUrl& url);
+    static NPT_Result Connect(const NPT_HttpUrl& url, BLT_HttpConnection*& connection);
+
+private:
+    // methods
+    void Cleanup();
+
+    // members
+    NPT_Mutex                       m_Lock;
+    unsigned int                    m_ReferenceCount;
+    NPT_List<BLT_HttpConnection*>   m_IdleConnections;
+};
+
+#endif /* __cplusplus */
+
+#endif /* _BLT_HTTP_CONNECTION_POOL_H_ */
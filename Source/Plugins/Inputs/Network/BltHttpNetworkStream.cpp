@@ -15,6 +15,8 @@
 #include "BltTypes.h"
 #include "BltModule.h"
 #include "BltHttpNetworkStream.h"
+#include "BltHttpConnectionPool.h"
+#include "BltNetworkCache.h"
 #include "BltNetworkStream.h"
 #include "BltNetworkInputSource.h"
 #include "BltStream.h"
@@ -28,6 +30,23 @@ ATX_SET_LOCAL_LOGGER("bluetune.plugins.inputs.network.http")
 |   constants
 +---------------------------------------------------------------------*/
 const BLT_Size BLT_HTTP_NETWORK_STREAM_DEFAULT_BUFFER_SIZE  = 262144;
+const BLT_Size BLT_HTTP_NETWORK_STREAM_DEFAULT_RANGE_SIZE   = 524288;
+
+/**
+ * When less than this many bytes remain in the current range, the request
+ * for the next range is sent on the same connection (pipelining).
+ */
+const BLT_Size BLT_HTTP_NETWORK_STREAM_PREFETCH_THRESHOLD   = 65536;
+
+/**
+ * When abandoning a response, the rest of the body is read and discarded
+ * if it is shorter than this, so that the connection can be reused.
+ */
+const BLT_Size BLT_HTTP_NETWORK_STREAM_DRAIN_THRESHOLD      = 32768;
+
+const unsigned int BLT_HTTP_NETWORK_STREAM_MAX_REDIRECTS    = 5;
+
+#define BLT_HTTP_NETWORK_STREAM_USER_AGENT "BlueTune/1.0"
 
 /*----------------------------------------------------------------------
 |   HttpInputStream
@@ -44,10 +63,12 @@ typedef struct {
 
     // members
     ATX_Cardinal              m_ReferenceCount;
+    BLT_HttpConnectionPool*   m_ConnectionPool;
+    BLT_HttpConnection*       m_Connection;
     NPT_HttpClient*           m_HttpClient;
+    bool                      m_KeepAlive;
     NPT_HttpUrl*              m_Url;
     NPT_HttpResponse*         m_Response;
-    NPT_InputStreamReference* m_InputStream;
     NPT_LargeSize             m_ContentLength;
     NPT_Position              m_Position;
     bool                      m_Eos;
@@ -57,6 +78,20 @@ typedef struct {
     unsigned int              m_IcyMetaCounter;
     BLT_Stream*               m_Context;
     BLT_UInt64                m_LastNotification;
+
+    // range scheduling
+    NPT_Size                  m_RangeSize;
+    bool                      m_Pipelining;
+    bool                      m_BodyHasLength;
+    NPT_LargeSize             m_BodyRemaining;
+    bool                      m_Ranged;
+    bool                      m_RangePending;
+    NPT_Position              m_PendingRangeStart;
+
+    // revalidation of cached data
+    BLT_NetworkCacheInfo*     m_CacheInfo;
+    bool                      m_Revalidating;
+    bool                      m_Revalidated;
 } HttpInputStream;
 
 /*----------------------------------------------------------------------
@@ -90,11 +125,38 @@ HttpInputStream_GetProperty(ATX_Properties*    _self,
             value->data.integer = ATX_INPUT_STREAM_SEEK_SPEED_NO_SEEK;
         }
         return ATX_SUCCESS;
+    } else if (name != NULL && ATX_StringsEqual(name, BLT_NETWORK_STREAM_SOCKET_PROPERTY)) {
+        // only connections from the pool have a socket we can wait for
+        if (self->m_Connection == NULL || self->m_Connection->m_Socket == BLT_SOCKET_FD_INVALID) {
+            return ATX_ERROR_NO_SUCH_PROPERTY;
+        }
+        value->type = ATX_PROPERTY_VALUE_TYPE_INTEGER;
+        value->data.integer = (ATX_Int32)self->m_Connection->m_Socket;
+        return ATX_SUCCESS;
     }
     
     return ATX_ERROR_NO_SUCH_PROPERTY;
 }
 
+/*----------------------------------------------------------------------
+|   HttpInputStream_GetContentType
++---------------------------------------------------------------------*/
+static NPT_String
+HttpInputStream_GetContentType(HttpInputStream* self)
+{
+    NPT_String content_type;
+    if (self->m_Response && self->m_Response->GetEntity()) {
+        content_type = self->m_Response->GetEntity()->GetContentType();
+    }
+
+    // a 304 usually comes without a content type, the cache knows it
+    if (content_type.IsEmpty() && self->m_Revalidated) {
+        content_type = self->m_CacheInfo->m_ContentType;
+    }
+
+    return content_type;
+}
+
 /*----------------------------------------------------------------------
 |   HttpInputStream_GetMediaType
 +---------------------------------------------------------------------*/
@@ -117,7 +179,7 @@ HttpInputStream_GetMediaType(HttpInputStream*  self,
     if (BLT_FAILED(result)) return result;
 
     // query the registry for the content type
-    NPT_String content_type = self->m_Response->GetEntity()->GetContentType();
+    NPT_String content_type = HttpInputStream_GetContentType(self);
     ATX_LOG_FINE_1("HttpInputStream::GetMediaType - Content-Type = %s", 
                    content_type.GetChars());
     if (content_type.GetLength() == 0 && self->m_IsIcy) {
@@ -158,76 +220,296 @@ HttpInputStream_GetMediaType(HttpInputStream*  self,
     return BLT_SUCCESS;
 }
 
+/*----------------------------------------------------------------------
+|   HttpInputStream_ReleaseConnection
++---------------------------------------------------------------------*/
+static void
+HttpInputStream_ReleaseConnection(HttpInputStream* self, bool reusable)
+{
+    if (self->m_Connection == NULL) return;
+
+    if (reusable && self->m_KeepAlive && self->m_ConnectionPool) {
+        self->m_ConnectionPool->Recycle(self->m_Connection);
+    } else {
+        delete self->m_Connection;
+    }
+    self->m_Connection   = NULL;
+    self->m_KeepAlive    = false;
+    self->m_RangePending = false;
+}
+
+/*----------------------------------------------------------------------
+|   HttpInputStream_AbandonResponse
++---------------------------------------------------------------------*/
+static void
+HttpInputStream_AbandonResponse(HttpInputStream* self)
+{
+    if (self->m_Connection == NULL) return;
+
+    // a connection with a pipelined request in flight, or with a large or
+    // unbounded body left to read, cannot be reused cheaply
+    if (self->m_RangePending   ||
+        !self->m_KeepAlive     ||
+        !self->m_BodyHasLength ||
+        self->m_BodyRemaining > BLT_HTTP_NETWORK_STREAM_DRAIN_THRESHOLD) {
+        HttpInputStream_ReleaseConnection(self, false);
+        return;
+    }
+
+    // drain what's left so that the connection can be reused
+    if (self->m_BodyRemaining) {
+        ATX_LOG_FINER_1("draining %d bytes", (int)self->m_BodyRemaining);
+        unsigned char scratch[4096];
+        while (self->m_BodyRemaining) {
+            NPT_Size chunk = self->m_BodyRemaining > sizeof(scratch) ?
+                             sizeof(scratch) : (NPT_Size)self->m_BodyRemaining;
+            NPT_Result result = self->m_Connection->m_InputStream->ReadFully(scratch, chunk);
+            if (NPT_FAILED(result)) {
+                HttpInputStream_ReleaseConnection(self, false);
+                return;
+            }
+            self->m_BodyRemaining -= chunk;
+        }
+    }
+    HttpInputStream_ReleaseConnection(self, true);
+}
+
 /*----------------------------------------------------------------------
 |   HttpInputStream_Destroy
 +---------------------------------------------------------------------*/
 static void
 HttpInputStream_Destroy(HttpInputStream* self)
 {
-    delete self->m_HttpClient;
+    HttpInputStream_AbandonResponse(self);
+    BLT_HttpConnectionPool_Release(self->m_ConnectionPool);
     delete self->m_Url;
     delete self->m_Response;
-    *self->m_InputStream = NULL;
-    delete self->m_InputStream;
+    delete self->m_HttpClient;
+    delete self->m_CacheInfo;
     delete self;
 }
 
 /*----------------------------------------------------------------------
-|   HttpInputStream_SendRequest
+|   HttpInputStream_AcquireConnection
 +---------------------------------------------------------------------*/
-BLT_METHOD
-HttpInputStream_SendRequest(HttpInputStream* self, NPT_Position position)
+static NPT_Result
+HttpInputStream_AcquireConnection(HttpInputStream* self, bool& reused)
 {
-    // send the request
-    NPT_Result      result = BLT_FAILURE;
-    NPT_HttpRequest request(*self->m_Url, NPT_HTTP_METHOD_GET);
+    reused = false;
+    self->m_KeepAlive = false;
+    if (self->m_ConnectionPool) {
+        return self->m_ConnectionPool->Acquire(*self->m_Url, self->m_Connection, reused);
+    } else {
+        return BLT_HttpConnectionPool::Connect(*self->m_Url, self->m_Connection);
+    }
+}
 
-    // delete any previous response we may have
-    delete self->m_Response;
-    self->m_Response = NULL;
-    *self->m_InputStream = NULL;
+/*----------------------------------------------------------------------
+|   HttpInputStream_GetResumePosition
+|
+|   When data for the resource is in the cache, the first request is made
+|   conditional on the resource being unchanged. A fully cached resource
+|   is only revalidated (with If-None-Match or If-Modified-Since, answered
+|   with a 304 if it has not changed). A partially cached one is resumed
+|   where the cached data ends (with a Range and If-Range, answered with a
+|   206 if it has not changed, and with the whole body otherwise).
++---------------------------------------------------------------------*/
+static NPT_Position
+HttpInputStream_GetResumePosition(HttpInputStream* self)
+{
+    if (!self->m_Revalidating) return 0;
+    if (self->m_CacheInfo->m_CachedSize >= self->m_CacheInfo->m_Size) return 0;
 
-    // handle a non-zero start position
-    if (position) {
-        if (self->m_ContentLength == position) {
-            // special case: seek to end of stream
-            self->m_Eos = true;
-            return BLT_SUCCESS;
-        }
-        NPT_String range = "bytes="+NPT_String::FromInteger(position);
+    return self->m_CacheInfo->m_CachedSize;
+}
+
+/*----------------------------------------------------------------------
+|   HttpInputStream_GetCondition
++---------------------------------------------------------------------*/
+static bool
+HttpInputStream_GetCondition(HttpInputStream* self,
+                             NPT_String&      header,
+                             NPT_String&      value)
+{
+    if (!self->m_Revalidating) return false;
+
+    // the validator is "etag:<entity tag>" or "date:<last modified>"
+    const NPT_String& validator = self->m_CacheInfo->m_Validator;
+    bool              etag = validator.StartsWith("etag:");
+    value = validator.GetChars()+5;
+    if (HttpInputStream_GetResumePosition(self)) {
+        header = "If-Range";
+    } else {
+        header = etag ? "If-None-Match" : "If-Modified-Since";
+    }
+
+    return true;
+}
+
+/*----------------------------------------------------------------------
+|   HttpInputStream_ParseContentRange
++---------------------------------------------------------------------*/
+static NPT_Result
+HttpInputStream_ParseContentRange(HttpInputStream* self,
+                                  NPT_Position&    start,
+                                  NPT_LargeSize&   total)
+{
+    // bytes <first>-<last>/<total>
+    const NPT_String* range = self->m_Response->GetHeaders().GetHeaderValue("Content-Range");
+    if (range == NULL || !range->StartsWith("bytes ", true)) return BLT_ERROR_PROTOCOL_FAILURE;
+    int dash  = range->Find('-');
+    int slash = range->Find('/');
+    if (dash < 0 || slash < dash) return BLT_ERROR_PROTOCOL_FAILURE;
+    NPT_LargeSize first = 0;
+    NPT_LargeSize size  = 0;
+    NPT_CHECK(range->SubString(6, dash-6).ToInteger64(first));
+    NPT_CHECK(range->SubString(slash+1).ToInteger64(size));
+    start = first;
+    total = size;
+
+    return NPT_SUCCESS;
+}
+
+/*----------------------------------------------------------------------
+|   HttpInputStream_EmitRequest
++---------------------------------------------------------------------*/
+static NPT_Result
+HttpInputStream_EmitRequest(HttpInputStream* self,
+                            NPT_Position     start,
+                            NPT_Position     end)
+{
+    // we use HTTP/1.0 with an explicit keep-alive so that the server never
+    // sends a chunked body
+    NPT_String request = "GET ";
+    request += self->m_Url->ToRequestString();
+    request += " HTTP/1.0\r\n";
+    request += "Host: ";
+    request += self->m_Url->GetHost();
+    if (self->m_Url->GetPort() != NPT_HTTP_DEFAULT_PORT) {
+        request += ":";
+        request += NPT_String::FromIntegerU(self->m_Url->GetPort());
+    }
+    request += "\r\n";
+    request += "User-Agent: " BLT_HTTP_NETWORK_STREAM_USER_AGENT "\r\n";
+    request += "Connection: keep-alive\r\n";
+
+    // handle a range request
+    if (start || end) {
+        NPT_String range = "bytes="+NPT_String::FromInteger(start);
         range += "-";
-        request.GetHeaders().SetHeader(NPT_HTTP_HEADER_RANGE, range);
-        ATX_LOG_FINE_1("HttpInputStream_SendRequest - seek, %s", range.GetChars());
+        if (end) range += NPT_String::FromInteger(end-1);
+        request += "Range: ";
+        request += range;
+        request += "\r\n";
+        ATX_LOG_FINE_1("HttpInputStream_EmitRequest - range, %s", range.GetChars());
+    }
+
+    // make the request conditional on the cached data being current
+    NPT_String condition_header;
+    NPT_String condition_value;
+    if (HttpInputStream_GetCondition(self, condition_header, condition_value)) {
+        request += condition_header+": "+condition_value+"\r\n";
+        ATX_LOG_FINE_2("HttpInputStream_EmitRequest - %s: %s",
+                       condition_header.GetChars(), condition_value.GetChars());
     }
 
     // add the ICY header that says we can deal with ICY metadata
-    request.GetHeaders().SetHeader("icy-metadata", "1");
+    request += "icy-metadata: 1\r\n";
+    request += "\r\n";
 
-    // send the request
-    result = self->m_HttpClient->SendRequest(request, self->m_Response);
-    if (NPT_FAILED(result)) return result;
+    ++self->m_Connection->m_RequestCount;
+    return self->m_Connection->m_OutputStream->WriteFully(request.GetChars(), request.GetLength());
+}
+
+/*----------------------------------------------------------------------
+|   HttpInputStream_ReceiveResponse
++---------------------------------------------------------------------*/
+static NPT_Result
+HttpInputStream_ReceiveResponse(HttpInputStream* self)
+{
+    delete self->m_Response;
+    self->m_Response      = NULL;
+    self->m_BodyHasLength = false;
+    self->m_BodyRemaining = 0;
+
+    NPT_Result result = NPT_HttpResponse::Parse(*self->m_Connection->m_InputStream, self->m_Response);
+    if (NPT_FAILED(result)) {
+        self->m_Response = NULL;
+        return result;
+    }
+
+    // setup the entity
+    NPT_HttpEntity* entity = new NPT_HttpEntity(self->m_Response->GetHeaders());
+    self->m_Response->SetEntity(entity);
+
+    // see if the connection can be kept alive once the body has been read
+    self->m_BodyHasLength = self->m_Response->GetHeaders().GetHeaderValue("Content-Length") != NULL;
+    self->m_BodyRemaining = entity->GetContentLength();
+    if (self->m_Response->GetStatusCode() == 304) {
+        // never has a body, whatever its Content-Length says
+        self->m_BodyHasLength = true;
+        self->m_BodyRemaining = 0;
+    }
+    const NPT_String* connection = self->m_Response->GetHeaders().GetHeaderValue("Connection");
+    if (self->m_Response->GetProtocol() == "HTTP/1.1") {
+        self->m_KeepAlive = (connection == NULL || connection->Compare("close", true) != 0);
+    } else {
+        self->m_KeepAlive = (connection != NULL && connection->Compare("keep-alive", true) == 0);
+    }
+    if (!self->m_BodyHasLength) self->m_KeepAlive = false;
+
+    return NPT_SUCCESS;
+}
+
+/*----------------------------------------------------------------------
+|   HttpInputStream_ProcessResponse
++---------------------------------------------------------------------*/
+static NPT_Result
+HttpInputStream_ProcessResponse(HttpInputStream* self, bool ranged)
+{
+    NPT_Result result;
 
+    self->m_Ranged = false;
     switch (self->m_Response->GetStatusCode()) {
         case 200:
-            // if this is a Range request, expect a 206 instead
-            if (position) {
+            // if this is a Range request, expect a 206 instead (unless
+            // it was conditional, the resource has then changed)
+            if (ranged && !self->m_Revalidating) {
                 result = BLT_ERROR_PROTOCOL_FAILURE;
             } else {
                 result = BLT_SUCCESS;
             }
             
-            // get the body stream and size
-            self->m_Response->GetEntity()->GetInputStream(*self->m_InputStream);
+            // get the body size
             self->m_ContentLength = self->m_Response->GetEntity()->GetContentLength();
             break;
 
         case 206:
             // if this is not a Range request, expect a 200 instead
-            if (position == 0) result = BLT_ERROR_PROTOCOL_FAILURE;
-            
-            // get the body stream
-            self->m_Response->GetEntity()->GetInputStream(*self->m_InputStream);
-            result = BLT_SUCCESS;
+            if (!ranged) {
+                result = BLT_ERROR_PROTOCOL_FAILURE;
+            } else {
+                result = BLT_SUCCESS;
+                self->m_Ranged = true;
+            }
+
+            // a resumed response picks up where the cached data ends
+            if (NPT_SUCCEEDED(result) && self->m_Revalidating) {
+                result = HttpInputStream_ParseContentRange(self, self->m_Position, self->m_ContentLength);
+                self->m_Revalidated = NPT_SUCCEEDED(result);
+            }
+            break;
+
+        case 304:
+            // the cached data is current
+            if (!self->m_Revalidating) {
+                result = BLT_ERROR_PROTOCOL_FAILURE;
+            } else {
+                result = BLT_SUCCESS;
+                self->m_ContentLength = self->m_CacheInfo->m_Size;
+                self->m_Ranged        = true;
+                self->m_Revalidated   = true;
+            }
             break;
 
         case 401:
@@ -243,12 +525,12 @@ HttpInputStream_SendRequest(HttpInputStream* self, NPT_Position position)
             result = BLT_FAILURE;
     }
 
-    // see if we can seek 
-    self->m_CanSeek = false;
+    // see if we can seek (a partial response is proof enough)
+    self->m_CanSeek = self->m_Ranged;
     const NPT_String* accept_range = self->m_Response->GetHeaders().GetHeaderValue("Accept-Ranges");
     if (accept_range) {
         if (*accept_range == "bytes") {
-            ATX_LOG_FINE("HttpInputStream::SendRequest - stream is seekable");
+            ATX_LOG_FINE("HttpInputStream::ProcessResponse - stream is seekable");
             self->m_CanSeek = true;
         }
     }
@@ -269,10 +551,346 @@ HttpInputStream_SendRequest(HttpInputStream* self, NPT_Position position)
     } else {
         self->m_IcyMetaInterval = 0;
     }
+    if (self->m_IsIcy) {
+        // ICY bodies run until the connection is closed
+        self->m_BodyHasLength = false;
+        self->m_KeepAlive     = false;
+    }
+
+    // only the first response can revalidate the cached data
+    self->m_Revalidating = false;
+
+    return result;
+}
+
+/*----------------------------------------------------------------------
+|   HttpInputStream_CanUsePool
+|
+|   The pooled connections only speak plain HTTP directly to the server.
+|   Anything else (a proxy, another scheme) goes through NPT_HttpClient.
++---------------------------------------------------------------------*/
+static bool
+HttpInputStream_CanUsePool(HttpInputStream* self)
+{
+    if (self->m_Url->GetSchemeId() != NPT_Uri::SCHEME_ID_HTTP) return false;
+
+    // use the same proxy settings as NPT_HttpClient
+    NPT_HttpProxySelector* selector = NPT_HttpProxySelector::GetDefault();
+    if (selector) {
+        NPT_HttpProxyAddress proxy;
+        if (NPT_SUCCEEDED(selector->GetProxyForUrl(*self->m_Url, proxy)) &&
+            !proxy.GetHostName().IsEmpty()) {
+            ATX_LOG_FINE_2("HttpInputStream_CanUsePool - using proxy %s:%d",
+                           proxy.GetHostName().GetChars(),
+                           proxy.GetPort());
+            return false;
+        }
+    }
+
+    return true;
+}
+
+/*----------------------------------------------------------------------
+|   HttpInputStream_ResolveLocation
+|
+|   Many servers send a relative Location header, which is resolved
+|   against the URL of the request, like NPT_HttpClient does.
++---------------------------------------------------------------------*/
+static NPT_Result
+HttpInputStream_ResolveLocation(HttpInputStream*  self,
+                                const NPT_String& location,
+                                NPT_HttpUrl&      url)
+{
+    if (location.StartsWith("http://", true) || location.StartsWith("https://", true)) {
+        url = NPT_HttpUrl(location);
+    } else if (location.StartsWith("//")) {
+        // network-path reference, same scheme
+        url = NPT_HttpUrl(self->m_Url->GetScheme()+":"+location);
+    } else {
+        url = NPT_HttpUrl(self->m_Url->GetHost(), self->m_Url->GetPort(), "/");
+        if (location.StartsWith("/")) {
+            url.ParsePathPlus(location);
+        } else {
+            NPT_String path = self->m_Url->GetPath();
+            int slash = path.ReverseFind('/');
+            if (slash >= 0) {
+                path.SetLength(slash+1);
+            } else {
+                path = "/";
+            }
+            path += location;
+            url.ParsePathPlus(path);
+        }
+    }
+
+    return url.IsValid() ? NPT_SUCCESS : BLT_ERROR_PROTOCOL_FAILURE;
+}
+
+/*----------------------------------------------------------------------
+|   HttpInputStream_SendClientRequest
+|
+|   Sends the request with NPT_HttpClient, which takes care of proxies,
+|   redirects and authentication. The connection is not reused, and the
+|   body is read until its end, without ranges.
++---------------------------------------------------------------------*/
+static NPT_Result
+HttpInputStream_SendClientRequest(HttpInputStream* self, NPT_Position position)
+{
+    NPT_HttpRequest request(*self->m_Url, NPT_HTTP_METHOD_GET);
+
+    HttpInputStream_AbandonResponse(self);
+    delete self->m_Response;
+    self->m_Response = NULL;
+
+    // resume or revalidate cached data
+    if (position == 0) position = HttpInputStream_GetResumePosition(self);
+    NPT_String condition_header;
+    NPT_String condition_value;
+    if (HttpInputStream_GetCondition(self, condition_header, condition_value)) {
+        request.GetHeaders().SetHeader(condition_header, condition_value);
+    }
+
+    if (position) {
+        NPT_String range = "bytes="+NPT_String::FromInteger(position);
+        range += "-";
+        request.GetHeaders().SetHeader(NPT_HTTP_HEADER_RANGE, range);
+        ATX_LOG_FINE_1("HttpInputStream_SendClientRequest - seek, %s", range.GetChars());
+    }
+
+    // add the ICY header that says we can deal with ICY metadata
+    request.GetHeaders().SetHeader("icy-metadata", "1");
+
+    if (self->m_HttpClient == NULL) self->m_HttpClient = new NPT_HttpClient();
+    NPT_Result result = self->m_HttpClient->SendRequest(request, self->m_Response);
+    if (NPT_FAILED(result)) {
+        self->m_Response = NULL;
+        return result;
+    }
+    if (self->m_Response->GetEntity() == NULL) {
+        self->m_Response->SetEntity(new NPT_HttpEntity(self->m_Response->GetHeaders()));
+    }
+
+    // read the body through a connection object like the pooled ones,
+    // but one that is never recycled
+    NPT_InputStreamReference  body;
+    NPT_OutputStreamReference no_output;
+    self->m_Response->GetEntity()->GetInputStream(body);
+    if (body.IsNull()) return NPT_ERROR_INTERNAL;
+    self->m_Connection    = new BLT_HttpConnection(BLT_HttpConnectionPool::MakeKey(*self->m_Url), body, no_output);
+    self->m_KeepAlive     = false;
+    self->m_BodyHasLength = false;
+    self->m_BodyRemaining = 0;
+
+    result = HttpInputStream_ProcessResponse(self, position != 0);
+    if (NPT_FAILED(result)) {
+        HttpInputStream_AbandonResponse(self);
+    } else if (self->m_Response->GetStatusCode() == 304) {
+        // nothing to read, a later read starts a new request
+        HttpInputStream_ReleaseConnection(self, false);
+    } else {
+        self->m_Ranged = false; // the range is open-ended, there is no next one
+    }
 
     return result;
 }
 
+/*----------------------------------------------------------------------
+|   HttpInputStream_SendRequest
++---------------------------------------------------------------------*/
+BLT_METHOD
+HttpInputStream_SendRequest(HttpInputStream* self, NPT_Position position)
+{
+    NPT_Result result = BLT_FAILURE;
+
+    // drop what's left of any previous response
+    HttpInputStream_AbandonResponse(self);
+    delete self->m_Response;
+    self->m_Response = NULL;
+
+    // handle a non-zero start position
+    if (position) {
+        if (self->m_ContentLength == position) {
+            // special case: seek to end of stream
+            self->m_Eos = true;
+            return BLT_SUCCESS;
+        }
+    }
+
+    // leave what the pool can't do to NPT_HttpClient
+    if (!HttpInputStream_CanUsePool(self)) {
+        return HttpInputStream_SendClientRequest(self, position);
+    }
+
+    // when resuming cached data, only ask for what is missing from it
+    if (position == 0) position = HttpInputStream_GetResumePosition(self);
+
+    // once we know that the server supports ranges, request a bounded
+    // range at a time, so that the connection can be reused and the next
+    // range requested ahead of time
+    NPT_Position end = 0;
+    if (self->m_RangeSize && self->m_CanSeek && self->m_ContentLength) {
+        end = position+self->m_RangeSize;
+        if (end > self->m_ContentLength) end = self->m_ContentLength;
+    }
+    bool ranged = (position != 0 || end != 0);
+
+    unsigned int redirects = 0;
+    bool         retried   = false;
+    for (;;) {
+        // get a connection
+        bool reused = false;
+        result = HttpInputStream_AcquireConnection(self, reused);
+        if (NPT_FAILED(result)) return result;
+
+        // send the request and wait for the response
+        result = HttpInputStream_EmitRequest(self, position, end);
+        if (NPT_SUCCEEDED(result)) {
+            result = HttpInputStream_ReceiveResponse(self);
+        }
+        if (NPT_FAILED(result)) {
+            HttpInputStream_ReleaseConnection(self, false);
+            if (reused && !retried) {
+                // the server may have closed the idle connection, try once more
+                ATX_LOG_FINE_1("HttpInputStream_SendRequest - reused connection failed (%d), retrying", result);
+                retried = true;
+                continue;
+            }
+            return result;
+        }
+
+        // follow redirects
+        unsigned int status = self->m_Response->GetStatusCode();
+        if (status == 301 || status == 302 || status == 303 || status == 307) {
+            const NPT_String* location = self->m_Response->GetHeaders().GetHeaderValue("Location");
+            if (location == NULL || ++redirects > BLT_HTTP_NETWORK_STREAM_MAX_REDIRECTS) {
+                return BLT_ERROR_PROTOCOL_FAILURE;
+            }
+            NPT_HttpUrl url;
+            result = HttpInputStream_ResolveLocation(self, *location, url);
+            if (NPT_FAILED(result)) return result;
+            ATX_LOG_FINE_1("HttpInputStream_SendRequest - redirected to %s", url.ToString().GetChars());
+            HttpInputStream_AbandonResponse(self);
+            *self->m_Url = url;
+            if (!HttpInputStream_CanUsePool(self)) {
+                return HttpInputStream_SendClientRequest(self, position);
+            }
+            retried = false;
+            continue;
+        }
+
+        // authentication challenges are NPT_HttpClient's business too
+        if (status == 401 || status == 407) {
+            ATX_LOG_FINE_1("HttpInputStream_SendRequest - status %d, retrying with NPT_HttpClient", status);
+            return HttpInputStream_SendClientRequest(self, position);
+        }
+
+        break;
+    }
+
+    result = HttpInputStream_ProcessResponse(self, ranged);
+    if (NPT_FAILED(result)) {
+        HttpInputStream_AbandonResponse(self);
+    } else if (self->m_Response->GetStatusCode() == 304) {
+        // nothing to read, the data comes from the cache
+        HttpInputStream_ReleaseConnection(self, true);
+    }
+
+    return result;
+}
+
+/*----------------------------------------------------------------------
+|   HttpInputStream_NextRange
++---------------------------------------------------------------------*/
+static NPT_Result
+HttpInputStream_NextRange(HttpInputStream* self)
+{
+    // if the request for the next range has already been sent, its response
+    // follows the current body on the same connection
+    if (self->m_RangePending && self->m_PendingRangeStart == self->m_Position) {
+        self->m_RangePending = false;
+        NPT_Result result = HttpInputStream_ReceiveResponse(self);
+        if (NPT_SUCCEEDED(result)) {
+            result = HttpInputStream_ProcessResponse(self, true);
+            if (NPT_SUCCEEDED(result)) return NPT_SUCCESS;
+        }
+        ATX_LOG_FINE_1("HttpInputStream_NextRange - pipelined response failed (%d)", result);
+        HttpInputStream_ReleaseConnection(self, false);
+    }
+
+    return HttpInputStream_SendRequest(self, self->m_Position);
+}
+
+/*----------------------------------------------------------------------
+|   HttpInputStream_Prefetch
++---------------------------------------------------------------------*/
+static void
+HttpInputStream_Prefetch(HttpInputStream* self)
+{
+    if (!self->m_Pipelining   ||
+        !self->m_Ranged       ||
+        self->m_RangePending  ||
+        self->m_Connection == NULL ||
+        !self->m_KeepAlive    ||
+        self->m_BodyRemaining > BLT_HTTP_NETWORK_STREAM_PREFETCH_THRESHOLD) {
+        return;
+    }
+
+    NPT_Position start = self->m_Position+self->m_BodyRemaining;
+    if (start >= self->m_ContentLength) return;
+    NPT_Position end = start+self->m_RangeSize;
+    if (end > self->m_ContentLength) end = self->m_ContentLength;
+
+    if (NPT_SUCCEEDED(HttpInputStream_EmitRequest(self, start, end))) {
+        self->m_RangePending      = true;
+        self->m_PendingRangeStart = start;
+    }
+}
+
+/*----------------------------------------------------------------------
+|   HttpInputStream_ReadBody
++---------------------------------------------------------------------*/
+static NPT_Result
+HttpInputStream_ReadBody(HttpInputStream* self,
+                         void*            buffer,
+                         NPT_Size         bytes_to_read,
+                         NPT_Size*        bytes_read)
+{
+    *bytes_read = 0;
+
+    // move on to the next range when the current one is exhausted
+    if (self->m_Ranged &&
+        self->m_BodyRemaining == 0 &&
+        self->m_Position < self->m_ContentLength) {
+        NPT_Result result = HttpInputStream_NextRange(self);
+        if (NPT_FAILED(result)) return result;
+    }
+    if (self->m_Connection == NULL) return ATX_ERROR_INVALID_STATE;
+
+    if (self->m_BodyHasLength) {
+        if (self->m_BodyRemaining == 0) return NPT_ERROR_EOS;
+        if (bytes_to_read > self->m_BodyRemaining) {
+            bytes_to_read = (NPT_Size)self->m_BodyRemaining;
+        }
+    }
+
+    NPT_Result result = self->m_Connection->m_InputStream->Read(buffer, bytes_to_read, bytes_read);
+    if (NPT_FAILED(result)) return result;
+    self->m_Position += *bytes_read;
+    if (self->m_BodyHasLength) {
+        self->m_BodyRemaining -= *bytes_read;
+        HttpInputStream_Prefetch(self);
+
+        // give back the connection when we have no more use for it
+        if (self->m_BodyRemaining == 0 &&
+            !self->m_RangePending &&
+            (!self->m_Ranged || self->m_Position >= self->m_ContentLength)) {
+            HttpInputStream_ReleaseConnection(self, true);
+        }
+    }
+
+    return NPT_SUCCESS;
+}
+
 /*----------------------------------------------------------------------
 |   HttpInputStream_Attach
 +---------------------------------------------------------------------*/
@@ -289,7 +907,7 @@ HttpInputStream_Attach(BLT_NetworkInputSource* _self,
     // read and write stream properties
     ATX_Properties* properties = NULL;
     BLT_Stream_GetProperties(stream, &properties);
-    if (properties) {
+    if (properties && self->m_Response) {
         // read the http headers
         for (NPT_List<NPT_HttpHeader*>::Iterator i = self->m_Response->GetHeaders().GetHeaders().GetFirstItem();
              i;
@@ -354,7 +972,6 @@ HttpInputStream_Read(ATX_InputStream* _self,
         self->m_Eos = true;
         return ATX_ERROR_EOS;
     }
-    if (self->m_InputStream->IsNull()) return ATX_ERROR_INVALID_STATE;
 
     // see if we need to truncate the read because of ICY metadata
     if (self->m_IsIcy && self->m_IcyMetaInterval) {
@@ -364,22 +981,22 @@ HttpInputStream_Read(ATX_InputStream* _self,
 
     // read and count
     NPT_Size local_bytes_read;
-    NPT_Result result = (*(self->m_InputStream))->Read(buffer, bytes_to_read, &local_bytes_read);
+    NPT_Result result = HttpInputStream_ReadBody(self, buffer, bytes_to_read, &local_bytes_read);
     if (NPT_SUCCEEDED(result)) {
         if (bytes_read) *bytes_read = local_bytes_read;
         self->m_IcyMetaCounter += local_bytes_read;
-        self->m_Position += local_bytes_read;
     }
 
     // see if we should read ICY metadata now 
-    if (self->m_IsIcy && self->m_IcyMetaInterval && 
+    if (self->m_IsIcy && self->m_IcyMetaInterval && self->m_Connection &&
         self->m_IcyMetaCounter == self->m_IcyMetaInterval) {
+        NPT_InputStream* input = self->m_Connection->m_InputStream.AsPointer();
         unsigned char meta_size = 0;
-        result = (*(self->m_InputStream))->Read(&meta_size, 1);
+        result = input->Read(&meta_size, 1);
         if (NPT_SUCCEEDED(result) && meta_size != 0) {
             char* meta_value = new char[meta_size*16+1];
             meta_value[meta_size*16] = '\0'; // terminate
-            result = (*self->m_InputStream)->ReadFully(meta_value, meta_size*16);
+            result = input->ReadFully(meta_value, meta_size*16);
             if (NPT_SUCCEEDED(result)) {
                 // extract the title
                 NPT_String title(meta_value);
@@ -430,7 +1047,7 @@ HttpInputStream_Seek(ATX_InputStream* _self,
     if ((!self->m_CanSeek) || (self->m_ContentLength == 0)) {
         return BLT_ERROR_NOT_SUPPORTED;
     }
-    
+
     // seek by emitting a new request with a range
     NPT_Result result = HttpInputStream_SendRequest(self, where);
     if (NPT_SUCCEEDED(result)) {
@@ -453,7 +1070,6 @@ HttpInputStream_Tell(ATX_InputStream* _self,
             *position = self->m_Response->GetEntity()->GetContentLength();
         }
     }
-    //if (self->m_InputStream->IsNull()) return ATX_ERROR_INVALID_STATE;
     *position = self->m_Position;
     return ATX_SUCCESS;
 }
@@ -479,9 +1095,15 @@ HttpInputStream_GetAvailable(ATX_InputStream* _self,
 {
     HttpInputStream* self = ATX_SELF(HttpInputStream, ATX_InputStream);
     *available = 0;
-    if (self->m_InputStream->IsNull()) return ATX_ERROR_INVALID_STATE;
+    if (self->m_Connection == NULL) {
+        // between two ranges, or at the end
+        return self->m_Response ? ATX_SUCCESS : ATX_ERROR_INVALID_STATE;
+    }
     NPT_LargeSize _available;
-    ATX_Result result = HttpInputStream_MapResult((*(self->m_InputStream))->GetAvailable(_available));
+    ATX_Result result = HttpInputStream_MapResult(self->m_Connection->m_InputStream->GetAvailable(_available));
+    if (self->m_BodyHasLength && self->m_BodyRemaining && _available > self->m_BodyRemaining) {
+        _available = self->m_BodyRemaining;
+    }
     if (available) *available = _available;
     return result;
 }
@@ -529,23 +1151,36 @@ ATX_IMPLEMENT_REFERENCEABLE_INTERFACE(HttpInputStream, m_ReferenceCount)
 |   HttpInputStream_Create
 +---------------------------------------------------------------------*/
 static HttpInputStream*
-HttpInputStream_Create(const char* url)
+HttpInputStream_Create(const char* url, BLT_HttpConnectionPool* connection_pool)
 {
     // create and initialize
-    HttpInputStream* stream   = new HttpInputStream;
-    stream->m_ReferenceCount  = 1;
-    stream->m_HttpClient      = new NPT_HttpClient;
-    stream->m_Url             = new NPT_HttpUrl(url);
-    stream->m_Response        = NULL;
-    stream->m_InputStream     = new NPT_InputStreamReference;
-    stream->m_ContentLength   = 0;
-    stream->m_Position        = 0;
-    stream->m_Eos             = false;
-    stream->m_IsIcy           = false;
-    stream->m_CanSeek         = false;
-    stream->m_IcyMetaInterval = 0;
-    stream->m_IcyMetaCounter  = 0;
-    stream->m_Context         = NULL;
+    HttpInputStream* stream     = new HttpInputStream;
+    stream->m_ReferenceCount    = 1;
+    stream->m_ConnectionPool    = connection_pool;
+    stream->m_Connection        = NULL;
+    stream->m_HttpClient        = NULL;
+    stream->m_KeepAlive         = false;
+    stream->m_Url               = new NPT_HttpUrl(url);
+    stream->m_Response          = NULL;
+    stream->m_ContentLength     = 0;
+    stream->m_Position          = 0;
+    stream->m_Eos               = false;
+    stream->m_IsIcy             = false;
+    stream->m_CanSeek           = false;
+    stream->m_IcyMetaInterval   = 0;
+    stream->m_IcyMetaCounter    = 0;
+    stream->m_Context           = NULL;
+    stream->m_RangeSize         = BLT_HTTP_NETWORK_STREAM_DEFAULT_RANGE_SIZE;
+    stream->m_Pipelining        = true;
+    stream->m_BodyHasLength     = false;
+    stream->m_BodyRemaining     = 0;
+    stream->m_Ranged            = false;
+    stream->m_RangePending      = false;
+    stream->m_PendingRangeStart = 0;
+    stream->m_CacheInfo         = NULL;
+    stream->m_Revalidating      = false;
+    stream->m_Revalidated       = false;
+    BLT_HttpConnectionPool_AddReference(connection_pool);
                                     
     // setup interfaces
     ATX_SET_INTERFACE(stream, HttpInputStream, ATX_InputStream);
@@ -556,6 +1191,31 @@ HttpInputStream_Create(const char* url)
     return stream;
 }
 
+/*----------------------------------------------------------------------
+|   HttpInputStream_GetValidator
++---------------------------------------------------------------------*/
+static NPT_String
+HttpInputStream_GetValidator(HttpInputStream* self)
+{
+    NPT_String validator;
+    if (self->m_Response == NULL) return validator;
+
+    // the server has confirmed that the cached data is current
+    if (self->m_Revalidated) return self->m_CacheInfo->m_Validator;
+    
+    // weak entity tags cannot be used to combine byte ranges, so fall
+    // back to the modification date in that case
+    const NPT_String* etag = self->m_Response->GetHeaders().GetHeaderValue("ETag");
+    if (etag && !etag->StartsWith("W/")) {
+        validator = "etag:" + *etag;
+    } else {
+        const NPT_String* last_modified = self->m_Response->GetHeaders().GetHeaderValue("Last-Modified");
+        if (last_modified) validator = "date:" + *last_modified;
+    }
+    
+    return validator;
+}
+
 /*----------------------------------------------------------------------
 |   BLT_HttpNetworkStream_Create
 +---------------------------------------------------------------------*/
@@ -568,6 +1228,10 @@ BLT_HttpNetworkStream_Create(const char*       url,
     BLT_Result result = BLT_FAILURE;
     ATX_Int32  min_buffer_fullness = 0;
     ATX_Int32  buffer_size = BLT_HTTP_NETWORK_STREAM_DEFAULT_BUFFER_SIZE;
+    ATX_Int32  range_size = BLT_HTTP_NETWORK_STREAM_DEFAULT_RANGE_SIZE;
+    ATX_Int32  min_buffer_size = 0;
+    ATX_Int32  max_buffer_size = 0;
+    bool       pipelining = true;
     
     // default return value
     *stream = NULL;
@@ -590,25 +1254,90 @@ BLT_HttpNetworkStream_Create(const char*       url,
                     min_buffer_fullness = value.data.integer;
                 }
             }
+            if (ATX_SUCCEEDED(ATX_Properties_GetProperty(properties, BLT_HTTP_NETWORK_STREAM_RANGE_SIZE_PROPERTY, &value))) {
+                if (value.type == ATX_PROPERTY_VALUE_TYPE_INTEGER && value.data.integer >= 0) {
+                    range_size = value.data.integer;
+                    ATX_LOG_INFO_1("setting network stream range size to %d", range_size);
+                }
+            }
+            if (ATX_SUCCEEDED(ATX_Properties_GetProperty(properties, BLT_HTTP_NETWORK_STREAM_MIN_BUFFER_SIZE_PROPERTY, &value))) {
+                if (value.type == ATX_PROPERTY_VALUE_TYPE_INTEGER && value.data.integer > 0) {
+                    min_buffer_size = value.data.integer;
+                }
+            }
+            if (ATX_SUCCEEDED(ATX_Properties_GetProperty(properties, BLT_HTTP_NETWORK_STREAM_MAX_BUFFER_SIZE_PROPERTY, &value))) {
+                if (value.type == ATX_PROPERTY_VALUE_TYPE_INTEGER && value.data.integer > 0) {
+                    max_buffer_size = value.data.integer;
+                }
+            }
+            if (ATX_SUCCEEDED(ATX_Properties_GetProperty(properties, BLT_HTTP_NETWORK_STREAM_PIPELINING_PROPERTY, &value))) {
+                if (value.type == ATX_PROPERTY_VALUE_TYPE_BOOLEAN) {
+                    pipelining = value.data.boolean == ATX_TRUE;
+                } else if (value.type == ATX_PROPERTY_VALUE_TYPE_INTEGER) {
+                    pipelining = value.data.integer != 0;
+                }
+            }
         }
     }
     
     // create a stream object
-    HttpInputStream* http_stream = HttpInputStream_Create(url);
+    BLT_HttpConnectionPool* connection_pool = NULL;
+    BLT_HttpConnectionPool_GetFromCore(core, &connection_pool);
+    HttpInputStream* http_stream = HttpInputStream_Create(url, connection_pool);
+    BLT_HttpConnectionPool_Release(connection_pool);
+    http_stream->m_RangeSize  = range_size;
+    http_stream->m_Pipelining = pipelining;
     if (!http_stream->m_Url->IsValid()) {
         HttpInputStream_Destroy(http_stream);
         return BLT_ERROR_INVALID_PARAMETERS;
     }
 
+    // see if the cache has data we can revalidate instead of fetching it
+    http_stream->m_CacheInfo = new BLT_NetworkCacheInfo;
+    if (NPT_SUCCEEDED(BLT_NetworkCache_Lookup(core, url, *http_stream->m_CacheInfo)) &&
+        (http_stream->m_CacheInfo->m_Validator.StartsWith("etag:") ||
+         http_stream->m_CacheInfo->m_Validator.StartsWith("date:"))) {
+        http_stream->m_Revalidating = true;
+    } else {
+        delete http_stream->m_CacheInfo;
+        http_stream->m_CacheInfo = NULL;
+    }
+
     // send the request
     result = HttpInputStream_SendRequest(http_stream, 0);
-    if (NPT_FAILED(result)) return result;
+    if (NPT_FAILED(result)) {
+        HttpInputStream_Destroy(http_stream);
+        return result;
+    }
 
     // see if we can determine the media type
     HttpInputStream_GetMediaType(http_stream, core, media_type);
 
+    // insert the cache, if enabled
+    ATX_InputStream* http_input_stream = &ATX_BASE(http_stream, ATX_InputStream);
+    ATX_InputStream* input_stream = NULL;
+    NPT_String       validator = HttpInputStream_GetValidator(http_stream);
+    NPT_String       content_type = HttpInputStream_GetContentType(http_stream);
+    result = BLT_NetworkCache_CreateStream(core, 
+                                           url, 
+                                           validator.IsEmpty() ? NULL : validator.GetChars(), 
+                                           content_type.IsEmpty() ? NULL : content_type.GetChars(),
+                                           http_input_stream,
+                                           &input_stream);
+    if (BLT_SUCCEEDED(result) && input_stream == http_input_stream && http_stream->m_Position) {
+        // the response was resumed for a cache entry that is now in use
+        // by another stream, so start over from the beginning
+        result = ATX_InputStream_Seek(http_input_stream, 0);
+        if (BLT_FAILED(result)) ATX_RELEASE_OBJECT(input_stream);
+    }
+    ATX_RELEASE_OBJECT(http_input_stream);
+    if (BLT_FAILED(result)) {
+        BLT_MediaType_Free(*media_type);
+        *media_type = NULL;
+        return result;
+    }
+
     // create the network stream
-    ATX_InputStream* input_stream = &ATX_BASE(http_stream, ATX_InputStream);
     BLT_NetworkStream* network_stream = NULL;
     result = BLT_NetworkStream_Create(buffer_size, 
                                       min_buffer_fullness,
@@ -616,13 +1345,21 @@ BLT_HttpNetworkStream_Create(const char*       url,
                                       &network_stream);
     ATX_RELEASE_OBJECT(input_stream);
     if (BLT_FAILED(result)) {
-        HttpInputStream_Destroy(http_stream);
+        BLT_MediaType_Free(*media_type);
+        *media_type = NULL;
         *stream = NULL;
         return result;
     }
+    
+    // enable adaptive buffer sizing if bounds were configured
+    if (min_buffer_size || max_buffer_size) {
+        if (min_buffer_size == 0 || min_buffer_size > buffer_size) min_buffer_size = buffer_size;
+        if (max_buffer_size < buffer_size) max_buffer_size = buffer_size;
+        ATX_LOG_INFO_2("adaptive buffer size between %d and %d", min_buffer_size, max_buffer_size);
+        BLT_NetworkStream_SetBufferBounds(network_stream, min_buffer_size, max_buffer_size);
+    }
     *stream = BLT_NetworkStream_GetInputStream(network_stream);
     BLT_NetworkStream_Release(network_stream);
     
     return BLT_SUCCESS;
 }
-
@@ -23,6 +23,10 @@
 +---------------------------------------------------------------------*/
 #define BLT_HTTP_NETWORK_STREAM_BUFFER_SIZE_PROPERTY      "NetworkStream.BufferSize"
 #define BLT_HTTP_NETWORK_STREAM_MINIMUM_FULLNESS_PROPERTY "NetworkStream.MinimumFullness"
+#define BLT_HTTP_NETWORK_STREAM_RANGE_SIZE_PROPERTY       "NetworkStream.RangeSize"
+#define BLT_HTTP_NETWORK_STREAM_PIPELINING_PROPERTY       "NetworkStream.Pipelining"
+#define BLT_HTTP_NETWORK_STREAM_MIN_BUFFER_SIZE_PROPERTY  "NetworkStream.MinBufferSize"
+#define BLT_HTTP_NETWORK_STREAM_MAX_BUFFER_SIZE_PROPERTY  "NetworkStream.MaxBufferSize"
 
 /*----------------------------------------------------------------------
 |   functions
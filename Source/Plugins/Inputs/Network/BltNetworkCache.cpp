@@ -0,0 +1,1039 @@
+/*****************************************************************
+|
+|   BlueTune - Network Cache
+|
+|   (c) 2002-2012 Gilles Boccon-Gibod
+|   Author: Gilles Boccon-Gibod (bok@bok.net)
+|
+****************************************************************/
+
+/*----------------------------------------------------------------------
+|   includes
++---------------------------------------------------------------------*/
+#include "Neptune.h"
+#include "Atomix.h"
+#include "BltTypes.h"
+#include "BltErrors.h"
+#include "BltCore.h"
+#include "BltNetworkCache.h"
+#include "BltNetworkInputSource.h"
+
+/*----------------------------------------------------------------------
+|   logging
++---------------------------------------------------------------------*/
+ATX_SET_LOCAL_LOGGER("bluetune.plugins.inputs.network.cache")
+
+/*----------------------------------------------------------------------
+|   constants
++---------------------------------------------------------------------*/
+#define BLT_NETWORK_CACHE_INDEX_SIGNATURE "BLT-NETWORK-CACHE 1"
+#define BLT_NETWORK_CACHE_INDEX_EXTENSION ".index"
+#define BLT_NETWORK_CACHE_DATA_EXTENSION  ".data"
+
+/*----------------------------------------------------------------------
+|   types
++---------------------------------------------------------------------*/
+/**
+ * Range of bytes present in the data file of a cache entry.
+ */
+struct BLT_NetworkCacheExtent {
+    NPT_Position m_Start;
+    NPT_Position m_End; // exclusive
+};
+
+/**
+ * Summary of an index file, as used when trimming the cache.
+ */
+struct BLT_NetworkCacheIndex {
+    NPT_String                       m_Url;
+    NPT_String                       m_Validator;
+    NPT_String                       m_ContentType;
+    NPT_LargeSize                    m_Size;
+    NPT_Int64                        m_LastAccess;
+    NPT_List<BLT_NetworkCacheExtent> m_Extents;
+};
+
+/**
+ * Size and age of a cache entry, as used when trimming the cache.
+ */
+struct BLT_NetworkCacheFile {
+    NPT_String    m_Key;
+    NPT_Int64     m_LastAccess;
+    NPT_LargeSize m_Size;
+};
+
+/**
+ * In-memory index of a cache directory: the entries it contains, least
+ * recently used first, and their total size. The directory is scanned
+ * the first time it is used by the process; after that, entries report
+ * their size changes here, so trimming never goes back to the disk.
+ */
+class BLT_NetworkCacheDirectory {
+public:
+    // class methods
+    static BLT_NetworkCacheDirectory* Get(const char* path);
+
+    // methods
+    void Update(const char* key, NPT_LargeSize size);
+    void Trim(NPT_LargeSize max_size);
+
+    // members
+    NPT_String                     m_Path;
+    NPT_List<BLT_NetworkCacheFile> m_Files;
+    NPT_LargeSize                  m_TotalSize;
+
+private:
+    // methods
+    void Load();
+};
+
+/**
+ * A cache entry is made of two files named after a hash of the URL: a
+ * sparse data file in which byte ranges are stored at their offset in
+ * the resource, and a text index listing the ranges that are present.
+ */
+class BLT_NetworkCacheEntry {
+public:
+    // class methods
+    static NPT_String MakeKey(const char* url);
+    static bool       ParseIndex(const NPT_String& text, BLT_NetworkCacheIndex& index);
+    static bool       IsLocked(const char* key);
+    static bool       Lock(const char* key);
+    static void       Unlock(const char* key);
+
+    // methods
+    BLT_NetworkCacheEntry(const char*   directory,
+                          const char*   key,
+                          const char*   url,
+                          const char*   validator,
+                          const char*   content_type,
+                          NPT_LargeSize size,
+                          NPT_LargeSize max_size);
+    ~BLT_NetworkCacheEntry();
+    NPT_Result Open();
+    NPT_Size   GetCachedLength(NPT_Position position, NPT_Size max);
+    NPT_Size   GetMissingLength(NPT_Position position, NPT_Size max);
+    NPT_Result ReadData(NPT_Position position, void* buffer, NPT_Size bytes_to_read, NPT_Size& bytes_read);
+    void       WriteData(NPT_Position position, const void* buffer, NPT_Size size);
+
+private:
+    // methods
+    bool LoadIndex();
+    void SaveIndex();
+    void AddExtent(NPT_Position start, NPT_Position end);
+    void UpdateDirectory();
+
+    // members
+    NPT_String                       m_Directory;
+    NPT_String                       m_Key;
+    NPT_String                       m_Url;
+    NPT_String                       m_Validator;
+    NPT_String                       m_ContentType;
+    NPT_LargeSize                    m_Size;
+    NPT_LargeSize                    m_MaxSize;
+    NPT_String                       m_IndexPath;
+    NPT_String                       m_DataPath;
+    NPT_File*                        m_DataFile;
+    NPT_InputStreamReference         m_DataInput;
+    NPT_OutputStreamReference        m_DataOutput;
+    NPT_List<BLT_NetworkCacheExtent> m_Extents;
+    bool                             m_Open;
+    bool                             m_Writable;
+    bool                             m_Dirty;
+};
+
+/*----------------------------------------------------------------------
+|   CachedInputStream
++---------------------------------------------------------------------*/
+// it is important to keep this structure a POD (no methods or object members)
+// because the strict compilers will not like use using
+// the offsetof() macro necessary when using ATX_SELF()
+typedef struct {
+    // interfaces
+    ATX_IMPLEMENTS(ATX_InputStream);
+    ATX_IMPLEMENTS(BLT_NetworkInputSource);
+    ATX_IMPLEMENTS(ATX_Properties);
+    ATX_IMPLEMENTS(ATX_Referenceable);
+
+    // members
+    ATX_Cardinal           m_ReferenceCount;
+    ATX_InputStream*       m_Source;
+    BLT_NetworkCacheEntry* m_Entry;
+    NPT_LargeSize          m_Size;
+    NPT_Position           m_Position;
+    NPT_Position           m_SourcePosition;
+} CachedInputStream;
+
+/*----------------------------------------------------------------------
+|   globals
++---------------------------------------------------------------------*/
+// keys of the entries that are currently open in this process, and the
+// index of each directory in use (both protected by the lock)
+static NPT_Mutex                           BLT_NetworkCache_Lock;
+static NPT_List<NPT_String>                BLT_NetworkCache_ActiveKeys;
+static NPT_List<BLT_NetworkCacheDirectory> BLT_NetworkCache_Directories;
+
+/*----------------------------------------------------------------------
+|   BLT_NetworkCacheEntry::MakeKey
++---------------------------------------------------------------------*/
+NPT_String
+BLT_NetworkCacheEntry::MakeKey(const char* url)
+{
+    NPT_Digest*    md5 = NULL;
+    NPT_DataBuffer digest;
+
+    NPT_Digest::Create(NPT_Digest::ALGORITHM_MD5, md5);
+    md5->Update((const NPT_UInt8*)url, NPT_StringLength(url));
+    md5->GetDigest(digest);
+    delete md5;
+
+    return NPT_HexString(digest.GetData(), digest.GetDataSize(), NULL, false);
+}
+
+/*----------------------------------------------------------------------
+|   BLT_NetworkCacheEntry::IsLocked
++---------------------------------------------------------------------*/
+bool
+BLT_NetworkCacheEntry::IsLocked(const char* key)
+{
+    // the caller must hold BLT_NetworkCache_Lock
+    for (NPT_List<NPT_String>::Iterator i = BLT_NetworkCache_ActiveKeys.GetFirstItem(); i; ++i) {
+        if (*i == key) return true;
+    }
+
+    return false;
+}
+
+/*----------------------------------------------------------------------
+|   BLT_NetworkCacheEntry::Lock
++---------------------------------------------------------------------*/
+bool
+BLT_NetworkCacheEntry::Lock(const char* key)
+{
+    NPT_AutoLock lock(BLT_NetworkCache_Lock);
+
+    if (IsLocked(key)) return false;
+    BLT_NetworkCache_ActiveKeys.Add(key);
+
+    return true;
+}
+
+/*----------------------------------------------------------------------
+|   BLT_NetworkCacheEntry::Unlock
++---------------------------------------------------------------------*/
+void
+BLT_NetworkCacheEntry::Unlock(const char* key)
+{
+    NPT_AutoLock lock(BLT_NetworkCache_Lock);
+    BLT_NetworkCache_ActiveKeys.Remove(NPT_String(key));
+}
+
+/*----------------------------------------------------------------------
+|   BLT_NetworkCacheEntry::ParseIndex
++---------------------------------------------------------------------*/
+bool
+BLT_NetworkCacheEntry::ParseIndex(const NPT_String& text, BLT_NetworkCacheIndex& index)
+{
+    NPT_List<NPT_String> lines = text.Split("\n");
+
+    index.m_Size       = 0;
+    index.m_LastAccess = 0;
+    index.m_Extents.Clear();
+
+    NPT_List<NPT_String>::Iterator line = lines.GetFirstItem();
+    if (!line || *line != BLT_NETWORK_CACHE_INDEX_SIGNATURE) return false;
+    for (++line; line; ++line) {
+        int separator = line->Find(' ');
+        if (separator <= 0) continue;
+        NPT_String name  = line->Left(separator);
+        NPT_String value = line->SubString(separator+1);
+        NPT_Int64  number = 0;
+        if (name == "url") {
+            index.m_Url = value;
+        } else if (name == "validator") {
+            index.m_Validator = value;
+        } else if (name == "type") {
+            index.m_ContentType = value;
+        } else if (name == "size") {
+            if (NPT_FAILED(value.ToInteger64(number)) || number < 0) return false;
+            index.m_Size = number;
+        } else if (name == "accessed") {
+            if (NPT_FAILED(value.ToInteger64(number))) return false;
+            index.m_LastAccess = number;
+        } else if (name == "extent") {
+            int space = value.Find(' ');
+            if (space <= 0) return false;
+            BLT_NetworkCacheExtent extent;
+            if (NPT_FAILED(value.Left(space).ToInteger64(number)) || number < 0) return false;
+            extent.m_Start = number;
+            if (NPT_FAILED(value.SubString(space+1).ToInteger64(number)) || number < 0) return false;
+            extent.m_End = number;
+            if (extent.m_End <= extent.m_Start) return false;
+            index.m_Extents.Add(extent);
+        }
+    }
+
+    return true;
+}
+
+/*----------------------------------------------------------------------
+|   BLT_NetworkCacheDirectory::Get
++---------------------------------------------------------------------*/
+BLT_NetworkCacheDirectory*
+BLT_NetworkCacheDirectory::Get(const char* path)
+{
+    // the caller must hold BLT_NetworkCache_Lock
+    for (NPT_List<BLT_NetworkCacheDirectory>::Iterator i = BLT_NetworkCache_Directories.GetFirstItem(); i; ++i) {
+        if (i->m_Path == path) return &*i;
+    }
+
+    BLT_NetworkCacheDirectory directory;
+    directory.m_Path      = path;
+    directory.m_TotalSize = 0;
+    BLT_NetworkCache_Directories.Add(directory);
+    BLT_NetworkCacheDirectory* added = &*BLT_NetworkCache_Directories.GetLastItem();
+    added->Load();
+
+    return added;
+}
+
+/*----------------------------------------------------------------------
+|   BLT_NetworkCacheDirectory::Load
++---------------------------------------------------------------------*/
+void
+BLT_NetworkCacheDirectory::Load()
+{
+    NPT_List<NPT_String> entries;
+
+    if (NPT_FAILED(NPT_File::ListDir(m_Path, entries))) return;
+
+    for (NPT_List<NPT_String>::Iterator i = entries.GetFirstItem(); i; ++i) {
+        NPT_String path = m_Path;
+        path += NPT_FilePath::Separator;
+        path += *i;
+
+        if (i->EndsWith(BLT_NETWORK_CACHE_DATA_EXTENSION)) {
+            // remove data files left without an index, unless in use
+            NPT_String key = i->Left(i->GetLength()-NPT_StringLength(BLT_NETWORK_CACHE_DATA_EXTENSION));
+            NPT_String index_path = m_Path;
+            index_path += NPT_FilePath::Separator;
+            index_path += key + BLT_NETWORK_CACHE_INDEX_EXTENSION;
+            NPT_LargeSize index_size = 0;
+            if (NPT_FAILED(NPT_File::GetSize(index_path, index_size)) &&
+                !BLT_NetworkCacheEntry::IsLocked(key)) {
+                ATX_LOG_FINE_1("removing orphan data file %s", i->GetChars());
+                NPT_File::RemoveFile(path);
+            }
+            continue;
+        }
+        if (!i->EndsWith(BLT_NETWORK_CACHE_INDEX_EXTENSION)) continue;
+
+        NPT_String            text;
+        BLT_NetworkCacheIndex index;
+        if (NPT_FAILED(NPT_File::Load(path, text))) continue;
+        if (!BLT_NetworkCacheEntry::ParseIndex(text, index)) continue;
+
+        BLT_NetworkCacheFile file;
+        file.m_Key        = i->Left(i->GetLength()-NPT_StringLength(BLT_NETWORK_CACHE_INDEX_EXTENSION));
+        file.m_LastAccess = index.m_LastAccess;
+        file.m_Size       = 0;
+        for (NPT_List<BLT_NetworkCacheExtent>::Iterator e = index.m_Extents.GetFirstItem(); e; ++e) {
+            file.m_Size += e->m_End-e->m_Start;
+        }
+        m_TotalSize += file.m_Size;
+
+        // keep the list sorted by access time, oldest first
+        NPT_List<BLT_NetworkCacheFile>::Iterator newer = m_Files.GetFirstItem();
+        while (newer && newer->m_LastAccess <= file.m_LastAccess) ++newer;
+        if (newer) {
+            m_Files.Insert(newer, file);
+        } else {
+            m_Files.Add(file);
+        }
+    }
+    ATX_LOG_FINE_3("cache directory %s: %d entries, %lld bytes",
+                   m_Path.GetChars(), m_Files.GetItemCount(), m_TotalSize);
+}
+
+/*----------------------------------------------------------------------
+|   BLT_NetworkCacheDirectory::Update
++---------------------------------------------------------------------*/
+void
+BLT_NetworkCacheDirectory::Update(const char* key, NPT_LargeSize size)
+{
+    // the caller must hold BLT_NetworkCache_Lock
+    BLT_NetworkCacheFile file;
+    file.m_Key  = key;
+    file.m_Size = size;
+    for (NPT_List<BLT_NetworkCacheFile>::Iterator i = m_Files.GetFirstItem(); i; ++i) {
+        if (i->m_Key == key) {
+            m_TotalSize -= i->m_Size;
+            m_Files.Erase(i);
+            break;
+        }
+    }
+
+    // this is now the most recently used entry
+    NPT_TimeStamp now;
+    NPT_System::GetCurrentTimeStamp(now);
+    file.m_LastAccess = now.ToMillis();
+    m_Files.Add(file);
+    m_TotalSize += size;
+}
+
+/*----------------------------------------------------------------------
+|   BLT_NetworkCacheDirectory::Trim
++---------------------------------------------------------------------*/
+void
+BLT_NetworkCacheDirectory::Trim(NPT_LargeSize max_size)
+{
+    // the caller must hold BLT_NetworkCache_Lock
+    // remove the least recently used entries until we're under the limit
+    NPT_List<BLT_NetworkCacheFile>::Iterator i = m_Files.GetFirstItem();
+    while (i && m_TotalSize > max_size) {
+        NPT_List<BLT_NetworkCacheFile>::Iterator next = i;
+        ++next;
+        if (!BLT_NetworkCacheEntry::IsLocked(i->m_Key)) {
+            ATX_LOG_FINE_2("evicting cache entry %s (%lld bytes)",
+                           i->m_Key.GetChars(), i->m_Size);
+            NPT_String base = m_Path;
+            base += NPT_FilePath::Separator;
+            base += i->m_Key;
+            NPT_File::RemoveFile(base + BLT_NETWORK_CACHE_INDEX_EXTENSION);
+            NPT_File::RemoveFile(base + BLT_NETWORK_CACHE_DATA_EXTENSION);
+            m_TotalSize -= i->m_Size;
+            m_Files.Erase(i);
+        }
+        i = next;
+    }
+}
+
+/*----------------------------------------------------------------------
+|   BLT_NetworkCacheEntry::BLT_NetworkCacheEntry
++---------------------------------------------------------------------*/
+BLT_NetworkCacheEntry::BLT_NetworkCacheEntry(const char*   directory,
+                                             const char*   key,
+                                             const char*   url,
+                                             const char*   validator,
+                                             const char*   content_type,
+                                             NPT_LargeSize size,
+                                             NPT_LargeSize max_size) :
+    m_Directory(directory),
+    m_Key(key),
+    m_Url(url),
+    m_Validator(validator),
+    m_ContentType(content_type),
+    m_Size(size),
+    m_MaxSize(max_size),
+    m_DataFile(NULL),
+    m_Open(false),
+    m_Writable(false),
+    m_Dirty(false)
+{
+    NPT_String base = m_Directory;
+    base += NPT_FilePath::Separator;
+    base += m_Key;
+    m_IndexPath = base + BLT_NETWORK_CACHE_INDEX_EXTENSION;
+    m_DataPath  = base + BLT_NETWORK_CACHE_DATA_EXTENSION;
+}
+
+/*----------------------------------------------------------------------
+|   BLT_NetworkCacheEntry::~BLT_NetworkCacheEntry
++---------------------------------------------------------------------*/
+BLT_NetworkCacheEntry::~BLT_NetworkCacheEntry()
+{
+    // close the data file before writing the index, so that the index
+    // never refers to data that has not been flushed
+    m_DataInput  = NULL;
+    m_DataOutput = NULL;
+    delete m_DataFile;
+
+    if (m_Dirty) SaveIndex();
+    if (m_Open) UpdateDirectory();
+    Unlock(m_Key);
+}
+
+/*----------------------------------------------------------------------
+|   BLT_NetworkCacheEntry::UpdateDirectory
++---------------------------------------------------------------------*/
+void
+BLT_NetworkCacheEntry::UpdateDirectory()
+{
+    NPT_LargeSize size = 0;
+    for (NPT_List<BLT_NetworkCacheExtent>::Iterator i = m_Extents.GetFirstItem(); i; ++i) {
+        size += i->m_End-i->m_Start;
+    }
+
+    // record the new size of this entry, and make room for it
+    NPT_AutoLock lock(BLT_NetworkCache_Lock);
+    BLT_NetworkCacheDirectory* directory = BLT_NetworkCacheDirectory::Get(m_Directory);
+    directory->Update(m_Key, size);
+    directory->Trim(m_MaxSize);
+}
+
+/*----------------------------------------------------------------------
+|   BLT_NetworkCacheEntry::LoadIndex
++---------------------------------------------------------------------*/
+bool
+BLT_NetworkCacheEntry::LoadIndex()
+{
+    NPT_String            text;
+    BLT_NetworkCacheIndex index;
+
+    if (NPT_FAILED(NPT_File::Load(m_IndexPath, text))) return false;
+    if (!ParseIndex(text, index)) {
+        ATX_LOG_WARNING_1("invalid cache index %s", m_IndexPath.GetChars());
+        return false;
+    }
+    if (index.m_Url != m_Url || index.m_Size != m_Size) return false;
+    if (index.m_Validator != m_Validator) {
+        ATX_LOG_FINE_2("cache entry is stale (%s != %s)",
+                       index.m_Validator.GetChars(), m_Validator.GetChars());
+        return false;
+    }
+    m_Extents = index.m_Extents;
+
+    return true;
+}
+
+/*----------------------------------------------------------------------
+|   BLT_NetworkCacheEntry::SaveIndex
++---------------------------------------------------------------------*/
+void
+BLT_NetworkCacheEntry::SaveIndex()
+{
+    NPT_TimeStamp now;
+    NPT_System::GetCurrentTimeStamp(now);
+
+    NPT_String text = BLT_NETWORK_CACHE_INDEX_SIGNATURE "\n";
+    text += "url "       + m_Url + "\n";
+    text += "validator " + m_Validator + "\n";
+    if (!m_ContentType.IsEmpty()) {
+        text += "type "  + m_ContentType + "\n";
+    }
+    text += "size "      + NPT_String::FromIntegerU(m_Size) + "\n";
+    text += "accessed "  + NPT_String::FromInteger(now.ToMillis()) + "\n";
+    for (NPT_List<BLT_NetworkCacheExtent>::Iterator i = m_Extents.GetFirstItem(); i; ++i) {
+        text += "extent ";
+        text += NPT_String::FromIntegerU(i->m_Start);
+        text += " ";
+        text += NPT_String::FromIntegerU(i->m_End);
+        text += "\n";
+    }
+
+    if (NPT_FAILED(NPT_File::Save(m_IndexPath, text))) {
+        ATX_LOG_WARNING_1("failed to save cache index %s", m_IndexPath.GetChars());
+    }
+}
+
+/*----------------------------------------------------------------------
+|   BLT_NetworkCacheEntry::Open
++---------------------------------------------------------------------*/
+NPT_Result
+BLT_NetworkCacheEntry::Open()
+{
+    NPT_LargeSize data_size = 0;
+    bool          valid;
+
+    // make sure the directory exists
+    NPT_File::CreateDir(m_Directory);
+
+    // load the index and check that it matches the data file
+    valid = LoadIndex() && NPT_SUCCEEDED(NPT_File::GetSize(m_DataPath, data_size));
+    if (valid) {
+        // forget about extents that may not have made it to the disk
+        NPT_List<BLT_NetworkCacheExtent>::Iterator i = m_Extents.GetFirstItem();
+        while (i) {
+            NPT_List<BLT_NetworkCacheExtent>::Iterator next = i;
+            ++next;
+            if (i->m_End > data_size || i->m_End > m_Size) m_Extents.Erase(i);
+            i = next;
+        }
+    } else {
+        m_Extents.Clear();
+    }
+
+    // open the data file
+    NPT_File::OpenMode mode = NPT_FILE_OPEN_MODE_READ | NPT_FILE_OPEN_MODE_WRITE;
+    if (!valid) mode |= NPT_FILE_OPEN_MODE_CREATE | NPT_FILE_OPEN_MODE_TRUNCATE;
+    m_DataFile = new NPT_File(m_DataPath);
+    NPT_Result result = m_DataFile->Open(mode);
+    if (NPT_FAILED(result)) {
+        ATX_LOG_WARNING_2("cannot open cache file %s (%d)", m_DataPath.GetChars(), result);
+        return result;
+    }
+    m_DataFile->GetInputStream(m_DataInput);
+    m_DataFile->GetOutputStream(m_DataOutput);
+    if (m_DataInput.IsNull() || m_DataOutput.IsNull()) return NPT_ERROR_INTERNAL;
+    m_Open     = true;
+    m_Writable = true;
+
+    // mark this entry as the most recently used, and make room for it
+    UpdateDirectory();
+
+    // the index is always re-written to update the access time
+    m_Dirty = true;
+
+    ATX_LOG_FINE_2("opened cache entry %s (%d extents)", m_Key.GetChars(), m_Extents.GetItemCount());
+    return NPT_SUCCESS;
+}
+
+/*----------------------------------------------------------------------
+|   BLT_NetworkCacheEntry::GetCachedLength
++---------------------------------------------------------------------*/
+NPT_Size
+BLT_NetworkCacheEntry::GetCachedLength(NPT_Position position, NPT_Size max)
+{
+    for (NPT_List<BLT_NetworkCacheExtent>::Iterator i = m_Extents.GetFirstItem(); i; ++i) {
+        if (position >= i->m_Start && position < i->m_End) {
+            NPT_LargeSize length = i->m_End-position;
+            return length < max ? (NPT_Size)length : max;
+        }
+        if (i->m_Start > position) break;
+    }
+
+    return 0;
+}
+
+/*----------------------------------------------------------------------
+|   BLT_NetworkCacheEntry::GetMissingLength
++---------------------------------------------------------------------*/
+NPT_Size
+BLT_NetworkCacheEntry::GetMissingLength(NPT_Position position, NPT_Size max)
+{
+    for (NPT_List<BLT_NetworkCacheExtent>::Iterator i = m_Extents.GetFirstItem(); i; ++i) {
+        if (i->m_Start > position) {
+            NPT_LargeSize length = i->m_Start-position;
+            return length < max ? (NPT_Size)length : max;
+        }
+    }
+
+    return max;
+}
+
+/*----------------------------------------------------------------------
+|   BLT_NetworkCacheEntry::ReadData
++---------------------------------------------------------------------*/
+NPT_Result
+BLT_NetworkCacheEntry::ReadData(NPT_Position position,
+                                void*        buffer,
+                                NPT_Size     bytes_to_read,
+                                NPT_Size&    bytes_read)
+{
+    bytes_read = 0;
+    NPT_Result result = m_DataInput->Seek(position);
+    if (NPT_FAILED(result)) return result;
+    return m_DataInput->Read(buffer, bytes_to_read, &bytes_read);
+}
+
+/*----------------------------------------------------------------------
+|   BLT_NetworkCacheEntry::WriteData
++---------------------------------------------------------------------*/
+void
+BLT_NetworkCacheEntry::WriteData(NPT_Position position, const void* buffer, NPT_Size size)
+{
+    if (!m_Writable || size == 0) return;
+
+    NPT_Result result = m_DataOutput->Seek(position);
+    if (NPT_SUCCEEDED(result)) {
+        result = m_DataOutput->WriteFully(buffer, size);
+    }
+    if (NPT_FAILED(result)) {
+        // stop caching, but keep what we have
+        ATX_LOG_WARNING_1("failed to write to cache (%d), disabling", result);
+        m_Writable = false;
+        return;
+    }
+    AddExtent(position, position+size);
+}
+
+/*----------------------------------------------------------------------
+|   BLT_NetworkCacheEntry::AddExtent
++---------------------------------------------------------------------*/
+void
+BLT_NetworkCacheEntry::AddExtent(NPT_Position start, NPT_Position end)
+{
+    // rebuild the list, merging the new extent with the ones it
+    // overlaps or touches
+    NPT_List<BLT_NetworkCacheExtent> extents;
+    BLT_NetworkCacheExtent           merged = { start, end };
+    bool                             inserted = false;
+    for (NPT_List<BLT_NetworkCacheExtent>::Iterator i = m_Extents.GetFirstItem(); i; ++i) {
+        if (i->m_End < merged.m_Start) {
+            extents.Add(*i);
+        } else if (i->m_Start > merged.m_End) {
+            if (!inserted) {
+                extents.Add(merged);
+                inserted = true;
+            }
+            extents.Add(*i);
+        } else {
+            if (i->m_Start < merged.m_Start) merged.m_Start = i->m_Start;
+            if (i->m_End   > merged.m_End)   merged.m_End   = i->m_End;
+        }
+    }
+    if (!inserted) extents.Add(merged);
+    m_Extents = extents;
+}
+
+/*----------------------------------------------------------------------
+|   CachedInputStream_Destroy
++---------------------------------------------------------------------*/
+static void
+CachedInputStream_Destroy(CachedInputStream* self)
+{
+    delete self->m_Entry;
+    ATX_RELEASE_OBJECT(self->m_Source);
+    delete self;
+}
+
+/*----------------------------------------------------------------------
+|   CachedInputStream_Read
++---------------------------------------------------------------------*/
+BLT_METHOD
+CachedInputStream_Read(ATX_InputStream* _self,
+                       ATX_Any          buffer,
+                       ATX_Size         bytes_to_read,
+                       ATX_Size*        bytes_read)
+{
+    CachedInputStream* self = ATX_SELF(CachedInputStream, ATX_InputStream);
+    ATX_Size           bytes_read_storage = 0;
+    ATX_Result         result;
+
+    if (bytes_read) {
+        *bytes_read = 0;
+    } else {
+        bytes_read = &bytes_read_storage;
+    }
+    if (bytes_to_read == 0) return ATX_SUCCESS;
+    if (self->m_Position >= self->m_Size) return ATX_ERROR_EOS;
+
+    // serve from the cache if we can
+    NPT_Size cached = self->m_Entry->GetCachedLength(self->m_Position, bytes_to_read);
+    if (cached) {
+        NPT_Size chunk = 0;
+        result = self->m_Entry->ReadData(self->m_Position, buffer, cached, chunk);
+        if (NPT_SUCCEEDED(result) && chunk) {
+            ATX_LOG_FINER_2("read %d bytes from cache at %lld", chunk, self->m_Position);
+            self->m_Position += chunk;
+            *bytes_read = chunk;
+            return ATX_SUCCESS;
+        }
+        ATX_LOG_WARNING_1("failed to read from cache (%d)", result);
+    }
+
+    // read what's missing from the source, up to the next cached extent
+    NPT_Size missing = self->m_Entry->GetMissingLength(self->m_Position, bytes_to_read);
+    if (self->m_SourcePosition != self->m_Position) {
+        ATX_LOG_FINE_1("seeking source to %lld", self->m_Position);
+        result = ATX_InputStream_Seek(self->m_Source, self->m_Position);
+        if (ATX_FAILED(result)) return result;
+        self->m_SourcePosition = self->m_Position;
+    }
+    result = ATX_InputStream_Read(self->m_Source, buffer, missing, bytes_read);
+    if (ATX_FAILED(result)) return result;
+
+    // store what we got
+    self->m_Entry->WriteData(self->m_Position, buffer, *bytes_read);
+    self->m_Position       += *bytes_read;
+    self->m_SourcePosition += *bytes_read;
+
+    return ATX_SUCCESS;
+}
+
+/*----------------------------------------------------------------------
+|   CachedInputStream_Seek
++---------------------------------------------------------------------*/
+BLT_METHOD
+CachedInputStream_Seek(ATX_InputStream* _self,
+                       ATX_Position     where)
+{
+    CachedInputStream* self = ATX_SELF(CachedInputStream, ATX_InputStream);
+
+    // the source is only repositioned when we need to read from it
+    if (where > self->m_Size) return ATX_ERROR_OUT_OF_RANGE;
+    self->m_Position = where;
+
+    return ATX_SUCCESS;
+}
+
+/*----------------------------------------------------------------------
+|   CachedInputStream_Tell
++---------------------------------------------------------------------*/
+BLT_METHOD
+CachedInputStream_Tell(ATX_InputStream* _self,
+                       ATX_Position*    position)
+{
+    CachedInputStream* self = ATX_SELF(CachedInputStream, ATX_InputStream);
+    *position = self->m_Position;
+    return ATX_SUCCESS;
+}
+
+/*----------------------------------------------------------------------
+|   CachedInputStream_GetSize
++---------------------------------------------------------------------*/
+BLT_METHOD
+CachedInputStream_GetSize(ATX_InputStream* _self,
+                          ATX_LargeSize*   size)
+{
+    CachedInputStream* self = ATX_SELF(CachedInputStream, ATX_InputStream);
+    *size = self->m_Size;
+    return ATX_SUCCESS;
+}
+
+/*----------------------------------------------------------------------
+|   CachedInputStream_GetAvailable
++---------------------------------------------------------------------*/
+BLT_METHOD
+CachedInputStream_GetAvailable(ATX_InputStream* _self,
+                               ATX_LargeSize*   available)
+{
+    CachedInputStream* self = ATX_SELF(CachedInputStream, ATX_InputStream);
+
+    *available = self->m_Entry->GetCachedLength(self->m_Position, 0xFFFFFFFF);
+    if (*available) return ATX_SUCCESS;
+    if (self->m_SourcePosition == self->m_Position) {
+        return ATX_InputStream_GetAvailable(self->m_Source, available);
+    }
+
+    return ATX_SUCCESS;
+}
+
+/*----------------------------------------------------------------------
+|   CachedInputStream_GetProperty
++---------------------------------------------------------------------*/
+ATX_METHOD
+CachedInputStream_GetProperty(ATX_Properties*    _self,
+                              const char*        name,
+                              ATX_PropertyValue* value)
+{
+    CachedInputStream* self = ATX_SELF(CachedInputStream, ATX_Properties);
+    ATX_Properties*    properties = ATX_CAST(self->m_Source, ATX_Properties);
+
+    if (properties == NULL) return ATX_ERROR_NO_SUCH_PROPERTY;
+    return ATX_Properties_GetProperty(properties, name, value);
+}
+
+/*----------------------------------------------------------------------
+|   CachedInputStream_Attach
++---------------------------------------------------------------------*/
+BLT_METHOD
+CachedInputStream_Attach(BLT_NetworkInputSource* _self,
+                         BLT_Stream*             stream)
+{
+    CachedInputStream*      self = ATX_SELF(CachedInputStream, BLT_NetworkInputSource);
+    BLT_NetworkInputSource* next = ATX_CAST(self->m_Source, BLT_NetworkInputSource);
+
+    if (next) return BLT_NetworkInputSource_Attach(next, stream);
+    return BLT_SUCCESS;
+}
+
+/*----------------------------------------------------------------------
+|   CachedInputStream_Detach
++---------------------------------------------------------------------*/
+BLT_METHOD
+CachedInputStream_Detach(BLT_NetworkInputSource* _self)
+{
+    CachedInputStream*      self = ATX_SELF(CachedInputStream, BLT_NetworkInputSource);
+    BLT_NetworkInputSource* next = ATX_CAST(self->m_Source, BLT_NetworkInputSource);
+
+    if (next) return BLT_NetworkInputSource_Detach(next);
+    return BLT_SUCCESS;
+}
+
+/*----------------------------------------------------------------------
+|   GetInterface implementation
++---------------------------------------------------------------------*/
+ATX_BEGIN_GET_INTERFACE_IMPLEMENTATION(CachedInputStream)
+    ATX_GET_INTERFACE_ACCEPT(CachedInputStream, ATX_Referenceable)
+    ATX_GET_INTERFACE_ACCEPT(CachedInputStream, ATX_Properties)
+    ATX_GET_INTERFACE_ACCEPT(CachedInputStream, ATX_InputStream)
+    ATX_GET_INTERFACE_ACCEPT(CachedInputStream, BLT_NetworkInputSource)
+ATX_END_GET_INTERFACE_IMPLEMENTATION
+
+/*----------------------------------------------------------------------
+|    ATX_InputStream interface
++---------------------------------------------------------------------*/
+ATX_BEGIN_INTERFACE_MAP(CachedInputStream, ATX_InputStream)
+    CachedInputStream_Read,
+    CachedInputStream_Seek,
+    CachedInputStream_Tell,
+    CachedInputStream_GetSize,
+    CachedInputStream_GetAvailable
+ATX_END_INTERFACE_MAP
+
+/*----------------------------------------------------------------------
+|   ATX_Properties interface
++---------------------------------------------------------------------*/
+ATX_IMPLEMENT_STATIC_PROPERTIES_INTERFACE(CachedInputStream)
+
+/*----------------------------------------------------------------------
+|    BLT_NetworkInputSource interface
++---------------------------------------------------------------------*/
+ATX_BEGIN_INTERFACE_MAP(CachedInputStream, BLT_NetworkInputSource)
+    CachedInputStream_Attach,
+    CachedInputStream_Detach
+ATX_END_INTERFACE_MAP
+
+/*----------------------------------------------------------------------
+|   ATX_Referenceable interface
++---------------------------------------------------------------------*/
+ATX_IMPLEMENT_REFERENCEABLE_INTERFACE(CachedInputStream, m_ReferenceCount)
+
+/*----------------------------------------------------------------------
+|   BLT_NetworkCache_GetSettings
++---------------------------------------------------------------------*/
+static bool
+BLT_NetworkCache_GetSettings(BLT_Core*      core,
+                             NPT_String&    directory,
+                             NPT_LargeSize& max_size)
+{
+    directory = NULL;
+    max_size  = BLT_NETWORK_CACHE_DEFAULT_MAX_SIZE;
+
+    ATX_Properties* properties = NULL;
+    if (ATX_SUCCEEDED(BLT_Core_GetProperties(core, &properties))) {
+        ATX_PropertyValue value;
+        if (ATX_SUCCEEDED(ATX_Properties_GetProperty(properties, BLT_NETWORK_CACHE_DIRECTORY_PROPERTY, &value)) &&
+            value.type == ATX_PROPERTY_VALUE_TYPE_STRING && value.data.string) {
+            directory = value.data.string;
+        }
+        if (ATX_SUCCEEDED(ATX_Properties_GetProperty(properties, BLT_NETWORK_CACHE_MAX_SIZE_PROPERTY, &value)) &&
+            value.type == ATX_PROPERTY_VALUE_TYPE_INTEGER && value.data.integer > 0) {
+            max_size = value.data.integer;
+        }
+    }
+
+    return !directory.IsEmpty();
+}
+
+/*----------------------------------------------------------------------
+|   BLT_NetworkCache_Lookup
++---------------------------------------------------------------------*/
+NPT_Result
+BLT_NetworkCache_Lookup(BLT_Core*             core,
+                        const char*           url,
+                        BLT_NetworkCacheInfo& info)
+{
+    NPT_String    directory;
+    NPT_LargeSize max_size = 0;
+
+    if (!BLT_NetworkCache_GetSettings(core, directory, max_size)) return NPT_ERROR_NO_SUCH_ITEM;
+
+    NPT_String key = BLT_NetworkCacheEntry::MakeKey(url);
+    {
+        NPT_AutoLock lock(BLT_NetworkCache_Lock);
+        if (BLT_NetworkCacheEntry::IsLocked(key)) return NPT_ERROR_NO_SUCH_ITEM;
+    }
+
+    // read the index
+    NPT_String base = directory;
+    base += NPT_FilePath::Separator;
+    base += key;
+    NPT_String            text;
+    BLT_NetworkCacheIndex index;
+    NPT_LargeSize         data_size = 0;
+    if (NPT_FAILED(NPT_File::Load(base + BLT_NETWORK_CACHE_INDEX_EXTENSION, text)) ||
+        !BLT_NetworkCacheEntry::ParseIndex(text, index) ||
+        NPT_FAILED(NPT_File::GetSize(base + BLT_NETWORK_CACHE_DATA_EXTENSION, data_size))) {
+        return NPT_ERROR_NO_SUCH_ITEM;
+    }
+    if (index.m_Url != url || index.m_Validator.IsEmpty() || index.m_Size == 0) {
+        return NPT_ERROR_NO_SUCH_ITEM;
+    }
+
+    // only the data cached from the start counts, since that's where
+    // a new stream starts reading (the extents are sorted, and Open drops
+    // those that may not have made it to the disk)
+    NPT_List<BLT_NetworkCacheExtent>::Iterator first = index.m_Extents.GetFirstItem();
+    if (!first || first->m_Start != 0) return NPT_ERROR_NO_SUCH_ITEM;
+    if (first->m_End > data_size || first->m_End > index.m_Size) return NPT_ERROR_NO_SUCH_ITEM;
+
+    info.m_Validator   = index.m_Validator;
+    info.m_ContentType = index.m_ContentType;
+    info.m_Size        = index.m_Size;
+    info.m_CachedSize  = first->m_End;
+    ATX_LOG_FINE_3("found cache entry %s (%lld of %lld bytes)", key.GetChars(), first->m_End, index.m_Size);
+
+    return NPT_SUCCESS;
+}
+
+/*----------------------------------------------------------------------
+|   BLT_NetworkCache_CreateStream
++---------------------------------------------------------------------*/
+BLT_Result
+BLT_NetworkCache_CreateStream(BLT_Core*         core,
+                              const char*       url,
+                              const char*       validator,
+                              const char*       content_type,
+                              ATX_InputStream*  source,
+                              ATX_InputStream** stream)
+{
+    NPT_String    directory;
+    NPT_LargeSize max_size = 0;
+    ATX_LargeSize size = 0;
+
+    // by default, use the source directly
+    *stream = source;
+    ATX_REFERENCE_OBJECT(source);
+
+    // get the settings
+    if (!BLT_NetworkCache_GetSettings(core, directory, max_size)) return BLT_SUCCESS;
+
+    // only validated, seekable resources of known size can be cached
+    if (validator == NULL) {
+        ATX_LOG_FINE("no validator, not caching");
+        return BLT_SUCCESS;
+    }
+    if (ATX_FAILED(ATX_InputStream_GetSize(source, &size)) || size == 0) {
+        ATX_LOG_FINE("unknown size, not caching");
+        return BLT_SUCCESS;
+    }
+    {
+        ATX_Properties*   properties = ATX_CAST(source, ATX_Properties);
+        ATX_PropertyValue value;
+        if (properties &&
+            ATX_SUCCEEDED(ATX_Properties_GetProperty(properties, ATX_INPUT_STREAM_PROPERTY_SEEK_SPEED, &value)) &&
+            value.type == ATX_PROPERTY_VALUE_TYPE_INTEGER &&
+            value.data.integer == ATX_INPUT_STREAM_SEEK_SPEED_NO_SEEK) {
+            ATX_LOG_FINE("source not seekable, not caching");
+            return BLT_SUCCESS;
+        }
+    }
+
+    // only one stream at a time may use a given entry
+    NPT_String key = BLT_NetworkCacheEntry::MakeKey(url);
+    if (!BLT_NetworkCacheEntry::Lock(key)) {
+        ATX_LOG_FINE_1("cache entry %s busy, not caching", key.GetChars());
+        return BLT_SUCCESS;
+    }
+    BLT_NetworkCacheEntry* entry = new BLT_NetworkCacheEntry(directory, key, url, validator, content_type, size, max_size);
+    if (NPT_FAILED(entry->Open())) {
+        delete entry;
+        return BLT_SUCCESS;
+    }
+
+    // create the stream
+    CachedInputStream* cached = new CachedInputStream;
+    cached->m_ReferenceCount = 1;
+    cached->m_Source         = source;
+    cached->m_Entry          = entry;
+    cached->m_Size           = size;
+    cached->m_Position       = 0;
+    cached->m_SourcePosition = 0;
+    ATX_Position source_position = 0;
+    if (ATX_SUCCEEDED(ATX_InputStream_Tell(source, &source_position))) {
+        cached->m_SourcePosition = source_position;
+    }
+
+    // setup interfaces
+    ATX_SET_INTERFACE(cached, CachedInputStream, ATX_InputStream);
+    ATX_SET_INTERFACE(cached, CachedInputStream, ATX_Properties);
+    ATX_SET_INTERFACE(cached, CachedInputStream, BLT_NetworkInputSource);
+    ATX_SET_INTERFACE(cached, CachedInputStream, ATX_Referenceable);
+
+    // the reference to the source taken above is now held by the cached stream
+    *stream = &ATX_BASE(cached, ATX_InputStream);
+
+    return BLT_SUCCESS;
+}
@@ -0,0 +1,103 @@
+/*****************************************************************
+|
+|   BlueTune - Network Cache
+|
+|   (c) 2002-2012 Gilles Boccon-Gibod
+|   Author: Gilles Boccon-Gibod (bok@bok.net)
+|
+****************************************************************/
+
+#ifndef _BLT_NETWORK_CACHE_H_
+#define _BLT_NETWORK_CACHE_H_
+
+/*----------------------------------------------------------------------
+|   includes
++---------------------------------------------------------------------*/
+#include "Atomix.h"
+#include "BltTypes.h"
+#include "BltCore.h"
+
+/*----------------------------------------------------------------------
+|   constants
++---------------------------------------------------------------------*/
+/**
+ * Core property (string) with the path of the directory in which
+ * fetched byte ranges are stored. The cache is disabled when this
+ * property is not set.
+ */
+#define BLT_NETWORK_CACHE_DIRECTORY_PROPERTY "NetworkStream.CacheDirectory"
+
+/**
+ * Core property (integer) with the maximum number of bytes kept in the
+ * cache directory. Least recently used entries are removed first.
+ */
+#define BLT_NETWORK_CACHE_MAX_SIZE_PROPERTY  "NetworkStream.CacheMaxSize"
+
+#define BLT_NETWORK_CACHE_DEFAULT_MAX_SIZE   (256*1024*1024)
+
+/*----------------------------------------------------------------------
+|   functions
++---------------------------------------------------------------------*/
+#if defined(__cplusplus)
+extern "C" {
+#endif
+
+/**
+ * Wrap a seekable source stream of known size with a stream that serves
+ * reads from the on-disk cache when the requested range is present, and
+ * stores what is read from the source otherwise.
+ * When the cache is not enabled for the core, or when the source cannot
+ * be cached, a new reference to the source itself is returned.
+ *
+ * @param url URL of the resource, used as the cache key.
+ * @param validator Opaque string that changes when the resource changes
+ * (typically derived from an ETag or Last-Modified header). Data cached
+ * under a different validator is discarded. Pass NULL if the resource
+ * cannot be validated, in which case it is not cached.
+ * @param content_type Content type of the resource, stored with the
+ * cached data so that it is known when the resource is revalidated
+ * without being sent again. May be NULL.
+ */
+BLT_Result
+BLT_NetworkCache_CreateStream(BLT_Core*         core,
+                              const char*       url,
+                              const char*       validator,
+                              const char*       content_type,
+                              ATX_InputStream*  source,
+                              ATX_InputStream** stream);
+
+#if defined(__cplusplus)
+}
+#endif
+
+/*----------------------------------------------------------------------
+|   C++ interface
++---------------------------------------------------------------------*/
+#if defined(__cplusplus)
+#include "Neptune.h"
+
+/**
+ * What the cache holds for a resource.
+ */
+struct BLT_NetworkCacheInfo {
+    NPT_String    m_Validator;   // as passed to BLT_NetworkCache_CreateStream
+    NPT_String    m_ContentType; // empty if unknown
+    NPT_LargeSize m_Size;        // size of the resource
+    NPT_LargeSize m_CachedSize;  // number of bytes cached from the start
+};
+
+/**
+ * Look up the cached data for a URL, so that the request for it can be
+ * made conditional on the resource being unchanged.
+ * Fails if the cache is not enabled for the core, if nothing is cached
+ * from the start of the resource, or if the entry is in use by another
+ * stream (in which case BLT_NetworkCache_CreateStream would not use it).
+ */
+NPT_Result
+BLT_NetworkCache_Lookup(BLT_Core*             core,
+                        const char*           url,
+                        BLT_NetworkCacheInfo& info);
+
+#endif /* __cplusplus */
+
+#endif /* _BLT_NETWORK_CACHE_H_ */
@@ -20,6 +20,7 @@
 #include "BltByteStreamProvider.h"
 #include "BltTcpNetworkStream.h"
 #include "BltHttpNetworkStream.h"
+#include "BltHttpConnectionPool.h"
 #include "BltNetworkInputSource.h"
 
 /*----------------------------------------------------------------------
@@ -33,6 +34,9 @@ ATX_SET_LOCAL_LOGGER("bluetune.plugins.inputs.network")
 typedef struct {
     /* base class */
     ATX_EXTENDS(BLT_BaseModule);
+
+    /* members */
+    BLT_HttpConnectionPool* connection_pool;
 } NetworkInputModule;
 
 typedef struct {
@@ -351,6 +355,32 @@ ATX_IMPLEMENT_REFERENCEABLE_INTERFACE_EX(NetworkInput,
                                          reference_count)
 
 
+/*----------------------------------------------------------------------
+|   NetworkInputModule_Attach
++---------------------------------------------------------------------*/
+BLT_METHOD
+NetworkInputModule_Attach(BLT_Module* _self, BLT_Core* core)
+{
+    NetworkInputModule* self = ATX_SELF_EX(NetworkInputModule, BLT_BaseModule, BLT_Module);
+    ATX_Properties*     properties = NULL;
+
+    /* create a connection pool that will be shared by all the */
+    /* http streams created in the context of this core        */
+    if (self->connection_pool == NULL) {
+        BLT_HttpConnectionPool_Create(&self->connection_pool);
+    }
+
+    /* publish the pool */
+    if (ATX_SUCCEEDED(BLT_Core_GetProperties(core, &properties))) {
+        ATX_PropertyValue property;
+        property.type = ATX_PROPERTY_VALUE_TYPE_POINTER;
+        property.data.pointer = self->connection_pool;
+        ATX_Properties_SetProperty(properties, BLT_HTTP_CONNECTION_POOL_PROPERTY, &property);
+    }
+
+    return BLT_SUCCESS;
+}
+
 /*----------------------------------------------------------------------
 |   NetworkInputModule_Probe
 +---------------------------------------------------------------------*/
@@ -425,7 +455,7 @@ BLT_MODULE_IMPLEMENT_SIMPLE_MEDIA_NODE_FACTORY(NetworkInputModule, NetworkInput)
 +---------------------------------------------------------------------*/
 ATX_BEGIN_INTERFACE_MAP_EX(NetworkInputModule, BLT_BaseModule, BLT_Module)
     BLT_BaseModule_GetInfo,
-    BLT_BaseModule_Attach,
+    NetworkInputModule_Attach,
     NetworkInputModule_CreateInstance,
     NetworkInputModule_Probe
 ATX_END_INTERFACE_MAP
@@ -433,8 +463,12 @@ ATX_END_INTERFACE_MAP
 /*----------------------------------------------------------------------
 |   ATX_Referenceable interface
 +---------------------------------------------------------------------*/
-#define NetworkInputModule_Destroy(x) \
-    BLT_BaseModule_Destroy((BLT_BaseModule*)(x))
+static BLT_Result
+NetworkInputModule_Destroy(NetworkInputModule* self)
+{
+    BLT_HttpConnectionPool_Release(self->connection_pool);
+    return BLT_BaseModule_Destroy(&ATX_BASE(self, BLT_BaseModule));
+}
 
 ATX_IMPLEMENT_REFERENCEABLE_INTERFACE_EX(NetworkInputModule, 
                                          BLT_BaseModule,
@@ -23,12 +23,22 @@
 #include "BltNetworkInputSource.h"
 #include "BltNetworkInput.h"
 #include "BltNetworkStream.h"
+#include "BltNetworkSockets.h"
 
 /*----------------------------------------------------------------------
 |   logging
 +---------------------------------------------------------------------*/
 ATX_SET_LOCAL_LOGGER("bluetune.plugins.inputs.queued-network")
 
+/*----------------------------------------------------------------------
+|    constants
++---------------------------------------------------------------------*/
+/**
+ * How often to look again at a stream whose source has no socket to
+ * wait for.
+ */
+const NPT_Timeout BLT_NETWORK_QUEUE_RETRY_INTERVAL = 100; /* ms */
+
 /*----------------------------------------------------------------------
 |    types
 +---------------------------------------------------------------------*/
@@ -39,10 +49,18 @@ public:
         public:
             Entry(const char* url, ATX_Object* media_node, NPT_UInt64 sequence);
             ~Entry();
-            NPT_String                 m_Url;
-            ATX_Object*                m_MediaNode;
-            BLT_BufferedNetworkStream* m_NetworkStream;
-            NPT_String                 m_Id;
+            bool IsAhead(const Entry& other) const {
+                return m_Priority < other.m_Priority ||
+                       (m_Priority == other.m_Priority && m_Sequence < other.m_Sequence);
+            }
+            NPT_String                      m_Url;
+            ATX_Object*                     m_MediaNode;
+            BLT_BufferedNetworkStream*      m_NetworkStream;
+            NPT_String                      m_Id;
+            NPT_UInt64                      m_Sequence;
+            unsigned int                    m_Priority;
+            BLT_BufferedNetworkStreamStatus m_Status;   // as of the last read
+            BLT_SocketFd                    m_Socket;   // waited for in this round
     };
     
     // methods
@@ -51,19 +69,30 @@ public:
     BLT_Result   Attach(BLT_Core* core);
     virtual void Run();
     void         Abort();
-    BLT_Result   Enqueue(const char* url, Entry*& entry);
+    BLT_Result   Enqueue(const char* url, unsigned int priority, Entry*& entry);
     BLT_Result   Remove(const char* entry_id);
     BLT_Result   Extract(const char* entry_id, ATX_Object** object);
     BLT_Result   GetStatus(const char* entry_id, BLT_BufferedNetworkStreamStatus* status);
+    BLT_Result   SetPriority(const char* entry_id, unsigned int priority);
+    void         SetMemoryBudget(NPT_Size budget);
     
 private:
+    // methods
+    void        Insert(Entry* entry);
+    Entry*      Detach(const char* entry_id);
+    NPT_Timeout Schedule();
+    void        Service();
+    void        WakeUp() { m_Selector.WakeUp(); }
+    
     // members
-    NPT_Mutex        m_Lock;
-    volatile bool    m_ShouldExit;
-    NPT_List<Entry*> m_Entries;
-    NPT_UInt64       m_Sequence;
-    BLT_Core*        m_Core;
-    BLT_Module*      m_FactoryModule;
+    NPT_Mutex          m_Lock;
+    BLT_SocketSelector m_Selector;
+    volatile bool      m_ShouldExit;
+    NPT_List<Entry*>   m_Entries;
+    NPT_UInt64         m_Sequence;
+    NPT_Size           m_MemoryBudget;
+    BLT_Core*          m_Core;
+    BLT_Module*        m_FactoryModule;
 };
 
 struct BLT_NetworkQueuedInputModule {
@@ -80,10 +109,14 @@ struct BLT_NetworkQueuedInputModule {
 NetworkQueue::Entry::Entry(const char* url, ATX_Object* media_node, NPT_UInt64 sequence) :
     m_Url(url),
     m_MediaNode(media_node),
-    m_NetworkStream(NULL)
+    m_NetworkStream(NULL),
+    m_Sequence(sequence),
+    m_Priority(BLT_NETWORK_QUEUED_INPUT_DEFAULT_PRIORITY),
+    m_Socket(BLT_SOCKET_FD_INVALID)
 {
     m_Id = "netq:";
     m_Id += NPT_String::FromIntegerU(sequence);
+    NPT_SetMemory(&m_Status, 0, sizeof(m_Status));
     
     ATX_REFERENCE_OBJECT(media_node);
     
@@ -93,6 +126,9 @@ NetworkQueue::Entry::Entry(const char* url, ATX_Object* media_node, NPT_UInt64 s
         BLT_InputStreamProvider_GetStream(input_stream_provider, &input_stream);
         m_NetworkStream = ATX_CAST(input_stream, BLT_BufferedNetworkStream);
     }
+    if (m_NetworkStream) {
+        BLT_BufferedNetworkStream_GetStatus(m_NetworkStream, &m_Status);
+    }
 }
 
 /*----------------------------------------------------------------------
@@ -110,6 +146,7 @@ NetworkQueue::Entry::~Entry()
 NetworkQueue::NetworkQueue(BLT_Module* factory_module) :
     m_ShouldExit(false),
     m_Sequence(0),
+    m_MemoryBudget(BLT_NETWORK_QUEUED_INPUT_DEFAULT_MEMORY_BUDGET),
     m_Core(NULL),
     m_FactoryModule(factory_module)
 {
@@ -136,6 +173,150 @@ NetworkQueue::Attach(BLT_Core* core)
     return BLT_SUCCESS;
 }
 
+/*----------------------------------------------------------------------
+|   NetworkQueue::Insert
++---------------------------------------------------------------------*/
+void
+NetworkQueue::Insert(Entry* entry)
+{
+    // keep the list sorted, highest priority (lowest value) first
+    for (NPT_List<Entry*>::Iterator it = m_Entries.GetFirstItem();
+                                    it;
+                                    ++it) {
+        if (entry->IsAhead(**it)) {
+            m_Entries.Insert(it, entry);
+            return;
+        }
+    }
+    m_Entries.Add(entry);
+}
+
+/*----------------------------------------------------------------------
+|   NetworkQueue::Detach
+|
+|   Takes an entry out of the list. Must be called with the lock held.
++---------------------------------------------------------------------*/
+NetworkQueue::Entry*
+NetworkQueue::Detach(const char* entry_id)
+{
+    for (NPT_List<Entry*>::Iterator it = m_Entries.GetFirstItem();
+                                    it;
+                                    ++it) {
+        Entry* entry = *it;
+        if (entry->m_Id == entry_id) {
+            m_Entries.Erase(it);
+            return entry;
+        }
+    }
+    
+    return NULL;
+}
+
+/*----------------------------------------------------------------------
+|   NetworkQueue::Schedule
+|
+|   Decides which entries may read, in priority order, as long as the
+|   total buffered stays within the memory budget. An entry that may read
+|   can fill its whole buffer before it is asked again, so the room left
+|   in its buffer counts against the budget. The first entry that has a
+|   stream may always read, so that the next item to be played never
+|   starves because of entries queued after it.
+|   The entries that may read take what their source already has (what
+|   the connection has buffered, or what is cached on disk), and their
+|   sockets are added to the selector.
+|   Returns how long to wait for the sockets.
++---------------------------------------------------------------------*/
+NPT_Timeout
+NetworkQueue::Schedule()
+{
+    NPT_AutoLock lock(m_Lock);
+    
+    m_Selector.Reset();
+    
+    // compute how much is buffered across all entries
+    NPT_Size committed = 0;
+    for (NPT_List<Entry*>::Iterator it = m_Entries.GetFirstItem();
+                                    it;
+                                    ++it) {
+        committed += (*it)->m_Status.buffer_fullness;
+    }
+    
+    NPT_Timeout timeout = NPT_TIMEOUT_INFINITE;
+    bool        head    = true;
+    for (NPT_List<Entry*>::Iterator it = m_Entries.GetFirstItem();
+                                    it;
+                                    ++it) {
+        Entry* entry = *it;
+        entry->m_Socket = BLT_SOCKET_FD_INVALID;
+        if (entry->m_NetworkStream == NULL) continue;
+        
+        bool go = entry->m_Status.end_of_stream == 0 &&
+                  entry->m_Status.buffer_fullness < entry->m_Status.buffer_size;
+        if (go && !head && committed >= m_MemoryBudget) {
+            ATX_LOG_FINEST_2("memory budget reached (%d bytes), not filling %s", 
+                             (int)committed, entry->m_Id.GetChars());
+            go = false;
+        }
+        head = false;
+        if (!go) continue;
+        committed += entry->m_Status.buffer_size-entry->m_Status.buffer_fullness;
+        
+        // this only reads what the source has, so it does not block
+        unsigned int fullness = entry->m_Status.buffer_fullness;
+        BLT_BufferedNetworkStream_FillBuffer(entry->m_NetworkStream);
+        BLT_BufferedNetworkStream_GetStatus(entry->m_NetworkStream, &entry->m_Status);
+        if (entry->m_Status.buffer_fullness != fullness) {
+            // there may be more right away
+            timeout = 0;
+        }
+        
+        ATX_Properties*   properties = ATX_CAST(entry->m_NetworkStream, ATX_Properties);
+        ATX_PropertyValue value;
+        if (properties &&
+            ATX_SUCCEEDED(ATX_Properties_GetProperty(properties, BLT_NETWORK_STREAM_SOCKET_PROPERTY, &value)) &&
+            value.type == ATX_PROPERTY_VALUE_TYPE_INTEGER) {
+            entry->m_Socket = (BLT_SocketFd)value.data.integer;
+            m_Selector.Add(entry->m_Socket);
+        } else if (timeout != 0) {
+            timeout = BLT_NETWORK_QUEUE_RETRY_INTERVAL;
+        }
+    }
+    
+    return timeout;
+}
+
+/*----------------------------------------------------------------------
+|   NetworkQueue::Service
+|
+|   Reads from the entries whose socket the selector found readable.
+|   Entries removed or extracted since Schedule are no longer in the
+|   list, and entries added since then have no socket yet, so only
+|   sockets that were waited for are read from, and the reads don't
+|   block.
++---------------------------------------------------------------------*/
+void
+NetworkQueue::Service()
+{
+    NPT_AutoLock lock(m_Lock);
+    
+    for (NPT_List<Entry*>::Iterator it = m_Entries.GetFirstItem();
+                                    it;
+                                    ++it) {
+        Entry* entry = *it;
+        if (entry->m_Socket == BLT_SOCKET_FD_INVALID ||
+            !m_Selector.IsReadable(entry->m_Socket)) {
+            continue;
+        }
+        
+        // this also sees the end of a connection closed by the server,
+        // which FillBuffer cannot tell from a connection with no data
+        ATX_LOG_FINEST_1("filling buffer for entry %s", entry->m_Id.GetChars());
+        BLT_BufferedNetworkStream_WaitAndFillBuffer(entry->m_NetworkStream);
+        BLT_BufferedNetworkStream_GetStatus(entry->m_NetworkStream, &entry->m_Status);
+        entry->m_Socket = BLT_SOCKET_FD_INVALID;
+    }
+}
+
 /*----------------------------------------------------------------------
 |   NetworkQueue::Run
 +---------------------------------------------------------------------*/
@@ -144,19 +325,11 @@ NetworkQueue::Run()
 {
     ATX_LOG_FINE("starting thread");
     while (!m_ShouldExit) {
-        NPT_AutoLock lock(m_Lock);
-        
-        for (NPT_List<Entry*>::Iterator it = m_Entries.GetFirstItem();
-                                        it;
-                                        ++it) {
-            Entry* entry = *it;
-            if (entry->m_NetworkStream) {
-                ATX_LOG_FINEST_1("filling buffer for entry %s", entry->m_Id.GetChars());
-                BLT_BufferedNetworkStream_FillBuffer(entry->m_NetworkStream);
-            }
-        }
-
-        NPT_System::Sleep(0.1);
+        // wait for one of the sockets to be readable or for the queue
+        // to change, without holding the lock
+        NPT_Timeout timeout = Schedule();
+        m_Selector.Wait(timeout);
+        Service();
     }
 }
 
@@ -167,17 +340,22 @@ void
 NetworkQueue::Abort()
 {
     m_ShouldExit = true;
+    WakeUp();
 }
 
 /*----------------------------------------------------------------------
 |   NetworkQueue::Enqueue
 +---------------------------------------------------------------------*/
 BLT_Result   
-NetworkQueue::Enqueue(const char* url, Entry*& entry)
+NetworkQueue::Enqueue(const char* url, unsigned int priority, Entry*& entry)
 {
-    NPT_AutoLock lock(m_Lock);
+    NPT_UInt64 sequence;
+    {
+        NPT_AutoLock lock(m_Lock);
+        sequence = m_Sequence++;
+    }
     
-    // create an input module instance
+    // create an input module instance (this connects, so don't hold the lock)
     BLT_MediaNodeConstructor input_constructor;
     
     NPT_SetMemory(&input_constructor, 0, sizeof(input_constructor));
@@ -195,10 +373,14 @@ NetworkQueue::Enqueue(const char* url, Entry*& entry)
                                        &object);
     if (BLT_FAILED(result)) return result;
     
-    entry = new Entry(url, object, m_Sequence++);
-    m_Entries.Add(entry);
+    entry = new Entry(url, object, sequence);
+    entry->m_Priority = priority;
     ATX_RELEASE_OBJECT(object);
     
+    NPT_AutoLock lock(m_Lock);
+    Insert(entry);
+    WakeUp();
+    
     return NPT_SUCCESS;
 }
 
@@ -208,21 +390,20 @@ NetworkQueue::Enqueue(const char* url, Entry*& entry)
 BLT_Result 
 NetworkQueue::Remove(const char* entry_id)
 {
-    NPT_AutoLock lock(m_Lock);
-    
-    for (NPT_List<Entry*>::Iterator it = m_Entries.GetFirstItem();
-                                    it;
-                                    ++it) {
-        Entry* entry = *it;
-        if (entry->m_Id == entry_id) {
-            ATX_LOG_FINE_1("removing entry %s", entry_id);
-            m_Entries.Erase(it);
-            delete entry;
-            return BLT_SUCCESS;
-        }
+    Entry* entry;
+    {
+        NPT_AutoLock lock(m_Lock);
+        entry = Detach(entry_id);
+        if (entry == NULL) return ATX_ERROR_NO_SUCH_ITEM;
+        ATX_LOG_FINE_1("removing entry %s", entry_id);
+        WakeUp();
     }
     
-    return ATX_ERROR_NO_SUCH_ITEM;
+    // closing the connection may have to read the end of a response,
+    // so don't hold the lock
+    delete entry;
+    
+    return BLT_SUCCESS;
 }
 
 /*----------------------------------------------------------------------
@@ -231,23 +412,22 @@ NetworkQueue::Remove(const char* entry_id)
 BLT_Result   
 NetworkQueue::Extract(const char* entry_id, ATX_Object** object)
 {
-    NPT_AutoLock lock(m_Lock);
-    
-    for (NPT_List<Entry*>::Iterator it = m_Entries.GetFirstItem();
-                                    it;
-                                    ++it) {
-        Entry* entry = *it;
-        if (entry->m_Id == entry_id) {
-            ATX_LOG_FINE_1("extracting entry %s", entry_id);
-            m_Entries.Erase(it);
-            *object = entry->m_MediaNode;
-            entry->m_MediaNode = NULL;
-            delete entry;
-            return BLT_SUCCESS;
-        }
+    Entry* entry;
+    {
+        NPT_AutoLock lock(m_Lock);
+        entry = Detach(entry_id);
+        if (entry == NULL) return ATX_ERROR_NO_SUCH_ITEM;
+        ATX_LOG_FINE_1("extracting entry %s", entry_id);
+        WakeUp();
     }
     
-    return ATX_ERROR_NO_SUCH_ITEM;
+    // the queue thread only reads from entries in the list, so the
+    // stream can change hands right away
+    *object = entry->m_MediaNode;
+    entry->m_MediaNode = NULL;
+    delete entry;
+    
+    return BLT_SUCCESS;
 }
 
 /*----------------------------------------------------------------------
@@ -266,7 +446,8 @@ NetworkQueue::GetStatus(const char*                      entry_id,
         if (entry->m_Id == entry_id) {
             if (entry->m_NetworkStream) {
                 ATX_LOG_FINE_1("getting entry status for %s", entry_id);
-                return BLT_BufferedNetworkStream_GetStatus(entry->m_NetworkStream, status);
+                *status = entry->m_Status;
+                return BLT_SUCCESS;
             }
         }
     }
@@ -274,6 +455,38 @@ NetworkQueue::GetStatus(const char*                      entry_id,
     return ATX_ERROR_NO_SUCH_ITEM;
 }
 
+/*----------------------------------------------------------------------
+|   NetworkQueue::SetPriority
++---------------------------------------------------------------------*/
+BLT_Result 
+NetworkQueue::SetPriority(const char* entry_id, unsigned int priority)
+{
+    NPT_AutoLock lock(m_Lock);
+    
+    Entry* entry = Detach(entry_id);
+    if (entry == NULL) return ATX_ERROR_NO_SUCH_ITEM;
+    
+    ATX_LOG_FINE_2("setting priority of entry %s to %d", entry_id, priority);
+    entry->m_Priority = priority;
+    Insert(entry);
+    WakeUp();
+    
+    return BLT_SUCCESS;
+}
+
+/*----------------------------------------------------------------------
+|   NetworkQueue::SetMemoryBudget
++---------------------------------------------------------------------*/
+void
+NetworkQueue::SetMemoryBudget(NPT_Size budget)
+{
+    NPT_AutoLock lock(m_Lock);
+    
+    ATX_LOG_FINE_1("memory budget set to %d", (int)budget);
+    m_MemoryBudget = budget;
+    WakeUp();
+}
+
 /*----------------------------------------------------------------------
 |   BLT_NetworkQueuedInputModule_Destroy
 +---------------------------------------------------------------------*/
@@ -330,11 +543,26 @@ BLT_Result
 BLT_NetworkQueuedInputModule_Enqueue(BLT_NetworkQueuedInputModule* self,
                                      const char*                   url,
                                      const char**                  entry_id)
+{
+    return BLT_NetworkQueuedInputModule_EnqueueWithPriority(self, 
+                                                            url, 
+                                                            BLT_NETWORK_QUEUED_INPUT_DEFAULT_PRIORITY, 
+                                                            entry_id);
+}
+
+/*----------------------------------------------------------------------
+|   BLT_NetworkQueuedInputModule_EnqueueWithPriority
++---------------------------------------------------------------------*/
+BLT_Result 
+BLT_NetworkQueuedInputModule_EnqueueWithPriority(BLT_NetworkQueuedInputModule* self,
+                                                 const char*                   url,
+                                                 unsigned int                  priority,
+                                                 const char**                  entry_id)
 {
     NetworkQueue::Entry* entry = NULL;
     
-    ATX_LOG_INFO_1("enqueuing %s", url);
-    BLT_Result result = self->queue->Enqueue(url, entry);
+    ATX_LOG_INFO_2("enqueuing %s (priority %d)", url, priority);
+    BLT_Result result = self->queue->Enqueue(url, priority, entry);
     if (BLT_FAILED(result)) {
         *entry_id = NULL;
         return result;
@@ -366,6 +594,28 @@ BLT_NetworkQueuedInputModule_GetEntryStatus(BLT_NetworkQueuedInputModule*    sel
     return self->queue->GetStatus(entry_id, status);
 }
 
+/*----------------------------------------------------------------------
+|   BLT_NetworkQueuedInputModule_SetEntryPriority
++---------------------------------------------------------------------*/
+BLT_Result 
+BLT_NetworkQueuedInputModule_SetEntryPriority(BLT_NetworkQueuedInputModule* self,
+                                              const char*                   entry_id,
+                                              unsigned int                  priority)
+{
+    return self->queue->SetPriority(entry_id, priority);
+}
+
+/*----------------------------------------------------------------------
+|   BLT_NetworkQueuedInputModule_SetMemoryBudget
++---------------------------------------------------------------------*/
+BLT_Result 
+BLT_NetworkQueuedInputModule_SetMemoryBudget(BLT_NetworkQueuedInputModule* self,
+                                             BLT_Size                      budget)
+{
+    self->queue->SetMemoryBudget(budget);
+    return BLT_SUCCESS;
+}
+
 /*----------------------------------------------------------------------
 |   BLT_NetworkQueuedInputModule_Attach
 +---------------------------------------------------------------------*/
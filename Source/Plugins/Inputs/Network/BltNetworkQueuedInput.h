@@ -31,6 +31,20 @@
 #define BLT_NETWORK_QUEUED_INPUT_MODULE_UID "com.axiosys.input.queued-network"
 #define BLT_NETWORK_QUEUED_INPUT_HANDLE_PROPERTY "NetworkQueuedInput.Handle"
 
+/**
+ * Priority given to entries enqueued without an explicit priority.
+ * Entries with a lower priority value are filled first, and entries
+ * with the same priority are filled in the order in which they were
+ * enqueued, so the next item to be played comes first.
+ */
+#define BLT_NETWORK_QUEUED_INPUT_DEFAULT_PRIORITY 100
+
+/**
+ * Default limit on the total number of bytes buffered across all
+ * the entries of the queue.
+ */
+#define BLT_NETWORK_QUEUED_INPUT_DEFAULT_MEMORY_BUDGET (16*1024*1024)
+
 /*----------------------------------------------------------------------
 |   types
 +---------------------------------------------------------------------*/
@@ -55,6 +69,12 @@ BLT_NetworkQueuedInputModule_Enqueue(BLT_NetworkQueuedInputModule* self,
                                      const char*                   url,
                                      const char**                  entry_id);
 
+BLT_Result 
+BLT_NetworkQueuedInputModule_EnqueueWithPriority(BLT_NetworkQueuedInputModule* self,
+                                                 const char*                   url,
+                                                 unsigned int                  priority,
+                                                 const char**                  entry_id);
+
 BLT_Result 
 BLT_NetworkQueuedInputModule_RemoveEntry(BLT_NetworkQueuedInputModule* self,
                                          const char*                   entry_id);
@@ -64,6 +84,20 @@ BLT_NetworkQueuedInputModule_GetEntryStatus(BLT_NetworkQueuedInputModule*    sel
                                             const char*                      entry_id,
                                             BLT_BufferedNetworkStreamStatus* status);
 
+BLT_Result 
+BLT_NetworkQueuedInputModule_SetEntryPriority(BLT_NetworkQueuedInputModule* self,
+                                              const char*                   entry_id,
+                                              unsigned int                  priority);
+
+/**
+ * Set the maximum number of bytes buffered across all entries.
+ * Once the budget is reached, only the highest priority entry keeps
+ * being filled.
+ */
+BLT_Result 
+BLT_NetworkQueuedInputModule_SetMemoryBudget(BLT_NetworkQueuedInputModule* self,
+                                             BLT_Size                      budget);
+
 
 #if defined(__cplusplus)
 }
@@ -0,0 +1,471 @@
+/*****************************************************************
+|
+|   BlueTune - Network Sockets
+|
+|   (c) 2002-2012 Gilles Boccon-Gibod
+|   Author: Gilles Boccon-Gibod (bok@bok.net)
+|
+****************************************************************/
+
+/*----------------------------------------------------------------------
+|   includes
++---------------------------------------------------------------------*/
+#if defined(_WIN32)
+#if !defined(_WIN32_WINNT)
+#define _WIN32_WINNT 0x0600 /* for WSAPoll */
+#endif
+#include <winsock2.h>
+#include <ws2tcpip.h>
+#else
+#include <sys/types.h>
+#include <sys/socket.h>
+#include <sys/ioctl.h>
+#include <netinet/in.h>
+#include <arpa/inet.h>
+#include <fcntl.h>
+#include <poll.h>
+#include <unistd.h>
+#include <errno.h>
+#endif
+
+#include "Neptune.h"
+#include "Atomix.h"
+#include "BltNetworkSockets.h"
+
+/*----------------------------------------------------------------------
+|   logging
++---------------------------------------------------------------------*/
+ATX_SET_LOCAL_LOGGER("bluetune.plugins.inputs.network.sockets")
+
+/*----------------------------------------------------------------------
+|   constants
++---------------------------------------------------------------------*/
+const NPT_Timeout BLT_SOCKET_SELECTOR_MAX_WAIT_WITHOUT_WAKE_UP = 100; /* ms */
+
+/*----------------------------------------------------------------------
+|   platform adaptation
++---------------------------------------------------------------------*/
+#if defined(_WIN32)
+typedef SOCKET BLT_SystemSocket;
+typedef int    BLT_SystemSocketLength;
+#define BLT_Poll(fds, count, timeout) WSAPoll(fds, (ULONG)(count), timeout)
+#define BLT_CloseSocket               closesocket
+#define BLT_GetSocketError()          WSAGetLastError()
+#define BLT_SOCKET_ERROR_WOULD_BLOCK  WSAEWOULDBLOCK
+#define BLT_SOCKET_ERROR_IN_PROGRESS  WSAEWOULDBLOCK
+#define BLT_SOCKET_ERROR_INTERRUPTED  WSAEINTR
+#define BLT_SOCKET_SEND_FLAGS         0
+#else
+typedef int       BLT_SystemSocket;
+typedef socklen_t BLT_SystemSocketLength;
+#define BLT_Poll(fds, count, timeout) poll(fds, (nfds_t)(count), timeout)
+#define BLT_CloseSocket               close
+#define BLT_GetSocketError()          errno
+#define BLT_SOCKET_ERROR_WOULD_BLOCK  EWOULDBLOCK
+#define BLT_SOCKET_ERROR_IN_PROGRESS  EINPROGRESS
+#define BLT_SOCKET_ERROR_INTERRUPTED  EINTR
+#if defined(MSG_NOSIGNAL)
+#define BLT_SOCKET_SEND_FLAGS         MSG_NOSIGNAL
+#else
+#define BLT_SOCKET_SEND_FLAGS         0
+#endif
+#endif
+
+/*----------------------------------------------------------------------
+|   BLT_Socket_SetNonBlocking
++---------------------------------------------------------------------*/
+static NPT_Result
+BLT_Socket_SetNonBlocking(BLT_SystemSocket fd)
+{
+#if defined(_WIN32)
+    u_long mode = 1;
+    if (ioctlsocket(fd, FIONBIO, &mode) != 0) return NPT_ERROR_SOCKET_CONTROL_FAILED;
+#else
+    int flags = fcntl(fd, F_GETFL, 0);
+    if (flags < 0 || fcntl(fd, F_SETFL, flags | O_NONBLOCK) < 0) {
+        return NPT_ERROR_SOCKET_CONTROL_FAILED;
+    }
+#endif
+    return NPT_SUCCESS;
+}
+
+/*----------------------------------------------------------------------
+|   BLT_Socket_MapError
++---------------------------------------------------------------------*/
+static NPT_Result
+BLT_Socket_MapError(int error, NPT_Result default_result)
+{
+    switch (error) {
+#if defined(_WIN32)
+        case WSAECONNRESET:   return NPT_ERROR_CONNECTION_RESET;
+        case WSAECONNABORTED: return NPT_ERROR_CONNECTION_ABORTED;
+        case WSAECONNREFUSED: return NPT_ERROR_CONNECTION_REFUSED;
+        case WSAETIMEDOUT:    return NPT_ERROR_TIMEOUT;
+        case WSAENETDOWN:     return NPT_ERROR_NETWORK_DOWN;
+        case WSAENETUNREACH:  return NPT_ERROR_NETWORK_UNREACHABLE;
+#else
+        case ECONNRESET:      return NPT_ERROR_CONNECTION_RESET;
+        case ECONNABORTED:    return NPT_ERROR_CONNECTION_ABORTED;
+        case ECONNREFUSED:    return NPT_ERROR_CONNECTION_REFUSED;
+        case ETIMEDOUT:       return NPT_ERROR_TIMEOUT;
+        case ENETDOWN:        return NPT_ERROR_NETWORK_DOWN;
+        case ENETUNREACH:     return NPT_ERROR_NETWORK_UNREACHABLE;
+        case EPIPE:           return NPT_ERROR_CONNECTION_RESET;
+#endif
+        default:              return default_result;
+    }
+}
+
+/*----------------------------------------------------------------------
+|   BLT_Socket_WaitUntilReady
+|
+|   Waits until a socket is readable (or writable), which includes the
+|   peer having closed the connection or an error being pending.
++---------------------------------------------------------------------*/
+static NPT_Result
+BLT_Socket_WaitUntilReady(BLT_SystemSocket fd, bool write, NPT_Timeout timeout)
+{
+    struct pollfd entry;
+    entry.fd      = fd;
+    entry.events  = write?POLLOUT:POLLIN;
+    entry.revents = 0;
+
+    for (;;) {
+        int io_result = BLT_Poll(&entry, 1, timeout);
+        if (io_result > 0) return NPT_SUCCESS;
+        if (io_result == 0) return NPT_ERROR_TIMEOUT;
+        if (BLT_GetSocketError() != BLT_SOCKET_ERROR_INTERRUPTED) {
+            return write?NPT_ERROR_WRITE_FAILED:NPT_ERROR_READ_FAILED;
+        }
+    }
+}
+
+/*----------------------------------------------------------------------
+|   BLT_Socket
+|
+|   Owner of a socket descriptor, shared by the input and output streams
+|   of a connection.
++---------------------------------------------------------------------*/
+class BLT_Socket {
+public:
+    BLT_Socket(BLT_SystemSocket fd, NPT_Timeout io_timeout) :
+        m_Fd(fd), m_IoTimeout(io_timeout) {}
+    ~BLT_Socket() { BLT_CloseSocket(m_Fd); }
+
+    // members
+    BLT_SystemSocket m_Fd;
+    NPT_Timeout      m_IoTimeout;
+};
+typedef NPT_Reference<BLT_Socket> BLT_SocketReference;
+
+/*----------------------------------------------------------------------
+|   BLT_SocketInputStream
++---------------------------------------------------------------------*/
+class BLT_SocketInputStream : public NPT_InputStream {
+public:
+    BLT_SocketInputStream(BLT_SocketReference& socket) :
+        m_Socket(socket), m_Position(0) {}
+
+    // NPT_InputStream methods
+    NPT_Result Read(void*     buffer,
+                    NPT_Size  bytes_to_read,
+                    NPT_Size* bytes_read = NULL);
+    NPT_Result Seek(NPT_Position)             { return NPT_ERROR_NOT_SUPPORTED; }
+    NPT_Result Tell(NPT_Position& where)      { where = m_Position; return NPT_SUCCESS; }
+    NPT_Result GetSize(NPT_LargeSize& size)   { size = 0; return NPT_ERROR_NOT_SUPPORTED; }
+    NPT_Result GetAvailable(NPT_LargeSize& available);
+
+private:
+    // members
+    BLT_SocketReference m_Socket;
+    NPT_Position        m_Position;
+};
+
+/*----------------------------------------------------------------------
+|   BLT_SocketInputStream::Read
++---------------------------------------------------------------------*/
+NPT_Result
+BLT_SocketInputStream::Read(void* buffer, NPT_Size bytes_to_read, NPT_Size* bytes_read)
+{
+    if (bytes_read) *bytes_read = 0;
+    if (bytes_to_read == 0) return NPT_SUCCESS;
+
+    // the socket is non-blocking, so wait for it to be readable first
+    for (;;) {
+        NPT_Result result = BLT_Socket_WaitUntilReady(m_Socket->m_Fd, false, m_Socket->m_IoTimeout);
+        if (NPT_FAILED(result)) return result;
+
+        int io_result = (int)recv(m_Socket->m_Fd, (char*)buffer, (int)bytes_to_read, 0);
+        if (io_result > 0) {
+            if (bytes_read) *bytes_read = (NPT_Size)io_result;
+            m_Position += io_result;
+            return NPT_SUCCESS;
+        }
+        if (io_result == 0) return NPT_ERROR_EOS;
+
+        int error = BLT_GetSocketError();
+        if (error != BLT_SOCKET_ERROR_WOULD_BLOCK && error != BLT_SOCKET_ERROR_INTERRUPTED) {
+            return BLT_Socket_MapError(error, NPT_ERROR_READ_FAILED);
+        }
+    }
+}
+
+/*----------------------------------------------------------------------
+|   BLT_SocketInputStream::GetAvailable
++---------------------------------------------------------------------*/
+NPT_Result
+BLT_SocketInputStream::GetAvailable(NPT_LargeSize& available)
+{
+    available = 0;
+#if defined(_WIN32)
+    u_long count = 0;
+    if (ioctlsocket(m_Socket->m_Fd, FIONREAD, &count) != 0) return NPT_ERROR_SOCKET_CONTROL_FAILED;
+#else
+    int count = 0;
+    if (ioctl(m_Socket->m_Fd, FIONREAD, &count) != 0) return NPT_ERROR_SOCKET_CONTROL_FAILED;
+#endif
+    available = (NPT_LargeSize)count;
+
+    return NPT_SUCCESS;
+}
+
+/*----------------------------------------------------------------------
+|   BLT_SocketOutputStream
++---------------------------------------------------------------------*/
+class BLT_SocketOutputStream : public NPT_OutputStream {
+public:
+    BLT_SocketOutputStream(BLT_SocketReference& socket) :
+        m_Socket(socket), m_Position(0) {}
+
+    // NPT_OutputStream methods
+    NPT_Result Write(const void* buffer,
+                     NPT_Size    bytes_to_write,
+                     NPT_Size*   bytes_written = NULL);
+    NPT_Result Seek(NPT_Position)        { return NPT_ERROR_NOT_SUPPORTED; }
+    NPT_Result Tell(NPT_Position& where) { where = m_Position; return NPT_SUCCESS; }
+
+private:
+    // members
+    BLT_SocketReference m_Socket;
+    NPT_Position        m_Position;
+};
+
+/*----------------------------------------------------------------------
+|   BLT_SocketOutputStream::Write
++---------------------------------------------------------------------*/
+NPT_Result
+BLT_SocketOutputStream::Write(const void* buffer, NPT_Size bytes_to_write, NPT_Size* bytes_written)
+{
+    if (bytes_written) *bytes_written = 0;
+    if (bytes_to_write == 0) return NPT_SUCCESS;
+
+    for (;;) {
+        NPT_Result result = BLT_Socket_WaitUntilReady(m_Socket->m_Fd, true, m_Socket->m_IoTimeout);
+        if (NPT_FAILED(result)) return result;
+
+        int io_result = (int)send(m_Socket->m_Fd, (const char*)buffer, (int)bytes_to_write, BLT_SOCKET_SEND_FLAGS);
+        if (io_result > 0) {
+            if (bytes_written) *bytes_written = (NPT_Size)io_result;
+            m_Position += io_result;
+            return NPT_SUCCESS;
+        }
+
+        int error = BLT_GetSocketError();
+        if (error != BLT_SOCKET_ERROR_WOULD_BLOCK && error != BLT_SOCKET_ERROR_INTERRUPTED) {
+            return BLT_Socket_MapError(error, NPT_ERROR_WRITE_FAILED);
+        }
+    }
+}
+
+/*----------------------------------------------------------------------
+|   BLT_TcpSocket_Connect
++---------------------------------------------------------------------*/
+NPT_Result
+BLT_TcpSocket_Connect(const NPT_SocketAddress&   address,
+                      NPT_Timeout                connect_timeout,
+                      NPT_Timeout                io_timeout,
+                      NPT_InputStreamReference&  input_stream,
+                      NPT_OutputStreamReference& output_stream,
+                      BLT_SocketFd&              fd)
+{
+    fd = BLT_SOCKET_FD_INVALID;
+
+    BLT_SystemSocket system_fd = socket(AF_INET, SOCK_STREAM, IPPROTO_TCP);
+#if defined(_WIN32)
+    if (system_fd == INVALID_SOCKET) return NPT_ERROR_SOCKET_FAILED;
+#else
+    if (system_fd < 0) return NPT_ERROR_SOCKET_FAILED;
+#endif
+    BLT_SocketReference owner(new BLT_Socket(system_fd, io_timeout));
+
+#if defined(SO_NOSIGPIPE)
+    int option = 1;
+    setsockopt(system_fd, SOL_SOCKET, SO_NOSIGPIPE, (const char*)&option, sizeof(option));
+#endif
+
+    // the socket stays non-blocking: reads and writes wait with poll
+    NPT_Result result = BLT_Socket_SetNonBlocking(system_fd);
+    if (NPT_FAILED(result)) return result;
+
+    struct sockaddr_in inet_address;
+    NPT_SetMemory(&inet_address, 0, sizeof(inet_address));
+    inet_address.sin_family      = AF_INET;
+    inet_address.sin_port        = htons(address.GetPort());
+    inet_address.sin_addr.s_addr = htonl(address.GetIpAddress().AsLong());
+    if (connect(system_fd, (struct sockaddr*)&inet_address, sizeof(inet_address)) != 0) {
+        int error = BLT_GetSocketError();
+        if (error != BLT_SOCKET_ERROR_IN_PROGRESS) {
+            return BLT_Socket_MapError(error, NPT_ERROR_CONNECTION_FAILED);
+        }
+        result = BLT_Socket_WaitUntilReady(system_fd, true, connect_timeout);
+        if (NPT_FAILED(result)) return result;
+
+        int                    connect_error = 0;
+        BLT_SystemSocketLength length = sizeof(connect_error);
+        if (getsockopt(system_fd, SOL_SOCKET, SO_ERROR, (char*)&connect_error, &length) != 0) {
+            return NPT_ERROR_GETOPT_FAILED;
+        }
+        if (connect_error) return BLT_Socket_MapError(connect_error, NPT_ERROR_CONNECTION_FAILED);
+    }
+
+    input_stream  = new BLT_SocketInputStream(owner);
+    output_stream = new BLT_SocketOutputStream(owner);
+    fd = (BLT_SocketFd)system_fd;
+
+    return NPT_SUCCESS;
+}
+
+/*----------------------------------------------------------------------
+|   BLT_SocketSelector::BLT_SocketSelector
++---------------------------------------------------------------------*/
+BLT_SocketSelector::BLT_SocketSelector() :
+    m_WakeUpFd(BLT_SOCKET_FD_INVALID)
+{
+    // WakeUp sends a datagram to a UDP socket connected to itself,
+    // which works with poll on every platform, unlike a pipe
+    BLT_SystemSocket fd = socket(AF_INET, SOCK_DGRAM, IPPROTO_UDP);
+#if defined(_WIN32)
+    if (fd == INVALID_SOCKET) return;
+#else
+    if (fd < 0) return;
+#endif
+    struct sockaddr_in     loopback;
+    BLT_SystemSocketLength length = sizeof(loopback);
+    NPT_SetMemory(&loopback, 0, sizeof(loopback));
+    loopback.sin_family      = AF_INET;
+    loopback.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+    if (bind(fd, (struct sockaddr*)&loopback, sizeof(loopback)) != 0                  ||
+        getsockname(fd, (struct sockaddr*)&loopback, &length) != 0                    ||
+        connect(fd, (struct sockaddr*)&loopback, sizeof(loopback)) != 0               ||
+        NPT_FAILED(BLT_Socket_SetNonBlocking(fd))) {
+        ATX_LOG_WARNING("failed to create the wake up socket");
+        BLT_CloseSocket(fd);
+        return;
+    }
+    m_WakeUpFd = (BLT_SocketFd)fd;
+}
+
+/*----------------------------------------------------------------------
+|   BLT_SocketSelector::~BLT_SocketSelector
++---------------------------------------------------------------------*/
+BLT_SocketSelector::~BLT_SocketSelector()
+{
+    if (m_WakeUpFd != BLT_SOCKET_FD_INVALID) {
+        BLT_CloseSocket((BLT_SystemSocket)m_WakeUpFd);
+    }
+}
+
+/*----------------------------------------------------------------------
+|   BLT_SocketSelector::Reset
++---------------------------------------------------------------------*/
+void
+BLT_SocketSelector::Reset()
+{
+    m_Fds.Clear();
+    m_Readable.Clear();
+}
+
+/*----------------------------------------------------------------------
+|   BLT_SocketSelector::Add
++---------------------------------------------------------------------*/
+void
+BLT_SocketSelector::Add(BLT_SocketFd fd)
+{
+    m_Fds.Add(fd);
+    m_Readable.Add(false);
+}
+
+/*----------------------------------------------------------------------
+|   BLT_SocketSelector::Wait
++---------------------------------------------------------------------*/
+NPT_Result
+BLT_SocketSelector::Wait(NPT_Timeout timeout)
+{
+    NPT_Cardinal   count = m_Fds.GetItemCount();
+    struct pollfd* fds   = new struct pollfd[count+1];
+    for (NPT_Ordinal i=0; i<count; i++) {
+        fds[i].fd      = (BLT_SystemSocket)m_Fds[i];
+        fds[i].events  = POLLIN;
+        fds[i].revents = 0;
+        m_Readable[i]  = false;
+    }
+    NPT_Cardinal total = count;
+    if (m_WakeUpFd != BLT_SOCKET_FD_INVALID) {
+        fds[total].fd      = (BLT_SystemSocket)m_WakeUpFd;
+        fds[total].events  = POLLIN;
+        fds[total].revents = 0;
+        ++total;
+    } else if (timeout < 0 || timeout > BLT_SOCKET_SELECTOR_MAX_WAIT_WITHOUT_WAKE_UP) {
+        // without a way to be woken up, don't sleep for long
+        timeout = BLT_SOCKET_SELECTOR_MAX_WAIT_WITHOUT_WAKE_UP;
+    }
+
+    NPT_Result result = NPT_SUCCESS;
+    if (total == 0) {
+        NPT_System::Sleep(NPT_TimeInterval((double)timeout/1000.0));
+        result = NPT_ERROR_TIMEOUT;
+    } else {
+        int io_result = BLT_Poll(fds, total, timeout);
+        if (io_result == 0) {
+            result = NPT_ERROR_TIMEOUT;
+        } else if (io_result < 0) {
+            result = BLT_GetSocketError() == BLT_SOCKET_ERROR_INTERRUPTED ?
+                     NPT_SUCCESS : NPT_ERROR_INTERNAL;
+        } else {
+            for (NPT_Ordinal i=0; i<count; i++) {
+                m_Readable[i] = fds[i].revents != 0;
+            }
+            if (total > count && fds[count].revents) {
+                // consume the wake up datagrams
+                char datagram[16];
+                while (recv((BLT_SystemSocket)m_WakeUpFd, datagram, sizeof(datagram), 0) > 0) {}
+            }
+        }
+    }
+    delete[] fds;
+
+    return result;
+}
+
+/*----------------------------------------------------------------------
+|   BLT_SocketSelector::IsReadable
++---------------------------------------------------------------------*/
+bool
+BLT_SocketSelector::IsReadable(BLT_SocketFd fd)
+{
+    for (NPT_Ordinal i=0; i<m_Fds.GetItemCount(); i++) {
+        if (m_Fds[i] == fd) return m_Readable[i];
+    }
+    return false;
+}
+
+/*----------------------------------------------------------------------
+|   BLT_SocketSelector::WakeUp
++---------------------------------------------------------------------*/
+void
+BLT_SocketSelector::WakeUp()
+{
+    if (m_WakeUpFd == BLT_SOCKET_FD_INVALID) return;
+    char datagram = 0;
+    send((BLT_SystemSocket)m_WakeUpFd, &datagram, 1, 0);
+}
@@ -0,0 +1,91 @@
+/*****************************************************************
+|
+|   BlueTune - Network Sockets
+|
+|   (c) 2002-2012 Gilles Boccon-Gibod
+|   Author: Gilles Boccon-Gibod (bok@bok.net)
+|
+****************************************************************/
+
+#ifndef _BLT_NETWORK_SOCKETS_H_
+#define _BLT_NETWORK_SOCKETS_H_
+
+/*----------------------------------------------------------------------
+|   includes
++---------------------------------------------------------------------*/
+#include "Neptune.h"
+
+/*----------------------------------------------------------------------
+|   types
++---------------------------------------------------------------------*/
+/**
+ * Descriptor of a socket, as used by the system (a file descriptor
+ * on POSIX systems, a SOCKET handle on Windows).
+ */
+typedef NPT_Int64 BLT_SocketFd;
+
+/*----------------------------------------------------------------------
+|   constants
++---------------------------------------------------------------------*/
+#define BLT_SOCKET_FD_INVALID ((BLT_SocketFd)-1)
+
+/*----------------------------------------------------------------------
+|   functions
++---------------------------------------------------------------------*/
+/**
+ * Open a TCP connection.
+ * Neptune sockets do not expose their descriptor, which is needed to
+ * wait for several connections at once, so the connections of the
+ * network input are made here.
+ * The streams own the socket, which is closed when both have been
+ * released. Reads and writes wait at most io_timeout for the socket
+ * to be ready.
+ */
+NPT_Result
+BLT_TcpSocket_Connect(const NPT_SocketAddress&   address,
+                      NPT_Timeout                connect_timeout,
+                      NPT_Timeout                io_timeout,
+                      NPT_InputStreamReference&  input_stream,
+                      NPT_OutputStreamReference& output_stream,
+                      BLT_SocketFd&              fd);
+
+/*----------------------------------------------------------------------
+|   BLT_SocketSelector
++---------------------------------------------------------------------*/
+/**
+ * Waits until at least one of a set of sockets is readable, or until
+ * another thread calls WakeUp.
+ */
+class BLT_SocketSelector {
+public:
+    BLT_SocketSelector();
+    ~BLT_SocketSelector();
+
+    /**
+     * Empty the set of sockets to wait for.
+     */
+    void       Reset();
+    void       Add(BLT_SocketFd fd);
+
+    /**
+     * Wait for one of the sockets to be readable (or to be closed by
+     * the peer, or to have an error), for WakeUp to be called, or for
+     * the timeout to expire.
+     */
+    NPT_Result Wait(NPT_Timeout timeout);
+    bool       IsReadable(BLT_SocketFd fd);
+
+    /**
+     * Make the current or next call to Wait return. May be called
+     * from any thread.
+     */
+    void       WakeUp();
+
+private:
+    // members
+    BLT_SocketFd            m_WakeUpFd;
+    NPT_Array<BLT_SocketFd> m_Fds;
+    NPT_Array<bool>         m_Readable;
+};
+
+#endif /* _BLT_NETWORK_SOCKETS_H_ */
@@ -14,6 +14,7 @@
 #include "BltNetworkStream.h"
 #include "BltNetworkInputSource.h"
 #include "BltErrors.h"
+#include "BltStream.h"
 
 /*----------------------------------------------------------------------
 |   types
@@ -41,6 +42,22 @@ struct BLT_NetworkStream {
     ATX_Size         min_buffer_fullness;
     ATX_Int64        last_connection;
     ATX_Int64        last_notification;
+    
+    /* adaptive sizing */
+    ATX_Size         min_buffer_size;
+    ATX_Size         max_buffer_size;
+    ATX_Size         buffer_target;
+    ATX_UInt32       byte_rate; /* of the media, 0 if not known yet */
+    
+    /* estimators (times in nanoseconds) */
+    ATX_Int64        window_start;
+    ATX_Int64        window_bytes;
+    ATX_Int64        last_arrival;
+    ATX_Int64        mean_gap;
+    ATX_Int64        jitter;
+    ATX_Int64        rtt;
+    ATX_Int64        connection_request;
+    ATX_UInt32       bandwidth; /* bytes per second */
 };
 
 /*----------------------------------------------------------------------
@@ -58,9 +75,27 @@ ATX_SET_LOCAL_LOGGER("bluetune.network.stream")
 #define BLT_NETWORK_STREAM_DEFAULT_SEEK_AS_READ_THRESHOLD 0     /* when seek is normal */ 
 #define BLT_NETWORK_STREAM_SLOW_SEEK_AS_READ_THRESHOLD    32768 /* when seek is slow   */
 
+#define BLT_NETWORK_STREAM_MAX_SEEK_AS_READ_THRESHOLD     1048576
+
 #define BLT_NETWORK_STREAM_NOTIFICATION_INTERVAL       1000000000    /* 1 second   */
 #define BLT_NETWORK_STREAM_RECONNECT_INTERVAL          10000000000LL /* 10 seconds */
 
+/**
+ * Bandwidth is measured over windows of at least this duration.
+ */
+#define BLT_NETWORK_STREAM_BANDWIDTH_WINDOW            500000000     /* 0.5 second */
+
+/**
+ * Gain of the moving averages used by the estimators (1/8).
+ */
+#define BLT_NETWORK_STREAM_ESTIMATOR_SHIFT             3
+
+/**
+ * Minimum amount of media, in milliseconds, that the buffer target 
+ * should cover on top of what is needed to ride out network delays.
+ */
+#define BLT_NETWORK_STREAM_MIN_COVER                   2000
+
 const ATX_InterfaceId ATX_INTERFACE_ID(BLT_BufferedNetworkStream) = {0x0202, 0x0001};
 
 /*----------------------------------------------------------------------
@@ -97,6 +132,7 @@ BLT_NetworkStream_Create(BLT_Size            buffer_size,
         return result;
     }
     (*stream)->buffer_size = buffer_size;
+    (*stream)->buffer_target = buffer_size;
     (*stream)->min_buffer_fullness = min_buffer_fullness;
     (*stream)->eos_cause = ATX_ERROR_EOS;
     (*stream)->source = source;
@@ -254,6 +290,10 @@ BLT_NetworkStream_GetProperty(ATX_Properties*    _self,
     BLT_NetworkStream* self = ATX_SELF(BLT_NetworkStream, ATX_Properties);
     
     if (self->source_properties && name != NULL &&
+        ATX_StringsEqual(name, BLT_NETWORK_STREAM_SOCKET_PROPERTY)) {
+        /* the socket, if any, belongs to the source */
+        return ATX_Properties_GetProperty(self->source_properties, name, value);
+    } else if (self->source_properties && name != NULL &&
         ATX_StringsEqual(name, ATX_INPUT_STREAM_PROPERTY_SEEK_SPEED)) {        
         /* ask the source if it has the seek speed property */
         if (ATX_FAILED(ATX_Properties_GetProperty(self->source_properties, name, value))) {
@@ -267,6 +307,213 @@ BLT_NetworkStream_GetProperty(ATX_Properties*    _self,
     }
 }
 
+/*----------------------------------------------------------------------
+|   BLT_NetworkStream_SetBufferBounds
++---------------------------------------------------------------------*/
+BLT_Result
+BLT_NetworkStream_SetBufferBounds(BLT_NetworkStream* self,
+                                  BLT_Size           min_size,
+                                  BLT_Size           max_size)
+{
+    if (min_size == 0 || max_size < min_size) return BLT_ERROR_INVALID_PARAMETERS;
+    self->min_buffer_size = min_size;
+    self->max_buffer_size = max_size;
+    
+    return BLT_SUCCESS;
+}
+
+/*----------------------------------------------------------------------
+|   BLT_NetworkStream_GetTime
++---------------------------------------------------------------------*/
+static ATX_Int64
+BLT_NetworkStream_GetTime(void)
+{
+    ATX_TimeStamp now;
+    ATX_Int64     now_int = 0;
+    
+    ATX_System_GetCurrentTimeStamp(&now);
+    ATX_TimeStamp_ToInt64(now, now_int);
+    
+    return now_int;
+}
+
+/*----------------------------------------------------------------------
+|   BLT_NetworkStream_UpdateByteRate
+|
+|   Called from Read, on the thread of the decoder that owns the stream
+|   context. The fill path may run on the thread of a network queue, so
+|   it only uses the value cached here.
++---------------------------------------------------------------------*/
+static void
+BLT_NetworkStream_UpdateByteRate(BLT_NetworkStream* self)
+{
+    BLT_StreamInfo info;
+    
+    if (self->context == NULL) return;
+    if (BLT_FAILED(BLT_Stream_GetInfo(self->context, &info))) return;
+    if (info.average_bitrate) {
+        self->byte_rate = info.average_bitrate/8;
+    } else {
+        self->byte_rate = info.nominal_bitrate/8;
+    }
+}
+
+/*----------------------------------------------------------------------
+|   BLT_NetworkStream_GetDelayCover
++---------------------------------------------------------------------*/
+static ATX_Int64
+BLT_NetworkStream_GetDelayCover(BLT_NetworkStream* self)
+{
+    /* time (ns) needed to get data flowing again after a stall */
+    return 2*self->rtt+4*self->jitter;
+}
+
+/*----------------------------------------------------------------------
+|   BLT_NetworkStream_ResizeBuffer
++---------------------------------------------------------------------*/
+static void
+BLT_NetworkStream_ResizeBuffer(BLT_NetworkStream* self, ATX_Size size)
+{
+    ATX_RingBuffer* buffer = NULL;
+    ATX_Size        available = ATX_RingBuffer_GetAvailable(self->buffer);
+    
+    /* don't drop any buffered data */
+    if (available > size) return;
+    
+    if (ATX_FAILED(ATX_RingBuffer_Create(size, &buffer))) return;
+    if (available) {
+        ATX_RingBuffer_Read(self->buffer, ATX_RingBuffer_GetIn(buffer), available);
+        ATX_RingBuffer_MoveIn(buffer, available);
+    }
+    ATX_RingBuffer_Destroy(self->buffer);
+    self->buffer = buffer;
+    
+    ATX_LOG_FINE_2("buffer resized from %d to %d", self->buffer_size, size);
+    self->buffer_size = size;
+    
+    if (self->context) {
+        ATX_Properties* properties = NULL;
+        BLT_Stream_GetProperties(self->context, &properties);
+        if (properties) {
+            ATX_PropertyValue value;
+            value.type = ATX_PROPERTY_VALUE_TYPE_INTEGER;
+            value.data.integer = self->buffer_size;
+            ATX_Properties_SetProperty(properties, BLT_NETWORK_STREAM_BUFFER_SIZE_PROPERTY, &value);
+        }
+    }
+}
+
+/*----------------------------------------------------------------------
+|   BLT_NetworkStream_Adapt
++---------------------------------------------------------------------*/
+static void
+BLT_NetworkStream_Adapt(BLT_NetworkStream* self)
+{
+    ATX_UInt32 byte_rate = self->byte_rate;
+    ATX_Int64  cover;
+    ATX_Int64  target;
+    
+    /* seeking by reading is worth it as long as it takes less time */
+    /* than getting the first byte after a new request              */
+    if (self->seek_as_read_threshold && self->bandwidth && self->rtt) {
+        ATX_Int64 threshold = ((ATX_Int64)self->bandwidth*self->rtt)/1000000000;
+        if (threshold < BLT_NETWORK_STREAM_SLOW_SEEK_AS_READ_THRESHOLD) {
+            threshold = BLT_NETWORK_STREAM_SLOW_SEEK_AS_READ_THRESHOLD;
+        } else if (threshold > BLT_NETWORK_STREAM_MAX_SEEK_AS_READ_THRESHOLD) {
+            threshold = BLT_NETWORK_STREAM_MAX_SEEK_AS_READ_THRESHOLD;
+        }
+        self->seek_as_read_threshold = (ATX_Size)threshold;
+    }
+    
+    /* nothing more to do unless adaptive sizing is enabled */
+    if (self->max_buffer_size <= self->min_buffer_size) return;
+    if (byte_rate == 0) return;
+    
+    /* compute how much media (in ms) we want to keep buffered: a minimum */
+    /* plus what it takes to recover from a stall, scaled up when the     */
+    /* network is barely faster than the stream                          */
+    cover = BLT_NETWORK_STREAM_MIN_COVER+BLT_NetworkStream_GetDelayCover(self)/1000000;
+    if (self->bandwidth && self->bandwidth < 2*byte_rate) {
+        ATX_Int64 scaled = (cover*2*byte_rate)/self->bandwidth;
+        cover = scaled > 4*cover ? 4*cover : scaled;
+    }
+    target = (cover*byte_rate)/1000;
+    if (target < (ATX_Int64)self->min_buffer_size) target = self->min_buffer_size;
+    if (target > (ATX_Int64)self->max_buffer_size) target = self->max_buffer_size;
+    self->buffer_target = (ATX_Size)target;
+    
+    /* resize when the target is far enough from the current size */
+    if (self->buffer_target > self->buffer_size+self->buffer_size/4 ||
+        self->buffer_target < self->buffer_size-self->buffer_size/4) {
+        BLT_NetworkStream_ResizeBuffer(self, self->buffer_target);
+    }
+}
+
+/*----------------------------------------------------------------------
+|   BLT_NetworkStream_UpdateEstimates
++---------------------------------------------------------------------*/
+static void
+BLT_NetworkStream_UpdateEstimates(BLT_NetworkStream* self, ATX_Size bytes_read)
+{
+    ATX_Int64 now = BLT_NetworkStream_GetTime();
+    
+    /* time to first byte after a (re)connection */
+    if (self->connection_request) {
+        ATX_Int64 sample = now-self->connection_request;
+        if (self->rtt) {
+            self->rtt += (sample-self->rtt)>>BLT_NETWORK_STREAM_ESTIMATOR_SHIFT;
+        } else {
+            self->rtt = sample;
+        }
+        self->connection_request = 0;
+        ATX_LOG_FINE_1("rtt = %d ms", (int)(self->rtt/1000000));
+    }
+    
+    /* inter-arrival jitter */
+    if (self->last_arrival) {
+        ATX_Int64 gap = now-self->last_arrival;
+        if (self->mean_gap) {
+            ATX_Int64 deviation = gap-self->mean_gap;
+            self->mean_gap += deviation>>BLT_NETWORK_STREAM_ESTIMATOR_SHIFT;
+            if (deviation < 0) deviation = -deviation;
+            self->jitter += (deviation-self->jitter)>>BLT_NETWORK_STREAM_ESTIMATOR_SHIFT;
+        } else {
+            self->mean_gap = gap;
+        }
+    }
+    self->last_arrival = now;
+    
+    /* throughput, measured over a window */
+    if (self->window_start == 0) {
+        /* the data we just got arrived before the window started */
+        self->window_start = now;
+        self->window_bytes = 0;
+    } else {
+        self->window_bytes += bytes_read;
+        if (now-self->window_start >= BLT_NETWORK_STREAM_BANDWIDTH_WINDOW) {
+            ATX_Int64 sample = (self->window_bytes*1000000000)/(now-self->window_start);
+            if (self->bandwidth) {
+                self->bandwidth = (ATX_UInt32)(self->bandwidth+((sample-(ATX_Int64)self->bandwidth)>>BLT_NETWORK_STREAM_ESTIMATOR_SHIFT));
+            } else {
+                self->bandwidth = (ATX_UInt32)sample;
+            }
+            self->window_start = now;
+            self->window_bytes = 0;
+            ATX_LOG_FINER_2("bandwidth = %d B/s, jitter = %d ms", 
+                            self->bandwidth, (int)(self->jitter/1000000));
+            
+            BLT_NetworkStream_Adapt(self);
+        }
+    }
+    
+    /* when the buffer is full, we stop reading: the time until the next */
+    /* read says nothing about the network                               */
+    if (ATX_RingBuffer_GetSpace(self->buffer) == 0) {
+        self->window_start = 0;
+        self->last_arrival = 0;
+    }
+}
+
 /*----------------------------------------------------------------------
 |   BLT_NetworkStream_FillBuffer
 +---------------------------------------------------------------------*/
@@ -292,6 +539,9 @@ BLT_NetworkStream_FillBuffer(BLT_NetworkStream* self)
         
         /* adjust the ring buffer */
         ATX_RingBuffer_MoveIn(self->buffer, read_from_source);
+        if (read_from_source) {
+            BLT_NetworkStream_UpdateEstimates(self, read_from_source);
+        }
         
         /* check if we've read everything there is to read */
         if (self->source_size && 
@@ -336,6 +586,15 @@ BLT_NetworkStream_CheckReconnection(BLT_NetworkStream* self)
     ATX_System_GetCurrentTimeStamp(&now);
     ATX_TimeStamp_ToInt64(now, now_int);
     
+    /* reconnect early enough for data to flow again before we run out */
+    if (self->eos_cause != ATX_ERROR_EOS && self->rtt) {
+        ATX_Int64 needed = (self->byte_rate*BLT_NetworkStream_GetDelayCover(self))/1000000000;
+        if ((ATX_Int64)buffered < needed) {
+            ATX_LOG_FINE_2("buffer low (%d, need %d), reconnecting", buffered, (int)needed);
+            buffered = 0;
+        }
+    }
+    
     /* decide what to do if the buffer is empty */
     if (buffered == 0 || now_int > self->last_connection+BLT_NETWORK_STREAM_RECONNECT_INTERVAL) {
         ATX_Position position = 0;
@@ -350,6 +609,7 @@ BLT_NetworkStream_CheckReconnection(BLT_NetworkStream* self)
         
         /* attempt to seek, it may reconnect to the source */
         self->last_connection = now_int;
+        self->connection_request = now_int;
         result = ATX_InputStream_Tell(self->source, &position);
         if (ATX_SUCCEEDED(result) && position) {
             ATX_LOG_FINE_1("attempting a reconnection by seeking to %lld", position);
@@ -448,6 +708,7 @@ BLT_NetworkStream_Read(ATX_InputStream* _self,
         if (now_int > next_update) {
             ATX_LOG_FINE("updating buffer status");
             self->last_notification = now_int;
+            BLT_NetworkStream_UpdateByteRate(self);
             if (self->context) {
                 ATX_Properties* properties = NULL;
                 BLT_Stream_GetProperties(self->context, &properties);
@@ -520,6 +781,9 @@ BLT_NetworkStream_Seek(ATX_InputStream* _self, ATX_Position position)
     } else {
         /* perform a real seek in the source */
         ATX_LOG_FINE_2("performing seek of %ld as input seek(%ld)", (long)move, (long)position);
+        self->connection_request = BLT_NetworkStream_GetTime();
+        self->window_start = 0;
+        self->last_arrival = 0;
         result = ATX_InputStream_Seek(self->source, position);
         if (ATX_FAILED(result)) return result;
         ATX_RingBuffer_Reset(self->buffer);
@@ -605,6 +869,10 @@ BLT_NetworkStream_GetStatus(BLT_BufferedNetworkStream*       _self,
 
     status->buffer_size     = self->buffer_size;
     status->buffer_fullness = ATX_RingBuffer_GetAvailable(self->buffer);
+    status->buffer_target   = self->buffer_target;
+    status->bandwidth       = self->bandwidth;
+    status->jitter          = (unsigned int)(self->jitter/1000000);
+    status->rtt             = (unsigned int)(self->rtt/1000000);
     if (self->eos) {
         status->end_of_stream = self->eos_cause;
     } else {
@@ -614,6 +882,23 @@ BLT_NetworkStream_GetStatus(BLT_BufferedNetworkStream*       _self,
     return BLT_SUCCESS;
 }
 
+/*----------------------------------------------------------------------
+|   BLT_NetworkStream_WaitAndFillBuffer
++---------------------------------------------------------------------*/
+BLT_METHOD
+BLT_NetworkStream_WaitAndFillBuffer(BLT_BufferedNetworkStream* _self)
+{
+    BLT_NetworkStream* self = ATX_SELF(BLT_NetworkStream, BLT_BufferedNetworkStream);
+    
+    if (self->eos || ATX_RingBuffer_GetSpace(self->buffer) == 0) return ATX_SUCCESS;
+    
+    /* the read waits until the source has something for us, or sees
+       that the connection was closed */
+    BLT_NetworkStream_FillBuffer(self);
+    
+    return ATX_SUCCESS;
+}
+
 /*----------------------------------------------------------------------
 |   GetInterface implementation
 +---------------------------------------------------------------------*/
@@ -649,7 +934,8 @@ ATX_END_INTERFACE_MAP
 +---------------------------------------------------------------------*/
 ATX_BEGIN_INTERFACE_MAP(BLT_NetworkStream, BLT_BufferedNetworkStream)
     BLT_NetworkStream_FillBuffer_,
-    BLT_NetworkStream_GetStatus
+    BLT_NetworkStream_GetStatus,
+    BLT_NetworkStream_WaitAndFillBuffer
 ATX_END_INTERFACE_MAP
 
 /*----------------------------------------------------------------------
@@ -684,4 +970,13 @@ BLT_BufferedNetworkStream_GetStatus(BLT_BufferedNetworkStream*       self,
     return ATX_INTERFACE(self)->GetStatus(self, status);
 }
 
+/*----------------------------------------------------------------------
+|   BLT_BufferedNetworkStream_WaitAndFillBuffer
++---------------------------------------------------------------------*/
+BLT_Result 
+BLT_BufferedNetworkStream_WaitAndFillBuffer(BLT_BufferedNetworkStream* self)
+{
+    return ATX_INTERFACE(self)->WaitAndFillBuffer(self);
+}
+
 
@@ -25,6 +25,14 @@ extern "C" {
 #define BLT_NETWORK_STREAM_BUFFER_SIZE_PROPERTY     "NetworkStream.BufferSize"
 #define BLT_NETWORK_STREAM_BUFFER_FULLNESS_PROPERTY "NetworkStream.BufferFullness"
 
+/**
+ * Integer property of a network stream (and of its source) with the
+ * descriptor of the socket that the source reads from, so that the
+ * stream can be waited for along with others. Not available when the
+ * source has no socket to wait for at the moment.
+ */
+#define BLT_NETWORK_STREAM_SOCKET_PROPERTY          "NetworkStream.Socket"
+
 /*----------------------------------------------------------------------
 |   types
 +---------------------------------------------------------------------*/
@@ -34,6 +42,10 @@ typedef struct {
     unsigned int buffer_size;
     unsigned int buffer_fullness;
     unsigned int end_of_stream;
+    unsigned int buffer_target; /* size the buffer is adapting to        */
+    unsigned int bandwidth;     /* bytes per second, 0 if not known yet  */
+    unsigned int jitter;        /* inter-arrival jitter in milliseconds  */
+    unsigned int rtt;           /* time to first byte after a (re)connection, in ms */
 } BLT_BufferedNetworkStreamStatus;
 
 /*----------------------------------------------------------------------
@@ -44,6 +56,7 @@ ATX_BEGIN_INTERFACE_DEFINITION(BLT_BufferedNetworkStream)
     BLT_Result (*FillBuffer)(BLT_BufferedNetworkStream* self);
     BLT_Result (*GetStatus)(BLT_BufferedNetworkStream*       self, 
                             BLT_BufferedNetworkStreamStatus* status);
+    BLT_Result (*WaitAndFillBuffer)(BLT_BufferedNetworkStream* self);
 ATX_END_INTERFACE_DEFINITION
 
 /*----------------------------------------------------------------------
@@ -56,12 +69,34 @@ BLT_Result
 BLT_BufferedNetworkStream_GetStatus(BLT_BufferedNetworkStream*       self, 
                                     BLT_BufferedNetworkStreamStatus* status);
 
+/**
+ * Read from the source into the buffer even if the source does not
+ * report any data as available, waiting for it if needed.
+ * Unlike BLT_BufferedNetworkStream_FillBuffer, this sees the end of a
+ * connection closed by the peer, so it is meant for callers that know
+ * the source is readable, for example because its socket
+ * (BLT_NETWORK_STREAM_SOCKET_PROPERTY) was reported readable.
+ * Returns immediately if the buffer is full or the stream has ended.
+ */
+BLT_Result 
+BLT_BufferedNetworkStream_WaitAndFillBuffer(BLT_BufferedNetworkStream* self);
+
 BLT_Result 
 BLT_NetworkStream_Create(BLT_Size            size,
                          BLT_Size            min_buffer_fullness,
                          ATX_InputStream*    source, 
                          BLT_NetworkStream** stream);
 
+/**
+ * Enable adaptive buffer sizing: the buffer is resized between min_size
+ * and max_size according to the stream bitrate and the measured network
+ * throughput, jitter and round-trip time.
+ */
+BLT_Result
+BLT_NetworkStream_SetBufferBounds(BLT_NetworkStream* self,
+                                  BLT_Size           min_size,
+                                  BLT_Size           max_size);
+
 ATX_InputStream*
 BLT_NetworkStream_GetInputStream(BLT_NetworkStream* self);
 
@@ -11,6 +11,10 @@
 |       includes
 +---------------------------------------------------------------------*/
 #include <alsa/asoundlib.h>
+#include <pthread.h>
+#include <sched.h>
+#include <errno.h>
+#include <time.h>
 
 #include "Atomix.h"
 #include "BltConfig.h"
@@ -22,6 +26,7 @@
 #include "BltCore.h"
 #include "BltPacketConsumer.h"
 #include "BltMediaPacket.h"
+#include "BltOutputBuffer.h"
 
 /*----------------------------------------------------------------------
 |   logging
@@ -44,6 +49,11 @@ ATX_DECLARE_INTERFACE_MAP(AlsaOutput, BLT_PacketConsumer)
 +---------------------------------------------------------------------*/
 #define BLT_ALSA_DEFAULT_BUFFER_TIME    500000 /* 0.5 secs */
 #define BLT_ALSA_DEFAULT_PERIOD_SIZE    4096
+#define BLT_ALSA_MIN_BUFFER_TIME        1000    /* 1 ms   */
+#define BLT_ALSA_MAX_BUFFER_TIME        2000000 /* 2 secs */
+
+/* SCHED_FIFO priority of the render thread, when the process may use it */
+#define BLT_ALSA_RENDER_THREAD_PRIORITY 20
 
 /*----------------------------------------------------------------------
 |    types
@@ -60,6 +70,26 @@ typedef enum {
     BLT_ALSA_OUTPUT_STATE_PREPARED
 } AlsaOutputState;
 
+typedef struct {
+    pthread_t            thread;
+    BLT_Boolean          running;  /* the thread was created        */
+    pthread_mutex_t      lock;
+    pthread_cond_t       data_cond;  /* signaled to the render thread */
+    BLT_Boolean          signaled;
+    volatile BLT_Boolean exiting;
+    volatile BLT_Boolean draining;
+    volatile BLT_Boolean paused;
+    volatile BLT_Boolean done;     /* the thread has returned       */
+
+    /* PCM FIFO, written by the node and read by the thread */
+    BLT_OutputBuffer*    buffer;
+
+    /* device settings */
+    snd_pcm_uframes_t    period_size;
+    snd_pcm_uframes_t    buffer_size;
+    snd_pcm_uframes_t    start_threshold;
+} AlsaOutputRenderer;
+
 typedef struct {
     /* base class */
     ATX_EXTENDS   (BLT_BaseMediaNode);
@@ -77,6 +107,12 @@ typedef struct {
     BLT_PcmMediaType media_type;
     ATX_UInt64       media_time;      /* media time of the last received packet       */
     ATX_UInt64       next_media_time; /* media time just pas the last received packet */
+    struct {
+        BLT_Boolean  mmap;
+        unsigned int buffer_time; /* us */
+        unsigned int period_time; /* us, 0 for BLT_ALSA_DEFAULT_PERIOD_SIZE */
+    } settings;
+    AlsaOutputRenderer renderer;
 } AlsaOutput;
 
 /*----------------------------------------------------------------------
@@ -124,6 +160,302 @@ AlsaOutput_SetState(AlsaOutput* self, AlsaOutputState state)
     return BLT_SUCCESS;
 }
 
+/*----------------------------------------------------------------------
+|    AlsaOutput_GetTime
++---------------------------------------------------------------------*/
+static ATX_Int64
+AlsaOutput_GetTime(void)
+{
+    ATX_TimeStamp now;
+    ATX_Int64     now_int = 0;
+
+    ATX_System_GetCurrentTimeStamp(&now);
+    ATX_TimeStamp_ToInt64(now, now_int);
+
+    return now_int;
+}
+
+/*----------------------------------------------------------------------
+|    AlsaOutput_SignalRenderer
++---------------------------------------------------------------------*/
+static void
+AlsaOutput_SignalRenderer(AlsaOutput* self)
+{
+    pthread_mutex_lock(&self->renderer.lock);
+    self->renderer.signaled = BLT_TRUE;
+    pthread_cond_signal(&self->renderer.data_cond);
+    pthread_mutex_unlock(&self->renderer.lock);
+}
+
+/*----------------------------------------------------------------------
+|    AlsaOutput_WaitForSignal
++---------------------------------------------------------------------*/
+static void
+AlsaOutput_WaitForSignal(AlsaOutput* self, unsigned int timeout /* ms */)
+{
+    struct timespec deadline;
+
+    /* the condition uses the monotonic clock, which does not jump */
+    /* when the system time is set                                */
+    clock_gettime(CLOCK_MONOTONIC, &deadline);
+    deadline.tv_sec  += timeout/1000;
+    deadline.tv_nsec += (timeout%1000)*1000000;
+    if (deadline.tv_nsec >= 1000000000) {
+        deadline.tv_sec  += 1;
+        deadline.tv_nsec -= 1000000000;
+    }
+
+    pthread_mutex_lock(&self->renderer.lock);
+    if (!self->renderer.signaled) {
+        pthread_cond_timedwait(&self->renderer.data_cond, &self->renderer.lock, &deadline);
+    }
+    self->renderer.signaled = BLT_FALSE;
+    pthread_mutex_unlock(&self->renderer.lock);
+}
+
+/*----------------------------------------------------------------------
+|    AlsaOutput_PublishDelay
++---------------------------------------------------------------------*/
+static void
+AlsaOutput_PublishDelay(AlsaOutput* self)
+{
+    snd_pcm_sframes_t delay = 0;
+    BLT_Boolean       running;
+
+    if (snd_pcm_delay(self->device_handle, &delay) != 0 || delay < 0) delay = 0;
+    running = (snd_pcm_state(self->device_handle) == SND_PCM_STATE_RUNNING);
+    BLT_OutputBuffer_SetDeviceDelay(self->renderer.buffer,
+                                    (BLT_Cardinal)delay,
+                                    AlsaOutput_GetTime(),
+                                    running);
+}
+
+/*----------------------------------------------------------------------
+|    AlsaOutput_Transfer
++---------------------------------------------------------------------*/
+static int
+AlsaOutput_Transfer(AlsaOutput* self, snd_pcm_uframes_t frame_count)
+{
+    while (frame_count) {
+        const snd_pcm_channel_area_t* areas;
+        snd_pcm_uframes_t             offset;
+        snd_pcm_uframes_t             chunk = frame_count;
+        snd_pcm_sframes_t             committed;
+        unsigned char*                destination;
+        int                           ior;
+
+        ior = snd_pcm_mmap_begin(self->device_handle, &areas, &offset, &chunk);
+        if (ior < 0) return ior;
+
+        /* with interleaved access, all the channels are in the first area */
+        destination = (unsigned char*)areas[0].addr+(areas[0].first+offset*areas[0].step)/8;
+        chunk = BLT_OutputBuffer_Read(self->renderer.buffer, destination, (BLT_Cardinal)chunk, BLT_FALSE);
+
+        committed = snd_pcm_mmap_commit(self->device_handle, offset, chunk);
+        if (committed < 0) return (int)committed;
+        if ((snd_pcm_uframes_t)committed != chunk) return -EPIPE;
+
+        frame_count -= chunk;
+    }
+
+    return 0;
+}
+
+/*----------------------------------------------------------------------
+|    AlsaOutput_RenderThread
++---------------------------------------------------------------------*/
+static void*
+AlsaOutput_RenderThread(void* arg)
+{
+    AlsaOutput*         self          = (AlsaOutput*)arg;
+    AlsaOutputRenderer* renderer      = &self->renderer;
+    snd_pcm_t*          pcm           = self->device_handle;
+    BLT_Boolean         device_paused = BLT_FALSE;
+    unsigned int        wait_time;
+    struct sched_param  param;
+
+    /* try to get a real time priority, and keep going without it */
+    ATX_SetMemory(&param, 0, sizeof(param));
+    param.sched_priority = BLT_ALSA_RENDER_THREAD_PRIORITY;
+    if (pthread_setschedparam(pthread_self(), SCHED_FIFO, &param) != 0) {
+        ATX_LOG_FINE("render thread running without real time priority");
+    }
+
+    /* never sleep for more than two periods */
+    wait_time = (unsigned int)((2000*renderer->period_size)/self->media_type.sample_rate);
+    if (wait_time < 10) wait_time = 10;
+
+    while (!renderer->exiting) {
+        BLT_Cardinal      queued;
+        snd_pcm_sframes_t avail;
+        int               ior;
+
+        /* follow the pause requests */
+        if (renderer->paused != device_paused) {
+            device_paused = renderer->paused;
+            snd_pcm_pause(pcm, device_paused?1:0);
+            AlsaOutput_PublishDelay(self);
+        }
+        if (device_paused) {
+            AlsaOutput_WaitForSignal(self, wait_time);
+            continue;
+        }
+
+        queued = BLT_OutputBuffer_GetFill(renderer->buffer);
+        if (queued == 0) {
+            if (renderer->draining) {
+                /* everything was written, let the device play it out */
+                ATX_LOG_FINER("snd_pcm_drain");
+                snd_pcm_drain(pcm);
+                break;
+            }
+            AlsaOutput_WaitForSignal(self, wait_time);
+            continue;
+        }
+
+        /* see how much the device can take */
+        avail = snd_pcm_avail_update(pcm);
+        if (avail < 0) {
+            ATX_LOG_FINE_1("**** UNDERRUN (%d) *****", (int)avail);
+            if (avail == -EPIPE) BLT_OutputBuffer_ReportUnderrun(renderer->buffer, 0);
+            if (snd_pcm_recover(pcm, (int)avail, 1) < 0) break;
+            continue;
+        }
+        if ((snd_pcm_uframes_t)avail < renderer->period_size && (BLT_Cardinal)avail < queued) {
+            /* the device buffer is full: start the device if it is */
+            /* not running yet, or wait until it has played a period */
+            if (snd_pcm_state(pcm) == SND_PCM_STATE_PREPARED) {
+                ior = snd_pcm_start(pcm);
+            } else {
+                ior = snd_pcm_wait(pcm, (int)wait_time);
+            }
+            if (ior < 0 && snd_pcm_recover(pcm, ior, 1) < 0) break;
+            continue;
+        }
+
+        /* copy the samples to the device buffer */
+        ior = AlsaOutput_Transfer(self, (BLT_Cardinal)avail < queued ? (snd_pcm_uframes_t)avail : queued);
+        if (ior < 0) {
+            ATX_LOG_FINE_1("**** TRANSFER FAILED (%d) *****", ior);
+            if (ior == -EPIPE) BLT_OutputBuffer_ReportUnderrun(renderer->buffer, 0);
+            if (snd_pcm_recover(pcm, ior, 1) < 0) break;
+            continue;
+        }
+
+        /* start the device once it has enough samples */
+        if (snd_pcm_state(pcm) == SND_PCM_STATE_PREPARED) {
+            avail = snd_pcm_avail_update(pcm);
+            if (renderer->draining ||
+                (avail >= 0 &&
+                 renderer->buffer_size-(snd_pcm_uframes_t)avail >= renderer->start_threshold)) {
+                snd_pcm_start(pcm);
+            }
+        }
+
+        AlsaOutput_PublishDelay(self);
+    }
+
+    /* the writer stops waiting for room */
+    renderer->done = BLT_TRUE;
+
+    return NULL;
+}
+
+/*----------------------------------------------------------------------
+|    AlsaOutput_StartRenderer
++---------------------------------------------------------------------*/
+static BLT_Result
+AlsaOutput_StartRenderer(AlsaOutput* self)
+{
+    AlsaOutputRenderer* renderer = &self->renderer;
+
+    if (renderer->running) return BLT_SUCCESS;
+
+    BLT_OutputBuffer_Reset(renderer->buffer);
+    renderer->signaled = BLT_FALSE;
+    renderer->exiting  = BLT_FALSE;
+    renderer->draining = BLT_FALSE;
+    renderer->paused   = BLT_FALSE;
+    renderer->done     = BLT_FALSE;
+    if (pthread_create(&renderer->thread, NULL, AlsaOutput_RenderThread, self) != 0) {
+        ATX_LOG_WARNING("failed to create the render thread");
+        return BLT_FAILURE;
+    }
+    renderer->running = BLT_TRUE;
+
+    return BLT_SUCCESS;
+}
+
+/*----------------------------------------------------------------------
+|    AlsaOutput_StopRenderer
++---------------------------------------------------------------------*/
+static void
+AlsaOutput_StopRenderer(AlsaOutput* self, BLT_Boolean drain)
+{
+    AlsaOutputRenderer* renderer = &self->renderer;
+
+    if (!renderer->running) return;
+
+    /* when draining, the thread exits once it has played the FIFO out */
+    if (drain) BLT_OutputBuffer_SetDraining(renderer->buffer);
+    pthread_mutex_lock(&renderer->lock);
+    if (drain) {
+        renderer->draining = BLT_TRUE;
+        renderer->paused   = BLT_FALSE;
+    } else {
+        renderer->exiting = BLT_TRUE;
+    }
+    renderer->signaled = BLT_TRUE;
+    pthread_cond_signal(&renderer->data_cond);
+    pthread_mutex_unlock(&renderer->lock);
+
+    pthread_join(renderer->thread, NULL);
+    renderer->running = BLT_FALSE;
+}
+
+/*----------------------------------------------------------------------
+|    AlsaOutput_WriteFifo
++---------------------------------------------------------------------*/
+static BLT_Result
+AlsaOutput_WriteFifo(AlsaOutput* self, const unsigned char* buffer, BLT_Size size)
+{
+    AlsaOutputRenderer* renderer    = &self->renderer;
+    BLT_Cardinal        capacity    = BLT_OutputBuffer_GetCapacity(renderer->buffer);
+    BLT_Size            frame_size  = self->media_type.channel_count*self->media_type.bits_per_sample/8;
+    BLT_Cardinal        frame_count = size/frame_size;
+    ATX_TimeInterval    wait;
+
+    /* the render thread runs with a real time priority, so it never */
+    /* takes the lock to say that there is room: poll for it, half a */
+    /* period at a time                                              */
+    wait.seconds     = 0;
+    wait.nanoseconds = (ATX_Int32)(((ATX_UInt64)renderer->period_size*500000000)/self->media_type.sample_rate);
+    if (wait.nanoseconds < 1000000)     wait.nanoseconds = 1000000;
+    if (wait.nanoseconds >= 1000000000) wait.nanoseconds = 999999999;
+
+    while (frame_count) {
+        BLT_Cardinal chunk = BLT_OutputBuffer_Write(renderer->buffer, buffer, frame_count);
+        if (chunk) {
+            /* let the render thread know that there are new samples */
+            AlsaOutput_SignalRenderer(self);
+            buffer      += chunk*frame_size;
+            frame_count -= chunk;
+            continue;
+        }
+
+        /* wait for the render thread to make room */
+        while (!renderer->done && BLT_OutputBuffer_GetFill(renderer->buffer) == capacity) {
+            ATX_System_Sleep(&wait);
+        }
+        if (renderer->done) {
+            ATX_LOG_WARNING("the render thread has stopped");
+            return BLT_FAILURE;
+        }
+    }
+
+    return BLT_SUCCESS;
+}
+
 /*----------------------------------------------------------------------
 |    AlsaOutput_Open
 +---------------------------------------------------------------------*/
@@ -177,8 +509,12 @@ AlsaOutput_Close(AlsaOutput* self)
 
       case BLT_ALSA_OUTPUT_STATE_PREPARED:
         /* wait for buffers to finish */
-        ATX_LOG_FINER("snd_pcm_drain");
-        snd_pcm_drain(self->device_handle);
+        if (self->renderer.running) {
+            AlsaOutput_StopRenderer(self, BLT_TRUE);
+        } else {
+            ATX_LOG_FINER("snd_pcm_drain");
+            snd_pcm_drain(self->device_handle);
+        }
         /* FALLTHROUGH */
 
       case BLT_ALSA_OUTPUT_STATE_OPEN:
@@ -213,8 +549,15 @@ AlsaOutput_Drain(AlsaOutput* self)
 
       case BLT_ALSA_OUTPUT_STATE_PREPARED:
         /* drain samples buffered by the driver (wait until they are played) */
-        ATX_LOG_FINER("snd_pcm_drain");
-        snd_pcm_drain(self->device_handle);
+        if (self->renderer.running) {
+            /* the render thread drains the FIFO and the device before */
+            /* it exits, and the device must be prepared again after   */
+            AlsaOutput_StopRenderer(self, BLT_TRUE);
+            AlsaOutput_SetState(self, BLT_ALSA_OUTPUT_STATE_CONFIGURED);
+        } else {
+            ATX_LOG_FINER("snd_pcm_drain");
+            snd_pcm_drain(self->device_handle);
+        }
         break;
     }
 
@@ -237,6 +580,7 @@ AlsaOutput_Reset(AlsaOutput* self)
         return BLT_SUCCESS;
 
       case BLT_ALSA_OUTPUT_STATE_PREPARED:
+        AlsaOutput_StopRenderer(self, BLT_FALSE);
         ATX_LOG_FINER("snd_pcm_drop");
         snd_pcm_drop(self->device_handle);
         AlsaOutput_SetState(self, BLT_ALSA_OUTPUT_STATE_CONFIGURED);
@@ -269,6 +613,12 @@ AlsaOutput_Prepare(AlsaOutput* self)
             ATX_LOG_FINER_2("snd_pcm_prepare() failed (%d : %s)", ior, snd_strerror(ior));
             return BLT_FAILURE;
         }
+
+        /* in mmap mode, the samples are fed to the device by the render thread */
+        if (self->settings.mmap) {
+            BLT_Result result = AlsaOutput_StartRenderer(self);
+            if (BLT_FAILED(result)) return result;
+        }
         break;
 
       case BLT_ALSA_OUTPUT_STATE_PREPARED:
@@ -322,7 +672,8 @@ AlsaOutput_Configure(AlsaOutput*             self,
     snd_pcm_hw_params_t* hw_params;
     snd_pcm_sw_params_t* sw_params;
     unsigned int         rate = format->sample_rate;
-    unsigned int         buffer_time = BLT_ALSA_DEFAULT_BUFFER_TIME;
+    unsigned int         buffer_time = self->settings.buffer_time;
+    unsigned int         period_time = self->settings.period_time;
     snd_pcm_uframes_t    buffer_size = 0;
     snd_pcm_uframes_t    period_size = BLT_ALSA_DEFAULT_PERIOD_SIZE;
     snd_pcm_format_t     pcm_format_id = SND_PCM_FORMAT_UNKNOWN;
@@ -378,8 +729,10 @@ AlsaOutput_Configure(AlsaOutput*             self,
         snd_pcm_hw_params_alloca_no_assert(&hw_params);
         snd_pcm_hw_params_any(self->device_handle, hw_params);
 
-        /* use interleaved access */
+        /* use interleaved access, through the mmap'ed device buffer if required */
         ior = snd_pcm_hw_params_set_access(self->device_handle, hw_params, 
+                                           self->settings.mmap ?
+                                           SND_PCM_ACCESS_MMAP_INTERLEAVED :
                                            SND_PCM_ACCESS_RW_INTERLEAVED);
         if (ior != 0) {
             ATX_LOG_WARNING_2("snd_pcm_hw_params_set_access failed (%d:%s)", ior, snd_strerror(ior));
@@ -473,13 +826,24 @@ AlsaOutput_Configure(AlsaOutput*             self,
         }
 
         /* set the period size */
-        ior = snd_pcm_hw_params_set_period_size_near(self->device_handle, 
-                                                     hw_params,
-                                                     &period_size,
-                                                     NULL);
-        if (ior != 0) {
-            ATX_LOG_WARNING_2("snd_pcm_hw_params_set_period_size_near() failed (%d:%s)", ior, snd_strerror(ior));
-            return BLT_FAILURE;
+        if (period_time) {
+            ior = snd_pcm_hw_params_set_period_time_near(self->device_handle, 
+                                                         hw_params,
+                                                         &period_time,
+                                                         NULL);
+            if (ior != 0) {
+                ATX_LOG_WARNING_2("snd_pcm_hw_params_set_period_time_near() failed (%d:%s)", ior, snd_strerror(ior));
+                return BLT_FAILURE;
+            }
+        } else {
+            ior = snd_pcm_hw_params_set_period_size_near(self->device_handle, 
+                                                         hw_params,
+                                                         &period_size,
+                                                         NULL);
+            if (ior != 0) {
+                ATX_LOG_WARNING_2("snd_pcm_hw_params_set_period_size_near() failed (%d:%s)", ior, snd_strerror(ior));
+                return BLT_FAILURE;
+            }
         }
         
                                                 
@@ -502,6 +866,7 @@ AlsaOutput_Configure(AlsaOutput*             self,
             ATX_LOG_WARNING_2("snd_pcm_hw_params() failed (%d:%s)", ior, snd_strerror(ior));
             return BLT_FAILURE;
         }
+        snd_pcm_hw_params_get_period_size(hw_params, &period_size, NULL);
 
         /* configure the software parameters */
         snd_pcm_sw_params_alloca_no_assert(&sw_params);
@@ -512,6 +877,13 @@ AlsaOutput_Configure(AlsaOutput*             self,
                                               sw_params, 
                                               buffer_size/2);
 
+        /* wake up the render thread once a period has been played */
+        if (self->settings.mmap) {
+            snd_pcm_sw_params_set_avail_min(self->device_handle, 
+                                            sw_params, 
+                                            period_size);
+        }
+
         /* set the buffer alignment */
         /* NOTE: this call is now obsolete */
         /* snd_pcm_sw_params_set_xfer_align(self->device_handle, sw_params, 1); */
@@ -523,6 +895,27 @@ AlsaOutput_Configure(AlsaOutput*             self,
             return BLT_FAILURE;
         }
 
+        /* the FIFO between the node and the render thread holds */
+        /* as many samples as the device buffer                  */
+        if (self->settings.mmap) {
+            AlsaOutputRenderer* renderer = &self->renderer;
+
+            renderer->period_size     = period_size;
+            renderer->buffer_size     = buffer_size;
+            renderer->start_threshold = buffer_size/2;
+            if (renderer->buffer &&
+                BLT_OutputBuffer_GetCapacity(renderer->buffer) < buffer_size) {
+                BLT_OutputBuffer_Destroy(renderer->buffer);
+                renderer->buffer = NULL;
+            }
+            if (renderer->buffer == NULL) {
+                result = BLT_OutputBuffer_Create((BLT_Cardinal)buffer_size, 0, &renderer->buffer);
+                if (BLT_FAILED(result)) return result;
+            }
+            result = BLT_OutputBuffer_SetFormat(renderer->buffer, format);
+            if (BLT_FAILED(result)) return result;
+        }
+
         /* print status info */
         {
             snd_pcm_uframes_t val;
@@ -565,6 +958,11 @@ AlsaOutput_Write(AlsaOutput* self, void* buffer, BLT_Size size)
     result = AlsaOutput_Prepare(self);
     if (BLT_FAILED(result)) return result;
 
+    /* in mmap mode, the render thread does the actual writing */
+    if (self->renderer.running) {
+        return AlsaOutput_WriteFifo(self, (const unsigned char*)buffer, size);
+    }
+
     /* compute the number of samples */
     sample_size  = self->media_type.channel_count*self->media_type.bits_per_sample/8;
     sample_count = size / sample_size;
@@ -678,6 +1076,10 @@ AlsaOutput_PutPacket(BLT_PacketConsumer* _self,
             self->media_time = ts_nanos;
         }
         self->next_media_time = self->media_time+BLT_TimeStamp_ToNanos(packet_duration);
+        if (self->renderer.buffer) {
+            BLT_OutputBuffer_SetMediaTime(self->renderer.buffer, 
+                                          BLT_TimeStamp_FromNanos(self->media_time));
+        }
     }
     
     /* write the audio samples */
@@ -716,6 +1118,7 @@ AlsaOutput_Create(BLT_Module*              module,
     AlsaOutput*               output;
     BLT_MediaNodeConstructor* constructor = 
         (BLT_MediaNodeConstructor*)parameters;
+    pthread_condattr_t        cond_attributes;
 
     ATX_LOG_FINE("creating output");
 
@@ -741,6 +1144,14 @@ AlsaOutput_Create(BLT_Module*              module,
     output->media_type.sample_rate     = 0;
     output->media_type.channel_count   = 0;
     output->media_type.bits_per_sample = 0;
+    output->settings.mmap              = BLT_FALSE;
+    output->settings.buffer_time       = BLT_ALSA_DEFAULT_BUFFER_TIME;
+    output->settings.period_time       = 0;
+    pthread_mutex_init(&output->renderer.lock, NULL);
+    pthread_condattr_init(&cond_attributes);
+    pthread_condattr_setclock(&cond_attributes, CLOCK_MONOTONIC);
+    pthread_cond_init(&output->renderer.data_cond, &cond_attributes);
+    pthread_condattr_destroy(&cond_attributes);
 
     /* parse the name */
     if (constructor->name && ATX_StringLength(constructor->name) > 5) {
@@ -777,6 +1188,11 @@ AlsaOutput_Destroy(AlsaOutput* self)
     /* free the name */
     ATX_String_Destruct(&self->device_name);
 
+    /* free the render thread resources */
+    if (self->renderer.buffer) BLT_OutputBuffer_Destroy(self->renderer.buffer);
+    pthread_cond_destroy(&self->renderer.data_cond);
+    pthread_mutex_destroy(&self->renderer.lock);
+
     /* destruct the inherited object */
     BLT_BaseMediaNode_Destruct(&ATX_BASE(self, BLT_BaseMediaNode));
 
@@ -792,11 +1208,42 @@ AlsaOutput_Destroy(AlsaOutput* self)
 BLT_METHOD
 AlsaOutput_Activate(BLT_MediaNode* _self, BLT_Stream* stream)
 {
-    AlsaOutput* self = ATX_SELF_EX(AlsaOutput, BLT_BaseMediaNode, BLT_MediaNode);
+    AlsaOutput*     self = ATX_SELF_EX(AlsaOutput, BLT_BaseMediaNode, BLT_MediaNode);
+    ATX_Properties* properties;
     BLT_COMPILER_UNUSED(stream);
         
     ATX_LOG_FINER("activating output");
 
+    /* read the device settings, they apply the next time the device is configured */
+    if (BLT_SUCCEEDED(BLT_Core_GetProperties(ATX_BASE(self, BLT_BaseMediaNode).core, &properties))) {
+        ATX_PropertyValue property;
+        if (ATX_SUCCEEDED(ATX_Properties_GetProperty(properties,
+                                                     BLT_ALSA_OUTPUT_MMAP,
+                                                     &property)) &&
+            property.type == ATX_PROPERTY_VALUE_TYPE_INTEGER) {
+            self->settings.mmap = property.data.integer?BLT_TRUE:BLT_FALSE;
+        }
+        if (ATX_SUCCEEDED(ATX_Properties_GetProperty(properties,
+                                                     BLT_ALSA_OUTPUT_BUFFER_TIME,
+                                                     &property)) &&
+            property.type == ATX_PROPERTY_VALUE_TYPE_INTEGER) {
+            if (property.data.integer < BLT_ALSA_MIN_BUFFER_TIME) {
+                self->settings.buffer_time = BLT_ALSA_MIN_BUFFER_TIME;
+            } else if (property.data.integer > BLT_ALSA_MAX_BUFFER_TIME) {
+                self->settings.buffer_time = BLT_ALSA_MAX_BUFFER_TIME;
+            } else {
+                self->settings.buffer_time = (unsigned int)property.data.integer;
+            }
+        }
+        if (ATX_SUCCEEDED(ATX_Properties_GetProperty(properties,
+                                                     BLT_ALSA_OUTPUT_PERIOD_TIME,
+                                                     &property)) &&
+            property.type == ATX_PROPERTY_VALUE_TYPE_INTEGER &&
+            property.data.integer >= 0) {
+            self->settings.period_time = (unsigned int)property.data.integer;
+        }
+    }
+
     /* open the device */
     AlsaOutput_Open(self);
 
@@ -848,7 +1295,12 @@ AlsaOutput_Pause(BLT_MediaNode* _self)
     /* pause the device */
     switch (self->state) {
       case BLT_ALSA_OUTPUT_STATE_PREPARED:
-        snd_pcm_pause(self->device_handle, 1);
+        if (self->renderer.running) {
+            self->renderer.paused = BLT_TRUE;
+            AlsaOutput_SignalRenderer(self);
+        } else {
+            snd_pcm_pause(self->device_handle, 1);
+        }
         break;
 
       default:
@@ -872,7 +1324,12 @@ AlsaOutput_Resume(BLT_MediaNode* _self)
     /* pause the device */
     switch (self->state) {
       case BLT_ALSA_OUTPUT_STATE_PREPARED:
-        snd_pcm_pause(self->device_handle, 0);
+        if (self->renderer.running) {
+            self->renderer.paused = BLT_FALSE;
+            AlsaOutput_SignalRenderer(self);
+        } else {
+            snd_pcm_pause(self->device_handle, 0);
+        }
         break;
 
       default:
@@ -951,6 +1408,13 @@ AlsaOutput_GetStatus(BLT_OutputNode*       _self,
     status->media_time.nanoseconds = 0;
     status->flags = 0;
 
+    /* the device belongs to the render thread when there is one: the */
+    /* FIFO extrapolates from the last delay that the thread measured  */
+    if (self->renderer.running) {
+        BLT_OutputBuffer_GetStatus(self->renderer.buffer, AlsaOutput_GetTime(), status);
+        return BLT_SUCCESS;
+    }
+
     /* get the driver status */
     snd_pcm_status_alloca_no_assert(&pcm_status);
     io_result = snd_pcm_status(self->device_handle, pcm_status);
@@ -22,6 +22,11 @@
  * This module responds to probe with the name:
  * 'alsa:<name>'
  * where <name> is the name of an ALSA output.
+ * By default, samples are written to the device with snd_pcm_writei.
+ * When the BLT_ALSA_OUTPUT_MMAP core property is set, the node instead
+ * queues them in a FIFO, and a render thread copies them into the
+ * mmap'ed device buffer as the device plays, so that decoding never
+ * stalls the device.
  * @{ 
  */
 
@@ -31,6 +36,26 @@
 #include "BltTypes.h"
 #include "BltModule.h"
 
+/*----------------------------------------------------------------------
+|       constants
++---------------------------------------------------------------------*/
+/**
+ * Core property: use mmap access and a render thread (integer,
+ * non-zero to enable).
+ */
+#define BLT_ALSA_OUTPUT_MMAP        "Plugins.AlsaOutput.Mmap"
+
+/**
+ * Core property: duration of the device buffer (integer, microseconds).
+ */
+#define BLT_ALSA_OUTPUT_BUFFER_TIME "Plugins.AlsaOutput.BufferTime"
+
+/**
+ * Core property: duration of a device period (integer, microseconds).
+ * When not set, the period is 4096 frames.
+ */
+#define BLT_ALSA_OUTPUT_PERIOD_TIME "Plugins.AlsaOutput.PeriodTime"
+
 /*----------------------------------------------------------------------
 |       module
 +---------------------------------------------------------------------*/
@@ -10,6 +10,13 @@
 /*----------------------------------------------------------------------
 |   includes
 +---------------------------------------------------------------------*/
+#if defined(_WIN32)
+#include <windows.h>
+#else
+#include <pthread.h>
+#include <sys/time.h>
+#endif
+
 #include "Atomix.h"
 #include "BltConfig.h"
 #include "BltCallbackOutput.h"
@@ -24,6 +31,43 @@
 +---------------------------------------------------------------------*/
 ATX_SET_LOCAL_LOGGER("bluetune.plugins.outputs.callback")
 
+/*----------------------------------------------------------------------
+|   interface constants
++---------------------------------------------------------------------*/
+const ATX_InterfaceId ATX_INTERFACE_ID(BLT_PacketLender)   = {0x0203, 0x0001};
+const ATX_InterfaceId ATX_INTERFACE_ID(BLT_PacketBorrower) = {0x0204, 0x0001};
+
+/*----------------------------------------------------------------------
+|   constants
++---------------------------------------------------------------------*/
+#define BLT_CALLBACK_OUTPUT_MAX_MAX_LENT_PACKETS 1024
+#define BLT_CALLBACK_OUTPUT_WAIT_FOREVER         ((BLT_Cardinal)(-1))
+
+/*----------------------------------------------------------------------
+|   locks and conditions
++---------------------------------------------------------------------*/
+#if defined(_WIN32)
+typedef CRITICAL_SECTION   CallbackOutputLock;
+typedef CONDITION_VARIABLE CallbackOutputCondition;
+#define CallbackOutputLock_Init(lock)         InitializeCriticalSection(lock)
+#define CallbackOutputLock_Destroy(lock)      DeleteCriticalSection(lock)
+#define CallbackOutputLock_Lock(lock)         EnterCriticalSection(lock)
+#define CallbackOutputLock_Unlock(lock)       LeaveCriticalSection(lock)
+#define CallbackOutputCondition_Init(cond)    InitializeConditionVariable(cond)
+#define CallbackOutputCondition_Destroy(cond)
+#define CallbackOutputCondition_Signal(cond)  WakeAllConditionVariable(cond)
+#else
+typedef pthread_mutex_t CallbackOutputLock;
+typedef pthread_cond_t  CallbackOutputCondition;
+#define CallbackOutputLock_Init(lock)         pthread_mutex_init(lock, NULL)
+#define CallbackOutputLock_Destroy(lock)      pthread_mutex_destroy(lock)
+#define CallbackOutputLock_Lock(lock)         pthread_mutex_lock(lock)
+#define CallbackOutputLock_Unlock(lock)       pthread_mutex_unlock(lock)
+#define CallbackOutputCondition_Init(cond)    pthread_cond_init(cond, NULL)
+#define CallbackOutputCondition_Destroy(cond) pthread_cond_destroy(cond)
+#define CallbackOutputCondition_Signal(cond)  pthread_cond_broadcast(cond)
+#endif
+
 /*----------------------------------------------------------------------
 |    types
 +---------------------------------------------------------------------*/
@@ -32,6 +76,24 @@ typedef struct {
     ATX_EXTENDS(BLT_BaseModule);
 } CallbackOutputModule;
 
+/* The lent packets. This is allocated on its own, because the borrower
+   may still return packets after the node is gone: it is freed by the
+   node, or by the last ReturnPacket once the node has let go of it. */
+typedef struct {
+    /* interfaces */
+    ATX_IMPLEMENTS(BLT_PacketLender);
+
+    /* members */
+    CallbackOutputLock      lock;
+    CallbackOutputCondition returned_condition; /* signaled by ReturnPacket */
+    BLT_MediaPacket**       packets;  /* NULL for free slots             */
+    BLT_Boolean*            returned; /* set by ReturnPacket, any thread */
+    BLT_MediaPacket**       released; /* scratch space                   */
+    BLT_Cardinal            count;
+    BLT_Cardinal            max_count;
+    BLT_Boolean             orphaned; /* the node is gone                */
+} CallbackOutputLender;
+
 typedef struct {
     /* base class */
     ATX_EXTENDS   (BLT_BaseMediaNode);
@@ -42,8 +104,10 @@ typedef struct {
     ATX_IMPLEMENTS(BLT_MediaPort);
 
     /* members */
-    BLT_MediaType*      expected_media_type;
-    BLT_PacketConsumer* callback_target;
+    BLT_MediaType*        expected_media_type;
+    BLT_PacketConsumer*   callback_target;
+    BLT_PacketBorrower*   borrower;
+    CallbackOutputLender* lender;
 } CallbackOutput;
 
 /*----------------------------------------------------------------------
@@ -56,6 +120,270 @@ ATX_DECLARE_INTERFACE_MAP(CallbackOutput, ATX_Referenceable)
 ATX_DECLARE_INTERFACE_MAP(CallbackOutput, BLT_OutputNode)
 ATX_DECLARE_INTERFACE_MAP(CallbackOutput, BLT_MediaPort)
 ATX_DECLARE_INTERFACE_MAP(CallbackOutput, BLT_PacketConsumer)
+ATX_DECLARE_INTERFACE_MAP(CallbackOutputLender, BLT_PacketLender)
+static BLT_Result CallbackOutput_Destroy(CallbackOutput* self);
+
+/*----------------------------------------------------------------------
+|    CallbackOutputLender_Create
++---------------------------------------------------------------------*/
+static BLT_Result
+CallbackOutputLender_Create(BLT_Cardinal max_count, CallbackOutputLender** lender)
+{
+    CallbackOutputLender* self = ATX_AllocateZeroMemory(sizeof(CallbackOutputLender));
+
+    *lender = NULL;
+    if (self == NULL) return BLT_ERROR_OUT_OF_MEMORY;
+
+    self->max_count = max_count;
+    self->packets   = ATX_AllocateZeroMemory(max_count*sizeof(BLT_MediaPacket*));
+    self->returned  = ATX_AllocateZeroMemory(max_count*sizeof(BLT_Boolean));
+    self->released  = ATX_AllocateZeroMemory(max_count*sizeof(BLT_MediaPacket*));
+    if (self->packets == NULL || self->returned == NULL || self->released == NULL) {
+        ATX_FreeMemory(self->packets);
+        ATX_FreeMemory(self->returned);
+        ATX_FreeMemory(self->released);
+        ATX_FreeMemory(self);
+        return BLT_ERROR_OUT_OF_MEMORY;
+    }
+    CallbackOutputLock_Init(&self->lock);
+    CallbackOutputCondition_Init(&self->returned_condition);
+    ATX_SET_INTERFACE(self, CallbackOutputLender, BLT_PacketLender);
+
+    *lender = self;
+    return BLT_SUCCESS;
+}
+
+/*----------------------------------------------------------------------
+|    CallbackOutputLender_Destroy
++---------------------------------------------------------------------*/
+static void
+CallbackOutputLender_Destroy(CallbackOutputLender* self)
+{
+    CallbackOutputCondition_Destroy(&self->returned_condition);
+    CallbackOutputLock_Destroy(&self->lock);
+    ATX_FreeMemory(self->packets);
+    ATX_FreeMemory(self->returned);
+    ATX_FreeMemory(self->released);
+    ATX_FreeMemory(self);
+}
+
+/*----------------------------------------------------------------------
+|    CallbackOutputLender_ReleaseReturnedPackets
+|
+|    Packet reference counts are only touched on the decoder thread, so
+|    the returned packets are released here rather than in ReturnPacket.
++---------------------------------------------------------------------*/
+static void
+CallbackOutputLender_ReleaseReturnedPackets(CallbackOutputLender* self)
+{
+    BLT_Cardinal released = 0;
+    BLT_Cardinal i;
+
+    CallbackOutputLock_Lock(&self->lock);
+    for (i=0; i<self->max_count; i++) {
+        if (self->packets[i] && self->returned[i]) {
+            self->released[released++] = self->packets[i];
+            self->packets[i]  = NULL;
+            self->returned[i] = BLT_FALSE;
+            --self->count;
+        }
+    }
+    CallbackOutputLock_Unlock(&self->lock);
+
+    for (i=0; i<released; i++) {
+        BLT_MediaPacket_Release(self->released[i]);
+    }
+}
+
+/*----------------------------------------------------------------------
+|    CallbackOutputLender_WaitForSignal
+|
+|    Waits, with the lock held, for ReturnPacket to be called or for
+|    'timeout' milliseconds to pass.
++---------------------------------------------------------------------*/
+static void
+CallbackOutputLender_WaitForSignal(CallbackOutputLender* self, BLT_Cardinal timeout)
+{
+#if defined(_WIN32)
+    SleepConditionVariableCS(&self->returned_condition, 
+                             &self->lock, 
+                             timeout == BLT_CALLBACK_OUTPUT_WAIT_FOREVER ? INFINITE : timeout);
+#else
+    struct timespec deadline;
+    struct timeval  now;
+
+    if (timeout == BLT_CALLBACK_OUTPUT_WAIT_FOREVER) {
+        pthread_cond_wait(&self->returned_condition, &self->lock);
+        return;
+    }
+
+    gettimeofday(&now, NULL);
+    deadline.tv_sec  = now.tv_sec+timeout/1000;
+    deadline.tv_nsec = now.tv_usec*1000+(timeout%1000)*1000000;
+    if (deadline.tv_nsec >= 1000000000) {
+        deadline.tv_sec  += 1;
+        deadline.tv_nsec -= 1000000000;
+    }
+    pthread_cond_timedwait(&self->returned_condition, &self->lock, &deadline);
+#endif
+}
+
+/*----------------------------------------------------------------------
+|    CallbackOutputLender_GetTime
++---------------------------------------------------------------------*/
+static ATX_Int64
+CallbackOutputLender_GetTime(void)
+{
+    ATX_TimeStamp now;
+    ATX_Int64     now_int = 0;
+
+    ATX_System_GetCurrentTimeStamp(&now);
+    ATX_TimeStamp_ToInt64(now, now_int);
+
+    return now_int;
+}
+
+/*----------------------------------------------------------------------
+|    CallbackOutputLender_WaitForReturns
+|
+|    Waits until at most max_count packets are lent, or for 'timeout'
+|    milliseconds.
++---------------------------------------------------------------------*/
+static BLT_Result
+CallbackOutputLender_WaitForReturns(CallbackOutputLender* self, 
+                                    BLT_Cardinal          max_count, 
+                                    BLT_Cardinal          timeout)
+{
+    ATX_Int64  deadline = 0; /* nanoseconds */
+    BLT_Result result   = BLT_SUCCESS;
+
+    if (timeout != BLT_CALLBACK_OUTPUT_WAIT_FOREVER) {
+        deadline = CallbackOutputLender_GetTime()+(ATX_Int64)timeout*1000000;
+    }
+    for (;;) {
+        BLT_Cardinal wait = BLT_CALLBACK_OUTPUT_WAIT_FOREVER;
+
+        CallbackOutputLender_ReleaseReturnedPackets(self);
+
+        CallbackOutputLock_Lock(&self->lock);
+        if (self->count <= max_count) {
+            CallbackOutputLock_Unlock(&self->lock);
+            return BLT_SUCCESS;
+        }
+        if (timeout != BLT_CALLBACK_OUTPUT_WAIT_FOREVER) {
+            ATX_Int64 now = CallbackOutputLender_GetTime();
+            if (now >= deadline) {
+                result = ATX_ERROR_TIMEOUT;
+            } else {
+                wait = (BLT_Cardinal)((deadline-now+999999)/1000000);
+            }
+        }
+        if (BLT_SUCCEEDED(result)) {
+            /* a packet returned since the release above is seen here */
+            BLT_Boolean pending = BLT_FALSE;
+            BLT_Cardinal i;
+            for (i=0; i<self->max_count && !pending; i++) {
+                pending = self->packets[i] && self->returned[i];
+            }
+            if (!pending) CallbackOutputLender_WaitForSignal(self, wait);
+        }
+        CallbackOutputLock_Unlock(&self->lock);
+        if (BLT_FAILED(result)) return result;
+    }
+}
+
+/*----------------------------------------------------------------------
+|    CallbackOutputLender_Orphan
+|
+|    Called when the node goes away. If packets are still lent, the
+|    lender stays, for the borrower to return them, and is freed with
+|    the last one. Those packets are leaked: they may only be released
+|    on the decoder thread, which is done with them.
++---------------------------------------------------------------------*/
+static void
+CallbackOutputLender_Orphan(CallbackOutputLender* self)
+{
+    BLT_Boolean destroy;
+
+    CallbackOutputLock_Lock(&self->lock);
+    self->orphaned = BLT_TRUE;
+    destroy = (self->count == 0);
+    if (!destroy) {
+        ATX_LOG_WARNING_1("%d packets not returned, leaking them", self->count);
+    }
+    CallbackOutputLock_Unlock(&self->lock);
+
+    if (destroy) CallbackOutputLender_Destroy(self);
+}
+
+/*----------------------------------------------------------------------
+|    CallbackOutputLender_ReturnPacket
++---------------------------------------------------------------------*/
+BLT_METHOD
+CallbackOutputLender_ReturnPacket(BLT_PacketLender* _self,
+                                  BLT_MediaPacket*  packet)
+{
+    CallbackOutputLender* self    = ATX_SELF(CallbackOutputLender, BLT_PacketLender);
+    BLT_Result            result  = BLT_ERROR_INVALID_PARAMETERS;
+    BLT_Boolean           destroy = BLT_FALSE;
+    BLT_Cardinal          i;
+
+    CallbackOutputLock_Lock(&self->lock);
+    for (i=0; i<self->max_count; i++) {
+        if (self->packets[i] == packet && !self->returned[i]) {
+            if (self->orphaned) {
+                /* nobody left to release it */
+                self->packets[i] = NULL;
+                destroy = (--self->count == 0);
+            } else {
+                self->returned[i] = BLT_TRUE;
+                CallbackOutputCondition_Signal(&self->returned_condition);
+            }
+            result = BLT_SUCCESS;
+            break;
+        }
+    }
+    CallbackOutputLock_Unlock(&self->lock);
+
+    if (destroy) CallbackOutputLender_Destroy(self);
+
+    return result;
+}
+
+/*----------------------------------------------------------------------
+|    CallbackOutput_LendPacket
++---------------------------------------------------------------------*/
+static BLT_Result
+CallbackOutput_LendPacket(CallbackOutput* self, BLT_MediaPacket* packet)
+{
+    CallbackOutputLender* lender = self->lender;
+    BLT_Cardinal          slot;
+    BLT_Result            result;
+
+    /* wait for a free slot, like for room in a device buffer */
+    CallbackOutputLender_WaitForReturns(lender, lender->max_count-1, BLT_CALLBACK_OUTPUT_WAIT_FOREVER);
+
+    /* the borrower may return the packet before BorrowPacket returns */
+    BLT_MediaPacket_AddReference(packet);
+    CallbackOutputLock_Lock(&lender->lock);
+    for (slot=0; lender->packets[slot]; slot++) {}
+    lender->packets[slot] = packet;
+    ++lender->count;
+    CallbackOutputLock_Unlock(&lender->lock);
+
+    result = BLT_PacketBorrower_BorrowPacket(self->borrower, 
+                                             packet, 
+                                             &ATX_BASE(lender, BLT_PacketLender));
+    if (BLT_FAILED(result)) {
+        /* not lent after all */
+        CallbackOutputLock_Lock(&lender->lock);
+        lender->returned[slot] = BLT_TRUE;
+        CallbackOutputLock_Unlock(&lender->lock);
+        CallbackOutputLender_ReleaseReturnedPackets(lender);
+    }
+
+    return result;
+}
 
 /*----------------------------------------------------------------------
 |    CallbackOutput_PutPacket
@@ -66,6 +394,8 @@ CallbackOutput_PutPacket(BLT_PacketConsumer* _self,
 {
     CallbackOutput* self = ATX_SELF(CallbackOutput, BLT_PacketConsumer);
     
+    if (self->borrower) return CallbackOutput_LendPacket(self, packet);
+
     return BLT_PacketConsumer_PutPacket(self->callback_target, packet);
 }
 
@@ -140,6 +470,32 @@ CallbackOutput_Create(BLT_Module*              module,
     BLT_MediaType_Clone(constructor->spec.input.media_type, 
                         &self->expected_media_type); 
 
+    /* see if the target borrows packets */
+    self->borrower = ATX_CAST(self->callback_target, BLT_PacketBorrower);
+    if (self->borrower) {
+        ATX_Properties*   properties;
+        ATX_PropertyValue property;
+        BLT_Cardinal      max_count = BLT_CALLBACK_OUTPUT_DEFAULT_MAX_LENT_PACKETS;
+
+        if (BLT_SUCCEEDED(BLT_Core_GetProperties(core, &properties)) &&
+            ATX_SUCCEEDED(ATX_Properties_GetProperty(properties,
+                                                     BLT_CALLBACK_OUTPUT_MAX_LENT_PACKETS,
+                                                     &property)) &&
+            property.type == ATX_PROPERTY_VALUE_TYPE_INTEGER &&
+            property.data.integer > 0) {
+            max_count = property.data.integer > BLT_CALLBACK_OUTPUT_MAX_MAX_LENT_PACKETS ?
+                        BLT_CALLBACK_OUTPUT_MAX_MAX_LENT_PACKETS :
+                        (BLT_Cardinal)property.data.integer;
+        }
+        result = CallbackOutputLender_Create(max_count, &self->lender);
+        if (BLT_FAILED(result)) {
+            CallbackOutput_Destroy(self);
+            *object = NULL;
+            return result;
+        }
+        ATX_LOG_FINE_1("lending up to %d packets", max_count);
+    }
+
     /* setup interfaces */
     ATX_SET_INTERFACE_EX(self, CallbackOutput, BLT_BaseMediaNode, BLT_MediaNode);
     ATX_SET_INTERFACE_EX(self, CallbackOutput, BLT_BaseMediaNode, ATX_Referenceable);
@@ -159,6 +515,12 @@ CallbackOutput_Destroy(CallbackOutput* self)
 {
     ATX_LOG_FINE("CallbackOutput::Destroy");
 
+    /* take back the lent packets, the lender outlives us if some are late */
+    if (self->lender) {
+        CallbackOutputLender_WaitForReturns(self->lender, 0, BLT_CALLBACK_OUTPUT_RETURN_TIMEOUT);
+        CallbackOutputLender_Orphan(self->lender);
+    }
+
     /* release our target */
     ATX_RELEASE_OBJECT(self->callback_target);
 
@@ -209,6 +571,18 @@ CallbackOutput_GetStatus(BLT_OutputNode*       _self,
     return BLT_SUCCESS;
 }
 
+/*----------------------------------------------------------------------
+|   CallbackOutput_Drain
++---------------------------------------------------------------------*/
+BLT_METHOD
+CallbackOutput_Drain(BLT_OutputNode* _self)
+{
+    CallbackOutput* self = ATX_SELF(CallbackOutput, BLT_OutputNode);
+
+    if (self->lender == NULL) return BLT_SUCCESS;
+    return CallbackOutputLender_WaitForReturns(self->lender, 0, BLT_CALLBACK_OUTPUT_RETURN_TIMEOUT);
+}
+
 /*----------------------------------------------------------------------
 |   GetInterface implementation
 +---------------------------------------------------------------------*/
@@ -238,6 +612,20 @@ ATX_BEGIN_INTERFACE_MAP(CallbackOutput, BLT_PacketConsumer)
     CallbackOutput_PutPacket
 ATX_END_INTERFACE_MAP
 
+/*----------------------------------------------------------------------
+|   GetInterface implementation
++---------------------------------------------------------------------*/
+ATX_BEGIN_GET_INTERFACE_IMPLEMENTATION(CallbackOutputLender)
+    ATX_GET_INTERFACE_ACCEPT(CallbackOutputLender, BLT_PacketLender)
+ATX_END_GET_INTERFACE_IMPLEMENTATION
+
+/*----------------------------------------------------------------------
+|    BLT_PacketLender interface
++---------------------------------------------------------------------*/
+ATX_BEGIN_INTERFACE_MAP(CallbackOutputLender, BLT_PacketLender)
+    CallbackOutputLender_ReturnPacket
+ATX_END_INTERFACE_MAP
+
 /*----------------------------------------------------------------------
 |    BLT_MediaNode interface
 +---------------------------------------------------------------------*/
@@ -258,7 +646,7 @@ ATX_END_INTERFACE_MAP_EX
 +---------------------------------------------------------------------*/
 ATX_BEGIN_INTERFACE_MAP(CallbackOutput, BLT_OutputNode)
     CallbackOutput_GetStatus,
-    NULL
+    CallbackOutput_Drain
 ATX_END_INTERFACE_MAP
 
 /*----------------------------------------------------------------------
@@ -19,6 +19,20 @@
  * This module responds to probes with the name 'callback-output:<addr>',
  * where <addr> is a decimal representation of the address of an object that
  * implements the BLT_PacketConsumer interface.
+ *
+ * If that object also implements the BLT_PacketBorrower interface, the
+ * packets are lent to it instead of being passed to its PutPacket method:
+ * it may keep a packet, and read the payload in place, for as long as it
+ * needs, then hand it back, from any thread, with
+ * BLT_PacketLender_ReturnPacket. This saves copying the payload into
+ * buffers of its own. The borrower must not add references to, or
+ * release, lent packets. When it holds BLT_CALLBACK_OUTPUT_MAX_LENT_PACKETS
+ * packets, the node waits for one to be returned before lending the next
+ * one, like a full device buffer. Draining or destroying the node waits
+ * until all the packets are returned, for at most 
+ * BLT_CALLBACK_OUTPUT_RETURN_TIMEOUT milliseconds. Packets may still be
+ * returned after the node is destroyed, the lender stays valid until the
+ * last one is, but they are leaked, and a warning is logged.
  * @{ 
  */
 
@@ -27,14 +41,63 @@
 +---------------------------------------------------------------------*/
 #include "BltTypes.h"
 #include "BltModule.h"
+#include "BltMediaPacket.h"
 
 /*----------------------------------------------------------------------
-|   module
+|   constants
 +---------------------------------------------------------------------*/
+/**
+ * Core property: number of packets that can be lent at the same time
+ * (integer). Read when a node is created. Defaults to 
+ * BLT_CALLBACK_OUTPUT_DEFAULT_MAX_LENT_PACKETS.
+ */
+#define BLT_CALLBACK_OUTPUT_MAX_LENT_PACKETS "Plugins.CallbackOutput.MaxLentPackets"
+
+#define BLT_CALLBACK_OUTPUT_DEFAULT_MAX_LENT_PACKETS 32
+#define BLT_CALLBACK_OUTPUT_RETURN_TIMEOUT           5000 /* milliseconds */
+
 #if defined(__cplusplus)
 extern "C" {
 #endif
-    
+
+/*----------------------------------------------------------------------
+|   BLT_PacketLender interface
++---------------------------------------------------------------------*/
+/**
+ * Implemented by the nodes, to take back the packets they lend.
+ * ReturnPacket may be called from any thread.
+ */
+ATX_DECLARE_INTERFACE(BLT_PacketLender)
+ATX_BEGIN_INTERFACE_DEFINITION(BLT_PacketLender)
+    BLT_Result (*ReturnPacket)(BLT_PacketLender* self, 
+                               BLT_MediaPacket*  packet);
+ATX_END_INTERFACE_DEFINITION
+
+#define BLT_PacketLender_ReturnPacket(object, packet) \
+ATX_INTERFACE(object)->ReturnPacket(object, packet)
+
+/*----------------------------------------------------------------------
+|   BLT_PacketBorrower interface
++---------------------------------------------------------------------*/
+/**
+ * Implemented by the callback targets that borrow packets.
+ * BorrowPacket is called on the decoder thread. When it succeeds, the
+ * packet must eventually be given back to the lender, which stays valid
+ * until then. When it fails, the packet isn't lent.
+ */
+ATX_DECLARE_INTERFACE(BLT_PacketBorrower)
+ATX_BEGIN_INTERFACE_DEFINITION(BLT_PacketBorrower)
+    BLT_Result (*BorrowPacket)(BLT_PacketBorrower* self, 
+                               BLT_MediaPacket*    packet,
+                               BLT_PacketLender*   lender);
+ATX_END_INTERFACE_DEFINITION
+
+#define BLT_PacketBorrower_BorrowPacket(object, packet, lender) \
+ATX_INTERFACE(object)->BorrowPacket(object, packet, lender)
+
+/*----------------------------------------------------------------------
+|   module
++---------------------------------------------------------------------*/
 BLT_Result BLT_CallbackOutputModule_GetModuleObject(BLT_Module** module);
 
 #if defined(__cplusplus)
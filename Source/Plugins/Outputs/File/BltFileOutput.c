@@ -18,6 +18,7 @@
 #include "BltMedia.h"
 #include "BltByteStreamProvider.h"
 #include "BltPcm.h"
+#include "BltWriteBehindStream.h"
 
 /*----------------------------------------------------------------------
 |   logging
@@ -76,10 +77,12 @@ FileOutput_GetStatus(BLT_OutputNode*       self,
 |    FileOutput_Drain
 +---------------------------------------------------------------------*/
 BLT_METHOD
-FileOutput_Drain(BLT_OutputNode* self)
+FileOutput_Drain(BLT_OutputNode* _self)
 {
-    ATX_COMPILER_UNUSED(self);
-    return BLT_SUCCESS;
+    FileOutput* self = ATX_SELF(FileOutput, BLT_OutputNode);
+
+    /* wait for the write-behind buffer */
+    return ATX_OutputStream_Flush(self->stream);
 }
 
 /*----------------------------------------------------------------------
@@ -112,6 +115,87 @@ FileOutput_DecideMediaType(FileOutput* self, BLT_CString name)
                                                    &self->media_type->id);
 }
 
+/*----------------------------------------------------------------------
+|    FileOutput_GetIntegerProperty
++---------------------------------------------------------------------*/
+static ATX_Int32
+FileOutput_GetIntegerProperty(ATX_Properties* properties,
+                              const char*     name,
+                              ATX_Int32       default_value)
+{
+    ATX_PropertyValue property;
+
+    if (properties &&
+        ATX_SUCCEEDED(ATX_Properties_GetProperty(properties, name, &property)) &&
+        property.type == ATX_PROPERTY_VALUE_TYPE_INTEGER &&
+        property.data.integer >= 0) {
+        return property.data.integer;
+    }
+    return default_value;
+}
+
+/*----------------------------------------------------------------------
+|    FileOutput_OpenStream
++---------------------------------------------------------------------*/
+static BLT_Result
+FileOutput_OpenStream(FileOutput* self, BLT_Core* core, BLT_CString filename)
+{
+    ATX_Properties*   properties = NULL;
+    ATX_OutputStream* file_stream;
+    BLT_Size          buffer_size;
+    BLT_Flags         flags;
+    BLT_LargeSize     preallocation;
+    BLT_Result        result;
+
+    /* read the settings */
+    BLT_Core_GetProperties(core, &properties);
+    buffer_size   = FileOutput_GetIntegerProperty(properties,
+                                                  BLT_FILE_OUTPUT_BUFFER_SIZE,
+                                                  BLT_FILE_OUTPUT_DEFAULT_BUFFER_SIZE);
+    flags         = FileOutput_GetIntegerProperty(properties, BLT_FILE_OUTPUT_DIRECT_IO, 0) ?
+                    BLT_WRITE_BEHIND_STREAM_FLAG_DIRECT : 0;
+    preallocation = FileOutput_GetIntegerProperty(properties, BLT_FILE_OUTPUT_PREALLOCATION, 0);
+
+    /* direct I/O and preallocation need a file of our own */
+    if (buffer_size && (flags || preallocation)) {
+        result = BLT_WriteBehindStream_CreateForFile(filename,
+                                                     buffer_size,
+                                                     flags,
+                                                     preallocation,
+                                                     &self->stream);
+        if (result != BLT_ERROR_NOT_SUPPORTED) return result;
+        ATX_LOG_FINE("direct I/O and preallocation not supported");
+    }
+
+    /* create the output file object */
+    result = ATX_File_Create(filename, &self->file);
+    if (BLT_FAILED(result)) {
+        self->file = NULL;
+        return result;
+    }
+
+    /* open the output file */
+    result = ATX_File_Open(self->file,
+                           ATX_FILE_OPEN_MODE_WRITE  |
+                           ATX_FILE_OPEN_MODE_CREATE |
+                           ATX_FILE_OPEN_MODE_TRUNCATE);
+    if (ATX_FAILED(result)) return result;
+
+    /* get the output stream */
+    result = ATX_File_GetOutputStream(self->file, &file_stream);
+    if (BLT_FAILED(result)) return result;
+    if (buffer_size == 0) {
+        self->stream = file_stream;
+        return BLT_SUCCESS;
+    }
+
+    /* write behind to it */
+    result = BLT_WriteBehindStream_Create(file_stream, buffer_size, &self->stream);
+    ATX_RELEASE_OBJECT(file_stream);
+
+    return result;
+}
+
 /*----------------------------------------------------------------------
 |   FileOutput_GetStream
 +---------------------------------------------------------------------*/
@@ -209,26 +293,9 @@ FileOutput_Create(BLT_Module*              module,
                             &self->media_type);
     }
 
-    /* create the output file object */
-    result = ATX_File_Create(constructor->name+5, &self->file);
-    if (BLT_FAILED(result)) {
-        self->file = NULL;
-        goto failure;
-    }
-
     /* open the output file */
-    result = ATX_File_Open(self->file,
-                           ATX_FILE_OPEN_MODE_WRITE  |
-                           ATX_FILE_OPEN_MODE_CREATE |
-                           ATX_FILE_OPEN_MODE_TRUNCATE);
-    if (ATX_FAILED(result)) goto failure;
-
-    /* get the output stream */
-    result = ATX_File_GetOutputStream(self->file, &self->stream);
-    if (BLT_FAILED(result)) {
-        self->stream = NULL;
-        goto failure;
-    }
+    result = FileOutput_OpenStream(self, core, constructor->name+5);
+    if (BLT_FAILED(result)) goto failure;
 
     /* setup interfaces */
     ATX_SET_INTERFACE_EX(self, FileOutput, BLT_BaseMediaNode, BLT_MediaNode);
@@ -254,7 +321,7 @@ FileOutput_Destroy(FileOutput* self)
 {
     ATX_LOG_FINE("FileOutput::Destroy");
 
-    /* release the stream */
+    /* release the stream (this waits for the write-behind buffer) */
     ATX_RELEASE_OBJECT(self->stream);
 
     /* destroy the file */
@@ -25,6 +25,9 @@
  * If no mime-type is explicitely set, this module will try to guess the
  * mime type based on the file extension, using the registered file 
  * extensions.
+ * The file is written through a write-behind buffer (see
+ * BltWriteBehindStream.h), so that the decoder doesn't wait for the
+ * storage. Draining the node waits until the buffer is written.
  * @{ 
  */
 
@@ -34,6 +37,31 @@
 #include "BltTypes.h"
 #include "BltModule.h"
 
+/*----------------------------------------------------------------------
+|   constants
++---------------------------------------------------------------------*/
+/**
+ * Core property: size of the write-behind buffer, in bytes (integer).
+ * 0 writes directly to the file. Read when a node is created.
+ */
+#define BLT_FILE_OUTPUT_BUFFER_SIZE   "Plugins.FileOutput.BufferSize"
+
+/**
+ * Core property: if not 0, the file is written with O_DIRECT, bypassing
+ * the page cache, where the platform and the filesystem support it
+ * (integer). Defaults to 0.
+ */
+#define BLT_FILE_OUTPUT_DIRECT_IO     "Plugins.FileOutput.DirectIo"
+
+/**
+ * Core property: if not 0, space is reserved for the file this many
+ * bytes at a time, ahead of the writes, where the platform supports it
+ * (integer). Defaults to 0.
+ */
+#define BLT_FILE_OUTPUT_PREALLOCATION "Plugins.FileOutput.Preallocation"
+
+#define BLT_FILE_OUTPUT_DEFAULT_BUFFER_SIZE (4*1024*1024)
+
 /*----------------------------------------------------------------------
 |   module
 +---------------------------------------------------------------------*/
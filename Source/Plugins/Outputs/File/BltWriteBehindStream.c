@@ -0,0 +1,561 @@
+/*****************************************************************
+|
+|   BlueTune - Write-Behind Stream
+|
+|   (c) 2002-2012 Gilles Boccon-Gibod
+|   Author: Gilles Boccon-Gibod (bok@bok.net)
+|
+ ****************************************************************/
+
+/*----------------------------------------------------------------------
+|   includes
++---------------------------------------------------------------------*/
+#if defined(__linux__) && !defined(__ANDROID__)
+#if !defined(_GNU_SOURCE)
+#define _GNU_SOURCE /* O_DIRECT and fallocate */
+#endif
+#define BLT_WRITE_BEHIND_STREAM_HAVE_FILES
+#include <fcntl.h>
+#include <unistd.h>
+#include <errno.h>
+#endif
+
+#if !defined(_WIN32)
+#define BLT_WRITE_BEHIND_STREAM_HAVE_THREADS
+#include <pthread.h>
+#endif
+
+#include "Atomix.h"
+#include "BltConfig.h"
+#include "BltTypes.h"
+#include "BltErrors.h"
+#include "BltWriteBehindStream.h"
+
+/*----------------------------------------------------------------------
+|   logging
++---------------------------------------------------------------------*/
+ATX_SET_LOCAL_LOGGER("bluetune.plugins.outputs.file.write-behind")
+
+/*----------------------------------------------------------------------
+|   constants
++---------------------------------------------------------------------*/
+#define BLT_WRITE_BEHIND_STREAM_CHUNK_COUNT    4
+#define BLT_WRITE_BEHIND_STREAM_ALIGNMENT      4096 /* for O_DIRECT */
+#define BLT_WRITE_BEHIND_STREAM_MIN_CHUNK_SIZE BLT_WRITE_BEHIND_STREAM_ALIGNMENT
+
+/*----------------------------------------------------------------------
+|   types
++---------------------------------------------------------------------*/
+typedef struct {
+    BLT_UInt8* data;
+    BLT_Size   size; /* bytes filled */
+} WriteBehindChunk;
+
+typedef struct {
+    /* interfaces */
+    ATX_IMPLEMENTS(ATX_OutputStream);
+    ATX_IMPLEMENTS(ATX_Referenceable);
+
+    /* members */
+    ATX_Cardinal      reference_count;
+    ATX_OutputStream* target;   /* NULL when writing to fd */
+    int               fd;
+    BLT_Boolean       direct;
+    BLT_LargeSize     preallocation;
+    BLT_Position      preallocated;
+    BLT_Position      file_position; /* where the next chunk goes */
+    BLT_Position      file_size;
+    BLT_Position      position;      /* what Tell returns */
+    BLT_UInt8*        memory;
+    BLT_Size          chunk_size;
+    WriteBehindChunk  chunks[BLT_WRITE_BEHIND_STREAM_CHUNK_COUNT];
+
+    /* chunks [tail, tail+queued) are waiting to be written, the chunk */
+    /* at head is being filled; head is only touched by the thread that */
+    /* uses the stream, so it can fill without the lock                */
+    unsigned int      head;
+    unsigned int      tail;
+    unsigned int      queued;
+    BLT_Result        error;
+
+#if defined(BLT_WRITE_BEHIND_STREAM_HAVE_THREADS)
+    pthread_t         thread;
+    BLT_Boolean       thread_started;
+    pthread_mutex_t   lock;
+    pthread_cond_t    work_cond; /* signaled to the writer thread */
+    pthread_cond_t    done_cond; /* signaled by the writer thread */
+    BLT_Boolean       terminate;
+#endif
+} WriteBehindStream;
+
+/*----------------------------------------------------------------------
+|   WriteBehindStream_WriteChunk
+|
+|   Writes a chunk to the target. Called from the writer thread, or from
+|   the thread that uses the stream when the writer thread is idle.
++---------------------------------------------------------------------*/
+static BLT_Result
+WriteBehindStream_WriteChunk(WriteBehindStream* self, const BLT_UInt8* data, BLT_Size size)
+{
+    if (self->target) {
+        while (size) {
+            ATX_Size   written = 0;
+            BLT_Result result = ATX_OutputStream_Write(self->target, data, size, &written);
+            if (BLT_FAILED(result)) return result;
+            if (written == 0) return BLT_FAILURE;
+            data += written;
+            size -= written;
+        }
+        return BLT_SUCCESS;
+    }
+
+#if defined(BLT_WRITE_BEHIND_STREAM_HAVE_FILES)
+    /* O_DIRECT only takes whole blocks */
+    if (self->direct && (size%BLT_WRITE_BEHIND_STREAM_ALIGNMENT)) {
+        int flags = fcntl(self->fd, F_GETFL);
+        if (flags != -1) fcntl(self->fd, F_SETFL, flags & ~O_DIRECT);
+        self->direct = BLT_FALSE;
+    }
+
+    /* reserve space ahead of the writes */
+    if (self->preallocation && self->file_position+size > self->preallocated) {
+        if (fallocate(self->fd, FALLOC_FL_KEEP_SIZE, self->preallocated, self->preallocation) == 0) {
+            self->preallocated += self->preallocation;
+        } else {
+            ATX_LOG_FINE_1("fallocate failed (%d), not preallocating", errno);
+            self->preallocation = 0;
+        }
+    }
+
+    while (size) {
+        ssize_t written = write(self->fd, data, size);
+        if (written < 0) {
+            if (errno == EINTR) continue;
+            ATX_LOG_WARNING_1("write failed (%d)", errno);
+            return BLT_FAILURE;
+        }
+        data += written;
+        size -= (BLT_Size)written;
+        self->file_position += written;
+    }
+    if (self->file_position > self->file_size) self->file_size = self->file_position;
+
+    return BLT_SUCCESS;
+#else
+    return BLT_ERROR_INTERNAL;
+#endif
+}
+
+#if defined(BLT_WRITE_BEHIND_STREAM_HAVE_THREADS)
+/*----------------------------------------------------------------------
+|   WriteBehindStream_Run
++---------------------------------------------------------------------*/
+static void*
+WriteBehindStream_Run(void* arg)
+{
+    WriteBehindStream* self = (WriteBehindStream*)arg;
+
+    pthread_mutex_lock(&self->lock);
+    for (;;) {
+        WriteBehindChunk* chunk;
+        BLT_Result        result;
+
+        while (self->queued == 0 && !self->terminate) {
+            pthread_cond_wait(&self->work_cond, &self->lock);
+        }
+        if (self->queued == 0) break;
+
+        /* the chunk stays queued while it is written, so it isn't reused */
+        chunk = &self->chunks[self->tail];
+        pthread_mutex_unlock(&self->lock);
+        result = self->error == BLT_SUCCESS ?
+                 WriteBehindStream_WriteChunk(self, chunk->data, chunk->size) :
+                 BLT_SUCCESS;
+        pthread_mutex_lock(&self->lock);
+
+        if (BLT_FAILED(result) && self->error == BLT_SUCCESS) self->error = result;
+        chunk->size = 0;
+        self->tail = (self->tail+1)%BLT_WRITE_BEHIND_STREAM_CHUNK_COUNT;
+        --self->queued;
+        pthread_cond_signal(&self->done_cond);
+    }
+    pthread_mutex_unlock(&self->lock);
+
+    return NULL;
+}
+#endif
+
+/*----------------------------------------------------------------------
+|   WriteBehindStream_Submit
+|
+|   Queues the chunk being filled, then waits until there is a free
+|   chunk to fill.
++---------------------------------------------------------------------*/
+static void
+WriteBehindStream_Submit(WriteBehindStream* self)
+{
+#if defined(BLT_WRITE_BEHIND_STREAM_HAVE_THREADS)
+    pthread_mutex_lock(&self->lock);
+    ++self->queued;
+    pthread_cond_signal(&self->work_cond);
+    while (self->queued == BLT_WRITE_BEHIND_STREAM_CHUNK_COUNT) {
+        pthread_cond_wait(&self->done_cond, &self->lock);
+    }
+    pthread_mutex_unlock(&self->lock);
+#else
+    WriteBehindChunk* chunk = &self->chunks[self->head];
+    if (self->error == BLT_SUCCESS) {
+        self->error = WriteBehindStream_WriteChunk(self, chunk->data, chunk->size);
+    }
+    chunk->size = 0;
+#endif
+    self->head = (self->head+1)%BLT_WRITE_BEHIND_STREAM_CHUNK_COUNT;
+}
+
+/*----------------------------------------------------------------------
+|   WriteBehindStream_GetError
++---------------------------------------------------------------------*/
+static BLT_Result
+WriteBehindStream_GetError(WriteBehindStream* self)
+{
+#if defined(BLT_WRITE_BEHIND_STREAM_HAVE_THREADS)
+    BLT_Result result;
+
+    pthread_mutex_lock(&self->lock);
+    result = self->error;
+    pthread_mutex_unlock(&self->lock);
+
+    return result;
+#else
+    return self->error;
+#endif
+}
+
+/*----------------------------------------------------------------------
+|   WriteBehindStream_Drain
+|
+|   Waits until everything written so far has reached the target.
++---------------------------------------------------------------------*/
+static BLT_Result
+WriteBehindStream_Drain(WriteBehindStream* self)
+{
+    BLT_Result result;
+
+    if (self->chunks[self->head].size) WriteBehindStream_Submit(self);
+
+#if defined(BLT_WRITE_BEHIND_STREAM_HAVE_THREADS)
+    pthread_mutex_lock(&self->lock);
+    while (self->queued) {
+        pthread_cond_wait(&self->done_cond, &self->lock);
+    }
+    result = self->error;
+    pthread_mutex_unlock(&self->lock);
+#else
+    result = self->error;
+#endif
+
+    return result;
+}
+
+/*----------------------------------------------------------------------
+|   WriteBehindStream_Write
++---------------------------------------------------------------------*/
+ATX_METHOD
+WriteBehindStream_Write(ATX_OutputStream* _self,
+                        const void*       buffer,
+                        ATX_Size          bytes_to_write,
+                        ATX_Size*         bytes_written)
+{
+    WriteBehindStream* self = ATX_SELF(WriteBehindStream, ATX_OutputStream);
+    const BLT_UInt8*   data = (const BLT_UInt8*)buffer;
+    BLT_Size           left = bytes_to_write;
+    BLT_Result         result;
+
+    if (bytes_written) *bytes_written = 0;
+
+    /* report the errors of the writer thread */
+    result = WriteBehindStream_GetError(self);
+    if (BLT_FAILED(result)) return result;
+
+    while (left) {
+        WriteBehindChunk* chunk = &self->chunks[self->head];
+        BLT_Size          count = self->chunk_size-chunk->size;
+        if (count > left) count = left;
+        ATX_CopyMemory(chunk->data+chunk->size, data, count);
+        chunk->size += count;
+        data += count;
+        left -= count;
+        if (chunk->size == self->chunk_size) WriteBehindStream_Submit(self);
+    }
+
+    self->position += bytes_to_write;
+    if (bytes_written) *bytes_written = bytes_to_write;
+
+    return BLT_SUCCESS;
+}
+
+/*----------------------------------------------------------------------
+|   WriteBehindStream_Seek
++---------------------------------------------------------------------*/
+ATX_METHOD
+WriteBehindStream_Seek(ATX_OutputStream* _self, ATX_Position where)
+{
+    WriteBehindStream* self = ATX_SELF(WriteBehindStream, ATX_OutputStream);
+    BLT_Result         result;
+
+    if (where == self->position) return BLT_SUCCESS;
+
+    /* the writer thread is idle after this */
+    result = WriteBehindStream_Drain(self);
+    if (BLT_FAILED(result)) return result;
+
+    if (self->target) {
+        result = ATX_OutputStream_Seek(self->target, where);
+        if (BLT_FAILED(result)) return result;
+    } else {
+#if defined(BLT_WRITE_BEHIND_STREAM_HAVE_FILES)
+        if (lseek(self->fd, (off_t)where, SEEK_SET) == (off_t)-1) {
+            return BLT_ERROR_OUT_OF_RANGE;
+        }
+        self->file_position = where;
+
+        /* the writes won't be aligned anymore */
+        if (self->direct) {
+            int flags = fcntl(self->fd, F_GETFL);
+            if (flags != -1) fcntl(self->fd, F_SETFL, flags & ~O_DIRECT);
+            self->direct = BLT_FALSE;
+        }
+#endif
+    }
+    self->position = where;
+
+    return BLT_SUCCESS;
+}
+
+/*----------------------------------------------------------------------
+|   WriteBehindStream_Tell
++---------------------------------------------------------------------*/
+ATX_METHOD
+WriteBehindStream_Tell(ATX_OutputStream* _self, ATX_Position* where)
+{
+    WriteBehindStream* self = ATX_SELF(WriteBehindStream, ATX_OutputStream);
+
+    *where = self->position;
+
+    return BLT_SUCCESS;
+}
+
+/*----------------------------------------------------------------------
+|   WriteBehindStream_Flush
++---------------------------------------------------------------------*/
+ATX_METHOD
+WriteBehindStream_Flush(ATX_OutputStream* _self)
+{
+    WriteBehindStream* self = ATX_SELF(WriteBehindStream, ATX_OutputStream);
+    BLT_Result         result;
+
+    result = WriteBehindStream_Drain(self);
+    if (BLT_FAILED(result)) return result;
+
+    return self->target ? ATX_OutputStream_Flush(self->target) : BLT_SUCCESS;
+}
+
+/*----------------------------------------------------------------------
+|   WriteBehindStream_Destroy
++---------------------------------------------------------------------*/
+static void
+WriteBehindStream_Destroy(WriteBehindStream* self)
+{
+    if (self->memory) {
+        BLT_Result result = WriteBehindStream_Drain(self);
+        if (BLT_FAILED(result)) {
+            ATX_LOG_WARNING_1("some data could not be written (%d)", result);
+        }
+    }
+
+#if defined(BLT_WRITE_BEHIND_STREAM_HAVE_THREADS)
+    if (self->thread_started) {
+        pthread_mutex_lock(&self->lock);
+        self->terminate = BLT_TRUE;
+        pthread_cond_signal(&self->work_cond);
+        pthread_mutex_unlock(&self->lock);
+        pthread_join(self->thread, NULL);
+    }
+    pthread_cond_destroy(&self->done_cond);
+    pthread_cond_destroy(&self->work_cond);
+    pthread_mutex_destroy(&self->lock);
+#endif
+
+    if (self->target) {
+        ATX_RELEASE_OBJECT(self->target);
+    } else {
+#if defined(BLT_WRITE_BEHIND_STREAM_HAVE_FILES)
+        if (self->fd >= 0) {
+            /* give back the space reserved past the end */
+            if (self->preallocated > self->file_size) {
+                if (ftruncate(self->fd, (off_t)self->file_size) != 0) {
+                    ATX_LOG_FINE_1("ftruncate failed (%d)", errno);
+                }
+            }
+            close(self->fd);
+        }
+#endif
+    }
+
+    ATX_FreeMemory(self->memory);
+    ATX_FreeMemory(self);
+}
+
+/*----------------------------------------------------------------------
+|   GetInterface implementation
++---------------------------------------------------------------------*/
+ATX_BEGIN_GET_INTERFACE_IMPLEMENTATION(WriteBehindStream)
+    ATX_GET_INTERFACE_ACCEPT(WriteBehindStream, ATX_OutputStream)
+    ATX_GET_INTERFACE_ACCEPT(WriteBehindStream, ATX_Referenceable)
+ATX_END_GET_INTERFACE_IMPLEMENTATION
+
+/*----------------------------------------------------------------------
+|   ATX_OutputStream interface
++---------------------------------------------------------------------*/
+ATX_BEGIN_INTERFACE_MAP(WriteBehindStream, ATX_OutputStream)
+    WriteBehindStream_Write,
+    WriteBehindStream_Seek,
+    WriteBehindStream_Tell,
+    WriteBehindStream_Flush
+ATX_END_INTERFACE_MAP
+
+/*----------------------------------------------------------------------
+|   ATX_Referenceable interface
++---------------------------------------------------------------------*/
+ATX_IMPLEMENT_REFERENCEABLE_INTERFACE(WriteBehindStream, reference_count)
+
+/*----------------------------------------------------------------------
+|   WriteBehindStream_Construct
++---------------------------------------------------------------------*/
+static BLT_Result
+WriteBehindStream_Construct(WriteBehindStream* self, BLT_Size buffer_size)
+{
+    BLT_UInt8*   aligned;
+    unsigned int i;
+
+    self->reference_count = 1;
+#if defined(BLT_WRITE_BEHIND_STREAM_HAVE_THREADS)
+    pthread_mutex_init(&self->lock, NULL);
+    pthread_cond_init(&self->work_cond, NULL);
+    pthread_cond_init(&self->done_cond, NULL);
+#endif
+
+    /* whole blocks, so that the chunks can be written with O_DIRECT */
+    self->chunk_size = buffer_size/BLT_WRITE_BEHIND_STREAM_CHUNK_COUNT;
+    self->chunk_size -= self->chunk_size%BLT_WRITE_BEHIND_STREAM_ALIGNMENT;
+    if (self->chunk_size < BLT_WRITE_BEHIND_STREAM_MIN_CHUNK_SIZE) {
+        self->chunk_size = BLT_WRITE_BEHIND_STREAM_MIN_CHUNK_SIZE;
+    }
+    self->memory = (BLT_UInt8*)ATX_AllocateMemory(BLT_WRITE_BEHIND_STREAM_CHUNK_COUNT*self->chunk_size+
+                                                  BLT_WRITE_BEHIND_STREAM_ALIGNMENT);
+    if (self->memory == NULL) return BLT_ERROR_OUT_OF_MEMORY;
+    aligned = self->memory+(BLT_WRITE_BEHIND_STREAM_ALIGNMENT-
+                            ((size_t)self->memory)%BLT_WRITE_BEHIND_STREAM_ALIGNMENT)%
+                           BLT_WRITE_BEHIND_STREAM_ALIGNMENT;
+    for (i=0; i<BLT_WRITE_BEHIND_STREAM_CHUNK_COUNT; i++) {
+        self->chunks[i].data = aligned+i*self->chunk_size;
+    }
+
+#if defined(BLT_WRITE_BEHIND_STREAM_HAVE_THREADS)
+    if (pthread_create(&self->thread, NULL, WriteBehindStream_Run, self) != 0) {
+        return BLT_ERROR_OUT_OF_RESOURCES;
+    }
+    self->thread_started = BLT_TRUE;
+#endif
+
+    ATX_SET_INTERFACE(self, WriteBehindStream, ATX_OutputStream);
+    ATX_SET_INTERFACE(self, WriteBehindStream, ATX_Referenceable);
+
+    return BLT_SUCCESS;
+}
+
+/*----------------------------------------------------------------------
+|   BLT_WriteBehindStream_Create
++---------------------------------------------------------------------*/
+BLT_Result
+BLT_WriteBehindStream_Create(ATX_OutputStream*  target,
+                             BLT_Size           buffer_size,
+                             ATX_OutputStream** stream)
+{
+    WriteBehindStream* self;
+    BLT_Result         result;
+
+    *stream = NULL;
+    self = (WriteBehindStream*)ATX_AllocateZeroMemory(sizeof(WriteBehindStream));
+    if (self == NULL) return BLT_ERROR_OUT_OF_MEMORY;
+
+    self->fd     = -1;
+    self->target = target;
+    ATX_REFERENCE_OBJECT(target);
+    ATX_OutputStream_Tell(target, &self->position);
+
+    result = WriteBehindStream_Construct(self, buffer_size);
+    if (BLT_FAILED(result)) {
+        WriteBehindStream_Destroy(self);
+        return result;
+    }
+
+    *stream = &ATX_BASE(self, ATX_OutputStream);
+    return BLT_SUCCESS;
+}
+
+/*----------------------------------------------------------------------
+|   BLT_WriteBehindStream_CreateForFile
++---------------------------------------------------------------------*/
+BLT_Result
+BLT_WriteBehindStream_CreateForFile(const char*        filename,
+                                    BLT_Size           buffer_size,
+                                    BLT_Flags          flags,
+                                    BLT_LargeSize      preallocation,
+                                    ATX_OutputStream** stream)
+{
+#if defined(BLT_WRITE_BEHIND_STREAM_HAVE_FILES)
+    WriteBehindStream* self;
+    int                open_flags = O_WRONLY | O_CREAT | O_TRUNC;
+    BLT_Result         result;
+
+    *stream = NULL;
+    self = (WriteBehindStream*)ATX_AllocateZeroMemory(sizeof(WriteBehindStream));
+    if (self == NULL) return BLT_ERROR_OUT_OF_MEMORY;
+
+    /* not every filesystem takes O_DIRECT */
+    self->fd = -1;
+    if (flags & BLT_WRITE_BEHIND_STREAM_FLAG_DIRECT) {
+        self->fd = open(filename, open_flags | O_DIRECT, 0666);
+        if (self->fd >= 0) {
+            self->direct = BLT_TRUE;
+        } else {
+            ATX_LOG_FINE_1("cannot open with O_DIRECT (%d)", errno);
+        }
+    }
+    if (self->fd < 0) self->fd = open(filename, open_flags, 0666);
+    if (self->fd < 0) {
+        result = errno == EACCES ? BLT_ERROR_ACCESS_DENIED : BLT_ERROR_OPEN_FAILED;
+        ATX_FreeMemory(self);
+        return result;
+    }
+    self->preallocation = preallocation;
+
+    result = WriteBehindStream_Construct(self, buffer_size);
+    if (BLT_FAILED(result)) {
+        WriteBehindStream_Destroy(self);
+        return result;
+    }
+
+    ATX_LOG_FINE_2("writing behind to %s, direct=%d", filename, self->direct);
+    *stream = &ATX_BASE(self, ATX_OutputStream);
+    return BLT_SUCCESS;
+#else
+    ATX_COMPILER_UNUSED(filename);
+    ATX_COMPILER_UNUSED(buffer_size);
+    ATX_COMPILER_UNUSED(flags);
+    ATX_COMPILER_UNUSED(preallocation);
+    *stream = NULL;
+    return BLT_ERROR_NOT_SUPPORTED;
+#endif
+}
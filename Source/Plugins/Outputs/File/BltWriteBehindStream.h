@@ -0,0 +1,71 @@
+/*****************************************************************
+|
+|   BlueTune - Write-Behind Stream
+|
+|   (c) 2002-2012 Gilles Boccon-Gibod
+|   Author: Gilles Boccon-Gibod (bok@bok.net)
+|
+ ****************************************************************/
+/** @file
+ * Write-behind stream: an ATX_OutputStream that copies what is written
+ * to it into large chunks, which a background thread writes to the
+ * target, so that the thread writing to the stream doesn't wait for the
+ * storage, and the storage sees a few large writes instead of many
+ * small ones.
+ * Seeking, flushing and releasing the stream wait until everything
+ * written so far has reached the target. Write errors of the background
+ * thread are returned by the next call.
+ * On platforms without POSIX threads, the chunks are written by the
+ * thread that fills them.
+ */
+
+#ifndef _BLT_WRITE_BEHIND_STREAM_H_
+#define _BLT_WRITE_BEHIND_STREAM_H_
+
+/*----------------------------------------------------------------------
+|   includes
++---------------------------------------------------------------------*/
+#include "Atomix.h"
+#include "BltTypes.h"
+
+/*----------------------------------------------------------------------
+|   constants
++---------------------------------------------------------------------*/
+/** Bypass the page cache (O_DIRECT), where supported */
+#define BLT_WRITE_BEHIND_STREAM_FLAG_DIRECT 1
+
+/*----------------------------------------------------------------------
+|   prototypes
++---------------------------------------------------------------------*/
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/**
+ * Create a stream that writes behind to another stream.
+ * @param buffer_size Number of bytes that may be waiting to be written.
+ */
+BLT_Result BLT_WriteBehindStream_Create(ATX_OutputStream*  target,
+                                        BLT_Size           buffer_size,
+                                        ATX_OutputStream** stream);
+
+/**
+ * Create (or truncate) a file, and a stream that writes behind to it.
+ * @param flags BLT_WRITE_BEHIND_STREAM_FLAG_xxx flags.
+ * @param preallocation If not 0, space is reserved for the file this
+ * many bytes at a time, ahead of the writes, to limit fragmentation.
+ * @return BLT_ERROR_NOT_SUPPORTED on platforms where the file can't be
+ * opened this way, in which case callers use
+ * BLT_WriteBehindStream_Create with a stream of their own.
+ */
+BLT_Result BLT_WriteBehindStream_CreateForFile(const char*        filename,
+                                               BLT_Size           buffer_size,
+                                               BLT_Flags          flags,
+                                               BLT_LargeSize      preallocation,
+                                               ATX_OutputStream** stream);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* _BLT_WRITE_BEHIND_STREAM_H_ */
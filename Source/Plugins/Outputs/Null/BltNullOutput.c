@@ -10,25 +10,42 @@
 /*----------------------------------------------------------------------
 |   includes
 +---------------------------------------------------------------------*/
+#include <time.h>
+
 #include "Atomix.h"
 #include "BltConfig.h"
 #include "BltNullOutput.h"
 #include "BltCore.h"
 #include "BltMediaNode.h"
 #include "BltMedia.h"
+#include "BltPcm.h"
+#include "BltStream.h"
 #include "BltPacketConsumer.h"
+#include "BltOutputBuffer.h"
 
 /*----------------------------------------------------------------------
 |   logging
 +---------------------------------------------------------------------*/
 ATX_SET_LOCAL_LOGGER("bluetune.plugins.outputs.null")
 
+/*----------------------------------------------------------------------
+|    constants
++---------------------------------------------------------------------*/
+#define BLT_NULL_OUTPUT_DEFAULT_BUFFER_TIME 500    /* ms */
+#define BLT_NULL_OUTPUT_MAX_BUFFER_TIME     10000  /* ms */
+#define BLT_NULL_OUTPUT_PUBLISH_INTERVAL    1000000000 /* ns */
+#define BLT_NULL_OUTPUT_SCRATCH_FRAMES      1024
+#define BLT_NULL_OUTPUT_MIN_SLEEP           1000000 /* ns */
+
 /*----------------------------------------------------------------------
 |    types
 +---------------------------------------------------------------------*/
 typedef struct {
     /* base class */
     ATX_EXTENDS(BLT_BaseModule);
+
+    /* members */
+    BLT_UInt32 probe_type_id;
 } NullOutputModule;
 
 typedef struct {
@@ -41,8 +58,32 @@ typedef struct {
     ATX_IMPLEMENTS(BLT_MediaPort);
 
     /* members */
-    BLT_MediaType* expected_media_type;
-    BLT_TimeStamp  media_time;
+    BLT_MediaType*     expected_media_type;
+    BLT_Boolean        accept_any_type;
+    BLT_TimeStamp      media_time;
+    BLT_NullOutputMode mode;
+    BLT_Boolean        mode_from_name;
+    BLT_Cardinal       buffer_time; /* ms */
+    struct {
+        BLT_UInt64     packets;
+        BLT_UInt64     bytes;
+        BLT_UInt64     frames;
+        BLT_UInt64     media_duration;    /* ns of PCM received */
+        ATX_Int64      first_packet_time; /* ns */
+        ATX_Int64      last_packet_time;  /* ns */
+        ATX_Int64      publish_time;      /* ns */
+    } counters;
+
+    /* simulated device, in paced mode */
+    struct {
+        BLT_OutputBuffer* buffer;
+        BLT_PcmMediaType  format;
+        unsigned char*    scratch;
+        BLT_Boolean       running;
+        BLT_Boolean       paused;
+        ATX_Int64         start_time; /* ns, when frame 0 was played */
+        BLT_UInt64        played;     /* frames consumed since start_time */
+    } device;
 } NullOutput;
 
 /*----------------------------------------------------------------------
@@ -56,6 +97,223 @@ ATX_DECLARE_INTERFACE_MAP(NullOutput, BLT_OutputNode)
 ATX_DECLARE_INTERFACE_MAP(NullOutput, BLT_MediaPort)
 ATX_DECLARE_INTERFACE_MAP(NullOutput, BLT_PacketConsumer)
 
+/*----------------------------------------------------------------------
+|    NullOutput_GetTime
++---------------------------------------------------------------------*/
+static ATX_Int64
+NullOutput_GetTime(void)
+{
+#if defined(CLOCK_MONOTONIC)
+    /* pacing must not follow changes of the time of day */
+    struct timespec now;
+    if (clock_gettime(CLOCK_MONOTONIC, &now) == 0) {
+        return (ATX_Int64)now.tv_sec*1000000000+now.tv_nsec;
+    }
+#endif
+    {
+        ATX_TimeStamp now;
+        ATX_Int64     now_int = 0;
+        ATX_System_GetCurrentTimeStamp(&now);
+        ATX_TimeStamp_ToInt64(now, now_int);
+        return now_int;
+    }
+}
+
+/*----------------------------------------------------------------------
+|    NullOutput_FramesToNanos
++---------------------------------------------------------------------*/
+static ATX_Int64
+NullOutput_FramesToNanos(BLT_UInt64 frames, BLT_UInt32 sample_rate)
+{
+    /* in two parts, so that long runs don't overflow */
+    return (ATX_Int64)(frames/sample_rate)*1000000000+
+           (ATX_Int64)(((frames%sample_rate)*1000000000)/sample_rate);
+}
+
+/*----------------------------------------------------------------------
+|    NullOutput_PublishCounters
++---------------------------------------------------------------------*/
+static void
+NullOutput_PublishCounters(NullOutput* self)
+{
+    BLT_Stream*       stream = ATX_BASE(self, BLT_BaseMediaNode).context;
+    ATX_Properties*   properties = NULL;
+    ATX_PropertyValue value;
+    ATX_Int64         wall_time;
+
+    if (stream == NULL) return;
+    if (BLT_FAILED(BLT_Stream_GetProperties(stream, &properties)) || properties == NULL) {
+        return;
+    }
+    wall_time = self->counters.last_packet_time-self->counters.first_packet_time;
+
+    value.type = ATX_PROPERTY_VALUE_TYPE_INTEGER;
+    value.data.integer = (ATX_Int32)self->counters.packets;
+    ATX_Properties_SetProperty(properties, BLT_NULL_OUTPUT_PACKETS_PROPERTY, &value);
+    value.data.integer = (ATX_Int32)self->counters.frames;
+    ATX_Properties_SetProperty(properties, BLT_NULL_OUTPUT_FRAMES_PROPERTY, &value);
+    value.data.integer = (ATX_Int32)(self->counters.bytes/1024);
+    ATX_Properties_SetProperty(properties, BLT_NULL_OUTPUT_KILOBYTES_PROPERTY, &value);
+    value.data.integer = (ATX_Int32)(wall_time/1000000);
+    ATX_Properties_SetProperty(properties, BLT_NULL_OUTPUT_WALL_TIME_PROPERTY, &value);
+
+    value.type = ATX_PROPERTY_VALUE_TYPE_FLOAT;
+    value.data.fp = wall_time > 0 ? (float)((double)self->counters.media_duration/(double)wall_time) : 0.0f;
+    ATX_Properties_SetProperty(properties, BLT_NULL_OUTPUT_SPEED_PROPERTY, &value);
+
+    if (self->device.buffer) {
+        BLT_OutputBufferStats stats;
+        BLT_UInt32            sample_rate = self->device.format.sample_rate;
+
+        BLT_OutputBuffer_GetStats(self->device.buffer, &stats);
+        value.type = ATX_PROPERTY_VALUE_TYPE_INTEGER;
+        value.data.integer = (ATX_Int32)stats.underruns;
+        ATX_Properties_SetProperty(properties, BLT_NULL_OUTPUT_UNDERRUNS_PROPERTY, &value);
+        value.data.integer = (ATX_Int32)(NullOutput_FramesToNanos(stats.underrun_frames, sample_rate)/1000000);
+        ATX_Properties_SetProperty(properties, BLT_NULL_OUTPUT_UNDERRUN_TIME_PROPERTY, &value);
+        value.data.integer = (ATX_Int32)(NullOutput_FramesToNanos(stats.max_fill, sample_rate)/1000000);
+        ATX_Properties_SetProperty(properties, BLT_NULL_OUTPUT_MAX_LATENCY_PROPERTY, &value);
+    }
+}
+
+/*----------------------------------------------------------------------
+|    NullOutput_RunDevice
++---------------------------------------------------------------------*/
+static void
+NullOutput_RunDevice(NullOutput* self, ATX_Int64 now)
+{
+    BLT_UInt32 sample_rate = self->device.format.sample_rate;
+    ATX_Int64  elapsed;
+    BLT_UInt64 due;
+
+    if (!self->device.running || self->device.paused) return;
+    if (now <= self->device.start_time) return;
+
+    /* consume the frames that a real device would have played by now */
+    elapsed = now-self->device.start_time;
+    due = (BLT_UInt64)(elapsed/1000000000)*sample_rate+
+          ((BLT_UInt64)(elapsed%1000000000)*sample_rate)/1000000000;
+    while (self->device.played < due) {
+        BLT_UInt64 count = due-self->device.played;
+        if (count > BLT_NULL_OUTPUT_SCRATCH_FRAMES) count = BLT_NULL_OUTPUT_SCRATCH_FRAMES;
+        BLT_OutputBuffer_Read(self->device.buffer, self->device.scratch, (BLT_Cardinal)count, BLT_TRUE);
+        self->device.played += count;
+    }
+}
+
+/*----------------------------------------------------------------------
+|    NullOutput_ResetDevice
++---------------------------------------------------------------------*/
+static void
+NullOutput_ResetDevice(NullOutput* self)
+{
+    if (self->device.buffer) BLT_OutputBuffer_Reset(self->device.buffer);
+    self->device.running = BLT_FALSE;
+    self->device.played  = 0;
+}
+
+/*----------------------------------------------------------------------
+|    NullOutput_ConfigureDevice
++---------------------------------------------------------------------*/
+static BLT_Result
+NullOutput_ConfigureDevice(NullOutput* self, const BLT_PcmMediaType* format)
+{
+    BLT_Cardinal capacity;
+    BLT_Result   result;
+
+    if (self->device.buffer                                        &&
+        format->sample_rate     == self->device.format.sample_rate     &&
+        format->channel_count   == self->device.format.channel_count   &&
+        format->bits_per_sample == self->device.format.bits_per_sample &&
+        format->sample_format   == self->device.format.sample_format) {
+        return BLT_SUCCESS;
+    }
+
+    /* a new format starts a new device, like a real output would */
+    if (self->device.buffer) {
+        BLT_OutputBuffer_Destroy(self->device.buffer);
+        self->device.buffer = NULL;
+    }
+    if (self->device.scratch) {
+        ATX_FreeMemory(self->device.scratch);
+        self->device.scratch = NULL;
+    }
+    NullOutput_ResetDevice(self);
+
+    capacity = (BLT_Cardinal)(((BLT_UInt64)format->sample_rate*self->buffer_time)/1000);
+    result = BLT_OutputBuffer_Create(capacity ? capacity : 1, 0, &self->device.buffer);
+    if (BLT_FAILED(result)) return result;
+    result = BLT_OutputBuffer_SetFormat(self->device.buffer, format);
+    if (BLT_SUCCEEDED(result)) {
+        self->device.scratch = (unsigned char*)ATX_AllocateMemory(BLT_NULL_OUTPUT_SCRATCH_FRAMES*
+                                                                  format->channel_count*
+                                                                  format->bits_per_sample/8);
+        if (self->device.scratch == NULL) result = BLT_ERROR_OUT_OF_MEMORY;
+    }
+    if (BLT_FAILED(result)) {
+        BLT_OutputBuffer_Destroy(self->device.buffer);
+        self->device.buffer = NULL;
+        return result;
+    }
+    self->device.format = *format;
+
+    ATX_LOG_FINE_2("simulated device: %d Hz, %d frames", 
+                   (int)format->sample_rate, 
+                   (int)BLT_OutputBuffer_GetCapacity(self->device.buffer));
+
+    return BLT_SUCCESS;
+}
+
+/*----------------------------------------------------------------------
+|    NullOutput_WritePaced
++---------------------------------------------------------------------*/
+static void
+NullOutput_WritePaced(NullOutput*          self, 
+                      const unsigned char* samples, 
+                      BLT_Cardinal         frame_count)
+{
+    BLT_OutputBuffer* buffer     = self->device.buffer;
+    BLT_Cardinal      capacity   = BLT_OutputBuffer_GetCapacity(buffer);
+    BLT_Size          frame_size = self->device.format.channel_count*
+                                   self->device.format.bits_per_sample/8;
+    ATX_Int64         now        = NullOutput_GetTime();
+
+    /* the device starts playing with the first frame */
+    if (!self->device.running) {
+        self->device.running    = BLT_TRUE;
+        self->device.start_time = now;
+        self->device.played     = 0;
+    }
+
+    for (;;) {
+        BLT_Cardinal     written;
+        ATX_Int64        wait_time;
+        ATX_TimeInterval wait;
+
+        NullOutput_RunDevice(self, now);
+        written = BLT_OutputBuffer_Write(buffer, samples, frame_count);
+        samples     += written*frame_size;
+        frame_count -= written;
+        if (frame_count == 0) break;
+
+        /* a paused device does not make room, so the rest is lost */
+        if (self->device.paused) {
+            BLT_OutputBuffer_ReportOverrun(buffer, frame_count);
+            break;
+        }
+
+        /* the buffer is full: block, like a device write would, */
+        /* until the device has played enough for the rest       */
+        wait_time = NullOutput_FramesToNanos(frame_count < capacity ? frame_count : capacity,
+                                             self->device.format.sample_rate);
+        if (wait_time < BLT_NULL_OUTPUT_MIN_SLEEP) wait_time = BLT_NULL_OUTPUT_MIN_SLEEP;
+        wait.seconds     = (ATX_Int32)(wait_time/1000000000);
+        wait.nanoseconds = (ATX_Int32)(wait_time%1000000000);
+        ATX_System_Sleep(&wait);
+        now = NullOutput_GetTime();
+    }
+}
+
 /*----------------------------------------------------------------------
 |    NullOutput_GetStatus
 +---------------------------------------------------------------------*/
@@ -66,7 +324,14 @@ NullOutput_GetStatus(BLT_OutputNode*       _self,
     NullOutput* self = ATX_SELF(NullOutput, BLT_OutputNode);
 
     ATX_SetMemory(status, 0, sizeof(*status));
-    status->media_time = self->media_time;
+    if (self->device.running) {
+        /* the render clock of the simulated device */
+        ATX_Int64 now = NullOutput_GetTime();
+        NullOutput_RunDevice(self, now);
+        BLT_OutputBuffer_GetStatus(self->device.buffer, now, status);
+    } else {
+        status->media_time = self->media_time;
+    }
     
     return BLT_SUCCESS;
 }
@@ -75,13 +340,34 @@ NullOutput_GetStatus(BLT_OutputNode*       _self,
 |    NullOutput_Drain
 +---------------------------------------------------------------------*/
 BLT_METHOD
-NullOutput_Drain(BLT_OutputNode* self)
+NullOutput_Drain(BLT_OutputNode* _self)
 {
-    ATX_COMPILER_UNUSED(self);
+    NullOutput* self = ATX_SELF(NullOutput, BLT_OutputNode);
+
+    /* wait until the simulated device has played everything */
+    if (self->device.running && !self->device.paused) {
+        BLT_OutputBuffer_SetDraining(self->device.buffer);
+        for (;;) {
+            BLT_Cardinal     fill;
+            ATX_Int64        wait_time;
+            ATX_TimeInterval wait;
+
+            NullOutput_RunDevice(self, NullOutput_GetTime());
+            fill = BLT_OutputBuffer_GetFill(self->device.buffer);
+            if (fill == 0) break;
+            wait_time = NullOutput_FramesToNanos(fill, self->device.format.sample_rate);
+            if (wait_time < BLT_NULL_OUTPUT_MIN_SLEEP) wait_time = BLT_NULL_OUTPUT_MIN_SLEEP;
+            wait.seconds     = (ATX_Int32)(wait_time/1000000000);
+            wait.nanoseconds = (ATX_Int32)(wait_time%1000000000);
+            ATX_System_Sleep(&wait);
+        }
+    }
+
+    NullOutput_PublishCounters(self);
+
     return BLT_SUCCESS;
 }
 
-
 /*----------------------------------------------------------------------
 |    NullOutput_PutPacket
 +---------------------------------------------------------------------*/
@@ -91,10 +377,12 @@ NullOutput_PutPacket(BLT_PacketConsumer* _self,
 {
     NullOutput*          self = ATX_SELF(NullOutput, BLT_PacketConsumer);
     const BLT_MediaType* media_type;
+    BLT_Size             size = BLT_MediaPacket_GetPayloadSize(packet);
+    ATX_Int64            now  = NullOutput_GetTime();
 
     /* check the media type */
     BLT_MediaPacket_GetMediaType(packet, &media_type);
-    if (self->expected_media_type->id != BLT_MEDIA_TYPE_ID_UNKNOWN &&
+    if (!self->accept_any_type &&
         self->expected_media_type->id != media_type->id) {
         return BLT_ERROR_INVALID_MEDIA_TYPE;
     }
@@ -102,6 +390,43 @@ NullOutput_PutPacket(BLT_PacketConsumer* _self,
     /* store the timestamp */
     self->media_time = BLT_MediaPacket_GetTimeStamp(packet);
     
+    /* update the counters */
+    if (self->counters.packets == 0) {
+        self->counters.first_packet_time = now;
+        self->counters.publish_time      = now;
+    }
+    self->counters.packets++;
+    self->counters.bytes += size;
+    self->counters.last_packet_time = now;
+
+    if (media_type->id == BLT_MEDIA_TYPE_ID_AUDIO_PCM) {
+        const BLT_PcmMediaType* pcm_type   = (const BLT_PcmMediaType*)media_type;
+        BLT_Size                frame_size = pcm_type->channel_count*pcm_type->bits_per_sample/8;
+        if (frame_size && pcm_type->sample_rate) {
+            BLT_Cardinal frame_count = size/frame_size;
+            self->counters.frames         += frame_count;
+            self->counters.media_duration += NullOutput_FramesToNanos(frame_count, pcm_type->sample_rate);
+
+            /* in paced mode, feed the simulated device */
+            if (self->mode == BLT_NULL_OUTPUT_MODE_PACED && frame_count) {
+                BLT_Result result = NullOutput_ConfigureDevice(self, pcm_type);
+                if (BLT_FAILED(result)) return result;
+                if (self->media_time.seconds || self->media_time.nanoseconds) {
+                    BLT_OutputBuffer_SetMediaTime(self->device.buffer, self->media_time);
+                }
+                NullOutput_WritePaced(self, 
+                                      (const unsigned char*)BLT_MediaPacket_GetPayloadBuffer(packet), 
+                                      frame_count);
+            }
+        }
+    }
+
+    /* let the observers of the stream know how we're doing */
+    if (now-self->counters.publish_time >= BLT_NULL_OUTPUT_PUBLISH_INTERVAL) {
+        self->counters.publish_time = now;
+        NullOutput_PublishCounters(self);
+    }
+
     return BLT_SUCCESS;
 }
 
@@ -134,6 +459,7 @@ NullOutput_Create(BLT_Module*              module,
                   BLT_CString              parameters, 
                   BLT_MediaNode**          object)
 {
+    NullOutputModule*         null_module = (NullOutputModule*)module;
     NullOutput*               self;
     BLT_MediaNodeConstructor* constructor = (BLT_MediaNodeConstructor*)parameters;
 
@@ -155,6 +481,18 @@ NullOutput_Create(BLT_Module*              module,
 
     /* construct the object */
     BLT_MediaType_Clone(constructor->spec.input.media_type, &self->expected_media_type);
+    if (self->expected_media_type->id == BLT_MEDIA_TYPE_ID_UNKNOWN ||
+        self->expected_media_type->id == null_module->probe_type_id) {
+        self->accept_any_type = BLT_TRUE;
+    }
+    self->mode        = BLT_NULL_OUTPUT_MODE_UNPACED;
+    self->buffer_time = BLT_NULL_OUTPUT_DEFAULT_BUFFER_TIME;
+    if (constructor->name && ATX_StringsEqual(constructor->name, "null:paced")) {
+        self->mode           = BLT_NULL_OUTPUT_MODE_PACED;
+        self->mode_from_name = BLT_TRUE;
+    } else if (constructor->name && ATX_StringsEqual(constructor->name, "null:unpaced")) {
+        self->mode_from_name = BLT_TRUE;
+    }
 
     /* setup interfaces */
     ATX_SET_INTERFACE_EX(self, NullOutput, BLT_BaseMediaNode, BLT_MediaNode);
@@ -173,6 +511,10 @@ NullOutput_Create(BLT_Module*              module,
 static BLT_Result
 NullOutput_Destroy(NullOutput* self)
 {
+    /* free the simulated device */
+    if (self->device.buffer) BLT_OutputBuffer_Destroy(self->device.buffer);
+    if (self->device.scratch) ATX_FreeMemory(self->device.scratch);
+
     /* free the media type extensions */
     BLT_MediaType_Free(self->expected_media_type);
 
@@ -204,6 +546,134 @@ NullOutput_GetPortByName(BLT_MediaNode*  _self,
     }
 }
 
+/*----------------------------------------------------------------------
+|    NullOutput_Activate
++---------------------------------------------------------------------*/
+BLT_METHOD
+NullOutput_Activate(BLT_MediaNode* _self, BLT_Stream* stream)
+{
+    NullOutput*     self = ATX_SELF_EX(NullOutput, BLT_BaseMediaNode, BLT_MediaNode);
+    ATX_Properties* properties;
+
+    /* keep a reference to the stream, for the counters */
+    BLT_BaseMediaNode_Activate(_self, stream);
+
+    /* read the settings, they apply to the next simulated device */
+    if (BLT_SUCCEEDED(BLT_Core_GetProperties(ATX_BASE(self, BLT_BaseMediaNode).core, &properties))) {
+        ATX_PropertyValue property;
+        if (!self->mode_from_name &&
+            ATX_SUCCEEDED(ATX_Properties_GetProperty(properties,
+                                                     BLT_NULL_OUTPUT_MODE,
+                                                     &property)) &&
+            property.type == ATX_PROPERTY_VALUE_TYPE_INTEGER) {
+            self->mode = property.data.integer == BLT_NULL_OUTPUT_MODE_PACED ?
+                         BLT_NULL_OUTPUT_MODE_PACED :
+                         BLT_NULL_OUTPUT_MODE_UNPACED;
+        }
+        if (ATX_SUCCEEDED(ATX_Properties_GetProperty(properties,
+                                                     BLT_NULL_OUTPUT_BUFFER_TIME,
+                                                     &property)) &&
+            property.type == ATX_PROPERTY_VALUE_TYPE_INTEGER &&
+            property.data.integer > 0) {
+            self->buffer_time = property.data.integer > BLT_NULL_OUTPUT_MAX_BUFFER_TIME ?
+                                BLT_NULL_OUTPUT_MAX_BUFFER_TIME :
+                                (BLT_Cardinal)property.data.integer;
+        }
+    }
+
+    ATX_LOG_FINE_2("mode = %s, buffer time = %d ms", 
+                   self->mode == BLT_NULL_OUTPUT_MODE_PACED ? "paced" : "unpaced",
+                   (int)self->buffer_time);
+
+    return BLT_SUCCESS;
+}
+
+/*----------------------------------------------------------------------
+|    NullOutput_Deactivate
++---------------------------------------------------------------------*/
+BLT_METHOD
+NullOutput_Deactivate(BLT_MediaNode* _self)
+{
+    NullOutput* self = ATX_SELF_EX(NullOutput, BLT_BaseMediaNode, BLT_MediaNode);
+
+    /* last chance to publish, while we still have the stream */
+    NullOutput_PublishCounters(self);
+    NullOutput_ResetDevice(self);
+
+    return BLT_BaseMediaNode_Deactivate(_self);
+}
+
+/*----------------------------------------------------------------------
+|    NullOutput_Stop
++---------------------------------------------------------------------*/
+BLT_METHOD
+NullOutput_Stop(BLT_MediaNode* _self)
+{
+    NullOutput* self = ATX_SELF_EX(NullOutput, BLT_BaseMediaNode, BLT_MediaNode);
+
+    NullOutput_PublishCounters(self);
+    NullOutput_ResetDevice(self);
+    self->device.paused = BLT_FALSE;
+
+    return BLT_SUCCESS;
+}
+
+/*----------------------------------------------------------------------
+|    NullOutput_Pause
++---------------------------------------------------------------------*/
+BLT_METHOD
+NullOutput_Pause(BLT_MediaNode* _self)
+{
+    NullOutput* self = ATX_SELF_EX(NullOutput, BLT_BaseMediaNode, BLT_MediaNode);
+
+    if (!self->device.paused) {
+        /* play up to now, then freeze the device clock */
+        NullOutput_RunDevice(self, NullOutput_GetTime());
+        self->device.paused = BLT_TRUE;
+    }
+
+    return BLT_SUCCESS;
+}
+
+/*----------------------------------------------------------------------
+|    NullOutput_Resume
++---------------------------------------------------------------------*/
+BLT_METHOD
+NullOutput_Resume(BLT_MediaNode* _self)
+{
+    NullOutput* self = ATX_SELF_EX(NullOutput, BLT_BaseMediaNode, BLT_MediaNode);
+
+    if (self->device.paused) {
+        /* move the start of the device clock by the time spent paused */
+        if (self->device.running) {
+            self->device.start_time = NullOutput_GetTime()-
+                                      NullOutput_FramesToNanos(self->device.played,
+                                                               self->device.format.sample_rate);
+        }
+        self->device.paused = BLT_FALSE;
+    }
+
+    return BLT_SUCCESS;
+}
+
+/*----------------------------------------------------------------------
+|    NullOutput_Seek
++---------------------------------------------------------------------*/
+BLT_METHOD
+NullOutput_Seek(BLT_MediaNode* _self,
+                BLT_SeekMode*  mode,
+                BLT_SeekPoint* point)
+{
+    NullOutput* self = ATX_SELF_EX(NullOutput, BLT_BaseMediaNode, BLT_MediaNode);
+    BLT_COMPILER_UNUSED(mode);
+    BLT_COMPILER_UNUSED(point);
+
+    /* drop what the device has not played yet */
+    NullOutput_ResetDevice(self);
+
+    return BLT_SUCCESS;
+}
+
 /*----------------------------------------------------------------------
 |   GetInterface implementation
 +---------------------------------------------------------------------*/
@@ -239,13 +709,13 @@ ATX_END_INTERFACE_MAP
 ATX_BEGIN_INTERFACE_MAP_EX(NullOutput, BLT_BaseMediaNode, BLT_MediaNode)
     BLT_BaseMediaNode_GetInfo,
     NullOutput_GetPortByName,
-    BLT_BaseMediaNode_Activate,
-    BLT_BaseMediaNode_Deactivate,
+    NullOutput_Activate,
+    NullOutput_Deactivate,
     BLT_BaseMediaNode_Start,
-    BLT_BaseMediaNode_Stop,
-    BLT_BaseMediaNode_Pause,
-    BLT_BaseMediaNode_Resume,
-    BLT_BaseMediaNode_Seek
+    NullOutput_Stop,
+    NullOutput_Pause,
+    NullOutput_Resume,
+    NullOutput_Seek
 ATX_END_INTERFACE_MAP_EX
 
 /*----------------------------------------------------------------------
@@ -263,6 +733,33 @@ ATX_IMPLEMENT_REFERENCEABLE_INTERFACE_EX(NullOutput,
                                          BLT_BaseMediaNode, 
                                          reference_count)
 
+/*----------------------------------------------------------------------
+|   NullOutputModule_Attach
++---------------------------------------------------------------------*/
+BLT_METHOD
+NullOutputModule_Attach(BLT_Module* _self, BLT_Core* core)
+{
+    NullOutputModule* self = ATX_SELF_EX(NullOutputModule, BLT_BaseModule, BLT_Module);
+    BLT_Registry*     registry;
+    BLT_Result        result;
+
+    /* get the registry */
+    result = BLT_Core_GetRegistry(core, &registry);
+    if (BLT_FAILED(result)) return result;
+
+    /* register the probe type */
+    result = BLT_Registry_GetIdForName(
+        registry,
+        BLT_REGISTRY_NAME_CATEGORY_MEDIA_TYPE_IDS,
+        BLT_OUTPUT_NODE_PROBE_MIME_TYPE,
+        &self->probe_type_id);
+    if (BLT_FAILED(result)) return result;
+
+    ATX_LOG_FINE_1("probe type = %d", self->probe_type_id);
+
+    return BLT_SUCCESS;
+}
+
 /*----------------------------------------------------------------------
 |   NullOutputModule_Probe
 +---------------------------------------------------------------------*/
@@ -291,9 +788,11 @@ NullOutputModule_Probe(BLT_Module*              self,
                 return BLT_FAILURE;
             }
 
-            /* the name should be 'null' */
+            /* the name should be 'null', 'null:paced' or 'null:unpaced' */
             if (constructor->name == NULL ||
-                !ATX_StringsEqual(constructor->name, "null")) {
+                (!ATX_StringsEqual(constructor->name, "null")        &&
+                 !ATX_StringsEqual(constructor->name, "null:paced")  &&
+                 !ATX_StringsEqual(constructor->name, "null:unpaced"))) {
                 return BLT_FAILURE;
             }
 
@@ -330,7 +829,7 @@ BLT_MODULE_IMPLEMENT_SIMPLE_MEDIA_NODE_FACTORY(NullOutputModule, NullOutput)
 +---------------------------------------------------------------------*/
 ATX_BEGIN_INTERFACE_MAP_EX(NullOutputModule, BLT_BaseModule, BLT_Module)
     BLT_BaseModule_GetInfo,
-    BLT_BaseModule_Attach,
+    NullOutputModule_Attach,
     NullOutputModule_CreateInstance,
     NullOutputModule_Probe
 ATX_END_INTERFACE_MAP
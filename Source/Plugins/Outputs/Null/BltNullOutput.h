@@ -18,6 +18,17 @@
  * It produces media nodes that simply discard the media packets they
  * receive.
  * This module responds to probes with the name 'null'.
+ * By default the nodes discard packets as fast as they arrive, which
+ * measures the throughput of the rest of the stream (unpaced mode).
+ * In paced mode they consume PCM audio at its sample rate through a
+ * simulated device with a bounded buffer, so that the stream runs as
+ * it would with a real output, without the hardware. The names
+ * 'null:paced' and 'null:unpaced' select a mode regardless of the
+ * BLT_NULL_OUTPUT_MODE core property.
+ * The nodes publish throughput counters as stream properties, about
+ * once a second and when the output is drained or stopped.
+ * When created with no type, or with the BLT_OUTPUT_NODE_PROBE_MIME_TYPE
+ * type, the nodes accept packets of any media type.
  * @{ 
  */
 
@@ -27,6 +38,39 @@
 #include "BltTypes.h"
 #include "BltModule.h"
 
+/*----------------------------------------------------------------------
+|   types
++---------------------------------------------------------------------*/
+typedef enum {
+    BLT_NULL_OUTPUT_MODE_UNPACED,
+    BLT_NULL_OUTPUT_MODE_PACED
+} BLT_NullOutputMode;
+
+/*----------------------------------------------------------------------
+|   constants
++---------------------------------------------------------------------*/
+/**
+ * Core property: mode of the nodes (integer, one of BLT_NullOutputMode).
+ * Read when a node is activated.
+ */
+#define BLT_NULL_OUTPUT_MODE        "Plugins.NullOutput.Mode"
+
+/**
+ * Core property: capacity of the simulated device buffer in paced
+ * mode, in milliseconds (integer). Defaults to 500.
+ */
+#define BLT_NULL_OUTPUT_BUFFER_TIME "Plugins.NullOutput.BufferTime"
+
+/* stream properties (integers, except where noted) */
+#define BLT_NULL_OUTPUT_PACKETS_PROPERTY       "NullOutput.Packets"
+#define BLT_NULL_OUTPUT_FRAMES_PROPERTY        "NullOutput.Frames"       /**< PCM frames   */
+#define BLT_NULL_OUTPUT_KILOBYTES_PROPERTY     "NullOutput.KiloBytes"
+#define BLT_NULL_OUTPUT_WALL_TIME_PROPERTY     "NullOutput.WallTime"     /**< ms, first to last packet */
+#define BLT_NULL_OUTPUT_SPEED_PROPERTY         "NullOutput.Speed"        /**< float, media time over wall time */
+#define BLT_NULL_OUTPUT_UNDERRUNS_PROPERTY     "NullOutput.Underruns"    /**< paced mode   */
+#define BLT_NULL_OUTPUT_UNDERRUN_TIME_PROPERTY "NullOutput.UnderrunTime" /**< ms, paced mode */
+#define BLT_NULL_OUTPUT_MAX_LATENCY_PROPERTY   "NullOutput.MaxLatency"   /**< ms, paced mode */
+
 /*----------------------------------------------------------------------
 |   module
 +---------------------------------------------------------------------*/
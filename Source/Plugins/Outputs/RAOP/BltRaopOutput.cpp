@@ -22,6 +22,8 @@
 #include "BltPacketConsumer.h"
 #include "BltMediaPacket.h"
 #include "BltVolumeControl.h"
+#include "BltAlacEncoder.h"
+#include "BltAesCbc.h"
 
 /*----------------------------------------------------------------------
 |   logging
@@ -45,12 +47,27 @@ const unsigned int BLT_RAOP_RTP_TIME_ORIGIN         = 88200;
 
 const unsigned int BLT_RAOP_AUDIO_BUFFER_SIZE_V1 = 4096*4;
 const unsigned int BLT_RAOP_AUDIO_BUFFER_SIZE_V2 = 352*4;
+const unsigned int BLT_RAOP_AUDIO_HEADER_SIZE_V1 = 16;
+const unsigned int BLT_RAOP_AUDIO_HEADER_SIZE_V2 = 12;
+const unsigned int BLT_RAOP_SYNC_PACKET_SIZE     = 20;
+const unsigned int BLT_RAOP_RESEND_HEADER_SIZE   = 4;
+
+// UDP packets go through a ring that holds the packets queued for the
+// sender thread, followed by the packets already sent, which are kept
+// to answer resend requests. The queue and history lengths must add up
+// to no more than the ring size, so that queuing a packet never
+// overwrites one that can still be resent.
+const unsigned int BLT_RAOP_PACKET_RING_SIZE      = 512;
+const unsigned int BLT_RAOP_PACKET_QUEUE_LENGTH   = 256; // ~2 seconds at 352 frames per packet
+const unsigned int BLT_RAOP_PACKET_HISTORY_LENGTH = BLT_RAOP_PACKET_RING_SIZE-BLT_RAOP_PACKET_QUEUE_LENGTH;
+const NPT_Timeout  BLT_RAOP_SENDER_IDLE_WAIT      = 1000; // ms
 
 const unsigned int BLT_RAOP_RTP_PACKET_FLAG_MARKER_BIT      = 0x80;
 const unsigned int BLT_RAOP_RTP_PACKET_TYPE_TIMING_REQUEST  = 0x52;
 const unsigned int BLT_RAOP_RTP_PACKET_TYPE_TIMING_RESPONSE = 0x53;
 const unsigned int BLT_RAOP_RTP_PACKET_TYPE_SYNC            = 0x54;
 const unsigned int BLT_RAOP_RTP_PACKET_TYPE_RESEND          = 0x55;
+const unsigned int BLT_RAOP_RTP_PACKET_TYPE_RESEND_RESPONSE = 0x56;
 const unsigned int BLT_RAOP_RTP_PACKET_TYPE_AUDIO           = 0x60;
 
 // internal RTP types 
@@ -76,6 +93,39 @@ private:
     RaopOutput& m_Output;
 };
 
+class RaopSenderThread : public NPT_Thread {
+public:
+    RaopSenderThread(RaopOutput& output);
+    ~RaopSenderThread();
+    virtual void Run();
+    
+private:
+    void SendSyncPacket(NPT_UInt32 rtp_time);
+    
+    RaopOutput&    m_Output;
+    volatile bool  m_ShouldExit;
+    NPT_TimeStamp  m_StartTime;
+    NPT_DataBuffer m_SyncPacket;
+};
+
+class RaopControlThread : public NPT_Thread {
+public:
+    RaopControlThread(RaopOutput& output) : m_Output(output) {}
+    ~RaopControlThread();
+    virtual void Run();
+    
+private:
+    void Resend(NPT_UInt16 sequence, NPT_SocketAddress& address, NPT_DataBuffer& response);
+    
+    RaopOutput& m_Output;
+};
+
+struct RaopPacket {
+    NPT_DataBuffer m_Data;
+    NPT_UInt32     m_RtpTime;
+    NPT_UInt16     m_Sequence;
+};
+
 class RaopOutput {
 public:
     RaopOutput(unsigned int version, const char* hostname, unsigned int port, const char* password);
@@ -117,10 +167,14 @@ public:
     NPT_Result AddAudio(const void* audio, unsigned int audio_size, const BLT_PcmMediaType* media_type);
     NPT_Result DrainAudio();
     NPT_Result SendAudioBuffer();
+    NPT_Size   EncodeAudioBuffer(NPT_DataBuffer& packet, unsigned int header_size);
+    NPT_Result WaitForPackets(unsigned int max_queued);
+    void       ResetPackets();
     NPT_Result SetVolume(float volume);
     NPT_Result SetMetadata(const char* metadata);
     NPT_Result UpdateMetadata();
     void       Encrypt(const unsigned char* in, unsigned char* out, unsigned int size);
+    void       AllocateAudioBuffers(unsigned int audio_buffer_size, unsigned int header_size);
     void       Reset();
     
     // utils
@@ -158,6 +212,10 @@ public:
     NPT_String                       m_RtspRecordUrl;
     unsigned int                     m_ConnectionSequence;
     NPT_BlockCipher*                 m_Cipher;
+    BLT_AesCbc*                      m_HardwareCipher;
+    bool                             m_Compress;
+    BLT_AlacEncoder*                 m_AlacEncoder;
+    NPT_DataBuffer                   m_AudioPacket;
     NPT_UInt8*                       m_AudioBuffer;
     unsigned int                     m_AudioBufferSize;
     unsigned int                     m_AudioBufferFullness;
@@ -168,12 +226,23 @@ public:
     NPT_UInt32                       m_RtpTime;
     NPT_UInt32                       m_RtpSequence;
     bool                             m_RtpMarker;
-    NPT_TimeStamp                    m_StartTime;
     NPT_UdpSocket*                   m_ControlSocket;
     unsigned int                     m_ControlPort;
+    NPT_SocketAddress                m_ServerControlAddress;
     NPT_UdpSocket*                   m_TimingSocket;
     unsigned int                     m_TimingPort;
     RaopTimingThread*                m_TimingThread;
+    
+    // UDP packet ring, shared with the sender and control threads
+    NPT_Mutex                        m_PacketLock;
+    NPT_SharedVariable               m_PacketQueued; // wakes up the sender thread
+    NPT_SharedVariable               m_PacketSent;   // wakes up the decoder thread
+    RaopPacket*                      m_Packets;
+    NPT_UInt32                       m_PacketsSent;
+    NPT_UInt32                       m_PacketsWritten;
+    NPT_UInt32                       m_PacketGeneration;
+    RaopSenderThread*                m_SenderThread;
+    RaopControlThread*               m_ControlThread;
 };
 
 typedef struct {
@@ -198,51 +267,6 @@ BLT_METHOD RaopOutput_Resume(BLT_MediaNode* self);
 BLT_METHOD RaopOutput_Stop(BLT_MediaNode* self);
 BLT_METHOD RaopOutput_Drain(BLT_OutputNode* self);
 
-/*----------------------------------------------------------------------
-|    RaopBitWriter
-+---------------------------------------------------------------------*/
-class RaopBitWriter
-{
-public:
-    RaopBitWriter(unsigned int size) : m_DataSize(size), m_BitCount(0) {
-        m_Data = new unsigned char[size];
-        NPT_SetMemory(m_Data, 0, size);
-    }
-    ~RaopBitWriter() { delete[] m_Data; }
-    
-    void Write(unsigned int bits, unsigned int bit_count);
-    
-    unsigned char* m_Data;
-    unsigned int   m_DataSize;
-    unsigned int   m_BitCount;
-};
-
-/*----------------------------------------------------------------------
-|   RaopBitstream::Write
-+---------------------------------------------------------------------*/
-void 
-RaopBitWriter::Write(unsigned int bits, unsigned int bit_count)
-{
-    unsigned char* data = m_Data;
-    if (m_BitCount+bit_count > m_DataSize*8) return;
-    data += m_BitCount/8;
-    unsigned int space = 8-(m_BitCount%8);
-    while (bit_count) {
-        unsigned int mask = bit_count==32 ? 0xFFFFFFFF : ((1<<bit_count)-1);
-        if (bit_count <= space) {
-            *data |= ((bits&mask) << (space-bit_count));
-            m_BitCount += bit_count;
-            return;
-        } else {
-            *data |= ((bits&mask) >> (bit_count-space));
-            ++data;
-            m_BitCount += space;
-            bit_count  -= space;
-            space       = 8;
-        }
-    }
-}
-
 /*----------------------------------------------------------------------
 |    BLT_TimeStampToNtpTime
 +---------------------------------------------------------------------*/
@@ -690,6 +714,9 @@ RaopOutput::RaopOutput(unsigned int version, const char* hostname, unsigned int
     m_AudioLatency(0),
     m_ConnectionSequence(1),
     m_Cipher(NULL),
+    m_HardwareCipher(NULL),
+    m_Compress(true),
+    m_AlacEncoder(NULL),
     m_AudioBuffer(NULL),
     m_AudioBufferSize(0),
     m_AudioBufferFullness(0),
@@ -703,7 +730,15 @@ RaopOutput::RaopOutput(unsigned int version, const char* hostname, unsigned int
     m_ControlPort(0),
     m_TimingSocket(NULL),
     m_TimingPort(0),
-    m_TimingThread(NULL)
+    m_TimingThread(NULL),
+    m_PacketQueued(0),
+    m_PacketSent(0),
+    m_Packets(NULL),
+    m_PacketsSent(0),
+    m_PacketsWritten(0),
+    m_PacketGeneration(0),
+    m_SenderThread(NULL),
+    m_ControlThread(NULL)
 {
     m_MediaType.sample_rate     = 0;
     m_MediaType.channel_count   = 0;
@@ -719,6 +754,9 @@ RaopOutput::RaopOutput(unsigned int version, const char* hostname, unsigned int
                             NPT_BlockCipher::ENCRYPT, 
                             key, 16, 
                             m_Cipher);     
+    if (BLT_SUCCEEDED(BLT_AesCbc_Create(key, &m_HardwareCipher))) {
+        ATX_LOG_FINE("using AES instructions");
+    }
                             
     m_AudioResampleBuffer[0] = 0;
     m_AudioResampleBuffer[1] = 0;
@@ -730,7 +768,13 @@ RaopOutput::RaopOutput(unsigned int version, const char* hostname, unsigned int
 RaopOutput::~RaopOutput()
 {
     delete m_TimingThread;
+    delete m_ControlThread;
+    delete m_SenderThread;
+    delete[] m_Packets;
     delete[] m_AudioBuffer;
+    delete m_Cipher;
+    if (m_HardwareCipher) BLT_AesCbc_Destroy(m_HardwareCipher);
+    if (m_AlacEncoder) BLT_AlacEncoder_Destroy(m_AlacEncoder);
     delete m_RtpSocket;
     delete m_ControlSocket;
     delete m_TimingSocket;
@@ -1134,11 +1178,17 @@ RaopOutput::Announce()
         "t=0 0\r\n"
         "m=audio 0 RTP/AVP 96\r\n"
         "a=rtpmap:96 AppleLossless\r\n"
-        "a=fmtp:96 %d 0 16 40 10 14 2 255 0 0 44100\r\n",
+        "a=fmtp:96 %d 0 %d %d %d %d %d %d 0 0 44100\r\n",
         m_ClientSessionId.GetChars(), 
         m_LocalIpAddress.ToString().GetChars(), 
         m_RemoteIpAddress.ToString().GetChars(),
-        (m_Version==0)?4096:352);
+        (m_Version==0)?4096:352,
+        BLT_ALAC_ENCODER_BIT_DEPTH,
+        BLT_ALAC_ENCODER_RICE_HISTORY_MULT,
+        BLT_ALAC_ENCODER_INITIAL_HISTORY,
+        BLT_ALAC_ENCODER_RICE_LIMIT,
+        BLT_ALAC_ENCODER_CHANNEL_COUNT,
+        BLT_ALAC_ENCODER_MAX_RUN);
     if (m_UseEncryption) {
         sdp += 
         "a=rsaaeskey:"
@@ -1166,6 +1216,38 @@ RaopOutput::Announce()
     return NPT_SUCCESS;
 }
 
+/*----------------------------------------------------------------------
+|    RaopOutput::AllocateAudioBuffers
++---------------------------------------------------------------------*/
+void
+RaopOutput::AllocateAudioBuffers(unsigned int audio_buffer_size, unsigned int header_size)
+{
+    // keep the buffers of the previous connection if they are the same,
+    // so that reconnecting from SendAudioBuffer doesn't lose the audio
+    if (m_AudioBuffer && m_AudioBufferSize == audio_buffer_size) return;
+    
+    delete[] m_AudioBuffer;
+    m_AudioBuffer         = new unsigned char[audio_buffer_size];
+    m_AudioBufferSize     = audio_buffer_size;
+    m_AudioBufferFullness = 0;
+    
+    // the packets are built in place: header, then the ALAC frame
+    if (m_AlacEncoder) BLT_AlacEncoder_Destroy(m_AlacEncoder);
+    m_AlacEncoder = NULL;
+    BLT_AlacEncoder_Create(audio_buffer_size/4, m_Compress?BLT_TRUE:BLT_FALSE, &m_AlacEncoder);
+    unsigned int packet_size = header_size+BLT_AlacEncoder_GetMaxFrameSize(m_AlacEncoder);
+    if (m_Version == 0) {
+        m_AudioPacket.SetBufferSize(packet_size);
+    } else {
+        delete[] m_Packets;
+        m_Packets = new RaopPacket[BLT_RAOP_PACKET_RING_SIZE];
+        for (unsigned int i=0; i<BLT_RAOP_PACKET_RING_SIZE; i++) {
+            m_Packets[i].m_Data.SetBufferSize(packet_size);
+        }
+        ResetPackets();
+    }
+}
+
 /*----------------------------------------------------------------------
 |    RaopOutput::Setup
 +---------------------------------------------------------------------*/
@@ -1177,16 +1259,11 @@ RaopOutput::Setup()
     NPT_Result result;
     
     NPT_String extra_headers;
-    delete m_AudioBuffer;
     if (m_Version == 0) {
-        m_AudioBuffer         = new unsigned char[BLT_RAOP_AUDIO_BUFFER_SIZE_V1];
-        m_AudioBufferSize     = BLT_RAOP_AUDIO_BUFFER_SIZE_V1;
-        m_AudioBufferFullness = 0;
+        AllocateAudioBuffers(BLT_RAOP_AUDIO_BUFFER_SIZE_V1, BLT_RAOP_AUDIO_HEADER_SIZE_V1);
         extra_headers = "Transport: RTP/AVP/TCP;unicast;interleaved=0-1;mode=record\r\n";
     } else if (m_Version == 1) {
-        m_AudioBuffer         = new unsigned char[BLT_RAOP_AUDIO_BUFFER_SIZE_V2];
-        m_AudioBufferSize     = BLT_RAOP_AUDIO_BUFFER_SIZE_V2;
-        m_AudioBufferFullness = 0;
+        AllocateAudioBuffers(BLT_RAOP_AUDIO_BUFFER_SIZE_V2, BLT_RAOP_AUDIO_HEADER_SIZE_V2);
         
         // create UDP sockets unless we already have them
         if (m_RtpSocket == NULL) {
@@ -1255,8 +1332,10 @@ RaopOutput::Setup()
         if (control_port_position > 0) {
             NPT_ParseInteger(transport->GetChars()+control_port_position+14, m_ServerControlPort, true);
             ATX_LOG_FINE_1("control_port=%d", m_ServerControlPort);
-            NPT_SocketAddress control_address(m_RemoteIpAddress, m_ServerControlPort);
-            m_ControlSocket->Connect(control_address);
+            
+            // the control socket stays unconnected, like the timing socket,
+            // so that its thread can be woken up with a local packet
+            m_ServerControlAddress = NPT_SocketAddress(m_RemoteIpAddress, m_ServerControlPort);
         }
         int timing_port_position = transport->Find(";timing_port=");
         if (timing_port_position > 0) {
@@ -1273,6 +1352,16 @@ RaopOutput::Setup()
         m_TimingThread = new RaopTimingThread(*this);
         m_TimingThread->Start();
     }
+    
+    // setup the threads that send the audio packets and resend lost ones
+    if (m_Version == 1 && m_SenderThread == NULL) {
+        m_SenderThread = new RaopSenderThread(*this);
+        m_SenderThread->Start();
+    }
+    if (m_Version == 1 && m_ControlThread == NULL) {
+        m_ControlThread = new RaopControlThread(*this);
+        m_ControlThread->Start();
+    }
         
     DiscardResponseBody(response);
     delete response;    
@@ -1430,6 +1519,9 @@ RaopOutput::Flush()
 {
     if (!m_Connected || !m_Setup) return BLT_SUCCESS;
     
+    // stop sending what is queued before the receiver flushes
+    ResetPackets();
+    
     NPT_String extra_headers = NPT_String::Format("RTP-Info: seq=%d;rtptime=%d\r\n",
                                                   m_RtpSequence,
                                                   BLT_RAOP_RTP_TIME_ORIGIN/*m_RtpTime*/);
@@ -1447,6 +1539,7 @@ RaopOutput::Flush()
     
     // flush internal buffers
     m_AudioBufferFullness = 0;
+    if (m_AlacEncoder) BLT_AlacEncoder_Reset(m_AlacEncoder);
     m_RtpTime = BLT_RAOP_RTP_TIME_ORIGIN;
     m_RtpSequence = 0;
     m_AudioResampleBuffer[0] = 0;
@@ -1495,6 +1588,47 @@ RaopOutput::Reset()
     m_ConnectionSequence  = 1;
     m_RtpSequence         = 0;
     m_RtpTime             = BLT_RAOP_RTP_TIME_ORIGIN;
+    ResetPackets();
+}
+
+/*----------------------------------------------------------------------
+|    RaopOutput::ResetPackets
++---------------------------------------------------------------------*/
+void
+RaopOutput::ResetPackets()
+{
+    NPT_AutoLock lock(m_PacketLock);
+    
+    // the history goes too, the sequence numbers start over
+    m_PacketsSent    = 0;
+    m_PacketsWritten = 0;
+    ++m_PacketGeneration;
+    
+    // the sender may be waiting to send a packet that is now gone
+    m_PacketQueued.SetValue(1);
+}
+
+/*----------------------------------------------------------------------
+|    RaopOutput::WaitForPackets
++---------------------------------------------------------------------*/
+NPT_Result
+RaopOutput::WaitForPackets(unsigned int max_queued)
+{
+    if (m_SenderThread == NULL) return BLT_ERROR_INVALID_STATE;
+    
+    for (;;) {
+        m_PacketSent.SetValue(0);
+        {
+            NPT_AutoLock lock(m_PacketLock);
+            if (m_PacketsWritten-m_PacketsSent <= max_queued) return NPT_SUCCESS;
+        }
+        
+        // the sender sends a packet every few milliseconds, unless it is stuck
+        if (m_PacketSent.WaitUntilEquals(1, BLT_RAOP_MAX_THREAD_WAIT_TIMEOUT) == NPT_ERROR_TIMEOUT) {
+            ATX_LOG_WARNING("timed out waiting for the sender thread");
+            return NPT_ERROR_TIMEOUT;
+        }
+    }
 }
 
 /*----------------------------------------------------------------------
@@ -1508,6 +1642,12 @@ RaopOutput::Encrypt(const unsigned char* in, unsigned char* out, unsigned int si
 
     // process all blocks
     unsigned int block_count = size/16;
+    if (m_HardwareCipher) {
+        BLT_AesCbc_Encrypt(m_HardwareCipher, chain, in, out, block_count);
+        in  += block_count*16;
+        out += block_count*16;
+        block_count = 0;
+    }
     for (unsigned int x=0; x<block_count; x++) {
         // xor with the chaining block
         for (unsigned int y=0; y<16; y++) {
@@ -1524,11 +1664,31 @@ RaopOutput::Encrypt(const unsigned char* in, unsigned char* out, unsigned int si
     }
     
     // copy any remaining partial block data unencrypted
-    if (size%16) {
+    if (size%16 && in != out) {
         NPT_CopyMemory(out, in, size%16);
     }
 }
             
+/*----------------------------------------------------------------------
+|    RaopOutput::EncodeAudioBuffer
++---------------------------------------------------------------------*/
+NPT_Size
+RaopOutput::EncodeAudioBuffer(NPT_DataBuffer& packet, unsigned int header_size)
+{
+    // encode the ALAC frame in place, after the room for the header
+    unsigned char* data      = packet.UseData();
+    NPT_Size       alac_size = BLT_AlacEncoder_EncodeFrame(m_AlacEncoder,
+                                                           (const BLT_Int16*)m_AudioBuffer,
+                                                           m_AudioBufferFullness/4,
+                                                           data+header_size);
+    if (m_UseEncryption) {
+        Encrypt(data+header_size, data+header_size, alac_size);
+    }
+    packet.SetDataSize(header_size+alac_size);
+    
+    return alac_size;
+}
+
 /*----------------------------------------------------------------------
 |    RaopOutput::SendAudioBuffer
 +---------------------------------------------------------------------*/
@@ -1537,21 +1697,6 @@ RaopOutput::SendAudioBuffer()
 {
     unsigned int sample_count = m_AudioBufferFullness/4;
     
-    // compute the ALAC bitstream
-    unsigned int alac_size = sample_count*4+3+4;
-    RaopBitWriter alac(alac_size);
-    alac.Write(1,  3); // channel count (1=stereo)
-    alac.Write(0, 16); // unknown
-    alac.Write(1,  1); // has_size
-    alac.Write(0,  2); // unknown
-    alac.Write(1,  1); // uncompressed
-    alac.Write(sample_count, 32); // sample count
-    unsigned char* samples = m_AudioBuffer;
-    for (unsigned int i=0; i<m_AudioBufferFullness; i += 2, samples += 2) {
-        unsigned int sample = samples[0]<<8 | samples[1];
-        alac.Write(sample, 16);
-    }
-    
     // auto-reconnect if needed
     NPT_Result result;
     if (!m_Connected || !m_Setup) {
@@ -1563,6 +1708,8 @@ RaopOutput::SendAudioBuffer()
     }
 
     if (m_Version == 0) {
+        NPT_Size alac_size = EncodeAudioBuffer(m_AudioPacket, BLT_RAOP_AUDIO_HEADER_SIZE_V1);
+        
         // compute the header
         NPT_UInt8 header[16] = {
             0x24, 0x00, 0x00, 0x00,
@@ -1571,19 +1718,10 @@ RaopOutput::SendAudioBuffer()
             0x00, 0x00, 0x00, 0x00,
         };
         NPT_BytesFromInt16Be(&header[2], 12+alac_size);
-
-        // create the output audio payload
-        NPT_DataBuffer payload;
-        payload.SetDataSize(16+alac_size);
-        NPT_CopyMemory(payload.UseData(), header, 16);
-        if (m_UseEncryption) {
-            Encrypt(alac.m_Data, payload.UseData()+16, alac_size);
-        } else {
-            NPT_CopyMemory(payload.UseData()+16, alac.m_Data, alac_size);
-        }
+        NPT_CopyMemory(m_AudioPacket.UseData(), header, 16);
     
         ATX_LOG_FINER("sending audio buffer over TCP");
-        result = m_AudioOutputStream->WriteFully(payload.GetData(), payload.GetDataSize());
+        result = m_AudioOutputStream->WriteFully(m_AudioPacket.GetData(), m_AudioPacket.GetDataSize());
         if (NPT_FAILED(result)) {
             ATX_LOG_FINER_1("WriteFully failed (%d)", result);
             if (result == NPT_ERROR_CONNECTION_RESET || result == NPT_ERROR_CONNECTION_ABORTED) {
@@ -1592,71 +1730,35 @@ RaopOutput::SendAudioBuffer()
             }
         }
     } else {
-        // compute the header
-        NPT_UInt8 rtp_header[12];
-        rtp_header[0] = 0x80;
-        rtp_header[1] = BLT_RAOP_RTP_PACKET_TYPE_AUDIO | (m_RtpMarker?BLT_RAOP_RTP_PACKET_FLAG_MARKER_BIT:0);
-        NPT_BytesFromInt16Be(&rtp_header[2], m_RtpSequence);
-        NPT_BytesFromInt32Be(&rtp_header[4], m_RtpTime);
-        NPT_SetMemory(&rtp_header[8], 0, 4);
-                
-        // send SYNC packets at regular intervals
-        if (((m_RtpSequence)%BLT_RAOP_SYNC_PACKET_INTERVAL) == 0) {
-            bool first_sync = m_RtpTime == BLT_RAOP_RTP_TIME_ORIGIN;
-            NPT_DataBuffer sync_packet;
-            sync_packet.SetDataSize(20);
-            unsigned char* payload = sync_packet.UseData();
-            payload[0] = first_sync?0x90:0x80;
-            payload[1] = BLT_RAOP_RTP_PACKET_TYPE_SYNC | BLT_RAOP_RTP_PACKET_FLAG_MARKER_BIT;
-            payload[2] = 0;
-            payload[3] = 7;
-            NPT_BytesFromInt32Be(&payload[4], m_RtpTime-BLT_RAOP_DEFAULT_AUDIO_LATENCY);
-            NPT_BytesFromInt32Be(&payload[16], m_RtpTime);
-
-            NPT_TimeStamp now;
-            NPT_System::GetCurrentTimeStamp(now);
-            BLT_TimeStamp_ToNtpTime(now, &payload[8]);
-            
-            ATX_LOG_FINE("sending sync packet");
-            m_ControlSocket->Send(sync_packet);
-        }
-
-        // wait until it is time to send the buffer
-        NPT_TimeStamp now;
-        NPT_System::GetCurrentTimeStamp(now);
-        if (m_RtpTime == BLT_RAOP_RTP_TIME_ORIGIN) {
-            m_StartTime = now;
-        } else {
-            double elapsed = (double)(now.ToNanos()-m_StartTime.ToNanos())/1000000000.0;
-            double target = (double)(m_RtpTime-BLT_RAOP_RTP_TIME_ORIGIN)/44100.0;
-            double delta = target-elapsed;
-            if (delta > 0.001) {
-                if (delta > BLT_RAOP_MAX_DELAY) {
-                    ATX_LOG_WARNING("unexpected large delay, recalibrating");
-                    m_StartTime = now;
-                }
-                NPT_System::Sleep(delta);
-            }
-        }
-
+        // wait for room in the queue: the sender thread paces the packets,
+        // so this is where the decoder gets held back, once it is far
+        // enough ahead
+        result = WaitForPackets(BLT_RAOP_PACKET_QUEUE_LENGTH-1);
+        if (NPT_FAILED(result)) return result;
+        
+        // build the packet in the ring, where it stays for resending
+        // after it is sent
+        RaopPacket& packet = m_Packets[m_PacketsWritten%BLT_RAOP_PACKET_RING_SIZE];
+        EncodeAudioBuffer(packet.m_Data, BLT_RAOP_AUDIO_HEADER_SIZE_V2);
+        unsigned char* header = packet.m_Data.UseData();
+        header[0] = 0x80;
+        header[1] = BLT_RAOP_RTP_PACKET_TYPE_AUDIO | (m_RtpMarker?BLT_RAOP_RTP_PACKET_FLAG_MARKER_BIT:0);
+        NPT_BytesFromInt16Be(&header[2], m_RtpSequence);
+        NPT_BytesFromInt32Be(&header[4], m_RtpTime);
+        NPT_SetMemory(&header[8], 0, 4);
+        packet.m_Sequence = (NPT_UInt16)m_RtpSequence;
+        packet.m_RtpTime  = m_RtpTime;
+        
         // update RTP state
         if (m_RtpMarker) m_RtpMarker = false;
-                
-        // create the output audio payload
-        NPT_DataBuffer payload;
-        payload.SetDataSize(12+alac_size);
-        NPT_CopyMemory(payload.UseData(), rtp_header, 12);
-        if (m_UseEncryption) {
-            Encrypt(alac.m_Data, payload.UseData()+12, alac_size);
-        } else {
-            NPT_CopyMemory(payload.UseData()+12, alac.m_Data, alac_size);
+        
+        // queue it
+        {
+            NPT_AutoLock lock(m_PacketLock);
+            bool was_empty = (m_PacketsSent == m_PacketsWritten);
+            ++m_PacketsWritten;
+            if (was_empty) m_PacketQueued.SetValue(1);
         }
-    
-        ATX_LOG_FINER("sending audio buffer over UDP");
-        result = m_RtpSocket->Send(payload);
-        if (NPT_FAILED(result)) {
-            ATX_LOG_FINER_1("Send failed (%d)", result);
-        }        
     }
     
     // update RTP counters
@@ -1674,22 +1776,15 @@ RaopOutput::AddAudio(const void*             audio,
                      unsigned int            audio_size, 
                      const BLT_PcmMediaType* media_type)
 {
+    BLT_COMPILER_UNUSED(media_type);
+    
     while (audio_size >= 2) {
         unsigned int chunk = m_AudioBufferSize-m_AudioBufferFullness;
         if (chunk > audio_size) {
             chunk = audio_size;
         }
-        if (media_type->sample_format == BLT_PCM_SAMPLE_FORMAT_SIGNED_INT_BE) {
-            NPT_CopyMemory(&m_AudioBuffer[m_AudioBufferFullness], audio, chunk);
-        } else {
-            // swap bytes
-            const unsigned char* in  = (const unsigned char*)audio;
-            unsigned char*       out = (unsigned char*)&m_AudioBuffer[m_AudioBufferFullness];
-            for (unsigned int i=0; i<chunk/2; i++, in += 2, out += 2) {
-                out[1] = in[0];
-                out[0] = in[1];
-            }
-        }
+        // the encoder takes native byte order samples, which is all we accept
+        NPT_CopyMemory(&m_AudioBuffer[m_AudioBufferFullness], audio, chunk);
         m_AudioBufferFullness += chunk;
         audio_size            -= chunk;
         audio                  = (const void*)((const char*)audio+chunk);
@@ -1718,6 +1813,11 @@ RaopOutput::DrainAudio()
         if (NPT_FAILED(result)) return result;
     }
     
+    // wait until the sender thread has sent everything
+    if (m_Version == 1 && m_Connected && m_Setup) {
+        return WaitForPackets(0);
+    }
+    
     return BLT_SUCCESS;
 }
 
@@ -1985,11 +2085,12 @@ RaopTimingThread::Run()
 }
 
 /*----------------------------------------------------------------------
-|    RaopTimingThread::~RaopTimingThread
+|    RaopTerminateThread
 +---------------------------------------------------------------------*/
-RaopTimingThread::~RaopTimingThread()
+static void
+RaopTerminateThread(NPT_Thread& thread, NPT_UdpSocket* socket)
 {
-    // send ourselves a termination packet
+    // send a termination packet to the socket the thread is reading from
     NPT_DataBuffer terminate_packet;
     terminate_packet.SetDataSize(8);
     unsigned char* payload = terminate_packet.UseData();
@@ -1997,10 +2098,9 @@ RaopTimingThread::~RaopTimingThread()
     payload[0] = 0x80;
     payload[1] = BLT_RAOP_RTP_PACKET_TYPE_TERMINATE;
     
-    // sending kill packet to timing socket
     NPT_UdpSocket kill_socket;
     NPT_SocketInfo socket_info;
-    m_Output.m_TimingSocket->GetInfo(socket_info);
+    socket->GetInfo(socket_info);
     NPT_IpAddress localhost;
     localhost.ResolveName("localhost");
     socket_info.local_address.SetIpAddress(localhost);
@@ -2008,13 +2108,229 @@ RaopTimingThread::~RaopTimingThread()
     
     // wait for thread to terminate
     ATX_LOG_FINE("waiting for thread to terminate");
-    NPT_Result result = Wait(BLT_RAOP_MAX_THREAD_WAIT_TIMEOUT);
+    NPT_Result result = thread.Wait(BLT_RAOP_MAX_THREAD_WAIT_TIMEOUT);
     if (result == NPT_ERROR_TIMEOUT) {
         ATX_LOG_WARNING("timed out waiting for thread");
     }
     ATX_LOG_FINE("thread terminated");
 }
 
+/*----------------------------------------------------------------------
+|    RaopTimingThread::~RaopTimingThread
++---------------------------------------------------------------------*/
+RaopTimingThread::~RaopTimingThread()
+{
+    RaopTerminateThread(*this, m_Output.m_TimingSocket);
+}
+
+/*----------------------------------------------------------------------
+|    RaopSenderThread::RaopSenderThread
++---------------------------------------------------------------------*/
+RaopSenderThread::RaopSenderThread(RaopOutput& output) :
+    m_Output(output),
+    m_ShouldExit(false)
+{
+    m_SyncPacket.SetDataSize(BLT_RAOP_SYNC_PACKET_SIZE);
+}
+
+/*----------------------------------------------------------------------
+|    RaopSenderThread::~RaopSenderThread
++---------------------------------------------------------------------*/
+RaopSenderThread::~RaopSenderThread()
+{
+    m_ShouldExit = true;
+    m_Output.m_PacketQueued.SetValue(1);
+    
+    ATX_LOG_FINE("waiting for sender thread to terminate");
+    if (Wait(BLT_RAOP_MAX_THREAD_WAIT_TIMEOUT) == NPT_ERROR_TIMEOUT) {
+        ATX_LOG_WARNING("timed out waiting for sender thread");
+    }
+}
+
+/*----------------------------------------------------------------------
+|    RaopSenderThread::SendSyncPacket
++---------------------------------------------------------------------*/
+void
+RaopSenderThread::SendSyncPacket(NPT_UInt32 rtp_time)
+{
+    bool first_sync = rtp_time == BLT_RAOP_RTP_TIME_ORIGIN;
+    unsigned char* payload = m_SyncPacket.UseData();
+    NPT_SetMemory(payload, 0, BLT_RAOP_SYNC_PACKET_SIZE);
+    payload[0] = first_sync?0x90:0x80;
+    payload[1] = BLT_RAOP_RTP_PACKET_TYPE_SYNC | BLT_RAOP_RTP_PACKET_FLAG_MARKER_BIT;
+    payload[2] = 0;
+    payload[3] = 7;
+    NPT_BytesFromInt32Be(&payload[4], rtp_time-BLT_RAOP_DEFAULT_AUDIO_LATENCY);
+    NPT_BytesFromInt32Be(&payload[16], rtp_time);
+
+    NPT_TimeStamp now;
+    NPT_System::GetCurrentTimeStamp(now);
+    BLT_TimeStamp_ToNtpTime(now, &payload[8]);
+    
+    ATX_LOG_FINE("sending sync packet");
+    m_Output.m_ControlSocket->Send(m_SyncPacket, &m_Output.m_ServerControlAddress);
+}
+
+/*----------------------------------------------------------------------
+|    RaopSenderThread::Run
++---------------------------------------------------------------------*/
+void
+RaopSenderThread::Run()
+{
+    for (;;) {
+        m_Output.m_PacketQueued.SetValue(0);
+        if (m_ShouldExit) {
+            ATX_LOG_FINE("terminating sender thread");
+            return;
+        }
+        
+        // look at the next packet to send
+        NPT_UInt32 rtp_time   = 0;
+        NPT_UInt32 generation = 0;
+        bool       queued     = false;
+        {
+            NPT_AutoLock lock(m_Output.m_PacketLock);
+            if (m_Output.m_PacketsSent != m_Output.m_PacketsWritten) {
+                rtp_time = m_Output.m_Packets[m_Output.m_PacketsSent%BLT_RAOP_PACKET_RING_SIZE].m_RtpTime;
+                queued   = true;
+            }
+            generation = m_Output.m_PacketGeneration;
+        }
+        if (!queued) {
+            m_Output.m_PacketQueued.WaitUntilEquals(1, BLT_RAOP_SENDER_IDLE_WAIT);
+            continue;
+        }
+        
+        // wait until it is time to send it, unless the queue is flushed
+        // in the meantime
+        NPT_TimeStamp now;
+        NPT_System::GetCurrentTimeStamp(now);
+        double target = (double)(rtp_time-BLT_RAOP_RTP_TIME_ORIGIN)/44100.0;
+        if (rtp_time == BLT_RAOP_RTP_TIME_ORIGIN) {
+            m_StartTime = now;
+        } else {
+            double elapsed = (double)(now.ToNanos()-m_StartTime.ToNanos())/1000000000.0;
+            double delta = target-elapsed;
+            if (delta > BLT_RAOP_MAX_DELAY) {
+                ATX_LOG_WARNING("unexpected large delay, recalibrating");
+                m_StartTime = NPT_TimeStamp((double)now-target);
+            } else if (delta > 0.001) {
+                m_Output.m_PacketQueued.WaitUntilEquals(1, (NPT_Timeout)(delta*1000.0));
+                continue;
+            }
+        }
+        
+        // send it, along with a sync packet at regular intervals
+        {
+            NPT_AutoLock lock(m_Output.m_PacketLock);
+            if (generation != m_Output.m_PacketGeneration) continue;
+            const RaopPacket& packet = m_Output.m_Packets[m_Output.m_PacketsSent%BLT_RAOP_PACKET_RING_SIZE];
+            if ((packet.m_Sequence%BLT_RAOP_SYNC_PACKET_INTERVAL) == 0 && m_Output.m_ServerControlPort) {
+                SendSyncPacket(packet.m_RtpTime);
+            }
+            
+            ATX_LOG_FINER("sending audio buffer over UDP");
+            NPT_Result result = m_Output.m_RtpSocket->Send(packet.m_Data);
+            if (NPT_FAILED(result)) {
+                ATX_LOG_FINER_1("Send failed (%d)", result);
+            }
+            ++m_Output.m_PacketsSent;
+        }
+        m_Output.m_PacketSent.SetValue(1);
+    }
+}
+
+/*----------------------------------------------------------------------
+|    RaopControlThread::~RaopControlThread
++---------------------------------------------------------------------*/
+RaopControlThread::~RaopControlThread()
+{
+    RaopTerminateThread(*this, m_Output.m_ControlSocket);
+}
+
+/*----------------------------------------------------------------------
+|    RaopControlThread::Resend
++---------------------------------------------------------------------*/
+void
+RaopControlThread::Resend(NPT_UInt16         sequence, 
+                          NPT_SocketAddress& address,
+                          NPT_DataBuffer&    response)
+{
+    NPT_AutoLock lock(m_Output.m_PacketLock);
+    
+    // find the packet in the history
+    NPT_UInt32 sent = m_Output.m_PacketsSent;
+    NPT_UInt16 age  = (NPT_UInt16)((NPT_UInt16)sent-sequence);
+    if (age == 0 || age > BLT_RAOP_PACKET_HISTORY_LENGTH || age > sent) {
+        ATX_LOG_FINE_1("packet %d is not in the history", sequence);
+        return;
+    }
+    const RaopPacket& packet = m_Output.m_Packets[(sent-age)%BLT_RAOP_PACKET_RING_SIZE];
+    if (packet.m_Sequence != sequence) return;
+    
+    // send it back as it was, after a resend response header
+    response.SetDataSize(BLT_RAOP_RESEND_HEADER_SIZE+packet.m_Data.GetDataSize());
+    unsigned char* payload = response.UseData();
+    payload[0] = 0x80;
+    payload[1] = BLT_RAOP_RTP_PACKET_TYPE_RESEND_RESPONSE | BLT_RAOP_RTP_PACKET_FLAG_MARKER_BIT;
+    NPT_BytesFromInt16Be(&payload[2], sequence);
+    NPT_CopyMemory(&payload[BLT_RAOP_RESEND_HEADER_SIZE], packet.m_Data.GetData(), packet.m_Data.GetDataSize());
+    m_Output.m_ControlSocket->Send(response, &address);
+}
+
+/*----------------------------------------------------------------------
+|    RaopControlThread::Run
++---------------------------------------------------------------------*/
+void
+RaopControlThread::Run()
+{
+    NPT_DataBuffer request_buffer(32);
+    NPT_DataBuffer response_buffer;
+    
+    for (;;) {
+        ATX_LOG_FINE("waiting for request on control port...");
+        NPT_SocketAddress remote_address;
+        NPT_Result result = m_Output.m_ControlSocket->Receive(request_buffer, &remote_address);
+        if (NPT_FAILED(result)) {
+            ATX_LOG_WARNING_1("failed to read datagram (%d)", result);
+            return;
+        }
+        if (request_buffer.GetDataSize() < 8) {
+            ATX_LOG_WARNING_1("packet too small (%d)", request_buffer.GetDataSize());
+            continue;
+        }
+        const unsigned char* request = request_buffer.GetData();
+        unsigned int packet_type  = 0;
+        unsigned int packet_flags = 0;
+        result = RaopParseRtpHeader(request, packet_type, packet_flags);
+        if (NPT_FAILED(result)) continue;
+        
+        switch (packet_type) {
+            case BLT_RAOP_RTP_PACKET_TYPE_RESEND: {
+                // the request has the first missing sequence number and a count
+                NPT_UInt16   first = NPT_BytesToInt16Be(&request[4]);
+                unsigned int count = NPT_BytesToInt16Be(&request[6]);
+                ATX_LOG_FINE_2("resend request for %d packets from %d", count, first);
+                if (count > BLT_RAOP_PACKET_HISTORY_LENGTH) {
+                    count = BLT_RAOP_PACKET_HISTORY_LENGTH;
+                }
+                for (unsigned int i=0; i<count; i++) {
+                    Resend((NPT_UInt16)(first+i), remote_address, response_buffer);
+                }
+                break;
+            }
+                
+            case BLT_RAOP_RTP_PACKET_TYPE_TERMINATE:
+                ATX_LOG_FINE("terminating control thread");
+                return;
+                
+            default:
+                ATX_LOG_FINE("unknown request");
+                break;
+        }
+    }
+}
+
 /*----------------------------------------------------------------------
 |    RaopOutput_Create
 +---------------------------------------------------------------------*/
@@ -2073,6 +2389,18 @@ RaopOutput_Create(BLT_Module*              module,
     }
     self->object = new RaopOutput(version, hostname, port, password);
     
+    /* read the settings */
+    ATX_Properties* properties = NULL;
+    if (BLT_SUCCEEDED(BLT_Core_GetProperties(core, &properties))) {
+        ATX_PropertyValue property;
+        if (ATX_SUCCEEDED(ATX_Properties_GetProperty(properties,
+                                                     BLT_RAOP_OUTPUT_COMPRESSION,
+                                                     &property)) &&
+            property.type == ATX_PROPERTY_VALUE_TYPE_INTEGER) {
+            self->object->m_Compress = property.data.integer != 0;
+        }
+    }
+    
     /* construct the inherited object */
     BLT_BaseMediaNode_Construct(&ATX_BASE(self, BLT_BaseMediaNode), module, core);
 
@@ -23,6 +23,14 @@
  * 'raop://[password@]<hostname>:<port>' for version 2 (UDP), supported by 
  * newer devices.
  *
+ * The audio is sent as ALAC frames, compressed unless the
+ * BLT_RAOP_OUTPUT_COMPRESSION core property is 0, and encrypted with
+ * the AES instructions of the CPU when it has them.
+ * With UDP, the packets are queued, up to about 2 seconds ahead, for a
+ * sender thread that sends them in real time, so the decoder only
+ * waits when it is that far ahead. The packets already sent are kept
+ * for about 2 seconds, to answer the resend requests of the receiver.
+ *
  * This output module will also send text and image metadata if the stream
  * property "Metadata.Json" is set. This property, if set, must be encoded
  * as a JSON object, with one or more of the following fields:
@@ -52,6 +60,16 @@
 #include "BltTypes.h"
 #include "BltModule.h"
 
+/*----------------------------------------------------------------------
+|   constants
++---------------------------------------------------------------------*/
+/**
+ * Core property: set to 0 to send uncompressed ALAC frames, for
+ * receivers that are too slow to decode compressed ones (integer).
+ * Read when a node is created. Defaults to 1.
+ */
+#define BLT_RAOP_OUTPUT_COMPRESSION "Plugins.RaopOutput.Compression"
+
 #if defined(__cplusplus)
 extern "C" {
 #endif
@@ -28,6 +28,17 @@
 +---------------------------------------------------------------------*/
 ATX_SET_LOCAL_LOGGER("bluetune.plugins.outputs.video.sdl")
 
+/*----------------------------------------------------------------------
+|    constants
++---------------------------------------------------------------------*/
+#define BLT_SDL_VIDEO_OUTPUT_QUEUE_SIZE       3    /* frames */
+#define BLT_SDL_VIDEO_OUTPUT_FRAME_DURATION   42   /* ms, when the packets have no timestamps */
+#define BLT_SDL_VIDEO_OUTPUT_MAX_WAIT         1000 /* ms, a frame due later resets the clock */
+#define BLT_SDL_VIDEO_OUTPUT_EVENT_INTERVAL   20   /* ms */
+#define BLT_SDL_VIDEO_OUTPUT_POLL_INTERVAL    100  /* ms */
+#define BLT_SDL_VIDEO_OUTPUT_DRAIN_TIMEOUT    5000 /* ms */
+#define BLT_SDL_VIDEO_OUTPUT_WAIT_FOREVER     ((Uint32)-1)
+
 /*----------------------------------------------------------------------
 |    types
 +---------------------------------------------------------------------*/
@@ -48,10 +59,48 @@ typedef struct {
     /* members */
     BLT_MediaType  expected_media_type;
     BLT_MediaType  media_type;
-
-    SDL_Surface*   screen;
-    SDL_Overlay*   yuv_overlay;
-    ATX_TimeStamp  next_display_time;
+    BLT_Boolean    headless;
+
+    /* frames are queued by the decoder thread and presented by the */
+    /* present thread. The queue keeps references to the packets    */
+    /* instead of copies; they are released by the decoder thread,  */
+    /* since packet reference counts are not thread-safe.           */
+    struct {
+        SDL_Thread*      thread;
+        SDL_mutex*       lock;
+        SDL_cond*        condition;
+        BLT_MediaPacket* frames[BLT_SDL_VIDEO_OUTPUT_QUEUE_SIZE];
+        unsigned int     put_count;     /* frames queued     */
+        unsigned int     present_count; /* frames presented  */
+        unsigned int     release_count; /* frames released   */
+        BLT_Boolean      flushing;
+        BLT_Boolean      paused;
+        BLT_Boolean      terminating;
+        BLT_Boolean      reset_clock;
+        BLT_Result       result;
+        BLT_TimeStamp    media_time;
+        unsigned int     shown_frames;
+        unsigned int     dropped_frames;
+        Uint32           first_show_time;
+        Uint32           last_show_time;
+    } presenter;
+
+    /* only used by the present thread */
+    struct {
+        SDL_Surface*     screen;
+        SDL_Overlay*     yuv_overlay;
+        BLT_PixelScaler* scaler;
+        unsigned int     picture_width;
+        unsigned int     picture_height;
+        unsigned int     window_width;
+        unsigned int     window_height;
+        BLT_Boolean      resized;
+        BLT_Boolean      clock_valid;
+        Uint32           clock_ticks;
+        BLT_TimeStamp    clock_time;
+        BLT_TimeStamp    last_time;
+        Uint32           last_due;
+    } display;
 } SdlVideoOutput;
 
 /*----------------------------------------------------------------------
@@ -65,6 +114,382 @@ ATX_DECLARE_INTERFACE_MAP(SdlVideoOutput, BLT_OutputNode)
 ATX_DECLARE_INTERFACE_MAP(SdlVideoOutput, BLT_MediaPort)
 ATX_DECLARE_INTERFACE_MAP(SdlVideoOutput, BLT_PacketConsumer)
 
+static BLT_Result SdlVideoOutput_Destroy(SdlVideoOutput* self);
+
+/*----------------------------------------------------------------------
+|    SdlVideoOutput_SetVideoMode
++---------------------------------------------------------------------*/
+static BLT_Result
+SdlVideoOutput_SetVideoMode(SdlVideoOutput* self)
+{
+    BLT_PixelFormat format;
+    Uint32          red_first;
+    Uint32          red_third;
+    BLT_Result      result;
+
+    if (self->display.yuv_overlay) {
+        SDL_FreeYUVOverlay(self->display.yuv_overlay);
+        self->display.yuv_overlay = NULL;
+    }
+    BLT_PixelScaler_Destroy(self->display.scaler);
+    self->display.scaler = NULL;
+
+    self->display.screen = SDL_SetVideoMode(self->display.window_width,
+                                            self->display.window_height,
+                                            32,
+                                            SDL_HWSURFACE | SDL_RESIZABLE);
+    if (self->display.screen == NULL) {
+        ATX_LOG_WARNING_1("SDL_SetVideoMode() failed (%s)", SDL_GetError());
+        return BLT_FAILURE;
+    }
+
+    /* a hardware overlay converts and scales for free, but a software */
+    /* one does it more slowly than we do                               */
+    if (!self->headless) {
+        self->display.yuv_overlay = SDL_CreateYUVOverlay(self->display.picture_width,
+                                                         self->display.picture_height,
+                                                         SDL_YV12_OVERLAY,
+                                                         self->display.screen);
+        if (self->display.yuv_overlay) {
+            if (self->display.yuv_overlay->hw_overlay) return BLT_SUCCESS;
+            SDL_FreeYUVOverlay(self->display.yuv_overlay);
+            self->display.yuv_overlay = NULL;
+        }
+    }
+
+    /* convert to the layout of the screen pixels */
+#if SDL_BYTEORDER == SDL_LIL_ENDIAN
+    red_first = 0x000000FF;
+    red_third = 0x00FF0000;
+#else
+    red_first = 0xFF000000;
+    red_third = 0x0000FF00;
+#endif
+    if (self->display.screen->format->BytesPerPixel == 4 &&
+        self->display.screen->format->Rmask == red_first) {
+        format = BLT_PIXEL_FORMAT_RGBA;
+    } else if (self->display.screen->format->BytesPerPixel == 4 &&
+               self->display.screen->format->Rmask == red_third) {
+        format = BLT_PIXEL_FORMAT_BGRA;
+    } else {
+        ATX_LOG_WARNING_1("unsupported screen format (%d bits per pixel)",
+                          self->display.screen->format->BitsPerPixel);
+        return BLT_ERROR_NOT_SUPPORTED;
+    }
+    result = BLT_PixelScaler_Create(self->display.picture_width,
+                                    self->display.picture_height,
+                                    self->display.screen->w,
+                                    self->display.screen->h,
+                                    format,
+                                    &self->display.scaler);
+    if (BLT_FAILED(result)) {
+        ATX_LOG_WARNING_1("BLT_PixelScaler_Create failed (%d)", result);
+    }
+
+    return result;
+}
+
+/*----------------------------------------------------------------------
+|    SdlVideoOutput_HandleEvents
++---------------------------------------------------------------------*/
+static void
+SdlVideoOutput_HandleEvents(SdlVideoOutput* self)
+{
+    SDL_Event event;
+
+    if (self->headless) return;
+    SDL_PumpEvents();
+    while (SDL_PeepEvents(&event, 1, SDL_GETEVENT, SDL_VIDEORESIZEMASK) > 0) {
+        self->display.window_width  = event.resize.w;
+        self->display.window_height = event.resize.h;
+        self->display.resized       = BLT_TRUE;
+    }
+}
+
+/*----------------------------------------------------------------------
+|    SdlVideoOutput_ShowFrame
++---------------------------------------------------------------------*/
+static BLT_Result
+SdlVideoOutput_ShowFrame(SdlVideoOutput* self, BLT_MediaPacket* packet)
+{
+    const BLT_RawVideoMediaType* media_type;
+    unsigned char*               pixel_data = (unsigned char*)BLT_MediaPacket_GetPayloadBuffer(packet);
+    SDL_Surface*                 screen;
+    unsigned int                 plane;
+    BLT_Result                   result;
+
+    BLT_MediaPacket_GetMediaType(packet, (const BLT_MediaType**)&media_type);
+
+    /* resize/create the window if needed */
+    if (self->display.screen == NULL                       ||
+        self->display.picture_width  != media_type->width  ||
+        self->display.picture_height != media_type->height ||
+        self->display.resized) {
+        if (self->display.picture_width  != media_type->width ||
+            self->display.picture_height != media_type->height) {
+            self->display.picture_width  = media_type->width;
+            self->display.picture_height = media_type->height;
+            self->display.window_width   = media_type->width;
+            self->display.window_height  = media_type->height;
+        }
+        self->display.resized = BLT_FALSE;
+        result = SdlVideoOutput_SetVideoMode(self);
+        if (BLT_FAILED(result)) {
+            self->display.screen = NULL;
+            return result;
+        }
+    }
+    screen = self->display.screen;
+
+    if (self->display.yuv_overlay) {
+        SDL_Rect rect;
+
+        /* transfer the pixels */
+        SDL_LockYUVOverlay(self->display.yuv_overlay);
+        for (plane=0; plane<3; plane++) {
+            unsigned int   plane_width  = (plane==0?media_type->width:(media_type->width/2));
+            unsigned int   plane_height = (plane==0?media_type->height:(media_type->height/2));
+            unsigned char* src          = pixel_data+media_type->planes[plane].offset;
+            unsigned int   src_pitch    = media_type->planes[plane].bytes_per_line;
+            unsigned char* dst          = self->display.yuv_overlay->pixels[plane==0?0:3-plane];
+            unsigned int   dst_pitch    = self->display.yuv_overlay->pitches[plane==0?0:3-plane];
+            while (plane_height--) {
+                ATX_CopyMemory(dst, src,  plane_width);
+                src += src_pitch;
+                dst += dst_pitch;
+            }
+        }
+        SDL_UnlockYUVOverlay(self->display.yuv_overlay);
+
+        rect.x = 0;
+        rect.y = 0;
+        rect.w = screen->w;
+        rect.h = screen->h;
+        SDL_DisplayYUVOverlay(self->display.yuv_overlay, &rect);
+    } else {
+        const BLT_UInt8* planes[3];
+        unsigned int     pitches[3];
+
+        /* convert and scale straight into the screen */
+        for (plane=0; plane<3; plane++) {
+            planes[plane]  = pixel_data+media_type->planes[plane].offset;
+            pitches[plane] = media_type->planes[plane].bytes_per_line;
+        }
+        if (SDL_MUSTLOCK(screen) && SDL_LockSurface(screen) < 0) return BLT_FAILURE;
+        BLT_PixelScaler_Convert(self->display.scaler, planes, pitches, (BLT_UInt8*)screen->pixels, screen->pitch);
+        if (SDL_MUSTLOCK(screen)) SDL_UnlockSurface(screen);
+        SDL_Flip(screen);
+    }
+
+    return BLT_SUCCESS;
+}
+
+/*----------------------------------------------------------------------
+|    SdlVideoOutput_WaitForFrameTime
+|
+|    Called with the lock held. Returns BLT_FALSE if the frame is
+|    late enough to be dropped.
++---------------------------------------------------------------------*/
+static BLT_Boolean
+SdlVideoOutput_WaitForFrameTime(SdlVideoOutput* self, BLT_MediaPacket* packet)
+{
+    BLT_TimeStamp time_stamp = BLT_MediaPacket_GetTimeStamp(packet);
+    Uint32        now        = SDL_GetTicks();
+    Uint32        due;
+
+    /* as fast as possible when nobody is watching */
+    if (self->headless) return BLT_TRUE;
+
+    if (self->presenter.reset_clock) {
+        self->display.clock_valid = BLT_FALSE;
+        self->presenter.reset_clock = BLT_FALSE;
+    }
+    if (!self->display.clock_valid) {
+        self->display.clock_valid = BLT_TRUE;
+        self->display.clock_ticks = now;
+        self->display.clock_time  = time_stamp;
+        due = now;
+    } else if (BLT_TimeStamp_IsLater(time_stamp, self->display.last_time)) {
+        due = self->display.clock_ticks+
+              (Uint32)BLT_TimeStamp_ToMillis(BLT_TimeStamp_Sub(time_stamp, self->display.clock_time));
+    } else {
+        /* no usable timestamps */
+        due = self->display.last_due+BLT_SDL_VIDEO_OUTPUT_FRAME_DURATION;
+    }
+    if ((Sint32)(due-now) > BLT_SDL_VIDEO_OUTPUT_MAX_WAIT) {
+        self->display.clock_ticks = now;
+        self->display.clock_time  = time_stamp;
+        due = now;
+    }
+    self->display.last_time = time_stamp;
+    self->display.last_due  = due;
+
+    while (!self->presenter.terminating && !self->presenter.flushing) {
+        now = SDL_GetTicks();
+        if ((Sint32)(due-now) <= 0) break;
+        SDL_CondWaitTimeout(self->presenter.condition, self->presenter.lock, due-now);
+    }
+
+    /* drop the frame if it is more than a frame late and others are waiting */
+    return (Sint32)(now-due) <= BLT_SDL_VIDEO_OUTPUT_FRAME_DURATION ||
+           self->presenter.put_count-self->presenter.present_count <= 1;
+}
+
+/*----------------------------------------------------------------------
+|    SdlVideoOutput_PresentThread
++---------------------------------------------------------------------*/
+static int
+SdlVideoOutput_PresentThread(void* arg)
+{
+    SdlVideoOutput* self = (SdlVideoOutput*)arg;
+
+    /* all the SDL video calls are made from this thread */
+    if (SDL_VideoInit(self->headless?"dummy":NULL, 0) < 0) {
+        ATX_LOG_WARNING_1("SDL_VideoInit() failed (%s)", SDL_GetError());
+        SDL_LockMutex(self->presenter.lock);
+        self->presenter.result = BLT_FAILURE;
+        SDL_CondBroadcast(self->presenter.condition);
+        SDL_UnlockMutex(self->presenter.lock);
+        return 0;
+    }
+
+    SDL_LockMutex(self->presenter.lock);
+    while (!self->presenter.terminating) {
+        BLT_MediaPacket* packet;
+        BLT_Boolean      show;
+
+        if (self->presenter.flushing) {
+            self->presenter.present_count = self->presenter.put_count;
+            SDL_CondBroadcast(self->presenter.condition);
+        }
+        if (self->presenter.paused || self->presenter.present_count == self->presenter.put_count) {
+            SDL_UnlockMutex(self->presenter.lock);
+            SdlVideoOutput_HandleEvents(self);
+            SDL_LockMutex(self->presenter.lock);
+            SDL_CondWaitTimeout(self->presenter.condition,
+                                self->presenter.lock,
+                                BLT_SDL_VIDEO_OUTPUT_EVENT_INTERVAL);
+            continue;
+        }
+
+        packet = self->presenter.frames[self->presenter.present_count%BLT_SDL_VIDEO_OUTPUT_QUEUE_SIZE];
+        show = SdlVideoOutput_WaitForFrameTime(self, packet);
+        if (self->presenter.terminating || self->presenter.flushing) continue;
+
+        if (show) {
+            BLT_Result result;
+
+            SDL_UnlockMutex(self->presenter.lock);
+            SdlVideoOutput_HandleEvents(self);
+            result = SdlVideoOutput_ShowFrame(self, packet);
+            if (BLT_FAILED(result)) {
+                ATX_LOG_FINE_1("cannot show frame (%d)", result);
+            }
+            SDL_LockMutex(self->presenter.lock);
+
+            self->presenter.last_show_time = SDL_GetTicks();
+            if (self->presenter.shown_frames++ == 0) {
+                self->presenter.first_show_time = self->presenter.last_show_time;
+            }
+        } else {
+            ++self->presenter.dropped_frames;
+        }
+        self->presenter.media_time = BLT_MediaPacket_GetTimeStamp(packet);
+        ++self->presenter.present_count;
+        SDL_CondBroadcast(self->presenter.condition);
+    }
+    SDL_UnlockMutex(self->presenter.lock);
+
+    if (self->display.yuv_overlay) SDL_FreeYUVOverlay(self->display.yuv_overlay);
+    BLT_PixelScaler_Destroy(self->display.scaler);
+    SDL_VideoQuit();
+
+    return 0;
+}
+
+/*----------------------------------------------------------------------
+|    SdlVideoOutput_ReleaseFrames
+|
+|    Releases the frames that have been presented. Called by the
+|    decoder thread only.
++---------------------------------------------------------------------*/
+static void
+SdlVideoOutput_ReleaseFrames(SdlVideoOutput* self)
+{
+    unsigned int present_count;
+
+    SDL_LockMutex(self->presenter.lock);
+    if (BLT_FAILED(self->presenter.result)) {
+        /* there is no present thread anymore */
+        self->presenter.present_count = self->presenter.put_count;
+    }
+    present_count = self->presenter.present_count;
+    SDL_UnlockMutex(self->presenter.lock);
+
+    while (self->presenter.release_count != present_count) {
+        BLT_MediaPacket** frame = &self->presenter.frames[self->presenter.release_count%BLT_SDL_VIDEO_OUTPUT_QUEUE_SIZE];
+        BLT_MediaPacket_Release(*frame);
+        *frame = NULL;
+        ++self->presenter.release_count;
+    }
+}
+
+/*----------------------------------------------------------------------
+|    SdlVideoOutput_WaitForFrames
+|
+|    Waits until no more than max_pending frames remain to be presented.
++---------------------------------------------------------------------*/
+static BLT_Result
+SdlVideoOutput_WaitForFrames(SdlVideoOutput* self,
+                             unsigned int    max_pending,
+                             Uint32          timeout)
+{
+    Uint32     start  = SDL_GetTicks();
+    BLT_Result result = BLT_SUCCESS;
+
+    SDL_LockMutex(self->presenter.lock);
+    while (self->presenter.put_count-self->presenter.present_count > max_pending) {
+        if (BLT_FAILED(self->presenter.result)) {
+            result = self->presenter.result;
+            break;
+        }
+        if (timeout != BLT_SDL_VIDEO_OUTPUT_WAIT_FOREVER && SDL_GetTicks()-start >= timeout) {
+            result = ATX_ERROR_TIMEOUT;
+            break;
+        }
+        SDL_CondWaitTimeout(self->presenter.condition,
+                            self->presenter.lock,
+                            BLT_SDL_VIDEO_OUTPUT_POLL_INTERVAL);
+    }
+    SDL_UnlockMutex(self->presenter.lock);
+    SdlVideoOutput_ReleaseFrames(self);
+
+    return result;
+}
+
+/*----------------------------------------------------------------------
+|    SdlVideoOutput_Flush
+|
+|    Drops the frames that have not been presented yet.
++---------------------------------------------------------------------*/
+static void
+SdlVideoOutput_Flush(SdlVideoOutput* self)
+{
+    SDL_LockMutex(self->presenter.lock);
+    self->presenter.flushing = BLT_TRUE;
+    SDL_CondBroadcast(self->presenter.condition);
+    while (self->presenter.present_count != self->presenter.put_count &&
+           BLT_SUCCEEDED(self->presenter.result)) {
+        SDL_CondWaitTimeout(self->presenter.condition,
+                            self->presenter.lock,
+                            BLT_SDL_VIDEO_OUTPUT_POLL_INTERVAL);
+    }
+    self->presenter.flushing    = BLT_FALSE;
+    self->presenter.reset_clock = BLT_TRUE;
+    SDL_UnlockMutex(self->presenter.lock);
+    SdlVideoOutput_ReleaseFrames(self);
+}
+
 /*----------------------------------------------------------------------
 |    SdlVideoOutput_PutPacket
 +---------------------------------------------------------------------*/
@@ -73,11 +498,9 @@ SdlVideoOutput_PutPacket(BLT_PacketConsumer* _self,
                          BLT_MediaPacket*    packet)
 {
     SdlVideoOutput*              self = ATX_SELF(SdlVideoOutput, BLT_PacketConsumer);
-    unsigned char*               pixel_data = (unsigned char*)BLT_MediaPacket_GetPayloadBuffer(packet);
     const BLT_RawVideoMediaType* media_type;
-    unsigned int                 plane;
-	SDL_Rect                     rect;
-    
+    BLT_Result                   result;
+
     /* check the media type */
     BLT_MediaPacket_GetMediaType(packet, (const BLT_MediaType**)&media_type);
     if (media_type->base.id != BLT_MEDIA_TYPE_ID_VIDEO_RAW) {
@@ -89,65 +512,20 @@ SdlVideoOutput_PutPacket(BLT_PacketConsumer* _self,
         return BLT_ERROR_INVALID_MEDIA_TYPE;
     }
 
-    /* resize/create the window and overlay if needed */
-    if (self->yuv_overlay == NULL                 || 
-        self->yuv_overlay->w != media_type->width ||
-        self->yuv_overlay->h != media_type->height) {
-        self->screen = SDL_SetVideoMode(media_type->width, media_type->height, 24, SDL_HWSURFACE | SDL_RESIZABLE);
-        if (self->screen == NULL) {
-            ATX_LOG_WARNING("SDL_SetVideoMode() failed");
-            return BLT_FAILURE;
-        }
-        self->yuv_overlay = SDL_CreateYUVOverlay(media_type->width, media_type->height, SDL_YV12_OVERLAY, self->screen);
-        if (self->yuv_overlay == NULL) {
-            ATX_LOG_WARNING("SDL_CreateYUVOverlay() failed");
-            return BLT_FAILURE;
-        }
-        
-    }
-    
-    /* transfer the pixels */
-    SDL_LockYUVOverlay(self->yuv_overlay);
-    for (plane=0; plane<3; plane++) {
-        unsigned int   plane_width  = (plane==0?media_type->width:(media_type->width/2));
-        unsigned int   plane_height = (plane==0?media_type->height:(media_type->height/2));
-        unsigned char* src          = pixel_data+media_type->planes[plane].offset;
-        unsigned int   src_pitch    = media_type->planes[plane].bytes_per_line;
-        unsigned char* dst          = self->yuv_overlay->pixels[plane==0?0:3-plane];
-        unsigned int   dst_pitch    = self->yuv_overlay->pitches[plane==0?0:3-plane];
-        while (plane_height--) {
-            ATX_CopyMemory(dst, src,  plane_width);
-            src += src_pitch;
-            dst += dst_pitch;
-        }
-    }
-    SDL_UnlockYUVOverlay(self->yuv_overlay);
-
-    rect.x = 0;
-	rect.y = 0;
-	rect.w = self->screen->w;
-	rect.h = self->screen->h;
-	SDL_DisplayYUVOverlay(self->yuv_overlay, &rect);    
-    
-    {
-        ATX_TimeStamp now;
-        ATX_System_GetCurrentTimeStamp(&now);
-        if (ATX_TimeStamp_IsLaterOrEqual(self->next_display_time, now)) { 
-            ATX_TimeInterval delta;
-            ATX_TimeStamp_Sub(delta, self->next_display_time, now);
-            /* sanity check */
-            if (delta.seconds == 0 && delta.nanoseconds > 1000000) {
-                ATX_System_Sleep(&delta);
-            }
-        } else {
-            self->next_display_time = now;
-        }
-        {
-            ATX_TimeStamp frame_duration = {0, 41708000};
-            ATX_TimeStamp_Add(self->next_display_time, self->next_display_time, frame_duration);
-        }
-    }
-    
+    /* wait for a free slot */
+    result = SdlVideoOutput_WaitForFrames(self,
+                                          BLT_SDL_VIDEO_OUTPUT_QUEUE_SIZE-1,
+                                          BLT_SDL_VIDEO_OUTPUT_WAIT_FOREVER);
+    if (BLT_FAILED(result)) return result;
+
+    /* queue a reference to the packet, the pixels are not copied */
+    BLT_MediaPacket_AddReference(packet);
+    self->presenter.frames[self->presenter.put_count%BLT_SDL_VIDEO_OUTPUT_QUEUE_SIZE] = packet;
+    SDL_LockMutex(self->presenter.lock);
+    ++self->presenter.put_count;
+    SDL_CondBroadcast(self->presenter.condition);
+    SDL_UnlockMutex(self->presenter.lock);
+
     return BLT_SUCCESS;
 }
 
@@ -170,45 +548,21 @@ SdlVideoOutput_QueryMediaType(BLT_MediaPort*        _self,
     }
 }
 
-/*----------------------------------------------------------------------
-|    SdlVideoOutput_CreateWindow
-+---------------------------------------------------------------------*/
-static BLT_Result
-SdlVideoOutput_CreateWindow(SdlVideoOutput* self)
-{
-    if (SDL_Init(SDL_INIT_VIDEO) < 0) {
-        ATX_LOG_WARNING("SdlVideoOutput_CreateWindow - cannot init SDL");
-        return BLT_FAILURE;
-    }
-
-    self->screen = SDL_SetVideoMode(1000, 600, 24, SDL_HWSURFACE | SDL_RESIZABLE);
-    if (self->screen == NULL) {
-        ATX_LOG_WARNING("SdlVideoOutput_CreateWindow - SDL_SetVideoMode() failed");
-        return BLT_FAILURE;
-    }
-    self->yuv_overlay = SDL_CreateYUVOverlay(1000, 600, SDL_YV12_OVERLAY, self->screen);
-    if (self->yuv_overlay == NULL) {
-        ATX_LOG_WARNING("SdlVideoOutput_CreateWindow - SDL_CreateYUVOverlay() failed");
-        return BLT_FAILURE;
-    }
-    
-    return BLT_SUCCESS;
-}
-        
 /*----------------------------------------------------------------------
 |    SdlVideoOutput_Create
 +---------------------------------------------------------------------*/
 static BLT_Result
 SdlVideoOutput_Create(BLT_Module*              module,
-                      BLT_Core*                core, 
+                      BLT_Core*                core,
                       BLT_ModuleParametersType parameters_type,
-                      BLT_CString              parameters, 
+                      BLT_CString              parameters,
                       BLT_MediaNode**          object)
 {
-    SdlVideoOutput* self;
-    
+    BLT_MediaNodeConstructor* constructor = (BLT_MediaNodeConstructor*)parameters;
+    SdlVideoOutput*           self;
+
     /* check parameters */
-    if (parameters == NULL || 
+    if (parameters == NULL ||
         parameters_type != BLT_MODULE_PARAMETERS_TYPE_MEDIA_NODE_CONSTRUCTOR) {
         return BLT_ERROR_INVALID_PARAMETERS;
     }
@@ -224,13 +578,25 @@ SdlVideoOutput_Create(BLT_Module*              module,
     BLT_BaseMediaNode_Construct(&ATX_BASE(self, BLT_BaseMediaNode), module, core);
 
     /* construct the object */
+    self->headless = constructor->name && ATX_StringsEqual(constructor->name, "sdl:dummy");
 
     /* setup the expected media type */
     BLT_MediaType_Init(&self->expected_media_type, BLT_MEDIA_TYPE_ID_VIDEO_RAW);
     /*self->expected_media_type.sample_format = BLT_PCM_SAMPLE_FORMAT_SIGNED_INT_NE;*/
 
-    SdlVideoOutput_CreateWindow(self);
-    
+    /* start the present thread */
+    self->presenter.lock      = SDL_CreateMutex();
+    self->presenter.condition = SDL_CreateCond();
+    if (self->presenter.lock && self->presenter.condition) {
+        self->presenter.thread = SDL_CreateThread(SdlVideoOutput_PresentThread, self);
+    }
+    if (self->presenter.thread == NULL) {
+        ATX_LOG_WARNING("SdlVideoOutput_Create - cannot start the present thread");
+        SdlVideoOutput_Destroy(self);
+        *object = NULL;
+        return BLT_FAILURE;
+    }
+
     /* setup interfaces */
     ATX_SET_INTERFACE_EX(self, SdlVideoOutput, BLT_BaseMediaNode, BLT_MediaNode);
     ATX_SET_INTERFACE_EX(self, SdlVideoOutput, BLT_BaseMediaNode, ATX_Referenceable);
@@ -248,6 +614,27 @@ SdlVideoOutput_Create(BLT_Module*              module,
 static BLT_Result
 SdlVideoOutput_Destroy(SdlVideoOutput* self)
 {
+    /* stop the present thread and drop what it has not shown */
+    if (self->presenter.thread) {
+        SDL_LockMutex(self->presenter.lock);
+        self->presenter.terminating = BLT_TRUE;
+        SDL_CondBroadcast(self->presenter.condition);
+        SDL_UnlockMutex(self->presenter.lock);
+        SDL_WaitThread(self->presenter.thread, NULL);
+        self->presenter.present_count = self->presenter.put_count;
+        SdlVideoOutput_ReleaseFrames(self);
+
+        if (self->presenter.shown_frames > 1) {
+            Uint32 duration = self->presenter.last_show_time-self->presenter.first_show_time;
+            ATX_LOG_INFO_3("shown %d frames, dropped %d, %d fps",
+                           self->presenter.shown_frames,
+                           self->presenter.dropped_frames,
+                           duration ? (int)((self->presenter.shown_frames-1)*1000/duration) : 0);
+        }
+    }
+    if (self->presenter.condition) SDL_DestroyCond(self->presenter.condition);
+    if (self->presenter.lock) SDL_DestroyMutex(self->presenter.lock);
+
     /* destruct the inherited object */
     BLT_BaseMediaNode_Destruct(&ATX_BASE(self, BLT_BaseMediaNode));
 
@@ -256,7 +643,7 @@ SdlVideoOutput_Destroy(SdlVideoOutput* self)
 
     return BLT_SUCCESS;
 }
-                
+
 /*----------------------------------------------------------------------
 |   SdlVideoOutput_GetPortByName
 +---------------------------------------------------------------------*/
@@ -276,6 +663,64 @@ SdlVideoOutput_GetPortByName(BLT_MediaNode*  _self,
     }
 }
 
+/*----------------------------------------------------------------------
+|    SdlVideoOutput_Pause
++---------------------------------------------------------------------*/
+BLT_METHOD
+SdlVideoOutput_Pause(BLT_MediaNode* _self)
+{
+    SdlVideoOutput* self = ATX_SELF_EX(SdlVideoOutput, BLT_BaseMediaNode, BLT_MediaNode);
+
+    SDL_LockMutex(self->presenter.lock);
+    self->presenter.paused = BLT_TRUE;
+    SDL_UnlockMutex(self->presenter.lock);
+
+    return BLT_SUCCESS;
+}
+
+/*----------------------------------------------------------------------
+|    SdlVideoOutput_Resume
++---------------------------------------------------------------------*/
+BLT_METHOD
+SdlVideoOutput_Resume(BLT_MediaNode* _self)
+{
+    SdlVideoOutput* self = ATX_SELF_EX(SdlVideoOutput, BLT_BaseMediaNode, BLT_MediaNode);
+
+    SDL_LockMutex(self->presenter.lock);
+    self->presenter.paused      = BLT_FALSE;
+    self->presenter.reset_clock = BLT_TRUE;
+    SDL_CondBroadcast(self->presenter.condition);
+    SDL_UnlockMutex(self->presenter.lock);
+
+    return BLT_SUCCESS;
+}
+
+/*----------------------------------------------------------------------
+|    SdlVideoOutput_Seek
++---------------------------------------------------------------------*/
+BLT_METHOD
+SdlVideoOutput_Seek(BLT_MediaNode* _self,
+                    BLT_SeekMode*  mode,
+                    BLT_SeekPoint* point)
+{
+    SdlVideoOutput* self = ATX_SELF_EX(SdlVideoOutput, BLT_BaseMediaNode, BLT_MediaNode);
+    BLT_COMPILER_UNUSED(mode);
+
+    /* the frames from before the seek are not shown */
+    SdlVideoOutput_Flush(self);
+
+    /* update the media time */
+    SDL_LockMutex(self->presenter.lock);
+    if (point->mask & BLT_SEEK_POINT_MASK_TIME_STAMP) {
+        self->presenter.media_time = point->time_stamp;
+    } else {
+        BLT_TimeStamp_Set(self->presenter.media_time, 0, 0);
+    }
+    SDL_UnlockMutex(self->presenter.lock);
+
+    return BLT_SUCCESS;
+}
+
 /*----------------------------------------------------------------------
 |    SdlVideoOutput_GetStatus
 +---------------------------------------------------------------------*/
@@ -284,15 +729,27 @@ SdlVideoOutput_GetStatus(BLT_OutputNode*       _self,
                          BLT_OutputNodeStatus* status)
 {
     SdlVideoOutput* self = ATX_SELF(SdlVideoOutput, BLT_OutputNode);
-    BLT_COMPILER_UNUSED(self);
-    
-    /* default value */
-    status->media_time.seconds     = 0;
-    status->media_time.nanoseconds = 0;
+
+    /* the time of the frame on the screen */
+    SDL_LockMutex(self->presenter.lock);
+    status->media_time = self->presenter.media_time;
+    SDL_UnlockMutex(self->presenter.lock);
+    status->flags = 0;
 
     return BLT_SUCCESS;
 }
 
+/*----------------------------------------------------------------------
+|    SdlVideoOutput_Drain
++---------------------------------------------------------------------*/
+BLT_METHOD
+SdlVideoOutput_Drain(BLT_OutputNode* _self)
+{
+    SdlVideoOutput* self = ATX_SELF(SdlVideoOutput, BLT_OutputNode);
+
+    return SdlVideoOutput_WaitForFrames(self, 0, BLT_SDL_VIDEO_OUTPUT_DRAIN_TIMEOUT);
+}
+
 /*----------------------------------------------------------------------
 |   GetInterface implementation
 +---------------------------------------------------------------------*/
@@ -332,9 +789,9 @@ ATX_BEGIN_INTERFACE_MAP_EX(SdlVideoOutput, BLT_BaseMediaNode, BLT_MediaNode)
     BLT_BaseMediaNode_Deactivate,
     BLT_BaseMediaNode_Start,
     BLT_BaseMediaNode_Stop,
-    BLT_BaseMediaNode_Pause,
-    BLT_BaseMediaNode_Resume,
-    BLT_BaseMediaNode_Seek
+    SdlVideoOutput_Pause,
+    SdlVideoOutput_Resume,
+    SdlVideoOutput_Seek
 ATX_END_INTERFACE_MAP_EX
 
 /*----------------------------------------------------------------------
@@ -342,7 +799,7 @@ ATX_END_INTERFACE_MAP_EX
 +---------------------------------------------------------------------*/
 ATX_BEGIN_INTERFACE_MAP(SdlVideoOutput, BLT_OutputNode)
     SdlVideoOutput_GetStatus,
-    NULL
+    SdlVideoOutput_Drain
 ATX_END_INTERFACE_MAP
 
 /*----------------------------------------------------------------------
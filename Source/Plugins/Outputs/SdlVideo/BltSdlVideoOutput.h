@@ -20,7 +20,15 @@
  * This module responds to probe with the name:
  * 'sdl:<n>'
  * (In this version, <n> is ignored, and the default screen will
- * be used).
+ * be used, except for 'sdl:dummy', which uses the SDL dummy video
+ * driver: nothing is displayed, and frames are not paced, so that
+ * decoding and conversion throughput can be measured without a display).
+ *
+ * Frames are shown by a thread of their own, from a short queue of
+ * references to the decoded packets, so that decoding and display
+ * overlap. They are paced by their timestamps. Frames are converted and
+ * scaled with BLT_PixelScaler, straight into the screen surface, unless
+ * the display has a hardware YUV overlay.
  * @{ 
  */
 
@@ -0,0 +1,1409 @@
+/*****************************************************************
+|
+|   Tee Output Module
+|
+|   (c) 2002-2012 Gilles Boccon-Gibod
+|   Author: Gilles Boccon-Gibod (bok@bok.net)
+|
+ ****************************************************************/
+
+/*----------------------------------------------------------------------
+|   includes
++---------------------------------------------------------------------*/
+#include "Atomix.h"
+#include "Neptune.h"
+#include "BltConfig.h"
+#include "BltTeeOutput.h"
+#include "BltCore.h"
+#include "BltMediaNode.h"
+#include "BltMedia.h"
+#include "BltPcm.h"
+#include "BltMediaPort.h"
+#include "BltPacketConsumer.h"
+#include "BltMediaPacket.h"
+#include "BltOutputNode.h"
+#include "BltStream.h"
+
+/*----------------------------------------------------------------------
+|   logging
++---------------------------------------------------------------------*/
+ATX_SET_LOCAL_LOGGER("bluetune.plugins.outputs.tee")
+
+/*----------------------------------------------------------------------
+|   constants
++---------------------------------------------------------------------*/
+const unsigned int BLT_TEE_OUTPUT_MAX_CHILDREN          = 16;
+const unsigned int BLT_TEE_OUTPUT_MAX_LATENCY           = 10000; // ms
+const unsigned int BLT_TEE_OUTPUT_MAX_THREAD_WAIT_TIMEOUT = 3000; // ms
+const NPT_Timeout  BLT_TEE_OUTPUT_IDLE_WAIT             = 1000; // ms
+
+// each child may queue this much audio on top of its delay, or this
+// many packets when their duration isn't known
+const NPT_UInt64   BLT_TEE_OUTPUT_QUEUE_DURATION        = 1000; // ms
+const unsigned int BLT_TEE_OUTPUT_MAX_QUEUE_LENGTH      = 1024;
+
+// silence is sent in packets of this many frames
+const unsigned int BLT_TEE_OUTPUT_SILENCE_PACKET_FRAMES = 4096;
+
+/*----------------------------------------------------------------------
+|    types
++---------------------------------------------------------------------*/
+typedef struct {
+    /* base class */
+    ATX_EXTENDS(BLT_BaseModule);
+} TeeOutputModule;
+
+class TeeOutput; // forward reference
+
+// A child's own copy of a packet. Packets and their reference counts are
+// not thread-safe, so the copies are created and released on the thread
+// that calls the node: a child only plays its copy and hands it back.
+struct TeeEntry {
+    BLT_MediaPacket* m_Packet;
+    NPT_UInt64       m_Duration; // us, 0 if not known
+};
+
+class TeeChild : public NPT_Thread {
+public:
+    typedef enum {
+        STATE_ACTIVE,  // receives packets
+        STATE_STALLED, // stuck in PutPacket, skipped until it comes back
+        STATE_FAILED   // rejected a packet, skipped until the next seek
+    } State;
+
+    TeeChild(TeeOutput& output, const char* name, unsigned int latency);
+    ~TeeChild();
+    virtual void Run();
+
+    bool IsFull();
+    void Flush();
+    bool Accepts(const BLT_MediaType* media_type);
+
+    // set when the node is created
+    TeeOutput&                m_Output;
+    NPT_String                m_Name;
+    unsigned int              m_Latency; // ms
+    unsigned int              m_Delay;   // ms
+    BLT_MediaNode*            m_Node;
+    BLT_MediaPort*            m_Port;
+    BLT_PacketConsumer*       m_Consumer;
+    BLT_OutputNode*           m_OutputNode;
+    NPT_Array<BLT_MediaType*> m_MediaTypes; // expected by the node's port
+
+    // serializes the calls to the child node
+    NPT_Mutex            m_NodeLock;
+    NPT_SharedVariable   m_WakeUp;
+
+    // protected by the output lock
+    volatile bool        m_ShouldExit;
+    State                m_State;
+    bool                 m_Busy;
+    bool                 m_NeedsPriming;
+    NPT_List<TeeEntry*>  m_Queue;
+    NPT_UInt64           m_QueuedDuration; // us
+    NPT_UInt64           m_LastProgress;   // ms
+    BLT_OutputNodeStatus m_Status;
+    bool                 m_HasStatus;
+
+private:
+    void Resync();
+};
+
+class TeeOutput {
+public:
+    TeeOutput(BLT_Core* core);
+    ~TeeOutput();
+
+    BLT_Result AddChild(const BLT_MediaNodeConstructor* constructor,
+                        const char*                     name,
+                        unsigned int                    latency);
+    void       StartThreads();
+    BLT_Result CheckMediaType(const BLT_MediaType* media_type);
+    BLT_Result PutPacket(BLT_MediaPacket* packet);
+    BLT_Result WaitForRoom(bool drain);
+    TeeEntry*  CreateEntry(BLT_MediaPacket* packet, NPT_UInt64 duration);
+    BLT_Result CreateSilence(TeeChild* child, BLT_MediaPacket* packet, NPT_List<TeeEntry*>& entries);
+    void       Finish(TeeEntry* entry);
+    void       ReleaseFinishedEntries();
+    void       FlushQueues();
+    void       ResetProgress(bool prime);
+    BLT_Result GetStatus(BLT_OutputNodeStatus* status);
+
+    static NPT_UInt64 Now();
+    static void       DestroyEntry(TeeEntry* entry);
+
+    // members
+    BLT_Core*                 m_Core;
+    BLT_MediaType             m_ExpectedMediaType;
+    NPT_Array<BLT_MediaType*> m_MediaTypes; // expected by all the children
+    BLT_MediaType*            m_MediaType;  // of the last packet they all accept
+    NPT_Array<TeeChild*>      m_Children;
+    NPT_Mutex                 m_Lock;
+    NPT_SharedVariable        m_RoomAvailable; // wakes up the decoder thread
+    NPT_List<TeeEntry*>       m_FinishedEntries;
+    BLT_Result                m_LastError;
+};
+
+typedef struct {
+    /* base class */
+    ATX_EXTENDS   (BLT_BaseMediaNode);
+
+    /* interfaces */
+    ATX_IMPLEMENTS(BLT_PacketConsumer);
+    ATX_IMPLEMENTS(BLT_OutputNode);
+    ATX_IMPLEMENTS(BLT_MediaPort);
+
+    TeeOutput* object;
+} _TeeOutput;
+
+/*----------------------------------------------------------------------
+|    TeeChild::TeeChild
++---------------------------------------------------------------------*/
+TeeChild::TeeChild(TeeOutput& output, const char* name, unsigned int latency) :
+    m_Output(output),
+    m_Name(name),
+    m_Latency(latency),
+    m_Delay(0),
+    m_Node(NULL),
+    m_Port(NULL),
+    m_Consumer(NULL),
+    m_OutputNode(NULL),
+    m_WakeUp(0),
+    m_ShouldExit(false),
+    m_State(STATE_ACTIVE),
+    m_Busy(false),
+    m_NeedsPriming(true),
+    m_QueuedDuration(0),
+    m_LastProgress(0),
+    m_HasStatus(false)
+{
+    m_Status.flags = 0;
+    m_Status.media_time.seconds     = 0;
+    m_Status.media_time.nanoseconds = 0;
+}
+
+/*----------------------------------------------------------------------
+|    TeeChild::~TeeChild
++---------------------------------------------------------------------*/
+TeeChild::~TeeChild()
+{
+    {
+        NPT_AutoLock lock(m_Output.m_Lock);
+        m_ShouldExit = true;
+    }
+    m_WakeUp.SetValue(1);
+
+    ATX_LOG_FINE_1("waiting for the thread of %s to terminate", m_Name.GetChars());
+    if (Wait(BLT_TEE_OUTPUT_MAX_THREAD_WAIT_TIMEOUT) == NPT_ERROR_TIMEOUT) {
+        ATX_LOG_WARNING_1("timed out waiting for the thread of %s", m_Name.GetChars());
+    }
+
+    ATX_RELEASE_OBJECT(m_Node);
+    for (unsigned int i=0; i<m_MediaTypes.GetItemCount(); i++) {
+        BLT_MediaType_Free(m_MediaTypes[i]);
+    }
+}
+
+/*----------------------------------------------------------------------
+|    TeeChild::IsFull
+|
+|    Must be called with the output lock held.
++---------------------------------------------------------------------*/
+bool
+TeeChild::IsFull()
+{
+    if (m_Queue.GetItemCount() >= BLT_TEE_OUTPUT_MAX_QUEUE_LENGTH) return true;
+    return m_QueuedDuration >= (m_Delay+BLT_TEE_OUTPUT_QUEUE_DURATION)*1000;
+}
+
+/*----------------------------------------------------------------------
+|    TeeChild::Flush
+|
+|    Must be called with the output lock held.
++---------------------------------------------------------------------*/
+void
+TeeChild::Flush()
+{
+    TeeEntry* entry;
+    while (NPT_SUCCEEDED(m_Queue.PopHead(entry))) {
+        m_Output.Finish(entry);
+    }
+    m_QueuedDuration = 0;
+}
+
+/*----------------------------------------------------------------------
+|    TeeOutput_AcceptsMediaType
+|
+|    Tells if a packet of type 'media_type' fits a type expected by a
+|    port. PCM fields left to 0 in the expected type take any value.
++---------------------------------------------------------------------*/
+static bool
+TeeOutput_AcceptsMediaType(const BLT_MediaType* expected, const BLT_MediaType* media_type)
+{
+    if (expected->id == BLT_MEDIA_TYPE_ID_UNKNOWN) return true;
+    if (expected->id != media_type->id) return false;
+    if (expected->id != BLT_MEDIA_TYPE_ID_AUDIO_PCM ||
+        expected->extension_size   < sizeof(BLT_PcmMediaType)-sizeof(BLT_MediaType) ||
+        media_type->extension_size < sizeof(BLT_PcmMediaType)-sizeof(BLT_MediaType)) {
+        return true;
+    }
+
+    const BLT_PcmMediaType* want = (const BLT_PcmMediaType*)expected;
+    const BLT_PcmMediaType* have = (const BLT_PcmMediaType*)media_type;
+    if (want->sample_rate     && want->sample_rate     != have->sample_rate)     return false;
+    if (want->channel_count   && want->channel_count   != have->channel_count)   return false;
+    if (want->bits_per_sample && want->bits_per_sample != have->bits_per_sample) return false;
+    if (want->sample_format   && want->sample_format   != have->sample_format)   return false;
+    if (want->channel_mask    && want->channel_mask    != have->channel_mask)    return false;
+    return true;
+}
+
+/*----------------------------------------------------------------------
+|    TeeOutput_MergeMediaTypes
+|
+|    Returns in 'merged' a new type that fits both 'a' and 'b', or NULL
+|    if they have nothing in common.
++---------------------------------------------------------------------*/
+static void
+TeeOutput_MergeMediaTypes(const BLT_MediaType* a, const BLT_MediaType* b, BLT_MediaType** merged)
+{
+    *merged = NULL;
+    if (a->id == BLT_MEDIA_TYPE_ID_UNKNOWN) {
+        BLT_MediaType_Clone(b, merged);
+        return;
+    }
+    if (b->id == BLT_MEDIA_TYPE_ID_UNKNOWN) {
+        BLT_MediaType_Clone(a, merged);
+        return;
+    }
+    if (a->id != b->id) return;
+
+    // a PCM type without its fields is the least specific
+    if (a->id == BLT_MEDIA_TYPE_ID_AUDIO_PCM &&
+        a->extension_size < sizeof(BLT_PcmMediaType)-sizeof(BLT_MediaType)) {
+        BLT_MediaType_Clone(b, merged);
+        return;
+    }
+    if (BLT_FAILED(BLT_MediaType_Clone(a, merged))) return;
+    if (a->id != BLT_MEDIA_TYPE_ID_AUDIO_PCM ||
+        b->extension_size < sizeof(BLT_PcmMediaType)-sizeof(BLT_MediaType)) {
+        return;
+    }
+
+    // a field left to 0 takes the other's value, different values conflict
+    const BLT_PcmMediaType* other = (const BLT_PcmMediaType*)b;
+    BLT_PcmMediaType*       pcm   = (BLT_PcmMediaType*)*merged;
+    bool                    fits  = true;
+#define BLT_TEE_OUTPUT_MERGE_FIELD(_field)                              \
+    if (pcm->_field == 0) {                                             \
+        pcm->_field = other->_field;                                    \
+    } else if (other->_field && other->_field != pcm->_field) {         \
+        fits = false;                                                   \
+    }
+    BLT_TEE_OUTPUT_MERGE_FIELD(sample_rate)
+    BLT_TEE_OUTPUT_MERGE_FIELD(channel_count)
+    BLT_TEE_OUTPUT_MERGE_FIELD(bits_per_sample)
+    BLT_TEE_OUTPUT_MERGE_FIELD(sample_format)
+    BLT_TEE_OUTPUT_MERGE_FIELD(channel_mask)
+#undef BLT_TEE_OUTPUT_MERGE_FIELD
+    if (!fits) {
+        BLT_MediaType_Free(*merged);
+        *merged = NULL;
+    }
+}
+
+/*----------------------------------------------------------------------
+|    TeeChild::Accepts
++---------------------------------------------------------------------*/
+bool
+TeeChild::Accepts(const BLT_MediaType* media_type)
+{
+    // a node that doesn't say what it expects takes anything
+    if (m_MediaTypes.GetItemCount() == 0) return true;
+    for (unsigned int i=0; i<m_MediaTypes.GetItemCount(); i++) {
+        if (TeeOutput_AcceptsMediaType(m_MediaTypes[i], media_type)) return true;
+    }
+    return false;
+}
+
+/*----------------------------------------------------------------------
+|    TeeChild::Resync
+|
+|    Called when a stalled child has come back: what it buffered while
+|    the others went on is stale, so drop it and start over in sync.
++---------------------------------------------------------------------*/
+void
+TeeChild::Resync()
+{
+    ATX_LOG_INFO_1("%s is back, resyncing", m_Name.GetChars());
+    {
+        NPT_AutoLock node_lock(m_NodeLock);
+        BLT_SeekMode  mode = BLT_SEEK_MODE_IGNORE;
+        BLT_SeekPoint point;
+        ATX_SetMemory(&point, 0, sizeof(point));
+        BLT_MediaNode_Seek(m_Node, &mode, &point);
+    }
+
+    NPT_AutoLock lock(m_Output.m_Lock);
+    if (m_State == STATE_STALLED) m_State = STATE_ACTIVE;
+    m_NeedsPriming = true;
+    m_LastProgress = TeeOutput::Now();
+}
+
+/*----------------------------------------------------------------------
+|    TeeChild::Run
++---------------------------------------------------------------------*/
+void
+TeeChild::Run()
+{
+    for (;;) {
+        m_WakeUp.SetValue(0);
+
+        // take the next packet
+        TeeEntry* entry  = NULL;
+        bool      resync = false;
+        {
+            NPT_AutoLock lock(m_Output.m_Lock);
+            if (m_ShouldExit) {
+                ATX_LOG_FINE_1("terminating the thread of %s", m_Name.GetChars());
+                return;
+            }
+            if (m_State == STATE_STALLED) {
+                resync = true;
+            } else if (m_State == STATE_ACTIVE && NPT_SUCCEEDED(m_Queue.PopHead(entry))) {
+                m_QueuedDuration -= entry->m_Duration;
+                m_Busy = true;
+            }
+        }
+        if (resync) {
+            Resync();
+            continue;
+        }
+        if (entry == NULL) {
+            m_WakeUp.WaitUntilEquals(1, BLT_TEE_OUTPUT_IDLE_WAIT);
+            continue;
+        }
+
+        // play it
+        BLT_OutputNodeStatus status;
+        bool                 has_status = false;
+        BLT_Result           result;
+        {
+            NPT_AutoLock node_lock(m_NodeLock);
+            result = BLT_PacketConsumer_PutPacket(m_Consumer, entry->m_Packet);
+            if (BLT_SUCCEEDED(result) && m_OutputNode) {
+                has_status = BLT_SUCCEEDED(BLT_OutputNode_GetStatus(m_OutputNode, &status));
+            }
+        }
+
+        // hand it back
+        {
+            NPT_AutoLock lock(m_Output.m_Lock);
+            m_Busy = false;
+            m_LastProgress = TeeOutput::Now();
+            if (has_status) {
+                m_Status    = status;
+                m_HasStatus = true;
+            }
+            if (BLT_FAILED(result) && m_State == STATE_ACTIVE) {
+                ATX_LOG_WARNING_2("%s failed (%d), dropping it", m_Name.GetChars(), result);
+                m_State = STATE_FAILED;
+                m_Output.m_LastError = result;
+                Flush();
+            }
+            m_Output.Finish(entry);
+        }
+        m_Output.m_RoomAvailable.SetValue(1);
+    }
+}
+
+/*----------------------------------------------------------------------
+|    TeeOutput::TeeOutput
++---------------------------------------------------------------------*/
+TeeOutput::TeeOutput(BLT_Core* core) :
+    m_Core(core),
+    m_MediaType(NULL),
+    m_RoomAvailable(0),
+    m_LastError(BLT_SUCCESS)
+{
+    BLT_MediaType_Init(&m_ExpectedMediaType, BLT_MEDIA_TYPE_ID_UNKNOWN);
+}
+
+/*----------------------------------------------------------------------
+|    TeeOutput::~TeeOutput
++---------------------------------------------------------------------*/
+TeeOutput::~TeeOutput()
+{
+    // stop the threads first, nothing touches the queues after that
+    for (unsigned int i=0; i<m_Children.GetItemCount(); i++) {
+        TeeChild* child = m_Children[i];
+        {
+            NPT_AutoLock lock(m_Lock);
+            child->Flush();
+        }
+        delete child;
+    }
+    ReleaseFinishedEntries();
+
+    for (unsigned int i=0; i<m_MediaTypes.GetItemCount(); i++) {
+        BLT_MediaType_Free(m_MediaTypes[i]);
+    }
+    if (m_MediaType) BLT_MediaType_Free(m_MediaType);
+}
+
+/*----------------------------------------------------------------------
+|    TeeOutput::Now
++---------------------------------------------------------------------*/
+NPT_UInt64
+TeeOutput::Now()
+{
+    NPT_TimeStamp now;
+    NPT_System::GetCurrentTimeStamp(now);
+    return now.ToMillis();
+}
+
+/*----------------------------------------------------------------------
+|    TeeOutput::AddChild
++---------------------------------------------------------------------*/
+BLT_Result
+TeeOutput::AddChild(const BLT_MediaNodeConstructor* constructor,
+                    const char*                     name,
+                    unsigned int                    latency)
+{
+    BLT_MediaNodeConstructor child_constructor = *constructor;
+    BLT_MediaNode*           node = NULL;
+
+    child_constructor.name = name;
+    BLT_Result result = BLT_Core_CreateCompatibleMediaNode(m_Core, &child_constructor, &node);
+    if (BLT_FAILED(result)) {
+        ATX_LOG_WARNING_2("cannot create output %s (%d)", name, result);
+        return result;
+    }
+
+    // the children are fed packets, whatever they are
+    BLT_MediaPort*      port     = NULL;
+    BLT_PacketConsumer* consumer = NULL;
+    if (BLT_SUCCEEDED(BLT_MediaNode_GetPortByName(node, "input", &port))) {
+        consumer = ATX_CAST(port, BLT_PacketConsumer);
+    }
+    if (consumer == NULL) {
+        ATX_LOG_WARNING_1("output %s doesn't take packets", name);
+        ATX_RELEASE_OBJECT(node);
+        return BLT_ERROR_INVALID_INTERFACE;
+    }
+
+    TeeChild* child = new TeeChild(*this, name, latency);
+    child->m_Node       = node;
+    child->m_Port       = port;
+    child->m_Consumer   = consumer;
+    child->m_OutputNode = ATX_CAST(node, BLT_OutputNode);
+    m_Children.Add(child);
+
+    // remember what it expects, to negotiate the format for all of them
+    const BLT_MediaType* media_type = NULL;
+    for (BLT_Ordinal index=0;
+         BLT_SUCCEEDED(BLT_MediaPort_QueryMediaType(port, index, &media_type)) && media_type;
+         index++) {
+        BLT_MediaType* clone = NULL;
+        if (BLT_SUCCEEDED(BLT_MediaType_Clone(media_type, &clone))) {
+            child->m_MediaTypes.Add(clone);
+        }
+    }
+
+    return BLT_SUCCESS;
+}
+
+/*----------------------------------------------------------------------
+|    TeeOutput::StartThreads
++---------------------------------------------------------------------*/
+void
+TeeOutput::StartThreads()
+{
+    // line every child up with the one that has the largest latency
+    unsigned int max_latency = 0;
+    for (unsigned int i=0; i<m_Children.GetItemCount(); i++) {
+        if (m_Children[i]->m_Latency > max_latency) max_latency = m_Children[i]->m_Latency;
+    }
+    for (unsigned int i=0; i<m_Children.GetItemCount(); i++) {
+        m_Children[i]->m_Delay = max_latency-m_Children[i]->m_Latency;
+        m_Children[i]->m_LastProgress = Now();
+        m_Children[i]->Start();
+    }
+
+    // offer the formats that every child expects, starting with the
+    // ones the first child prefers
+    if (m_Children.GetItemCount() == 0) return;
+    TeeChild*    first           = m_Children[0];
+    unsigned int candidate_count = first->m_MediaTypes.GetItemCount();
+    for (unsigned int t=0; t<(candidate_count?candidate_count:1); t++) {
+        const BLT_MediaType* candidate = candidate_count ? first->m_MediaTypes[t] : &m_ExpectedMediaType;
+        BLT_MediaType*       merged    = NULL;
+        BLT_MediaType_Clone(candidate, &merged);
+        for (unsigned int i=1; merged && i<m_Children.GetItemCount(); i++) {
+            TeeChild* child = m_Children[i];
+            if (child->m_MediaTypes.GetItemCount() == 0) continue; // takes anything
+            BLT_MediaType* common = NULL;
+            for (unsigned int c=0; common == NULL && c<child->m_MediaTypes.GetItemCount(); c++) {
+                TeeOutput_MergeMediaTypes(merged, child->m_MediaTypes[c], &common);
+            }
+            BLT_MediaType_Free(merged);
+            merged = common;
+        }
+        if (merged) m_MediaTypes.Add(merged);
+    }
+    if (m_MediaTypes.GetItemCount() == 0) {
+        ATX_LOG_WARNING("the outputs have no format in common");
+    }
+}
+
+/*----------------------------------------------------------------------
+|    TeeOutput::CreateEntry
+|
+|    Makes a copy of a packet for one child. Must be called from the
+|    thread that calls the node.
++---------------------------------------------------------------------*/
+TeeEntry*
+TeeOutput::CreateEntry(BLT_MediaPacket* packet, NPT_UInt64 duration)
+{
+    const BLT_MediaType* media_type = NULL;
+    BLT_MediaPacket*     copy       = NULL;
+    BLT_Size             size       = BLT_MediaPacket_GetPayloadSize(packet);
+
+    BLT_MediaPacket_GetMediaType(packet, &media_type);
+    if (BLT_FAILED(BLT_Core_CreateMediaPacket(m_Core, size, media_type, &copy))) {
+        return NULL;
+    }
+    if (size) {
+        ATX_CopyMemory(BLT_MediaPacket_GetPayloadBuffer(copy),
+                       BLT_MediaPacket_GetPayloadBuffer(packet),
+                       size);
+    }
+    BLT_MediaPacket_SetPayloadSize(copy, size);
+    BLT_MediaPacket_SetTimeStamp(copy, BLT_MediaPacket_GetTimeStamp(packet));
+    BLT_MediaPacket_SetDuration(copy, BLT_MediaPacket_GetDuration(packet));
+    BLT_MediaPacket_SetFlags(copy, BLT_MediaPacket_GetFlags(packet));
+
+    TeeEntry* entry = new TeeEntry;
+    entry->m_Packet   = copy;
+    entry->m_Duration = duration;
+    return entry;
+}
+
+/*----------------------------------------------------------------------
+|    TeeOutput::CreateSilence
+|
+|    Delays a child by adding to 'entries' its m_Delay milliseconds of
+|    silence, in the format of the packet it is about to play. Must be
+|    called from the thread that calls the node.
++---------------------------------------------------------------------*/
+BLT_Result
+TeeOutput::CreateSilence(TeeChild* child, BLT_MediaPacket* packet, NPT_List<TeeEntry*>& entries)
+{
+    const BLT_MediaType* media_type = NULL;
+    BLT_MediaPacket_GetMediaType(packet, &media_type);
+    if (child->m_Delay == 0 || media_type == NULL || media_type->id != BLT_MEDIA_TYPE_ID_AUDIO_PCM) {
+        return BLT_SUCCESS;
+    }
+    const BLT_PcmMediaType* pcm_type = (const BLT_PcmMediaType*)media_type;
+    unsigned int frame_size = pcm_type->channel_count*(pcm_type->bits_per_sample/8);
+    if (frame_size == 0 || pcm_type->sample_rate == 0) return BLT_SUCCESS;
+
+    // unsigned samples are silent in the middle of their range
+    int fill = 0;
+    if (pcm_type->bits_per_sample == 8 &&
+        (pcm_type->sample_format == BLT_PCM_SAMPLE_FORMAT_UNSIGNED_INT_BE ||
+         pcm_type->sample_format == BLT_PCM_SAMPLE_FORMAT_UNSIGNED_INT_LE)) {
+        fill = 0x80;
+    }
+
+    NPT_UInt64 frames = ((NPT_UInt64)child->m_Delay*pcm_type->sample_rate)/1000;
+    ATX_LOG_FINE_2("delaying %s by %d ms", child->m_Name.GetChars(), child->m_Delay);
+    while (frames) {
+        unsigned int chunk = frames > BLT_TEE_OUTPUT_SILENCE_PACKET_FRAMES ?
+                             BLT_TEE_OUTPUT_SILENCE_PACKET_FRAMES : (unsigned int)frames;
+        BLT_MediaPacket* silence = NULL;
+        BLT_Result result = BLT_Core_CreateMediaPacket(m_Core,
+                                                       chunk*frame_size,
+                                                       media_type,
+                                                       &silence);
+        if (BLT_FAILED(result)) return result;
+        ATX_SetMemory(BLT_MediaPacket_GetPayloadBuffer(silence), fill, chunk*frame_size);
+        BLT_MediaPacket_SetPayloadSize(silence, chunk*frame_size);
+        BLT_MediaPacket_SetTimeStamp(silence, BLT_MediaPacket_GetTimeStamp(packet));
+
+        TeeEntry* entry = new TeeEntry;
+        entry->m_Packet   = silence;
+        entry->m_Duration = ((NPT_UInt64)chunk*1000000)/pcm_type->sample_rate;
+        entries.Add(entry);
+        frames -= chunk;
+    }
+
+    return BLT_SUCCESS;
+}
+
+/*----------------------------------------------------------------------
+|    TeeOutput::Finish
+|
+|    Hands an entry back to the thread that calls the node, which
+|    releases it. Must be called with the lock held.
++---------------------------------------------------------------------*/
+void
+TeeOutput::Finish(TeeEntry* entry)
+{
+    m_FinishedEntries.Add(entry);
+}
+
+/*----------------------------------------------------------------------
+|    TeeOutput::DestroyEntry
++---------------------------------------------------------------------*/
+void
+TeeOutput::DestroyEntry(TeeEntry* entry)
+{
+    BLT_MediaPacket_Release(entry->m_Packet);
+    delete entry;
+}
+
+/*----------------------------------------------------------------------
+|    TeeOutput::ReleaseFinishedEntries
+|
+|    Must be called from the thread that calls the node, since that is
+|    the thread that owns the packet references.
++---------------------------------------------------------------------*/
+void
+TeeOutput::ReleaseFinishedEntries()
+{
+    NPT_List<TeeEntry*> finished;
+    TeeEntry*           entry;
+    {
+        NPT_AutoLock lock(m_Lock);
+        while (NPT_SUCCEEDED(m_FinishedEntries.PopHead(entry))) {
+            finished.Add(entry);
+        }
+    }
+    while (NPT_SUCCEEDED(finished.PopHead(entry))) {
+        DestroyEntry(entry);
+    }
+}
+
+/*----------------------------------------------------------------------
+|    TeeOutput::FlushQueues
++---------------------------------------------------------------------*/
+void
+TeeOutput::FlushQueues()
+{
+    {
+        NPT_AutoLock lock(m_Lock);
+        for (unsigned int i=0; i<m_Children.GetItemCount(); i++) {
+            m_Children[i]->Flush();
+        }
+    }
+    ReleaseFinishedEntries();
+}
+
+/*----------------------------------------------------------------------
+|    TeeOutput::ResetProgress
+|
+|    Called when the stream starts or resumes, so that the time spent
+|    stopped doesn't count as a stall, and when it seeks, so that the
+|    children line up again from the next packet.
++---------------------------------------------------------------------*/
+void
+TeeOutput::ResetProgress(bool prime)
+{
+    NPT_AutoLock lock(m_Lock);
+    NPT_UInt64 now = Now();
+    for (unsigned int i=0; i<m_Children.GetItemCount(); i++) {
+        TeeChild* child = m_Children[i];
+        child->m_LastProgress = now;
+        if (prime) {
+            child->m_NeedsPriming = true;
+            if (child->m_State == TeeChild::STATE_FAILED) child->m_State = TeeChild::STATE_ACTIVE;
+        }
+    }
+}
+
+/*----------------------------------------------------------------------
+|    TeeOutput::WaitForRoom
+|
+|    Waits until every active child has room for one more packet, or
+|    has nothing left at all when draining. A child that doesn't take
+|    a packet for BLT_TEE_OUTPUT_STALL_TIMEOUT is marked as stalled,
+|    and its queue is flushed, so that it no longer holds up the others.
++---------------------------------------------------------------------*/
+BLT_Result
+TeeOutput::WaitForRoom(bool drain)
+{
+    for (;;) {
+        m_RoomAvailable.SetValue(0);
+        ReleaseFinishedEntries();
+
+        NPT_Timeout timeout = 0;
+        {
+            NPT_AutoLock lock(m_Lock);
+            NPT_UInt64 now = Now();
+            for (unsigned int i=0; i<m_Children.GetItemCount(); i++) {
+                TeeChild* child = m_Children[i];
+                if (child->m_State != TeeChild::STATE_ACTIVE) continue;
+                bool waiting = drain ? (child->m_Queue.GetItemCount() || child->m_Busy) : child->IsFull();
+                if (!waiting) continue;
+                NPT_UInt64 idle = now > child->m_LastProgress ? now-child->m_LastProgress : 0;
+                if (idle >= BLT_TEE_OUTPUT_STALL_TIMEOUT) {
+                    ATX_LOG_WARNING_2("%s has been stuck for %d ms, skipping it",
+                                      child->m_Name.GetChars(), (int)idle);
+                    child->m_State = TeeChild::STATE_STALLED;
+                    child->Flush();
+                    continue;
+                }
+                NPT_Timeout left = (NPT_Timeout)(BLT_TEE_OUTPUT_STALL_TIMEOUT-idle);
+                if (timeout == 0 || left < timeout) timeout = left;
+            }
+        }
+        if (timeout == 0) break;
+
+        m_RoomAvailable.WaitUntilEquals(1, timeout);
+    }
+    ReleaseFinishedEntries();
+
+    return BLT_SUCCESS;
+}
+
+/*----------------------------------------------------------------------
+|    TeeOutput::CheckMediaType
+|
+|    A packet that one of the children can't play is refused, so that
+|    the stream converts it to a format they all expect.
++---------------------------------------------------------------------*/
+BLT_Result
+TeeOutput::CheckMediaType(const BLT_MediaType* media_type)
+{
+    if (media_type == NULL) return BLT_SUCCESS;
+    if (m_MediaType && BLT_MediaType_Equals(m_MediaType, media_type)) return BLT_SUCCESS;
+
+    for (unsigned int i=0; i<m_Children.GetItemCount(); i++) {
+        if (!m_Children[i]->Accepts(media_type)) {
+            ATX_LOG_FINE_1("%s doesn't take this format", m_Children[i]->m_Name.GetChars());
+            return BLT_ERROR_INVALID_MEDIA_TYPE;
+        }
+    }
+
+    if (m_MediaType) {
+        BLT_MediaType_Free(m_MediaType);
+        m_MediaType = NULL;
+    }
+    BLT_MediaType_Clone(media_type, &m_MediaType);
+
+    return BLT_SUCCESS;
+}
+
+/*----------------------------------------------------------------------
+|    TeeOutput::PutPacket
+|
+|    Each active child gets its own copy of the packet, made here, so
+|    that the children never touch a packet that another thread uses.
++---------------------------------------------------------------------*/
+BLT_Result
+TeeOutput::PutPacket(BLT_MediaPacket* packet)
+{
+    const BLT_MediaType* media_type = NULL;
+    BLT_MediaPacket_GetMediaType(packet, &media_type);
+    BLT_Result result = CheckMediaType(media_type);
+    if (BLT_FAILED(result)) return result;
+
+    // don't get ahead of the children
+    WaitForRoom(false);
+
+    // work out how long the packet plays
+    NPT_UInt64 duration = 0;
+    if (media_type && media_type->id == BLT_MEDIA_TYPE_ID_AUDIO_PCM) {
+        const BLT_PcmMediaType* pcm_type = (const BLT_PcmMediaType*)media_type;
+        unsigned int frame_size = pcm_type->channel_count*(pcm_type->bits_per_sample/8);
+        if (frame_size && pcm_type->sample_rate) {
+            duration = ((NPT_UInt64)(BLT_MediaPacket_GetPayloadSize(packet)/frame_size)*1000000)/
+                       pcm_type->sample_rate;
+        }
+    }
+
+    // see who takes it, and who must be delayed first
+    unsigned int child_count = m_Children.GetItemCount();
+    bool         takes[BLT_TEE_OUTPUT_MAX_CHILDREN];
+    bool         primes[BLT_TEE_OUTPUT_MAX_CHILDREN];
+    {
+        NPT_AutoLock lock(m_Lock);
+        for (unsigned int i=0; i<child_count; i++) {
+            TeeChild* child = m_Children[i];
+            takes[i]  = child->m_State == TeeChild::STATE_ACTIVE;
+            primes[i] = takes[i] && child->m_NeedsPriming;
+            if (primes[i]) child->m_NeedsPriming = false;
+        }
+    }
+
+    // make the copies without the lock, the children keep playing
+    NPT_List<TeeEntry*> entries[BLT_TEE_OUTPUT_MAX_CHILDREN];
+    result = BLT_SUCCESS;
+    for (unsigned int i=0; i<child_count; i++) {
+        if (!takes[i]) continue;
+        if (primes[i]) result = CreateSilence(m_Children[i], packet, entries[i]);
+        if (BLT_FAILED(result)) break;
+        TeeEntry* entry = CreateEntry(packet, duration);
+        if (entry == NULL) {
+            result = BLT_ERROR_OUT_OF_MEMORY;
+            break;
+        }
+        entries[i].Add(entry);
+    }
+    if (BLT_FAILED(result)) {
+        NPT_AutoLock lock(m_Lock);
+        for (unsigned int i=0; i<child_count; i++) {
+            if (primes[i]) m_Children[i]->m_NeedsPriming = true;
+            TeeEntry* entry;
+            while (NPT_SUCCEEDED(entries[i].PopHead(entry))) Finish(entry);
+        }
+    } else {
+        // queue them for the children that are still active
+        NPT_AutoLock lock(m_Lock);
+        result = BLT_FAILURE;
+        for (unsigned int i=0; i<child_count; i++) {
+            TeeChild* child = m_Children[i];
+            TeeEntry* entry;
+            if (takes[i] && child->m_State == TeeChild::STATE_ACTIVE) {
+                while (NPT_SUCCEEDED(entries[i].PopHead(entry))) {
+                    child->m_Queue.Add(entry);
+                    child->m_QueuedDuration += entry->m_Duration;
+                }
+            } else {
+                if (primes[i]) child->m_NeedsPriming = true;
+                while (NPT_SUCCEEDED(entries[i].PopHead(entry))) Finish(entry);
+            }
+            if (child->m_State != TeeChild::STATE_FAILED) result = BLT_SUCCESS;
+        }
+
+        // only give up when no child can play anything anymore
+        if (BLT_FAILED(result) && BLT_FAILED(m_LastError)) result = m_LastError;
+    }
+    for (unsigned int i=0; i<child_count; i++) {
+        m_Children[i]->m_WakeUp.SetValue(1);
+    }
+    ReleaseFinishedEntries();
+
+    return result;
+}
+
+/*----------------------------------------------------------------------
+|    TeeOutput::GetStatus
++---------------------------------------------------------------------*/
+BLT_Result
+TeeOutput::GetStatus(BLT_OutputNodeStatus* status)
+{
+    status->flags = 0;
+    status->media_time.seconds     = 0;
+    status->media_time.nanoseconds = 0;
+
+    NPT_AutoLock lock(m_Lock);
+    bool found = false;
+    for (unsigned int i=0; i<m_Children.GetItemCount(); i++) {
+        TeeChild* child = m_Children[i];
+        if (child->m_State != TeeChild::STATE_ACTIVE) continue;
+        if (!found && child->m_HasStatus) {
+            status->media_time = child->m_Status.media_time;
+            status->flags      = child->m_Status.flags & ~BLT_OUTPUT_NODE_STATUS_QUEUE_FULL;
+            found = true;
+        }
+        if (child->IsFull()) status->flags |= BLT_OUTPUT_NODE_STATUS_QUEUE_FULL;
+    }
+
+    return BLT_SUCCESS;
+}
+
+/*----------------------------------------------------------------------
+|    TeeOutput_PutPacket
++---------------------------------------------------------------------*/
+BLT_METHOD
+TeeOutput_PutPacket(BLT_PacketConsumer* _self,
+                    BLT_MediaPacket*    packet)
+{
+    TeeOutput* self = ATX_SELF(_TeeOutput, BLT_PacketConsumer)->object;
+
+    /* check parameters */
+    if (packet == NULL) {
+        return BLT_ERROR_INVALID_PARAMETERS;
+    }
+
+    return self->PutPacket(packet);
+}
+
+/*----------------------------------------------------------------------
+|    TeeOutput_QueryMediaType
++---------------------------------------------------------------------*/
+BLT_METHOD
+TeeOutput_QueryMediaType(BLT_MediaPort*        _self,
+                         BLT_Ordinal           index,
+                         const BLT_MediaType** media_type)
+{
+    TeeOutput* self = ATX_SELF(_TeeOutput, BLT_MediaPort)->object;
+
+    /* the formats that all the children expect */
+    if (self->m_Children.GetItemCount() == 0 && index == 0) {
+        *media_type = &self->m_ExpectedMediaType;
+        return BLT_SUCCESS;
+    }
+    if (index < self->m_MediaTypes.GetItemCount()) {
+        *media_type = self->m_MediaTypes[index];
+        return BLT_SUCCESS;
+    } else {
+        *media_type = NULL;
+        return BLT_FAILURE;
+    }
+}
+
+/*----------------------------------------------------------------------
+|    TeeOutput_Destroy
++---------------------------------------------------------------------*/
+static BLT_Result
+_TeeOutput_Destroy(_TeeOutput* self)
+{
+    delete self->object;
+
+    /* destruct the inherited object */
+    BLT_BaseMediaNode_Destruct(&ATX_BASE(self, BLT_BaseMediaNode));
+
+    /* free the object memory */
+    ATX_FreeMemory(self);
+
+    return BLT_SUCCESS;
+}
+
+/*----------------------------------------------------------------------
+|   TeeOutput_GetPortByName
++---------------------------------------------------------------------*/
+BLT_METHOD
+TeeOutput_GetPortByName(BLT_MediaNode*  _self,
+                        BLT_CString     name,
+                        BLT_MediaPort** port)
+{
+    _TeeOutput* self = ATX_SELF_EX(_TeeOutput, BLT_BaseMediaNode, BLT_MediaNode);
+
+    if (ATX_StringsEqual(name, "input")) {
+        *port = &ATX_BASE(self, BLT_MediaPort);
+        return BLT_SUCCESS;
+    } else {
+        *port = NULL;
+        return BLT_ERROR_NO_SUCH_PORT;
+    }
+}
+
+/*----------------------------------------------------------------------
+|    TeeOutput_Seek
++---------------------------------------------------------------------*/
+BLT_METHOD
+TeeOutput_Seek(BLT_MediaNode* _self,
+               BLT_SeekMode*  mode,
+               BLT_SeekPoint* point)
+{
+    TeeOutput* self = ATX_SELF_EX(_TeeOutput, BLT_BaseMediaNode, BLT_MediaNode)->object;
+
+    self->FlushQueues();
+    for (unsigned int i=0; i<self->m_Children.GetItemCount(); i++) {
+        TeeChild* child = self->m_Children[i];
+        {
+            /* a stalled child is flushed when it comes back */
+            NPT_AutoLock lock(self->m_Lock);
+            if (child->m_State == TeeChild::STATE_STALLED) continue;
+        }
+        NPT_AutoLock node_lock(child->m_NodeLock);
+        BLT_MediaNode_Seek(child->m_Node, mode, point);
+    }
+    self->ResetProgress(true);
+
+    return BLT_SUCCESS;
+}
+
+/*----------------------------------------------------------------------
+|    TeeOutput_GetStatus
++---------------------------------------------------------------------*/
+BLT_METHOD
+TeeOutput_GetStatus(BLT_OutputNode*       _self,
+                    BLT_OutputNodeStatus* status)
+{
+    TeeOutput* self = ATX_SELF(_TeeOutput, BLT_OutputNode)->object;
+
+    return self->GetStatus(status);
+}
+
+/*----------------------------------------------------------------------
+|    TeeOutput_Drain
++---------------------------------------------------------------------*/
+BLT_METHOD
+TeeOutput_Drain(BLT_OutputNode* _self)
+{
+    TeeOutput* self = ATX_SELF(_TeeOutput, BLT_OutputNode)->object;
+
+    /* wait for the queues to empty, then for the children themselves */
+    self->WaitForRoom(true);
+    for (unsigned int i=0; i<self->m_Children.GetItemCount(); i++) {
+        TeeChild* child = self->m_Children[i];
+        {
+            NPT_AutoLock lock(self->m_Lock);
+            if (child->m_State != TeeChild::STATE_ACTIVE) continue;
+        }
+        if (child->m_OutputNode) {
+            NPT_AutoLock node_lock(child->m_NodeLock);
+            BLT_OutputNode_Drain(child->m_OutputNode);
+        }
+    }
+
+    return BLT_SUCCESS;
+}
+
+/*----------------------------------------------------------------------
+|    TeeOutput_Start
++---------------------------------------------------------------------*/
+BLT_METHOD
+TeeOutput_Start(BLT_MediaNode* _self)
+{
+    TeeOutput* self = ATX_SELF_EX(_TeeOutput, BLT_BaseMediaNode, BLT_MediaNode)->object;
+
+    for (unsigned int i=0; i<self->m_Children.GetItemCount(); i++) {
+        TeeChild*    child = self->m_Children[i];
+        NPT_AutoLock node_lock(child->m_NodeLock);
+        BLT_MediaNode_Start(child->m_Node);
+    }
+    self->ResetProgress(true);
+
+    return BLT_SUCCESS;
+}
+
+/*----------------------------------------------------------------------
+|    TeeOutput_Stop
++---------------------------------------------------------------------*/
+BLT_METHOD
+TeeOutput_Stop(BLT_MediaNode* _self)
+{
+    TeeOutput* self = ATX_SELF_EX(_TeeOutput, BLT_BaseMediaNode, BLT_MediaNode)->object;
+
+    self->FlushQueues();
+    for (unsigned int i=0; i<self->m_Children.GetItemCount(); i++) {
+        TeeChild* child = self->m_Children[i];
+        {
+            NPT_AutoLock lock(self->m_Lock);
+            if (child->m_State == TeeChild::STATE_STALLED) continue;
+        }
+        NPT_AutoLock node_lock(child->m_NodeLock);
+        BLT_MediaNode_Stop(child->m_Node);
+    }
+
+    return BLT_SUCCESS;
+}
+
+/*----------------------------------------------------------------------
+|    TeeOutput_Pause
++---------------------------------------------------------------------*/
+BLT_METHOD
+TeeOutput_Pause(BLT_MediaNode* _self)
+{
+    TeeOutput* self = ATX_SELF_EX(_TeeOutput, BLT_BaseMediaNode, BLT_MediaNode)->object;
+
+    for (unsigned int i=0; i<self->m_Children.GetItemCount(); i++) {
+        TeeChild* child = self->m_Children[i];
+        {
+            NPT_AutoLock lock(self->m_Lock);
+            if (child->m_State == TeeChild::STATE_STALLED) continue;
+        }
+        NPT_AutoLock node_lock(child->m_NodeLock);
+        BLT_MediaNode_Pause(child->m_Node);
+    }
+
+    return BLT_SUCCESS;
+}
+
+/*----------------------------------------------------------------------
+|    TeeOutput_Resume
++---------------------------------------------------------------------*/
+BLT_METHOD
+TeeOutput_Resume(BLT_MediaNode* _self)
+{
+    TeeOutput* self = ATX_SELF_EX(_TeeOutput, BLT_BaseMediaNode, BLT_MediaNode)->object;
+
+    for (unsigned int i=0; i<self->m_Children.GetItemCount(); i++) {
+        TeeChild* child = self->m_Children[i];
+        {
+            NPT_AutoLock lock(self->m_Lock);
+            if (child->m_State == TeeChild::STATE_STALLED) continue;
+        }
+        NPT_AutoLock node_lock(child->m_NodeLock);
+        BLT_MediaNode_Resume(child->m_Node);
+    }
+    self->ResetProgress(false);
+
+    return BLT_SUCCESS;
+}
+
+/*----------------------------------------------------------------------
+|   TeeOutput_Activate
++---------------------------------------------------------------------*/
+BLT_METHOD
+TeeOutput_Activate(BLT_MediaNode* _self, BLT_Stream* stream)
+{
+    _TeeOutput* self = ATX_SELF_EX(_TeeOutput, BLT_BaseMediaNode, BLT_MediaNode);
+
+    /* keep a reference to the stream */
+    ATX_BASE(self, BLT_BaseMediaNode).context = stream;
+
+    /* the children see the same stream */
+    for (unsigned int i=0; i<self->object->m_Children.GetItemCount(); i++) {
+        TeeChild*    child = self->object->m_Children[i];
+        NPT_AutoLock node_lock(child->m_NodeLock);
+        BLT_MediaNode_Activate(child->m_Node, stream);
+    }
+
+    return BLT_SUCCESS;
+}
+
+/*----------------------------------------------------------------------
+|   TeeOutput_Deactivate
++---------------------------------------------------------------------*/
+BLT_METHOD
+TeeOutput_Deactivate(BLT_MediaNode* _self)
+{
+    _TeeOutput* self = ATX_SELF_EX(_TeeOutput, BLT_BaseMediaNode, BLT_MediaNode);
+
+    self->object->FlushQueues();
+    for (unsigned int i=0; i<self->object->m_Children.GetItemCount(); i++) {
+        TeeChild*    child = self->object->m_Children[i];
+        NPT_AutoLock node_lock(child->m_NodeLock);
+        BLT_MediaNode_Deactivate(child->m_Node);
+    }
+
+    /* we're detached from the stream */
+    ATX_BASE(self, BLT_BaseMediaNode).context = NULL;
+
+    return BLT_SUCCESS;
+}
+
+/*----------------------------------------------------------------------
+|   GetInterface implementation
++---------------------------------------------------------------------*/
+ATX_BEGIN_GET_INTERFACE_IMPLEMENTATION(_TeeOutput)
+    ATX_GET_INTERFACE_ACCEPT_EX(_TeeOutput, BLT_BaseMediaNode, BLT_MediaNode)
+    ATX_GET_INTERFACE_ACCEPT_EX(_TeeOutput, BLT_BaseMediaNode, ATX_Referenceable)
+    ATX_GET_INTERFACE_ACCEPT   (_TeeOutput, BLT_OutputNode)
+    ATX_GET_INTERFACE_ACCEPT   (_TeeOutput, BLT_MediaPort)
+    ATX_GET_INTERFACE_ACCEPT   (_TeeOutput, BLT_PacketConsumer)
+ATX_END_GET_INTERFACE_IMPLEMENTATION
+
+/*----------------------------------------------------------------------
+|    BLT_MediaPort interface
++---------------------------------------------------------------------*/
+BLT_MEDIA_PORT_IMPLEMENT_SIMPLE_TEMPLATE(TeeOutput, "input", PACKET, IN)
+ATX_BEGIN_INTERFACE_MAP(_TeeOutput, BLT_MediaPort)
+    TeeOutput_GetName,
+    TeeOutput_GetProtocol,
+    TeeOutput_GetDirection,
+    TeeOutput_QueryMediaType
+ATX_END_INTERFACE_MAP
+
+/*----------------------------------------------------------------------
+|    BLT_PacketConsumer interface
++---------------------------------------------------------------------*/
+ATX_BEGIN_INTERFACE_MAP(_TeeOutput, BLT_PacketConsumer)
+    TeeOutput_PutPacket
+ATX_END_INTERFACE_MAP
+
+/*----------------------------------------------------------------------
+|    BLT_MediaNode interface
++---------------------------------------------------------------------*/
+ATX_BEGIN_INTERFACE_MAP_EX(_TeeOutput, BLT_BaseMediaNode, BLT_MediaNode)
+    BLT_BaseMediaNode_GetInfo,
+    TeeOutput_GetPortByName,
+    TeeOutput_Activate,
+    TeeOutput_Deactivate,
+    TeeOutput_Start,
+    TeeOutput_Stop,
+    TeeOutput_Pause,
+    TeeOutput_Resume,
+    TeeOutput_Seek
+ATX_END_INTERFACE_MAP_EX
+
+/*----------------------------------------------------------------------
+|    BLT_OutputNode interface
++---------------------------------------------------------------------*/
+ATX_BEGIN_INTERFACE_MAP(_TeeOutput, BLT_OutputNode)
+    TeeOutput_GetStatus,
+    TeeOutput_Drain
+ATX_END_INTERFACE_MAP
+
+/*----------------------------------------------------------------------
+|   ATX_Referenceable interface
++---------------------------------------------------------------------*/
+ATX_IMPLEMENT_REFERENCEABLE_INTERFACE_EX(_TeeOutput,
+                                         BLT_BaseMediaNode,
+                                         reference_count)
+
+/*----------------------------------------------------------------------
+|    TeeOutput_Create
++---------------------------------------------------------------------*/
+static BLT_Result
+TeeOutput_Create(BLT_Module*              module,
+                 BLT_Core*                core,
+                 BLT_ModuleParametersType parameters_type,
+                 const void*              parameters,
+                 BLT_MediaNode**          object)
+{
+    _TeeOutput*               self;
+    BLT_MediaNodeConstructor* constructor = (BLT_MediaNodeConstructor*)parameters;
+
+    /* check parameters */
+    *object = NULL;
+    if (parameters == NULL ||
+        parameters_type != BLT_MODULE_PARAMETERS_TYPE_MEDIA_NODE_CONSTRUCTOR) {
+        return BLT_ERROR_INVALID_PARAMETERS;
+    }
+    if (!ATX_StringsEqualN(constructor->name, "tee:", 4)) {
+        return BLT_ERROR_INTERNAL;
+    }
+
+    /* allocate memory for the object */
+    self = (_TeeOutput*)ATX_AllocateZeroMemory(sizeof(_TeeOutput));
+    if (self == NULL) {
+        return BLT_ERROR_OUT_OF_MEMORY;
+    }
+    self->object = new TeeOutput(core);
+
+    /* construct the inherited object */
+    BLT_BaseMediaNode_Construct(&ATX_BASE(self, BLT_BaseMediaNode), module, core);
+
+    /* setup interfaces */
+    ATX_SET_INTERFACE_EX(self, _TeeOutput, BLT_BaseMediaNode, BLT_MediaNode);
+    ATX_SET_INTERFACE_EX(self, _TeeOutput, BLT_BaseMediaNode, ATX_Referenceable);
+    ATX_SET_INTERFACE   (self, _TeeOutput, BLT_PacketConsumer);
+    ATX_SET_INTERFACE   (self, _TeeOutput, BLT_OutputNode);
+    ATX_SET_INTERFACE   (self, _TeeOutput, BLT_MediaPort);
+
+    /* create the children: 'tee:<name>[#<latency>]|<name>[#<latency>]|...' */
+    NPT_String           names = constructor->name+4;
+    NPT_List<NPT_String> parts = names.Split("|");
+    BLT_Result           result = BLT_SUCCESS;
+    for (NPT_List<NPT_String>::Iterator part = parts.GetFirstItem(); part; ++part) {
+        NPT_String   name    = *part;
+        unsigned int latency = 0;
+        int          sharp   = name.ReverseFind('#');
+        if (sharp >= 0) {
+            NPT_String latency_string = name.GetChars()+sharp+1;
+            if (NPT_FAILED(latency_string.ToInteger(latency)) ||
+                latency > BLT_TEE_OUTPUT_MAX_LATENCY) {
+                ATX_LOG_WARNING_1("invalid latency for %s", name.GetChars());
+                result = BLT_ERROR_INVALID_PARAMETERS;
+                break;
+            }
+            name.SetLength(sharp);
+        }
+        if (name.IsEmpty() || self->object->m_Children.GetItemCount() == BLT_TEE_OUTPUT_MAX_CHILDREN) {
+            ATX_LOG_WARNING("invalid syntax");
+            result = BLT_ERROR_INVALID_PARAMETERS;
+            break;
+        }
+        result = self->object->AddChild(constructor, name, latency);
+        if (BLT_FAILED(result)) break;
+    }
+    if (BLT_SUCCEEDED(result) && self->object->m_Children.GetItemCount() == 0) {
+        result = BLT_ERROR_INVALID_PARAMETERS;
+    }
+    if (BLT_FAILED(result)) {
+        _TeeOutput_Destroy(self);
+        return result;
+    }
+    self->object->StartThreads();
+
+    *object = &ATX_BASE_EX(self, BLT_BaseMediaNode, BLT_MediaNode);
+
+    return BLT_SUCCESS;
+}
+
+/*----------------------------------------------------------------------
+|   TeeOutputModule_Probe
++---------------------------------------------------------------------*/
+BLT_METHOD
+TeeOutputModule_Probe(BLT_Module*              self,
+                      BLT_Core*                core,
+                      BLT_ModuleParametersType parameters_type,
+                      BLT_AnyConst             parameters,
+                      BLT_Cardinal*            match)
+{
+    BLT_COMPILER_UNUSED(self);
+    BLT_COMPILER_UNUSED(core);
+
+    switch (parameters_type) {
+      case BLT_MODULE_PARAMETERS_TYPE_MEDIA_NODE_CONSTRUCTOR:
+        {
+            BLT_MediaNodeConstructor* constructor =
+                (BLT_MediaNodeConstructor*)parameters;
+
+            /* the input protocol should be PACKET and the */
+            /* output protocol should be NONE              */
+            if ((constructor->spec.input.protocol != BLT_MEDIA_PORT_PROTOCOL_ANY &&
+                 constructor->spec.input.protocol != BLT_MEDIA_PORT_PROTOCOL_PACKET) ||
+                (constructor->spec.output.protocol != BLT_MEDIA_PORT_PROTOCOL_ANY &&
+                 constructor->spec.output.protocol != BLT_MEDIA_PORT_PROTOCOL_NONE)) {
+                return BLT_FAILURE;
+            }
+
+            /* the name should be 'tee:<name>|<name>...' */
+            if (constructor->name == NULL ||
+                !ATX_StringsEqualN(constructor->name, "tee:", 4)) {
+                return BLT_FAILURE;
+            }
+
+            /* always an exact match, since we only respond to our name */
+            *match = BLT_MODULE_PROBE_MATCH_EXACT;
+
+            return BLT_SUCCESS;
+        }
+        break;
+
+      default:
+        break;
+    }
+
+    return BLT_FAILURE;
+}
+
+/*----------------------------------------------------------------------
+|   GetInterface implementation
++---------------------------------------------------------------------*/
+ATX_BEGIN_GET_INTERFACE_IMPLEMENTATION(TeeOutputModule)
+    ATX_GET_INTERFACE_ACCEPT_EX(TeeOutputModule, BLT_BaseModule, BLT_Module)
+    ATX_GET_INTERFACE_ACCEPT_EX(TeeOutputModule, BLT_BaseModule, ATX_Referenceable)
+ATX_END_GET_INTERFACE_IMPLEMENTATION
+
+/*----------------------------------------------------------------------
+|   node factory
++---------------------------------------------------------------------*/
+BLT_MODULE_IMPLEMENT_SIMPLE_MEDIA_NODE_FACTORY(TeeOutputModule, TeeOutput)
+
+/*----------------------------------------------------------------------
+|   BLT_Module interface
++---------------------------------------------------------------------*/
+ATX_BEGIN_INTERFACE_MAP_EX(TeeOutputModule, BLT_BaseModule, BLT_Module)
+    BLT_BaseModule_GetInfo,
+    BLT_BaseModule_Attach,
+    TeeOutputModule_CreateInstance,
+    TeeOutputModule_Probe
+ATX_END_INTERFACE_MAP
+
+/*----------------------------------------------------------------------
+|   ATX_Referenceable interface
++---------------------------------------------------------------------*/
+#define TeeOutputModule_Destroy(x) \
+    BLT_BaseModule_Destroy((BLT_BaseModule*)(x))
+
+ATX_IMPLEMENT_REFERENCEABLE_INTERFACE_EX(TeeOutputModule,
+                                         BLT_BaseModule,
+                                         reference_count)
+
+/*----------------------------------------------------------------------
+|   module object
++---------------------------------------------------------------------*/
+BLT_MODULE_IMPLEMENT_STANDARD_GET_MODULE(TeeOutputModule,
+                                         "Tee Output",
+                                         "com.axiosys.output.tee",
+                                         "1.0.0",
+                                         BLT_MODULE_AXIOMATIC_COPYRIGHT)
@@ -0,0 +1,72 @@
+/*****************************************************************
+|
+|   Tee Output Module
+|
+|   (c) 2002-2012 Gilles Boccon-Gibod
+|   Author: Gilles Boccon-Gibod (bok@bok.net)
+|
+ ****************************************************************/
+
+#ifndef _BLT_TEE_OUTPUT_H_
+#define _BLT_TEE_OUTPUT_H_
+
+/**
+ * @ingroup plugin_modules
+ * @ingroup plugin_output_modules
+ * @defgroup tee_output_module Tee Output Module
+ * Plugin module that creates media nodes that send the packets of one
+ * stream to several other output nodes, so that the stream is decoded
+ * only once.
+ * This module responds to probe with the name:
+ * 'tee:<output>[#<latency>]|<output>[#<latency>]|...'
+ * where each <output> is the name of an output, as it would be passed
+ * to BLT_Stream_SetOutput, and <latency> is the time, in milliseconds,
+ * between the moment that output receives a packet and the moment the
+ * packet is heard. Each output is delayed, with silence, by the
+ * difference between the largest latency and its own, so that they
+ * all play in sync.
+ * Ex: 'tee:alsa:default#50|raop://192.168.1.10:5000#2000'
+ *
+ * Each output has its own queue, and a thread that feeds it. The
+ * packets are copied for each output on the thread that calls the
+ * node, which also releases them once played. The decoder only waits
+ * when an output's queue is full. An output that
+ * doesn't take a packet for BLT_TEE_OUTPUT_STALL_TIMEOUT milliseconds
+ * stops receiving packets, so that it doesn't hold up the others. When
+ * it gets going again, it is flushed and rejoins the stream in sync.
+ * Output nodes used this way must not keep references to the packets
+ * they receive after their PutPacket method returns.
+ * The node only accepts the formats that all the outputs expect, so
+ * that the stream converts the packets for them when it can.
+ * The status returned by the node is the status of the first output
+ * that is receiving packets.
+ * @{
+ */
+
+/*----------------------------------------------------------------------
+|   includes
++---------------------------------------------------------------------*/
+#include "BltTypes.h"
+#include "BltModule.h"
+
+/*----------------------------------------------------------------------
+|   constants
++---------------------------------------------------------------------*/
+#define BLT_TEE_OUTPUT_STALL_TIMEOUT 2000 /* milliseconds */
+
+#if defined(__cplusplus)
+extern "C" {
+#endif
+
+/*----------------------------------------------------------------------
+|   module
++---------------------------------------------------------------------*/
+BLT_Result BLT_TeeOutputModule_GetModuleObject(BLT_Module** module);
+
+#if defined(__cplusplus)
+}
+#endif
+
+/** @} */
+
+#endif /* _BLT_TEE_OUTPUT_H_ */
@@ -0,0 +1,149 @@
+/*****************************************************************
+|
+|   BlueTune - AES-CBC Test
+|
+|   (c) 2002-2012 Gilles Boccon-Gibod
+|   Author: Gilles Boccon-Gibod (bok@bok.net)
+|
+****************************************************************/
+
+/*----------------------------------------------------------------------
+|    includes
++---------------------------------------------------------------------*/
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "Atomix.h"
+#include "BltConfig.h"
+#include "BltErrors.h"
+#include "BltAesCbc.h"
+
+/*----------------------------------------------------------------------
+|    CHECK
++---------------------------------------------------------------------*/
+#define CHECK(x)                                        \
+do {                                                    \
+    if (!(x)) {                                         \
+        fprintf(stderr, "FAILED line %d\n", __LINE__);  \
+        abort();                                        \
+    }                                                   \
+} while(0)
+
+/*----------------------------------------------------------------------
+|    test vectors
++---------------------------------------------------------------------*/
+/* NIST SP 800-38A, F.2.1 CBC-AES128.Encrypt */
+static const BLT_UInt8 Sp800Key[16] = {
+    0x2b, 0x7e, 0x15, 0x16, 0x28, 0xae, 0xd2, 0xa6, 0xab, 0xf7, 0x15, 0x88, 0x09, 0xcf, 0x4f, 0x3c
+};
+static const BLT_UInt8 Sp800Iv[16] = {
+    0x00, 0x01, 0x02, 0x03, 0x04, 0x05, 0x06, 0x07, 0x08, 0x09, 0x0a, 0x0b, 0x0c, 0x0d, 0x0e, 0x0f
+};
+static const BLT_UInt8 Sp800Plaintext[64] = {
+    0x6b, 0xc1, 0xbe, 0xe2, 0x2e, 0x40, 0x9f, 0x96, 0xe9, 0x3d, 0x7e, 0x11, 0x73, 0x93, 0x17, 0x2a,
+    0xae, 0x2d, 0x8a, 0x57, 0x1e, 0x03, 0xac, 0x9c, 0x9e, 0xb7, 0x6f, 0xac, 0x45, 0xaf, 0x8e, 0x51,
+    0x30, 0xc8, 0x1c, 0x46, 0xa3, 0x5c, 0xe4, 0x11, 0xe5, 0xfb, 0xc1, 0x19, 0x1a, 0x0a, 0x52, 0xef,
+    0xf6, 0x9f, 0x24, 0x45, 0xdf, 0x4f, 0x9b, 0x17, 0xad, 0x2b, 0x41, 0x7b, 0xe6, 0x6c, 0x37, 0x10
+};
+static const BLT_UInt8 Sp800Ciphertext[64] = {
+    0x76, 0x49, 0xab, 0xac, 0x81, 0x19, 0xb2, 0x46, 0xce, 0xe9, 0x8e, 0x9b, 0x12, 0xe9, 0x19, 0x7d,
+    0x50, 0x86, 0xcb, 0x9b, 0x50, 0x72, 0x19, 0xee, 0x95, 0xdb, 0x11, 0x3a, 0x91, 0x76, 0x78, 0xb2,
+    0x73, 0xbe, 0xd6, 0xb8, 0xe3, 0xc1, 0x74, 0x3b, 0x71, 0x16, 0xe6, 0x9e, 0x22, 0x22, 0x95, 0x16,
+    0x3f, 0xf1, 0xca, 0xa1, 0x68, 0x1f, 0xac, 0x09, 0x12, 0x0e, 0xca, 0x30, 0x75, 0x86, 0xe1, 0xa7
+};
+
+/* FIPS-197, C.1: with a zero IV, one block of CBC is the cipher itself */
+static const BLT_UInt8 FipsKey[16] = {
+    0x00, 0x01, 0x02, 0x03, 0x04, 0x05, 0x06, 0x07, 0x08, 0x09, 0x0a, 0x0b, 0x0c, 0x0d, 0x0e, 0x0f
+};
+static const BLT_UInt8 FipsPlaintext[16] = {
+    0x00, 0x11, 0x22, 0x33, 0x44, 0x55, 0x66, 0x77, 0x88, 0x99, 0xaa, 0xbb, 0xcc, 0xdd, 0xee, 0xff
+};
+static const BLT_UInt8 FipsCiphertext[16] = {
+    0x69, 0xc4, 0xe0, 0xd8, 0x6a, 0x7b, 0x04, 0x30, 0xd8, 0xcd, 0xb7, 0x80, 0x70, 0xb4, 0xc5, 0x5a
+};
+
+/*----------------------------------------------------------------------
+|    TestVectors
++---------------------------------------------------------------------*/
+static void
+TestVectors(void)
+{
+    BLT_AesCbc* cipher = NULL;
+    BLT_UInt8   zero[16];
+    BLT_UInt8   out[64];
+
+    CHECK(BLT_SUCCEEDED(BLT_AesCbc_Create(Sp800Key, &cipher)));
+    BLT_AesCbc_Encrypt(cipher, Sp800Iv, Sp800Plaintext, out, 4);
+    CHECK(memcmp(out, Sp800Ciphertext, 64) == 0);
+    BLT_AesCbc_Destroy(cipher);
+
+    memset(zero, 0, sizeof(zero));
+    CHECK(BLT_SUCCEEDED(BLT_AesCbc_Create(FipsKey, &cipher)));
+    BLT_AesCbc_Encrypt(cipher, zero, FipsPlaintext, out, 1);
+    CHECK(memcmp(out, FipsCiphertext, 16) == 0);
+    BLT_AesCbc_Destroy(cipher);
+}
+
+/*----------------------------------------------------------------------
+|    TestChaining
+|
+|    Encrypting in place, or a block at a time chaining from the last
+|    output, gives the same result as a single call.
++---------------------------------------------------------------------*/
+static void
+TestChaining(void)
+{
+    BLT_AesCbc*  cipher = NULL;
+    BLT_UInt8    out[64];
+    unsigned int i;
+
+    CHECK(BLT_SUCCEEDED(BLT_AesCbc_Create(Sp800Key, &cipher)));
+
+    memcpy(out, Sp800Plaintext, 64);
+    BLT_AesCbc_Encrypt(cipher, Sp800Iv, out, out, 4);
+    CHECK(memcmp(out, Sp800Ciphertext, 64) == 0);
+
+    BLT_AesCbc_Encrypt(cipher, Sp800Iv, Sp800Plaintext, out, 1);
+    for (i=1; i<4; i++) {
+        BLT_AesCbc_Encrypt(cipher, out+(i-1)*16, Sp800Plaintext+i*16, out+i*16, 1);
+    }
+    CHECK(memcmp(out, Sp800Ciphertext, 64) == 0);
+
+    /* no blocks, no output */
+    memset(out, 0xAA, sizeof(out));
+    BLT_AesCbc_Encrypt(cipher, Sp800Iv, Sp800Plaintext, out, 0);
+    for (i=0; i<sizeof(out); i++) CHECK(out[i] == 0xAA);
+
+    BLT_AesCbc_Destroy(cipher);
+}
+
+/*----------------------------------------------------------------------
+|    main
++---------------------------------------------------------------------*/
+int
+main(int argc, char** argv)
+{
+    BLT_AesCbc* cipher = NULL;
+    BLT_Result  result;
+
+    BLT_COMPILER_UNUSED(argc);
+    BLT_COMPILER_UNUSED(argv);
+
+    /* without the instructions, the callers use their software cipher */
+    result = BLT_AesCbc_Create(Sp800Key, &cipher);
+    if (result == BLT_ERROR_NOT_SUPPORTED) {
+        CHECK(cipher == NULL);
+        printf("AesCbcTest skipped: no AES instructions\n");
+        return 0;
+    }
+    CHECK(BLT_SUCCEEDED(result));
+    BLT_AesCbc_Destroy(cipher);
+
+    TestVectors();
+    TestChaining();
+
+    printf("AesCbcTest passed\n");
+    return 0;
+}
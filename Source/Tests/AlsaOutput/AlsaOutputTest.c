@@ -0,0 +1,166 @@
+/*****************************************************************
+|
+|   BlueTune - ALSA Output Test
+|
+|   (c) 2002-2012 Gilles Boccon-Gibod
+|   Author: Gilles Boccon-Gibod (bok@bok.net)
+|
+****************************************************************/
+
+/*----------------------------------------------------------------------
+|    includes
++---------------------------------------------------------------------*/
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+
+#include "Atomix.h"
+#include "BltConfig.h"
+#include "BltErrors.h"
+#include "BltDecoder.h"
+#include "BltAlsaOutput.h"
+#include "TestUtils.h"
+
+/*----------------------------------------------------------------------
+|    constants
++---------------------------------------------------------------------*/
+#define TEST_FILENAME     "AlsaOutputTest.wav"
+#define TEST_DEVICE       "alsa:null" /* plays nothing, any format */
+#define TEST_SAMPLE_RATE  48000
+#define TEST_FRAME_COUNT  (2*TEST_SAMPLE_RATE)
+#define TEST_DURATION     2000   /* ms  */
+#define TEST_BUFFER_TIME  100000 /* us  */
+#define TEST_PERIOD_TIME  20000  /* us  */
+#define TEST_PAUSE_PUMPS  10     /* packets played before the pause */
+#define TEST_PI           3.14159265358979323846
+
+/*----------------------------------------------------------------------
+|    CHECK
++---------------------------------------------------------------------*/
+#define CHECK(x)                                        \
+do {                                                    \
+    if (!(x)) {                                         \
+        fprintf(stderr, "FAILED line %d\n", __LINE__);  \
+        abort();                                        \
+    }                                                   \
+} while(0)
+
+/*----------------------------------------------------------------------
+|    WriteTestFile: a 16 bit sine on all the channels
++---------------------------------------------------------------------*/
+static void
+WriteTestFile(unsigned int channel_count)
+{
+    BLT_Int16*   samples = (BLT_Int16*)malloc(TEST_FRAME_COUNT*2*channel_count);
+    unsigned int i;
+    unsigned int c;
+
+    CHECK(samples != NULL);
+    for (i=0; i<TEST_FRAME_COUNT; i++) {
+        BLT_Int16 sample = (BLT_Int16)(8192.0*sin(2.0*TEST_PI*440.0*(double)i/TEST_SAMPLE_RATE));
+        for (c=0; c<channel_count; c++) {
+            samples[i*channel_count+c] = sample;
+        }
+    }
+    CHECK(BLT_SUCCEEDED(TestUtils_WriteWavFile(TEST_FILENAME, samples, TEST_FRAME_COUNT,
+                                               channel_count, TEST_SAMPLE_RATE)));
+    free(samples);
+}
+
+/*----------------------------------------------------------------------
+|    SetIntegerProperty
++---------------------------------------------------------------------*/
+static void
+SetIntegerProperty(ATX_Properties* properties, const char* name, int integer)
+{
+    ATX_PropertyValue value;
+
+    value.type         = ATX_PROPERTY_VALUE_TYPE_INTEGER;
+    value.data.integer = integer;
+    CHECK(ATX_SUCCEEDED(ATX_Properties_SetProperty(properties, name, &value)));
+}
+
+/*----------------------------------------------------------------------
+|    Play
+|
+|    Plays the test file to the null device, pausing and resuming on the
+|    way, and checks that all of it goes through, with a media time that
+|    only moves forward and never goes past the end.
++---------------------------------------------------------------------*/
+static void
+Play(unsigned int channel_count, BLT_Boolean mmap)
+{
+    BLT_Decoder*      decoder    = NULL;
+    ATX_Properties*   properties = NULL;
+    BLT_DecoderStatus status;
+    ATX_UInt64        media_time = 0;
+    unsigned int      pumps      = 0;
+    BLT_Result        result;
+
+    WriteTestFile(channel_count);
+
+    CHECK(BLT_SUCCEEDED(BLT_Decoder_Create(&decoder)));
+    BLT_Decoder_RegisterBuiltins(decoder);
+#if !defined(BLT_CONFIG_MODULES_ENABLE_ALSA_OUTPUT)
+    {
+        BLT_Module* module = NULL;
+        CHECK(BLT_SUCCEEDED(BLT_AlsaOutputModule_GetModuleObject(&module)));
+        BLT_Decoder_RegisterModule(decoder, module);
+        ATX_RELEASE_OBJECT(module);
+    }
+#endif
+
+    /* the device settings are read when the output is activated */
+    CHECK(BLT_SUCCEEDED(BLT_Decoder_GetProperties(decoder, &properties)));
+    SetIntegerProperty(properties, BLT_ALSA_OUTPUT_MMAP,        mmap?1:0);
+    SetIntegerProperty(properties, BLT_ALSA_OUTPUT_BUFFER_TIME, TEST_BUFFER_TIME);
+    SetIntegerProperty(properties, BLT_ALSA_OUTPUT_PERIOD_TIME, TEST_PERIOD_TIME);
+
+    CHECK(BLT_SUCCEEDED(BLT_Decoder_SetOutput(decoder, TEST_DEVICE, "audio/pcm")));
+    CHECK(BLT_SUCCEEDED(BLT_Decoder_SetInput(decoder, TEST_FILENAME, NULL)));
+
+    for (;;) {
+        result = BLT_Decoder_PumpPacket(decoder);
+        if (BLT_FAILED(result)) break;
+
+        CHECK(BLT_SUCCEEDED(BLT_Decoder_GetStatus(decoder, &status)));
+        CHECK(BLT_TimeStamp_ToNanos(status.time_stamp) >= media_time);
+        media_time = BLT_TimeStamp_ToNanos(status.time_stamp);
+        CHECK(media_time <= (ATX_UInt64)TEST_DURATION*1000000);
+
+        /* the next pump resumes */
+        if (++pumps == TEST_PAUSE_PUMPS) {
+            CHECK(BLT_SUCCEEDED(BLT_Decoder_Pause(decoder)));
+            CHECK(BLT_SUCCEEDED(BLT_Decoder_GetStatus(decoder, &status)));
+            CHECK(BLT_TimeStamp_ToNanos(status.time_stamp) <= (ATX_UInt64)TEST_DURATION*1000000);
+        }
+    }
+    CHECK(result == BLT_ERROR_EOS);
+    CHECK(pumps > TEST_PAUSE_PUMPS);
+
+    /* destroying the decoder drains the device */
+    BLT_Decoder_Destroy(decoder);
+    remove(TEST_FILENAME);
+}
+
+/*----------------------------------------------------------------------
+|    main
++---------------------------------------------------------------------*/
+int
+main(int argc, char** argv)
+{
+    static const unsigned int layouts[] = { 1, 2, 6 };
+    unsigned int              l;
+
+    BLT_COMPILER_UNUSED(argc);
+    BLT_COMPILER_UNUSED(argv);
+
+    for (l=0; l<sizeof(layouts)/sizeof(layouts[0]); l++) {
+        Play(layouts[l], BLT_FALSE);
+        Play(layouts[l], BLT_TRUE);
+    }
+
+    printf("AlsaOutputTest passed\n");
+    return 0;
+}
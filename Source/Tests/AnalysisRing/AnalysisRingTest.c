@@ -0,0 +1,217 @@
+/*****************************************************************
+|
+|   BlueTune - Analysis Ring Test
+|
+|   (c) 2002-2012 Gilles Boccon-Gibod
+|   Author: Gilles Boccon-Gibod (bok@bok.net)
+|
+****************************************************************/
+
+/*----------------------------------------------------------------------
+|    includes
++---------------------------------------------------------------------*/
+#include <stdio.h>
+#include <stdlib.h>
+
+#include "Atomix.h"
+#include "BltConfig.h"
+#include "BltErrors.h"
+#include "BltAnalysisRing.h"
+
+/*----------------------------------------------------------------------
+|    constants
++---------------------------------------------------------------------*/
+#define TEST_RING_SIZE 4
+
+/*----------------------------------------------------------------------
+|    CHECK
++---------------------------------------------------------------------*/
+#define CHECK(x)                                        \
+do {                                                    \
+    if (!(x)) {                                         \
+        fprintf(stderr, "FAILED line %d\n", __LINE__);  \
+        abort();                                        \
+    }                                                   \
+} while(0)
+
+/*----------------------------------------------------------------------
+|    Fill: every level of the frame is set to the same value
++---------------------------------------------------------------------*/
+static void
+Fill(BLT_AnalysisFrame* frame, float value)
+{
+    unsigned int i;
+
+    for (i=0; i<BLT_ANALYSIS_MAX_CHANNELS; i++) {
+        frame->rms[i]  = value;
+        frame->peak[i] = value;
+    }
+}
+
+/*----------------------------------------------------------------------
+|    WriteFrames
++---------------------------------------------------------------------*/
+static void
+WriteFrames(BLT_AnalysisRing* ring, unsigned int count)
+{
+    while (count--) {
+        BLT_AnalysisFrame* frame = BLT_AnalysisRing_BeginWrite(ring);
+        Fill(frame, (float)frame->sequence);
+        BLT_AnalysisRing_EndWrite(ring);
+    }
+}
+
+/*----------------------------------------------------------------------
+|    CheckFrame: the frame is whole, all its levels match its sequence
++---------------------------------------------------------------------*/
+static void
+CheckFrame(const BLT_AnalysisFrame* frame, BLT_UInt32 sequence)
+{
+    unsigned int i;
+
+    CHECK(frame->sequence == sequence);
+    for (i=0; i<BLT_ANALYSIS_MAX_CHANNELS; i++) {
+        CHECK(frame->rms[i]  == (float)sequence);
+        CHECK(frame->peak[i] == (float)sequence);
+    }
+}
+
+/*----------------------------------------------------------------------
+|    TestReadInOrder
++---------------------------------------------------------------------*/
+static void
+TestReadInOrder(void)
+{
+    BLT_AnalysisRing* ring = NULL;
+    BLT_AnalysisFrame frame;
+    BLT_UInt32        cursor = 0;
+    BLT_UInt32        i;
+
+    CHECK(BLT_SUCCEEDED(BLT_AnalysisRing_Create(TEST_RING_SIZE, 0, &ring)));
+    CHECK(BLT_AnalysisRing_Read(ring, &cursor, &frame) == BLT_ERROR_WOULD_BLOCK);
+    CHECK(BLT_AnalysisRing_ReadLatest(ring, &frame) == BLT_ERROR_WOULD_BLOCK);
+
+    WriteFrames(ring, 3);
+    for (i=0; i<3; i++) {
+        CHECK(BLT_AnalysisRing_Read(ring, &cursor, &frame) == BLT_SUCCESS);
+        CheckFrame(&frame, i);
+    }
+    CHECK(cursor == 3);
+    CHECK(BLT_AnalysisRing_Read(ring, &cursor, &frame) == BLT_ERROR_WOULD_BLOCK);
+
+    CHECK(BLT_AnalysisRing_ReadLatest(ring, &frame) == BLT_SUCCESS);
+    CheckFrame(&frame, 2);
+
+    BLT_AnalysisRing_Destroy(ring);
+}
+
+/*----------------------------------------------------------------------
+|    TestOverwriteSkip
+|
+|    A reader that falls behind by more than the ring size gets the
+|    oldest frames still in the ring, and sees the gap in the sequence.
++---------------------------------------------------------------------*/
+static void
+TestOverwriteSkip(void)
+{
+    BLT_AnalysisRing* ring = NULL;
+    BLT_AnalysisFrame frame;
+    BLT_UInt32        cursor = 0;
+    BLT_UInt32        late   = 1;
+    BLT_UInt32        i;
+
+    CHECK(BLT_SUCCEEDED(BLT_AnalysisRing_Create(TEST_RING_SIZE, 0, &ring)));
+
+    WriteFrames(ring, 10);
+    for (i=10-TEST_RING_SIZE; i<10; i++) {
+        CHECK(BLT_AnalysisRing_Read(ring, &cursor, &frame) == BLT_SUCCESS);
+        CheckFrame(&frame, i);
+    }
+    CHECK(cursor == 10);
+    CHECK(BLT_AnalysisRing_Read(ring, &cursor, &frame) == BLT_ERROR_WOULD_BLOCK);
+
+    /* a second reader, with its own cursor, is not affected by the first */
+    WriteFrames(ring, 2);
+    CHECK(BLT_AnalysisRing_Read(ring, &late, &frame) == BLT_SUCCESS);
+    CheckFrame(&frame, 12-TEST_RING_SIZE);
+    CHECK(BLT_AnalysisRing_Read(ring, &cursor, &frame) == BLT_SUCCESS);
+    CheckFrame(&frame, 10);
+
+    BLT_AnalysisRing_Destroy(ring);
+}
+
+/*----------------------------------------------------------------------
+|    TestTornReadRejected
+|
+|    While the writer is filling a slot, readers must not copy it: the
+|    frame it held is gone, and the new one is not complete.
++---------------------------------------------------------------------*/
+static void
+TestTornReadRejected(void)
+{
+    BLT_AnalysisRing*  ring = NULL;
+    BLT_AnalysisFrame* writing;
+    BLT_AnalysisFrame  frame;
+    BLT_UInt32         cursor = 0;
+
+    CHECK(BLT_SUCCEEDED(BLT_AnalysisRing_Create(TEST_RING_SIZE, 0, &ring)));
+    WriteFrames(ring, TEST_RING_SIZE);
+
+    /* start overwriting the slot of frame 0, and only fill half of it */
+    writing = BLT_AnalysisRing_BeginWrite(ring);
+    CHECK(writing->sequence == TEST_RING_SIZE);
+    writing->rms[0] = -1.0f;
+
+    /* frame 0 is skipped rather than read half written */
+    Fill(&frame, 1000.0f);
+    CHECK(BLT_AnalysisRing_Read(ring, &cursor, &frame) == BLT_SUCCESS);
+    CheckFrame(&frame, 1);
+    CHECK(cursor == 2);
+
+    /* the frame being written is not available yet */
+    CHECK(BLT_AnalysisRing_ReadLatest(ring, &frame) == BLT_SUCCESS);
+    CheckFrame(&frame, TEST_RING_SIZE-1);
+
+    /* once published, it is */
+    Fill(writing, (float)TEST_RING_SIZE);
+    BLT_AnalysisRing_EndWrite(ring);
+    CHECK(BLT_AnalysisRing_Read(ring, &cursor, &frame) == BLT_SUCCESS);
+    CheckFrame(&frame, 2);
+    CHECK(BLT_AnalysisRing_Read(ring, &cursor, &frame) == BLT_SUCCESS);
+    CheckFrame(&frame, 3);
+    CHECK(BLT_AnalysisRing_Read(ring, &cursor, &frame) == BLT_SUCCESS);
+    CheckFrame(&frame, TEST_RING_SIZE);
+    CHECK(BLT_AnalysisRing_Read(ring, &cursor, &frame) == BLT_ERROR_WOULD_BLOCK);
+
+    /* a frame being written does not count as available */
+    writing = BLT_AnalysisRing_BeginWrite(ring);
+    Fill(writing, -1.0f);
+    cursor = TEST_RING_SIZE+1;
+    CHECK(BLT_AnalysisRing_Read(ring, &cursor, &frame) == BLT_ERROR_WOULD_BLOCK);
+    CHECK(cursor == TEST_RING_SIZE+1);
+    BLT_AnalysisRing_EndWrite(ring);
+
+    BLT_AnalysisRing_Destroy(ring);
+}
+
+/*----------------------------------------------------------------------
+|    main
++---------------------------------------------------------------------*/
+int
+main(int argc, char** argv)
+{
+    BLT_AnalysisRing* ring = NULL;
+
+    BLT_COMPILER_UNUSED(argc);
+    BLT_COMPILER_UNUSED(argv);
+
+    CHECK(BLT_AnalysisRing_Create(0, 0, &ring) == BLT_ERROR_INVALID_PARAMETERS);
+    CHECK(ring == NULL);
+
+    TestReadInOrder();
+    TestOverwriteSkip();
+    TestTornReadRejected();
+
+    printf("AnalysisRingTest passed\n");
+    return 0;
+}
@@ -0,0 +1,306 @@
+/*****************************************************************
+|
+|   BlueTune - Callback Output Test
+|
+|   (c) 2002-2012 Gilles Boccon-Gibod
+|   Author: Gilles Boccon-Gibod (bok@bok.net)
+|
+****************************************************************/
+
+/*----------------------------------------------------------------------
+|    includes
++---------------------------------------------------------------------*/
+#include <stdio.h>
+#include <stdlib.h>
+
+#include "Atomix.h"
+#include "BltConfig.h"
+#include "BltErrors.h"
+#include "BltDecoder.h"
+#include "BltMediaPacket.h"
+#include "BltPacketConsumer.h"
+#include "BltPcm.h"
+#include "BltCallbackOutput.h"
+#include "TestUtils.h"
+
+/*----------------------------------------------------------------------
+|    constants
++---------------------------------------------------------------------*/
+#define TEST_FILENAME      "CallbackOutputTest.wav"
+#define TEST_SAMPLE_RATE   44100
+#define TEST_CHANNEL_COUNT 2
+#define TEST_FRAME_COUNT   TEST_SAMPLE_RATE /* 1 second */
+#define TEST_MAX_LENT      4
+#define TEST_RETURN_EARLY  5 /* every 5th packet is returned before BorrowPacket returns */
+
+/*----------------------------------------------------------------------
+|    CHECK
++---------------------------------------------------------------------*/
+#define CHECK(x)                                        \
+do {                                                    \
+    if (!(x)) {                                         \
+        fprintf(stderr, "FAILED line %d\n", __LINE__);  \
+        abort();                                        \
+    }                                                   \
+} while(0)
+
+/*----------------------------------------------------------------------
+|    globals
++---------------------------------------------------------------------*/
+static BLT_Int16 TestSamples[TEST_FRAME_COUNT*TEST_CHANNEL_COUNT];
+
+/*----------------------------------------------------------------------
+|    TestBorrower
+|
+|    Borrows the packets and holds on to the last few, then checks,
+|    when it gives one back, that the payload is still what was lent.
++---------------------------------------------------------------------*/
+typedef struct {
+    /* interfaces */
+    ATX_IMPLEMENTS(BLT_PacketConsumer);
+    ATX_IMPLEMENTS(BLT_PacketBorrower);
+
+    /* members */
+    BLT_PacketLender* lender;
+    BLT_MediaPacket*  held[TEST_MAX_LENT];
+    unsigned int      held_frames[TEST_MAX_LENT]; /* where each one starts */
+    unsigned int      held_count;
+    unsigned int      max_held;
+    unsigned int      borrow_count;
+    unsigned int      put_count;
+    unsigned int      frame_count;
+} TestBorrower;
+
+/*----------------------------------------------------------------------
+|    TestBorrower_CheckPayload
++---------------------------------------------------------------------*/
+static void
+TestBorrower_CheckPayload(BLT_MediaPacket* packet, unsigned int first_frame)
+{
+    const BLT_Int16* samples = (const BLT_Int16*)BLT_MediaPacket_GetPayloadBuffer(packet);
+    unsigned int     count   = BLT_MediaPacket_GetPayloadSize(packet)/2;
+    unsigned int     i;
+
+    CHECK(first_frame*TEST_CHANNEL_COUNT+count <= TEST_FRAME_COUNT*TEST_CHANNEL_COUNT);
+    for (i=0; i<count; i++) {
+        CHECK(samples[i] == TestSamples[first_frame*TEST_CHANNEL_COUNT+i]);
+    }
+}
+
+/*----------------------------------------------------------------------
+|    TestBorrower_ReturnOldest
++---------------------------------------------------------------------*/
+static void
+TestBorrower_ReturnOldest(TestBorrower* self)
+{
+    unsigned int i;
+
+    CHECK(self->held_count);
+    TestBorrower_CheckPayload(self->held[0], self->held_frames[0]);
+    CHECK(BLT_SUCCEEDED(BLT_PacketLender_ReturnPacket(self->lender, self->held[0])));
+    for (i=1; i<self->held_count; i++) {
+        self->held[i-1]        = self->held[i];
+        self->held_frames[i-1] = self->held_frames[i];
+    }
+    --self->held_count;
+}
+
+/*----------------------------------------------------------------------
+|    TestBorrower_PutPacket
++---------------------------------------------------------------------*/
+BLT_METHOD
+TestBorrower_PutPacket(BLT_PacketConsumer* _self, BLT_MediaPacket* packet)
+{
+    TestBorrower* self = ATX_SELF(TestBorrower, BLT_PacketConsumer);
+
+    /* a borrower is always lent the packets */
+    BLT_COMPILER_UNUSED(packet);
+    ++self->put_count;
+
+    return BLT_ERROR_NOT_SUPPORTED;
+}
+
+/*----------------------------------------------------------------------
+|    TestBorrower_BorrowPacket
++---------------------------------------------------------------------*/
+BLT_METHOD
+TestBorrower_BorrowPacket(BLT_PacketBorrower* _self,
+                          BLT_MediaPacket*    packet,
+                          BLT_PacketLender*   lender)
+{
+    TestBorrower*           self = ATX_SELF(TestBorrower, BLT_PacketBorrower);
+    const BLT_PcmMediaType* media_type;
+    unsigned int            frames;
+
+    BLT_MediaPacket_GetMediaType(packet, (const BLT_MediaType**)(const void*)&media_type);
+    CHECK(media_type->base.id        == BLT_MEDIA_TYPE_ID_AUDIO_PCM);
+    CHECK(media_type->channel_count   == TEST_CHANNEL_COUNT);
+    CHECK(media_type->bits_per_sample == 16);
+
+    /* the same lender for all the packets of a node */
+    if (self->lender == NULL) self->lender = lender;
+    CHECK(lender == self->lender);
+
+    frames = BLT_MediaPacket_GetPayloadSize(packet)/(2*TEST_CHANNEL_COUNT);
+    TestBorrower_CheckPayload(packet, self->frame_count);
+
+    if ((++self->borrow_count)%TEST_RETURN_EARLY == 0) {
+        /* given back right away, and only once */
+        CHECK(BLT_SUCCEEDED(BLT_PacketLender_ReturnPacket(lender, packet)));
+        CHECK(BLT_PacketLender_ReturnPacket(lender, packet) == BLT_ERROR_INVALID_PARAMETERS);
+    } else {
+        if (self->held_count == self->max_held) TestBorrower_ReturnOldest(self);
+        self->held[self->held_count]        = packet;
+        self->held_frames[self->held_count] = self->frame_count;
+        ++self->held_count;
+    }
+    self->frame_count += frames;
+
+    return BLT_SUCCESS;
+}
+
+/*----------------------------------------------------------------------
+|    GetInterface implementation
++---------------------------------------------------------------------*/
+ATX_BEGIN_GET_INTERFACE_IMPLEMENTATION(TestBorrower)
+    ATX_GET_INTERFACE_ACCEPT(TestBorrower, BLT_PacketConsumer)
+    ATX_GET_INTERFACE_ACCEPT(TestBorrower, BLT_PacketBorrower)
+ATX_END_GET_INTERFACE_IMPLEMENTATION
+
+ATX_BEGIN_INTERFACE_MAP(TestBorrower, BLT_PacketConsumer)
+    TestBorrower_PutPacket
+ATX_END_INTERFACE_MAP
+
+ATX_BEGIN_INTERFACE_MAP(TestBorrower, BLT_PacketBorrower)
+    TestBorrower_BorrowPacket
+ATX_END_INTERFACE_MAP
+
+/*----------------------------------------------------------------------
+|    TestBorrower_Construct
++---------------------------------------------------------------------*/
+static void
+TestBorrower_Construct(TestBorrower* self, unsigned int max_held)
+{
+    ATX_SetMemory(self, 0, sizeof(*self));
+    self->max_held = max_held;
+    ATX_SET_INTERFACE(self, TestBorrower, BLT_PacketConsumer);
+    ATX_SET_INTERFACE(self, TestBorrower, BLT_PacketBorrower);
+}
+
+/*----------------------------------------------------------------------
+|    PlayToBorrower
+|
+|    Plays the test file to a borrower that holds on to up to
+|    'max_held' packets at a time.
++---------------------------------------------------------------------*/
+static void
+PlayToBorrower(BLT_Decoder* decoder, TestBorrower* borrower, unsigned int max_held)
+{
+    char output_name[64];
+
+    TestBorrower_Construct(borrower, max_held);
+    sprintf(output_name, "callback-output:%lu", (unsigned long)(size_t)&ATX_BASE(borrower, BLT_PacketConsumer));
+    CHECK(BLT_SUCCEEDED(BLT_Decoder_SetOutput(decoder, output_name, "audio/pcm")));
+    CHECK(BLT_SUCCEEDED(BLT_Decoder_SetInput(decoder, TEST_FILENAME, NULL)));
+    CHECK(TestUtils_PumpToEnd(decoder) == BLT_ERROR_EOS);
+
+    CHECK(borrower->frame_count  == TEST_FRAME_COUNT);
+    CHECK(borrower->borrow_count >  2*TEST_RETURN_EARLY);
+    CHECK(borrower->put_count    == 0);
+    CHECK(borrower->held_count   == max_held);
+}
+
+/*----------------------------------------------------------------------
+|    KeepBuffer
++---------------------------------------------------------------------*/
+static void
+KeepBuffer(BLT_Any instance, BLT_Any buffer)
+{
+    BLT_COMPILER_UNUSED(instance);
+    BLT_COMPILER_UNUSED(buffer);
+}
+
+/*----------------------------------------------------------------------
+|    TestLendAndReturn
+|
+|    The packets stay valid while they are held, and a packet that
+|    isn't lent can't be returned. Once they are all back, draining
+|    doesn't wait.
++---------------------------------------------------------------------*/
+static void
+TestLendAndReturn(BLT_Decoder* decoder)
+{
+    TestBorrower                    borrower;
+    BLT_MediaPacket*                stranger = NULL;
+    BLT_Int16                       sample = 0;
+    BLT_MediaPacketBufferDestructor destructor = { NULL, KeepBuffer };
+
+    /* the node lends one more than this, so it never has to wait */
+    PlayToBorrower(decoder, &borrower, TEST_MAX_LENT-1);
+
+    CHECK(BLT_SUCCEEDED(BLT_MediaPacket_CreateWithBuffer(&sample, sizeof(sample), NULL, &destructor, &stranger)));
+    CHECK(BLT_PacketLender_ReturnPacket(borrower.lender, stranger) == BLT_ERROR_INVALID_PARAMETERS);
+    BLT_MediaPacket_Release(stranger);
+
+    while (borrower.held_count) TestBorrower_ReturnOldest(&borrower);
+    CHECK(BLT_SUCCEEDED(BLT_Decoder_Drain(decoder)));
+
+    CHECK(BLT_SUCCEEDED(BLT_Decoder_SetOutput(decoder, "null", "audio/pcm")));
+}
+
+/*----------------------------------------------------------------------
+|    TestLateReturn
+|
+|    Packets still held when the node is destroyed can be returned
+|    afterwards: destroying the node waits for them for
+|    BLT_CALLBACK_OUTPUT_RETURN_TIMEOUT, then leaves the lender behind,
+|    and the packets stay valid until they are returned.
++---------------------------------------------------------------------*/
+static void
+TestLateReturn(BLT_Decoder* decoder)
+{
+    TestBorrower borrower;
+
+    PlayToBorrower(decoder, &borrower, TEST_MAX_LENT-1);
+
+    CHECK(BLT_SUCCEEDED(BLT_Decoder_SetOutput(decoder, "null", "audio/pcm")));
+    while (borrower.held_count) TestBorrower_ReturnOldest(&borrower);
+}
+
+/*----------------------------------------------------------------------
+|    main
++---------------------------------------------------------------------*/
+int
+main(int argc, char** argv)
+{
+    BLT_Decoder*      decoder = NULL;
+    ATX_Properties*   properties = NULL;
+    ATX_PropertyValue value;
+    unsigned int      seed = 1;
+    unsigned int      i;
+
+    BLT_COMPILER_UNUSED(argc);
+    BLT_COMPILER_UNUSED(argv);
+
+    for (i=0; i<TEST_FRAME_COUNT*TEST_CHANNEL_COUNT; i++) {
+        TestSamples[i] = (BLT_Int16)TestUtils_Random(&seed);
+    }
+    CHECK(BLT_SUCCEEDED(TestUtils_WriteWavFile(TEST_FILENAME, TestSamples, TEST_FRAME_COUNT,
+                                               TEST_CHANNEL_COUNT, TEST_SAMPLE_RATE)));
+
+    CHECK(BLT_SUCCEEDED(BLT_Decoder_Create(&decoder)));
+    BLT_Decoder_RegisterBuiltins(decoder);
+    CHECK(BLT_SUCCEEDED(BLT_Decoder_GetProperties(decoder, &properties)));
+    value.type         = ATX_PROPERTY_VALUE_TYPE_INTEGER;
+    value.data.integer = TEST_MAX_LENT;
+    CHECK(ATX_SUCCEEDED(ATX_Properties_SetProperty(properties, BLT_CALLBACK_OUTPUT_MAX_LENT_PACKETS, &value)));
+
+    TestLendAndReturn(decoder);
+    TestLateReturn(decoder);
+
+    BLT_Decoder_Destroy(decoder);
+    remove(TEST_FILENAME);
+
+    printf("CallbackOutputTest passed\n");
+    return 0;
+}
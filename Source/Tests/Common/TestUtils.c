@@ -0,0 +1,178 @@
+/*****************************************************************
+|
+|   BlueTune - Test Utilities
+|
+|   (c) 2002-2012 Gilles Boccon-Gibod
+|   Author: Gilles Boccon-Gibod (bok@bok.net)
+|
+****************************************************************/
+
+/*----------------------------------------------------------------------
+|    includes
++---------------------------------------------------------------------*/
+#include <stdio.h>
+
+#include "Atomix.h"
+#include "BltConfig.h"
+#include "BltErrors.h"
+#include "BltDecoder.h"
+#include "BltMediaPacket.h"
+#include "BltPacketConsumer.h"
+#include "BltPcm.h"
+#include "TestUtils.h"
+
+/*----------------------------------------------------------------------
+|    TestUtils_Random
++---------------------------------------------------------------------*/
+unsigned int
+TestUtils_Random(unsigned int* seed)
+{
+    *seed = *seed*1103515245+12345;
+    return *seed>>8;
+}
+
+/*----------------------------------------------------------------------
+|    WriteLE
++---------------------------------------------------------------------*/
+static void
+WriteLE(FILE* file, unsigned long value, unsigned int size)
+{
+    while (size--) {
+        fputc((int)(value&0xFF), file);
+        value >>= 8;
+    }
+}
+
+/*----------------------------------------------------------------------
+|    TestUtils_WriteWavFile
++---------------------------------------------------------------------*/
+BLT_Result
+TestUtils_WriteWavFile(const char*      filename,
+                       const BLT_Int16* samples,
+                       unsigned int     frame_count,
+                       unsigned int     channel_count,
+                       unsigned int     sample_rate)
+{
+    FILE*        file = fopen(filename, "wb");
+    unsigned int data_size = frame_count*2*channel_count;
+    unsigned int i;
+
+    if (file == NULL) return BLT_ERROR_OPEN_FAILED;
+    fwrite("RIFF", 1, 4, file);
+    WriteLE(file, 36+data_size, 4);
+    fwrite("WAVEfmt ", 1, 8, file);
+    WriteLE(file, 16, 4);
+    WriteLE(file, 1, 2);                                /* PCM         */
+    WriteLE(file, channel_count, 2);
+    WriteLE(file, sample_rate, 4);
+    WriteLE(file, sample_rate*2*channel_count, 4);      /* byte rate   */
+    WriteLE(file, 2*channel_count, 2);                  /* block align */
+    WriteLE(file, 16, 2);
+    fwrite("data", 1, 4, file);
+    WriteLE(file, data_size, 4);
+    for (i=0; i<frame_count*channel_count; i++) {
+        WriteLE(file, (unsigned long)(samples[i]&0xFFFF), 2);
+    }
+    if (fclose(file)) return BLT_FAILURE;
+
+    return BLT_SUCCESS;
+}
+
+/*----------------------------------------------------------------------
+|    TestUtils_PumpToEnd
++---------------------------------------------------------------------*/
+BLT_Result
+TestUtils_PumpToEnd(BLT_Decoder* decoder)
+{
+    BLT_Result result;
+
+    do {
+        result = BLT_Decoder_PumpPacket(decoder);
+    } while (BLT_SUCCEEDED(result) || result == BLT_ERROR_WOULD_BLOCK);
+
+    return result;
+}
+
+/*----------------------------------------------------------------------
+|    TestCollector_PutPacket
++---------------------------------------------------------------------*/
+BLT_METHOD
+TestCollector_PutPacket(BLT_PacketConsumer* _self, BLT_MediaPacket* packet)
+{
+    TestCollector*          self = ATX_SELF(TestCollector, BLT_PacketConsumer);
+    const BLT_PcmMediaType* media_type;
+    unsigned int            frames;
+
+    BLT_MediaPacket_GetMediaType(packet, (const BLT_MediaType**)(const void*)&media_type);
+    if (media_type->base.id        != BLT_MEDIA_TYPE_ID_AUDIO_PCM ||
+        media_type->channel_count   != self->channel_count        ||
+        media_type->bits_per_sample != 16) {
+        return BLT_ERROR_INVALID_MEDIA_TYPE;
+    }
+
+    frames = BLT_MediaPacket_GetPayloadSize(packet)/(2*self->channel_count);
+    if (self->frame_count+frames > self->max_frame_count) return BLT_ERROR_OUT_OF_RANGE;
+    ATX_CopyMemory(self->samples+self->frame_count*self->channel_count,
+                   BLT_MediaPacket_GetPayloadBuffer(packet),
+                   frames*2*self->channel_count);
+    self->frame_count += frames;
+
+    return BLT_SUCCESS;
+}
+
+/*----------------------------------------------------------------------
+|    GetInterface implementation
++---------------------------------------------------------------------*/
+ATX_BEGIN_GET_INTERFACE_IMPLEMENTATION(TestCollector)
+    ATX_GET_INTERFACE_ACCEPT(TestCollector, BLT_PacketConsumer)
+ATX_END_GET_INTERFACE_IMPLEMENTATION
+
+/*----------------------------------------------------------------------
+|    BLT_PacketConsumer interface
++---------------------------------------------------------------------*/
+ATX_BEGIN_INTERFACE_MAP(TestCollector, BLT_PacketConsumer)
+    TestCollector_PutPacket
+ATX_END_INTERFACE_MAP
+
+/*----------------------------------------------------------------------
+|    TestCollector_Construct
++---------------------------------------------------------------------*/
+BLT_Result
+TestCollector_Construct(TestCollector* self,
+                        unsigned int   channel_count,
+                        unsigned int   max_frame_count)
+{
+    ATX_SetMemory(self, 0, sizeof(*self));
+    self->samples = (BLT_Int16*)ATX_AllocateMemory(max_frame_count*2*channel_count);
+    if (self->samples == NULL) return BLT_ERROR_OUT_OF_MEMORY;
+    self->channel_count   = channel_count;
+    self->max_frame_count = max_frame_count;
+
+    ATX_SET_INTERFACE(self, TestCollector, BLT_PacketConsumer);
+
+    return BLT_SUCCESS;
+}
+
+/*----------------------------------------------------------------------
+|    TestCollector_Destruct
++---------------------------------------------------------------------*/
+void
+TestCollector_Destruct(TestCollector* self)
+{
+    ATX_FreeMemory(self->samples);
+    self->samples = NULL;
+}
+
+/*----------------------------------------------------------------------
+|    TestCollector_SetAsOutput
++---------------------------------------------------------------------*/
+BLT_Result
+TestCollector_SetAsOutput(TestCollector* self, BLT_Decoder* decoder)
+{
+    char output_name[64];
+
+    self->frame_count = 0;
+    sprintf(output_name, "callback-output:%lu", (unsigned long)(size_t)&ATX_BASE(self, BLT_PacketConsumer));
+
+    return BLT_Decoder_SetOutput(decoder, output_name, "audio/pcm");
+}
@@ -0,0 +1,83 @@
+/*****************************************************************
+|
+|   BlueTune - Test Utilities
+|
+|   (c) 2002-2012 Gilles Boccon-Gibod
+|   Author: Gilles Boccon-Gibod (bok@bok.net)
+|
+****************************************************************/
+
+#ifndef _TEST_UTILS_H_
+#define _TEST_UTILS_H_
+
+/*----------------------------------------------------------------------
+|    includes
++---------------------------------------------------------------------*/
+#include "Atomix.h"
+#include "BltTypes.h"
+#include "BltDecoder.h"
+#include "BltPacketConsumer.h"
+
+/*----------------------------------------------------------------------
+|    types
++---------------------------------------------------------------------*/
+/**
+ * Stands in for the audio output of a decoder: keeps all the 16 bit
+ * PCM it gets, up to a number of frames, and refuses anything else.
+ */
+typedef struct {
+    /* interfaces */
+    ATX_IMPLEMENTS(BLT_PacketConsumer);
+
+    /* members */
+    unsigned int channel_count;
+    unsigned int max_frame_count;
+    BLT_Int16*   samples;
+    unsigned int frame_count;
+} TestCollector;
+
+/*----------------------------------------------------------------------
+|    prototypes
++---------------------------------------------------------------------*/
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/**
+ * Next value of a linear congruential generator, 24 bits of it.
+ * The tests only need a sequence that is the same on every platform.
+ */
+unsigned int TestUtils_Random(unsigned int* seed);
+
+/**
+ * Write a 16 bit PCM WAV file with interleaved samples.
+ */
+BLT_Result TestUtils_WriteWavFile(const char*      filename,
+                                  const BLT_Int16* samples,
+                                  unsigned int     frame_count,
+                                  unsigned int     channel_count,
+                                  unsigned int     sample_rate);
+
+/**
+ * Pump packets until the decoder fails, and return the result of the
+ * last pump: BLT_ERROR_EOS when the whole input went through.
+ * BLT_ERROR_WOULD_BLOCK does not stop the decoder.
+ */
+BLT_Result TestUtils_PumpToEnd(BLT_Decoder* decoder);
+
+BLT_Result TestCollector_Construct(TestCollector* self,
+                                   unsigned int   channel_count,
+                                   unsigned int   max_frame_count);
+void       TestCollector_Destruct(TestCollector* self);
+
+/**
+ * Make the collector the output of a decoder, through the callback
+ * output, and empty it.
+ */
+BLT_Result TestCollector_SetAsOutput(TestCollector* self, BLT_Decoder* decoder);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* _TEST_UTILS_H_ */
@@ -0,0 +1,356 @@
+/*****************************************************************
+|
+|   BlueTune - Cross Fade Test
+|
+|   (c) 2002-2012 Gilles Boccon-Gibod
+|   Author: Gilles Boccon-Gibod (bok@bok.net)
+|
+****************************************************************/
+
+/*----------------------------------------------------------------------
+|    includes
++---------------------------------------------------------------------*/
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+
+#include "Atomix.h"
+#include "BltConfig.h"
+#include "BltErrors.h"
+#include "BltDecoder.h"
+#include "BltMediaPacket.h"
+#include "BltPacketProducer.h"
+#include "BltPcm.h"
+#include "BltCrossFade.h"
+#include "BltCrossFader.h"
+#include "TestUtils.h"
+
+/*----------------------------------------------------------------------
+|    constants
++---------------------------------------------------------------------*/
+#define TEST_FILENAME      "CrossFadeTest.wav"
+#define TEST_SAMPLE_RATE   44100
+#define TEST_CHANNEL_COUNT 2
+#define TEST_DURATION      1000 /* ms, the length of the fade */
+#define TEST_FADE_FRAMES   TEST_SAMPLE_RATE
+#define TEST_TOLERANCE     2    /* 16 bit steps */
+
+/* the first track is a constant level, the next one starts with some */
+/* silence, then has a higher level                                  */
+#define TEST_LEVEL_A       8000
+#define TEST_LEVEL_B       12000
+#define TEST_FRAMES_A      (2*TEST_SAMPLE_RATE)
+#define TEST_SILENCE_B     (TEST_SAMPLE_RATE/10)
+#define TEST_FRAMES_B      (3*TEST_SAMPLE_RATE/2)
+#define TEST_PACKET_FRAMES 1000
+#define TEST_OUTPUT_FRAMES (TEST_FRAMES_A+TEST_FRAMES_B-TEST_SILENCE_B-TEST_FADE_FRAMES)
+
+/*----------------------------------------------------------------------
+|    CHECK
++---------------------------------------------------------------------*/
+#define CHECK(x)                                        \
+do {                                                    \
+    if (!(x)) {                                         \
+        fprintf(stderr, "FAILED line %d\n", __LINE__);  \
+        abort();                                        \
+    }                                                   \
+} while(0)
+
+/*----------------------------------------------------------------------
+|    types
++---------------------------------------------------------------------*/
+/* stands in for the decoder of the next track */
+typedef struct {
+    /* interfaces */
+    ATX_IMPLEMENTS(BLT_PacketProducer);
+
+    /* members */
+    unsigned int frame_count;
+    unsigned int calls;
+} NextTrack;
+
+/*----------------------------------------------------------------------
+|    NextTrack_FreeBuffer
++---------------------------------------------------------------------*/
+static void
+NextTrack_FreeBuffer(BLT_Any instance, BLT_Any buffer)
+{
+    BLT_COMPILER_UNUSED(instance);
+    free(buffer);
+}
+
+/*----------------------------------------------------------------------
+|    NextTrack_GetPacket
+|
+|    Every other call has nothing ready, the way a decoder that waits
+|    for its input would.
++---------------------------------------------------------------------*/
+BLT_METHOD
+NextTrack_GetPacket(BLT_PacketProducer* _self, BLT_MediaPacket** packet)
+{
+    NextTrack*                      self = ATX_SELF(NextTrack, BLT_PacketProducer);
+    BLT_PcmMediaType                media_type;
+    BLT_MediaPacketBufferDestructor destructor = { NULL, NextTrack_FreeBuffer };
+    BLT_Int16*                      samples;
+    unsigned int                    frames;
+    unsigned int                    i;
+
+    *packet = NULL;
+    if (self->frame_count == TEST_FRAMES_B) return BLT_ERROR_EOS;
+    if (self->calls++ & 1) return BLT_ERROR_WOULD_BLOCK;
+
+    frames = TEST_FRAMES_B-self->frame_count;
+    if (frames > TEST_PACKET_FRAMES) frames = TEST_PACKET_FRAMES;
+    samples = (BLT_Int16*)malloc(frames*2*TEST_CHANNEL_COUNT);
+    for (i=0; i<frames*TEST_CHANNEL_COUNT; i++) {
+        samples[i] = self->frame_count+i/TEST_CHANNEL_COUNT < TEST_SILENCE_B ? 0 : TEST_LEVEL_B;
+    }
+    self->frame_count += frames;
+
+    BLT_PcmMediaType_Init(&media_type);
+    media_type.sample_rate     = TEST_SAMPLE_RATE;
+    media_type.channel_count   = TEST_CHANNEL_COUNT;
+    media_type.bits_per_sample = 16;
+    media_type.sample_format   = BLT_PCM_SAMPLE_FORMAT_SIGNED_INT_NE;
+    CHECK(BLT_SUCCEEDED(BLT_MediaPacket_CreateWithBuffer(samples,
+                                                         frames*2*TEST_CHANNEL_COUNT,
+                                                         (const BLT_MediaType*)&media_type,
+                                                         &destructor,
+                                                         packet)));
+    if (self->frame_count == TEST_FRAMES_B) {
+        BLT_MediaPacket_SetFlags(*packet, BLT_MEDIA_PACKET_FLAG_END_OF_STREAM);
+    }
+
+    return BLT_SUCCESS;
+}
+
+/*----------------------------------------------------------------------
+|    GetInterface implementation
++---------------------------------------------------------------------*/
+ATX_BEGIN_GET_INTERFACE_IMPLEMENTATION(NextTrack)
+    ATX_GET_INTERFACE_ACCEPT(NextTrack, BLT_PacketProducer)
+ATX_END_GET_INTERFACE_IMPLEMENTATION
+
+/*----------------------------------------------------------------------
+|    BLT_PacketProducer interface
++---------------------------------------------------------------------*/
+ATX_BEGIN_INTERFACE_MAP(NextTrack, BLT_PacketProducer)
+    NextTrack_GetPacket
+ATX_END_INTERFACE_MAP
+
+/*----------------------------------------------------------------------
+|    WriteTestFile
++---------------------------------------------------------------------*/
+static void
+WriteTestFile(void)
+{
+    BLT_Int16*   samples = (BLT_Int16*)malloc(TEST_FRAMES_A*2*TEST_CHANNEL_COUNT);
+    unsigned int i;
+
+    CHECK(samples != NULL);
+    for (i=0; i<TEST_FRAMES_A*TEST_CHANNEL_COUNT; i++) {
+        samples[i] = TEST_LEVEL_A;
+    }
+    CHECK(BLT_SUCCEEDED(TestUtils_WriteWavFile(TEST_FILENAME, samples, TEST_FRAMES_A,
+                                               TEST_CHANNEL_COUNT, TEST_SAMPLE_RATE)));
+    free(samples);
+}
+
+/*----------------------------------------------------------------------
+|    TestCurves
+|
+|    The gains rise from 0 to 1, and the two tracks together keep the
+|    same power, or the same gain for the linear curve.
++---------------------------------------------------------------------*/
+static void
+TestCurves(void)
+{
+    static const BLT_CrossFadeCurve curves[] = {
+        BLT_CROSS_FADE_CURVE_EQUAL_POWER,
+        BLT_CROSS_FADE_CURVE_SQUARE_ROOT,
+        BLT_CROSS_FADE_CURVE_LINEAR
+    };
+    static const unsigned int lengths[] = { 1, 2, 7, 1000, TEST_FADE_FRAMES };
+    float*       gains = (float*)malloc(TEST_FADE_FRAMES*sizeof(float));
+    unsigned int c;
+    unsigned int l;
+    unsigned int i;
+
+    for (c=0; c<sizeof(curves)/sizeof(curves[0]); c++) {
+        for (l=0; l<sizeof(lengths)/sizeof(lengths[0]); l++) {
+            unsigned int n = lengths[l];
+            BLT_CrossFade_ComputeGains(curves[c], gains, n);
+            for (i=0; i<n; i++) {
+                double g_in  = gains[i];
+                double g_out = gains[n-1-i];
+                CHECK(g_in > 0.0 && g_in <= 1.0);
+                if (i) CHECK(gains[i] >= gains[i-1]);
+                if (curves[c] == BLT_CROSS_FADE_CURVE_LINEAR) {
+                    CHECK(fabs(g_in+g_out-1.0) < 1e-6);
+                } else {
+                    CHECK(fabs(g_in*g_in+g_out*g_out-1.0) < 1e-5);
+                }
+            }
+        }
+    }
+
+    free(gains);
+}
+
+/*----------------------------------------------------------------------
+|    TestMix
+|
+|    Each sample is the sum of the two tracks, with gains that go in
+|    opposite directions, whatever the layout and the length.
++---------------------------------------------------------------------*/
+static void
+TestMix(void)
+{
+    static const unsigned int lengths[] = { 1, 2, 3, 5, 17, 1001 };
+    unsigned int size = 1001*BLT_CROSS_FADE_MAX_CHANNELS;
+    float*       out  = (float*)malloc(size*sizeof(float));
+    float*       in   = (float*)malloc(size*sizeof(float));
+    float*       gains = (float*)malloc(1001*sizeof(float));
+    unsigned int channel_count;
+    unsigned int l;
+    unsigned int i;
+
+    for (channel_count=1; channel_count<=BLT_CROSS_FADE_MAX_CHANNELS; channel_count++) {
+        for (l=0; l<sizeof(lengths)/sizeof(lengths[0]); l++) {
+            unsigned int n = lengths[l];
+            BLT_CrossFade_ComputeGains(BLT_CROSS_FADE_CURVE_EQUAL_POWER, gains, n);
+            for (i=0; i<n*channel_count; i++) {
+                out[i] = (float)((i*7)%13)/13.0f-0.5f;
+                in[i]  = (float)((i*5)%11)/11.0f-0.5f;
+            }
+            BLT_CrossFade_Mix(out, in, gains, n, channel_count);
+            for (i=0; i<n*channel_count; i++) {
+                unsigned int frame    = i/channel_count;
+                double       expected = ((double)((i*7)%13)/13.0-0.5)*gains[n-1-frame]+
+                                        ((double)((i*5)%11)/11.0-0.5)*gains[frame];
+                CHECK(fabs(out[i]-expected) < 1e-6);
+            }
+        }
+    }
+
+    free(gains);
+    free(in);
+    free(out);
+}
+
+/*----------------------------------------------------------------------
+|    TestSilence
++---------------------------------------------------------------------*/
+static void
+TestSilence(void)
+{
+    float        samples[100*3];
+    unsigned int i;
+
+    /* a single channel over the threshold is enough */
+    for (i=0; i<100*3; i++) samples[i] = (i&1) ? 0.0005f : -0.0005f;
+    CHECK(BLT_CrossFade_GetLeadingSilence(samples, 100, 3, 0.001f)  == 100);
+    CHECK(BLT_CrossFade_GetTrailingSilence(samples, 100, 3, 0.001f) == 100);
+    samples[10*3+2] = -0.5f;
+    samples[89*3+1] = 0.001f;
+    CHECK(BLT_CrossFade_GetLeadingSilence(samples, 100, 3, 0.001f)  == 10);
+    CHECK(BLT_CrossFade_GetTrailingSilence(samples, 100, 3, 0.001f) == 10);
+    CHECK(BLT_CrossFade_GetLeadingSilence(samples, 0, 3, 0.001f)    == 0);
+}
+
+/*----------------------------------------------------------------------
+|    TestTransition
+|
+|    Plays a track through the cross fader, with a next track, and
+|    checks that the end of one is mixed with the start of the other,
+|    without the silence at the start of the next track.
++---------------------------------------------------------------------*/
+static void
+TestTransition(void)
+{
+    BLT_Decoder*      decoder = NULL;
+    ATX_Properties*   properties = NULL;
+    ATX_PropertyValue value;
+    TestCollector     collector;
+    NextTrack         next;
+    unsigned int      i;
+
+    WriteTestFile();
+
+    CHECK(BLT_SUCCEEDED(TestCollector_Construct(&collector, TEST_CHANNEL_COUNT, TEST_OUTPUT_FRAMES)));
+    memset(&next, 0, sizeof(next));
+    ATX_SET_INTERFACE(&next, NextTrack, BLT_PacketProducer);
+
+    CHECK(BLT_SUCCEEDED(BLT_Decoder_Create(&decoder)));
+    BLT_Decoder_RegisterBuiltins(decoder);
+#if !defined(BLT_CONFIG_MODULES_ENABLE_CROSS_FADER)
+    {
+        BLT_Module* module = NULL;
+        CHECK(BLT_SUCCEEDED(BLT_CrossFaderModule_GetModuleObject(&module)));
+        BLT_Decoder_RegisterModule(decoder, module);
+        ATX_RELEASE_OBJECT(module);
+    }
+#endif
+
+    /* the settings and the next track are core properties, read when */
+    /* the node is activated                                          */
+    CHECK(BLT_SUCCEEDED(BLT_Decoder_GetProperties(decoder, &properties)));
+    value.type         = ATX_PROPERTY_VALUE_TYPE_INTEGER;
+    value.data.integer = TEST_DURATION;
+    ATX_Properties_SetProperty(properties, BLT_CROSS_FADER_DURATION, &value);
+    value.data.integer = BLT_CROSS_FADE_CURVE_LINEAR;
+    ATX_Properties_SetProperty(properties, BLT_CROSS_FADER_CURVE, &value);
+    value.type         = ATX_PROPERTY_VALUE_TYPE_POINTER;
+    value.data.pointer = &ATX_BASE(&next, BLT_PacketProducer);
+    ATX_Properties_SetProperty(properties, BLT_CROSS_FADER_NEXT_SOURCE, &value);
+
+    CHECK(BLT_SUCCEEDED(TestCollector_SetAsOutput(&collector, decoder)));
+    CHECK(BLT_SUCCEEDED(BLT_Decoder_SetInput(decoder, TEST_FILENAME, NULL)));
+    CHECK(BLT_SUCCEEDED(BLT_Decoder_AddNodeByName(decoder, NULL, BLT_CROSS_FADER_MODULE_NAME)));
+
+    /* when the next track has nothing ready, the fade waits for it */
+    CHECK(TestUtils_PumpToEnd(decoder) == BLT_ERROR_EOS);
+    BLT_Decoder_Destroy(decoder);
+    remove(TEST_FILENAME);
+
+    /* the whole next track was played, and the tracks overlap by the */
+    /* length of the fade                                             */
+    CHECK(next.frame_count == TEST_FRAMES_B);
+    CHECK(collector.frame_count == TEST_OUTPUT_FRAMES);
+    for (i=0; i<TEST_FRAMES_A-TEST_FADE_FRAMES; i++) {
+        CHECK(collector.samples[i*TEST_CHANNEL_COUNT]   == TEST_LEVEL_A);
+        CHECK(collector.samples[i*TEST_CHANNEL_COUNT+1] == TEST_LEVEL_A);
+    }
+    for (i=0; i<TEST_FADE_FRAMES; i++) {
+        double       position = ((double)i+0.5)/TEST_FADE_FRAMES;
+        double       expected = TEST_LEVEL_A*(1.0-position)+TEST_LEVEL_B*position;
+        unsigned int frame    = TEST_FRAMES_A-TEST_FADE_FRAMES+i;
+        CHECK(fabs(collector.samples[frame*TEST_CHANNEL_COUNT]  -expected) <= TEST_TOLERANCE);
+        CHECK(fabs(collector.samples[frame*TEST_CHANNEL_COUNT+1]-expected) <= TEST_TOLERANCE);
+    }
+    for (i=TEST_FRAMES_A; i<TEST_OUTPUT_FRAMES; i++) {
+        CHECK(collector.samples[i*TEST_CHANNEL_COUNT]   == TEST_LEVEL_B);
+        CHECK(collector.samples[i*TEST_CHANNEL_COUNT+1] == TEST_LEVEL_B);
+    }
+
+    TestCollector_Destruct(&collector);
+}
+
+/*----------------------------------------------------------------------
+|    main
++---------------------------------------------------------------------*/
+int
+main(int argc, char** argv)
+{
+    BLT_COMPILER_UNUSED(argc);
+    BLT_COMPILER_UNUSED(argv);
+
+    TestCurves();
+    TestMix();
+    TestSilence();
+    TestTransition();
+
+    printf("CrossFadeTest passed\n");
+    return 0;
+}
@@ -0,0 +1,239 @@
+/*****************************************************************
+|
+|   BlueTune - Equalizer Test
+|
+|   (c) 2002-2012 Gilles Boccon-Gibod
+|   Author: Gilles Boccon-Gibod (bok@bok.net)
+|
+****************************************************************/
+
+/*----------------------------------------------------------------------
+|    includes
++---------------------------------------------------------------------*/
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+
+#include "Atomix.h"
+#include "BltConfig.h"
+#include "BltErrors.h"
+#include "BltEqualizer.h"
+#include "TestUtils.h"
+
+/*----------------------------------------------------------------------
+|    constants
++---------------------------------------------------------------------*/
+#define TEST_SAMPLE_RATE 48000
+#define TEST_FRAME_COUNT 9600  /* 200 ms */
+#define TEST_CHUNK       1031  /* not a multiple of anything */
+#define TEST_TOLERANCE   0.1   /* dB */
+#define TEST_PI          3.14159265358979323846
+
+/*----------------------------------------------------------------------
+|    CHECK
++---------------------------------------------------------------------*/
+#define CHECK(x)                                        \
+do {                                                    \
+    if (!(x)) {                                         \
+        fprintf(stderr, "FAILED line %d\n", __LINE__);  \
+        abort();                                        \
+    }                                                   \
+} while(0)
+
+/*----------------------------------------------------------------------
+|    globals
++---------------------------------------------------------------------*/
+static const BLT_EqualizerBand TestBands[] = {
+    { BLT_EQUALIZER_BAND_HIGH_PASS,  30.0f,   0.0f, 0.71f },
+    { BLT_EQUALIZER_BAND_LOW_SHELF,  100.0f, -6.0f, 0.71f },
+    { BLT_EQUALIZER_BAND_PEAK,       1000.0f, 6.0f, 1.41f },
+    { BLT_EQUALIZER_BAND_HIGH_SHELF, 8000.0f, 3.0f, 0.71f }
+};
+
+/*----------------------------------------------------------------------
+|    Process: runs the equalizer in odd sized chunks
++---------------------------------------------------------------------*/
+static void
+Process(BLT_Equalizer* equalizer, float* samples, unsigned int frame_count)
+{
+    while (frame_count) {
+        unsigned int chunk = frame_count < TEST_CHUNK ? frame_count : TEST_CHUNK;
+        BLT_Equalizer_Process(equalizer, samples, chunk);
+        samples     += chunk*equalizer->channel_count;
+        frame_count -= chunk;
+    }
+}
+
+/*----------------------------------------------------------------------
+|    GetToneGain
+|
+|    Filters a sine with a single band, and returns the gain, in dB, once
+|    the filter has settled.
++---------------------------------------------------------------------*/
+static double
+GetToneGain(const BLT_EqualizerBand* band, double frequency)
+{
+    BLT_Equalizer* equalizer = (BLT_Equalizer*)malloc(sizeof(BLT_Equalizer));
+    float*         samples   = (float*)malloc(TEST_FRAME_COUNT*sizeof(float));
+    double         in_power  = 0.0;
+    double         out_power = 0.0;
+    unsigned int   i;
+
+    for (i=0; i<TEST_FRAME_COUNT; i++) {
+        samples[i] = (float)(0.5*sin(2.0*TEST_PI*frequency*(double)i/TEST_SAMPLE_RATE));
+    }
+
+    CHECK(BLT_SUCCEEDED(BLT_Equalizer_Init(equalizer, TEST_SAMPLE_RATE, 1)));
+    BLT_Equalizer_SetBands(equalizer, band, 1, 0.0f, BLT_FALSE);
+    Process(equalizer, samples, TEST_FRAME_COUNT);
+
+    /* skip the first half, where the filter settles */
+    for (i=TEST_FRAME_COUNT/2; i<TEST_FRAME_COUNT; i++) {
+        double x = 0.5*sin(2.0*TEST_PI*frequency*(double)i/TEST_SAMPLE_RATE);
+        in_power  += x*x;
+        out_power += (double)samples[i]*(double)samples[i];
+    }
+
+    free(samples);
+    free(equalizer);
+
+    return 10.0*log10(out_power/in_power);
+}
+
+/*----------------------------------------------------------------------
+|    TestResponse
++---------------------------------------------------------------------*/
+static void
+TestResponse(void)
+{
+    /* a peak has its gain at its center, and none far from it */
+    CHECK(fabs(GetToneGain(&TestBands[2], 1000.0)-6.0) <= TEST_TOLERANCE);
+    CHECK(fabs(GetToneGain(&TestBands[2], 20.0))        <= TEST_TOLERANCE);
+    CHECK(fabs(GetToneGain(&TestBands[2], 20000.0))     <= TEST_TOLERANCE);
+
+    /* shelves: all of the gain on their side, half at the corner */
+    CHECK(fabs(GetToneGain(&TestBands[1], 20.0)+6.0)    <= TEST_TOLERANCE);
+    CHECK(fabs(GetToneGain(&TestBands[1], 100.0)+3.0)   <= TEST_TOLERANCE);
+    CHECK(fabs(GetToneGain(&TestBands[1], 5000.0))      <= TEST_TOLERANCE);
+    CHECK(fabs(GetToneGain(&TestBands[3], 20000.0)-3.0) <= 0.5);
+    CHECK(fabs(GetToneGain(&TestBands[3], 200.0))       <= TEST_TOLERANCE);
+
+    /* a high pass is 3 dB down at its corner, with a Q of 0.71 */
+    CHECK(fabs(GetToneGain(&TestBands[0], 30.0)+3.0)    <= TEST_TOLERANCE);
+    CHECK(fabs(GetToneGain(&TestBands[0], 1000.0))      <= TEST_TOLERANCE);
+}
+
+/*----------------------------------------------------------------------
+|    TestChannels
+|
+|    Whatever the number of channels, each of them comes out exactly as
+|    if it had been filtered alone, including through a ramp.
++---------------------------------------------------------------------*/
+static void
+TestChannels(void)
+{
+    BLT_Equalizer* equalizer = (BLT_Equalizer*)malloc(sizeof(BLT_Equalizer));
+    float*         input     = (float*)malloc(TEST_FRAME_COUNT*BLT_EQUALIZER_MAX_CHANNELS*sizeof(float));
+    float*         mono      = (float*)malloc(TEST_FRAME_COUNT*BLT_EQUALIZER_MAX_CHANNELS*sizeof(float));
+    float*         samples   = (float*)malloc(TEST_FRAME_COUNT*BLT_EQUALIZER_MAX_CHANNELS*sizeof(float));
+    unsigned int   seed      = 1;
+    unsigned int   channel_count;
+    unsigned int   c;
+    unsigned int   i;
+
+    for (i=0; i<TEST_FRAME_COUNT*BLT_EQUALIZER_MAX_CHANNELS; i++) {
+        input[i] = (float)((int)(TestUtils_Random(&seed)&0xFFFF)-32768)/32768.0f;
+    }
+
+    /* each channel alone, one after the other */
+    for (c=0; c<BLT_EQUALIZER_MAX_CHANNELS; c++) {
+        float* channel = mono+c*TEST_FRAME_COUNT;
+        for (i=0; i<TEST_FRAME_COUNT; i++) {
+            channel[i] = input[i*BLT_EQUALIZER_MAX_CHANNELS+c];
+        }
+        CHECK(BLT_SUCCEEDED(BLT_Equalizer_Init(equalizer, TEST_SAMPLE_RATE, 1)));
+        BLT_Equalizer_SetBands(equalizer, TestBands, 4, -1.0f, BLT_FALSE);
+        Process(equalizer, channel, TEST_FRAME_COUNT/2);
+        BLT_Equalizer_SetBands(equalizer, TestBands+1, 2, 2.0f, BLT_TRUE);
+        Process(equalizer, channel+TEST_FRAME_COUNT/2, TEST_FRAME_COUNT/2);
+    }
+
+    /* then all of them together */
+    for (channel_count=1; channel_count<=BLT_EQUALIZER_MAX_CHANNELS; channel_count++) {
+        for (i=0; i<TEST_FRAME_COUNT; i++) {
+            for (c=0; c<channel_count; c++) {
+                samples[i*channel_count+c] = input[i*BLT_EQUALIZER_MAX_CHANNELS+c];
+            }
+        }
+        CHECK(BLT_SUCCEEDED(BLT_Equalizer_Init(equalizer, TEST_SAMPLE_RATE, channel_count)));
+        BLT_Equalizer_SetBands(equalizer, TestBands, 4, -1.0f, BLT_FALSE);
+        Process(equalizer, samples, TEST_FRAME_COUNT/2);
+        BLT_Equalizer_SetBands(equalizer, TestBands+1, 2, 2.0f, BLT_TRUE);
+        Process(equalizer, samples+(TEST_FRAME_COUNT/2)*channel_count, TEST_FRAME_COUNT/2);
+        for (i=0; i<TEST_FRAME_COUNT; i++) {
+            for (c=0; c<channel_count; c++) {
+                CHECK(samples[i*channel_count+c] == mono[c*TEST_FRAME_COUNT+i]);
+            }
+        }
+    }
+    CHECK(BLT_Equalizer_Init(equalizer, TEST_SAMPLE_RATE, BLT_EQUALIZER_MAX_CHANNELS+1) ==
+          BLT_ERROR_NOT_SUPPORTED);
+
+    free(samples);
+    free(mono);
+    free(input);
+    free(equalizer);
+}
+
+/*----------------------------------------------------------------------
+|    TestRamp
++---------------------------------------------------------------------*/
+static void
+TestRamp(void)
+{
+    BLT_Equalizer* equalizer = (BLT_Equalizer*)malloc(sizeof(BLT_Equalizer));
+    float          samples[2*BLT_EQUALIZER_RAMP_LENGTH];
+    double         target = pow(10.0, 6.0/20.0);
+    unsigned int   i;
+
+    CHECK(BLT_SUCCEEDED(BLT_Equalizer_Init(equalizer, TEST_SAMPLE_RATE, 1)));
+    CHECK(BLT_Equalizer_IsFlat(equalizer));
+
+    /* a gain change moves smoothly, over the ramp, to its target */
+    for (i=0; i<2*BLT_EQUALIZER_RAMP_LENGTH; i++) samples[i] = 0.5f;
+    BLT_Equalizer_SetBands(equalizer, NULL, 0, 6.0f, BLT_TRUE);
+    CHECK(!BLT_Equalizer_IsFlat(equalizer));
+    Process(equalizer, samples, 2*BLT_EQUALIZER_RAMP_LENGTH);
+    CHECK(samples[0] > 0.5f && samples[0] < 0.51f);
+    for (i=1; i<BLT_EQUALIZER_RAMP_LENGTH; i++) {
+        CHECK(samples[i] > samples[i-1]);
+        CHECK(samples[i]-samples[i-1] < 0.01f);
+    }
+    for (i=BLT_EQUALIZER_RAMP_LENGTH; i<2*BLT_EQUALIZER_RAMP_LENGTH; i++) {
+        CHECK(fabs(samples[i]-0.5*target) < 1e-5);
+    }
+
+    /* and back, without a ramp */
+    BLT_Equalizer_SetBands(equalizer, NULL, 0, 0.0f, BLT_FALSE);
+    CHECK(BLT_Equalizer_IsFlat(equalizer));
+
+    free(equalizer);
+}
+
+/*----------------------------------------------------------------------
+|    main
++---------------------------------------------------------------------*/
+int
+main(int argc, char** argv)
+{
+    BLT_COMPILER_UNUSED(argc);
+    BLT_COMPILER_UNUSED(argv);
+
+    TestResponse();
+    TestChannels();
+    TestRamp();
+
+    printf("EqualizerTest passed\n");
+    return 0;
+}
@@ -0,0 +1,254 @@
+/*****************************************************************
+|
+|   BlueTune - FFMPEG Decoder Benchmark
+|
+|   (c) 2002-2012 Gilles Boccon-Gibod
+|   Author: Gilles Boccon-Gibod (bok@bok.net)
+|
+****************************************************************/
+
+/*----------------------------------------------------------------------
+|    includes
++---------------------------------------------------------------------*/
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#if defined(_WIN32)
+#include <windows.h>
+#else
+#include <unistd.h>
+#endif
+
+#include "Atomix.h"
+#include "BltConfig.h"
+#include "BltErrors.h"
+#include "BltDecoder.h"
+#include "BltMediaPacket.h"
+#include "BltPacketConsumer.h"
+#include "BltPixels.h"
+#include "BltFfmpegDecoder.h"
+
+/*----------------------------------------------------------------------
+|    constants
++---------------------------------------------------------------------*/
+#define BENCHMARK_MAX_THREADS 16
+
+/*----------------------------------------------------------------------
+|    types
++---------------------------------------------------------------------*/
+/* stands in for the video output: counts the pictures, and, if asked */
+/* to, converts them the way the SDL output does when it has no       */
+/* hardware overlay                                                   */
+typedef struct {
+    /* interfaces */
+    ATX_IMPLEMENTS(BLT_PacketConsumer);
+
+    /* members */
+    unsigned int      frame_count;
+    BLT_Boolean       convert;
+    BLT_PixelScaler*  scaler;
+    unsigned int      width;
+    unsigned int      height;
+    BLT_UInt8*        pixels;
+} FrameCounter;
+
+/*----------------------------------------------------------------------
+|    GetTime
++---------------------------------------------------------------------*/
+static ATX_Int64
+GetTime(void)
+{
+    ATX_TimeStamp now;
+    ATX_Int64     now_int = 0;
+
+    ATX_System_GetCurrentTimeStamp(&now);
+    ATX_TimeStamp_ToInt64(now, now_int);
+
+    return now_int;
+}
+
+/*----------------------------------------------------------------------
+|    FrameCounter_PutPacket
++---------------------------------------------------------------------*/
+BLT_METHOD
+FrameCounter_PutPacket(BLT_PacketConsumer* _self, BLT_MediaPacket* packet)
+{
+    FrameCounter*                self = ATX_SELF(FrameCounter, BLT_PacketConsumer);
+    const BLT_RawVideoMediaType* media_type;
+    const BLT_UInt8*             planes[3];
+    unsigned int                 pitches[3];
+    const BLT_UInt8*             payload;
+    unsigned int                 i;
+
+    ++self->frame_count;
+    if (!self->convert) return BLT_SUCCESS;
+
+    BLT_MediaPacket_GetMediaType(packet, (const BLT_MediaType**)&media_type);
+    if (media_type->format != BLT_PIXEL_FORMAT_YV12) return BLT_ERROR_INVALID_MEDIA_TYPE;
+
+    /* a new scaler when the size changes */
+    if (self->scaler == NULL || media_type->width != self->width || media_type->height != self->height) {
+        BLT_Result result;
+        if (self->scaler) BLT_PixelScaler_Destroy(self->scaler);
+        free(self->pixels);
+        self->width  = media_type->width;
+        self->height = media_type->height;
+        self->pixels = (BLT_UInt8*)malloc(self->width*self->height*4);
+        result = BLT_PixelScaler_Create(self->width, self->height,
+                                        self->width, self->height,
+                                        BLT_PIXEL_FORMAT_BGRA,
+                                        &self->scaler);
+        if (BLT_FAILED(result)) {
+            self->scaler = NULL;
+            return result;
+        }
+    }
+
+    payload = (const BLT_UInt8*)BLT_MediaPacket_GetPayloadBuffer(packet);
+    for (i=0; i<3; i++) {
+        planes[i]  = payload+media_type->planes[i].offset;
+        pitches[i] = media_type->planes[i].bytes_per_line;
+    }
+    BLT_PixelScaler_Convert(self->scaler, planes, pitches, self->pixels, self->width*4);
+
+    return BLT_SUCCESS;
+}
+
+/*----------------------------------------------------------------------
+|    GetInterface implementation
++---------------------------------------------------------------------*/
+ATX_BEGIN_GET_INTERFACE_IMPLEMENTATION(FrameCounter)
+    ATX_GET_INTERFACE_ACCEPT(FrameCounter, BLT_PacketConsumer)
+ATX_END_GET_INTERFACE_IMPLEMENTATION
+
+/*----------------------------------------------------------------------
+|    BLT_PacketConsumer interface
++---------------------------------------------------------------------*/
+ATX_BEGIN_INTERFACE_MAP(FrameCounter, BLT_PacketConsumer)
+    FrameCounter_PutPacket
+ATX_END_INTERFACE_MAP
+
+/*----------------------------------------------------------------------
+|    Run
++---------------------------------------------------------------------*/
+static void
+Run(const char* filename, unsigned int thread_count, BLT_Boolean convert)
+{
+    BLT_Decoder*      decoder = NULL;
+    ATX_Properties*   properties = NULL;
+    ATX_PropertyValue value;
+    FrameCounter      counter;
+    char              output_name[64];
+    ATX_Int64         start;
+    double            seconds;
+    BLT_Result        result;
+
+    memset(&counter, 0, sizeof(counter));
+    counter.convert = convert;
+    ATX_SET_INTERFACE(&counter, FrameCounter, BLT_PacketConsumer);
+
+    result = BLT_Decoder_Create(&decoder);
+    if (BLT_FAILED(result)) {
+        fprintf(stderr, "BLT_Decoder_Create failed (%d)\n", result);
+        return;
+    }
+    BLT_Decoder_RegisterBuiltins(decoder);
+#if !defined(BLT_CONFIG_MODULES_ENABLE_FFMPEG_DECODER)
+    {
+        BLT_Module* module = NULL;
+        if (BLT_SUCCEEDED(BLT_FfmpegDecoderModule_GetModuleObject(&module))) {
+            BLT_Decoder_RegisterModule(decoder, module);
+            ATX_RELEASE_OBJECT(module);
+        }
+    }
+#endif
+
+    /* the decoder reads this when it is created */
+    BLT_Decoder_GetProperties(decoder, &properties);
+    value.type         = ATX_PROPERTY_VALUE_TYPE_INTEGER;
+    value.data.integer = thread_count;
+    ATX_Properties_SetProperty(properties, BLT_FFMPEG_DECODER_THREAD_COUNT, &value);
+
+    /* the pictures go to the counter, headless */
+    sprintf(output_name, "callback-output:%lu", (unsigned long)(size_t)&ATX_BASE(&counter, BLT_PacketConsumer));
+    result = BLT_Decoder_SetOutput(decoder, output_name, NULL);
+    if (BLT_SUCCEEDED(result)) {
+        result = BLT_Decoder_SetInput(decoder, filename, "video/H264");
+    }
+    if (BLT_FAILED(result)) {
+        fprintf(stderr, "cannot open %s (%d)\n", filename, result);
+        BLT_Decoder_Destroy(decoder);
+        return;
+    }
+
+    start = GetTime();
+    do {
+        result = BLT_Decoder_PumpPacket(decoder);
+    } while (BLT_SUCCEEDED(result));
+    seconds = (double)(GetTime()-start)/1000000000.0;
+    if (seconds <= 0.0) seconds = 1e-9;
+
+    printf("%2d thread%s%s %6d frames %8.1f fps\n",
+           thread_count,
+           thread_count == 1 ? ", " : "s,",
+           convert ? " converted," : "",
+           counter.frame_count,
+           (double)counter.frame_count/seconds);
+
+    BLT_Decoder_Destroy(decoder);
+    if (counter.scaler) BLT_PixelScaler_Destroy(counter.scaler);
+    free(counter.pixels);
+}
+
+/*----------------------------------------------------------------------
+|    GetProcessorCount
++---------------------------------------------------------------------*/
+static unsigned int
+GetProcessorCount(void)
+{
+#if defined(_WIN32)
+    SYSTEM_INFO info;
+    GetSystemInfo(&info);
+    return info.dwNumberOfProcessors;
+#elif defined(_SC_NPROCESSORS_ONLN)
+    long count = sysconf(_SC_NPROCESSORS_ONLN);
+    return count > 0 ? (unsigned int)count : 1;
+#else
+    return 1;
+#endif
+}
+
+/*----------------------------------------------------------------------
+|    main
++---------------------------------------------------------------------*/
+int
+main(int argc, char** argv)
+{
+    const char*  filename = NULL;
+    BLT_Boolean  convert = BLT_FALSE;
+    unsigned int max_threads = 0;
+    unsigned int threads;
+
+    for (++argv; *argv; ++argv) {
+        if (!strcmp(*argv, "-convert")) {
+            convert = BLT_TRUE;
+        } else if (!strcmp(*argv, "-threads") && argv[1]) {
+            max_threads = (unsigned int)strtoul(*++argv, NULL, 10);
+        } else {
+            filename = *argv;
+        }
+    }
+    if (filename == NULL) {
+        fprintf(stderr, "usage: FfmpegDecoderBenchmark [-convert] [-threads <max>] <h264-annex-b-file>\n"
+                        "(-convert also converts the pictures to BGRA, like the SDL output)\n");
+        return 1;
+    }
+    if (max_threads == 0) max_threads = GetProcessorCount(); /* what the decoder uses by default */
+    if (max_threads > BENCHMARK_MAX_THREADS) max_threads = BENCHMARK_MAX_THREADS;
+
+    for (threads=1; threads<=max_threads; threads *= 2) {
+        Run(filename, threads, convert);
+    }
+
+    return 0;
+}
@@ -0,0 +1,471 @@
+/*****************************************************************
+|
+|   BlueTune - FFMPEG Decoder Test
+|
+|   (c) 2002-2012 Gilles Boccon-Gibod
+|   Author: Gilles Boccon-Gibod (bok@bok.net)
+|
+****************************************************************/
+
+/*----------------------------------------------------------------------
+|    includes
++---------------------------------------------------------------------*/
+#include <stdio.h>
+#include <stdlib.h>
+
+#include "Atomix.h"
+#include "BltConfig.h"
+#include "BltErrors.h"
+#include "BltDecoder.h"
+#include "BltMediaPacket.h"
+#include "BltPacketConsumer.h"
+#include "BltPixels.h"
+#include "BltFfmpegDecoder.h"
+#include "TestUtils.h"
+
+/*----------------------------------------------------------------------
+|    constants
++---------------------------------------------------------------------*/
+#define TEST_FILENAME       "FfmpegDecoderTest.h264"
+#define TEST_WIDTH          48 /* narrower than a line of the pictures */
+#define TEST_HEIGHT         32
+#define TEST_FRAME_COUNT    60
+#define TEST_MAX_HELD       6
+#define TEST_MAX_RBSP_SIZE  8192
+
+/*----------------------------------------------------------------------
+|    CHECK
++---------------------------------------------------------------------*/
+#define CHECK(x)                                        \
+do {                                                    \
+    if (!(x)) {                                         \
+        fprintf(stderr, "FAILED line %d\n", __LINE__);  \
+        abort();                                        \
+    }                                                   \
+} while(0)
+
+/*----------------------------------------------------------------------
+|    types
++---------------------------------------------------------------------*/
+/* the payload of a NAL unit, before the emulation prevention bytes */
+typedef struct {
+    BLT_UInt8    data[TEST_MAX_RBSP_SIZE];
+    unsigned int size;
+    unsigned int bit_count; /* bits already in the last byte */
+} BitWriter;
+
+/*----------------------------------------------------------------------
+|    TestSample
+|
+|    The value of a sample of a plane (0 for luma) of a frame. Never 0,
+|    and different from frame to frame.
++---------------------------------------------------------------------*/
+static BLT_UInt8
+TestSample(unsigned int frame, unsigned int plane, unsigned int x, unsigned int y)
+{
+    switch (plane) {
+        case 0:  return (BLT_UInt8)(1+(x+3*y+17*frame)%251);
+        case 1:  return (BLT_UInt8)(1+(2*x+y+29*frame)%251);
+        default: return (BLT_UInt8)(1+(x+2*y+41*frame)%251);
+    }
+}
+
+/*----------------------------------------------------------------------
+|    BitWriter_Reset
++---------------------------------------------------------------------*/
+static void
+BitWriter_Reset(BitWriter* self)
+{
+    self->size      = 0;
+    self->bit_count = 0;
+}
+
+/*----------------------------------------------------------------------
+|    BitWriter_WriteBits
++---------------------------------------------------------------------*/
+static void
+BitWriter_WriteBits(BitWriter* self, unsigned int value, unsigned int bits)
+{
+    while (bits--) {
+        if (self->bit_count == 0) {
+            CHECK(self->size < TEST_MAX_RBSP_SIZE);
+            self->data[self->size++] = 0;
+        }
+        if ((value>>bits)&1) self->data[self->size-1] |= 0x80>>self->bit_count;
+        self->bit_count = (self->bit_count+1)&7;
+    }
+}
+
+/*----------------------------------------------------------------------
+|    BitWriter_WriteUe
+|
+|    Exp-Golomb code of an unsigned value.
++---------------------------------------------------------------------*/
+static void
+BitWriter_WriteUe(BitWriter* self, unsigned int value)
+{
+    unsigned int bits = 0;
+
+    while ((value+1)>>(bits+1)) ++bits;
+    BitWriter_WriteBits(self, 0, bits);
+    BitWriter_WriteBits(self, value+1, bits+1);
+}
+
+/*----------------------------------------------------------------------
+|    BitWriter_Align
++---------------------------------------------------------------------*/
+static void
+BitWriter_Align(BitWriter* self)
+{
+    if (self->bit_count) BitWriter_WriteBits(self, 0, 8-self->bit_count);
+}
+
+/*----------------------------------------------------------------------
+|    BitWriter_Finish
+|
+|    rbsp_trailing_bits()
++---------------------------------------------------------------------*/
+static void
+BitWriter_Finish(BitWriter* self)
+{
+    BitWriter_WriteBits(self, 1, 1);
+    BitWriter_Align(self);
+}
+
+/*----------------------------------------------------------------------
+|    WriteNalUnit
+|
+|    Writes a NAL unit in the annex-b format, with the emulation
+|    prevention bytes.
++---------------------------------------------------------------------*/
+static void
+WriteNalUnit(FILE* file, unsigned int header, const BitWriter* rbsp)
+{
+    static const BLT_UInt8 start_code[4] = { 0, 0, 0, 1 };
+    unsigned char          byte = (unsigned char)header;
+    unsigned int           zeros = 0;
+    unsigned int           i;
+
+    CHECK(fwrite(start_code, sizeof(start_code), 1, file) == 1);
+    CHECK(fputc(byte, file) != EOF);
+    for (i=0; i<rbsp->size; i++) {
+        if (zeros == 2 && rbsp->data[i] <= 3) {
+            CHECK(fputc(3, file) != EOF);
+            zeros = 0;
+        }
+        CHECK(fputc(rbsp->data[i], file) != EOF);
+        zeros = rbsp->data[i] ? 0 : zeros+1;
+    }
+}
+
+/*----------------------------------------------------------------------
+|    WriteTestFile
+|
+|    An H.264 stream that is only I_PCM macroblocks, so that the
+|    decoded pictures are exactly the samples that went in. There is
+|    one reference picture, and the pictures are output in the order
+|    in which they are decoded.
++---------------------------------------------------------------------*/
+static void
+WriteTestFile(void)
+{
+    static BitWriter rbsp;
+    FILE*            file = fopen(TEST_FILENAME, "wb");
+    unsigned int     frame;
+    unsigned int     mb_x;
+    unsigned int     mb_y;
+    unsigned int     plane;
+    unsigned int     x;
+    unsigned int     y;
+
+    CHECK(file != NULL);
+
+    /* sequence parameter set: baseline */
+    BitWriter_Reset(&rbsp);
+    BitWriter_WriteBits(&rbsp, 66, 8);              /* profile_idc                     */
+    BitWriter_WriteBits(&rbsp, 0xC0, 8);            /* constraint_set0/1_flag          */
+    BitWriter_WriteBits(&rbsp, 30, 8);              /* level_idc                       */
+    BitWriter_WriteUe(&rbsp, 0);                    /* seq_parameter_set_id            */
+    BitWriter_WriteUe(&rbsp, 0);                    /* log2_max_frame_num_minus4       */
+    BitWriter_WriteUe(&rbsp, 2);                    /* pic_order_cnt_type              */
+    BitWriter_WriteUe(&rbsp, 1);                    /* max_num_ref_frames              */
+    BitWriter_WriteBits(&rbsp, 0, 1);               /* gaps_in_frame_num_allowed_flag  */
+    BitWriter_WriteUe(&rbsp, TEST_WIDTH/16-1);      /* pic_width_in_mbs_minus1         */
+    BitWriter_WriteUe(&rbsp, TEST_HEIGHT/16-1);     /* pic_height_in_map_units_minus1  */
+    BitWriter_WriteBits(&rbsp, 1, 1);               /* frame_mbs_only_flag             */
+    BitWriter_WriteBits(&rbsp, 1, 1);               /* direct_8x8_inference_flag       */
+    BitWriter_WriteBits(&rbsp, 0, 1);               /* frame_cropping_flag             */
+    BitWriter_WriteBits(&rbsp, 0, 1);               /* vui_parameters_present_flag     */
+    BitWriter_Finish(&rbsp);
+    WriteNalUnit(file, 0x67, &rbsp);
+
+    /* picture parameter set: CAVLC, and the slices can turn the deblocking filter off */
+    BitWriter_Reset(&rbsp);
+    BitWriter_WriteUe(&rbsp, 0);                    /* pic_parameter_set_id            */
+    BitWriter_WriteUe(&rbsp, 0);                    /* seq_parameter_set_id            */
+    BitWriter_WriteBits(&rbsp, 0, 1);               /* entropy_coding_mode_flag        */
+    BitWriter_WriteBits(&rbsp, 0, 1);               /* bottom_field_pic_order_in_frame_present_flag */
+    BitWriter_WriteUe(&rbsp, 0);                    /* num_slice_groups_minus1         */
+    BitWriter_WriteUe(&rbsp, 0);                    /* num_ref_idx_l0_default_active_minus1 */
+    BitWriter_WriteUe(&rbsp, 0);                    /* num_ref_idx_l1_default_active_minus1 */
+    BitWriter_WriteBits(&rbsp, 0, 1);               /* weighted_pred_flag              */
+    BitWriter_WriteBits(&rbsp, 0, 2);               /* weighted_bipred_idc             */
+    BitWriter_WriteUe(&rbsp, 0);                    /* pic_init_qp_minus26 (se)        */
+    BitWriter_WriteUe(&rbsp, 0);                    /* pic_init_qs_minus26 (se)        */
+    BitWriter_WriteUe(&rbsp, 0);                    /* chroma_qp_index_offset (se)     */
+    BitWriter_WriteBits(&rbsp, 1, 1);               /* deblocking_filter_control_present_flag */
+    BitWriter_WriteBits(&rbsp, 0, 1);               /* constrained_intra_pred_flag     */
+    BitWriter_WriteBits(&rbsp, 0, 1);               /* redundant_pic_cnt_present_flag  */
+    BitWriter_Finish(&rbsp);
+    WriteNalUnit(file, 0x68, &rbsp);
+
+    /* an IDR picture, then I pictures, each one slice */
+    for (frame=0; frame<TEST_FRAME_COUNT; frame++) {
+        BitWriter_Reset(&rbsp);
+        BitWriter_WriteUe(&rbsp, 0);                /* first_mb_in_slice               */
+        BitWriter_WriteUe(&rbsp, 7);                /* slice_type: I, all slices       */
+        BitWriter_WriteUe(&rbsp, 0);                /* pic_parameter_set_id            */
+        BitWriter_WriteBits(&rbsp, frame%16, 4);    /* frame_num                       */
+        if (frame == 0) {
+            BitWriter_WriteUe(&rbsp, 0);            /* idr_pic_id                      */
+            BitWriter_WriteBits(&rbsp, 0, 1);       /* no_output_of_prior_pics_flag    */
+            BitWriter_WriteBits(&rbsp, 0, 1);       /* long_term_reference_flag        */
+        } else {
+            BitWriter_WriteBits(&rbsp, 0, 1);       /* adaptive_ref_pic_marking_mode_flag */
+        }
+        BitWriter_WriteUe(&rbsp, 0);                /* slice_qp_delta (se)             */
+        BitWriter_WriteUe(&rbsp, 1);                /* disable_deblocking_filter_idc   */
+        for (mb_y=0; mb_y<TEST_HEIGHT/16; mb_y++) {
+            for (mb_x=0; mb_x<TEST_WIDTH/16; mb_x++) {
+                BitWriter_WriteUe(&rbsp, 25);       /* mb_type: I_PCM                  */
+                BitWriter_Align(&rbsp);             /* pcm_alignment_zero_bit          */
+                for (y=0; y<16; y++) {
+                    for (x=0; x<16; x++) {
+                        BitWriter_WriteBits(&rbsp, TestSample(frame, 0, mb_x*16+x, mb_y*16+y), 8);
+                    }
+                }
+                for (plane=1; plane<3; plane++) {
+                    for (y=0; y<8; y++) {
+                        for (x=0; x<8; x++) {
+                            BitWriter_WriteBits(&rbsp, TestSample(frame, plane, mb_x*8+x, mb_y*8+y), 8);
+                        }
+                    }
+                }
+            }
+        }
+        BitWriter_Finish(&rbsp);
+        WriteNalUnit(file, frame == 0 ? 0x65 : 0x41, &rbsp);
+    }
+
+    CHECK(fclose(file) == 0);
+}
+
+/*----------------------------------------------------------------------
+|    TestHolder
+|
+|    Stands in for a video output that holds on to the last few
+|    pictures it got, the way a renderer keeps the ones it is showing.
+|    The pictures it holds must not change, even while the decoder
+|    keeps decoding, and the buffers it lets go of are decoded into
+|    again.
++---------------------------------------------------------------------*/
+typedef struct {
+    /* interfaces */
+    ATX_IMPLEMENTS(BLT_PacketConsumer);
+
+    /* members */
+    BLT_MediaPacket* held[TEST_MAX_HELD];
+    unsigned int     held_frames[TEST_MAX_HELD];
+    unsigned int     held_count;
+    const void*      buffers[TEST_FRAME_COUNT]; /* the payload of each frame */
+    unsigned int     frame_count;
+} TestHolder;
+
+/*----------------------------------------------------------------------
+|    CheckPicture
++---------------------------------------------------------------------*/
+static void
+CheckPicture(BLT_MediaPacket* packet, unsigned int frame)
+{
+    const BLT_RawVideoMediaType* media_type;
+    const BLT_UInt8*             payload = (const BLT_UInt8*)BLT_MediaPacket_GetPayloadBuffer(packet);
+    BLT_Size                     size    = BLT_MediaPacket_GetPayloadSize(packet);
+    unsigned int                 plane;
+    unsigned int                 x;
+    unsigned int                 y;
+
+    BLT_MediaPacket_GetMediaType(packet, (const BLT_MediaType**)(const void*)&media_type);
+    CHECK(media_type->format == BLT_PIXEL_FORMAT_YV12);
+    CHECK(media_type->width  == TEST_WIDTH);
+    CHECK(media_type->height == TEST_HEIGHT);
+
+    for (plane=0; plane<3; plane++) {
+        unsigned int width  = plane ? TEST_WIDTH/2  : TEST_WIDTH;
+        unsigned int height = plane ? TEST_HEIGHT/2 : TEST_HEIGHT;
+        unsigned int pitch  = media_type->planes[plane].bytes_per_line;
+        BLT_Size     offset = media_type->planes[plane].offset;
+
+        /* the plane is in the payload */
+        CHECK(pitch >= width);
+        CHECK(offset+(height-1)*pitch+width <= size);
+
+        for (y=0; y<height; y++) {
+            for (x=0; x<width; x++) {
+                CHECK(payload[offset+y*pitch+x] == TestSample(frame, plane, x, y));
+            }
+        }
+    }
+}
+
+/*----------------------------------------------------------------------
+|    TestHolder_ReleaseOldest
++---------------------------------------------------------------------*/
+static void
+TestHolder_ReleaseOldest(TestHolder* self)
+{
+    unsigned int i;
+
+    CHECK(self->held_count);
+    CheckPicture(self->held[0], self->held_frames[0]);
+    BLT_MediaPacket_Release(self->held[0]);
+    for (i=1; i<self->held_count; i++) {
+        self->held[i-1]        = self->held[i];
+        self->held_frames[i-1] = self->held_frames[i];
+    }
+    --self->held_count;
+}
+
+/*----------------------------------------------------------------------
+|    TestHolder_PutPacket
++---------------------------------------------------------------------*/
+BLT_METHOD
+TestHolder_PutPacket(BLT_PacketConsumer* _self, BLT_MediaPacket* packet)
+{
+    TestHolder*  self = ATX_SELF(TestHolder, BLT_PacketConsumer);
+    const void*  buffer = BLT_MediaPacket_GetPayloadBuffer(packet);
+    unsigned int i;
+
+    CHECK(self->frame_count < TEST_FRAME_COUNT);
+    CheckPicture(packet, self->frame_count);
+
+    /* not decoded into a picture that is still held */
+    for (i=0; i<self->held_count; i++) {
+        CHECK(BLT_MediaPacket_GetPayloadBuffer(self->held[i]) != buffer);
+    }
+    self->buffers[self->frame_count] = buffer;
+
+    if (self->held_count == TEST_MAX_HELD) TestHolder_ReleaseOldest(self);
+    BLT_MediaPacket_AddReference(packet);
+    self->held[self->held_count]        = packet;
+    self->held_frames[self->held_count] = self->frame_count;
+    ++self->held_count;
+    ++self->frame_count;
+
+    return BLT_SUCCESS;
+}
+
+/*----------------------------------------------------------------------
+|    GetInterface implementation
++---------------------------------------------------------------------*/
+ATX_BEGIN_GET_INTERFACE_IMPLEMENTATION(TestHolder)
+    ATX_GET_INTERFACE_ACCEPT(TestHolder, BLT_PacketConsumer)
+ATX_END_GET_INTERFACE_IMPLEMENTATION
+
+ATX_BEGIN_INTERFACE_MAP(TestHolder, BLT_PacketConsumer)
+    TestHolder_PutPacket
+ATX_END_INTERFACE_MAP
+
+/*----------------------------------------------------------------------
+|    CountBuffers
+|
+|    How many different buffers the frames were decoded into.
++---------------------------------------------------------------------*/
+static unsigned int
+CountBuffers(const TestHolder* holder)
+{
+    unsigned int count = 0;
+    unsigned int i;
+    unsigned int j;
+
+    for (i=0; i<holder->frame_count; i++) {
+        for (j=0; j<i; j++) {
+            if (holder->buffers[j] == holder->buffers[i]) break;
+        }
+        if (j == i) ++count;
+    }
+
+    return count;
+}
+
+/*----------------------------------------------------------------------
+|    TestHandoff
+|
+|    Decodes the test file with a number of codec threads, holding on
+|    to the last pictures, and keeps the last ones after the decoder
+|    is gone: the pictures outlive the node that decoded them.
++---------------------------------------------------------------------*/
+static void
+TestHandoff(unsigned int thread_count)
+{
+    BLT_Decoder*      decoder = NULL;
+    ATX_Properties*   properties = NULL;
+    ATX_PropertyValue value;
+    TestHolder        holder;
+    char              output_name[64];
+
+    ATX_SetMemory(&holder, 0, sizeof(holder));
+    ATX_SET_INTERFACE(&holder, TestHolder, BLT_PacketConsumer);
+
+    CHECK(BLT_SUCCEEDED(BLT_Decoder_Create(&decoder)));
+    BLT_Decoder_RegisterBuiltins(decoder);
+#if !defined(BLT_CONFIG_MODULES_ENABLE_FFMPEG_DECODER)
+    {
+        BLT_Module* module = NULL;
+        CHECK(BLT_SUCCEEDED(BLT_FfmpegDecoderModule_GetModuleObject(&module)));
+        CHECK(BLT_SUCCEEDED(BLT_Decoder_RegisterModule(decoder, module)));
+        ATX_RELEASE_OBJECT(module);
+    }
+#endif
+
+    /* the decoder reads this when it is created */
+    CHECK(BLT_SUCCEEDED(BLT_Decoder_GetProperties(decoder, &properties)));
+    value.type         = ATX_PROPERTY_VALUE_TYPE_INTEGER;
+    value.data.integer = thread_count;
+    CHECK(ATX_SUCCEEDED(ATX_Properties_SetProperty(properties, BLT_FFMPEG_DECODER_THREAD_COUNT, &value)));
+
+    sprintf(output_name, "callback-output:%lu", (unsigned long)(size_t)&ATX_BASE(&holder, BLT_PacketConsumer));
+    CHECK(BLT_SUCCEEDED(BLT_Decoder_SetOutput(decoder, output_name, NULL)));
+    CHECK(BLT_SUCCEEDED(BLT_Decoder_SetInput(decoder, TEST_FILENAME, "video/H264")));
+    CHECK(TestUtils_PumpToEnd(decoder) == BLT_ERROR_EOS);
+
+    CHECK(holder.frame_count == TEST_FRAME_COUNT);
+    CHECK(holder.held_count  == TEST_MAX_HELD);
+
+    /* the buffers that were let go of were decoded into again */
+    CHECK(CountBuffers(&holder) < TEST_FRAME_COUNT-TEST_MAX_HELD);
+
+    BLT_Decoder_Destroy(decoder);
+    while (holder.held_count) TestHolder_ReleaseOldest(&holder);
+}
+
+/*----------------------------------------------------------------------
+|    main
++---------------------------------------------------------------------*/
+int
+main(int argc, char** argv)
+{
+    BLT_COMPILER_UNUSED(argc);
+    BLT_COMPILER_UNUSED(argv);
+
+    WriteTestFile();
+
+    /* with frame threads, the pictures are taken from the pool */
+    /* and given back from the codec's threads                  */
+    TestHandoff(1);
+    TestHandoff(4);
+
+    remove(TEST_FILENAME);
+
+    printf("FfmpegDecoderTest passed\n");
+    return 0;
+}
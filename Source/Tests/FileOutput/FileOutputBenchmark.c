@@ -0,0 +1,225 @@
+/*****************************************************************
+|
+|   BlueTune - File Output Benchmark
+|
+|   (c) 2002-2012 Gilles Boccon-Gibod
+|   Author: Gilles Boccon-Gibod (bok@bok.net)
+|
+****************************************************************/
+
+/*----------------------------------------------------------------------
+|    includes
++---------------------------------------------------------------------*/
+#include <stdio.h>
+#include <stdlib.h>
+#include <math.h>
+
+#include "Atomix.h"
+#include "BltConfig.h"
+#include "BltErrors.h"
+#include "BltWriteBehindStream.h"
+
+/*----------------------------------------------------------------------
+|    constants
++---------------------------------------------------------------------*/
+#define BENCHMARK_SAMPLE_RATE    44100
+#define BENCHMARK_PACKET_FRAMES  1152 /* an MP3 frame */
+#define BENCHMARK_AUDIO_DURATION 1800 /* seconds of audio written per run */
+#define BENCHMARK_BUFFER_SIZE    (4*1024*1024)
+#define BENCHMARK_PREALLOCATION  (16*1024*1024)
+
+/*----------------------------------------------------------------------
+|    types
++---------------------------------------------------------------------*/
+typedef enum {
+    BENCHMARK_MODE_UNBUFFERED,   /* what the file output used to do */
+    BENCHMARK_MODE_WRITE_BEHIND,
+    BENCHMARK_MODE_WRITE_BEHIND_PREALLOCATED,
+    BENCHMARK_MODE_WRITE_BEHIND_O_DIRECT
+} BenchmarkMode;
+
+/*----------------------------------------------------------------------
+|    GetTime
++---------------------------------------------------------------------*/
+static ATX_Int64
+GetTime(void)
+{
+    ATX_TimeStamp now;
+    ATX_Int64     now_int = 0;
+
+    ATX_System_GetCurrentTimeStamp(&now);
+    ATX_TimeStamp_ToInt64(now, now_int);
+
+    return now_int;
+}
+
+/*----------------------------------------------------------------------
+|    Decode
+|
+|    Stands in for the decoder: a little work for each sample, so that
+|    the writes have something to overlap with.
++---------------------------------------------------------------------*/
+static void
+Decode(BLT_Int16* samples, unsigned int packet_index)
+{
+    double       phase = (double)packet_index*BENCHMARK_PACKET_FRAMES;
+    unsigned int i;
+
+    for (i=0; i<BENCHMARK_PACKET_FRAMES; i++) {
+        double t = (phase+i)/BENCHMARK_SAMPLE_RATE;
+        samples[2*i  ] = (BLT_Int16)(8000.0*sin(2*M_PI*220.0*t));
+        samples[2*i+1] = (BLT_Int16)(8000.0*sin(2*M_PI*331.0*t));
+    }
+}
+
+/*----------------------------------------------------------------------
+|    OpenStream
++---------------------------------------------------------------------*/
+static BLT_Result
+OpenStream(const char* filename, BenchmarkMode mode, ATX_File** file, ATX_OutputStream** stream)
+{
+    ATX_OutputStream* file_stream = NULL;
+    BLT_Result        result;
+
+    *file = NULL;
+    switch (mode) {
+        case BENCHMARK_MODE_WRITE_BEHIND_PREALLOCATED:
+            return BLT_WriteBehindStream_CreateForFile(filename,
+                                                       BENCHMARK_BUFFER_SIZE,
+                                                       0,
+                                                       BENCHMARK_PREALLOCATION,
+                                                       stream);
+
+        case BENCHMARK_MODE_WRITE_BEHIND_O_DIRECT:
+            return BLT_WriteBehindStream_CreateForFile(filename,
+                                                       BENCHMARK_BUFFER_SIZE,
+                                                       BLT_WRITE_BEHIND_STREAM_FLAG_DIRECT,
+                                                       BENCHMARK_PREALLOCATION,
+                                                       stream);
+
+        default:
+            break;
+    }
+
+    result = ATX_File_Create(filename, file);
+    if (BLT_FAILED(result)) return result;
+    result = ATX_File_Open(*file,
+                           ATX_FILE_OPEN_MODE_WRITE  |
+                           ATX_FILE_OPEN_MODE_CREATE |
+                           ATX_FILE_OPEN_MODE_TRUNCATE);
+    if (BLT_FAILED(result)) return result;
+    result = ATX_File_GetOutputStream(*file, &file_stream);
+    if (BLT_FAILED(result)) return result;
+
+    if (mode == BENCHMARK_MODE_UNBUFFERED) {
+        *stream = file_stream;
+        return BLT_SUCCESS;
+    }
+    result = BLT_WriteBehindStream_Create(file_stream, BENCHMARK_BUFFER_SIZE, stream);
+    ATX_RELEASE_OBJECT(file_stream);
+
+    return result;
+}
+
+/*----------------------------------------------------------------------
+|    WriteHeader
+|
+|    The header as the wave formatter used to write it, one field at a
+|    time, or as it writes it now, in one call.
++---------------------------------------------------------------------*/
+static void
+WriteHeader(ATX_OutputStream* stream, BenchmarkMode mode)
+{
+    unsigned char header[44] = {0};
+    unsigned int  i;
+
+    ATX_CopyMemory(header, "RIFF", 4);
+    ATX_CopyMemory(header+8, "WAVEfmt ", 8);
+    ATX_CopyMemory(header+36, "data", 4);
+    if (mode == BENCHMARK_MODE_UNBUFFERED) {
+        static const unsigned int fields[] = {4,4,4,4,4,2,2,4,4,2,2,4,4};
+        unsigned int offset = 0;
+        for (i=0; i<sizeof(fields)/sizeof(fields[0]); i++) {
+            ATX_OutputStream_Write(stream, header+offset, fields[i], NULL);
+            offset += fields[i];
+        }
+    } else {
+        ATX_OutputStream_Write(stream, header, sizeof(header), NULL);
+    }
+}
+
+/*----------------------------------------------------------------------
+|    Run
++---------------------------------------------------------------------*/
+static void
+Run(const char* filename, BenchmarkMode mode, const char* name)
+{
+    ATX_File*         file = NULL;
+    ATX_OutputStream* stream = NULL;
+    BLT_Int16*        samples = (BLT_Int16*)malloc(BENCHMARK_PACKET_FRAMES*4);
+    unsigned int      packet_count = (BENCHMARK_AUDIO_DURATION*BENCHMARK_SAMPLE_RATE)/BENCHMARK_PACKET_FRAMES;
+    unsigned int      i;
+    ATX_Position      where = 0;
+    ATX_Int64         start;
+    double            seconds;
+    BLT_Result        result;
+
+    start = GetTime();
+    result = OpenStream(filename, mode, &file, &stream);
+    if (BLT_FAILED(result)) {
+        printf("%-28s not available (%d)\n", name, result);
+        ATX_RELEASE_OBJECT(stream);
+        ATX_DESTROY_OBJECT(file);
+        free(samples);
+        return;
+    }
+
+    /* what the wave formatter and the file output do, per packet */
+    WriteHeader(stream, mode);
+    for (i=0; i<packet_count; i++) {
+        Decode(samples, i);
+        ATX_OutputStream_Write(stream, samples, BENCHMARK_PACKET_FRAMES*4, NULL);
+    }
+
+    /* the header fix-up, then close, which waits for the writes */
+    ATX_OutputStream_Tell(stream, &where);
+    ATX_OutputStream_Seek(stream, 0);
+    WriteHeader(stream, mode);
+    ATX_OutputStream_Seek(stream, where);
+    ATX_RELEASE_OBJECT(stream);
+    ATX_DESTROY_OBJECT(file);
+    seconds = (double)(GetTime()-start)/1000000000.0;
+    if (seconds <= 0.0) seconds = 1e-9;
+
+    printf("%-28s %7.1f MB/s %6.0fx realtime\n",
+           name,
+           (double)where/(1024.0*1024.0)/seconds,
+           (double)BENCHMARK_AUDIO_DURATION/seconds);
+
+    free(samples);
+}
+
+/*----------------------------------------------------------------------
+|    main
++---------------------------------------------------------------------*/
+int
+main(int argc, char** argv)
+{
+    const char* filename;
+
+    if (argc != 2) {
+        fprintf(stderr, "usage: FileOutputBenchmark <output-file>\n"
+                        "(put it on the disk to measure, it is overwritten)\n");
+        return 1;
+    }
+    filename = argv[1];
+
+    /* the data goes to the page cache first, so sizes larger than the */
+    /* free memory show the storage more than the buffering            */
+    Run(filename, BENCHMARK_MODE_UNBUFFERED,                "unbuffered");
+    Run(filename, BENCHMARK_MODE_WRITE_BEHIND,              "write-behind");
+    Run(filename, BENCHMARK_MODE_WRITE_BEHIND_PREALLOCATED, "write-behind, preallocated");
+    Run(filename, BENCHMARK_MODE_WRITE_BEHIND_O_DIRECT,     "write-behind, O_DIRECT");
+
+    return 0;
+}
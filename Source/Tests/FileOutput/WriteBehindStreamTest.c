@@ -0,0 +1,391 @@
+/*****************************************************************
+|
+|   BlueTune - Write-Behind Stream Test
+|
+|   (c) 2002-2012 Gilles Boccon-Gibod
+|   Author: Gilles Boccon-Gibod (bok@bok.net)
+|
+****************************************************************/
+
+/*----------------------------------------------------------------------
+|    includes
++---------------------------------------------------------------------*/
+#include <stdio.h>
+#include <stdlib.h>
+
+#include "Atomix.h"
+#include "BltConfig.h"
+#include "BltErrors.h"
+#include "BltDecoder.h"
+#include "BltFileOutput.h"
+#include "BltWriteBehindStream.h"
+#include "TestUtils.h"
+
+/*----------------------------------------------------------------------
+|    constants
++---------------------------------------------------------------------*/
+#define TEST_BUFFER_SIZE     (4*4096)  /* four chunks of 4096 bytes */
+#define TEST_CHUNK_SIZE      4096
+#define TEST_TARGET_CAPACITY (64*1024)
+#define TEST_TARGET_ERROR    BLT_ERROR_NO_MEDIUM
+#define TEST_HEADER_SIZE     44
+#define TEST_INPUT_FILENAME  "WriteBehindStreamTestIn.wav"
+#define TEST_OUTPUT_FILENAME "WriteBehindStreamTestOut.wav"
+#define TEST_SAMPLE_RATE     44100
+#define TEST_CHANNEL_COUNT   2
+#define TEST_FRAME_COUNT     (TEST_SAMPLE_RATE/2) /* 500 ms */
+
+/*----------------------------------------------------------------------
+|    CHECK
++---------------------------------------------------------------------*/
+#define CHECK(x)                                        \
+do {                                                    \
+    if (!(x)) {                                         \
+        fprintf(stderr, "FAILED line %d\n", __LINE__);  \
+        abort();                                        \
+    }                                                   \
+} while(0)
+
+/*----------------------------------------------------------------------
+|    TestTarget
+|
+|    A stream in memory that the write-behind stream writes to. It
+|    counts what reaches it before each seek and flush, and can fail
+|    the writes that would take it past a number of bytes.
++---------------------------------------------------------------------*/
+typedef struct {
+    /* interfaces */
+    ATX_IMPLEMENTS(ATX_OutputStream);
+    ATX_IMPLEMENTS(ATX_Referenceable);
+
+    /* members */
+    ATX_Cardinal  reference_count;
+    unsigned char data[TEST_TARGET_CAPACITY];
+    ATX_Position  position;
+    ATX_Size      size;
+    ATX_Size      received;   /* bytes written, wherever they went */
+    ATX_Size      fail_after; /* 0 for never */
+    unsigned int  seek_count;
+    ATX_Size      received_at_seek;
+    unsigned int  flush_count;
+    ATX_Size      received_at_flush;
+} TestTarget;
+
+static void
+TestTarget_Destroy(TestTarget* self)
+{
+    ATX_FreeMemory(self);
+}
+
+ATX_METHOD
+TestTarget_Write(ATX_OutputStream* _self,
+                 const void*       buffer,
+                 ATX_Size          bytes_to_write,
+                 ATX_Size*         bytes_written)
+{
+    TestTarget* self = ATX_SELF(TestTarget, ATX_OutputStream);
+
+    if (bytes_written) *bytes_written = 0;
+    if (self->fail_after && self->received+bytes_to_write > self->fail_after) {
+        return TEST_TARGET_ERROR;
+    }
+    if (self->position+bytes_to_write > TEST_TARGET_CAPACITY) return BLT_ERROR_OUT_OF_RANGE;
+
+    ATX_CopyMemory(self->data+self->position, buffer, bytes_to_write);
+    self->position += bytes_to_write;
+    if (self->position > self->size) self->size = (ATX_Size)self->position;
+    self->received += bytes_to_write;
+    if (bytes_written) *bytes_written = bytes_to_write;
+
+    return ATX_SUCCESS;
+}
+
+ATX_METHOD
+TestTarget_Seek(ATX_OutputStream* _self, ATX_Position where)
+{
+    TestTarget* self = ATX_SELF(TestTarget, ATX_OutputStream);
+
+    if (where > TEST_TARGET_CAPACITY) return BLT_ERROR_OUT_OF_RANGE;
+    self->position = where;
+    self->received_at_seek = self->received;
+    ++self->seek_count;
+
+    return ATX_SUCCESS;
+}
+
+ATX_METHOD
+TestTarget_Tell(ATX_OutputStream* _self, ATX_Position* where)
+{
+    TestTarget* self = ATX_SELF(TestTarget, ATX_OutputStream);
+    *where = self->position;
+    return ATX_SUCCESS;
+}
+
+ATX_METHOD
+TestTarget_Flush(ATX_OutputStream* _self)
+{
+    TestTarget* self = ATX_SELF(TestTarget, ATX_OutputStream);
+
+    self->received_at_flush = self->received;
+    ++self->flush_count;
+
+    return ATX_SUCCESS;
+}
+
+ATX_BEGIN_GET_INTERFACE_IMPLEMENTATION(TestTarget)
+    ATX_GET_INTERFACE_ACCEPT(TestTarget, ATX_OutputStream)
+    ATX_GET_INTERFACE_ACCEPT(TestTarget, ATX_Referenceable)
+ATX_END_GET_INTERFACE_IMPLEMENTATION
+
+ATX_BEGIN_INTERFACE_MAP(TestTarget, ATX_OutputStream)
+    TestTarget_Write,
+    TestTarget_Seek,
+    TestTarget_Tell,
+    TestTarget_Flush
+ATX_END_INTERFACE_MAP
+
+ATX_IMPLEMENT_REFERENCEABLE_INTERFACE(TestTarget, reference_count)
+
+static TestTarget*
+TestTarget_Create(ATX_Size fail_after)
+{
+    TestTarget* self = (TestTarget*)ATX_AllocateZeroMemory(sizeof(TestTarget));
+    self->reference_count = 1;
+    self->fail_after      = fail_after;
+    ATX_SET_INTERFACE(self, TestTarget, ATX_OutputStream);
+    ATX_SET_INTERFACE(self, TestTarget, ATX_Referenceable);
+    return self;
+}
+
+/*----------------------------------------------------------------------
+|    WritePattern
+|
+|    Writes bytes that tell where they belong, in pieces that don't
+|    line up with the chunks.
++---------------------------------------------------------------------*/
+static void
+WritePattern(ATX_OutputStream* stream, ATX_Position from, ATX_Size size)
+{
+    unsigned char piece[333];
+    ATX_Size      done = 0;
+
+    while (done < size) {
+        ATX_Size     count = size-done < sizeof(piece) ? size-done : sizeof(piece);
+        ATX_Size     written = 0;
+        unsigned int i;
+        for (i=0; i<count; i++) piece[i] = (unsigned char)((from+done+i)%251);
+        CHECK(BLT_SUCCEEDED(ATX_OutputStream_Write(stream, piece, count, &written)));
+        CHECK(written == count);
+        done += count;
+    }
+}
+
+/*----------------------------------------------------------------------
+|    TestOrdering
+|
+|    What the wave formatter does when it closes: seek back to rewrite
+|    the header, then seek to the end. Everything written before a seek
+|    or a flush reaches the target before the target sees the seek or
+|    the flush.
++---------------------------------------------------------------------*/
+static void
+TestOrdering(void)
+{
+    TestTarget*       target = TestTarget_Create(0);
+    ATX_OutputStream* stream = NULL;
+    unsigned char     header[TEST_HEADER_SIZE];
+    ATX_Position      where = 0;
+    unsigned int      i;
+
+    CHECK(BLT_SUCCEEDED(BLT_WriteBehindStream_Create(&ATX_BASE(target, ATX_OutputStream),
+                                                     TEST_BUFFER_SIZE,
+                                                     &stream)));
+    CHECK(target->reference_count == 2);
+
+    /* more than two chunks, the last one only partly filled */
+    WritePattern(stream, 0, 10000);
+    CHECK(BLT_SUCCEEDED(ATX_OutputStream_Tell(stream, &where)));
+    CHECK(where == 10000);
+
+    /* seeking to where the stream already is doesn't wait */
+    CHECK(BLT_SUCCEEDED(ATX_OutputStream_Seek(stream, 10000)));
+    CHECK(target->seek_count == 0);
+
+    /* the header rewrite */
+    CHECK(BLT_SUCCEEDED(ATX_OutputStream_Seek(stream, 0)));
+    CHECK(target->seek_count == 1);
+    CHECK(target->received_at_seek == 10000);
+    for (i=0; i<TEST_HEADER_SIZE; i++) header[i] = (unsigned char)(0xA0+i);
+    CHECK(BLT_SUCCEEDED(ATX_OutputStream_Write(stream, header, TEST_HEADER_SIZE, NULL)));
+    CHECK(BLT_SUCCEEDED(ATX_OutputStream_Tell(stream, &where)));
+    CHECK(where == TEST_HEADER_SIZE);
+    CHECK(BLT_SUCCEEDED(ATX_OutputStream_Seek(stream, 10000)));
+    CHECK(target->seek_count == 2);
+    CHECK(target->received_at_seek == 10000+TEST_HEADER_SIZE);
+
+    /* a flush waits for the writes, then flushes the target */
+    WritePattern(stream, 10000, 5000);
+    CHECK(BLT_SUCCEEDED(ATX_OutputStream_Flush(stream)));
+    CHECK(target->flush_count == 1);
+    CHECK(target->received_at_flush == 15000+TEST_HEADER_SIZE);
+
+    /* releasing the stream waits for what was written since */
+    WritePattern(stream, 15000, 100);
+    ATX_RELEASE_OBJECT(stream);
+    CHECK(target->reference_count == 1);
+    CHECK(target->received == 15100+TEST_HEADER_SIZE);
+
+    CHECK(target->size == 15100);
+    for (i=0; i<TEST_HEADER_SIZE; i++) {
+        CHECK(target->data[i] == (unsigned char)(0xA0+i));
+    }
+    for (; i<15100; i++) {
+        CHECK(target->data[i] == (unsigned char)(i%251));
+    }
+
+    TestTarget_Destroy(target);
+}
+
+/*----------------------------------------------------------------------
+|    TestErrors
+|
+|    The background thread fails to write the second chunk: the error
+|    comes back from the next call that waits for it, and from every
+|    call after that, and nothing more reaches the target.
++---------------------------------------------------------------------*/
+static void
+TestErrors(void)
+{
+    TestTarget*       target = TestTarget_Create(TEST_CHUNK_SIZE+1000);
+    ATX_OutputStream* stream = NULL;
+    unsigned char*    data = (unsigned char*)ATX_AllocateZeroMemory(3*TEST_CHUNK_SIZE);
+    unsigned char     byte = 0;
+    ATX_Size          written = 1;
+
+    CHECK(BLT_SUCCEEDED(BLT_WriteBehindStream_Create(&ATX_BASE(target, ATX_OutputStream),
+                                                     TEST_BUFFER_SIZE,
+                                                     &stream)));
+
+    /* one write, which only checks for errors before it fills chunks, */
+    /* so it doesn't see the error yet                                 */
+    CHECK(BLT_SUCCEEDED(ATX_OutputStream_Write(stream, data, 3*TEST_CHUNK_SIZE, NULL)));
+
+    CHECK(ATX_OutputStream_Flush(stream) == TEST_TARGET_ERROR);
+    CHECK(target->flush_count == 0);
+    CHECK(ATX_OutputStream_Write(stream, &byte, 1, &written) == TEST_TARGET_ERROR);
+    CHECK(written == 0);
+    CHECK(ATX_OutputStream_Seek(stream, 0) == TEST_TARGET_ERROR);
+    CHECK(target->seek_count == 0);
+    CHECK(ATX_OutputStream_Flush(stream) == TEST_TARGET_ERROR);
+
+    /* the chunks queued behind the failed one were dropped */
+    CHECK(target->received == TEST_CHUNK_SIZE);
+
+    ATX_RELEASE_OBJECT(stream);
+    CHECK(target->reference_count == 1);
+    CHECK(target->received == TEST_CHUNK_SIZE);
+    TestTarget_Destroy(target);
+
+    /* a stream released with an error pending still goes away cleanly */
+    target = TestTarget_Create(TEST_CHUNK_SIZE+1000);
+    CHECK(BLT_SUCCEEDED(BLT_WriteBehindStream_Create(&ATX_BASE(target, ATX_OutputStream),
+                                                     TEST_BUFFER_SIZE,
+                                                     &stream)));
+    CHECK(BLT_SUCCEEDED(ATX_OutputStream_Write(stream, data, 2*TEST_CHUNK_SIZE+100, NULL)));
+    ATX_RELEASE_OBJECT(stream);
+    CHECK(target->reference_count == 1);
+    CHECK(target->received == TEST_CHUNK_SIZE);
+    TestTarget_Destroy(target);
+
+    ATX_FreeMemory(data);
+}
+
+/*----------------------------------------------------------------------
+|    ReadLE
++---------------------------------------------------------------------*/
+static unsigned long
+ReadLE(const unsigned char* bytes, unsigned int size)
+{
+    unsigned long value = 0;
+
+    while (size--) value = (value<<8)|bytes[size];
+    return value;
+}
+
+/*----------------------------------------------------------------------
+|    TestWavFile
+|
+|    Decodes a WAV file to a WAV file through the file output, with a
+|    buffer small enough for the header rewrite to happen with chunks
+|    still in flight: the file is complete once the decoder is gone,
+|    with the sizes of the finished file in its header.
++---------------------------------------------------------------------*/
+static void
+TestWavFile(void)
+{
+    static BLT_Int16  samples[TEST_FRAME_COUNT*TEST_CHANNEL_COUNT];
+    BLT_Decoder*      decoder = NULL;
+    ATX_Properties*   properties = NULL;
+    ATX_PropertyValue value;
+    unsigned int      data_size = TEST_FRAME_COUNT*TEST_CHANNEL_COUNT*2;
+    unsigned char*    file_data = (unsigned char*)malloc(TEST_HEADER_SIZE+data_size+1);
+    FILE*             file;
+    unsigned int      seed = 1;
+    unsigned int      i;
+
+    for (i=0; i<TEST_FRAME_COUNT*TEST_CHANNEL_COUNT; i++) {
+        samples[i] = (BLT_Int16)TestUtils_Random(&seed);
+    }
+    CHECK(BLT_SUCCEEDED(TestUtils_WriteWavFile(TEST_INPUT_FILENAME, samples, TEST_FRAME_COUNT,
+                                               TEST_CHANNEL_COUNT, TEST_SAMPLE_RATE)));
+
+    CHECK(BLT_SUCCEEDED(BLT_Decoder_Create(&decoder)));
+    BLT_Decoder_RegisterBuiltins(decoder);
+    CHECK(BLT_SUCCEEDED(BLT_Decoder_GetProperties(decoder, &properties)));
+    value.type         = ATX_PROPERTY_VALUE_TYPE_INTEGER;
+    value.data.integer = TEST_BUFFER_SIZE;
+    CHECK(ATX_SUCCEEDED(ATX_Properties_SetProperty(properties, BLT_FILE_OUTPUT_BUFFER_SIZE, &value)));
+
+    CHECK(BLT_SUCCEEDED(BLT_Decoder_SetOutput(decoder, "file:" TEST_OUTPUT_FILENAME, NULL)));
+    CHECK(BLT_SUCCEEDED(BLT_Decoder_SetInput(decoder, TEST_INPUT_FILENAME, NULL)));
+    CHECK(TestUtils_PumpToEnd(decoder) == BLT_ERROR_EOS);
+    BLT_Decoder_Destroy(decoder);
+
+    file = fopen(TEST_OUTPUT_FILENAME, "rb");
+    CHECK(file != NULL);
+    CHECK(fread(file_data, 1, TEST_HEADER_SIZE+data_size+1, file) == TEST_HEADER_SIZE+data_size);
+    fclose(file);
+
+    CHECK(ATX_StringsEqualN((const char*)file_data, "RIFF", 4));
+    CHECK(ReadLE(file_data+4, 4) == 36+data_size);
+    CHECK(ATX_StringsEqualN((const char*)file_data+8, "WAVEfmt ", 8));
+    CHECK(ReadLE(file_data+22, 2) == TEST_CHANNEL_COUNT);
+    CHECK(ReadLE(file_data+24, 4) == TEST_SAMPLE_RATE);
+    CHECK(ReadLE(file_data+34, 2) == 16);
+    CHECK(ATX_StringsEqualN((const char*)file_data+36, "data", 4));
+    CHECK(ReadLE(file_data+40, 4) == data_size);
+    for (i=0; i<TEST_FRAME_COUNT*TEST_CHANNEL_COUNT; i++) {
+        CHECK((BLT_Int16)ReadLE(file_data+TEST_HEADER_SIZE+2*i, 2) == samples[i]);
+    }
+
+    free(file_data);
+    remove(TEST_INPUT_FILENAME);
+    remove(TEST_OUTPUT_FILENAME);
+}
+
+/*----------------------------------------------------------------------
+|    main
++---------------------------------------------------------------------*/
+int
+main(int argc, char** argv)
+{
+    BLT_COMPILER_UNUSED(argc);
+    BLT_COMPILER_UNUSED(argv);
+
+    TestOrdering();
+    TestErrors();
+    TestWavFile();
+
+    printf("WriteBehindStreamTest passed\n");
+    return 0;
+}
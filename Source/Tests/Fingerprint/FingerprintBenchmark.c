@@ -0,0 +1,125 @@
+/*****************************************************************
+|
+|   BlueTune - Fingerprint Benchmark
+|
+|   (c) 2002-2012 Gilles Boccon-Gibod
+|   Author: Gilles Boccon-Gibod (bok@bok.net)
+|
+****************************************************************/
+
+/*----------------------------------------------------------------------
+|    includes
++---------------------------------------------------------------------*/
+#include <stdio.h>
+#include <stdlib.h>
+
+#include "Atomix.h"
+#include "BltErrors.h"
+#include "BltPcm.h"
+#include "BltPcmFloat.h"
+#include "BltFingerprint.h"
+
+/*----------------------------------------------------------------------
+|    constants
++---------------------------------------------------------------------*/
+#define BENCHMARK_PACKET_FRAMES  4096
+#define BENCHMARK_AUDIO_DURATION 600 /* seconds of audio processed per run */
+
+/*----------------------------------------------------------------------
+|    GetTime
++---------------------------------------------------------------------*/
+static ATX_Int64
+GetTime(void)
+{
+    ATX_TimeStamp now;
+    ATX_Int64     now_int = 0;
+
+    ATX_System_GetCurrentTimeStamp(&now);
+    ATX_TimeStamp_ToInt64(now, now_int);
+
+    return now_int;
+}
+
+/*----------------------------------------------------------------------
+|    Run
++---------------------------------------------------------------------*/
+static void
+Run(BLT_Fingerprinter* fingerprinter,
+    const char*        name,
+    unsigned int       sample_rate,
+    unsigned int       channel_count,
+    BLT_UInt8          bits_per_sample,
+    BLT_UInt8          sample_format)
+{
+    BLT_PcmMediaType format;
+    unsigned int     sample_count = BENCHMARK_PACKET_FRAMES*channel_count;
+    float*           samples      = (float*)malloc(sample_count*sizeof(float));
+    unsigned char*   packet       = (unsigned char*)malloc(sample_count*(bits_per_sample/8));
+    unsigned int     packet_count = (BENCHMARK_AUDIO_DURATION*sample_rate)/BENCHMARK_PACKET_FRAMES;
+    unsigned int     i;
+    ATX_Int64        start;
+    ATX_Int64        elapsed;
+    double           seconds;
+
+    /* setup the format */
+    BLT_PcmMediaType_Init(&format);
+    format.sample_rate     = sample_rate;
+    format.channel_count   = (BLT_UInt16)channel_count;
+    format.bits_per_sample = bits_per_sample;
+    format.sample_format   = sample_format;
+
+    /* a pseudo-random signal, in the packet format */
+    for (i=0; i<sample_count; i++) {
+        samples[i] = (float)((int)(i*7919)%2000-1000)/1000.0f;
+    }
+    BLT_PcmFloat_Export(&format, samples, sample_count, packet);
+
+    BLT_Fingerprinter_SetFormat(fingerprinter, sample_rate, channel_count);
+
+    /* convert and fingerprint each packet, like the filter does */
+    start = GetTime();
+    for (i=0; i<packet_count; i++) {
+        BLT_PcmFloat_Import(&format, packet, sample_count, samples);
+        BLT_Fingerprinter_Process(fingerprinter, samples, BENCHMARK_PACKET_FRAMES);
+    }
+    elapsed = GetTime()-start;
+    seconds = (double)elapsed/1000000000.0;
+    if (seconds <= 0.0) seconds = 1e-9;
+
+    printf("%-8s %6dHz %dch %6d sub-fingerprints %8.0fx realtime\n",
+           name,
+           sample_rate,
+           channel_count,
+           (int)BLT_Fingerprinter_GetCount(fingerprinter),
+           (double)BENCHMARK_AUDIO_DURATION/seconds);
+
+    free(packet);
+    free(samples);
+}
+
+/*----------------------------------------------------------------------
+|    main
++---------------------------------------------------------------------*/
+int
+main(int argc, char** argv)
+{
+    BLT_Fingerprinter* fingerprinter;
+
+    BLT_COMPILER_UNUSED(argc);
+    BLT_COMPILER_UNUSED(argv);
+
+    if (BLT_FAILED(BLT_Fingerprinter_Create(BLT_FINGERPRINT_COUNT_FOR_DURATION(BENCHMARK_AUDIO_DURATION+1),
+                                            &fingerprinter))) {
+        return 1;
+    }
+
+    Run(fingerprinter, "s16",   44100, 2, 16, BLT_PCM_SAMPLE_FORMAT_SIGNED_INT_NE);
+    Run(fingerprinter, "s24le", 44100, 2, 24, BLT_PCM_SAMPLE_FORMAT_SIGNED_INT_LE);
+    Run(fingerprinter, "s32",   48000, 2, 32, BLT_PCM_SAMPLE_FORMAT_SIGNED_INT_NE);
+    Run(fingerprinter, "f32",   48000, 2, 32, BLT_PCM_SAMPLE_FORMAT_FLOAT_NE);
+    Run(fingerprinter, "f32",   96000, 6, 32, BLT_PCM_SAMPLE_FORMAT_FLOAT_NE);
+
+    BLT_Fingerprinter_Destroy(fingerprinter);
+
+    return 0;
+}
@@ -0,0 +1,356 @@
+/*****************************************************************
+|
+|   BlueTune - Fingerprint Stability Test
+|
+|   (c) 2002-2012 Gilles Boccon-Gibod
+|   Author: Gilles Boccon-Gibod (bok@bok.net)
+|
+****************************************************************/
+
+/*----------------------------------------------------------------------
+|    includes
++---------------------------------------------------------------------*/
+#include <stdio.h>
+#include <stdlib.h>
+#include <math.h>
+
+#include "Atomix.h"
+#include "BltErrors.h"
+#include "BltPcm.h"
+#include "BltPcmFloat.h"
+#include "BltFingerprint.h"
+#include "TestUtils.h"
+
+/*----------------------------------------------------------------------
+|    constants
++---------------------------------------------------------------------*/
+#define TEST_SAMPLE_RATE    44100
+#define TEST_CHANNEL_COUNT  2
+#define TEST_DURATION       30   /* seconds */
+#define TEST_NOTE_DURATION  0.25 /* seconds */
+#define TEST_MAX_OFFSET     8    /* sub-fingerprints */
+#define TEST_MAX_COPY_BER   0.35
+#define TEST_MIN_OTHER_BER  0.40
+#define TEST_PI             3.14159265358979323846
+
+/*----------------------------------------------------------------------
+|    types
++---------------------------------------------------------------------*/
+typedef struct {
+    float*       samples;
+    unsigned int frame_count;
+    unsigned int sample_rate;
+    unsigned int channel_count;
+} Signal;
+
+/*----------------------------------------------------------------------
+|    Random
++---------------------------------------------------------------------*/
+static double
+Random(unsigned int* seed)
+{
+    return (double)(TestUtils_Random(seed) & 0xFFFF)/65536.0;
+}
+
+/*----------------------------------------------------------------------
+|    Generate
+|
+|    Something that looks a bit like music: a sequence of notes with
+|    harmonics and a decaying envelope, over a soft noise floor.
++---------------------------------------------------------------------*/
+static void
+Generate(Signal* signal, unsigned int seed)
+{
+    unsigned int note_size = (unsigned int)(TEST_NOTE_DURATION*TEST_SAMPLE_RATE);
+    double       frequency = 0.0;
+    double       balance   = 0.5;
+    unsigned int i;
+
+    signal->sample_rate   = TEST_SAMPLE_RATE;
+    signal->channel_count = TEST_CHANNEL_COUNT;
+    signal->frame_count   = TEST_DURATION*TEST_SAMPLE_RATE;
+    signal->samples       = (float*)malloc(signal->frame_count*TEST_CHANNEL_COUNT*sizeof(float));
+
+    for (i=0; i<signal->frame_count; i++) {
+        double t = (double)(i%note_size)/(double)TEST_SAMPLE_RATE;
+        double value = 0.0;
+        int    h;
+        if (i%note_size == 0) {
+            /* pick a new note, on a pentatonic scale between 110Hz and 880Hz */
+            static const int steps[5] = {0, 2, 4, 7, 9};
+            int note = steps[(int)(Random(&seed)*5)]+12*(int)(Random(&seed)*3);
+            frequency = 110.0*pow(2.0, (double)note/12.0);
+            balance   = 0.2+0.6*Random(&seed);
+        }
+        for (h=1; h<=6; h++) {
+            value += sin(2.0*TEST_PI*frequency*h*t)/(double)h;
+        }
+        value *= 0.3*exp(-6.0*t);
+        value += 0.01*(Random(&seed)-0.5);
+        signal->samples[2*i]   = (float)(value*balance);
+        signal->samples[2*i+1] = (float)(value*(1.0-balance));
+    }
+}
+
+/*----------------------------------------------------------------------
+|    Copy
++---------------------------------------------------------------------*/
+static void
+Copy(const Signal* source, Signal* copy)
+{
+    unsigned int i;
+    *copy = *source;
+    copy->samples = (float*)malloc(source->frame_count*source->channel_count*sizeof(float));
+    for (i=0; i<source->frame_count*source->channel_count; i++) {
+        copy->samples[i] = source->samples[i];
+    }
+}
+
+/*----------------------------------------------------------------------
+|    Quantize: round trip through an integer PCM format
++---------------------------------------------------------------------*/
+static void
+Quantize(Signal* signal, unsigned int bits_per_sample, float gain)
+{
+    BLT_PcmMediaType format;
+    unsigned int     sample_count = signal->frame_count*signal->channel_count;
+    void*            buffer       = malloc(sample_count*4);
+    unsigned int     i;
+
+    BLT_PcmMediaType_Init(&format);
+    format.sample_rate     = signal->sample_rate;
+    format.channel_count   = (BLT_UInt16)signal->channel_count;
+    format.bits_per_sample = (BLT_UInt8)bits_per_sample;
+    format.sample_format   = bits_per_sample == 8 ?
+                             BLT_PCM_SAMPLE_FORMAT_UNSIGNED_INT_NE :
+                             BLT_PCM_SAMPLE_FORMAT_SIGNED_INT_NE;
+    for (i=0; i<sample_count; i++) signal->samples[i] *= gain;
+    BLT_PcmFloat_Export(&format, signal->samples, sample_count, buffer);
+    BLT_PcmFloat_Import(&format, buffer, sample_count, signal->samples);
+    free(buffer);
+}
+
+/*----------------------------------------------------------------------
+|    LowPass: band limit and add noise, like a low bitrate encoder
++---------------------------------------------------------------------*/
+static void
+LowPass(Signal* signal, double cutoff, double noise_level)
+{
+    double       w0     = 2.0*TEST_PI*cutoff/(double)signal->sample_rate;
+    double       alpha  = sin(w0)/(2.0*0.7071);
+    double       a0     = 1.0+alpha;
+    double       b0     = (1.0-cos(w0))/2.0/a0;
+    double       b1     = (1.0-cos(w0))/a0;
+    double       a1     = -2.0*cos(w0)/a0;
+    double       a2     = (1.0-alpha)/a0;
+    unsigned int seed   = 1234;
+    unsigned int c;
+
+    for (c=0; c<signal->channel_count; c++) {
+        double       s1 = 0.0, s2 = 0.0;
+        unsigned int i;
+        for (i=0; i<signal->frame_count; i++) {
+            float* sample = &signal->samples[i*signal->channel_count+c];
+            double in     = *sample;
+            double out    = b0*in+s1;
+            s1 = b1*in-a1*out+s2;
+            s2 = b0*in-a2*out;
+            *sample = (float)(out+noise_level*(Random(&seed)-0.5));
+        }
+    }
+}
+
+/*----------------------------------------------------------------------
+|    Resample: linear interpolation to another sample rate
++---------------------------------------------------------------------*/
+static void
+Resample(Signal* signal, unsigned int sample_rate)
+{
+    unsigned int frame_count = (unsigned int)((double)signal->frame_count*sample_rate/signal->sample_rate);
+    float*       samples     = (float*)malloc(frame_count*signal->channel_count*sizeof(float));
+    unsigned int i, c;
+
+    for (i=0; i<frame_count; i++) {
+        double       position = (double)i*signal->sample_rate/sample_rate;
+        unsigned int index    = (unsigned int)position;
+        double       fraction = position-index;
+        if (index+1 >= signal->frame_count) index = signal->frame_count-2;
+        for (c=0; c<signal->channel_count; c++) {
+            float a = signal->samples[index*signal->channel_count+c];
+            float b = signal->samples[(index+1)*signal->channel_count+c];
+            samples[i*signal->channel_count+c] = (float)(a+(b-a)*fraction);
+        }
+    }
+    free(signal->samples);
+    signal->samples     = samples;
+    signal->frame_count = frame_count;
+    signal->sample_rate = sample_rate;
+}
+
+/*----------------------------------------------------------------------
+|    Delay: prepend silence, like an encoder delay
++---------------------------------------------------------------------*/
+static void
+Delay(Signal* signal, double seconds)
+{
+    unsigned int delay   = (unsigned int)(seconds*signal->sample_rate)*signal->channel_count;
+    unsigned int count   = signal->frame_count*signal->channel_count;
+    float*       samples = (float*)calloc(count, sizeof(float));
+    unsigned int i;
+
+    for (i=delay; i<count; i++) samples[i] = signal->samples[i-delay];
+    free(signal->samples);
+    signal->samples = samples;
+}
+
+/*----------------------------------------------------------------------
+|    Downmix: to mono
++---------------------------------------------------------------------*/
+static void
+Downmix(Signal* signal)
+{
+    unsigned int i;
+    for (i=0; i<signal->frame_count; i++) {
+        signal->samples[i] = 0.5f*(signal->samples[2*i]+signal->samples[2*i+1]);
+    }
+    signal->channel_count = 1;
+}
+
+/*----------------------------------------------------------------------
+|    Fingerprint
++---------------------------------------------------------------------*/
+static BLT_Cardinal
+Fingerprint(BLT_Fingerprinter* fingerprinter, const Signal* signal, BLT_UInt32* result)
+{
+    const BLT_UInt32* sub_fingerprints;
+    BLT_Cardinal      count;
+    BLT_Cardinal      i;
+    unsigned int      position = 0;
+
+    BLT_Fingerprinter_SetFormat(fingerprinter, signal->sample_rate, signal->channel_count);
+
+    /* feed it in packet sized chunks */
+    while (position < signal->frame_count) {
+        unsigned int chunk = signal->frame_count-position;
+        if (chunk > 1152) chunk = 1152;
+        BLT_Fingerprinter_Process(fingerprinter,
+                                  signal->samples+position*signal->channel_count,
+                                  chunk);
+        position += chunk;
+    }
+
+    count            = BLT_Fingerprinter_GetCount(fingerprinter);
+    sub_fingerprints = BLT_Fingerprinter_GetSubFingerprints(fingerprinter);
+    for (i=0; i<count; i++) result[i] = sub_fingerprints[i];
+
+    return count;
+}
+
+/*----------------------------------------------------------------------
+|    main
++---------------------------------------------------------------------*/
+int
+main(int argc, char** argv)
+{
+    BLT_Cardinal       max_count = BLT_FINGERPRINT_COUNT_FOR_DURATION(TEST_DURATION+1);
+    BLT_UInt32*        reference = (BLT_UInt32*)malloc(max_count*sizeof(BLT_UInt32));
+    BLT_UInt32*        other     = (BLT_UInt32*)malloc(max_count*sizeof(BLT_UInt32));
+    BLT_Fingerprinter* fingerprinter;
+    BLT_Cardinal       reference_count;
+    Signal             original;
+    int                failures = 0;
+    int                test;
+
+    BLT_COMPILER_UNUSED(argc);
+    BLT_COMPILER_UNUSED(argv);
+
+    if (BLT_FAILED(BLT_Fingerprinter_Create(max_count, &fingerprinter))) return 1;
+
+    Generate(&original, 1);
+    reference_count = Fingerprint(fingerprinter, &original, reference);
+    printf("reference: %d sub-fingerprints\n", (int)reference_count);
+
+    for (test=0; test<10; test++) {
+        Signal       copy;
+        const char*  name   = NULL;
+        BLT_Boolean  same   = BLT_TRUE;
+        BLT_Cardinal count;
+        double       ber;
+        int          offset;
+
+        if (test == 9) {
+            Generate(&copy, 2);
+            name = "unrelated audio";
+            same = BLT_FALSE;
+        } else {
+            Copy(&original, &copy);
+            switch (test) {
+              case 0:
+                name = "identical";
+                break;
+
+              case 1:
+                name = "16 bit, -9dB";
+                Quantize(&copy, 16, 0.35f);
+                break;
+
+              case 2:
+                name = "8 bit";
+                Quantize(&copy, 8, 1.0f);
+                break;
+
+              case 3:
+                name = "low pass 4kHz, noise";
+                LowPass(&copy, 4000.0, 0.02);
+                break;
+
+              case 4:
+                name = "low pass 2.5kHz";
+                LowPass(&copy, 2500.0, 0.0);
+                break;
+
+              case 5:
+                name = "resampled to 48kHz";
+                Resample(&copy, 48000);
+                break;
+
+              case 6:
+                name = "resampled to 22.05kHz, mono";
+                Resample(&copy, 22050);
+                Downmix(&copy);
+                break;
+
+              case 7:
+                name = "delayed by 50ms";
+                Delay(&copy, 0.050);
+                break;
+
+              case 8:
+                /* the worst alignment: half way between two frames */
+                name = "delayed by half a step";
+                Delay(&copy, 0.5*BLT_FINGERPRINT_FRAME_STEP/BLT_FINGERPRINT_SAMPLE_RATE);
+                break;
+            }
+        }
+
+        count = Fingerprint(fingerprinter, &copy, other);
+        ber   = BLT_Fingerprint_Compare(reference, reference_count,
+                                        other, count,
+                                        TEST_MAX_OFFSET, &offset);
+        if (same ? ber > TEST_MAX_COPY_BER : ber < TEST_MIN_OTHER_BER) {
+            ++failures;
+            printf("FAILED ");
+        } else {
+            printf("ok     ");
+        }
+        printf("%-32s bit error rate = %.3f (offset %d)\n", name, ber, offset);
+        free(copy.samples);
+    }
+
+    BLT_Fingerprinter_Destroy(fingerprinter);
+    free(original.samples);
+    free(reference);
+    free(other);
+
+    return failures ? 1 : 0;
+}
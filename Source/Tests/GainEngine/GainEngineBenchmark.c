@@ -0,0 +1,134 @@
+/*****************************************************************
+|
+|   BlueTune - Gain Engine Benchmark
+|
+|   (c) 2002-2012 Gilles Boccon-Gibod
+|   Author: Gilles Boccon-Gibod (bok@bok.net)
+|
+****************************************************************/
+
+/*----------------------------------------------------------------------
+|    includes
++---------------------------------------------------------------------*/
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "Atomix.h"
+#include "BltPcm.h"
+#include "BltGainEngine.h"
+
+/*----------------------------------------------------------------------
+|    constants
++---------------------------------------------------------------------*/
+#define BENCHMARK_SAMPLE_RATE    44100
+#define BENCHMARK_CHANNEL_COUNT  2
+#define BENCHMARK_PACKET_FRAMES  4096
+#define BENCHMARK_AUDIO_DURATION 600 /* seconds of audio processed per run */
+
+/*----------------------------------------------------------------------
+|    types
++---------------------------------------------------------------------*/
+typedef enum {
+    BENCHMARK_ATTENUATE,
+    BENCHMARK_AMPLIFY,
+    BENCHMARK_RAMP
+} BenchmarkMode;
+
+/*----------------------------------------------------------------------
+|    GetTime
++---------------------------------------------------------------------*/
+static ATX_Int64
+GetTime(void)
+{
+    ATX_TimeStamp now;
+    ATX_Int64     now_int = 0;
+
+    ATX_System_GetCurrentTimeStamp(&now);
+    ATX_TimeStamp_ToInt64(now, now_int);
+
+    return now_int;
+}
+
+/*----------------------------------------------------------------------
+|    Run
++---------------------------------------------------------------------*/
+static void
+Run(const char* name, BLT_UInt8 bits_per_sample, BLT_UInt8 sample_format, BenchmarkMode mode)
+{
+    BLT_PcmMediaType format;
+    BLT_GainEngine   engine;
+    BLT_Size         size = BENCHMARK_PACKET_FRAMES*BENCHMARK_CHANNEL_COUNT*(bits_per_sample/8);
+    unsigned char*   source = (unsigned char*)malloc(size);
+    unsigned char*   buffer = (unsigned char*)malloc(size);
+    unsigned int     packet_count = (BENCHMARK_AUDIO_DURATION*BENCHMARK_SAMPLE_RATE)/BENCHMARK_PACKET_FRAMES;
+    unsigned int     i;
+    ATX_Int64        start;
+    ATX_Int64        elapsed;
+    double           seconds;
+
+    /* setup the format */
+    BLT_PcmMediaType_Init(&format);
+    format.sample_rate     = BENCHMARK_SAMPLE_RATE;
+    format.channel_count   = BENCHMARK_CHANNEL_COUNT;
+    format.bits_per_sample = bits_per_sample;
+    format.sample_format   = sample_format;
+
+    /* fill the buffer with a pseudo-random signal */
+    for (i=0; i<size; i++) source[i] = (unsigned char)(i*7919);
+    if (sample_format == BLT_PCM_SAMPLE_FORMAT_FLOAT_NE) {
+        float* samples = (float*)source;
+        for (i=0; i<size/4; i++) samples[i] = (float)((int)(i*7919)%2000-1000)/1000.0f;
+    }
+
+    /* setup the engine */
+    BLT_GainEngine_Init(&engine, BLT_GAIN_ENGINE_RAMP_EXPONENTIAL, BLT_GAIN_ENGINE_DEFAULT_RAMP_DURATION);
+    BLT_GainEngine_ResetGain(&engine, BLT_GainEngine_DbToGain(mode == BENCHMARK_AMPLIFY ? 600 : -600));
+
+    start = GetTime();
+    for (i=0; i<packet_count; i++) {
+        if (mode == BENCHMARK_RAMP) {
+            /* keep the engine ramping all the time */
+            BLT_GainEngine_SetGain(&engine, BLT_GainEngine_DbToGain((i&1) ? 600 : -600));
+        }
+
+        /* start from fresh samples each time, like a real packet stream   */
+        /* (re-processing the same buffer would decay floats to denormals) */
+        memcpy(buffer, source, size);
+        BLT_GainEngine_Process(&engine, &format, buffer, size);
+    }
+    elapsed = GetTime()-start;
+    seconds = (double)elapsed/1000000000.0;
+    if (seconds <= 0.0) seconds = 1e-9;
+
+    printf("%-8s %-10s %8.1f Msamples/s %8.0fx realtime\n",
+           name,
+           mode == BENCHMARK_ATTENUATE ? "attenuate" :
+           mode == BENCHMARK_AMPLIFY   ? "amplify"   : "ramp",
+           ((double)packet_count*BENCHMARK_PACKET_FRAMES*BENCHMARK_CHANNEL_COUNT)/seconds/1000000.0,
+           (double)BENCHMARK_AUDIO_DURATION/seconds);
+
+    free(buffer);
+    free(source);
+}
+
+/*----------------------------------------------------------------------
+|    main
++---------------------------------------------------------------------*/
+int
+main(int argc, char** argv)
+{
+    BenchmarkMode mode;
+
+    BLT_COMPILER_UNUSED(argc);
+    BLT_COMPILER_UNUSED(argv);
+
+    for (mode = BENCHMARK_ATTENUATE; mode <= BENCHMARK_RAMP; mode++) {
+        Run("s16",   16, BLT_PCM_SAMPLE_FORMAT_SIGNED_INT_NE, mode);
+        Run("s24le", 24, BLT_PCM_SAMPLE_FORMAT_SIGNED_INT_LE, mode);
+        Run("s32",   32, BLT_PCM_SAMPLE_FORMAT_SIGNED_INT_NE, mode);
+        Run("f32",   32, BLT_PCM_SAMPLE_FORMAT_FLOAT_NE,      mode);
+    }
+
+    return 0;
+}
@@ -0,0 +1,169 @@
+/*****************************************************************
+|
+|   BlueTune - Gain Engine Test
+|
+|   (c) 2002-2012 Gilles Boccon-Gibod
+|   Author: Gilles Boccon-Gibod (bok@bok.net)
+|
+****************************************************************/
+
+/*----------------------------------------------------------------------
+|    includes
++---------------------------------------------------------------------*/
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "Atomix.h"
+#include "BltErrors.h"
+#include "BltPcm.h"
+#include "BltGainEngine.h"
+#include "TestUtils.h"
+
+/*----------------------------------------------------------------------
+|    constants
++---------------------------------------------------------------------*/
+#define TEST_SAMPLE_COUNT 1027 /* not a multiple of any vector size */
+#define TEST_MAX_OFFSET   3    /* unaligned starts, in samples      */
+
+/*----------------------------------------------------------------------
+|    CHECK
++---------------------------------------------------------------------*/
+#define CHECK(x)                                        \
+do {                                                    \
+    if (!(x)) {                                         \
+        fprintf(stderr, "FAILED line %d\n", __LINE__);  \
+        abort();                                        \
+    }                                                   \
+} while(0)
+
+/*----------------------------------------------------------------------
+|    globals
++---------------------------------------------------------------------*/
+static const BLT_UInt32 TestGains[] = {
+    0,
+    1,
+    16,
+    BLT_GAIN_ENGINE_UNITY_GAIN/3,
+    BLT_GAIN_ENGINE_UNITY_GAIN-1,
+    BLT_GAIN_ENGINE_UNITY_GAIN+16,
+    2*BLT_GAIN_ENGINE_UNITY_GAIN+12345,
+    BLT_GAIN_ENGINE_MAX_GAIN-16,
+    BLT_GAIN_ENGINE_MAX_GAIN
+};
+
+/*----------------------------------------------------------------------
+|    Apply: runs the engine at a constant gain
++---------------------------------------------------------------------*/
+static void
+Apply(BLT_UInt8 bits_per_sample, BLT_UInt8 sample_format, BLT_UInt32 gain,
+      void* samples, unsigned int count)
+{
+    BLT_PcmMediaType format;
+    BLT_GainEngine   engine;
+
+    BLT_PcmMediaType_Init(&format);
+    format.sample_rate     = 44100;
+    format.channel_count   = 1;
+    format.bits_per_sample = bits_per_sample;
+    format.sample_format   = sample_format;
+
+    BLT_GainEngine_Init(&engine, BLT_GAIN_ENGINE_RAMP_LINEAR, 0);
+    BLT_GainEngine_ResetGain(&engine, gain);
+    CHECK(BLT_SUCCEEDED(BLT_GainEngine_Process(&engine, &format, samples, count*bits_per_sample/8)));
+}
+
+/*----------------------------------------------------------------------
+|    Reference16
++---------------------------------------------------------------------*/
+static BLT_Int16
+Reference16(BLT_Int16 sample, BLT_UInt32 gain)
+{
+    BLT_Int32 value = (sample*(BLT_Int32)(gain>>4))>>12;
+    if (value >  32767) value =  32767;
+    if (value < -32768) value = -32768;
+    return (BLT_Int16)value;
+}
+
+/*----------------------------------------------------------------------
+|    Test16
++---------------------------------------------------------------------*/
+static void
+Test16(void)
+{
+    BLT_Int16    input[TEST_SAMPLE_COUNT+TEST_MAX_OFFSET];
+    BLT_Int16    output[TEST_SAMPLE_COUNT+TEST_MAX_OFFSET];
+    unsigned int seed = 1;
+    unsigned int g, offset, i;
+
+    /* the extremes first, then anything */
+    input[0] = -32768;
+    input[1] =  32767;
+    input[2] = -1;
+    input[3] =  1;
+    for (i=4; i<TEST_SAMPLE_COUNT+TEST_MAX_OFFSET; i++) {
+        input[i] = (BLT_Int16)TestUtils_Random(&seed);
+    }
+
+    for (g=0; g<sizeof(TestGains)/sizeof(TestGains[0]); g++) {
+        for (offset=0; offset<=TEST_MAX_OFFSET; offset++) {
+            unsigned int count = TEST_SAMPLE_COUNT+TEST_MAX_OFFSET-offset;
+            memcpy(output, input, sizeof(input));
+            Apply(16, BLT_PCM_SAMPLE_FORMAT_SIGNED_INT_NE, TestGains[g], output+offset, count);
+            for (i=0; i<offset; i++) {
+                CHECK(output[i] == input[i]);
+            }
+            for (; i<offset+count; i++) {
+                CHECK(output[i] == Reference16(input[i], TestGains[g]));
+            }
+        }
+    }
+}
+
+/*----------------------------------------------------------------------
+|    TestFloat
++---------------------------------------------------------------------*/
+static void
+TestFloat(void)
+{
+    float        input[TEST_SAMPLE_COUNT+TEST_MAX_OFFSET];
+    float        output[TEST_SAMPLE_COUNT+TEST_MAX_OFFSET];
+    unsigned int seed = 2;
+    unsigned int g, offset, i;
+
+    for (i=0; i<TEST_SAMPLE_COUNT+TEST_MAX_OFFSET; i++) {
+        input[i] = (float)((int)(TestUtils_Random(&seed)&0xFFFF)-32768)/32768.0f;
+    }
+
+    for (g=0; g<sizeof(TestGains)/sizeof(TestGains[0]); g++) {
+        float factor = (float)TestGains[g]/(float)BLT_GAIN_ENGINE_UNITY_GAIN;
+        if (TestGains[g] == BLT_GAIN_ENGINE_UNITY_GAIN) continue;
+        for (offset=0; offset<=TEST_MAX_OFFSET; offset++) {
+            unsigned int count = TEST_SAMPLE_COUNT+TEST_MAX_OFFSET-offset;
+            memcpy(output, input, sizeof(input));
+            Apply(32, BLT_PCM_SAMPLE_FORMAT_FLOAT_NE, TestGains[g], output+offset, count);
+            for (i=0; i<offset; i++) {
+                CHECK(output[i] == input[i]);
+            }
+            for (; i<offset+count; i++) {
+                CHECK(output[i] == input[i]*factor);
+            }
+        }
+    }
+}
+
+/*----------------------------------------------------------------------
+|    main
++---------------------------------------------------------------------*/
+int
+main(int argc, char** argv)
+{
+    BLT_COMPILER_UNUSED(argc);
+    BLT_COMPILER_UNUSED(argv);
+
+    Test16();
+    TestFloat();
+
+    printf("GainEngineTest passed\n");
+    return 0;
+}
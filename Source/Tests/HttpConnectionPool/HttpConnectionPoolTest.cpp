@@ -0,0 +1,536 @@
+/*****************************************************************
+|
+|   BlueTune - HTTP Connection Pool Test
+|
+|   (c) 2002-2012 Gilles Boccon-Gibod
+|   Author: Gilles Boccon-Gibod (bok@bok.net)
+|
+****************************************************************/
+
+/*----------------------------------------------------------------------
+|    includes
++---------------------------------------------------------------------*/
+#include <stdio.h>
+#include <stdlib.h>
+
+#include "Neptune.h"
+#include "Atomix.h"
+#include "BltErrors.h"
+#include "BltHttpConnectionPool.h"
+#include "BltHttpNetworkStream.h"
+#include "BltNetworkCache.h"
+extern "C" {
+#include "BltCorePriv.h"
+}
+
+/*----------------------------------------------------------------------
+|    constants
++---------------------------------------------------------------------*/
+const unsigned int TEST_BODY_SIZE  = 2*1024*1024;
+const unsigned int TEST_RANGE_SIZE = 65536;
+const unsigned int TEST_SEEK_POINT = 1000;
+
+#define TEST_CACHE_DIRECTORY "HttpConnectionPoolTest.cache"
+
+/*----------------------------------------------------------------------
+|    CHECK
++---------------------------------------------------------------------*/
+#define CHECK(x)                                        \
+do {                                                    \
+    if (!(x)) {                                         \
+        fprintf(stderr, "FAILED line %d\n", __LINE__);  \
+        abort();                                        \
+    }                                                   \
+} while(0)
+
+/*----------------------------------------------------------------------
+|    BodyByte
++---------------------------------------------------------------------*/
+static unsigned char
+BodyByte(NPT_Position position)
+{
+    return (unsigned char)(position%251);
+}
+
+/*----------------------------------------------------------------------
+|    TestServer
+|
+|    Serves TEST_BODY_SIZE bytes at /file, with ranges and keep-alive,
+|    redirects /redirect to /file (with an absolute URL), /relative and
+|    /dir/relative to /file (with relative ones), answers 401 at /auth,
+|    and counts the connections and requests it gets.
+|    /file has an entity tag, and conditional requests for it are
+|    answered with a 304, or with a 206 for a matching If-Range.
++---------------------------------------------------------------------*/
+class TestServer : public NPT_Thread
+{
+public:
+    TestServer() : m_Port(0), m_Connections(0), m_Requests(0), m_LastStatus(0),
+                   m_LastLength(0), m_ETag("\"1\""), m_Done(false) {
+        m_Socket.Bind(NPT_SocketAddress(NPT_IpAddress::Loopback, 0));
+        m_Socket.Listen(16);
+        NPT_SocketInfo info;
+        m_Socket.GetInfo(info);
+        m_Port = info.local_address.GetPort();
+    }
+    ~TestServer() {
+        m_Done = true;
+        Wait();
+        m_Handlers.Apply(NPT_ObjectDeleter<NPT_Thread>());
+    }
+
+    NPT_String Url(const char* path) {
+        return NPT_String("http://127.0.0.1:")+NPT_String::FromIntegerU(m_Port)+path;
+    }
+    unsigned int GetConnections() { NPT_AutoLock lock(m_Lock); return m_Connections; }
+    unsigned int GetRequests()    { NPT_AutoLock lock(m_Lock); return m_Requests;    }
+    unsigned int GetLastStatus()  { NPT_AutoLock lock(m_Lock); return m_LastStatus;  }
+    NPT_Size     GetLastLength()  { NPT_AutoLock lock(m_Lock); return m_LastLength;  }
+    NPT_String   GetCondition()   { NPT_AutoLock lock(m_Lock); return m_Condition;   }
+    NPT_String   GetRange()       { NPT_AutoLock lock(m_Lock); return m_Range;       }
+    void SetETag(const char* etag) { NPT_AutoLock lock(m_Lock); m_ETag = etag; }
+    void ResetCounters() {
+        NPT_AutoLock lock(m_Lock);
+        m_Connections = m_Requests = 0;
+        m_LastStatus = 0;
+        m_LastLength = 0;
+        m_Condition = m_Range = NULL;
+    }
+
+private:
+    class Handler : public NPT_Thread {
+    public:
+        Handler(TestServer& server, NPT_Socket* socket) : m_Server(server), m_Socket(socket) {}
+        ~Handler() { Wait(); delete m_Socket; }
+        void Run() {
+            NPT_InputStreamReference  input;
+            NPT_OutputStreamReference output;
+            m_Socket->GetInputStream(input);
+            m_Socket->GetOutputStream(output);
+            NPT_BufferedInputStream reader(input);
+            while (NPT_SUCCEEDED(m_Server.ServeRequest(reader, *output))) {}
+        }
+    private:
+        TestServer& m_Server;
+        NPT_Socket* m_Socket;
+    };
+
+    void Run() {
+        while (!m_Done) {
+            NPT_Socket* socket = NULL;
+            if (NPT_FAILED(m_Socket.WaitForNewClient(socket, 100))) continue;
+            {
+                NPT_AutoLock lock(m_Lock);
+                ++m_Connections;
+            }
+            Handler* handler = new Handler(*this, socket);
+            m_Handlers.Add(handler);
+            handler->Start();
+        }
+    }
+
+    NPT_Result ServeRequest(NPT_BufferedInputStream& input, NPT_OutputStream& output) {
+        // request line and headers
+        NPT_String line;
+        NPT_CHECK(input.ReadLine(line));
+        NPT_List<NPT_String> parts = line.Split(" ");
+        if (parts.GetItemCount() != 3) return NPT_FAILURE;
+        NPT_String path     = *parts.GetItem(1);
+        NPT_String protocol = *parts.GetItem(2);
+        bool keep_alive = (protocol == "HTTP/1.1");
+        NPT_Position start = 0;
+        NPT_Position end   = TEST_BODY_SIZE-1;
+        bool         ranged = false;
+        NPT_String   if_none_match;
+        NPT_String   if_range;
+        NPT_String   etag;
+        {
+            NPT_AutoLock lock(m_Lock);
+            etag = m_ETag;
+        }
+        for (;;) {
+            NPT_CHECK(input.ReadLine(line));
+            if (line.IsEmpty()) break;
+            if (line.StartsWith("If-None-Match: ", true)) {
+                if_none_match = line.SubString(15);
+            } else if (line.StartsWith("If-Range: ", true)) {
+                if_range = line.SubString(10);
+            } else if (line.StartsWith("Connection:", true)) {
+                keep_alive = line.Find("keep-alive", 0, true) >= 0;
+            } else if (line.StartsWith("Range: bytes=", true)) {
+                NPT_String range = line.SubString(13);
+                int dash = range.Find('-');
+                NPT_LargeSize value = 0;
+                range.SubString(0, dash).ToInteger64(value);
+                start = value;
+                if (dash+1 < (int)range.GetLength()) {
+                    range.SubString(dash+1).ToInteger64(value);
+                    if (value < end) end = value;
+                }
+                ranged = true;
+                NPT_AutoLock lock(m_Lock);
+                m_Range = range;
+            }
+        }
+        {
+            NPT_AutoLock lock(m_Lock);
+            ++m_Requests;
+            if (!if_none_match.IsEmpty()) m_Condition = "If-None-Match: "+if_none_match;
+            if (!if_range.IsEmpty())      m_Condition = "If-Range: "+if_range;
+        }
+
+        // a range is only sent if the entity has not changed
+        if (!if_range.IsEmpty() && if_range != etag) {
+            ranged = false;
+            start  = 0;
+            end    = TEST_BODY_SIZE-1;
+        }
+
+        // response
+        NPT_String response;
+        if (path == "/redirect") {
+            response = "HTTP/1.1 302 Found\r\nLocation: "+Url("/file")+"\r\nContent-Length: 0\r\n";
+            end = start-1;
+        } else if (path == "/relative") {
+            response = "HTTP/1.1 302 Found\r\nLocation: file\r\nContent-Length: 0\r\n";
+            end = start-1;
+        } else if (path == "/dir/relative") {
+            response = "HTTP/1.1 301 Moved Permanently\r\nLocation: /file\r\nContent-Length: 0\r\n";
+            end = start-1;
+        } else if (path == "/auth") {
+            response = "HTTP/1.1 401 Unauthorized\r\nContent-Length: 0\r\n";
+            end = start-1;
+        } else if (!if_none_match.IsEmpty() && if_none_match == etag) {
+            response = "HTTP/1.1 304 Not Modified\r\nETag: "+etag+"\r\n";
+            end = start-1;
+        } else if (ranged) {
+            response  = "HTTP/1.1 206 Partial Content\r\nContent-Range: bytes ";
+            response += NPT_String::FromIntegerU(start)+"-"+NPT_String::FromIntegerU(end)+"/";
+            response += NPT_String::FromIntegerU(TEST_BODY_SIZE)+"\r\n";
+        } else {
+            response  = "HTTP/1.1 200 OK\r\n";
+        }
+        if (path == "/file" || path == "/redirect" || path == "/relative" ||
+            path == "/dir/relative" || path == "/auth") {
+            if (end+1 > start) {
+                response += "Content-Type: audio/mpeg\r\n";
+                response += "ETag: "+etag+"\r\n";
+                response += "Accept-Ranges: bytes\r\n";
+                response += "Content-Length: "+NPT_String::FromIntegerU(end-start+1)+"\r\n";
+            }
+        } else {
+            response = "HTTP/1.1 404 Not Found\r\nContent-Length: 0\r\n";
+            end = start-1;
+        }
+        response += keep_alive ? "Connection: keep-alive\r\n\r\n" : "Connection: close\r\n\r\n";
+        {
+            NPT_AutoLock lock(m_Lock);
+            response.SubString(9, 3).ToInteger(m_LastStatus);
+            m_LastLength = end+1 > start ? (NPT_Size)(end-start+1) : 0;
+        }
+        NPT_CHECK(output.WriteFully(response.GetChars(), response.GetLength()));
+
+        unsigned char chunk[4096];
+        for (NPT_Position position = start; position <= end && end+1 > start;) {
+            NPT_Size size = 0;
+            while (size < sizeof(chunk) && position+size <= end) {
+                chunk[size] = BodyByte(position+size);
+                ++size;
+            }
+            NPT_CHECK(output.WriteFully(chunk, size));
+            position += size;
+        }
+
+        return keep_alive ? NPT_SUCCESS : NPT_ERROR_EOS;
+    }
+
+    NPT_TcpServerSocket m_Socket;
+    NPT_UInt16          m_Port;
+    NPT_Mutex           m_Lock;
+    unsigned int        m_Connections;
+    unsigned int        m_Requests;
+    unsigned int        m_LastStatus;
+    NPT_Size            m_LastLength;
+    NPT_String          m_Condition;
+    NPT_String          m_Range;
+    NPT_String          m_ETag;
+    volatile bool       m_Done;
+    NPT_List<Handler*>  m_Handlers;
+};
+
+/*----------------------------------------------------------------------
+|    TestPool
++---------------------------------------------------------------------*/
+static void
+TestPool(TestServer& server)
+{
+    BLT_HttpConnectionPool* pool = NULL;
+    BLT_HttpConnection*     connection = NULL;
+    BLT_HttpConnection*     first = NULL;
+    BLT_HttpConnection*     connections[BLT_HTTP_CONNECTION_POOL_MAX_IDLE_CONNECTIONS_PER_HOST+2];
+    NPT_HttpUrl             url(server.Url("/file"));
+    NPT_HttpUrl             other_url(NPT_String("http://localhost:")+NPT_String::FromIntegerU(url.GetPort())+"/file");
+    bool                    reused = true;
+    unsigned int            count = sizeof(connections)/sizeof(connections[0]);
+    unsigned int            i;
+
+    CHECK(BLT_SUCCEEDED(BLT_HttpConnectionPool_Create(&pool)));
+
+    // a new connection, then the same one again
+    CHECK(NPT_SUCCEEDED(pool->Acquire(url, first, reused)));
+    CHECK(!reused);
+    pool->Recycle(first);
+    CHECK(NPT_SUCCEEDED(pool->Acquire(url, connection, reused)));
+    CHECK(reused);
+    CHECK(connection == first);
+
+    // connections are kept per host
+    pool->Recycle(connection);
+    CHECK(NPT_SUCCEEDED(pool->Acquire(other_url, connection, reused)));
+    CHECK(!reused);
+    delete connection;
+
+    // no more than the maximum number of idle connections per host
+    for (i=0; i<count; i++) {
+        CHECK(NPT_SUCCEEDED(pool->Acquire(url, connections[i], reused)));
+        CHECK(reused == (i == 0));
+    }
+    for (i=0; i<count; i++) pool->Recycle(connections[i]);
+    for (i=0; i<count; i++) {
+        CHECK(NPT_SUCCEEDED(pool->Acquire(url, connections[i], reused)));
+        CHECK(reused == (i < BLT_HTTP_CONNECTION_POOL_MAX_IDLE_CONNECTIONS_PER_HOST));
+    }
+    for (i=0; i<count; i++) delete connections[i];
+
+    BLT_HttpConnectionPool_Release(pool);
+    printf("pool: ok\n");
+}
+
+/*----------------------------------------------------------------------
+|    ReadAndCheck
++---------------------------------------------------------------------*/
+static void
+ReadAndCheck(ATX_InputStream* stream, NPT_Position position, NPT_Size size)
+{
+    unsigned char buffer[10000];
+
+    while (size) {
+        ATX_Size chunk = size > sizeof(buffer) ? sizeof(buffer) : size;
+        ATX_Size bytes_read = 0;
+        ATX_Result result = ATX_InputStream_Read(stream, buffer, chunk, &bytes_read);
+        CHECK(ATX_SUCCEEDED(result));
+        for (unsigned int i=0; i<bytes_read; i++) {
+            CHECK(buffer[i] == BodyByte(position+i));
+        }
+        position += bytes_read;
+        size     -= bytes_read;
+    }
+}
+
+/*----------------------------------------------------------------------
+|    OpenStream
++---------------------------------------------------------------------*/
+static BLT_Result
+OpenStream(BLT_Core* core, const char* url, ATX_InputStream** stream)
+{
+    BLT_MediaType* media_type = NULL;
+    BLT_Result     result = BLT_HttpNetworkStream_Create(url, core, stream, &media_type);
+    if (media_type) BLT_MediaType_Free(media_type);
+
+    return result;
+}
+
+/*----------------------------------------------------------------------
+|    TestRanges
++---------------------------------------------------------------------*/
+static void
+TestRanges(TestServer& server)
+{
+    BLT_Core*               core = NULL;
+    BLT_HttpConnectionPool* pool = NULL;
+    ATX_Properties*         properties = NULL;
+    ATX_PropertyValue       value;
+    ATX_InputStream*        stream = NULL;
+    ATX_Position            position = 0;
+    unsigned int            ranges = (TEST_BODY_SIZE-TEST_SEEK_POINT+TEST_RANGE_SIZE-1)/TEST_RANGE_SIZE;
+
+    // a core with a pool, as the network input module sets it up
+    CHECK(BLT_SUCCEEDED(BLT_Core_Create(&core)));
+    CHECK(BLT_SUCCEEDED(BLT_HttpConnectionPool_Create(&pool)));
+    BLT_Core_GetProperties(core, &properties);
+    value.type         = ATX_PROPERTY_VALUE_TYPE_POINTER;
+    value.data.pointer = pool;
+    ATX_Properties_SetProperty(properties, BLT_HTTP_CONNECTION_POOL_PROPERTY, &value);
+    value.type         = ATX_PROPERTY_VALUE_TYPE_INTEGER;
+    value.data.integer = TEST_RANGE_SIZE;
+    ATX_Properties_SetProperty(properties, BLT_HTTP_NETWORK_STREAM_RANGE_SIZE_PROPERTY, &value);
+
+    // the first request is for the whole body, since its size isn't known
+    server.ResetCounters();
+    CHECK(BLT_SUCCEEDED(OpenStream(core, server.Url("/file"), &stream)));
+    ReadAndCheck(stream, 0, 100000);
+    CHECK(server.GetRequests() == 1);
+
+    // after a seek, the rest comes in ranges, all on one new connection
+    CHECK(ATX_SUCCEEDED(ATX_InputStream_Seek(stream, TEST_SEEK_POINT)));
+    ReadAndCheck(stream, TEST_SEEK_POINT, TEST_BODY_SIZE-TEST_SEEK_POINT);
+    ATX_InputStream_Tell(stream, &position);
+    CHECK(position == TEST_BODY_SIZE);
+    printf("ranges: %d requests on %d connections\n", server.GetRequests(), server.GetConnections());
+    CHECK(server.GetRequests() == 1+ranges);
+    CHECK(server.GetConnections() == 2);
+    ATX_RELEASE_OBJECT(stream);
+
+    // redirects are followed on pooled connections
+    server.ResetCounters();
+    CHECK(BLT_SUCCEEDED(OpenStream(core, server.Url("/redirect"), &stream)));
+    ReadAndCheck(stream, 0, 1000);
+    CHECK(server.GetRequests() == 2);
+    ATX_RELEASE_OBJECT(stream);
+
+    // relative redirects are resolved against the request URL
+    server.ResetCounters();
+    CHECK(BLT_SUCCEEDED(OpenStream(core, server.Url("/relative"), &stream)));
+    ReadAndCheck(stream, 0, 1000);
+    ATX_RELEASE_OBJECT(stream);
+    CHECK(BLT_SUCCEEDED(OpenStream(core, server.Url("/dir/relative"), &stream)));
+    ReadAndCheck(stream, 0, 1000);
+    CHECK(server.GetRequests() == 4);
+    ATX_RELEASE_OBJECT(stream);
+
+    // authentication challenges are retried with NPT_HttpClient
+    server.ResetCounters();
+    CHECK(OpenStream(core, server.Url("/auth"), &stream) == ATX_ERROR_ACCESS_DENIED);
+    CHECK(server.GetRequests() == 2);
+
+    ATX_Properties_UnsetProperty(properties, BLT_HTTP_CONNECTION_POOL_PROPERTY);
+    BLT_HttpConnectionPool_Release(pool);
+    BLT_Core_Destroy(core);
+    printf("ranges: ok\n");
+}
+
+/*----------------------------------------------------------------------
+|    RemoveCache
++---------------------------------------------------------------------*/
+static void
+RemoveCache()
+{
+    NPT_List<NPT_String> entries;
+    NPT_File::ListDir(TEST_CACHE_DIRECTORY, entries);
+    for (NPT_List<NPT_String>::Iterator i = entries.GetFirstItem(); i; ++i) {
+        NPT_File::RemoveFile(NPT_String(TEST_CACHE_DIRECTORY)+NPT_FilePath::Separator+*i);
+    }
+    NPT_File::RemoveDir(TEST_CACHE_DIRECTORY);
+}
+
+/*----------------------------------------------------------------------
+|    TestCache
++---------------------------------------------------------------------*/
+static void
+TestCache(TestServer& server)
+{
+    BLT_Core*            core = NULL;
+    ATX_Properties*      properties = NULL;
+    ATX_PropertyValue    value;
+    ATX_InputStream*     stream = NULL;
+    BLT_NetworkCacheInfo info;
+    NPT_String           url = server.Url("/file");
+
+    RemoveCache();
+    CHECK(BLT_SUCCEEDED(BLT_Core_Create(&core)));
+    BLT_Core_GetProperties(core, &properties);
+    value.type        = ATX_PROPERTY_VALUE_TYPE_STRING;
+    value.data.string = TEST_CACHE_DIRECTORY;
+    ATX_Properties_SetProperty(properties, BLT_NETWORK_CACHE_DIRECTORY_PROPERTY, &value);
+
+    // nothing cached yet, the request is not conditional
+    server.ResetCounters();
+    CHECK(NPT_FAILED(BLT_NetworkCache_Lookup(core, url, info)));
+    CHECK(BLT_SUCCEEDED(OpenStream(core, url, &stream)));
+    ReadAndCheck(stream, 0, 100000);
+    CHECK(server.GetCondition().IsEmpty());
+    ATX_RELEASE_OBJECT(stream);
+
+    // what was read is cached, with its validator and content type
+    CHECK(NPT_SUCCEEDED(BLT_NetworkCache_Lookup(core, url, info)));
+    CHECK(info.m_Validator == "etag:\"1\"");
+    CHECK(info.m_ContentType == "audio/mpeg");
+    CHECK(info.m_Size == TEST_BODY_SIZE);
+    CHECK(info.m_CachedSize >= 100000 && info.m_CachedSize < TEST_BODY_SIZE);
+
+    // a partially cached resource is resumed where the cached data ends
+    server.ResetCounters();
+    CHECK(BLT_SUCCEEDED(OpenStream(core, url, &stream)));
+    ReadAndCheck(stream, 0, TEST_BODY_SIZE);
+    printf("cache: resumed at %d\n", (int)info.m_CachedSize);
+    CHECK(server.GetRequests() == 1);
+    CHECK(server.GetCondition() == "If-Range: \"1\"");
+    CHECK(server.GetRange() == NPT_String("bytes=")+NPT_String::FromIntegerU(info.m_CachedSize)+"-");
+    CHECK(server.GetLastStatus() == 206);
+    CHECK(server.GetLastLength() == TEST_BODY_SIZE-info.m_CachedSize);
+    ATX_RELEASE_OBJECT(stream);
+
+    // a fully cached resource is only revalidated
+    CHECK(NPT_SUCCEEDED(BLT_NetworkCache_Lookup(core, url, info)));
+    CHECK(info.m_CachedSize == TEST_BODY_SIZE);
+    server.ResetCounters();
+    CHECK(BLT_SUCCEEDED(OpenStream(core, url, &stream)));
+    ReadAndCheck(stream, 0, TEST_BODY_SIZE);
+    CHECK(server.GetCondition() == "If-None-Match: \"1\"");
+    CHECK(server.GetRequests() == 1);
+    CHECK(server.GetLastStatus() == 304);
+
+    // the entry is in use, so a second stream is not conditional
+    ATX_InputStream* other = NULL;
+    server.ResetCounters();
+    CHECK(NPT_FAILED(BLT_NetworkCache_Lookup(core, url, info)));
+    CHECK(BLT_SUCCEEDED(OpenStream(core, url, &other)));
+    ReadAndCheck(other, 0, 1000);
+    CHECK(server.GetCondition().IsEmpty());
+    ATX_RELEASE_OBJECT(other);
+    ATX_RELEASE_OBJECT(stream);
+
+    // a changed resource is sent again, and replaces the cached data
+    server.SetETag("\"2\"");
+    server.ResetCounters();
+    CHECK(BLT_SUCCEEDED(OpenStream(core, url, &stream)));
+    ReadAndCheck(stream, 0, 100000);
+    CHECK(server.GetCondition() == "If-None-Match: \"1\"");
+    CHECK(server.GetLastStatus() == 200);
+    ATX_RELEASE_OBJECT(stream);
+    CHECK(NPT_SUCCEEDED(BLT_NetworkCache_Lookup(core, url, info)));
+    CHECK(info.m_Validator == "etag:\"2\"");
+    CHECK(info.m_CachedSize < TEST_BODY_SIZE);
+
+    // and so is a partially cached one, when the If-Range doesn't match
+    server.SetETag("\"3\"");
+    server.ResetCounters();
+    CHECK(BLT_SUCCEEDED(OpenStream(core, url, &stream)));
+    ReadAndCheck(stream, 0, TEST_BODY_SIZE);
+    CHECK(server.GetCondition() == "If-Range: \"2\"");
+    CHECK(server.GetLastStatus() == 200);
+    CHECK(server.GetLastLength() == TEST_BODY_SIZE);
+    ATX_RELEASE_OBJECT(stream);
+    CHECK(NPT_SUCCEEDED(BLT_NetworkCache_Lookup(core, url, info)));
+    CHECK(info.m_Validator == "etag:\"3\"");
+
+    BLT_Core_Destroy(core);
+    RemoveCache();
+    printf("cache: ok\n");
+}
+
+/*----------------------------------------------------------------------
+|    main
++---------------------------------------------------------------------*/
+int
+main(int /*argc*/, char** /*argv*/)
+{
+    TestServer server;
+    server.Start();
+
+    TestPool(server);
+    TestRanges(server);
+    TestCache(server);
+
+    return 0;
+}
@@ -0,0 +1,252 @@
+/*****************************************************************
+|
+|   BlueTune - Limiter Test
+|
+|   (c) 2002-2012 Gilles Boccon-Gibod
+|   Author: Gilles Boccon-Gibod (bok@bok.net)
+|
+****************************************************************/
+
+/*----------------------------------------------------------------------
+|    includes
++---------------------------------------------------------------------*/
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+
+#include "Atomix.h"
+#include "BltConfig.h"
+#include "BltErrors.h"
+#include "BltDecoder.h"
+#include "BltMediaPacket.h"
+#include "BltPacketConsumer.h"
+#include "BltPcm.h"
+#include "BltStream.h"
+#include "BltLimiterFilter.h"
+
+/*----------------------------------------------------------------------
+|    constants
++---------------------------------------------------------------------*/
+#define TEST_FILENAME      "LimiterTest.wav"
+#define TEST_SAMPLE_RATE   44100
+#define TEST_FRAME_COUNT   (2*TEST_SAMPLE_RATE)
+#define TEST_SPIKE_FRAME   (TEST_SAMPLE_RATE/2)
+#define TEST_LEVEL         8192   /* -12 dBFS */
+#define TEST_LOOK_AHEAD    5      /* ms, the default */
+#define TEST_RELEASE       100    /* ms, the default */
+#define TEST_CEILING       0.8913f /* -1 dBTP, the default */
+#define TEST_TOLERANCE     2       /* LSBs, for rounding */
+
+/*----------------------------------------------------------------------
+|    CHECK
++---------------------------------------------------------------------*/
+#define CHECK(x)                                        \
+do {                                                    \
+    if (!(x)) {                                         \
+        fprintf(stderr, "FAILED line %d\n", __LINE__);  \
+        abort();                                        \
+    }                                                   \
+} while(0)
+
+/*----------------------------------------------------------------------
+|    types
++---------------------------------------------------------------------*/
+/* stands in for the audio output: keeps everything it gets */
+typedef struct {
+    /* interfaces */
+    ATX_IMPLEMENTS(BLT_PacketConsumer);
+
+    /* members */
+    BLT_Int16*   samples;
+    unsigned int frame_count;
+    BLT_Boolean  time_stamps_ok;
+} Collector;
+
+/*----------------------------------------------------------------------
+|    Collector_PutPacket
++---------------------------------------------------------------------*/
+BLT_METHOD
+Collector_PutPacket(BLT_PacketConsumer* _self, BLT_MediaPacket* packet)
+{
+    Collector*              self = ATX_SELF(Collector, BLT_PacketConsumer);
+    const BLT_PcmMediaType* media_type;
+    BLT_TimeStamp           time_stamp = BLT_MediaPacket_GetTimeStamp(packet);
+    unsigned int            frames;
+
+    BLT_MediaPacket_GetMediaType(packet, (const BLT_MediaType**)(const void*)&media_type);
+    if (media_type->base.id        != BLT_MEDIA_TYPE_ID_AUDIO_PCM ||
+        media_type->channel_count   != 1                           ||
+        media_type->bits_per_sample != 16) {
+        return BLT_ERROR_INVALID_MEDIA_TYPE;
+    }
+
+    /* the time stamps are those of the audio in the packets */
+    if (time_stamp.seconds || time_stamp.nanoseconds) {
+        ATX_UInt64 expected = ((ATX_UInt64)self->frame_count*1000)/TEST_SAMPLE_RATE;
+        ATX_UInt64 actual   = BLT_TimeStamp_ToMillis(time_stamp);
+        if (actual+1 < expected || actual > expected+1) self->time_stamps_ok = BLT_FALSE;
+    }
+
+    frames = BLT_MediaPacket_GetPayloadSize(packet)/2;
+    if (self->frame_count+frames > TEST_FRAME_COUNT) return BLT_ERROR_OUT_OF_RANGE;
+    ATX_CopyMemory(self->samples+self->frame_count,
+                   BLT_MediaPacket_GetPayloadBuffer(packet),
+                   frames*2);
+    self->frame_count += frames;
+
+    return BLT_SUCCESS;
+}
+
+/*----------------------------------------------------------------------
+|    GetInterface implementation
++---------------------------------------------------------------------*/
+ATX_BEGIN_GET_INTERFACE_IMPLEMENTATION(Collector)
+    ATX_GET_INTERFACE_ACCEPT(Collector, BLT_PacketConsumer)
+ATX_END_GET_INTERFACE_IMPLEMENTATION
+
+/*----------------------------------------------------------------------
+|    BLT_PacketConsumer interface
++---------------------------------------------------------------------*/
+ATX_BEGIN_INTERFACE_MAP(Collector, BLT_PacketConsumer)
+    Collector_PutPacket
+ATX_END_INTERFACE_MAP
+
+/*----------------------------------------------------------------------
+|    WriteLE
++---------------------------------------------------------------------*/
+static void
+WriteLE(FILE* file, unsigned long value, unsigned int size)
+{
+    while (size--) {
+        fputc((int)(value&0xFF), file);
+        value >>= 8;
+    }
+}
+
+/*----------------------------------------------------------------------
+|    WriteTestFile
+|
+|    A constant level, with a single full scale sample in the middle.
++---------------------------------------------------------------------*/
+static void
+WriteTestFile(void)
+{
+    FILE*        file = fopen(TEST_FILENAME, "wb");
+    unsigned int i;
+
+    CHECK(file != NULL);
+    fwrite("RIFF", 1, 4, file);
+    WriteLE(file, 36+TEST_FRAME_COUNT*2, 4);
+    fwrite("WAVEfmt ", 1, 8, file);
+    WriteLE(file, 16, 4);
+    WriteLE(file, 1, 2);                  /* PCM         */
+    WriteLE(file, 1, 2);                  /* mono        */
+    WriteLE(file, TEST_SAMPLE_RATE, 4);
+    WriteLE(file, TEST_SAMPLE_RATE*2, 4); /* byte rate   */
+    WriteLE(file, 2, 2);                  /* block align */
+    WriteLE(file, 16, 2);
+    fwrite("data", 1, 4, file);
+    WriteLE(file, TEST_FRAME_COUNT*2, 4);
+    for (i=0; i<TEST_FRAME_COUNT; i++) {
+        WriteLE(file, i == TEST_SPIKE_FRAME ? 32767 : TEST_LEVEL, 2);
+    }
+    fclose(file);
+}
+
+/*----------------------------------------------------------------------
+|    Gain: the gain applied to a frame of the constant level
++---------------------------------------------------------------------*/
+static float
+Gain(const Collector* collector, unsigned int frame)
+{
+    return (float)collector->samples[frame]/(float)TEST_LEVEL;
+}
+
+/*----------------------------------------------------------------------
+|    main
++---------------------------------------------------------------------*/
+int
+main(int argc, char** argv)
+{
+    BLT_Decoder*      decoder = NULL;
+    BLT_DecoderStatus status;
+    Collector         collector;
+    char              output_name[64];
+    unsigned int      look_ahead = (TEST_LOOK_AHEAD*TEST_SAMPLE_RATE)/1000;
+    unsigned int      release    = (TEST_RELEASE*TEST_SAMPLE_RATE)/1000;
+    unsigned int      i;
+    BLT_Result        result;
+
+    BLT_COMPILER_UNUSED(argc);
+    BLT_COMPILER_UNUSED(argv);
+
+    WriteTestFile();
+
+    memset(&collector, 0, sizeof(collector));
+    collector.samples        = (BLT_Int16*)malloc(TEST_FRAME_COUNT*2);
+    collector.time_stamps_ok = BLT_TRUE;
+    ATX_SET_INTERFACE(&collector, Collector, BLT_PacketConsumer);
+
+    CHECK(BLT_SUCCEEDED(BLT_Decoder_Create(&decoder)));
+    BLT_Decoder_RegisterBuiltins(decoder);
+#if !defined(BLT_CONFIG_MODULES_ENABLE_LIMITER_FILTER)
+    {
+        BLT_Module* module = NULL;
+        CHECK(BLT_SUCCEEDED(BLT_LimiterFilterModule_GetModuleObject(&module)));
+        BLT_Decoder_RegisterModule(decoder, module);
+        ATX_RELEASE_OBJECT(module);
+    }
+#endif
+
+    sprintf(output_name, "callback-output:%lu", (unsigned long)(size_t)&ATX_BASE(&collector, BLT_PacketConsumer));
+    CHECK(BLT_SUCCEEDED(BLT_Decoder_SetOutput(decoder, output_name, "audio/pcm")));
+    CHECK(BLT_SUCCEEDED(BLT_Decoder_SetInput(decoder, TEST_FILENAME, NULL)));
+    CHECK(BLT_SUCCEEDED(BLT_Decoder_AddNodeByName(decoder, NULL, "com.axiosys.filter.limiter")));
+
+    do {
+        result = BLT_Decoder_PumpPacket(decoder);
+    } while (BLT_SUCCEEDED(result));
+    CHECK(result == BLT_ERROR_EOS);
+
+    /* the look-ahead shows in the status */
+    CHECK(BLT_SUCCEEDED(BLT_Decoder_GetStatus(decoder, &status)));
+    CHECK(BLT_TimeStamp_ToMillis(status.latency) >= TEST_LOOK_AHEAD);
+    BLT_Decoder_Destroy(decoder);
+    remove(TEST_FILENAME);
+
+    /* all the audio comes out, in place, with the right time stamps */
+    CHECK(collector.frame_count == TEST_FRAME_COUNT);
+    CHECK(collector.time_stamps_ok);
+
+    /* nothing goes over the ceiling */
+    for (i=0; i<TEST_FRAME_COUNT; i++) {
+        CHECK(collector.samples[i] <= (int)(TEST_CEILING*32768.0f)+TEST_TOLERANCE);
+    }
+
+    /* untouched until the peak enters the look-ahead window */
+    for (i=0; i<TEST_SPIKE_FRAME-2*look_ahead; i++) {
+        CHECK(abs(collector.samples[i]-TEST_LEVEL) <= TEST_TOLERANCE);
+    }
+
+    /* the gain is already down when the peak comes out, and holds while */
+    /* it is in the window                                                */
+    CHECK(Gain(&collector, TEST_SPIKE_FRAME-1) < 0.95f);
+    for (i=TEST_SPIKE_FRAME+1; i<TEST_SPIKE_FRAME+look_ahead/2; i++) {
+        CHECK(Gain(&collector, i) <= TEST_CEILING+0.005f);
+    }
+
+    /* then it is released, slowly: about 1/e of the way after the   */
+    /* release time, and all the way after 10 times the release time */
+    CHECK(Gain(&collector, TEST_SPIKE_FRAME+look_ahead+release/2) < 0.97f);
+    CHECK(Gain(&collector, TEST_SPIKE_FRAME+look_ahead+release)   > 0.93f);
+    CHECK(Gain(&collector, TEST_SPIKE_FRAME+look_ahead+release)   < 0.99f);
+    for (i=TEST_SPIKE_FRAME+look_ahead+10*release; i<TEST_FRAME_COUNT; i++) {
+        CHECK(abs(collector.samples[i]-TEST_LEVEL) <= TEST_TOLERANCE);
+    }
+
+    free(collector.samples);
+
+    printf("LimiterTest passed\n");
+    return 0;
+}
@@ -0,0 +1,150 @@
+/*****************************************************************
+|
+|   BlueTune - Loudness Meter Test
+|
+|   (c) 2002-2012 Gilles Boccon-Gibod
+|   Author: Gilles Boccon-Gibod (bok@bok.net)
+|
+****************************************************************/
+
+/*----------------------------------------------------------------------
+|    includes
++---------------------------------------------------------------------*/
+#include <stdio.h>
+#include <stdlib.h>
+#include <math.h>
+
+#include "Atomix.h"
+#include "BltErrors.h"
+#include "BltPcm.h"
+#include "BltLoudness.h"
+
+/*----------------------------------------------------------------------
+|    constants
++---------------------------------------------------------------------*/
+#define TEST_SAMPLE_RATE 48000
+#define TEST_TOLERANCE   0.1 /* LU, as in EBU Tech 3341 */
+#define TEST_PI          3.14159265358979323846
+
+/*----------------------------------------------------------------------
+|    CHECK
++---------------------------------------------------------------------*/
+#define CHECK(x)                                        \
+do {                                                    \
+    if (!(x)) {                                         \
+        fprintf(stderr, "FAILED line %d\n", __LINE__);  \
+        abort();                                        \
+    }                                                   \
+} while(0)
+
+/*----------------------------------------------------------------------
+|    Tone
+|
+|    Feeds the meter a 1 kHz sine at a level in dBFS, on all the channels,
+|    in odd sized chunks.
++---------------------------------------------------------------------*/
+static void
+Tone(BLT_LoudnessMeter* meter,
+     unsigned int       channel_count,
+     double             level,
+     double             seconds,
+     unsigned int*      phase)
+{
+    float        buffer[1031*BLT_LOUDNESS_METER_MAX_CHANNELS];
+    unsigned int frame_count = (unsigned int)(seconds*TEST_SAMPLE_RATE);
+    double       amplitude   = pow(10.0, level/20.0);
+
+    while (frame_count) {
+        unsigned int chunk = frame_count < 1031 ? frame_count : 1031;
+        unsigned int i;
+        unsigned int c;
+        for (i=0; i<chunk; i++, (*phase)++) {
+            float value = (float)(amplitude*sin(2.0*TEST_PI*1000.0*(double)*phase/TEST_SAMPLE_RATE));
+            for (c=0; c<channel_count; c++) {
+                buffer[i*channel_count+c] = value;
+            }
+        }
+        BLT_LoudnessMeter_Process(meter, buffer, chunk);
+        frame_count -= chunk;
+    }
+}
+
+/*----------------------------------------------------------------------
+|    CheckLoudness
++---------------------------------------------------------------------*/
+static void
+CheckLoudness(const BLT_LoudnessMeter* meter, double expected)
+{
+    double loudness;
+
+    CHECK(BLT_SUCCEEDED(BLT_LoudnessMeter_GetMomentary(meter, &loudness)));
+    CHECK(fabs(loudness-expected) <= TEST_TOLERANCE);
+    CHECK(BLT_SUCCEEDED(BLT_LoudnessMeter_GetShortTerm(meter, &loudness)));
+    CHECK(fabs(loudness-expected) <= TEST_TOLERANCE);
+}
+
+/*----------------------------------------------------------------------
+|    main
++---------------------------------------------------------------------*/
+int
+main(int argc, char** argv)
+{
+    BLT_LoudnessMeter* meter = (BLT_LoudnessMeter*)malloc(sizeof(BLT_LoudnessMeter));
+    unsigned int       phase;
+    double             loudness;
+
+    BLT_COMPILER_UNUSED(argc);
+    BLT_COMPILER_UNUSED(argv);
+
+    /* EBU Tech 3341 test 1 and 2: a stereo tone at -23 and -33 dBFS */
+    CHECK(BLT_SUCCEEDED(BLT_LoudnessMeter_Init(meter, TEST_SAMPLE_RATE, 2, 0)));
+    phase = 0;
+    Tone(meter, 2, -23.0, 20.0, &phase);
+    CheckLoudness(meter, -23.0);
+    CHECK(BLT_SUCCEEDED(BLT_LoudnessMeter_GetIntegrated(meter, &loudness)));
+    CHECK(fabs(loudness+23.0) <= TEST_TOLERANCE);
+    BLT_LoudnessMeter_Reset(meter);
+    Tone(meter, 2, -33.0, 20.0, &phase);
+    CheckLoudness(meter, -33.0);
+    CHECK(BLT_SUCCEEDED(BLT_LoudnessMeter_GetIntegrated(meter, &loudness)));
+    CHECK(fabs(loudness+33.0) <= TEST_TOLERANCE);
+
+    /* test 3 and 4: the gates leave out the quiet and silent parts */
+    BLT_LoudnessMeter_Reset(meter);
+    Tone(meter, 2, -36.0, 10.0, &phase);
+    Tone(meter, 2, -23.0, 60.0, &phase);
+    Tone(meter, 2, -36.0, 10.0, &phase);
+    CHECK(BLT_SUCCEEDED(BLT_LoudnessMeter_GetIntegrated(meter, &loudness)));
+    CHECK(fabs(loudness+23.0) <= TEST_TOLERANCE);
+    BLT_LoudnessMeter_Reset(meter);
+    Tone(meter, 2, -72.0, 10.0, &phase);
+    Tone(meter, 2, -36.0, 10.0, &phase);
+    Tone(meter, 2, -23.0, 60.0, &phase);
+    Tone(meter, 2, -36.0, 10.0, &phase);
+    Tone(meter, 2, -72.0, 10.0, &phase);
+    CHECK(BLT_SUCCEEDED(BLT_LoudnessMeter_GetIntegrated(meter, &loudness)));
+    CHECK(fabs(loudness+23.0) <= TEST_TOLERANCE);
+
+    /* the true peak of a tone is its amplitude */
+    CHECK(fabs(20.0*log10(BLT_LoudnessMeter_GetTruePeak(meter))+23.0) <= TEST_TOLERANCE);
+
+    /* mono, and 3 channels (left, right and center), which adds up */
+    /* the channels one at a time and two at a time                 */
+    CHECK(BLT_SUCCEEDED(BLT_LoudnessMeter_Init(meter, TEST_SAMPLE_RATE, 1, 0)));
+    Tone(meter, 1, -23.0, 5.0, &phase);
+    CheckLoudness(meter, -23.0-10.0*log10(2.0));
+    CHECK(BLT_SUCCEEDED(BLT_LoudnessMeter_Init(meter, TEST_SAMPLE_RATE, 3, 0)));
+    Tone(meter, 3, -23.0, 5.0, &phase);
+    CheckLoudness(meter, -23.0+10.0*log10(1.5));
+
+    /* 5.1: the LFE channel does not count, the surround ones count */
+    /* for 1.5 dB more. Here, L+R+C+1.41*(Ls+Rs) = 5.83 times mono   */
+    CHECK(BLT_SUCCEEDED(BLT_LoudnessMeter_Init(meter, TEST_SAMPLE_RATE, 6, 0)));
+    Tone(meter, 6, -23.0, 5.0, &phase);
+    CheckLoudness(meter, -23.0-10.0*log10(2.0)+10.0*log10(3.0+2.0*1.41253754462275));
+
+    free(meter);
+
+    printf("LoudnessTest passed\n");
+    return 0;
+}
@@ -14,7 +14,10 @@
 #include <stdlib.h>
 
 #include "Atomix.h"
+#include "BltCore.h"
+#include "BltStream.h"
 #include "BltNetworkStream.h"
+#include "BltNetworkInputSource.h"
 
 /*----------------------------------------------------------------------
 |    CHECK
@@ -109,6 +112,251 @@ Test(int buffer_size, int source_size)
 }
 #endif
 
+/*----------------------------------------------------------------------
+|    constants
++---------------------------------------------------------------------*/
+#define TRICKLE_CHUNK_SIZE      1024
+#define TEST_BUFFER_SIZE        65536
+#define TEST_MIN_BUFFER_SIZE    16384
+#define TEST_MAX_BUFFER_SIZE    1048576
+#define TEST_NOMINAL_BITRATE    1000000     /* 125000 bytes per second  */
+#define TEST_DURATION           1200000000  /* 1.2 seconds, two windows */
+
+/*----------------------------------------------------------------------
+|    TrickleSource
+|
+|    An endless source that returns at most TRICKLE_CHUNK_SIZE bytes per
+|    read, so that the buffer never fills up when it is read from as fast
+|    as it is filled.
++---------------------------------------------------------------------*/
+typedef struct {
+    /* interfaces */
+    ATX_IMPLEMENTS(ATX_InputStream);
+    ATX_IMPLEMENTS(ATX_Referenceable);
+
+    /* members */
+    ATX_Cardinal reference_count;
+    ATX_Position position;
+} TrickleSource;
+
+static void
+TrickleSource_Destroy(TrickleSource* self)
+{
+    ATX_FreeMemory(self);
+}
+
+ATX_METHOD
+TrickleSource_Read(ATX_InputStream* _self,
+                   ATX_Any          buffer,
+                   ATX_Size         bytes_to_read,
+                   ATX_Size*        bytes_read)
+{
+    TrickleSource* self = ATX_SELF(TrickleSource, ATX_InputStream);
+    ATX_Size       i;
+
+    if (bytes_to_read > TRICKLE_CHUNK_SIZE) bytes_to_read = TRICKLE_CHUNK_SIZE;
+    for (i=0; i<bytes_to_read; i++) {
+        ((unsigned char*)buffer)[i] = (unsigned char)(self->position+i);
+    }
+    self->position += bytes_to_read;
+    if (bytes_read) *bytes_read = bytes_to_read;
+
+    return ATX_SUCCESS;
+}
+
+ATX_METHOD
+TrickleSource_Seek(ATX_InputStream* _self, ATX_Position position)
+{
+    (void)_self;
+    (void)position;
+    return ATX_ERROR_NOT_SUPPORTED;
+}
+
+ATX_METHOD
+TrickleSource_Tell(ATX_InputStream* _self, ATX_Position* position)
+{
+    TrickleSource* self = ATX_SELF(TrickleSource, ATX_InputStream);
+    *position = self->position;
+    return ATX_SUCCESS;
+}
+
+ATX_METHOD
+TrickleSource_GetSize(ATX_InputStream* _self, ATX_LargeSize* size)
+{
+    (void)_self;
+    *size = 0;
+    return ATX_SUCCESS;
+}
+
+ATX_METHOD
+TrickleSource_GetAvailable(ATX_InputStream* _self, ATX_LargeSize* available)
+{
+    (void)_self;
+    *available = TRICKLE_CHUNK_SIZE;
+    return ATX_SUCCESS;
+}
+
+ATX_BEGIN_GET_INTERFACE_IMPLEMENTATION(TrickleSource)
+    ATX_GET_INTERFACE_ACCEPT(TrickleSource, ATX_InputStream)
+    ATX_GET_INTERFACE_ACCEPT(TrickleSource, ATX_Referenceable)
+ATX_END_GET_INTERFACE_IMPLEMENTATION
+
+ATX_BEGIN_INTERFACE_MAP(TrickleSource, ATX_InputStream)
+    TrickleSource_Read,
+    TrickleSource_Seek,
+    TrickleSource_Tell,
+    TrickleSource_GetSize,
+    TrickleSource_GetAvailable
+ATX_END_INTERFACE_MAP
+
+ATX_IMPLEMENT_REFERENCEABLE_INTERFACE(TrickleSource, reference_count)
+
+static ATX_InputStream*
+TrickleSource_Create(void)
+{
+    TrickleSource* self = (TrickleSource*)ATX_AllocateZeroMemory(sizeof(TrickleSource));
+    self->reference_count = 1;
+    ATX_SET_INTERFACE(self, TrickleSource, ATX_InputStream);
+    ATX_SET_INTERFACE(self, TrickleSource, ATX_Referenceable);
+    return &ATX_BASE(self, ATX_InputStream);
+}
+
+/*----------------------------------------------------------------------
+|    stream info spy
+|
+|    Replaces the GetInfo method of a stream, to check that the network
+|    stream only asks for the stream info from its read path (the fill
+|    path may run on the thread of a network queue).
++---------------------------------------------------------------------*/
+static BLT_StreamInterface SpyStreamInterface;
+static const BLT_StreamInterface* SpyBaseInterface = NULL;
+static unsigned int        SpyGetInfoCalls = 0;
+static ATX_Boolean         SpyFilling = ATX_FALSE;
+
+static BLT_Result
+SpyStream_GetInfo(BLT_Stream* self, BLT_StreamInfo* info)
+{
+    CHECK(!SpyFilling);
+    ++SpyGetInfoCalls;
+    return SpyBaseInterface->GetInfo(self, info);
+}
+
+/*----------------------------------------------------------------------
+|    GetTime
++---------------------------------------------------------------------*/
+static ATX_Int64
+GetTime(void)
+{
+    ATX_TimeStamp now;
+    ATX_Int64     now_int = 0;
+
+    ATX_System_GetCurrentTimeStamp(&now);
+    ATX_TimeStamp_ToInt64(now, now_int);
+
+    return now_int;
+}
+
+/*----------------------------------------------------------------------
+|    RunAdaptiveStream
+|
+|    Reads from an adaptive network stream for TEST_DURATION, while
+|    also filling it through the BLT_BufferedNetworkStream interface,
+|    as a network queue does.
++---------------------------------------------------------------------*/
+static void
+RunAdaptiveStream(BLT_Stream* context, BLT_BufferedNetworkStreamStatus* status)
+{
+    ATX_InputStream*           source = TrickleSource_Create();
+    BLT_NetworkStream*         network_stream = NULL;
+    ATX_InputStream*           stream;
+    BLT_NetworkInputSource*    input_source;
+    BLT_BufferedNetworkStream* buffered;
+    ATX_TimeInterval           pause = {0, 1000000}; /* 1 ms */
+    ATX_Int64                  start;
+    unsigned char              scratch[2*TRICKLE_CHUNK_SIZE];
+    int                        i;
+
+    CHECK(BLT_SUCCEEDED(BLT_NetworkStream_Create(TEST_BUFFER_SIZE, 0, source, &network_stream)));
+    CHECK(BLT_SUCCEEDED(BLT_NetworkStream_SetBufferBounds(network_stream, 
+                                                          TEST_MIN_BUFFER_SIZE, 
+                                                          TEST_MAX_BUFFER_SIZE)));
+    stream = BLT_NetworkStream_GetInputStream(network_stream);
+    BLT_NetworkStream_Release(network_stream);
+    ATX_RELEASE_OBJECT(source);
+    input_source = ATX_CAST(stream, BLT_NetworkInputSource);
+    buffered     = ATX_CAST(stream, BLT_BufferedNetworkStream);
+    CHECK(input_source != NULL && buffered != NULL);
+    if (context) BLT_NetworkInputSource_Attach(input_source, context);
+
+    /* filling alone, before anything is read */
+    SpyFilling = ATX_TRUE;
+    for (i=0; i<10; i++) {
+        CHECK(BLT_SUCCEEDED(BLT_BufferedNetworkStream_FillBuffer(buffered)));
+    }
+    SpyFilling = ATX_FALSE;
+
+    /* read as fast as the source delivers */
+    start = GetTime();
+    while (GetTime()-start < TEST_DURATION) {
+        ATX_Size bytes_read = 0;
+        CHECK(ATX_SUCCEEDED(ATX_InputStream_Read(stream, scratch, sizeof(scratch), &bytes_read)));
+        SpyFilling = ATX_TRUE;
+        CHECK(BLT_SUCCEEDED(BLT_BufferedNetworkStream_FillBuffer(buffered)));
+        SpyFilling = ATX_FALSE;
+        ATX_System_Sleep(&pause);
+    }
+    BLT_BufferedNetworkStream_GetStatus(buffered, status);
+    printf("byte rate: size=%d, target=%d, bandwidth=%d, jitter=%d\n",
+           status->buffer_size, status->buffer_target, status->bandwidth, status->jitter);
+
+    if (context) BLT_NetworkInputSource_Detach(input_source);
+    ATX_RELEASE_OBJECT(stream);
+}
+
+/*----------------------------------------------------------------------
+|    TestByteRate
++---------------------------------------------------------------------*/
+static void
+TestByteRate(void)
+{
+    BLT_Core*                       core = NULL;
+    BLT_Stream*                     context = NULL;
+    BLT_StreamInfo                  info;
+    BLT_BufferedNetworkStreamStatus status;
+
+    CHECK(BLT_SUCCEEDED(BLT_Core_Create(&core)));
+    CHECK(BLT_SUCCEEDED(BLT_Core_CreateStream(core, &context)));
+    ATX_SetMemory(&info, 0, sizeof(info));
+    info.mask            = BLT_STREAM_INFO_MASK_NOMINAL_BITRATE;
+    info.nominal_bitrate = TEST_NOMINAL_BITRATE;
+    BLT_Stream_SetInfo(context, &info);
+
+    /* without a stream, the byte rate is not known: no adaptation */
+    RunAdaptiveStream(NULL, &status);
+    CHECK(status.bandwidth != 0);
+    CHECK(status.buffer_size   == TEST_BUFFER_SIZE);
+    CHECK(status.buffer_target == TEST_BUFFER_SIZE);
+
+    /* with one, the byte rate is taken from its info, on the read path */
+    SpyBaseInterface   = context->iface;
+    SpyStreamInterface = *SpyBaseInterface;
+    SpyStreamInterface.GetInfo = SpyStream_GetInfo;
+    context->iface = &SpyStreamInterface;
+    RunAdaptiveStream(context, &status);
+    context->iface = SpyBaseInterface;
+    CHECK(SpyGetInfoCalls != 0);
+    CHECK(status.bandwidth != 0);
+
+    /* it covers at least two seconds of media, at the nominal rate */
+    CHECK(status.buffer_target >= 2*TEST_NOMINAL_BITRATE/8);
+    CHECK(status.buffer_target <= TEST_MAX_BUFFER_SIZE);
+    CHECK(status.buffer_size   >= 2*TEST_NOMINAL_BITRATE/8);
+
+    ATX_RELEASE_OBJECT(context);
+    BLT_Core_Destroy(core);
+    printf("byte rate: ok\n");
+}
+
 #if defined(_DEBUG)
 #include <crtdbg.h>
 #endif
@@ -143,5 +391,7 @@ main(int argc, char** argv)
     }
 #endif
 
+    TestByteRate();
+
     return 0;
 }
\ No newline at end of file
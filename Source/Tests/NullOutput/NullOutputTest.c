@@ -0,0 +1,298 @@
+/*****************************************************************
+|
+|   BlueTune - Null Output Test
+|
+|   (c) 2002-2012 Gilles Boccon-Gibod
+|   Author: Gilles Boccon-Gibod (bok@bok.net)
+|
+****************************************************************/
+
+/*----------------------------------------------------------------------
+|    includes
++---------------------------------------------------------------------*/
+#include <stdio.h>
+#include <stdlib.h>
+
+#include "Atomix.h"
+#include "BltConfig.h"
+#include "BltErrors.h"
+#include "BltDecoder.h"
+#include "BltOutputNode.h"
+#include "BltNullOutput.h"
+#include "TestUtils.h"
+
+/*----------------------------------------------------------------------
+|    constants
++---------------------------------------------------------------------*/
+#define TEST_FILENAME      "NullOutputTest.wav"
+#define TEST_SAMPLE_RATE   44100
+#define TEST_CHANNEL_COUNT 2
+#define TEST_FRAME_COUNT   TEST_SAMPLE_RATE /* 1000 ms */
+#define TEST_DURATION      1000             /* ms */
+#define TEST_BUFFER_TIME   200              /* ms */
+#define TEST_TOLERANCE     50               /* ms, scheduling jitter   */
+#define TEST_MAX_OVERSHOOT 500              /* ms, for a loaded machine */
+#define TEST_STOP_PUMPS    10
+
+/*----------------------------------------------------------------------
+|    CHECK
++---------------------------------------------------------------------*/
+#define CHECK(x)                                        \
+do {                                                    \
+    if (!(x)) {                                         \
+        fprintf(stderr, "FAILED line %d\n", __LINE__);  \
+        abort();                                        \
+    }                                                   \
+} while(0)
+
+/*----------------------------------------------------------------------
+|    GetTime: in milliseconds
++---------------------------------------------------------------------*/
+static ATX_Int64
+GetTime(void)
+{
+    ATX_TimeStamp now;
+    ATX_Int64     now_int = 0;
+
+    ATX_System_GetCurrentTimeStamp(&now);
+    ATX_TimeStamp_ToInt64(now, now_int);
+
+    return now_int/1000000;
+}
+
+/*----------------------------------------------------------------------
+|    WriteTestFile
++---------------------------------------------------------------------*/
+static void
+WriteTestFile(void)
+{
+    BLT_Int16*   samples = (BLT_Int16*)malloc(TEST_FRAME_COUNT*TEST_CHANNEL_COUNT*sizeof(BLT_Int16));
+    unsigned int seed = 1;
+    unsigned int i;
+
+    for (i=0; i<TEST_FRAME_COUNT*TEST_CHANNEL_COUNT; i++) {
+        samples[i] = (BLT_Int16)TestUtils_Random(&seed);
+    }
+    CHECK(BLT_SUCCEEDED(TestUtils_WriteWavFile(TEST_FILENAME, samples, TEST_FRAME_COUNT,
+                                               TEST_CHANNEL_COUNT, TEST_SAMPLE_RATE)));
+    free(samples);
+}
+
+/*----------------------------------------------------------------------
+|    GetProperty
++---------------------------------------------------------------------*/
+static BLT_Result
+GetProperty(BLT_Decoder* decoder, const char* name, ATX_PropertyValue* value)
+{
+    ATX_Properties* properties = NULL;
+
+    CHECK(BLT_SUCCEEDED(BLT_Decoder_GetStreamProperties(decoder, &properties)));
+    return ATX_Properties_GetProperty(properties, name, value);
+}
+
+/*----------------------------------------------------------------------
+|    GetIntegerProperty
++---------------------------------------------------------------------*/
+static int
+GetIntegerProperty(BLT_Decoder* decoder, const char* name)
+{
+    ATX_PropertyValue value;
+
+    CHECK(ATX_SUCCEEDED(GetProperty(decoder, name, &value)));
+    CHECK(value.type == ATX_PROPERTY_VALUE_TYPE_INTEGER);
+
+    return value.data.integer;
+}
+
+/*----------------------------------------------------------------------
+|    GetSpeed
++---------------------------------------------------------------------*/
+static float
+GetSpeed(BLT_Decoder* decoder)
+{
+    ATX_PropertyValue value;
+
+    CHECK(ATX_SUCCEEDED(GetProperty(decoder, BLT_NULL_OUTPUT_SPEED_PROPERTY, &value)));
+    CHECK(value.type == ATX_PROPERTY_VALUE_TYPE_FLOAT);
+
+    return value.data.fp;
+}
+
+/*----------------------------------------------------------------------
+|    GetOutputTime: media time of the frame being heard, in ms
++---------------------------------------------------------------------*/
+static ATX_Int64
+GetOutputTime(BLT_Decoder* decoder)
+{
+    BLT_MediaNode*       node = NULL;
+    BLT_OutputNode*      output;
+    BLT_OutputNodeStatus status;
+
+    CHECK(BLT_SUCCEEDED(BLT_Decoder_GetOutputNode(decoder, &node)));
+    output = ATX_CAST(node, BLT_OutputNode);
+    CHECK(output != NULL);
+    CHECK(BLT_SUCCEEDED(BLT_OutputNode_GetStatus(output, &status)));
+    ATX_RELEASE_OBJECT(node);
+
+    return (ATX_Int64)BLT_TimeStamp_ToMillis(status.media_time);
+}
+
+/*----------------------------------------------------------------------
+|    CheckCounters
+|
+|    The counters that do not depend on the mode, once the whole file
+|    has gone through.
++---------------------------------------------------------------------*/
+static void
+CheckCounters(BLT_Decoder* decoder)
+{
+    CHECK(GetIntegerProperty(decoder, BLT_NULL_OUTPUT_PACKETS_PROPERTY) > 0);
+    CHECK(GetIntegerProperty(decoder, BLT_NULL_OUTPUT_FRAMES_PROPERTY) == TEST_FRAME_COUNT);
+    CHECK(GetIntegerProperty(decoder, BLT_NULL_OUTPUT_KILOBYTES_PROPERTY) ==
+          TEST_FRAME_COUNT*TEST_CHANNEL_COUNT*2/1024);
+}
+
+/*----------------------------------------------------------------------
+|    TestPaced
+|
+|    The output consumes the audio at its sample rate: pumping stops
+|    being ahead of the device by more than its buffer, and draining
+|    returns once everything has been played, not before.
++---------------------------------------------------------------------*/
+static void
+TestPaced(BLT_Decoder* decoder)
+{
+    ATX_Int64 start;
+    ATX_Int64 pumped;
+    ATX_Int64 drained;
+    int       max_latency;
+    float     speed;
+
+    CHECK(BLT_SUCCEEDED(BLT_Decoder_SetOutput(decoder, "null:paced", "audio/pcm")));
+    CHECK(BLT_SUCCEEDED(BLT_Decoder_SetInput(decoder, TEST_FILENAME, NULL)));
+
+    start = GetTime();
+    CHECK(TestUtils_PumpToEnd(decoder) == BLT_ERROR_EOS);
+    pumped = GetTime()-start;
+    CHECK(BLT_SUCCEEDED(BLT_Decoder_Drain(decoder)));
+    drained = GetTime()-start;
+
+    /* the counters are published by the drain */
+    CheckCounters(decoder);
+    max_latency = GetIntegerProperty(decoder, BLT_NULL_OUTPUT_MAX_LATENCY_PROPERTY);
+    CHECK(max_latency > 0);
+    CHECK(max_latency <= 2*TEST_BUFFER_TIME); /* the capacity is rounded up to a power of 2 */
+    /* a busy machine may starve the device, but not for long */
+    GetIntegerProperty(decoder, BLT_NULL_OUTPUT_UNDERRUNS_PROPERTY);
+    CHECK(GetIntegerProperty(decoder, BLT_NULL_OUTPUT_UNDERRUN_TIME_PROPERTY) <= TEST_TOLERANCE);
+    CHECK(GetIntegerProperty(decoder, BLT_NULL_OUTPUT_WALL_TIME_PROPERTY) <= pumped+TEST_TOLERANCE);
+
+    /* the writes blocked once the buffer was full */
+    CHECK(pumped >= TEST_DURATION-max_latency-TEST_TOLERANCE);
+
+    /* the drain waited for the device to play the rest */
+    CHECK(drained >= TEST_DURATION-TEST_TOLERANCE);
+    CHECK(drained <= TEST_DURATION+TEST_MAX_OVERSHOOT);
+    CHECK(GetOutputTime(decoder) >= TEST_DURATION-1);
+
+    /* media time over the time it took to get all the packets, which */
+    /* is a little more than 1 since the last ones stay in the buffer */
+    speed = GetSpeed(decoder);
+    CHECK(speed > 0.5f);
+    CHECK(speed < (float)TEST_DURATION/(float)(TEST_DURATION-2*TEST_BUFFER_TIME-TEST_TOLERANCE));
+}
+
+/*----------------------------------------------------------------------
+|    TestUnpaced
+|
+|    Without pacing, the packets go through as fast as they come, and
+|    there is no simulated device to report on.
++---------------------------------------------------------------------*/
+static void
+TestUnpaced(BLT_Decoder* decoder)
+{
+    ATX_PropertyValue value;
+    ATX_Int64         start;
+
+    CHECK(BLT_SUCCEEDED(BLT_Decoder_SetOutput(decoder, "null:unpaced", "audio/pcm")));
+    CHECK(BLT_SUCCEEDED(BLT_Decoder_SetInput(decoder, TEST_FILENAME, NULL)));
+
+    start = GetTime();
+    CHECK(TestUtils_PumpToEnd(decoder) == BLT_ERROR_EOS);
+    CHECK(BLT_SUCCEEDED(BLT_Decoder_Drain(decoder)));
+    CHECK(GetTime()-start < TEST_DURATION/2);
+
+    CheckCounters(decoder);
+    CHECK(ATX_FAILED(GetProperty(decoder, BLT_NULL_OUTPUT_UNDERRUNS_PROPERTY, &value)));
+    CHECK(ATX_FAILED(GetProperty(decoder, BLT_NULL_OUTPUT_MAX_LATENCY_PROPERTY, &value)));
+}
+
+/*----------------------------------------------------------------------
+|    TestStop
+|
+|    Stopping drops what the device has not played, without waiting,
+|    and publishes the counters so far.
++---------------------------------------------------------------------*/
+static void
+TestStop(BLT_Decoder* decoder)
+{
+    ATX_PropertyValue value;
+    ATX_Int64         start;
+    unsigned int      i;
+    int               frames;
+
+    CHECK(BLT_SUCCEEDED(BLT_Decoder_SetOutput(decoder, "null:paced", "audio/pcm")));
+    CHECK(BLT_SUCCEEDED(BLT_Decoder_SetInput(decoder, TEST_FILENAME, NULL)));
+    for (i=0; i<TEST_STOP_PUMPS; i++) {
+        CHECK(BLT_SUCCEEDED(BLT_Decoder_PumpPacket(decoder)));
+    }
+
+    /* nothing is published before a second has passed */
+    CHECK(ATX_FAILED(GetProperty(decoder, BLT_NULL_OUTPUT_PACKETS_PROPERTY, &value)));
+
+    start = GetTime();
+    CHECK(BLT_SUCCEEDED(BLT_Decoder_Stop(decoder)));
+    CHECK(GetTime()-start < TEST_TOLERANCE);
+
+    CHECK(GetIntegerProperty(decoder, BLT_NULL_OUTPUT_PACKETS_PROPERTY) > 0);
+    CHECK(GetIntegerProperty(decoder, BLT_NULL_OUTPUT_PACKETS_PROPERTY) <= TEST_STOP_PUMPS);
+    frames = GetIntegerProperty(decoder, BLT_NULL_OUTPUT_FRAMES_PROPERTY);
+    CHECK(frames > 0 && frames < TEST_FRAME_COUNT);
+    CHECK(GetIntegerProperty(decoder, BLT_NULL_OUTPUT_KILOBYTES_PROPERTY) ==
+          frames*TEST_CHANNEL_COUNT*2/1024);
+}
+
+/*----------------------------------------------------------------------
+|    main
++---------------------------------------------------------------------*/
+int
+main(int argc, char** argv)
+{
+    BLT_Decoder*      decoder = NULL;
+    ATX_Properties*   properties = NULL;
+    ATX_PropertyValue value;
+
+    BLT_COMPILER_UNUSED(argc);
+    BLT_COMPILER_UNUSED(argv);
+
+    WriteTestFile();
+
+    CHECK(BLT_SUCCEEDED(BLT_Decoder_Create(&decoder)));
+    BLT_Decoder_RegisterBuiltins(decoder);
+
+    /* a small device buffer, read when the outputs are activated */
+    CHECK(BLT_SUCCEEDED(BLT_Decoder_GetProperties(decoder, &properties)));
+    value.type         = ATX_PROPERTY_VALUE_TYPE_INTEGER;
+    value.data.integer = TEST_BUFFER_TIME;
+    CHECK(ATX_SUCCEEDED(ATX_Properties_SetProperty(properties, BLT_NULL_OUTPUT_BUFFER_TIME, &value)));
+
+    TestPaced(decoder);
+    TestUnpaced(decoder);
+    TestStop(decoder);
+
+    BLT_Decoder_Destroy(decoder);
+    remove(TEST_FILENAME);
+
+    printf("NullOutputTest passed\n");
+    return 0;
+}
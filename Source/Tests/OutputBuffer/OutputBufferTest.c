@@ -0,0 +1,334 @@
+/*****************************************************************
+|
+|   BlueTune - Output Buffer Test
+|
+|   (c) 2002-2012 Gilles Boccon-Gibod
+|   Author: Gilles Boccon-Gibod (bok@bok.net)
+|
+****************************************************************/
+
+/*----------------------------------------------------------------------
+|    includes
++---------------------------------------------------------------------*/
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "Atomix.h"
+#include "BltConfig.h"
+#include "BltErrors.h"
+#include "BltOutputBuffer.h"
+
+/*----------------------------------------------------------------------
+|    constants
++---------------------------------------------------------------------*/
+#define TEST_SAMPLE_RATE   48000
+#define TEST_CHANNEL_COUNT 2
+#define TEST_MS            (TEST_SAMPLE_RATE/1000) /* frames in 1 ms */
+#define TEST_NANOS_PER_MS  1000000
+#define TEST_START_TIME    ((ATX_Int64)1000000000) /* simulated clock */
+
+/*----------------------------------------------------------------------
+|    CHECK
++---------------------------------------------------------------------*/
+#define CHECK(x)                                        \
+do {                                                    \
+    if (!(x)) {                                         \
+        fprintf(stderr, "FAILED line %d\n", __LINE__);  \
+        abort();                                        \
+    }                                                   \
+} while(0)
+
+/*----------------------------------------------------------------------
+|    CreateBuffer: 16 bit stereo
++---------------------------------------------------------------------*/
+static BLT_OutputBuffer*
+CreateBuffer(BLT_Cardinal capacity)
+{
+    BLT_OutputBuffer* buffer = NULL;
+    BLT_PcmMediaType  format;
+
+    BLT_PcmMediaType_Init(&format);
+    format.sample_rate     = TEST_SAMPLE_RATE;
+    format.channel_count   = TEST_CHANNEL_COUNT;
+    format.bits_per_sample = 16;
+    format.sample_format   = BLT_PCM_SAMPLE_FORMAT_SIGNED_INT_NE;
+    CHECK(BLT_SUCCEEDED(BLT_OutputBuffer_Create(capacity, 0, &buffer)));
+    CHECK(BLT_SUCCEEDED(BLT_OutputBuffer_SetFormat(buffer, &format)));
+
+    return buffer;
+}
+
+/*----------------------------------------------------------------------
+|    Fill: frames numbered from 'first', the same number on both channels
++---------------------------------------------------------------------*/
+static void
+Fill(short* frames, unsigned int first, unsigned int frame_count)
+{
+    unsigned int i;
+
+    for (i=0; i<frame_count; i++) {
+        frames[i*TEST_CHANNEL_COUNT]   = (short)(first+i);
+        frames[i*TEST_CHANNEL_COUNT+1] = (short)(first+i);
+    }
+}
+
+/*----------------------------------------------------------------------
+|    GetMediaTime: in ms, at a time in ms after the start of the clock
++---------------------------------------------------------------------*/
+static ATX_UInt64
+GetMediaTime(BLT_OutputBuffer* buffer, unsigned int now, BLT_Flags* flags)
+{
+    BLT_OutputNodeStatus status;
+    ATX_UInt64           nanos;
+
+    BLT_OutputBuffer_GetStatus(buffer, TEST_START_TIME+(ATX_Int64)now*TEST_NANOS_PER_MS, &status);
+    nanos = BLT_TimeStamp_ToNanos(status.media_time);
+    CHECK(nanos%TEST_NANOS_PER_MS == 0);
+    if (flags) *flags = status.flags;
+
+    return nanos/TEST_NANOS_PER_MS;
+}
+
+/*----------------------------------------------------------------------
+|    GetFlags
++---------------------------------------------------------------------*/
+static BLT_Flags
+GetFlags(BLT_OutputBuffer* buffer)
+{
+    BLT_OutputNodeStatus status;
+
+    BLT_OutputBuffer_GetStatus(buffer, TEST_START_TIME, &status);
+    return status.flags;
+}
+
+/*----------------------------------------------------------------------
+|    TestData
+|
+|    Frames come out in the order they went in, across the wrap around,
+|    whatever the sizes of the writes and the reads.
++---------------------------------------------------------------------*/
+static void
+TestData(void)
+{
+    BLT_OutputBuffer*     buffer  = CreateBuffer(1000);
+    short*                frames  = (short*)malloc(4096*TEST_CHANNEL_COUNT*sizeof(short));
+    unsigned int          written = 0;
+    unsigned int          read    = 0;
+    unsigned int          chunk   = 1;
+    BLT_OutputBufferStats stats;
+    unsigned int          i;
+
+    CHECK(BLT_OutputBuffer_GetCapacity(buffer) == 1024);
+    while (read < 100000) {
+        BLT_Cardinal count;
+
+        Fill(frames, written, chunk);
+        written += BLT_OutputBuffer_Write(buffer, frames, chunk);
+        CHECK(BLT_OutputBuffer_GetFill(buffer) == written-read);
+
+        chunk = (chunk*7+3)%1031;
+        count = BLT_OutputBuffer_Read(buffer, frames, chunk, BLT_FALSE);
+        CHECK(count <= chunk);
+        for (i=0; i<count; i++) {
+            CHECK(frames[i*TEST_CHANNEL_COUNT]   == (short)(read+i));
+            CHECK(frames[i*TEST_CHANNEL_COUNT+1] == (short)(read+i));
+        }
+        read += count;
+        chunk = (chunk*5+1)%1033;
+    }
+
+    /* a full buffer takes what fits, and that alone is not an overrun */
+    Fill(frames, written, 2000);
+    CHECK(BLT_OutputBuffer_Write(buffer, frames, 2000) == 1024-(written-read));
+    CHECK(BLT_OutputBuffer_Write(buffer, frames, 1) == 0);
+    CHECK(BLT_OutputBuffer_GetFill(buffer) == 1024);
+    BLT_OutputBuffer_GetStats(buffer, &stats);
+    CHECK(stats.overruns == 0);
+    CHECK(stats.max_fill == 1024);
+    CHECK(stats.frames_written == (BLT_UInt64)read+1024);
+    CHECK(stats.frames_read == read);
+
+    free(frames);
+    BLT_OutputBuffer_Destroy(buffer);
+}
+
+/*----------------------------------------------------------------------
+|    TestClock
+|
+|    The media time is the one of the frame being heard: what was
+|    written, less what is in the buffer and in the device, which keeps
+|    playing after it measured its delay.
++---------------------------------------------------------------------*/
+static void
+TestClock(void)
+{
+    BLT_OutputBuffer* buffer = CreateBuffer(128*TEST_MS);
+    short*            frames = (short*)calloc(200*TEST_MS*TEST_CHANNEL_COUNT, sizeof(short));
+    BLT_Flags         flags;
+
+    /* nothing played yet */
+    BLT_OutputBuffer_SetMediaTime(buffer, BLT_TimeStamp_FromNanos((ATX_UInt64)10000*TEST_NANOS_PER_MS));
+    CHECK(GetMediaTime(buffer, 0, &flags) == 10000);
+    CHECK(flags == 0);
+
+    /* 100 ms written, 50 ms read, of which 20 ms not heard yet */
+    CHECK(BLT_OutputBuffer_Write(buffer, frames, 100*TEST_MS) == 100*TEST_MS);
+    CHECK(GetMediaTime(buffer, 0, NULL) == 10000);
+    CHECK(BLT_OutputBuffer_Read(buffer, frames, 50*TEST_MS, BLT_TRUE) == 50*TEST_MS);
+    BLT_OutputBuffer_SetDeviceDelay(buffer, 20*TEST_MS, TEST_START_TIME, BLT_TRUE);
+    CHECK(GetMediaTime(buffer, 0, NULL) == 10030);
+
+    /* the device goes on playing what it has, and no more */
+    CHECK(GetMediaTime(buffer, 5,    NULL) == 10035);
+    CHECK(GetMediaTime(buffer, 20,   NULL) == 10050);
+    CHECK(GetMediaTime(buffer, 1000, NULL) == 10050);
+
+    /* a stopped device does not */
+    BLT_OutputBuffer_SetDeviceDelay(buffer, 20*TEST_MS, TEST_START_TIME, BLT_FALSE);
+    CHECK(GetMediaTime(buffer, 1000, NULL) == 10030);
+
+    /* a new media time applies from the next frame written */
+    BLT_OutputBuffer_SetMediaTime(buffer, BLT_TimeStamp_FromNanos((ATX_UInt64)20000*TEST_NANOS_PER_MS));
+    CHECK(BLT_OutputBuffer_Write(buffer, frames, 100*TEST_MS) == 100*TEST_MS);
+    CHECK(GetMediaTime(buffer, 0, &flags) == 20000);
+    CHECK(flags == BLT_OUTPUT_NODE_STATUS_QUEUE_FULL);
+    CHECK(BLT_OutputBuffer_Read(buffer, frames, 100*TEST_MS, BLT_TRUE) == 100*TEST_MS);
+    BLT_OutputBuffer_SetDeviceDelay(buffer, 0, TEST_START_TIME, BLT_TRUE);
+    CHECK(GetMediaTime(buffer, 0, &flags) == 20050);
+    CHECK(flags == 0);
+
+    /* after a reset, the frames written next follow on from the dropped ones */
+    BLT_OutputBuffer_Reset(buffer);
+    CHECK(BLT_OutputBuffer_GetFill(buffer) == 0);
+    CHECK(GetMediaTime(buffer, 0, NULL) == 20100);
+    CHECK(BLT_OutputBuffer_Write(buffer, frames, 10*TEST_MS) == 10*TEST_MS);
+    CHECK(BLT_OutputBuffer_Read(buffer, frames, 10*TEST_MS, BLT_TRUE) == 10*TEST_MS);
+    CHECK(GetMediaTime(buffer, 0, NULL) == 20110);
+
+    free(frames);
+    BLT_OutputBuffer_Destroy(buffer);
+}
+
+/*----------------------------------------------------------------------
+|    TestXruns
+|
+|    Only silence played for want of frames counts as an underrun, and
+|    only frames that the producer drops count as an overrun.
++---------------------------------------------------------------------*/
+static void
+TestXruns(void)
+{
+    BLT_OutputBuffer*     buffer = CreateBuffer(100*TEST_MS);
+    short*                frames = (short*)malloc(200*TEST_MS*TEST_CHANNEL_COUNT*sizeof(short));
+    BLT_OutputBufferStats stats;
+    unsigned int          i;
+
+    /* the device finds 10 ms when it wants 30: the rest is silence */
+    Fill(frames, 1, 10*TEST_MS);
+    CHECK(BLT_OutputBuffer_Write(buffer, frames, 10*TEST_MS) == 10*TEST_MS);
+    CHECK(BLT_OutputBuffer_Read(buffer, frames, 30*TEST_MS, BLT_TRUE) == 10*TEST_MS);
+    for (i=10*TEST_MS; i<30*TEST_MS; i++) {
+        CHECK(frames[i*TEST_CHANNEL_COUNT] == 0 && frames[i*TEST_CHANNEL_COUNT+1] == 0);
+    }
+    BLT_OutputBuffer_GetStats(buffer, &stats);
+    CHECK(stats.underruns == 1);
+    CHECK(stats.underrun_frames == 20*TEST_MS);
+    CHECK(stats.frames_read == 30*TEST_MS);
+
+    /* the underflow is reported once */
+    CHECK(GetFlags(buffer) == BLT_OUTPUT_NODE_STATUS_UNDERFLOW);
+    CHECK(GetFlags(buffer) == 0);
+
+    /* running out while draining is not an underrun, and neither is */
+    /* reading without padding                                       */
+    BLT_OutputBuffer_SetDraining(buffer);
+    CHECK(BLT_OutputBuffer_Read(buffer, frames, 10*TEST_MS, BLT_TRUE) == 0);
+    CHECK(BLT_OutputBuffer_Read(buffer, frames, 10*TEST_MS, BLT_FALSE) == 0);
+    BLT_OutputBuffer_GetStats(buffer, &stats);
+    CHECK(stats.underruns == 1);
+    CHECK(stats.frames_read == 40*TEST_MS);
+
+    /* writing clears the draining condition */
+    CHECK(BLT_OutputBuffer_Write(buffer, frames, 1) == 1);
+    CHECK(BLT_OutputBuffer_Read(buffer, frames, 2, BLT_TRUE) == 1);
+    BLT_OutputBuffer_ReportUnderrun(buffer, 5);
+    BLT_OutputBuffer_GetStats(buffer, &stats);
+    CHECK(stats.underruns == 3);
+    CHECK(stats.underrun_frames == 20*TEST_MS+6);
+    CHECK(GetFlags(buffer) == BLT_OUTPUT_NODE_STATUS_UNDERFLOW);
+
+    /* writes that do not fit are no overrun until frames are dropped */
+    CHECK(BLT_OutputBuffer_Write(buffer, frames, 200*TEST_MS) == BLT_OutputBuffer_GetCapacity(buffer));
+    CHECK(BLT_OutputBuffer_Write(buffer, frames, 200*TEST_MS) == 0);
+    BLT_OutputBuffer_GetStats(buffer, &stats);
+    CHECK(stats.overruns == 0);
+    CHECK(stats.overrun_frames == 0);
+    BLT_OutputBuffer_ReportOverrun(buffer, 0);
+    BLT_OutputBuffer_ReportOverrun(buffer, 30);
+    BLT_OutputBuffer_ReportOverrun(buffer, 12);
+    BLT_OutputBuffer_GetStats(buffer, &stats);
+    CHECK(stats.overruns == 2);
+    CHECK(stats.overrun_frames == 42);
+
+    free(frames);
+    BLT_OutputBuffer_Destroy(buffer);
+}
+
+/*----------------------------------------------------------------------
+|    TestSilence: unsigned samples are silent half way up their range
++---------------------------------------------------------------------*/
+static void
+TestSilence(void)
+{
+    BLT_OutputBuffer* buffer = NULL;
+    BLT_PcmMediaType  format;
+    unsigned char     frames[16*2*2];
+    unsigned int      i;
+
+    BLT_PcmMediaType_Init(&format);
+    format.sample_rate     = TEST_SAMPLE_RATE;
+    format.channel_count   = 2;
+    format.bits_per_sample = 16;
+    format.sample_format   = BLT_PCM_SAMPLE_FORMAT_UNSIGNED_INT_LE;
+    CHECK(BLT_SUCCEEDED(BLT_OutputBuffer_Create(64, 0, &buffer)));
+    CHECK(BLT_SUCCEEDED(BLT_OutputBuffer_SetFormat(buffer, &format)));
+    CHECK(BLT_OutputBuffer_Read(buffer, frames, 16, BLT_TRUE) == 0);
+    for (i=0; i<16*2; i++) {
+        CHECK(frames[2*i] == 0x00 && frames[2*i+1] == 0x80);
+    }
+
+    format.sample_format = BLT_PCM_SAMPLE_FORMAT_UNSIGNED_INT_BE;
+    CHECK(BLT_SUCCEEDED(BLT_OutputBuffer_SetFormat(buffer, &format)));
+    CHECK(BLT_OutputBuffer_Read(buffer, frames, 16, BLT_TRUE) == 0);
+    for (i=0; i<16*2; i++) {
+        CHECK(frames[2*i] == 0x80 && frames[2*i+1] == 0x00);
+    }
+
+    format.sample_rate = 0;
+    CHECK(BLT_OutputBuffer_SetFormat(buffer, &format) == BLT_ERROR_INVALID_MEDIA_FORMAT);
+    BLT_OutputBuffer_Destroy(buffer);
+}
+
+/*----------------------------------------------------------------------
+|    main
++---------------------------------------------------------------------*/
+int
+main(int argc, char** argv)
+{
+    BLT_OutputBuffer* buffer = NULL;
+
+    BLT_COMPILER_UNUSED(argc);
+    BLT_COMPILER_UNUSED(argv);
+
+    CHECK(BLT_OutputBuffer_Create(0, 0, &buffer) == BLT_ERROR_INVALID_PARAMETERS);
+    CHECK(buffer == NULL);
+
+    TestData();
+    TestClock();
+    TestXruns();
+    TestSilence();
+
+    printf("OutputBufferTest passed\n");
+    return 0;
+}
@@ -0,0 +1,249 @@
+/*****************************************************************
+|
+|   BlueTune - Pixel Conversion Benchmark
+|
+|   (c) 2002-2012 Gilles Boccon-Gibod
+|   Author: Gilles Boccon-Gibod (bok@bok.net)
+|
+****************************************************************/
+
+/*----------------------------------------------------------------------
+|    includes
++---------------------------------------------------------------------*/
+#include <stdio.h>
+#include <stdlib.h>
+
+#include "Atomix.h"
+#include "BltConfig.h"
+#include "BltErrors.h"
+#include "BltPixels.h"
+
+/*----------------------------------------------------------------------
+|    constants
++---------------------------------------------------------------------*/
+#define BENCHMARK_SRC_WIDTH  1280
+#define BENCHMARK_SRC_HEIGHT 720
+#define BENCHMARK_FRAMES     200
+
+/*----------------------------------------------------------------------
+|    GetTime
++---------------------------------------------------------------------*/
+static ATX_Int64
+GetTime(void)
+{
+    ATX_TimeStamp now;
+    ATX_Int64     now_int = 0;
+
+    ATX_System_GetCurrentTimeStamp(&now);
+    ATX_TimeStamp_ToInt64(now, now_int);
+
+    return now_int;
+}
+
+/*----------------------------------------------------------------------
+|    Clamp
++---------------------------------------------------------------------*/
+static int
+Clamp(int x, int low, int high)
+{
+    return x < low ? low : (x > high ? high : x);
+}
+
+/*----------------------------------------------------------------------
+|    ConvertPixel
+|
+|    The conversion, one pixel at a time, with the saturations of the
+|    16 bit arithmetic that the library uses.
++---------------------------------------------------------------------*/
+static void
+ConvertPixel(int y, int u, int v, BLT_UInt8* rgb)
+{
+    int luma = (y-16)*74;
+    
+    rgb[0] = (BLT_UInt8)Clamp(Clamp(luma+(v-128)*102, -32768, 32767)>>6, 0, 255);
+    rgb[1] = (BLT_UInt8)Clamp(Clamp(Clamp(luma-(v-128)*52, -32768, 32767)-(u-128)*25, -32768, 32767)>>6, 0, 255);
+    rgb[2] = (BLT_UInt8)Clamp(Clamp(luma+(u-128)*129, -32768, 32767)>>6, 0, 255);
+}
+
+/*----------------------------------------------------------------------
+|    CheckRows
+|
+|    Every combination of y, u and v, at every position of the vector
+|    loops and of their tails.
++---------------------------------------------------------------------*/
+static int
+CheckRows(void)
+{
+    BLT_UInt8    y[256], u[128], v[128];
+    BLT_UInt8    out[256*4];
+    BLT_UInt8    expected[3];
+    unsigned int width;
+    int          i, j, k;
+    int          errors = 0;
+
+    for (j=0; j<256 && errors < 10; j++) {
+        for (k=0; k<256 && errors < 10; k++) {
+            for (i=0; i<256; i++) y[i] = (BLT_UInt8)i;
+            for (i=0; i<128; i++) {
+                u[i] = (BLT_UInt8)j;
+                v[i] = (BLT_UInt8)k;
+            }
+            for (width=(j+k)%32+225; width<=256; width += 31) {
+                BLT_Pixels_ConvertYuv420Row(y, u, v, out, width, BLT_PIXEL_FORMAT_RGBA);
+                for (i=0; i<(int)width; i++) {
+                    ConvertPixel(y[i], j, k, expected);
+                    if (out[4*i] != expected[0] || out[4*i+1] != expected[1] ||
+                        out[4*i+2] != expected[2] || out[4*i+3] != 255) {
+                        if (++errors < 10) {
+                            printf("ERROR: y=%d u=%d v=%d width=%d: %d,%d,%d instead of %d,%d,%d\n",
+                                   i, j, k, width,
+                                   out[4*i], out[4*i+1], out[4*i+2],
+                                   expected[0], expected[1], expected[2]);
+                        }
+                    }
+                }
+                BLT_Pixels_ConvertYuv420Row(y, u, v, out, width, BLT_PIXEL_FORMAT_BGRA);
+                ConvertPixel(y[width-1], j, k, expected);
+                if (out[4*(width-1)] != expected[2] || out[4*(width-1)+2] != expected[0]) {
+                    if (++errors < 10) printf("ERROR: BGRA order, width=%d\n", width);
+                }
+            }
+        }
+    }
+
+    return errors;
+}
+
+/*----------------------------------------------------------------------
+|    CheckScaler
+|
+|    A flat picture stays flat, whatever the scaling.
++---------------------------------------------------------------------*/
+static int
+CheckScaler(unsigned int dst_width, unsigned int dst_height)
+{
+    unsigned int       src_width  = 321;
+    unsigned int       src_height = 241;
+    BLT_UInt8*         y = (BLT_UInt8*)malloc(src_width*src_height);
+    BLT_UInt8*         u = (BLT_UInt8*)malloc(((src_width+1)/2)*((src_height+1)/2));
+    BLT_UInt8*         v = (BLT_UInt8*)malloc(((src_width+1)/2)*((src_height+1)/2));
+    BLT_UInt8*         out = (BLT_UInt8*)malloc(dst_width*dst_height*4);
+    const BLT_UInt8*   planes[3];
+    unsigned int       pitches[3];
+    BLT_UInt8          expected[3];
+    BLT_PixelScaler*   scaler = NULL;
+    unsigned int       i;
+    int                errors = 0;
+
+    memset(y, 100, src_width*src_height);
+    memset(u, 90,  ((src_width+1)/2)*((src_height+1)/2));
+    memset(v, 200, ((src_width+1)/2)*((src_height+1)/2));
+    planes[0]  = y;
+    planes[1]  = u;
+    planes[2]  = v;
+    pitches[0] = src_width;
+    pitches[1] = pitches[2] = (src_width+1)/2;
+    ConvertPixel(100, 90, 200, expected);
+
+    if (BLT_FAILED(BLT_PixelScaler_Create(src_width, src_height, dst_width, dst_height, BLT_PIXEL_FORMAT_RGBA, &scaler))) {
+        printf("ERROR: cannot create a %dx%d scaler\n", dst_width, dst_height);
+        return 1;
+    }
+    BLT_PixelScaler_Convert(scaler, planes, pitches, out, dst_width*4);
+    for (i=0; i<dst_width*dst_height; i++) {
+        if (out[4*i] != expected[0] || out[4*i+1] != expected[1] || out[4*i+2] != expected[2]) {
+            printf("ERROR: %dx%d, pixel %d\n", dst_width, dst_height, i);
+            ++errors;
+            break;
+        }
+    }
+    BLT_PixelScaler_Destroy(scaler);
+    free(y);
+    free(u);
+    free(v);
+    free(out);
+
+    return errors;
+}
+
+/*----------------------------------------------------------------------
+|    Run
++---------------------------------------------------------------------*/
+static void
+Run(unsigned int dst_width, unsigned int dst_height, const char* name)
+{
+    unsigned int       chroma_width  = BENCHMARK_SRC_WIDTH/2;
+    unsigned int       chroma_height = BENCHMARK_SRC_HEIGHT/2;
+    BLT_UInt8*         y   = (BLT_UInt8*)malloc(BENCHMARK_SRC_WIDTH*BENCHMARK_SRC_HEIGHT);
+    BLT_UInt8*         u   = (BLT_UInt8*)malloc(chroma_width*chroma_height);
+    BLT_UInt8*         v   = (BLT_UInt8*)malloc(chroma_width*chroma_height);
+    BLT_UInt8*         out = (BLT_UInt8*)malloc(dst_width*dst_height*4);
+    const BLT_UInt8*   planes[3];
+    unsigned int       pitches[3];
+    BLT_PixelScaler*   scaler = NULL;
+    ATX_Int64          start;
+    double             seconds;
+    unsigned int       i;
+
+    for (i=0; i<BENCHMARK_SRC_WIDTH*BENCHMARK_SRC_HEIGHT; i++) y[i] = (BLT_UInt8)(i*7);
+    for (i=0; i<chroma_width*chroma_height; i++) {
+        u[i] = (BLT_UInt8)(i*3);
+        v[i] = (BLT_UInt8)(i*5);
+    }
+    planes[0]  = y;
+    planes[1]  = u;
+    planes[2]  = v;
+    pitches[0] = BENCHMARK_SRC_WIDTH;
+    pitches[1] = pitches[2] = chroma_width;
+
+    BLT_PixelScaler_Create(BENCHMARK_SRC_WIDTH, BENCHMARK_SRC_HEIGHT,
+                           dst_width, dst_height,
+                           BLT_PIXEL_FORMAT_BGRA,
+                           &scaler);
+    start = GetTime();
+    for (i=0; i<BENCHMARK_FRAMES; i++) {
+        BLT_PixelScaler_Convert(scaler, planes, pitches, out, dst_width*4);
+    }
+    seconds = (double)(GetTime()-start)/1000000000.0;
+    if (seconds <= 0.0) seconds = 1e-9;
+    BLT_PixelScaler_Destroy(scaler);
+
+    printf("%-32s %8.1f frames/s %7.1f Mpixels/s\n",
+           name,
+           (double)BENCHMARK_FRAMES/seconds,
+           (double)BENCHMARK_FRAMES*dst_width*dst_height/seconds/1000000.0);
+
+    free(y);
+    free(u);
+    free(v);
+    free(out);
+}
+
+/*----------------------------------------------------------------------
+|    main
++---------------------------------------------------------------------*/
+int
+main(int argc, char** argv)
+{
+    int errors;
+
+    BLT_COMPILER_UNUSED(argc);
+    BLT_COMPILER_UNUSED(argv);
+
+    errors  = CheckRows();
+    errors += CheckScaler(321, 241);
+    errors += CheckScaler(1000, 600);
+    errors += CheckScaler(160, 90);
+    errors += CheckScaler(321, 600);
+    if (errors) {
+        printf("FAILED\n");
+        return 1;
+    }
+
+    Run(1280, 720,  "1280x720 -> 1280x720 BGRA");
+    Run(1000, 600,  "1280x720 -> 1000x600 BGRA");
+    Run(1920, 1080, "1280x720 -> 1920x1080 BGRA");
+    Run(640,  360,  "1280x720 -> 640x360 BGRA");
+
+    return 0;
+}
@@ -0,0 +1,342 @@
+/*****************************************************************
+|
+|   BlueTune - Pixels Test
+|
+|   (c) 2002-2012 Gilles Boccon-Gibod
+|   Author: Gilles Boccon-Gibod (bok@bok.net)
+|
+****************************************************************/
+
+/*----------------------------------------------------------------------
+|    includes
++---------------------------------------------------------------------*/
+#include <stdio.h>
+#include <stdlib.h>
+
+#include "Atomix.h"
+#include "BltConfig.h"
+#include "BltErrors.h"
+#include "BltPixels.h"
+#include "TestUtils.h"
+
+/*----------------------------------------------------------------------
+|    constants
++---------------------------------------------------------------------*/
+#define TEST_MAX_WIDTH  1000
+#define TEST_GUARD      0xA5 /* in the bytes that must not be written */
+#define TEST_GUARD_SIZE 64
+
+/*----------------------------------------------------------------------
+|    CHECK
++---------------------------------------------------------------------*/
+#define CHECK(x)                                        \
+do {                                                    \
+    if (!(x)) {                                         \
+        fprintf(stderr, "FAILED line %d\n", __LINE__);  \
+        abort();                                        \
+    }                                                   \
+} while(0)
+
+/*----------------------------------------------------------------------
+|    Saturate16
++---------------------------------------------------------------------*/
+static int
+Saturate16(int x)
+{
+    return x > 32767 ? 32767 : (x < -32768 ? -32768 : x);
+}
+
+/*----------------------------------------------------------------------
+|    Clamp8
++---------------------------------------------------------------------*/
+static BLT_UInt8
+Clamp8(int x)
+{
+    return (BLT_UInt8)(x < 0 ? 0 : (x > 255 ? 255 : x));
+}
+
+/*----------------------------------------------------------------------
+|    ConvertRow
+|
+|    The scalar reference: one pixel at a time, with the saturations of
+|    the 16 bit arithmetic of the vector code.
++---------------------------------------------------------------------*/
+static void
+ConvertRow(const BLT_UInt8* y,
+           const BLT_UInt8* u,
+           const BLT_UInt8* v,
+           BLT_UInt8*       dst,
+           unsigned int     width,
+           BLT_PixelFormat  format)
+{
+    unsigned int r_offset = format == BLT_PIXEL_FORMAT_RGBA ? 0 : 2;
+    unsigned int x;
+
+    for (x=0; x<width; x++) {
+        int luma = (y[x]-16)*74;
+        int cb   = u[x/2]-128;
+        int cr   = v[x/2]-128;
+        dst[4*x+r_offset]   = Clamp8(Saturate16(luma+cr*102)>>6);
+        dst[4*x+1]          = Clamp8(Saturate16(Saturate16(luma-cr*52)-cb*25)>>6);
+        dst[4*x+2-r_offset] = Clamp8(Saturate16(luma+cb*129)>>6);
+        dst[4*x+3]          = 255;
+    }
+}
+
+/*----------------------------------------------------------------------
+|    Fill
++---------------------------------------------------------------------*/
+static void
+Fill(BLT_UInt8* buffer, unsigned int size, unsigned int* seed)
+{
+    unsigned int i;
+
+    for (i=0; i<size; i++) buffer[i] = (BLT_UInt8)TestUtils_Random(seed);
+}
+
+/*----------------------------------------------------------------------
+|    TestAllValues
+|
+|    Every combination of y, u and v, against the reference.
++---------------------------------------------------------------------*/
+static void
+TestAllValues(void)
+{
+    BLT_UInt8    y[256], u[128], v[128];
+    BLT_UInt8    out[256*4];
+    BLT_UInt8    expected[256*4];
+    unsigned int i, j, k;
+
+    for (i=0; i<256; i++) y[i] = (BLT_UInt8)i;
+    for (j=0; j<256; j++) {
+        for (k=0; k<256; k++) {
+            for (i=0; i<128; i++) {
+                u[i] = (BLT_UInt8)j;
+                v[i] = (BLT_UInt8)k;
+            }
+            BLT_Pixels_ConvertYuv420Row(y, u, v, out, 256, BLT_PIXEL_FORMAT_RGBA);
+            ConvertRow(y, u, v, expected, 256, BLT_PIXEL_FORMAT_RGBA);
+            CHECK(ATX_CompareMemory(out, expected, sizeof(out)) == 0);
+        }
+    }
+}
+
+/*----------------------------------------------------------------------
+|    TestRows
+|
+|    Random rows of every width up to a few vector lengths, and some
+|    longer ones, from buffers that aren't aligned, in both formats:
+|    the vector loops, their tails, and nothing written past the row.
++---------------------------------------------------------------------*/
+static void
+TestRows(void)
+{
+    BLT_UInt8*   y        = (BLT_UInt8*)malloc(TEST_MAX_WIDTH+16);
+    BLT_UInt8*   u        = (BLT_UInt8*)malloc(TEST_MAX_WIDTH/2+16);
+    BLT_UInt8*   v        = (BLT_UInt8*)malloc(TEST_MAX_WIDTH/2+16);
+    BLT_UInt8*   out      = (BLT_UInt8*)malloc(4*TEST_MAX_WIDTH+16+TEST_GUARD_SIZE);
+    BLT_UInt8*   expected = (BLT_UInt8*)malloc(4*TEST_MAX_WIDTH);
+    unsigned int seed = 1;
+    unsigned int width;
+    unsigned int format;
+    unsigned int i;
+
+    for (width=1; width<=TEST_MAX_WIDTH; width += width < 80 ? 1 : 97) {
+        for (format=0; format<2; format++) {
+            BLT_PixelFormat pixel_format  = format ? BLT_PIXEL_FORMAT_BGRA : BLT_PIXEL_FORMAT_RGBA;
+            unsigned int    misalignment  = width%16;
+            BLT_UInt8*      row_y = y+misalignment;
+            BLT_UInt8*      row_u = u+(misalignment+1)%16;
+            BLT_UInt8*      row_v = v+(misalignment+2)%16;
+            BLT_UInt8*      row_out = out+(misalignment+3)%16;
+
+            Fill(row_y, width, &seed);
+            Fill(row_u, (width+1)/2, &seed);
+            Fill(row_v, (width+1)/2, &seed);
+            ATX_SetMemory(row_out, TEST_GUARD, 4*width+TEST_GUARD_SIZE);
+
+            BLT_Pixels_ConvertYuv420Row(row_y, row_u, row_v, row_out, width, pixel_format);
+            ConvertRow(row_y, row_u, row_v, expected, width, pixel_format);
+            CHECK(ATX_CompareMemory(row_out, expected, 4*width) == 0);
+            for (i=0; i<TEST_GUARD_SIZE; i++) {
+                CHECK(row_out[4*width+i] == TEST_GUARD);
+            }
+        }
+    }
+
+    free(y);
+    free(u);
+    free(v);
+    free(out);
+    free(expected);
+}
+
+/*----------------------------------------------------------------------
+|    Tap
+|
+|    Where the center of a destination sample falls on the source, in
+|    8.8 fixed point.
++---------------------------------------------------------------------*/
+typedef struct {
+    unsigned int index;
+    unsigned int next;
+    unsigned int weight;
+} Tap;
+
+static Tap
+ComputeTap(unsigned int dst_index, unsigned int dst_size, unsigned int src_size)
+{
+    ATX_Int64 position = ((ATX_Int64)(2*dst_index+1)*src_size-dst_size)*256/(2*(ATX_Int64)dst_size);
+    Tap       tap;
+
+    if (position < 0) position = 0;
+    tap.index  = (unsigned int)(position>>8);
+    tap.weight = (unsigned int)(position&0xFF);
+    if (tap.index >= src_size-1) {
+        tap.index  = src_size-1;
+        tap.weight = 0;
+    }
+    tap.next = tap.weight ? tap.index+1 : tap.index;
+
+    return tap;
+}
+
+/*----------------------------------------------------------------------
+|    Blend
++---------------------------------------------------------------------*/
+static BLT_UInt8
+Blend(BLT_UInt8 a, BLT_UInt8 b, unsigned int weight)
+{
+    return (BLT_UInt8)((a*(256-weight)+b*weight+128)>>8);
+}
+
+/*----------------------------------------------------------------------
+|    ScalePlane
+|
+|    Bilinear, one sample at a time: first vertically, then
+|    horizontally, rounding after each, like the scaler.
++---------------------------------------------------------------------*/
+static void
+ScalePlane(const BLT_UInt8* plane,
+           unsigned int     pitch,
+           unsigned int     src_width,
+           unsigned int     src_height,
+           unsigned int     dst_width,
+           unsigned int     dst_height,
+           unsigned int     dst_row,
+           BLT_UInt8*       out)
+{
+    Tap          row = ComputeTap(dst_row, dst_height, src_height);
+    unsigned int x;
+
+    for (x=0; x<dst_width; x++) {
+        Tap       column = ComputeTap(x, dst_width, src_width);
+        BLT_UInt8 a      = Blend(plane[row.index*pitch+column.index],
+                                 plane[row.next *pitch+column.index], row.weight);
+        BLT_UInt8 b      = Blend(plane[row.index*pitch+column.next ],
+                                 plane[row.next *pitch+column.next ], row.weight);
+        out[x] = Blend(a, b, column.weight);
+    }
+}
+
+/*----------------------------------------------------------------------
+|    TestScaler
+|
+|    A random picture, with padding at the end of the lines, scaled
+|    and converted, against the reference.
++---------------------------------------------------------------------*/
+static void
+TestScaler(unsigned int    src_width,
+           unsigned int    src_height,
+           unsigned int    dst_width,
+           unsigned int    dst_height,
+           BLT_PixelFormat format)
+{
+    unsigned int     src_chroma_width  = (src_width+1)/2;
+    unsigned int     src_chroma_height = (src_height+1)/2;
+    unsigned int     dst_chroma_width  = (dst_width+1)/2;
+    unsigned int     pitches[3];
+    const BLT_UInt8* planes[3];
+    BLT_UInt8*       y;
+    BLT_UInt8*       u;
+    BLT_UInt8*       v;
+    BLT_UInt8*       out;
+    BLT_UInt8*       row_y = (BLT_UInt8*)malloc(dst_width);
+    BLT_UInt8*       row_u = (BLT_UInt8*)malloc(dst_chroma_width);
+    BLT_UInt8*       row_v = (BLT_UInt8*)malloc(dst_chroma_width);
+    BLT_UInt8*       expected = (BLT_UInt8*)malloc(4*dst_width);
+    BLT_PixelScaler* scaler = NULL;
+    unsigned int     seed = src_width*dst_width+src_height*dst_height;
+    unsigned int     row;
+
+    pitches[0] = src_width+13;
+    pitches[1] = pitches[2] = src_chroma_width+7;
+    y   = (BLT_UInt8*)malloc(pitches[0]*src_height);
+    u   = (BLT_UInt8*)malloc(pitches[1]*src_chroma_height);
+    v   = (BLT_UInt8*)malloc(pitches[2]*src_chroma_height);
+    out = (BLT_UInt8*)malloc(4*dst_width*dst_height);
+    Fill(y, pitches[0]*src_height, &seed);
+    Fill(u, pitches[1]*src_chroma_height, &seed);
+    Fill(v, pitches[2]*src_chroma_height, &seed);
+    planes[0] = y;
+    planes[1] = u;
+    planes[2] = v;
+
+    CHECK(BLT_SUCCEEDED(BLT_PixelScaler_Create(src_width, src_height, dst_width, dst_height, format, &scaler)));
+    CHECK(BLT_SUCCEEDED(BLT_PixelScaler_Convert(scaler, planes, pitches, out, 4*dst_width)));
+    BLT_PixelScaler_Destroy(scaler);
+
+    for (row=0; row<dst_height; row++) {
+        if (src_width == dst_width && src_height == dst_height) {
+            ConvertRow(y+row*pitches[0], u+(row/2)*pitches[1], v+(row/2)*pitches[2],
+                       expected, dst_width, format);
+        } else {
+            ScalePlane(y, pitches[0], src_width, src_height,
+                       dst_width, dst_height, row, row_y);
+            ScalePlane(u, pitches[1], src_chroma_width, src_chroma_height,
+                       dst_chroma_width, (dst_height+1)/2, row/2, row_u);
+            ScalePlane(v, pitches[2], src_chroma_width, src_chroma_height,
+                       dst_chroma_width, (dst_height+1)/2, row/2, row_v);
+            ConvertRow(row_y, row_u, row_v, expected, dst_width, format);
+        }
+        CHECK(ATX_CompareMemory(out+4*dst_width*row, expected, 4*dst_width) == 0);
+    }
+
+    free(y);
+    free(u);
+    free(v);
+    free(out);
+    free(row_y);
+    free(row_u);
+    free(row_v);
+    free(expected);
+}
+
+/*----------------------------------------------------------------------
+|    main
++---------------------------------------------------------------------*/
+int
+main(int argc, char** argv)
+{
+    BLT_PixelScaler* scaler = NULL;
+
+    BLT_COMPILER_UNUSED(argc);
+    BLT_COMPILER_UNUSED(argv);
+
+    TestAllValues();
+    TestRows();
+
+    TestScaler(321, 241, 321, 241, BLT_PIXEL_FORMAT_RGBA); /* no scaling      */
+    TestScaler(321, 241, 321, 600, BLT_PIXEL_FORMAT_BGRA); /* vertically only */
+    TestScaler(321, 241, 1000, 600, BLT_PIXEL_FORMAT_RGBA);
+    TestScaler(320, 240, 160, 90,   BLT_PIXEL_FORMAT_BGRA);
+    TestScaler(7,   5,   33,  17,   BLT_PIXEL_FORMAT_RGBA);
+
+    CHECK(BLT_PixelScaler_Create(0, 240, 160, 90, BLT_PIXEL_FORMAT_RGBA, &scaler) == BLT_ERROR_INVALID_PARAMETERS);
+    CHECK(scaler == NULL);
+    CHECK(BLT_PixelScaler_Create(320, 240, 160, 90, BLT_PIXEL_FORMAT_YV12, &scaler) == BLT_ERROR_NOT_SUPPORTED);
+    CHECK(scaler == NULL);
+
+    printf("PixelsTest passed\n");
+    return 0;
+}
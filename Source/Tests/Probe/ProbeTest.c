@@ -0,0 +1,224 @@
+/*****************************************************************
+|
+|   BlueTune - Probe Test
+|
+|   (c) 2002-2012 Gilles Boccon-Gibod
+|   Author: Gilles Boccon-Gibod (bok@bok.net)
+|
+****************************************************************/
+
+/*----------------------------------------------------------------------
+|    includes
++---------------------------------------------------------------------*/
+#include <stdio.h>
+#include <stdlib.h>
+
+#include "Atomix.h"
+#include "BltConfig.h"
+#include "BltErrors.h"
+#include "BltDecoder.h"
+#include "BltStream.h"
+#include "BltNullOutput.h"
+#include "TestUtils.h"
+
+/*----------------------------------------------------------------------
+|    constants
++---------------------------------------------------------------------*/
+#define TEST_FILENAME_A      "ProbeTestA.wav"
+#define TEST_SAMPLE_RATE_A   44100
+#define TEST_CHANNEL_COUNT_A 2
+#define TEST_FRAME_COUNT_A   (3*TEST_SAMPLE_RATE_A/2) /* 1500 ms */
+#define TEST_FILENAME_B      "ProbeTestB.wav"
+#define TEST_SAMPLE_RATE_B   22050
+#define TEST_CHANNEL_COUNT_B 1
+#define TEST_FRAME_COUNT_B   TEST_SAMPLE_RATE_B       /* 1000 ms */
+#define TEST_INFO_MASK       (BLT_STREAM_INFO_MASK_SAMPLE_RATE   | \
+                              BLT_STREAM_INFO_MASK_CHANNEL_COUNT | \
+                              BLT_STREAM_INFO_MASK_DURATION)
+
+/*----------------------------------------------------------------------
+|    CHECK
++---------------------------------------------------------------------*/
+#define CHECK(x)                                        \
+do {                                                    \
+    if (!(x)) {                                         \
+        fprintf(stderr, "FAILED line %d\n", __LINE__);  \
+        abort();                                        \
+    }                                                   \
+} while(0)
+
+/*----------------------------------------------------------------------
+|    globals
++---------------------------------------------------------------------*/
+static BLT_Int16 TestSamplesA[TEST_FRAME_COUNT_A*TEST_CHANNEL_COUNT_A];
+static BLT_Int16 TestSamplesB[TEST_FRAME_COUNT_B*TEST_CHANNEL_COUNT_B];
+
+/*----------------------------------------------------------------------
+|    WriteTestFiles
++---------------------------------------------------------------------*/
+static void
+WriteTestFiles(void)
+{
+    unsigned int seed = 1;
+    unsigned int i;
+
+    for (i=0; i<TEST_FRAME_COUNT_A*TEST_CHANNEL_COUNT_A; i++) {
+        TestSamplesA[i] = (BLT_Int16)TestUtils_Random(&seed);
+    }
+    for (i=0; i<TEST_FRAME_COUNT_B*TEST_CHANNEL_COUNT_B; i++) {
+        TestSamplesB[i] = (BLT_Int16)TestUtils_Random(&seed);
+    }
+    CHECK(BLT_SUCCEEDED(TestUtils_WriteWavFile(TEST_FILENAME_A, TestSamplesA, TEST_FRAME_COUNT_A,
+                                               TEST_CHANNEL_COUNT_A, TEST_SAMPLE_RATE_A)));
+    CHECK(BLT_SUCCEEDED(TestUtils_WriteWavFile(TEST_FILENAME_B, TestSamplesB, TEST_FRAME_COUNT_B,
+                                               TEST_CHANNEL_COUNT_B, TEST_SAMPLE_RATE_B)));
+}
+
+/*----------------------------------------------------------------------
+|    GetIntegerProperty
++---------------------------------------------------------------------*/
+static int
+GetIntegerProperty(BLT_Decoder* decoder, const char* name)
+{
+    ATX_Properties*   properties = NULL;
+    ATX_PropertyValue value;
+
+    CHECK(BLT_SUCCEEDED(BLT_Decoder_GetStreamProperties(decoder, &properties)));
+    CHECK(ATX_SUCCEEDED(ATX_Properties_GetProperty(properties, name, &value)));
+    CHECK(value.type == ATX_PROPERTY_VALUE_TYPE_INTEGER);
+
+    return value.data.integer;
+}
+
+/*----------------------------------------------------------------------
+|    CheckInfo
+|
+|    Checks the info returned by a probe, and that the decoder status
+|    has the same.
++---------------------------------------------------------------------*/
+static void
+CheckInfo(BLT_Decoder*          decoder,
+          const BLT_StreamInfo* info,
+          unsigned int          sample_rate,
+          unsigned int          channel_count,
+          unsigned int          duration)
+{
+    BLT_DecoderStatus status;
+
+    CHECK((info->mask & TEST_INFO_MASK) == TEST_INFO_MASK);
+    CHECK(info->sample_rate   == sample_rate);
+    CHECK(info->channel_count == channel_count);
+    CHECK(info->duration      == duration);
+
+    CHECK(BLT_SUCCEEDED(BLT_Decoder_GetStatus(decoder, &status)));
+    CHECK(status.stream_info.mask        == info->mask);
+    CHECK(status.stream_info.sample_rate == info->sample_rate);
+    CHECK(status.stream_info.duration    == info->duration);
+}
+
+/*----------------------------------------------------------------------
+|    TestProbe
+|
+|    Probes the test files one after the other with the same decoder:
+|    each gets its own info, and only the first packet of each is
+|    pumped to the null output.
++---------------------------------------------------------------------*/
+static void
+TestProbe(BLT_Decoder* decoder)
+{
+    BLT_StreamInfo info;
+
+    CHECK(BLT_SUCCEEDED(BLT_Decoder_Probe(decoder, TEST_FILENAME_A, NULL, 0, &info)));
+    CheckInfo(decoder, &info, TEST_SAMPLE_RATE_A, TEST_CHANNEL_COUNT_A, 1500);
+    CHECK(GetIntegerProperty(decoder, BLT_NULL_OUTPUT_PACKETS_PROPERTY) == 1);
+    CHECK(GetIntegerProperty(decoder, BLT_NULL_OUTPUT_FRAMES_PROPERTY) < TEST_FRAME_COUNT_A);
+
+    CHECK(BLT_SUCCEEDED(BLT_Decoder_Probe(decoder, TEST_FILENAME_B, NULL, 0, &info)));
+    CheckInfo(decoder, &info, TEST_SAMPLE_RATE_B, TEST_CHANNEL_COUNT_B, 1000);
+    CHECK(GetIntegerProperty(decoder, BLT_NULL_OUTPUT_PACKETS_PROPERTY) == 1);
+
+    /* allowing decoders changes nothing for a format that has its */
+    /* duration in the header                                      */
+    CHECK(BLT_SUCCEEDED(BLT_Decoder_Probe(decoder,
+                                          TEST_FILENAME_A,
+                                          NULL,
+                                          BLT_DECODER_PROBE_FLAG_ALLOW_DECODERS,
+                                          &info)));
+    CheckInfo(decoder, &info, TEST_SAMPLE_RATE_A, TEST_CHANNEL_COUNT_A, 1500);
+}
+
+/*----------------------------------------------------------------------
+|    TestFailures
++---------------------------------------------------------------------*/
+static void
+TestFailures(BLT_Decoder* decoder)
+{
+    BLT_StreamInfo info;
+
+    CHECK(BLT_Decoder_Probe(decoder, NULL, NULL, 0, &info) == BLT_ERROR_INVALID_PARAMETERS);
+    CHECK(BLT_Decoder_Probe(decoder, "", NULL, 0, &info) == BLT_ERROR_INVALID_PARAMETERS);
+    CHECK(BLT_Decoder_Probe(decoder, TEST_FILENAME_A, NULL, 0, NULL) == BLT_ERROR_INVALID_PARAMETERS);
+
+    /* the info is cleared, not left over from the previous probe */
+    info.mask = TEST_INFO_MASK;
+    CHECK(BLT_FAILED(BLT_Decoder_Probe(decoder, "ProbeTestMissing.wav", NULL, 0, &info)));
+    CHECK(info.mask == 0);
+}
+
+/*----------------------------------------------------------------------
+|    TestPlayAfterProbe
+|
+|    Once the output is set again, the decoder plays from the start of
+|    a file that it probed.
++---------------------------------------------------------------------*/
+static void
+TestPlayAfterProbe(BLT_Decoder* decoder)
+{
+    TestCollector  collector;
+    BLT_StreamInfo info;
+    unsigned int   i;
+
+    CHECK(BLT_SUCCEEDED(BLT_Decoder_Probe(decoder, TEST_FILENAME_A, NULL, 0, &info)));
+
+    CHECK(BLT_SUCCEEDED(TestCollector_Construct(&collector, TEST_CHANNEL_COUNT_A, TEST_FRAME_COUNT_A)));
+    CHECK(BLT_SUCCEEDED(TestCollector_SetAsOutput(&collector, decoder)));
+    CHECK(BLT_SUCCEEDED(BLT_Decoder_SetInput(decoder, TEST_FILENAME_A, NULL)));
+    CHECK(TestUtils_PumpToEnd(decoder) == BLT_ERROR_EOS);
+
+    CHECK(collector.frame_count == TEST_FRAME_COUNT_A);
+    for (i=0; i<TEST_FRAME_COUNT_A*TEST_CHANNEL_COUNT_A; i++) {
+        CHECK(collector.samples[i] == TestSamplesA[i]);
+    }
+
+    /* the output has to be replaced before it goes away */
+    CHECK(BLT_SUCCEEDED(BLT_Decoder_SetOutput(decoder, "null", "audio/pcm")));
+    TestCollector_Destruct(&collector);
+}
+
+/*----------------------------------------------------------------------
+|    main
++---------------------------------------------------------------------*/
+int
+main(int argc, char** argv)
+{
+    BLT_Decoder* decoder = NULL;
+
+    BLT_COMPILER_UNUSED(argc);
+    BLT_COMPILER_UNUSED(argv);
+
+    WriteTestFiles();
+
+    CHECK(BLT_SUCCEEDED(BLT_Decoder_Create(&decoder)));
+    BLT_Decoder_RegisterBuiltins(decoder);
+
+    TestProbe(decoder);
+    TestFailures(decoder);
+    TestPlayAfterProbe(decoder);
+
+    BLT_Decoder_Destroy(decoder);
+    remove(TEST_FILENAME_A);
+    remove(TEST_FILENAME_B);
+
+    printf("ProbeTest passed\n");
+    return 0;
+}
@@ -0,0 +1,146 @@
+/*****************************************************************
+|
+|   BlueTune - RAOP Packet Benchmark
+|
+|   (c) 2002-2012 Gilles Boccon-Gibod
+|   Author: Gilles Boccon-Gibod (bok@bok.net)
+|
+****************************************************************/
+
+/*----------------------------------------------------------------------
+|    includes
++---------------------------------------------------------------------*/
+#include <stdio.h>
+#include <stdlib.h>
+#include <math.h>
+
+#include "Atomix.h"
+#include "BltConfig.h"
+#include "BltErrors.h"
+#include "BltAlacEncoder.h"
+#include "BltAesCbc.h"
+
+/*----------------------------------------------------------------------
+|    constants
++---------------------------------------------------------------------*/
+#define BENCHMARK_SAMPLE_RATE    44100
+#define BENCHMARK_PACKET_FRAMES  352 /* RAOP over UDP */
+#define BENCHMARK_AUDIO_DURATION 600 /* seconds of audio encoded per run */
+#define BENCHMARK_SIGNAL_FRAMES  (BENCHMARK_SAMPLE_RATE*10)
+
+/*----------------------------------------------------------------------
+|    GetTime
++---------------------------------------------------------------------*/
+static ATX_Int64
+GetTime(void)
+{
+    ATX_TimeStamp now;
+    ATX_Int64     now_int = 0;
+
+    ATX_System_GetCurrentTimeStamp(&now);
+    ATX_TimeStamp_ToInt64(now, now_int);
+
+    return now_int;
+}
+
+/*----------------------------------------------------------------------
+|    MakeSignal
+|
+|    Something that compresses about like music: a few partials with a
+|    slow envelope, a stereo image, and a little noise.
++---------------------------------------------------------------------*/
+static BLT_Int16*
+MakeSignal(void)
+{
+    BLT_Int16*   samples = (BLT_Int16*)malloc(BENCHMARK_SIGNAL_FRAMES*2*sizeof(BLT_Int16));
+    BLT_UInt32   random = 1;
+    unsigned int i;
+
+    for (i=0; i<BENCHMARK_SIGNAL_FRAMES; i++) {
+        double t        = (double)i/BENCHMARK_SAMPLE_RATE;
+        double envelope = 0.5+0.5*sin(t*0.7);
+        double mid      = envelope*(6000.0*sin(2*M_PI*220.0*t)+
+                                    3000.0*sin(2*M_PI*331.0*t+1.0)+
+                                    1500.0*sin(2*M_PI*1250.0*t));
+        double side     = envelope*2000.0*sin(2*M_PI*440.0*t);
+        int    noise;
+
+        random = random*1664525+1013904223;
+        noise  = (int)((random>>16)%41)-20;
+        samples[2*i  ] = (BLT_Int16)(mid+side+noise);
+        samples[2*i+1] = (BLT_Int16)(mid-side-noise);
+    }
+
+    return samples;
+}
+
+/*----------------------------------------------------------------------
+|    Run
++---------------------------------------------------------------------*/
+static void
+Run(const BLT_Int16* signal, BLT_Boolean compress, BLT_AesCbc* cipher)
+{
+    BLT_AlacEncoder* encoder;
+    BLT_UInt8*       packet;
+    BLT_UInt8        iv[BLT_AES_CBC_BLOCK_SIZE] = {0};
+    unsigned int     packet_count = (BENCHMARK_AUDIO_DURATION*BENCHMARK_SAMPLE_RATE)/BENCHMARK_PACKET_FRAMES;
+    unsigned int     signal_packets = BENCHMARK_SIGNAL_FRAMES/BENCHMARK_PACKET_FRAMES;
+    unsigned int     i;
+    double           bytes = 0.0;
+    ATX_Int64        start;
+    double           seconds;
+
+    BLT_AlacEncoder_Create(BENCHMARK_PACKET_FRAMES, compress, &encoder);
+    packet = (BLT_UInt8*)malloc(BLT_AlacEncoder_GetMaxFrameSize(encoder));
+
+    /* what the output does for each packet, minus the network */
+    start = GetTime();
+    for (i=0; i<packet_count; i++) {
+        const BLT_Int16* samples = signal+2*BENCHMARK_PACKET_FRAMES*(i%signal_packets);
+        BLT_Size         size = BLT_AlacEncoder_EncodeFrame(encoder, samples, BENCHMARK_PACKET_FRAMES, packet);
+        if (cipher) {
+            BLT_AesCbc_Encrypt(cipher, iv, packet, packet, size/BLT_AES_CBC_BLOCK_SIZE);
+        }
+        bytes += (double)size;
+    }
+    seconds = (double)(GetTime()-start)/1000000000.0;
+    if (seconds <= 0.0) seconds = 1e-9;
+
+    printf("%-12s %-9s %9.0f packets/s %7.0fx realtime, %5.1f%% of raw size\n",
+           compress ? "compressed" : "uncompressed",
+           cipher   ? "aes"        : "clear",
+           (double)packet_count/seconds,
+           (double)BENCHMARK_AUDIO_DURATION/seconds,
+           100.0*bytes/((double)packet_count*BENCHMARK_PACKET_FRAMES*4));
+
+    free(packet);
+    BLT_AlacEncoder_Destroy(encoder);
+}
+
+/*----------------------------------------------------------------------
+|    main
++---------------------------------------------------------------------*/
+int
+main(int argc, char** argv)
+{
+    BLT_Int16*      signal = MakeSignal();
+    const BLT_UInt8 key[BLT_AES_CBC_KEY_SIZE] = {0};
+    BLT_AesCbc*     cipher = NULL;
+
+    BLT_COMPILER_UNUSED(argc);
+    BLT_COMPILER_UNUSED(argv);
+
+    /* one thread, so these are the rates for one core */
+    Run(signal, BLT_FALSE, NULL);
+    Run(signal, BLT_TRUE,  NULL);
+    if (BLT_SUCCEEDED(BLT_AesCbc_Create(key, &cipher))) {
+        Run(signal, BLT_FALSE, cipher);
+        Run(signal, BLT_TRUE,  cipher);
+        BLT_AesCbc_Destroy(cipher);
+    } else {
+        printf("no AES instructions on this CPU, the output uses the software cipher\n");
+    }
+
+    free(signal);
+    return 0;
+}
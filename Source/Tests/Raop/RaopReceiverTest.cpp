@@ -0,0 +1,374 @@
+/*****************************************************************
+|
+|   BlueTune - RAOP Receiver Test
+|
+|   (c) 2002-2012 Gilles Boccon-Gibod
+|   Author: Gilles Boccon-Gibod (bok@bok.net)
+|
+ ****************************************************************/
+
+/*----------------------------------------------------------------------
+|    includes
++---------------------------------------------------------------------*/
+#include <stdio.h>
+#include <stdlib.h>
+#include <math.h>
+
+#include "Atomix.h"
+#include "Neptune.h"
+#include "BlueTune.h"
+
+/*----------------------------------------------------------------------
+|    constants
++---------------------------------------------------------------------*/
+const unsigned int TEST_SAMPLE_RATE     = 44100;
+const unsigned int TEST_DURATION        = 6;   // seconds of audio
+const unsigned int TEST_PACKET_FRAMES   = 352;
+const unsigned int TEST_DROP_INTERVAL   = 25;  // every Nth packet is "lost"
+const unsigned int TEST_AUDIO_LATENCY   = 88200;
+const NPT_Timeout  TEST_RECEIVE_TIMEOUT = 5000;
+const char* const  TEST_INPUT_FILE      = "RaopReceiverTest.wav";
+
+/*----------------------------------------------------------------------
+|    CHECK
++---------------------------------------------------------------------*/
+#define CHECK(x)                                        \
+do {                                                    \
+    if (!(x)) {                                         \
+        fprintf(stderr, "FAILED line %d\n", __LINE__);  \
+        exit(1);                                        \
+    }                                                   \
+} while(0)
+
+/*----------------------------------------------------------------------
+|    GetTime
++---------------------------------------------------------------------*/
+static double
+GetTime()
+{
+    NPT_TimeStamp now;
+    NPT_System::GetCurrentTimeStamp(now);
+    return (double)now;
+}
+
+/*----------------------------------------------------------------------
+|    BindUdpSocket
++---------------------------------------------------------------------*/
+static unsigned int
+BindUdpSocket(NPT_UdpSocket& socket)
+{
+    // let the system pick the port, so we don't collide with the sender
+    NPT_SocketAddress address(NPT_IpAddress::Any, 0);
+    CHECK(NPT_SUCCEEDED(socket.Bind(address, false)));
+    NPT_SocketInfo info;
+    socket.GetInfo(info);
+    return info.local_address.GetPort();
+}
+
+/*----------------------------------------------------------------------
+|    StandInReceiver
+|
+|    Just enough of a receiver to play along: it answers the RTSP
+|    requests, records when each audio packet arrives, pretends to lose
+|    some of them and asks for those to be resent.
++---------------------------------------------------------------------*/
+class StandInReceiver {
+public:
+    StandInReceiver();
+
+    class RtspThread : public NPT_Thread {
+    public:
+        RtspThread(StandInReceiver& receiver) : m_Receiver(receiver) {}
+        virtual void Run() { m_Receiver.ServeRtsp(); }
+        StandInReceiver& m_Receiver;
+    };
+    class AudioThread : public NPT_Thread {
+    public:
+        AudioThread(StandInReceiver& receiver) : m_Receiver(receiver) {}
+        virtual void Run() { m_Receiver.ReceiveAudio(); }
+        StandInReceiver& m_Receiver;
+    };
+    class ControlThread : public NPT_Thread {
+    public:
+        ControlThread(StandInReceiver& receiver) : m_Receiver(receiver) {}
+        virtual void Run() { m_Receiver.ReceiveControl(); }
+        StandInReceiver& m_Receiver;
+    };
+
+    void ServeRtsp();
+    void ReceiveAudio();
+    void ReceiveControl();
+
+    // members
+    NPT_TcpServerSocket m_RtspSocket;
+    NPT_UdpSocket       m_AudioSocket;
+    NPT_UdpSocket       m_ControlSocket;
+    NPT_UdpSocket       m_TimingSocket;
+    unsigned int        m_RtspPort;
+    unsigned int        m_AudioPort;
+    unsigned int        m_ControlPort;
+    unsigned int        m_TimingPort;
+    NPT_SocketAddress   m_SenderControlAddress;
+    NPT_Mutex           m_Lock;
+    NPT_Map<NPT_UInt16, NPT_DataBuffer> m_Dropped;
+    unsigned int        m_PacketCount;
+    unsigned int        m_DropCount;
+    unsigned int        m_ResendCount;
+    unsigned int        m_SyncCount;
+    double              m_FirstArrival;
+    double              m_LastArrival;
+    double              m_MaxGap;
+};
+
+/*----------------------------------------------------------------------
+|    StandInReceiver::StandInReceiver
++---------------------------------------------------------------------*/
+StandInReceiver::StandInReceiver() :
+    m_PacketCount(0),
+    m_DropCount(0),
+    m_ResendCount(0),
+    m_SyncCount(0),
+    m_FirstArrival(0.0),
+    m_LastArrival(0.0),
+    m_MaxGap(0.0)
+{
+    NPT_SocketAddress address(NPT_IpAddress::Any, 0);
+    CHECK(NPT_SUCCEEDED(m_RtspSocket.Bind(address)));
+    CHECK(NPT_SUCCEEDED(m_RtspSocket.Listen(1)));
+    NPT_SocketInfo info;
+    m_RtspSocket.GetInfo(info);
+    m_RtspPort    = info.local_address.GetPort();
+    m_AudioPort   = BindUdpSocket(m_AudioSocket);
+    m_ControlPort = BindUdpSocket(m_ControlSocket);
+    m_TimingPort  = BindUdpSocket(m_TimingSocket);
+    m_AudioSocket.SetReadTimeout(TEST_RECEIVE_TIMEOUT);
+    m_ControlSocket.SetReadTimeout(TEST_RECEIVE_TIMEOUT);
+}
+
+/*----------------------------------------------------------------------
+|    StandInReceiver::ServeRtsp
++---------------------------------------------------------------------*/
+void
+StandInReceiver::ServeRtsp()
+{
+    NPT_Socket* client = NULL;
+    CHECK(NPT_SUCCEEDED(m_RtspSocket.WaitForNewClient(client)));
+    NPT_InputStreamReference  input;
+    NPT_OutputStreamReference output;
+    client->GetInputStream(input);
+    client->GetOutputStream(output);
+    NPT_BufferedInputStream request(input);
+
+    for (;;) {
+        // read the request line and headers
+        NPT_String line;
+        if (NPT_FAILED(request.ReadLine(line))) break;
+        if (line.IsEmpty()) continue;
+        NPT_String   command = line.Left(line.Find(' '));
+        NPT_String   cseq;
+        NPT_String   transport;
+        unsigned int content_length = 0;
+        for (;;) {
+            NPT_String header;
+            CHECK(NPT_SUCCEEDED(request.ReadLine(header)));
+            if (header.IsEmpty()) break;
+            if (header.StartsWith("CSeq: ")) cseq = header.GetChars()+6;
+            if (header.StartsWith("Transport: ")) transport = header.GetChars()+11;
+            if (header.StartsWith("Content-Length: ")) {
+                NPT_ParseInteger(header.GetChars()+16, content_length);
+            }
+        }
+        if (content_length) {
+            NPT_DataBuffer body(content_length);
+            CHECK(NPT_SUCCEEDED(request.ReadFully(body.UseData(), content_length)));
+        }
+
+        // respond
+        NPT_String response = "RTSP/1.0 200 OK\r\nCSeq: "+cseq+"\r\n";
+        if (command == "SETUP") {
+            // remember where the sender expects resend responses
+            int position = transport.Find("control_port=");
+            CHECK(position >= 0);
+            unsigned int sender_control_port = 0;
+            NPT_ParseInteger(transport.GetChars()+position+13, sender_control_port, true);
+            NPT_IpAddress localhost;
+            localhost.ResolveName("localhost");
+            m_SenderControlAddress = NPT_SocketAddress(localhost, sender_control_port);
+
+            response += "Session: 1\r\n";
+            response += NPT_String::Format("Transport: RTP/AVP/UDP;unicast;mode=record;server_port=%d;control_port=%d;timing_port=%d\r\n",
+                                           m_AudioPort, m_ControlPort, m_TimingPort);
+        } else if (command == "RECORD") {
+            response += NPT_String::Format("Audio-Latency: %d\r\n", TEST_AUDIO_LATENCY);
+        }
+        response += "\r\n";
+        output->WriteFully(response.GetChars(), response.GetLength());
+        if (command == "TEARDOWN") break;
+    }
+
+    delete client;
+}
+
+/*----------------------------------------------------------------------
+|    StandInReceiver::ReceiveAudio
++---------------------------------------------------------------------*/
+void
+StandInReceiver::ReceiveAudio()
+{
+    NPT_DataBuffer packet(2048);
+    NPT_DataBuffer resend_request;
+    resend_request.SetDataSize(8);
+
+    for (;;) {
+        if (NPT_FAILED(m_AudioSocket.Receive(packet))) break;
+        double now = GetTime();
+        CHECK(packet.GetDataSize() > 12);
+        const unsigned char* data = packet.GetData();
+        CHECK((data[1]&0x7F) == 0x60);
+        NPT_UInt16 sequence = NPT_BytesToInt16Be(&data[2]);
+
+        NPT_AutoLock lock(m_Lock);
+        if (m_PacketCount) {
+            if (now-m_LastArrival > m_MaxGap) m_MaxGap = now-m_LastArrival;
+        } else {
+            m_FirstArrival = now;
+        }
+        m_LastArrival = now;
+        ++m_PacketCount;
+
+        // lose some, and ask for them again
+        if ((sequence%TEST_DROP_INTERVAL) == TEST_DROP_INTERVAL-1) {
+            m_Dropped.Put(sequence, packet);
+            ++m_DropCount;
+            unsigned char* request = resend_request.UseData();
+            request[0] = 0x80;
+            request[1] = 0xD5;
+            NPT_BytesFromInt16Be(&request[2], m_DropCount);
+            NPT_BytesFromInt16Be(&request[4], sequence);
+            NPT_BytesFromInt16Be(&request[6], 1);
+            m_ControlSocket.Send(resend_request, &m_SenderControlAddress);
+        }
+    }
+}
+
+/*----------------------------------------------------------------------
+|    StandInReceiver::ReceiveControl
++---------------------------------------------------------------------*/
+void
+StandInReceiver::ReceiveControl()
+{
+    NPT_DataBuffer packet(2048);
+
+    for (;;) {
+        if (NPT_FAILED(m_ControlSocket.Receive(packet))) break;
+        CHECK(packet.GetDataSize() >= 8);
+        const unsigned char* data = packet.GetData();
+        unsigned int type = data[1]&0x7F;
+
+        NPT_AutoLock lock(m_Lock);
+        if (type == 0x54) {
+            ++m_SyncCount;
+        } else if (type == 0x56) {
+            // a resent packet must be exactly the one that was lost
+            CHECK(packet.GetDataSize() > 4+12);
+            NPT_UInt16 sequence = NPT_BytesToInt16Be(&data[4+2]);
+            NPT_DataBuffer* dropped = NULL;
+            CHECK(NPT_SUCCEEDED(m_Dropped.Get(sequence, dropped)));
+            CHECK(dropped->GetDataSize() == packet.GetDataSize()-4);
+            CHECK(NPT_MemoryEqual(dropped->GetData(), data+4, dropped->GetDataSize()));
+            m_Dropped.Erase(sequence);
+            ++m_ResendCount;
+        }
+    }
+}
+
+/*----------------------------------------------------------------------
+|    WriteInputFile
++---------------------------------------------------------------------*/
+static void
+WriteInputFile()
+{
+    unsigned int  frame_count = TEST_SAMPLE_RATE*TEST_DURATION;
+    unsigned char header[44] = {
+        'R','I','F','F', 0,0,0,0, 'W','A','V','E',
+        'f','m','t',' ', 16,0,0,0, 1,0, 2,0, 0,0,0,0, 0,0,0,0, 4,0, 16,0,
+        'd','a','t','a', 0,0,0,0
+    };
+    ATX_BytesFromInt32Le(&header[4],  36+frame_count*4);
+    ATX_BytesFromInt32Le(&header[24], TEST_SAMPLE_RATE);
+    ATX_BytesFromInt32Le(&header[28], TEST_SAMPLE_RATE*4);
+    ATX_BytesFromInt32Le(&header[40], frame_count*4);
+
+    FILE* file = fopen(TEST_INPUT_FILE, "wb");
+    CHECK(file != NULL);
+    fwrite(header, sizeof(header), 1, file);
+    for (unsigned int i=0; i<frame_count; i++) {
+        unsigned char sample[4];
+        short         value = (short)(8000.0*sin(2.0*3.14159265358979*440.0*(double)i/TEST_SAMPLE_RATE));
+        ATX_BytesFromInt16Le(&sample[0], (ATX_UInt16)value);
+        ATX_BytesFromInt16Le(&sample[2], (ATX_UInt16)value);
+        fwrite(sample, sizeof(sample), 1, file);
+    }
+    fclose(file);
+}
+
+/*----------------------------------------------------------------------
+|    main
++---------------------------------------------------------------------*/
+int
+main(int /*argc*/, char** /*argv*/)
+{
+    WriteInputFile();
+
+    StandInReceiver receiver;
+    StandInReceiver::RtspThread    rtsp_thread(receiver);
+    StandInReceiver::AudioThread   audio_thread(receiver);
+    StandInReceiver::ControlThread control_thread(receiver);
+    rtsp_thread.Start();
+    audio_thread.Start();
+    control_thread.Start();
+
+    // play the file to the receiver
+    BLT_Decoder* decoder = NULL;
+    CHECK(BLT_SUCCEEDED(BLT_Decoder_Create(&decoder)));
+    CHECK(BLT_SUCCEEDED(BLT_Decoder_RegisterBuiltins(decoder)));
+    NPT_String output_name = NPT_String::Format("raop://127.0.0.1:%d", receiver.m_RtspPort);
+    CHECK(BLT_SUCCEEDED(BLT_Decoder_SetOutput(decoder, output_name, "audio/pcm")));
+    CHECK(BLT_SUCCEEDED(BLT_Decoder_SetInput(decoder, TEST_INPUT_FILE, NULL)));
+
+    double start = GetTime();
+    while (BLT_SUCCEEDED(BLT_Decoder_PumpPacket(decoder))) {}
+    double pumped = GetTime()-start;
+    BLT_Decoder_Drain(decoder);
+    double drained = GetTime()-start;
+    BLT_Decoder_Stop(decoder);
+    BLT_Decoder_Destroy(decoder);
+
+    // wait for the receiver to time out on its sockets
+    audio_thread.Wait();
+    control_thread.Wait();
+    rtsp_thread.Wait();
+
+    unsigned int expected = (TEST_SAMPLE_RATE*TEST_DURATION+TEST_PACKET_FRAMES-1)/TEST_PACKET_FRAMES;
+    double       span     = receiver.m_LastArrival-receiver.m_FirstArrival;
+    printf("pumped in %.2fs, drained in %.2fs\n", pumped, drained);
+    printf("%d packets over %.2fs, largest gap %.1fms, %d syncs\n",
+           receiver.m_PacketCount, span, receiver.m_MaxGap*1000.0, receiver.m_SyncCount);
+    printf("%d dropped, %d resent\n", receiver.m_DropCount, receiver.m_ResendCount);
+
+    // the decoder ran ahead of the playback, by about the queue length,
+    // and only the sender waited
+    CHECK(pumped < (double)TEST_DURATION-1.0);
+    CHECK(drained > (double)TEST_DURATION-0.5);
+
+    // everything arrived, in real time, and every lost packet came back
+    CHECK(receiver.m_PacketCount == expected);
+    CHECK(fabs(span-(double)(expected-1)*TEST_PACKET_FRAMES/TEST_SAMPLE_RATE) < 0.1);
+    CHECK(receiver.m_MaxGap < 0.05);
+    CHECK(receiver.m_SyncCount > 0);
+    CHECK(receiver.m_DropCount > 0);
+    CHECK(receiver.m_ResendCount == receiver.m_DropCount);
+
+    printf("PASSED\n");
+    return 0;
+}
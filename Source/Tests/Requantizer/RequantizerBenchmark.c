@@ -0,0 +1,132 @@
+/*****************************************************************
+|
+|   BlueTune - Requantizer Benchmark
+|
+|   (c) 2002-2012 Gilles Boccon-Gibod
+|   Author: Gilles Boccon-Gibod (bok@bok.net)
+|
+****************************************************************/
+
+/*----------------------------------------------------------------------
+|    includes
++---------------------------------------------------------------------*/
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+
+#include "Atomix.h"
+#include "BltConfig.h"
+#include "BltErrors.h"
+#include "BltRequantizer.h"
+
+/*----------------------------------------------------------------------
+|    constants
++---------------------------------------------------------------------*/
+#define BENCHMARK_SAMPLE_RATE    48000
+#define BENCHMARK_CHANNEL_COUNT  2
+#define BENCHMARK_BLOCK_FRAMES   1024 /* frames per call, like a decoded packet */
+#define BENCHMARK_AUDIO_DURATION 600  /* seconds of audio requantized per run */
+#define BENCHMARK_SIGNAL_FRAMES  (BENCHMARK_SAMPLE_RATE*10)
+
+/*----------------------------------------------------------------------
+|    GetTime
++---------------------------------------------------------------------*/
+static ATX_Int64
+GetTime(void)
+{
+    ATX_TimeStamp now;
+    ATX_Int64     now_int = 0;
+
+    ATX_System_GetCurrentTimeStamp(&now);
+    ATX_TimeStamp_ToInt64(now, now_int);
+
+    return now_int;
+}
+
+/*----------------------------------------------------------------------
+|    MakeSignal
+|
+|    A quiet passage, where dither matters most: a few partials 40 dB
+|    down with a slow envelope, and a stereo image.
++---------------------------------------------------------------------*/
+static float*
+MakeSignal(void)
+{
+    float*       samples = (float*)malloc(BENCHMARK_SIGNAL_FRAMES*BENCHMARK_CHANNEL_COUNT*sizeof(float));
+    unsigned int i;
+
+    for (i=0; i<BENCHMARK_SIGNAL_FRAMES; i++) {
+        double t        = (double)i/BENCHMARK_SAMPLE_RATE;
+        double envelope = 0.5+0.5*sin(t*0.7);
+        double mid      = envelope*(0.006*sin(2*M_PI*220.0*t)+
+                                    0.003*sin(2*M_PI*331.0*t+1.0));
+        double side     = envelope*0.002*sin(2*M_PI*440.0*t);
+
+        samples[2*i  ] = (float)(mid+side);
+        samples[2*i+1] = (float)(mid-side);
+    }
+
+    return samples;
+}
+
+/*----------------------------------------------------------------------
+|    Run
++---------------------------------------------------------------------*/
+static void
+Run(const float*           signal,
+    BLT_Cardinal           bits_per_sample,
+    BLT_RequantizerShaping shaping,
+    const char*            shaping_name)
+{
+    BLT_Requantizer requantizer;
+    float*          block = (float*)malloc(BENCHMARK_BLOCK_FRAMES*BENCHMARK_CHANNEL_COUNT*sizeof(float));
+    unsigned int    block_count = (BENCHMARK_AUDIO_DURATION*BENCHMARK_SAMPLE_RATE)/BENCHMARK_BLOCK_FRAMES;
+    unsigned int    signal_blocks = BENCHMARK_SIGNAL_FRAMES/BENCHMARK_BLOCK_FRAMES;
+    unsigned int    i;
+    ATX_Int64       start;
+    double          seconds;
+
+    BLT_Requantizer_Init(&requantizer, BENCHMARK_CHANNEL_COUNT, bits_per_sample, shaping);
+
+    /* the requantizer works in place, so each block is copied first, */
+    /* as the stream does when it narrows a decoded packet            */
+    start = GetTime();
+    for (i=0; i<block_count; i++) {
+        memcpy(block,
+               signal+BENCHMARK_CHANNEL_COUNT*BENCHMARK_BLOCK_FRAMES*(i%signal_blocks),
+               BENCHMARK_BLOCK_FRAMES*BENCHMARK_CHANNEL_COUNT*sizeof(float));
+        BLT_Requantizer_Process(&requantizer, block, BENCHMARK_BLOCK_FRAMES);
+    }
+    seconds = (double)(GetTime()-start)/1000000000.0;
+    if (seconds <= 0.0) seconds = 1e-9;
+
+    printf("%2u bits %-12s %7.1f Msamples/s %7.0fx realtime\n",
+           (unsigned int)bits_per_sample,
+           shaping_name,
+           (double)block_count*BENCHMARK_BLOCK_FRAMES*BENCHMARK_CHANNEL_COUNT/seconds/1000000.0,
+           (double)BENCHMARK_AUDIO_DURATION/seconds);
+
+    free(block);
+}
+
+/*----------------------------------------------------------------------
+|    main
++---------------------------------------------------------------------*/
+int
+main(int argc, char** argv)
+{
+    float* signal = MakeSignal();
+
+    BLT_COMPILER_UNUSED(argc);
+    BLT_COMPILER_UNUSED(argv);
+
+    /* one thread, so these are the rates for one core */
+    Run(signal, 16, BLT_REQUANTIZER_SHAPING_NONE,        "flat");
+    Run(signal, 16, BLT_REQUANTIZER_SHAPING_FIRST_ORDER, "first order");
+    Run(signal, 16, BLT_REQUANTIZER_SHAPING_WEIGHTED,    "weighted");
+    Run(signal, 24, BLT_REQUANTIZER_SHAPING_NONE,        "flat");
+
+    free(signal);
+    return 0;
+}
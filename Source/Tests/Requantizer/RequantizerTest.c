@@ -0,0 +1,273 @@
+/*****************************************************************
+|
+|   BlueTune - Requantizer Test
+|
+|   (c) 2002-2012 Gilles Boccon-Gibod
+|   Author: Gilles Boccon-Gibod (bok@bok.net)
+|
+****************************************************************/
+
+/*----------------------------------------------------------------------
+|    includes
++---------------------------------------------------------------------*/
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+
+#include "Atomix.h"
+#include "BltConfig.h"
+#include "BltErrors.h"
+#include "BltRequantizer.h"
+#include "TestUtils.h"
+
+/*----------------------------------------------------------------------
+|    constants
++---------------------------------------------------------------------*/
+#define TEST_SAMPLE_COUNT 480000
+#define TEST_BITS         16
+#define TEST_SCALE        32768.0
+#define TEST_BLOCK        64 /* samples summed by the low pass */
+
+/*----------------------------------------------------------------------
+|    CHECK
++---------------------------------------------------------------------*/
+#define CHECK(x)                                        \
+do {                                                    \
+    if (!(x)) {                                         \
+        fprintf(stderr, "FAILED line %d\n", __LINE__);  \
+        abort();                                        \
+    }                                                   \
+} while(0)
+
+/*----------------------------------------------------------------------
+|    MakeNoise: values all over the range, and some beyond it
++---------------------------------------------------------------------*/
+static void
+MakeNoise(float* samples, unsigned int sample_count)
+{
+    unsigned int seed = 1;
+    unsigned int i;
+
+    for (i=0; i<sample_count; i++) {
+        samples[i] = (float)((int)(TestUtils_Random(&seed)&0xFFFFF)-0x80000)/(float)0x70000;
+    }
+}
+
+/*----------------------------------------------------------------------
+|    Process: runs the requantizer in odd sized chunks
++---------------------------------------------------------------------*/
+static void
+Process(BLT_Requantizer* requantizer, float* samples, unsigned int frame_count)
+{
+    unsigned int chunk = 1;
+
+    while (frame_count) {
+        if (chunk > frame_count) chunk = frame_count;
+        BLT_Requantizer_Process(requantizer, samples, chunk);
+        samples     += chunk*requantizer->channel_count;
+        frame_count -= chunk;
+        chunk = (chunk*7+3)%1031;
+    }
+}
+
+/*----------------------------------------------------------------------
+|    TestGrid
+|
+|    Whatever the shaping, the width and the size of the calls, the
+|    samples come out on the grid of the target format, in its range,
+|    and the same as when processed in one call.
++---------------------------------------------------------------------*/
+static void
+TestGrid(void)
+{
+    static const unsigned int widths[] = { 8, 16, 20, 24 };
+    float*          input    = (float*)malloc(TEST_SAMPLE_COUNT*sizeof(float));
+    float*          whole    = (float*)malloc(TEST_SAMPLE_COUNT*sizeof(float));
+    float*          chunks   = (float*)malloc(TEST_SAMPLE_COUNT*sizeof(float));
+    unsigned int    frame_count;
+    unsigned int    shaping;
+    unsigned int    w;
+    unsigned int    channel_count;
+    unsigned int    i;
+    BLT_Requantizer requantizer;
+
+    MakeNoise(input, TEST_SAMPLE_COUNT);
+    for (shaping=BLT_REQUANTIZER_SHAPING_NONE; shaping<=BLT_REQUANTIZER_SHAPING_WEIGHTED; shaping++) {
+        for (w=0; w<sizeof(widths)/sizeof(widths[0]); w++) {
+            double scale = (double)(1L<<(widths[w]-1));
+            for (channel_count=1; channel_count<=3; channel_count++) {
+                frame_count = TEST_SAMPLE_COUNT/channel_count;
+
+                memcpy(whole, input, TEST_SAMPLE_COUNT*sizeof(float));
+                CHECK(BLT_SUCCEEDED(BLT_Requantizer_Init(&requantizer,
+                                                         channel_count,
+                                                         widths[w],
+                                                         (BLT_RequantizerShaping)shaping)));
+                BLT_Requantizer_Process(&requantizer, whole, frame_count);
+
+                memcpy(chunks, input, TEST_SAMPLE_COUNT*sizeof(float));
+                CHECK(BLT_SUCCEEDED(BLT_Requantizer_Init(&requantizer,
+                                                         channel_count,
+                                                         widths[w],
+                                                         (BLT_RequantizerShaping)shaping)));
+                Process(&requantizer, chunks, frame_count);
+
+                CHECK(memcmp(whole, chunks, frame_count*channel_count*sizeof(float)) == 0);
+                for (i=0; i<frame_count*channel_count; i++) {
+                    double value = (double)whole[i]*scale;
+                    CHECK(value == floor(value));
+                    CHECK(value >= -scale && value <= scale-1.0);
+                }
+            }
+        }
+    }
+
+    free(chunks);
+    free(whole);
+    free(input);
+}
+
+/*----------------------------------------------------------------------
+|    TestDither
+|
+|    With flat TPDF dither, the error has no bias and a power of a
+|    quarter of a step squared, whatever the signal, and it is white.
++---------------------------------------------------------------------*/
+static void
+TestDither(void)
+{
+    static const double levels[] = { 0.0, 0.25, 0.5, -100.3 };
+    float*          samples = (float*)malloc(TEST_SAMPLE_COUNT*sizeof(float));
+    double*         errors  = (double*)malloc(TEST_SAMPLE_COUNT*sizeof(double));
+    unsigned int    l;
+    unsigned int    lag;
+    unsigned int    i;
+    BLT_Requantizer requantizer;
+
+    CHECK(BLT_SUCCEEDED(BLT_Requantizer_Init(&requantizer, 2, TEST_BITS, BLT_REQUANTIZER_SHAPING_NONE)));
+    for (l=0; l<sizeof(levels)/sizeof(levels[0]); l++) {
+        float  input = (float)(levels[l]/TEST_SCALE);
+        double mean  = 0.0;
+        double power = 0.0;
+
+        for (i=0; i<TEST_SAMPLE_COUNT; i++) samples[i] = input;
+        Process(&requantizer, samples, TEST_SAMPLE_COUNT/2);
+        for (i=0; i<TEST_SAMPLE_COUNT; i++) {
+            errors[i] = ((double)samples[i]-(double)input)*TEST_SCALE;
+            CHECK(fabs(errors[i]) < 1.5);
+            mean  += errors[i];
+            power += errors[i]*errors[i];
+        }
+        mean  /= TEST_SAMPLE_COUNT;
+        power /= TEST_SAMPLE_COUNT;
+        CHECK(fabs(mean) < 0.005);
+        CHECK(fabs(power-0.25) < 0.01);
+
+        /* no correlation between neighbours, in a channel or across */
+        for (lag=1; lag<=8; lag++) {
+            double correlation = 0.0;
+            for (i=lag; i<TEST_SAMPLE_COUNT; i++) {
+                correlation += (errors[i]-mean)*(errors[i-lag]-mean);
+            }
+            CHECK(fabs(correlation/(TEST_SAMPLE_COUNT-lag)) < 0.01*power);
+        }
+    }
+
+    free(errors);
+    free(samples);
+}
+
+/*----------------------------------------------------------------------
+|    GetLowNoise
+|
+|    Requantizes a quiet signal, and returns the power of the error
+|    after a crude low pass (sums of TEST_BLOCK samples), in steps
+|    squared.
++---------------------------------------------------------------------*/
+static double
+GetLowNoise(BLT_RequantizerShaping shaping, double* sum)
+{
+    float*          samples = (float*)malloc(TEST_SAMPLE_COUNT*sizeof(float));
+    float*          input   = (float*)malloc(TEST_SAMPLE_COUNT*sizeof(float));
+    double          power   = 0.0;
+    unsigned int    i;
+    BLT_Requantizer requantizer;
+
+    for (i=0; i<TEST_SAMPLE_COUNT; i++) {
+        input[i] = (float)(10.0*sin((double)i*0.01)/TEST_SCALE);
+    }
+    memcpy(samples, input, TEST_SAMPLE_COUNT*sizeof(float));
+    CHECK(BLT_SUCCEEDED(BLT_Requantizer_Init(&requantizer, 1, TEST_BITS, shaping)));
+    Process(&requantizer, samples, TEST_SAMPLE_COUNT);
+
+    *sum = 0.0;
+    for (i=0; i<TEST_SAMPLE_COUNT; i++) {
+        double error = ((double)samples[i]-(double)input[i])*TEST_SCALE;
+        *sum += error;
+    }
+    for (i=0; i+TEST_BLOCK<=TEST_SAMPLE_COUNT; i += TEST_BLOCK) {
+        double       low = 0.0;
+        unsigned int k;
+        for (k=0; k<TEST_BLOCK; k++) {
+            low += ((double)samples[i+k]-(double)input[i+k])*TEST_SCALE;
+        }
+        power += low*low;
+    }
+
+    free(input);
+    free(samples);
+
+    return power/(TEST_SAMPLE_COUNT/TEST_BLOCK);
+}
+
+/*----------------------------------------------------------------------
+|    TestShaping
+|
+|    The shaped noise has less power at low frequencies than the flat
+|    one. With the first order filter, the errors cancel out, so their
+|    sum stays within the error of a single quantization.
++---------------------------------------------------------------------*/
+static void
+TestShaping(void)
+{
+    double flat_sum;
+    double first_order_sum;
+    double weighted_sum;
+    double flat        = GetLowNoise(BLT_REQUANTIZER_SHAPING_NONE,        &flat_sum);
+    double first_order = GetLowNoise(BLT_REQUANTIZER_SHAPING_FIRST_ORDER, &first_order_sum);
+    double weighted    = GetLowNoise(BLT_REQUANTIZER_SHAPING_WEIGHTED,    &weighted_sum);
+
+    CHECK(fabs(flat-TEST_BLOCK*0.25) < 0.1*TEST_BLOCK*0.25);
+    CHECK(first_order < 0.1*flat);
+    CHECK(weighted    < 0.3*flat);
+    CHECK(fabs(first_order_sum) < 1.5);
+}
+
+/*----------------------------------------------------------------------
+|    main
++---------------------------------------------------------------------*/
+int
+main(int argc, char** argv)
+{
+    BLT_Requantizer requantizer;
+
+    BLT_COMPILER_UNUSED(argc);
+    BLT_COMPILER_UNUSED(argv);
+
+    CHECK(BLT_Requantizer_Init(&requantizer, 0, 16, BLT_REQUANTIZER_SHAPING_NONE) ==
+          BLT_ERROR_NOT_SUPPORTED);
+    CHECK(BLT_Requantizer_Init(&requantizer, BLT_REQUANTIZER_MAX_CHANNELS+1, 16, BLT_REQUANTIZER_SHAPING_NONE) ==
+          BLT_ERROR_NOT_SUPPORTED);
+    CHECK(BLT_Requantizer_Init(&requantizer, 2, 7, BLT_REQUANTIZER_SHAPING_NONE) ==
+          BLT_ERROR_NOT_SUPPORTED);
+    CHECK(BLT_Requantizer_Init(&requantizer, 2, 25, BLT_REQUANTIZER_SHAPING_NONE) ==
+          BLT_ERROR_NOT_SUPPORTED);
+
+    TestGrid();
+    TestDither();
+    TestShaping();
+
+    printf("RequantizerTest passed\n");
+    return 0;
+}
@@ -0,0 +1,209 @@
+/*****************************************************************
+|
+|   BlueTune - Silence Remover Test
+|
+|   (c) 2002-2012 Gilles Boccon-Gibod
+|   Author: Gilles Boccon-Gibod (bok@bok.net)
+|
+****************************************************************/
+
+/*----------------------------------------------------------------------
+|    includes
++---------------------------------------------------------------------*/
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "Atomix.h"
+#include "BltConfig.h"
+#include "BltErrors.h"
+#include "BltDecoder.h"
+#include "BltSilenceRemover.h"
+#include "TestUtils.h"
+
+/*----------------------------------------------------------------------
+|    constants
++---------------------------------------------------------------------*/
+#define TEST_FILENAME      "SilenceRemoverTest.wav"
+#define TEST_SAMPLE_RATE   44100
+#define TEST_CHANNEL_COUNT 2
+
+/* the test file: quiet noise, a loud part, a long quiet part, a softer */
+/* part and quiet noise again, in 100th of seconds                      */
+#define TEST_LEAD          100
+#define TEST_LOUD          50
+#define TEST_GAP           300
+#define TEST_SOFT          50
+#define TEST_TAIL          200
+#define TEST_FRAMES(d)     ((d)*(TEST_SAMPLE_RATE/100))
+#define TEST_FRAME_COUNT   TEST_FRAMES(TEST_LEAD+TEST_LOUD+TEST_GAP+TEST_SOFT+TEST_TAIL)
+
+#define TEST_NOISE_LEVEL   40   /* under the default -54 dBFS (65) */
+#define TEST_LOUD_LEVEL    8192 /* -12 dBFS                        */
+#define TEST_SOFT_LEVEL    1000 /* -30 dBFS                        */
+
+/*----------------------------------------------------------------------
+|    CHECK
++---------------------------------------------------------------------*/
+#define CHECK(x)                                        \
+do {                                                    \
+    if (!(x)) {                                         \
+        fprintf(stderr, "FAILED line %d\n", __LINE__);  \
+        abort();                                        \
+    }                                                   \
+} while(0)
+
+/*----------------------------------------------------------------------
+|    GetTestSample
++---------------------------------------------------------------------*/
+static int
+GetTestSample(unsigned int frame, unsigned int channel)
+{
+    int sign = (frame+channel)&1 ? -1 : 1;
+
+    if (frame >= TEST_FRAMES(TEST_LEAD) &&
+        frame <  TEST_FRAMES(TEST_LEAD+TEST_LOUD)) {
+        return sign*TEST_LOUD_LEVEL;
+    }
+    if (frame >= TEST_FRAMES(TEST_LEAD+TEST_LOUD+TEST_GAP) &&
+        frame <  TEST_FRAMES(TEST_LEAD+TEST_LOUD+TEST_GAP+TEST_SOFT)) {
+        return sign*TEST_SOFT_LEVEL;
+    }
+
+    /* some noise, not just zeros */
+    return (int)((frame*7919+channel*31)%(2*TEST_NOISE_LEVEL+1))-TEST_NOISE_LEVEL;
+}
+
+/*----------------------------------------------------------------------
+|    WriteTestFile
++---------------------------------------------------------------------*/
+static void
+WriteTestFile(void)
+{
+    BLT_Int16*   samples = (BLT_Int16*)malloc(TEST_FRAME_COUNT*2*TEST_CHANNEL_COUNT);
+    unsigned int i;
+    unsigned int c;
+
+    CHECK(samples != NULL);
+    for (i=0; i<TEST_FRAME_COUNT; i++) {
+        for (c=0; c<TEST_CHANNEL_COUNT; c++) {
+            samples[i*TEST_CHANNEL_COUNT+c] = (BLT_Int16)GetTestSample(i, c);
+        }
+    }
+    CHECK(BLT_SUCCEEDED(TestUtils_WriteWavFile(TEST_FILENAME, samples, TEST_FRAME_COUNT,
+                                               TEST_CHANNEL_COUNT, TEST_SAMPLE_RATE)));
+    free(samples);
+}
+
+/*----------------------------------------------------------------------
+|    Run
+|
+|    Decodes the test file through the silence remover, with some
+|    settings, and collects what comes out.
++---------------------------------------------------------------------*/
+static void
+Run(TestCollector* collector, int mode, int threshold, int min_duration)
+{
+    BLT_Decoder*      decoder = NULL;
+    ATX_Properties*   properties = NULL;
+    ATX_PropertyValue value;
+
+    CHECK(BLT_SUCCEEDED(BLT_Decoder_Create(&decoder)));
+    BLT_Decoder_RegisterBuiltins(decoder);
+#if !defined(BLT_CONFIG_MODULES_ENABLE_SILENCE_REMOVER)
+    {
+        BLT_Module* module = NULL;
+        CHECK(BLT_SUCCEEDED(BLT_SilenceRemoverModule_GetModuleObject(&module)));
+        BLT_Decoder_RegisterModule(decoder, module);
+        ATX_RELEASE_OBJECT(module);
+    }
+#endif
+
+    CHECK(BLT_SUCCEEDED(TestCollector_SetAsOutput(collector, decoder)));
+    CHECK(BLT_SUCCEEDED(BLT_Decoder_SetInput(decoder, TEST_FILENAME, NULL)));
+
+    /* the settings are read when the node is activated, and the */
+    /* stream properties are cleared when the input is set       */
+    CHECK(BLT_SUCCEEDED(BLT_Decoder_GetStreamProperties(decoder, &properties)));
+    value.type         = ATX_PROPERTY_VALUE_TYPE_INTEGER;
+    value.data.integer = mode;
+    ATX_Properties_SetProperty(properties, BLT_SILENCE_REMOVER_MODE, &value);
+    value.data.integer = threshold;
+    ATX_Properties_SetProperty(properties, BLT_SILENCE_REMOVER_THRESHOLD, &value);
+    value.data.integer = min_duration;
+    ATX_Properties_SetProperty(properties, BLT_SILENCE_REMOVER_MIN_DURATION, &value);
+
+    CHECK(BLT_SUCCEEDED(BLT_Decoder_AddNodeByName(decoder, NULL, "SilenceRemover")));
+
+    CHECK(TestUtils_PumpToEnd(decoder) == BLT_ERROR_EOS);
+
+    BLT_Decoder_Destroy(decoder);
+}
+
+/*----------------------------------------------------------------------
+|    CheckFrames
+|
+|    Checks that frames of the output are frames of the input, starting
+|    at a given input frame.
++---------------------------------------------------------------------*/
+static void
+CheckFrames(const TestCollector* collector,
+            unsigned int         first,
+            unsigned int         count,
+            unsigned int         input_first)
+{
+    unsigned int i;
+    unsigned int c;
+
+    CHECK(first+count <= collector->frame_count);
+    for (i=0; i<count; i++) {
+        for (c=0; c<TEST_CHANNEL_COUNT; c++) {
+            CHECK(collector->samples[(first+i)*TEST_CHANNEL_COUNT+c] ==
+                  GetTestSample(input_first+i, c));
+        }
+    }
+}
+
+/*----------------------------------------------------------------------
+|    main
++---------------------------------------------------------------------*/
+int
+main(int argc, char** argv)
+{
+    TestCollector collector;
+    unsigned int  loud = TEST_FRAMES(TEST_LOUD);
+    unsigned int  gap  = TEST_FRAMES(TEST_GAP);
+    unsigned int  soft = TEST_FRAMES(TEST_SOFT);
+    unsigned int  kept;
+
+    BLT_COMPILER_UNUSED(argc);
+    BLT_COMPILER_UNUSED(argv);
+
+    WriteTestFile();
+
+    CHECK(BLT_SUCCEEDED(TestCollector_Construct(&collector, TEST_CHANNEL_COUNT, TEST_FRAME_COUNT)));
+
+    /* trim: everything from the first to the last loud frame, exactly */
+    Run(&collector, BLT_SILENCE_REMOVER_MODE_TRIM, -5400, 1000);
+    CHECK(collector.frame_count == loud+gap+soft);
+    CheckFrames(&collector, 0, loud+gap+soft, TEST_FRAMES(TEST_LEAD));
+
+    /* collapse: the gap is shortened to the minimum duration, and the */
+    /* frames that are kept are the ones at its start                 */
+    Run(&collector, BLT_SILENCE_REMOVER_MODE_COLLAPSE, -5400, 1000);
+    kept = TEST_SAMPLE_RATE;
+    CHECK(collector.frame_count == loud+kept+soft);
+    CheckFrames(&collector, 0, loud+kept, TEST_FRAMES(TEST_LEAD));
+    CheckFrames(&collector, loud+kept, soft, TEST_FRAMES(TEST_LEAD+TEST_LOUD+TEST_GAP));
+
+    /* a threshold above the soft part: it is silence too */
+    Run(&collector, BLT_SILENCE_REMOVER_MODE_TRIM, -2000, 1000);
+    CHECK(collector.frame_count == loud);
+    CheckFrames(&collector, 0, loud, TEST_FRAMES(TEST_LEAD));
+
+    remove(TEST_FILENAME);
+    TestCollector_Destruct(&collector);
+
+    printf("SilenceRemoverTest passed\n");
+    return 0;
+}
@@ -0,0 +1,493 @@
+/*****************************************************************
+|
+|   BlueTune - Tee Output Test
+|
+|   (c) 2002-2012 Gilles Boccon-Gibod
+|   Author: Gilles Boccon-Gibod (bok@bok.net)
+|
+****************************************************************/
+
+/*----------------------------------------------------------------------
+|    includes
++---------------------------------------------------------------------*/
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+
+#include "Atomix.h"
+#include "BltConfig.h"
+#include "BltErrors.h"
+#include "BltCore.h"
+#include "BltMediaNode.h"
+#include "BltMedia.h"
+#include "BltPcm.h"
+#include "BltPacketConsumer.h"
+#include "BltDecoder.h"
+#include "BltTeeOutput.h"
+#include "TestUtils.h"
+
+/*----------------------------------------------------------------------
+|    constants
++---------------------------------------------------------------------*/
+#define TEST_FILENAME      "TeeOutputTest.wav"
+#define TEST_SAMPLE_RATE   44100
+#define TEST_CHANNEL_COUNT 2
+#define TEST_FRAME_COUNT   TEST_SAMPLE_RATE /* 1 second */
+#define TEST_SAMPLE_COUNT  (TEST_FRAME_COUNT*TEST_CHANNEL_COUNT)
+#define TEST_LATENCY       100 /* ms, of the first output in the second test */
+#define TEST_SLOT_COUNT    2
+#define TEST_PI            3.14159265358979323846
+
+/*----------------------------------------------------------------------
+|    CHECK
++---------------------------------------------------------------------*/
+#define CHECK(x)                                        \
+do {                                                    \
+    if (!(x)) {                                         \
+        fprintf(stderr, "FAILED line %d\n", __LINE__);  \
+        abort();                                        \
+    }                                                   \
+} while(0)
+
+/*----------------------------------------------------------------------
+|    types
++---------------------------------------------------------------------*/
+/* what a capture output received, written by the thread that feeds it */
+typedef struct {
+    unsigned char*   data;
+    unsigned int     size;
+    BLT_PcmMediaType media_type; /* of the last packet */
+} CaptureSlot;
+
+typedef struct {
+    /* base class */
+    ATX_EXTENDS(BLT_BaseModule);
+} CaptureOutputModule;
+
+typedef struct {
+    /* base class */
+    ATX_EXTENDS   (BLT_BaseMediaNode);
+
+    /* interfaces */
+    ATX_IMPLEMENTS(BLT_PacketConsumer);
+    ATX_IMPLEMENTS(BLT_MediaPort);
+
+    /* members */
+    CaptureSlot*   slot;
+    BLT_MediaType* expected_media_type;
+} CaptureOutput;
+
+/*----------------------------------------------------------------------
+|    globals
++---------------------------------------------------------------------*/
+static CaptureSlot CaptureSlots[TEST_SLOT_COUNT];
+static BLT_Int16   TestSamples[TEST_SAMPLE_COUNT];
+
+/*----------------------------------------------------------------------
+|    forward declarations
++---------------------------------------------------------------------*/
+ATX_DECLARE_INTERFACE_MAP(CaptureOutputModule, BLT_Module)
+
+ATX_DECLARE_INTERFACE_MAP(CaptureOutput, BLT_MediaNode)
+ATX_DECLARE_INTERFACE_MAP(CaptureOutput, ATX_Referenceable)
+ATX_DECLARE_INTERFACE_MAP(CaptureOutput, BLT_MediaPort)
+ATX_DECLARE_INTERFACE_MAP(CaptureOutput, BLT_PacketConsumer)
+
+/*----------------------------------------------------------------------
+|    CaptureOutput_PutPacket
++---------------------------------------------------------------------*/
+BLT_METHOD
+CaptureOutput_PutPacket(BLT_PacketConsumer* _self,
+                        BLT_MediaPacket*    packet)
+{
+    CaptureOutput*          self = ATX_SELF(CaptureOutput, BLT_PacketConsumer);
+    const BLT_PcmMediaType* media_type;
+    const BLT_PcmMediaType* expected;
+    BLT_Size                size = BLT_MediaPacket_GetPayloadSize(packet);
+
+    /* only take the format we asked for */
+    BLT_MediaPacket_GetMediaType(packet, (const BLT_MediaType**)(const void*)&media_type);
+    if (media_type->base.id != BLT_MEDIA_TYPE_ID_AUDIO_PCM) {
+        return BLT_ERROR_INVALID_MEDIA_TYPE;
+    }
+    expected = (const BLT_PcmMediaType*)self->expected_media_type;
+    if (expected->base.id == BLT_MEDIA_TYPE_ID_AUDIO_PCM &&
+        expected->bits_per_sample &&
+        (expected->bits_per_sample != media_type->bits_per_sample ||
+         expected->sample_format   != media_type->sample_format)) {
+        return BLT_ERROR_INVALID_MEDIA_TYPE;
+    }
+
+    self->slot->media_type = *media_type;
+    self->slot->data = (unsigned char*)realloc(self->slot->data, self->slot->size+size);
+    CHECK(self->slot->data != NULL);
+    if (size) {
+        memcpy(self->slot->data+self->slot->size, BLT_MediaPacket_GetPayloadBuffer(packet), size);
+    }
+    self->slot->size += size;
+
+    return BLT_SUCCESS;
+}
+
+/*----------------------------------------------------------------------
+|    CaptureOutput_QueryMediaType
++---------------------------------------------------------------------*/
+BLT_METHOD
+CaptureOutput_QueryMediaType(BLT_MediaPort*        _self,
+                             BLT_Ordinal           index,
+                             const BLT_MediaType** media_type)
+{
+    CaptureOutput* self = ATX_SELF(CaptureOutput, BLT_MediaPort);
+
+    if (index == 0) {
+        *media_type = self->expected_media_type;
+        return BLT_SUCCESS;
+    } else {
+        *media_type = NULL;
+        return BLT_FAILURE;
+    }
+}
+
+/*----------------------------------------------------------------------
+|    CaptureOutput_Create
+|
+|    The name is 'capture:<slot>', or 'capture:<slot>:<bits>' for an
+|    output that only takes signed samples of that width.
++---------------------------------------------------------------------*/
+static BLT_Result
+CaptureOutput_Create(BLT_Module*              module,
+                     BLT_Core*                core,
+                     BLT_ModuleParametersType parameters_type,
+                     BLT_CString              parameters,
+                     BLT_MediaNode**          object)
+{
+    CaptureOutput*            self;
+    BLT_MediaNodeConstructor* constructor = (BLT_MediaNodeConstructor*)parameters;
+    unsigned int              slot = 0;
+    unsigned int              bits = 0;
+
+    /* check parameters */
+    if (parameters == NULL ||
+        parameters_type != BLT_MODULE_PARAMETERS_TYPE_MEDIA_NODE_CONSTRUCTOR) {
+        return BLT_ERROR_INVALID_PARAMETERS;
+    }
+    if (sscanf(constructor->name+8, "%u:%u", &slot, &bits) < 1 || slot >= TEST_SLOT_COUNT) {
+        return BLT_ERROR_INVALID_PARAMETERS;
+    }
+
+    /* allocate memory for the object */
+    self = ATX_AllocateZeroMemory(sizeof(CaptureOutput));
+    if (self == NULL) {
+        *object = NULL;
+        return BLT_ERROR_OUT_OF_MEMORY;
+    }
+
+    /* construct the inherited object */
+    BLT_BaseMediaNode_Construct(&ATX_BASE(self, BLT_BaseMediaNode), module, core);
+
+    /* the format it expects */
+    self->slot = &CaptureSlots[slot];
+    if (bits) {
+        BLT_PcmMediaType media_type;
+        BLT_PcmMediaType_Init(&media_type);
+        media_type.bits_per_sample = (BLT_UInt8)bits;
+        media_type.sample_format   = BLT_PCM_SAMPLE_FORMAT_SIGNED_INT_NE;
+        BLT_MediaType_Clone(&media_type.base, &self->expected_media_type);
+    } else {
+        BLT_MediaType_Clone(constructor->spec.input.media_type, &self->expected_media_type);
+    }
+
+    /* setup interfaces */
+    ATX_SET_INTERFACE_EX(self, CaptureOutput, BLT_BaseMediaNode, BLT_MediaNode);
+    ATX_SET_INTERFACE_EX(self, CaptureOutput, BLT_BaseMediaNode, ATX_Referenceable);
+    ATX_SET_INTERFACE(self, CaptureOutput, BLT_PacketConsumer);
+    ATX_SET_INTERFACE(self, CaptureOutput, BLT_MediaPort);
+    *object = &ATX_BASE_EX(self, BLT_BaseMediaNode, BLT_MediaNode);
+
+    return BLT_SUCCESS;
+}
+
+/*----------------------------------------------------------------------
+|    CaptureOutput_Destroy
++---------------------------------------------------------------------*/
+static BLT_Result
+CaptureOutput_Destroy(CaptureOutput* self)
+{
+    BLT_MediaType_Free(self->expected_media_type);
+    BLT_BaseMediaNode_Destruct(&ATX_BASE(self, BLT_BaseMediaNode));
+    ATX_FreeMemory(self);
+
+    return BLT_SUCCESS;
+}
+
+/*----------------------------------------------------------------------
+|   CaptureOutput_GetPortByName
++---------------------------------------------------------------------*/
+BLT_METHOD
+CaptureOutput_GetPortByName(BLT_MediaNode*  _self,
+                            BLT_CString     name,
+                            BLT_MediaPort** port)
+{
+    CaptureOutput* self = ATX_SELF_EX(CaptureOutput, BLT_BaseMediaNode, BLT_MediaNode);
+
+    if (ATX_StringsEqual(name, "input")) {
+        *port = &ATX_BASE(self, BLT_MediaPort);
+        return BLT_SUCCESS;
+    } else {
+        *port = NULL;
+        return BLT_ERROR_NO_SUCH_PORT;
+    }
+}
+
+/*----------------------------------------------------------------------
+|   GetInterface implementation
++---------------------------------------------------------------------*/
+ATX_BEGIN_GET_INTERFACE_IMPLEMENTATION(CaptureOutput)
+    ATX_GET_INTERFACE_ACCEPT_EX(CaptureOutput, BLT_BaseMediaNode, BLT_MediaNode)
+    ATX_GET_INTERFACE_ACCEPT_EX(CaptureOutput, BLT_BaseMediaNode, ATX_Referenceable)
+    ATX_GET_INTERFACE_ACCEPT(CaptureOutput, BLT_MediaPort)
+    ATX_GET_INTERFACE_ACCEPT(CaptureOutput, BLT_PacketConsumer)
+ATX_END_GET_INTERFACE_IMPLEMENTATION
+
+/*----------------------------------------------------------------------
+|    BLT_MediaPort interface
++---------------------------------------------------------------------*/
+BLT_MEDIA_PORT_IMPLEMENT_SIMPLE_TEMPLATE(CaptureOutput, "input", PACKET, IN)
+ATX_BEGIN_INTERFACE_MAP(CaptureOutput, BLT_MediaPort)
+    CaptureOutput_GetName,
+    CaptureOutput_GetProtocol,
+    CaptureOutput_GetDirection,
+    CaptureOutput_QueryMediaType
+ATX_END_INTERFACE_MAP
+
+/*----------------------------------------------------------------------
+|    BLT_PacketConsumer interface
++---------------------------------------------------------------------*/
+ATX_BEGIN_INTERFACE_MAP(CaptureOutput, BLT_PacketConsumer)
+    CaptureOutput_PutPacket
+ATX_END_INTERFACE_MAP
+
+/*----------------------------------------------------------------------
+|    BLT_MediaNode interface
++---------------------------------------------------------------------*/
+ATX_BEGIN_INTERFACE_MAP_EX(CaptureOutput, BLT_BaseMediaNode, BLT_MediaNode)
+    BLT_BaseMediaNode_GetInfo,
+    CaptureOutput_GetPortByName,
+    BLT_BaseMediaNode_Activate,
+    BLT_BaseMediaNode_Deactivate,
+    BLT_BaseMediaNode_Start,
+    BLT_BaseMediaNode_Stop,
+    BLT_BaseMediaNode_Pause,
+    BLT_BaseMediaNode_Resume,
+    BLT_BaseMediaNode_Seek
+ATX_END_INTERFACE_MAP_EX
+
+/*----------------------------------------------------------------------
+|   ATX_Referenceable interface
++---------------------------------------------------------------------*/
+ATX_IMPLEMENT_REFERENCEABLE_INTERFACE_EX(CaptureOutput,
+                                         BLT_BaseMediaNode,
+                                         reference_count)
+
+/*----------------------------------------------------------------------
+|   CaptureOutputModule_Probe
++---------------------------------------------------------------------*/
+BLT_METHOD
+CaptureOutputModule_Probe(BLT_Module*              self,
+                          BLT_Core*                core,
+                          BLT_ModuleParametersType parameters_type,
+                          BLT_AnyConst             parameters,
+                          BLT_Cardinal*            match)
+{
+    BLT_MediaNodeConstructor* constructor = (BLT_MediaNodeConstructor*)parameters;
+
+    BLT_COMPILER_UNUSED(self);
+    BLT_COMPILER_UNUSED(core);
+
+    if (parameters_type != BLT_MODULE_PARAMETERS_TYPE_MEDIA_NODE_CONSTRUCTOR ||
+        constructor->name == NULL ||
+        !ATX_StringsEqualN(constructor->name, "capture:", 8)) {
+        return BLT_FAILURE;
+    }
+    *match = BLT_MODULE_PROBE_MATCH_EXACT;
+
+    return BLT_SUCCESS;
+}
+
+/*----------------------------------------------------------------------
+|   GetInterface implementation
++---------------------------------------------------------------------*/
+ATX_BEGIN_GET_INTERFACE_IMPLEMENTATION(CaptureOutputModule)
+    ATX_GET_INTERFACE_ACCEPT_EX(CaptureOutputModule, BLT_BaseModule, BLT_Module)
+    ATX_GET_INTERFACE_ACCEPT_EX(CaptureOutputModule, BLT_BaseModule, ATX_Referenceable)
+ATX_END_GET_INTERFACE_IMPLEMENTATION
+
+/*----------------------------------------------------------------------
+|   node factory
++---------------------------------------------------------------------*/
+BLT_MODULE_IMPLEMENT_SIMPLE_MEDIA_NODE_FACTORY(CaptureOutputModule, CaptureOutput)
+
+/*----------------------------------------------------------------------
+|   BLT_Module interface
++---------------------------------------------------------------------*/
+ATX_BEGIN_INTERFACE_MAP_EX(CaptureOutputModule, BLT_BaseModule, BLT_Module)
+    BLT_BaseModule_GetInfo,
+    BLT_BaseModule_Attach,
+    CaptureOutputModule_CreateInstance,
+    CaptureOutputModule_Probe
+ATX_END_INTERFACE_MAP
+
+/*----------------------------------------------------------------------
+|   ATX_Referenceable interface
++---------------------------------------------------------------------*/
+#define CaptureOutputModule_Destroy(x) \
+    BLT_BaseModule_Destroy((BLT_BaseModule*)(x))
+
+ATX_IMPLEMENT_REFERENCEABLE_INTERFACE_EX(CaptureOutputModule,
+                                         BLT_BaseModule,
+                                         reference_count)
+
+/*----------------------------------------------------------------------
+|   module object
++---------------------------------------------------------------------*/
+BLT_MODULE_IMPLEMENT_STANDARD_GET_MODULE(CaptureOutputModule,
+                                         "Capture Output",
+                                         "com.bluetune.test.output.capture",
+                                         "1.0.0",
+                                         BLT_MODULE_AXIOMATIC_COPYRIGHT)
+
+/*----------------------------------------------------------------------
+|    WriteTestFile: a 16 bit stereo sine, a different one per channel
++---------------------------------------------------------------------*/
+static void
+WriteTestFile(void)
+{
+    unsigned int i;
+
+    for (i=0; i<TEST_SAMPLE_COUNT; i++) {
+        double frequency = (i%TEST_CHANNEL_COUNT) ? 440.0 : 1000.0;
+        TestSamples[i] = (BLT_Int16)(8192.0*sin(2.0*TEST_PI*frequency*(double)(i/TEST_CHANNEL_COUNT)/TEST_SAMPLE_RATE));
+    }
+    CHECK(BLT_SUCCEEDED(TestUtils_WriteWavFile(TEST_FILENAME, TestSamples, TEST_FRAME_COUNT,
+                                               TEST_CHANNEL_COUNT, TEST_SAMPLE_RATE)));
+}
+
+/*----------------------------------------------------------------------
+|    ReadSample: the sample at 'index' in a slot, left aligned on 32 bits
++---------------------------------------------------------------------*/
+static BLT_Int32
+ReadSample(const CaptureSlot* slot, unsigned int index)
+{
+    unsigned int         width = slot->media_type.bits_per_sample/8;
+    const unsigned char* x     = slot->data+index*width;
+    BLT_UInt32           value = 0;
+    unsigned int         i;
+
+    for (i=0; i<width; i++) {
+        if (slot->media_type.sample_format == BLT_PCM_SAMPLE_FORMAT_SIGNED_INT_LE) {
+            value |= (BLT_UInt32)x[i]<<(8*(4-width+i));
+        } else {
+            value |= (BLT_UInt32)x[i]<<(8*(3-i));
+        }
+    }
+    return (BLT_Int32)value;
+}
+
+/*----------------------------------------------------------------------
+|    Play
+|
+|    Plays the test file to 'output' and returns when it has all been
+|    heard: destroying the decoder waits for the tee threads.
++---------------------------------------------------------------------*/
+static void
+Play(const char* output)
+{
+    BLT_Decoder* decoder = NULL;
+    BLT_Module*  module  = NULL;
+    unsigned int s;
+
+    for (s=0; s<TEST_SLOT_COUNT; s++) {
+        free(CaptureSlots[s].data);
+        memset(&CaptureSlots[s], 0, sizeof(CaptureSlots[s]));
+    }
+
+    CHECK(BLT_SUCCEEDED(BLT_Decoder_Create(&decoder)));
+    BLT_Decoder_RegisterBuiltins(decoder);
+#if !defined(BLT_CONFIG_MODULES_ENABLE_TEE_OUTPUT)
+    CHECK(BLT_SUCCEEDED(BLT_TeeOutputModule_GetModuleObject(&module)));
+    BLT_Decoder_RegisterModule(decoder, module);
+    ATX_RELEASE_OBJECT(module);
+#endif
+    CHECK(BLT_SUCCEEDED(BLT_CaptureOutputModule_GetModuleObject(&module)));
+    BLT_Decoder_RegisterModule(decoder, module);
+    ATX_RELEASE_OBJECT(module);
+
+    CHECK(BLT_SUCCEEDED(BLT_Decoder_SetOutput(decoder, output, "audio/pcm")));
+    CHECK(BLT_SUCCEEDED(BLT_Decoder_SetInput(decoder, TEST_FILENAME, NULL)));
+    CHECK(TestUtils_PumpToEnd(decoder) == BLT_ERROR_EOS);
+    CHECK(BLT_SUCCEEDED(BLT_Decoder_Drain(decoder)));
+
+    BLT_Decoder_Destroy(decoder);
+}
+
+/*----------------------------------------------------------------------
+|    CheckSlot
+|
+|    Checks that a slot received 'silence' frames of silence, then the
+|    whole test signal, in samples of 'bits' bits.
++---------------------------------------------------------------------*/
+static void
+CheckSlot(const CaptureSlot* slot, unsigned int bits, unsigned int silence)
+{
+    unsigned int width = bits/8;
+    unsigned int i;
+
+    CHECK(slot->media_type.base.id == BLT_MEDIA_TYPE_ID_AUDIO_PCM);
+    CHECK(slot->media_type.bits_per_sample == bits);
+    CHECK(slot->media_type.sample_rate     == TEST_SAMPLE_RATE);
+    CHECK(slot->media_type.channel_count   == TEST_CHANNEL_COUNT);
+    CHECK(slot->size == (silence*TEST_CHANNEL_COUNT+TEST_SAMPLE_COUNT)*width);
+
+    for (i=0; i<silence*TEST_CHANNEL_COUNT; i++) {
+        CHECK(ReadSample(slot, i) == 0);
+    }
+    for (i=0; i<TEST_SAMPLE_COUNT; i++) {
+        CHECK(ReadSample(slot, silence*TEST_CHANNEL_COUNT+i) == (BLT_Int32)TestSamples[i]*65536);
+    }
+}
+
+/*----------------------------------------------------------------------
+|    main
++---------------------------------------------------------------------*/
+int
+main(int argc, char** argv)
+{
+    unsigned int s;
+
+    BLT_COMPILER_UNUSED(argc);
+    BLT_COMPILER_UNUSED(argv);
+
+    WriteTestFile();
+
+    /* every output gets all of it */
+    Play("tee:capture:0|capture:1");
+    CheckSlot(&CaptureSlots[0], 16, 0);
+    CheckSlot(&CaptureSlots[1], 16, 0);
+
+    /* the output with less latency is delayed to play in sync */
+    Play("tee:capture:0#100|capture:1");
+    CheckSlot(&CaptureSlots[0], 16, 0);
+    CheckSlot(&CaptureSlots[1], 16, TEST_SAMPLE_RATE*TEST_LATENCY/1000);
+
+    /* both get the format that the second one expects */
+    Play("tee:capture:0|capture:1:24");
+    CheckSlot(&CaptureSlots[0], 24, 0);
+    CheckSlot(&CaptureSlots[1], 24, 0);
+
+    for (s=0; s<TEST_SLOT_COUNT; s++) free(CaptureSlots[s].data);
+    remove(TEST_FILENAME);
+
+    printf("TeeOutputTest passed\n");
+    return 0;
+}
@@ -0,0 +1,264 @@
+/*****************************************************************
+|
+|   BlueTune - Time Stretch Test
+|
+|   (c) 2002-2012 Gilles Boccon-Gibod
+|   Author: Gilles Boccon-Gibod (bok@bok.net)
+|
+****************************************************************/
+
+/*----------------------------------------------------------------------
+|    includes
++---------------------------------------------------------------------*/
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+
+#include "Atomix.h"
+#include "BltConfig.h"
+#include "BltErrors.h"
+#include "BltTimeStretch.h"
+
+/*----------------------------------------------------------------------
+|    constants
++---------------------------------------------------------------------*/
+#define TEST_SAMPLE_RATE   44100
+#define TEST_CHANNEL_COUNT 2
+#define TEST_FRAME_COUNT   (4*TEST_SAMPLE_RATE)
+#define TEST_FREQUENCY     440.0
+#define TEST_AMPLITUDE     0.5
+#define TEST_CHUNK         1031 /* frames written at a time */
+#define TEST_OUTPUT_FRAMES 4096 /* output buffer, in frames */
+#define TEST_PI            3.14159265358979323846
+
+/*----------------------------------------------------------------------
+|    CHECK
++---------------------------------------------------------------------*/
+#define CHECK(x)                                        \
+do {                                                    \
+    if (!(x)) {                                         \
+        fprintf(stderr, "FAILED line %d\n", __LINE__);  \
+        abort();                                        \
+    }                                                   \
+} while(0)
+
+/*----------------------------------------------------------------------
+|    MakeTone: a sine, with a slightly different phase on each channel
++---------------------------------------------------------------------*/
+static float*
+MakeTone(unsigned int frame_count)
+{
+    float*       samples = (float*)malloc(frame_count*TEST_CHANNEL_COUNT*sizeof(float));
+    unsigned int i;
+    unsigned int c;
+
+    for (i=0; i<frame_count; i++) {
+        for (c=0; c<TEST_CHANNEL_COUNT; c++) {
+            samples[i*TEST_CHANNEL_COUNT+c] =
+                (float)(TEST_AMPLITUDE*sin(2.0*TEST_PI*TEST_FREQUENCY*(double)i/TEST_SAMPLE_RATE+0.1*c));
+        }
+    }
+
+    return samples;
+}
+
+/*----------------------------------------------------------------------
+|    Stretch
+|
+|    Runs all of the input through the stretcher at a rate, then flushes
+|    it, and returns the number of output frames.
++---------------------------------------------------------------------*/
+static unsigned int
+Stretch(BLT_TimeStretch* stretch,
+        const float*     input,
+        unsigned int     frame_count,
+        double           rate,
+        float*           output,
+        unsigned int     max_frames)
+{
+    unsigned int produced = 0;
+    unsigned int written  = 0;
+    unsigned int count;
+
+    while (written < frame_count) {
+        unsigned int chunk = frame_count-written < TEST_CHUNK ? frame_count-written : TEST_CHUNK;
+        written += BLT_TimeStretch_Write(stretch, input+written*TEST_CHANNEL_COUNT, chunk);
+        do {
+            CHECK(produced+TEST_OUTPUT_FRAMES <= max_frames);
+            count = BLT_TimeStretch_Process(stretch, rate, output+produced*TEST_CHANNEL_COUNT, TEST_OUTPUT_FRAMES);
+            produced += count;
+        } while (count);
+    }
+    do {
+        CHECK(produced+TEST_OUTPUT_FRAMES <= max_frames);
+        count = BLT_TimeStretch_Flush(stretch, output+produced*TEST_CHANNEL_COUNT, TEST_OUTPUT_FRAMES);
+        produced += count;
+    } while (count);
+
+    return produced;
+}
+
+/*----------------------------------------------------------------------
+|    GetFrequency: counts the rising zero crossings of the first channel
++---------------------------------------------------------------------*/
+static double
+GetFrequency(const float* samples, unsigned int first, unsigned int last)
+{
+    unsigned int crossings = 0;
+    unsigned int start = 0;
+    unsigned int end   = 0;
+    unsigned int i;
+
+    for (i=first+1; i<last; i++) {
+        if (samples[(i-1)*TEST_CHANNEL_COUNT] < 0.0f && samples[i*TEST_CHANNEL_COUNT] >= 0.0f) {
+            if (crossings++ == 0) start = i;
+            end = i;
+        }
+    }
+    CHECK(crossings > 1);
+
+    return (double)(crossings-1)*TEST_SAMPLE_RATE/(double)(end-start);
+}
+
+/*----------------------------------------------------------------------
+|    CheckSmooth: no jumps bigger than what the tone itself has
++---------------------------------------------------------------------*/
+static void
+CheckSmooth(const float* samples, unsigned int frame_count)
+{
+    double       limit = 1.5*TEST_AMPLITUDE*2.0*TEST_PI*TEST_FREQUENCY/TEST_SAMPLE_RATE;
+    unsigned int i;
+
+    for (i=TEST_CHANNEL_COUNT; i<frame_count*TEST_CHANNEL_COUNT; i++) {
+        CHECK(fabs(samples[i]-samples[i-TEST_CHANNEL_COUNT]) <= limit);
+    }
+}
+
+/*----------------------------------------------------------------------
+|    TestRates
++---------------------------------------------------------------------*/
+static void
+TestRates(void)
+{
+    static const double rates[] = { 0.5, 0.8, 1.25, 2.0, 3.0 };
+    float*              input   = MakeTone(TEST_FRAME_COUNT);
+    unsigned int        max_frames = 2*TEST_FRAME_COUNT+2*TEST_OUTPUT_FRAMES;
+    float*              output  = (float*)malloc(max_frames*TEST_CHANNEL_COUNT*sizeof(float));
+    BLT_TimeStretch*    stretch = NULL;
+    unsigned int        r;
+
+    CHECK(BLT_SUCCEEDED(BLT_TimeStretch_Create(TEST_SAMPLE_RATE, TEST_CHANNEL_COUNT, &stretch)));
+    for (r=0; r<sizeof(rates)/sizeof(rates[0]); r++) {
+        unsigned int hop      = BLT_TimeStretch_GetHopSize(stretch);
+        unsigned int expected = (unsigned int)(TEST_FRAME_COUNT/rates[r]);
+        unsigned int produced;
+        double       frequency;
+
+        BLT_TimeStretch_Reset(stretch);
+        produced = Stretch(stretch, input, TEST_FRAME_COUNT, rates[r], output, max_frames);
+
+        /* the duration changes, and all the input is used up. What the  */
+        /* stretcher still holds at the end comes out at the normal rate */
+        CHECK(produced+6*hop >= expected && produced <= expected+6*hop);
+        CHECK(BLT_TimeStretch_GetBufferedFrames(stretch) == 0);
+        CHECK(BLT_TimeStretch_GetPosition(stretch) == (double)TEST_FRAME_COUNT);
+
+        /* the pitch does not, and the segments join without clicks */
+        frequency = GetFrequency(output, produced/4, 3*produced/4);
+        CHECK(fabs(frequency-TEST_FREQUENCY) <= 0.01*TEST_FREQUENCY);
+        CheckSmooth(output, produced);
+    }
+
+    BLT_TimeStretch_Destroy(stretch);
+    free(output);
+    free(input);
+}
+
+/*----------------------------------------------------------------------
+|    TestPosition
+|
+|    The position follows the media time at any rate, also when the rate
+|    changes, and a flush hands back the input where the stretching left
+|    off.
++---------------------------------------------------------------------*/
+static void
+TestPosition(void)
+{
+    float*           input   = MakeTone(TEST_FRAME_COUNT);
+    float*           output  = (float*)malloc(TEST_OUTPUT_FRAMES*TEST_CHANNEL_COUNT*sizeof(float));
+    BLT_TimeStretch* stretch = NULL;
+    unsigned int     written = 0;
+    double           media   = 0.0;
+    unsigned int     count;
+    unsigned int     hop;
+    double           position;
+
+    CHECK(BLT_SUCCEEDED(BLT_TimeStretch_Create(TEST_SAMPLE_RATE, TEST_CHANNEL_COUNT, &stretch)));
+    hop = BLT_TimeStretch_GetHopSize(stretch);
+
+    /* nothing comes out until there is enough input for a step */
+    CHECK(BLT_TimeStretch_Write(stretch, input, hop) == hop);
+    CHECK(BLT_TimeStretch_Process(stretch, 2.0, output, TEST_OUTPUT_FRAMES) == 0);
+    CHECK(BLT_TimeStretch_Process(stretch, 2.0, output, hop-1) == 0);
+    written = hop;
+
+    /* each step moves the position by the rate times the hop */
+    while (written < TEST_FRAME_COUNT/2) {
+        double rate = written < TEST_FRAME_COUNT/4 ? 2.0 : 0.5;
+        written += BLT_TimeStretch_Write(stretch, input+written*TEST_CHANNEL_COUNT, TEST_CHUNK);
+        while ((count = BLT_TimeStretch_Process(stretch, rate, output, TEST_OUTPUT_FRAMES))) {
+            CHECK(count%hop == 0);
+            media += rate*(double)count;
+            CHECK(fabs(BLT_TimeStretch_GetPosition(stretch)-media) < 1e-6);
+        }
+    }
+
+    /* the flush picks up near the position, where the last segment */
+    /* ends, and goes on at the normal rate up to the end of the input */
+    position = BLT_TimeStretch_GetPosition(stretch);
+    count    = BLT_TimeStretch_Flush(stretch, output, TEST_OUTPUT_FRAMES);
+    CHECK(count > 0);
+    CHECK(fabs(BLT_TimeStretch_GetPosition(stretch)-(double)count-position) <= 2.0*hop);
+    do {
+        position = BLT_TimeStretch_GetPosition(stretch);
+        count    = BLT_TimeStretch_Flush(stretch, output, TEST_OUTPUT_FRAMES);
+        if (count) CHECK(BLT_TimeStretch_GetPosition(stretch) == position+(double)count);
+    } while (count);
+    CHECK(BLT_TimeStretch_GetPosition(stretch) == (double)written);
+    CHECK(BLT_TimeStretch_GetBufferedFrames(stretch) == 0);
+
+    /* before the first step, the input comes back as is */
+    BLT_TimeStretch_Reset(stretch);
+    CHECK(BLT_TimeStretch_Write(stretch, input, 1000) == 1000);
+    CHECK(BLT_TimeStretch_Flush(stretch, output, TEST_OUTPUT_FRAMES) == 1000);
+    CHECK(memcmp(output, input, 1000*TEST_CHANNEL_COUNT*sizeof(float)) == 0);
+    CHECK(BLT_TimeStretch_Flush(stretch, output, TEST_OUTPUT_FRAMES) == 0);
+
+    BLT_TimeStretch_Destroy(stretch);
+    free(output);
+    free(input);
+}
+
+/*----------------------------------------------------------------------
+|    main
++---------------------------------------------------------------------*/
+int
+main(int argc, char** argv)
+{
+    BLT_TimeStretch* stretch = NULL;
+
+    BLT_COMPILER_UNUSED(argc);
+    BLT_COMPILER_UNUSED(argv);
+
+    CHECK(BLT_TimeStretch_Create(TEST_SAMPLE_RATE, 0, &stretch) == BLT_ERROR_NOT_SUPPORTED);
+    CHECK(BLT_TimeStretch_Create(TEST_SAMPLE_RATE, BLT_TIME_STRETCH_MAX_CHANNELS+1, &stretch) ==
+          BLT_ERROR_NOT_SUPPORTED);
+    CHECK(stretch == NULL);
+
+    TestRates();
+    TestPosition();
+
+    printf("TimeStretchTest passed\n");
+    return 0;
+}